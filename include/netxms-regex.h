@@ -36,6 +36,9 @@
 #define _pcre_compile_w         pcre16_compile
 #define _pcre_exec_w            pcre16_exec
 #define _pcre_free_w            pcre16_free
+#define PCRE_EXTRA_DATA_W       pcre16_extra
+#define _pcre_study_w           pcre16_study
+#define _pcre_free_study_w      pcre16_free_study
 #else
 #define PCRE_WCHAR              PCRE_UCHAR32
 #define PCREW                   pcre32
@@ -43,6 +46,9 @@
 #define _pcre_compile_w         pcre32_compile
 #define _pcre_exec_w            pcre32_exec
 #define _pcre_free_w            pcre32_free
+#define PCRE_EXTRA_DATA_W       pcre32_extra
+#define _pcre_study_w           pcre32_study
+#define _pcre_free_study_w      pcre32_free_study
 #endif
 
 #ifdef UNICODE
@@ -51,12 +57,18 @@
 #define _pcre_compile_t         _pcre_compile_w
 #define _pcre_exec_t            _pcre_exec_w
 #define _pcre_free_t            _pcre_free_w
+#define PCRE_EXTRA_DATA         PCRE_EXTRA_DATA_W
+#define _pcre_study_t           _pcre_study_w
+#define _pcre_free_study_t      _pcre_free_study_w
 #else   /* UNICODE */
 #define PCRE_TCHAR              char
 #define PCRE                    pcre
 #define _pcre_compile_t         pcre_compile
 #define _pcre_exec_t            pcre_exec
 #define _pcre_free_t            pcre_free
+#define PCRE_EXTRA_DATA         pcre_extra
+#define _pcre_study_t           pcre_study
+#define _pcre_free_study_t      pcre_free_study
 #endif
 
 #define PCRE_COMMON_FLAGS_W     (PCRE_UNICODE_FLAGS | PCRE_DOTALL | PCRE_BSR_UNICODE | PCRE_NEWLINE_ANY)
@@ -68,4 +80,13 @@
 #define PCRE_COMMON_FLAGS       PCRE_COMMON_FLAGS_A
 #endif
 
+/**
+ * Study flags for patterns which are matched many times (use JIT compilation if supported by PCRE library)
+ */
+#ifdef PCRE_STUDY_JIT_COMPILE
+#define PCRE_COMMON_STUDY_FLAGS PCRE_STUDY_JIT_COMPILE
+#else
+#define PCRE_COMMON_STUDY_FLAGS 0
+#endif
+
 #endif	/* _netxms_regex_h */
@@ -25,7 +25,7 @@
 
 #define DB_LEGACY_SCHEMA_VERSION       700
 #define DB_SCHEMA_VERSION_MAJOR        32
-#define DB_SCHEMA_VERSION_MINOR        9
+#define DB_SCHEMA_VERSION_MINOR        17
 
 #define DB_SCHEMA_VERSION_V32_MINOR    DB_SCHEMA_VERSION_MINOR
 
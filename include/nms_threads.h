@@ -1207,9 +1207,10 @@ ThreadPool LIBNETXMS_EXPORTABLE *ThreadPoolCreate(const TCHAR *name, int minThre
 void LIBNETXMS_EXPORTABLE ThreadPoolDestroy(ThreadPool *p);
 void LIBNETXMS_EXPORTABLE ThreadPoolExecute(ThreadPool *p, ThreadPoolWorkerFunction f, void *arg);
 void LIBNETXMS_EXPORTABLE ThreadPoolExecuteSerialized(ThreadPool *p, const TCHAR *key, ThreadPoolWorkerFunction f, void *arg);
-void LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsolute(ThreadPool *p, time_t runTime, ThreadPoolWorkerFunction f, void *arg);
-void LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsoluteMs(ThreadPool *p, INT64 runTime, ThreadPoolWorkerFunction f, void *arg);
-void LIBNETXMS_EXPORTABLE ThreadPoolScheduleRelative(ThreadPool *p, UINT32 delay, ThreadPoolWorkerFunction f, void *arg);
+UINT64 LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsolute(ThreadPool *p, time_t runTime, ThreadPoolWorkerFunction f, void *arg);
+UINT64 LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsoluteMs(ThreadPool *p, INT64 runTime, ThreadPoolWorkerFunction f, void *arg);
+UINT64 LIBNETXMS_EXPORTABLE ThreadPoolScheduleRelative(ThreadPool *p, UINT32 delay, ThreadPoolWorkerFunction f, void *arg);
+bool LIBNETXMS_EXPORTABLE ThreadPoolCancelScheduledTask(ThreadPool *p, UINT64 taskId);
 void LIBNETXMS_EXPORTABLE ThreadPoolGetInfo(ThreadPool *p, ThreadPoolInfo *info);
 bool LIBNETXMS_EXPORTABLE ThreadPoolGetInfo(const TCHAR *name, ThreadPoolInfo *info);
 int LIBNETXMS_EXPORTABLE ThreadPoolGetSerializedRequestCount(ThreadPool *p, const TCHAR *key);
@@ -1278,25 +1279,25 @@ template <typename T> inline void ThreadPoolExecuteSerialized(ThreadPool *p, con
 /**
  * Wrapper for ThreadPoolScheduleAbsolute to use pointer to given type as argument
  */
-template <typename T> inline void ThreadPoolScheduleAbsolute(ThreadPool *p, time_t runTime, void (*f)(T *), T *arg)
+template <typename T> inline UINT64 ThreadPoolScheduleAbsolute(ThreadPool *p, time_t runTime, void (*f)(T *), T *arg)
 {
-   ThreadPoolScheduleAbsolute(p, runTime, (ThreadPoolWorkerFunction)f, (void *)arg);
+   return ThreadPoolScheduleAbsolute(p, runTime, (ThreadPoolWorkerFunction)f, (void *)arg);
 }
 
 /**
  * Wrapper for ThreadPoolScheduleAbsoluteMs to use pointer to given type as argument
  */
-template <typename T> inline void ThreadPoolScheduleAbsoluteMs(ThreadPool *p, INT64 runTime, void (*f)(T *), T *arg)
+template <typename T> inline UINT64 ThreadPoolScheduleAbsoluteMs(ThreadPool *p, INT64 runTime, void (*f)(T *), T *arg)
 {
-   ThreadPoolScheduleAbsoluteMs(p, runTime, (ThreadPoolWorkerFunction)f, (void *)arg);
+   return ThreadPoolScheduleAbsoluteMs(p, runTime, (ThreadPoolWorkerFunction)f, (void *)arg);
 }
 
 /**
  * Wrapper for ThreadPoolScheduleRelative to use pointer to given type as argument
  */
-template <typename T> inline void ThreadPoolScheduleRelative(ThreadPool *p, UINT32 delay, void (*f)(T *), T *arg)
+template <typename T> inline UINT64 ThreadPoolScheduleRelative(ThreadPool *p, UINT32 delay, void (*f)(T *), T *arg)
 {
-   ThreadPoolScheduleRelative(p, delay, (ThreadPoolWorkerFunction)f, (void *)arg);
+   return ThreadPoolScheduleRelative(p, delay, (ThreadPoolWorkerFunction)f, (void *)arg);
 }
 
 /**
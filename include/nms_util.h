@@ -605,16 +605,39 @@ template <class T> class ObjectMemoryPool
 };
 
 /**
- * Simple allocate only heap
+ * Number of size classes in memory pool free lists (blocks from 8 to 512 bytes with 8 bytes step)
+ */
+#define MEMPOOL_SIZE_CLASSES  64
+
+/**
+ * Memory pool checkpoint
+ */
+struct MemoryPoolCheckpoint
+{
+   void *region;
+   size_t allocated;
+};
+
+/**
+ * Arena allocator. Memory is allocated from large regions and released when pool is
+ * cleared or destroyed. Individual small blocks can be returned to pool with free() and will
+ * be reused by subsequent allocations of same size class. Regions of destroyed or cleared
+ * pools are kept in small per-thread cache, so short living pools (like one per message
+ * or per request) usually do not touch system heap at all.
  */
 class LIBNETXMS_EXPORTABLE MemoryPool
 {
 private:
    void *m_currentRegion;
+   void **m_freeLists;
    size_t m_headerSize;
    size_t m_regionSize;
+   size_t m_currentRegionSize;
    size_t m_allocated;
 
+   void *allocateRegion(size_t size);
+   void releaseRegion(void *region);
+
 public:
    /**
     * Create new memory pool
@@ -687,17 +710,77 @@ class LIBNETXMS_EXPORTABLE MemoryPool
       return static_cast<T*>(p);
    }
 
+   /**
+    * Return memory block to pool. Size should be the same as was requested on allocation.
+    */
+   void free(void *p, size_t size);
+
+   /**
+    * Destroy object created in pool and return memory to pool
+    */
+   template<typename T> void destroy(T *object)
+   {
+      if (object == NULL)
+         return;
+      object->~T();
+      free(object, sizeof(T));
+   }
+
    /**
     * Drop all allocated memory except one region
     */
    void clear();
 
+   /**
+    * Create checkpoint for later rollback
+    */
+   MemoryPoolCheckpoint checkpoint() const
+   {
+      MemoryPoolCheckpoint cp;
+      cp.region = m_currentRegion;
+      cp.allocated = m_allocated;
+      return cp;
+   }
+
+   /**
+    * Release all memory allocated after given checkpoint. Blocks returned to pool by free()
+    * before rollback will not be reused until pool is cleared.
+    */
+   void rollback(const MemoryPoolCheckpoint& cp);
+
    /**
     * Get region size
     */
    size_t regionSize() const { return m_regionSize; }
 };
 
+/**
+ * Scoped arena - all memory allocated from underlying pool within scope lifetime is released
+ * when scope is destroyed. Allows reuse of long living (for example, per-thread) pool for
+ * processing of individual requests.
+ */
+class MemoryPoolScope
+{
+   DISABLE_COPY_CTOR(MemoryPoolScope)
+
+private:
+   MemoryPool *m_pool;
+   MemoryPoolCheckpoint m_checkpoint;
+
+public:
+   MemoryPoolScope(MemoryPool *pool) : m_checkpoint(pool->checkpoint())
+   {
+      m_pool = pool;
+   }
+
+   ~MemoryPoolScope()
+   {
+      m_pool->rollback(m_checkpoint);
+   }
+
+   MemoryPool *pool() { return m_pool; }
+};
+
 /**
  * Resource pool element
  */
@@ -1436,8 +1519,7 @@ class LIBNETXMS_EXPORTABLE StringMapIterator : public AbstractIterator
 
 private:
    StringMapBase *m_map;
-   StringMapEntry *m_curr;
-   StringMapEntry *m_next;
+   int m_position;
    std::pair<const TCHAR*, const TCHAR*> m_element;
 
 public:
@@ -1450,18 +1532,27 @@ class LIBNETXMS_EXPORTABLE StringMapIterator : public AbstractIterator
 };
 
 /**
- * String maps base class
+ * String maps base class. Entries are kept in insertion order in contiguous array
+ * and located via open addressing index.
  */
 class LIBNETXMS_EXPORTABLE StringMapBase
 {
    friend class StringMapIterator;
 
 private:
-   StringMapEntry *find(const TCHAR *key, size_t keyLen) const;
+   StringMapEntry *find(const TCHAR *key, size_t keyLen, UINT32 *hash = NULL) const;
+   void rebuildIndex();
+   void reserveEntry();
+   void *removeEntry(int position);
    void destroyObject(void *object) { if (object != NULL) m_objectDestructor(object, this); }
 
 protected:
-   StringMapEntry *m_data;
+   StringMapEntry *m_data;   // Entries in insertion order (may contain deleted entries)
+   UINT64 *m_index;          // Open addressing index
+   UINT32 m_indexMask;
+   int m_used;               // Number of used entries in m_data (including deleted)
+   int m_allocated;
+   int m_size;
    bool m_objectOwner;
    bool m_ignoreCase;
    void (*m_objectDestructor)(void *, StringMapBase *);
@@ -1484,8 +1575,9 @@ class LIBNETXMS_EXPORTABLE StringMapBase
    void clear();
    void filterElements(bool (*filter)(const TCHAR *, const void *, void *), void *userData);
 
-   int size() const;
-   bool isEmpty() const { return size() == 0; }
+   int size() const { return m_size; }
+   bool isEmpty() const { return m_size == 0; }
+   size_t memoryUsage() const;
    bool contains(const TCHAR *key) const { return (key != NULL) ? (find(key, _tcslen(key) * sizeof(TCHAR)) != NULL) : false; }
    bool contains(const TCHAR *key, size_t len) const { return (key != NULL) ? (find(key, len * sizeof(TCHAR)) != NULL) : false; }
 
@@ -1901,19 +1993,28 @@ template <class K> class HashSet : public HashSetBase
 struct HashMapEntry;
 
 /**
- * Hash map base class (for fixed size non-pointer keys)
+ * Hash map base class (for fixed size non-pointer keys). Entries are kept in insertion
+ * order in contiguous array and located via open addressing index.
  */
 class LIBNETXMS_EXPORTABLE HashMapBase
 {
    friend class HashMapIterator;
 
 private:
-   HashMapEntry *m_data;
+   HashMapEntry *m_data;   // Entries in insertion order (may contain deleted entries)
+   UINT64 *m_index;        // Open addressing index
+   UINT32 m_indexMask;
+   int m_used;             // Number of used entries in m_data (including deleted)
+   int m_allocated;
+   int m_size;
 	bool m_objectOwner;
    unsigned int m_keylen;
    void *m_context;
 
-	HashMapEntry *find(const void *key) const;
+	HashMapEntry *find(const void *key, UINT32 hash) const;
+   void rebuildIndex();
+   void reserveEntry();
+   void removeEntry(int position, bool destroyValue);
 	void destroyObject(void *object) { if (object != NULL) m_objectDestructor(object, this); }
 
 protected:
@@ -1925,7 +2026,7 @@ class LIBNETXMS_EXPORTABLE HashMapBase
 	void _set(const void *key, void *value);
 	void _remove(const void *key, bool destroyValue);
 
-   bool _contains(const void *key) const { return find(key) != NULL; }
+   bool _contains(const void *key) const;
 
 public:
    virtual ~HashMapBase();
@@ -1933,7 +2034,8 @@ class LIBNETXMS_EXPORTABLE HashMapBase
    void setOwner(Ownership owner) { m_objectOwner = (owner == Ownership::True); }
 	void clear();
 
-	int size() const;
+	int size() const { return m_size; }
+   size_t memoryUsage() const;
 
    EnumerationCallbackResult forEach(EnumerationCallbackResult (*cb)(const void *, const void *, void *), void *userData) const;
    const void *findElement(bool (*comparator)(const void *, const void *, void *), void *userData) const;
@@ -1951,8 +2053,7 @@ class LIBNETXMS_EXPORTABLE HashMapIterator : public AbstractIterator
 
 private:
    HashMapBase *m_hashMap;
-   HashMapEntry *m_curr;
-   HashMapEntry *m_next;
+   int m_position;
 
 public:
    HashMapIterator(HashMapBase *hashMap);
@@ -3139,8 +3240,18 @@ typedef struct _dir_struc_w
 
 #ifdef __cplusplus
 
+/**
+ * Data block descriptor for vectored send
+ */
+struct SendBlock
+{
+   const void *data;
+   size_t size;
+};
+
 int LIBNETXMS_EXPORTABLE ConnectEx(SOCKET s, struct sockaddr *addr, int len, UINT32 timeout, bool *isTimeout = NULL);
 ssize_t LIBNETXMS_EXPORTABLE SendEx(SOCKET hSocket, const void *data, size_t len, int flags, MUTEX mutex);
+ssize_t LIBNETXMS_EXPORTABLE SendVectorEx(SOCKET hSocket, const SendBlock *blocks, int count, MUTEX mutex);
 ssize_t LIBNETXMS_EXPORTABLE RecvEx(SOCKET hSocket, void *data, size_t len, int flags, UINT32 timeout, SOCKET controlSocket = INVALID_SOCKET);
 bool LIBNETXMS_EXPORTABLE RecvAll(SOCKET s, void *buffer, size_t size, UINT32 timeout);
 
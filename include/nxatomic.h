@@ -130,6 +130,14 @@ inline void InterlockedOr(VolatileCounter *target, UINT32 bits)
    atomic_or_32(target, bits);
 }
 
+/**
+ * Atomic bitwise AND
+ */
+inline void InterlockedAnd(VolatileCounter *target, UINT32 bits)
+{
+   atomic_and_32(target, bits);
+}
+
 #elif defined(__HP_aCC)
 
 typedef volatile uint32_t VolatileCounter;
@@ -333,6 +341,22 @@ inline void InterlockedOr(VolatileCounter *target, UINT32 bits)
 #endif
 }
 
+/**
+ * Atomic bitwise AND
+ */
+inline void InterlockedAnd(VolatileCounter *target, UINT32 bits)
+{
+#if !HAVE_DECL___SYNC_OR_AND_FETCH
+   UINT32 c;
+   do
+   {
+      c = *target;
+   } while(InterlockedCompareExchange(target, c & bits, c) != c);
+#else
+   __sync_and_and_fetch(target, bits);
+#endif
+}
+
 #else /* not Solaris nor HP-UX nor AIX */
 
 typedef volatile INT32 VolatileCounter;
@@ -441,6 +465,22 @@ inline void InterlockedOr(VolatileCounter *target, UINT32 bits)
 #endif
 }
 
+/**
+ * Atomic bitwise AND
+ */
+inline void InterlockedAnd(VolatileCounter *target, UINT32 bits)
+{
+#if defined(__GNUC__) && ((__GNUC__ < 4) || (__GNUC_MINOR__ < 1)) && (defined(__i386__) || defined(__x86_64__))
+   UINT32 c;
+   do
+   {
+      c = *target;
+   } while(InterlockedCompareExchange(target, c & bits, c) != c);
+#else
+   __sync_and_and_fetch(target, bits);
+#endif
+}
+
 #endif   /* __sun */
 
 #endif   /* _WIN32 */
@@ -51,6 +51,9 @@ typedef struct
 #ifdef __cplusplus
 
 struct MessageField;
+struct MessageFieldIndexEntry;
+class MessageStreamWriter;
+class NXCPEncryptionContext;
 
 /**
  * Default size hint
@@ -70,14 +73,26 @@ class LIBNETXMS_EXPORTABLE NXCPMessage
    int m_version;          // Protocol version
    BYTE *m_data;           // binary data
    size_t m_dataSize;      // binary data size
-   MemoryPool m_pool;
+   const BYTE *m_rawFields;   // serialized fields (view mode only)
+   size_t m_rawFieldsSize;    // size of serialized fields
+   int m_rawFieldCount;       // number of serialized fields
+   bool m_external;           // true if m_rawFields or m_data points to caller's buffer
+   NXCP_MESSAGE *m_buffer;    // serialized message owned by view (freed on destruction)
+   mutable MessageFieldIndexEntry *m_index;  // field offset index (view mode only)
+   mutable int m_indexSize;                  // number of index entries or -1 if not built yet
+   mutable MemoryPool m_pool;
 
-   NXCPMessage(const NXCP_MESSAGE *msg, int version);
+   NXCPMessage(const NXCP_MESSAGE *msg, int version, bool view);
 
    void *set(UINT32 fieldId, BYTE type, const void *value, bool isSigned = false, size_t size = 0, bool isUtf8 = false);
    void *get(UINT32 fieldId, BYTE requiredType, BYTE *fieldType = NULL) const;
    NXCP_MESSAGE_FIELD *find(UINT32 fieldId) const;
+   NXCP_MESSAGE_FIELD *findInView(UINT32 fieldId) const;
+   bool buildIndex() const;
+   void materialize();
    bool isValid() { return m_version != -1; }
+   size_t calculateSerializedSize(UINT32 *fieldCount) const;
+   void serializeFields(MessageStreamWriter *writer) const;
 
    TCHAR *getFieldAsString(UINT32 fieldId, MemoryPool *pool, TCHAR *buffer, size_t bufferSize) const;
 
@@ -88,7 +103,14 @@ class LIBNETXMS_EXPORTABLE NXCPMessage
    ~NXCPMessage();
 
    static NXCPMessage *deserialize(const NXCP_MESSAGE *rawMsg, int version = NXCP_VERSION);
+   static NXCPMessage *createView(const NXCP_MESSAGE *rawMsg, int version = NXCP_VERSION);
    NXCP_MESSAGE *serialize(bool allowCompression = false) const;
+   bool sendTo(SOCKET s, MUTEX mutex = INVALID_MUTEX_HANDLE, NXCPEncryptionContext *ctx = NULL, bool allowCompression = false, size_t *wireSize = NULL) const;
+
+   bool isView() const { return m_rawFields != NULL; }
+   bool isDetached() const { return !m_external; }
+   void detach();
+   void adoptBuffer(NXCP_MESSAGE *rawMsg);
 
    UINT16 getCode() const { return m_code; }
    void setCode(UINT16 code) { m_code = code; }
@@ -173,47 +195,45 @@ class LIBNETXMS_EXPORTABLE NXCPMessage
 };
 
 /**
- * Message waiting queue element structure
+ * Message waiting queue element (internal)
  */
-typedef struct
-{
-   void *msg;         // Pointer to message, either to NXCPMessage object or raw message
-   UINT64 sequence;   // Sequence number
-   UINT32 id;         // Message ID
-   UINT32 ttl;        // Message time-to-live in milliseconds
-   UINT16 code;       // Message code
-   UINT16 isBinary;   // 1 for binary (raw) messages
-} WAIT_QUEUE_ELEMENT;
+struct MsgWaitQueueElement;
 
 /**
- * Max number of waiting threads in message queue
+ * Thread waiting for message in message waiting queue (internal)
  */
-#define MAX_MSGQUEUE_WAITERS     32
+struct MsgWaitQueueWaiter;
+
+class TimerWheel;
 
 /**
- * Message waiting queue class
+ * Message waiting queue class. Unclaimed messages and waiting threads are indexed
+ * by message ID and code, so incoming message is handed over directly to the thread
+ * waiting for it. Unclaimed messages are expired by shared timer.
  */
 class LIBNETXMS_EXPORTABLE MsgWaitQueue
 {
 private:
 #if defined(_WIN32)
    CRITICAL_SECTION m_mutex;
-   HANDLE m_wakeupEvents[MAX_MSGQUEUE_WAITERS];
-   BYTE m_waiters[MAX_MSGQUEUE_WAITERS];
 #elif defined(_USE_GNU_PTH)
    pth_mutex_t m_mutex;
-   pth_cond_t m_wakeupCondition;
 #else
    pthread_mutex_t m_mutex;
-   pthread_cond_t m_wakeupCondition;
 #endif
    UINT32 m_holdTime;
    int m_size;
-   int m_allocated;
-   WAIT_QUEUE_ELEMENT *m_elements;
-   UINT64 m_sequence;
-
+   HashMap<UINT64, MsgWaitQueueElement> *m_messages;
+   HashMap<UINT64, MsgWaitQueueWaiter> *m_waiters;
+   ObjectMemoryPool<MsgWaitQueueElement> m_elementPool;
+   MsgWaitQueueWaiter *m_freeWaiters;
+   bool m_timerScheduled;  // Protected by queue lock
+   UINT64 m_timerId;       // Protected by housekeeper lock
+
+   void putInternal(UINT16 isBinary, UINT16 code, UINT32 id, void *msg);
    void *waitForMessageInternal(UINT16 isBinary, UINT16 code, UINT32 id, UINT32 timeout);
+   void scheduleExpirationTimer(INT64 expirationTime);
+   INT64 expireMessages(INT64 now);
 
    void lock()
    {
@@ -237,22 +257,22 @@ class LIBNETXMS_EXPORTABLE MsgWaitQueue
 #endif
    }
 
-   void housekeeperRun();
-
    static MUTEX m_housekeeperLock;
-   static HashMap<UINT64, MsgWaitQueue> *m_activeQueues;
-   static CONDITION m_shutdownCondition;
+   static TimerWheel *m_expirationTimers;
+   static CONDITION m_housekeeperWakeup;
+   static INT64 m_housekeeperWakeupTime;
+   static bool m_shutdown;
    static THREAD m_housekeeperThread;
-   static EnumerationCallbackResult houseKeeperCallback(const void *key, const void *object, void *arg);
+   static VolatileCounter m_activeQueues;
+   static void expirationCallback(void *data, void *context);
    static THREAD_RESULT THREAD_CALL housekeeperThread(void *);
-   static EnumerationCallbackResult diagInfoCallback(const void *key, const void *object, void *arg);
 
 public:
    MsgWaitQueue();
    ~MsgWaitQueue();
 
-   void put(NXCPMessage *pMsg);
-   void put(NXCP_MESSAGE *pMsg);
+   void put(NXCPMessage *msg) { putInternal(0, msg->getCode(), msg->getId(), msg); }
+   void put(NXCP_MESSAGE *msg) { putInternal(1, msg->code, msg->id, msg); }
    NXCPMessage *waitForMessage(WORD wCode, UINT32 dwId, UINT32 dwTimeOut)
    {
       return (NXCPMessage *)waitForMessageInternal(0, wCode, dwId, dwTimeOut);
@@ -297,6 +317,10 @@ class LIBNETXMS_EXPORTABLE NXCPEncryptionContext : public RefCountObject
    NXCP_ENCRYPTED_MESSAGE *encryptMessage(NXCP_MESSAGE *msg);
    bool decryptMessage(NXCP_ENCRYPTED_MESSAGE *msg, BYTE *decryptionBuffer);
 
+   bool encryptStreamBegin(size_t msgSize, UINT32 checksum, BYTE *out, size_t *outSize);
+   size_t encryptStreamUpdate(const BYTE *in, size_t inSize, BYTE *out);
+   size_t encryptStreamEnd(BYTE *out);
+
 	int getCipher() { return m_cipher; }
 	BYTE *getSessionKey() { return m_sessionKey; }
 	int getKeyLength() { return m_keyLength; }
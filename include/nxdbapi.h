@@ -257,6 +257,11 @@ bool LIBNXDB_EXPORTABLE DBDropColumn(DB_HANDLE hdb, const TCHAR *table, const TC
 bool LIBNXDB_EXPORTABLE DBRenameColumn(DB_HANDLE hdb, const TCHAR *tableName, const TCHAR *oldName, const TCHAR *newName);
 bool LIBNXDB_EXPORTABLE DBDropIndex(DB_HANDLE hdb, const TCHAR *table, const TCHAR *index);
 
+TCHAR LIBNXDB_EXPORTABLE *DBGetTimePartitionName(const TCHAR *table, INT64 start, TCHAR *buffer, size_t size);
+IntegerArray<INT64> LIBNXDB_EXPORTABLE *DBGetTimePartitions(DB_HANDLE hdb, const TCHAR *table);
+int LIBNXDB_EXPORTABLE DBFindTimePartition(const IntegerArray<INT64> *partitions, INT64 timestamp);
+bool LIBNXDB_EXPORTABLE DBRebuildTimePartitionView(DB_HANDLE hdb, const TCHAR *table, const IntegerArray<INT64> *partitions);
+
 DB_HANDLE LIBNXDB_EXPORTABLE DBOpenInMemoryDatabase();
 void LIBNXDB_EXPORTABLE DBCloseInMemoryDatabase(DB_HANDLE hdb);
 bool LIBNXDB_EXPORTABLE DBCacheTable(DB_HANDLE cacheDB, DB_HANDLE sourceDB, const TCHAR *table, const TCHAR *indexColumn, const TCHAR *columns, const TCHAR * const *intColumns = NULL);
@@ -89,6 +89,7 @@ typedef void (* LogParserCallback)(UINT32, const TCHAR *, const TCHAR *, const T
          int, time_t, const TCHAR *, const StringList *, void *);
 
 class LIBNXLP_EXPORTABLE LogParser;
+class LIBNXLP_EXPORTABLE LogParserPrefilter;
 
 #ifdef _WIN32
 
@@ -123,6 +124,7 @@ class LIBNXLP_EXPORTABLE LogParserRule
 	LogParser *m_parser;
 	TCHAR *m_name;
 	PCRE *m_preg;
+	PCRE_EXTRA_DATA *m_pextra;
 	UINT32 m_eventCode;
 	TCHAR *m_eventName;
 	TCHAR *m_eventTag;
@@ -151,8 +153,9 @@ class LIBNXLP_EXPORTABLE LogParserRule
 
 	bool matchInternal(bool extMode, const TCHAR *source, UINT32 eventId, UINT32 level, const TCHAR *line,
 	         StringList *variables, UINT64 recordId, UINT32 objectId, time_t timestamp,
-	         LogParserCallback cb, void *context);
+	         LogParserCallback cb, void *context, bool literalFound);
 	bool matchRepeatCount();
+   void compileRegexp();
    void expandMacros(const TCHAR *regexp, StringBuffer &out);
    void incCheckCount(UINT32 objectId);
    void incMatchCount(UINT32 objectId);
@@ -168,6 +171,7 @@ class LIBNXLP_EXPORTABLE LogParserRule
 
 	const TCHAR *getName() const { return m_name; }
 	bool isValid() const { return m_preg != NULL; }
+   bool isIgnoreCase() const { return m_ignoreCase; }
 
 	bool match(const TCHAR *line, UINT32 objectId, LogParserCallback cb, void *context);
 	bool matchEx(const TCHAR *source, UINT32 eventId, UINT32 level, const TCHAR *line, StringList *variables, 
@@ -226,6 +230,7 @@ class LIBNXLP_EXPORTABLE LogParser
 {
 private:
 	ObjectArray<LogParserRule> *m_rules;
+   LogParserPrefilter *m_prefilter;
 	StringMap m_contexts;
 	StringMap m_macros;
 	LogParserCallback m_cb;
@@ -238,6 +243,7 @@ class LIBNXLP_EXPORTABLE LogParser
 	bool (*m_eventResolver)(const TCHAR *, UINT32 *);
 	THREAD m_thread;	// Associated thread
    CONDITION m_stopCondition;
+   CONDITION m_fileChangeCondition;   // Set by file watcher on file change
    int m_recordsProcessed;
 	int m_recordsMatched;
 	bool m_preallocatedFile;
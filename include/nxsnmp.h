@@ -334,6 +334,7 @@ class LIBNXSNMP_EXPORTABLE SNMP_MIBObject
    UINT32 getObjectId() { return m_dwOID; }
    const TCHAR *getName() { return m_pszName; }
    const TCHAR *getDescription() { return m_pszDescription; }
+   const TCHAR *getTextualConvention() { return m_pszTextualConvention; }
    int getType() { return m_iType; }
    int getStatus() { return m_iStatus; }
    int getAccess() { return m_iAccess; }
@@ -586,6 +587,15 @@ class LIBNXSNMP_EXPORTABLE SNMP_PDU
    SNMP_Variable *getVariable(int index) { return m_variables->get(index); }
    UINT32 getVersion() { return m_version; }
    UINT32 getErrorCode() { return m_dwErrorCode; }
+   void setErrorCode(UINT32 code) { m_dwErrorCode = code; }
+   UINT32 getErrorIndex() { return m_dwErrorIndex; }
+   void setErrorIndex(UINT32 index) { m_dwErrorIndex = index; }
+
+   // GETBULK request parameters are encoded in place of error status and error index
+   UINT32 getNonRepeaters() { return m_dwErrorCode; }
+   void setNonRepeaters(UINT32 n) { m_dwErrorCode = n; }
+   UINT32 getMaxRepetitions() { return m_dwErrorIndex; }
+   void setMaxRepetitions(UINT32 n) { m_dwErrorIndex = n; }
 
 	void setMessageId(UINT32 msgId) { m_msgId = msgId; }
 	UINT32 getMessageId() { return m_msgId; }
@@ -618,6 +628,8 @@ class LIBNXSNMP_EXPORTABLE SNMP_PDU
  */
 class LIBNXSNMP_EXPORTABLE SNMP_Transport
 {
+   friend class SNMP_AsyncEngine;
+
 protected:
 	SNMP_SecurityContext *m_securityContext;
 	SNMP_Engine *m_authoritativeEngine;
@@ -627,6 +639,9 @@ class LIBNXSNMP_EXPORTABLE SNMP_Transport
 	bool m_reliable;
 	SNMP_Version m_snmpVersion;
 
+   void prepareRequest(SNMP_PDU *request);
+   UINT32 processResponse(SNMP_PDU *request, SNMP_PDU *response, int *timeSyncRetries, bool *resend);
+
 public:
    SNMP_Transport();
    virtual ~SNMP_Transport();
@@ -638,6 +653,7 @@ class LIBNXSNMP_EXPORTABLE SNMP_Transport
    virtual InetAddress getPeerIpAddress() = 0;
    virtual UINT16 getPort() = 0;
    virtual bool isProxyTransport() = 0;
+   virtual bool getPeerSocketAddress(SockAddrBuffer *addr) { return false; }
 
    UINT32 doRequest(SNMP_PDU *request, SNMP_PDU **response, UINT32 timeout = INFINITE, int numRetries = 1);
 
@@ -674,6 +690,7 @@ class LIBNXSNMP_EXPORTABLE SNMP_UDPTransport : public SNMP_Transport
    size_t preParsePDU();
    int recvData(UINT32 dwTimeout, struct sockaddr *pSender, socklen_t *piAddrSize);
    void clearBuffer();
+   bool createSocket();
 
 public:
    SNMP_UDPTransport();
@@ -687,12 +704,76 @@ class LIBNXSNMP_EXPORTABLE SNMP_UDPTransport : public SNMP_Transport
    virtual InetAddress getPeerIpAddress() override;
    virtual UINT16 getPort() override;
    virtual bool isProxyTransport() override;
+   virtual bool getPeerSocketAddress(SockAddrBuffer *addr) override;
 
    UINT32 createUDPTransport(const TCHAR *hostName, UINT16 port = SNMP_DEFAULT_PORT);
    UINT32 createUDPTransport(const InetAddress& hostAddr, UINT16 port = SNMP_DEFAULT_PORT);
 	bool isConnected() { return m_connected; }
 };
 
+/**
+ * Callback for asynchronous SNMP request. Called from engine's thread and
+ * should not block. Response PDU (NULL if request failed) should be
+ * destroyed by callee.
+ */
+typedef void (*SNMP_AsyncCallback)(UINT32 rcc, SNMP_PDU *response, void *context);
+
+struct SNMP_AsyncRequest;
+
+/**
+ * Number of slots in asynchronous engine's timer wheel
+ */
+#define SNMP_ASYNC_TIMER_SLOTS   512
+
+/**
+ * Asynchronous SNMP engine. Requests to multiple agents are multiplexed over small
+ * set of shared UDP sockets and matched to responses by request ID (SNMPv1/v2c)
+ * or message ID (SNMPv3). Retransmissions and timeouts are handled by single
+ * thread using timer wheel.
+ */
+class LIBNXSNMP_EXPORTABLE SNMP_AsyncEngine
+{
+private:
+   int m_numSockets;
+   SOCKET *m_sockets;
+   SOCKET *m_sockets6;
+   VolatileCounter m_nextSocket;
+   HashMap<UINT32, SNMP_AsyncRequest> *m_requests;
+   SNMP_AsyncRequest *m_timerWheel[SNMP_ASYNC_TIMER_SLOTS];
+   UINT32 m_timerPosition;
+   INT64 m_timerTime;
+   MUTEX m_mutex;
+   THREAD m_thread;
+   BYTE *m_buffer;
+   bool m_running;
+   bool m_shutdown;
+
+   bool submit(SNMP_Transport *transport, SNMP_PDU *request, bool ownsRequest, UINT32 timeout, int numRetries, SNMP_AsyncCallback callback, void *context);
+   bool send(SNMP_AsyncRequest *request);
+   void schedule(SNMP_AsyncRequest *request);
+   void unschedule(SNMP_AsyncRequest *request);
+   void complete(SNMP_AsyncRequest *request, UINT32 rcc, SNMP_PDU *response);
+   void receive(SOCKET s);
+   void processTimers();
+   void workerThread();
+
+   static THREAD_RESULT THREAD_CALL workerThreadStarter(void *arg);
+
+public:
+   SNMP_AsyncEngine(int numSockets = 1);
+   ~SNMP_AsyncEngine();
+
+   bool start();
+   void stop();
+   bool isRunning() const { return m_running; }
+
+   bool isTransportSupported(SNMP_Transport *transport);
+   bool request(SNMP_Transport *transport, SNMP_PDU *request, SNMP_AsyncCallback callback, void *context, UINT32 timeout = 0, int numRetries = 3);
+   UINT32 doRequest(SNMP_Transport *transport, SNMP_PDU *request, SNMP_PDU **response, UINT32 timeout = 0, int numRetries = 3);
+
+   int getPendingRequestCount();
+};
+
 struct SNMP_SnapshotIndexEntry;
 
 /**
@@ -717,6 +798,7 @@ class LIBNXSNMP_EXPORTABLE SNMP_Snapshot
 
    static SNMP_Snapshot *create(SNMP_Transport *transport, const TCHAR *baseOid);
    static SNMP_Snapshot *create(SNMP_Transport *transport, const UINT32 *baseOid, size_t oidLen);
+   static SNMP_Snapshot *create(SNMP_Transport *transport, const ObjectArray<SNMP_ObjectId> *columns);
 
    Iterator<SNMP_Variable> *iterator() { return m_values->iterator(); }
    EnumerationCallbackResult walk(const TCHAR *baseOid, EnumerationCallbackResult (*handler)(const SNMP_Variable *, const SNMP_Snapshot *, void *), void *userArg) const;
@@ -745,6 +827,70 @@ class LIBNXSNMP_EXPORTABLE SNMP_Snapshot
    bool isEmpty() const { return m_values->size() == 0; }
 };
 
+/**
+ * Invalid node index in compiled MIB index
+ */
+#define SNMP_MIB_INVALID_NODE    0xFFFFFFFF
+
+struct SNMP_MIB_INDEX_HEADER;
+struct SNMP_MIB_INDEX_NODE;
+
+/**
+ * Read-only MIB tree loaded from indexed compiled MIB file. File is mapped into memory
+ * as is - nodes are stored in breadth-first order with children of each node sorted by
+ * sub-identifier, so child lookup is a binary search and no parsing is needed on load.
+ * Nodes are referenced by index, root node always has index 0. All strings are UTF-8.
+ */
+class LIBNXSNMP_EXPORTABLE SNMP_MIBIndex
+{
+private:
+   const BYTE *m_data;
+   size_t m_size;
+   bool m_mapped;
+#ifdef _WIN32
+   HANDLE m_mapping;
+#endif
+   const SNMP_MIB_INDEX_HEADER *m_header;
+   const SNMP_MIB_INDEX_NODE *m_nodes;
+   const UINT32 *m_hash;
+   const char *m_strings;
+   UINT32 m_nodeCount;
+   UINT32 m_hashSize;
+   UINT32 m_stringsSize;
+
+   SNMP_MIBIndex();
+
+   const char *string(UINT32 offset) const { return (offset < m_stringsSize) ? &m_strings[offset] : ""; }
+
+public:
+   ~SNMP_MIBIndex();
+
+   static SNMP_MIBIndex *load(const TCHAR *fileName, UINT32 *rcc = NULL);
+
+   UINT32 getNodeCount() const { return m_nodeCount; }
+   UINT32 getTimestamp() const;
+
+   UINT32 getParent(UINT32 node) const;
+   UINT32 getChildCount(UINT32 node) const;
+   UINT32 getChild(UINT32 node, UINT32 index) const;
+   UINT32 findChild(UINT32 node, UINT32 subId) const;
+   UINT32 findNode(const UINT32 *oid, size_t length, size_t *matchedLength = NULL) const;
+   UINT32 findNode(const SNMP_ObjectId& oid, size_t *matchedLength = NULL) const;
+   UINT32 findNodeByName(const char *name) const;
+
+   UINT32 getSubId(UINT32 node) const;
+   const char *getName(UINT32 node) const;
+   const char *getDescription(UINT32 node) const;
+   const char *getTextualConvention(UINT32 node) const;
+   int getType(UINT32 node) const;
+   int getStatus(UINT32 node) const;
+   int getAccess(UINT32 node) const;
+
+   size_t getObjectId(UINT32 node, UINT32 *buffer, size_t size) const;
+   TCHAR *getSymbolicName(const UINT32 *oid, size_t length, TCHAR *buffer, size_t size) const;
+   TCHAR *getSymbolicName(const SNMP_ObjectId& oid, TCHAR *buffer, size_t size) const;
+};
+
 /**
  * Functions
  */
@@ -756,12 +902,17 @@ const TCHAR LIBNXSNMP_EXPORTABLE *SNMPGetErrorText(UINT32 dwError);
 UINT32 LIBNXSNMP_EXPORTABLE SNMPSaveMIBTree(const TCHAR *fileName, SNMP_MIBObject *pRoot, UINT32 dwFlags);
 UINT32 LIBNXSNMP_EXPORTABLE SNMPLoadMIBTree(const TCHAR *fileName, SNMP_MIBObject **ppRoot);
 UINT32 LIBNXSNMP_EXPORTABLE SNMPGetMIBTreeTimestamp(const TCHAR *fileName, UINT32 *pdwTimestamp);
+UINT32 LIBNXSNMP_EXPORTABLE SNMPSaveIndexedMIBTree(const TCHAR *fileName, SNMP_MIBObject *root, UINT32 flags);
 UINT32 LIBNXSNMP_EXPORTABLE SNMPResolveDataType(const TCHAR *pszType);
 TCHAR LIBNXSNMP_EXPORTABLE *SNMPDataTypeName(UINT32 type, TCHAR *buffer, size_t bufferSize);
 
 UINT32 LIBNXSNMP_EXPORTABLE SnmpNewRequestId();
 void LIBNXSNMP_EXPORTABLE SnmpSetDefaultTimeout(UINT32 timeout);
 UINT32 LIBNXSNMP_EXPORTABLE SnmpGetDefaultTimeout();
+void LIBNXSNMP_EXPORTABLE SnmpSetBulkWalkOptions(bool enabled, UINT32 maxRepetitions);
+void LIBNXSNMP_EXPORTABLE SnmpResetBulkWalkCapabilities();
+void LIBNXSNMP_EXPORTABLE SnmpSetDefaultAsyncEngine(SNMP_AsyncEngine *engine);
+SNMP_AsyncEngine LIBNXSNMP_EXPORTABLE *SnmpGetDefaultAsyncEngine();
 UINT32 LIBNXSNMP_EXPORTABLE SnmpGet(SNMP_Version version, SNMP_Transport *transport,
                                     const TCHAR *szOidStr, const UINT32 *oidBinary, size_t oidLen, void *pValue,
                                     size_t bufferSize, UINT32 dwFlags);
@@ -774,6 +925,11 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const TCHAR *roo
 UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const UINT32 *rootOid, size_t rootOidLen,
                                      UINT32 (* handler)(SNMP_Variable *, SNMP_Transport *, void *),
                                      void *userArg, bool logErrors = false, bool failOnShutdown = false);
+UINT32 LIBNXSNMP_EXPORTABLE SnmpWalkColumns(SNMP_Transport *transport, const ObjectArray<SNMP_ObjectId> *columns,
+                                            ObjectArray<SNMP_Variable> **results, bool failOnShutdown = false);
+UINT32 LIBNXSNMP_EXPORTABLE SnmpWalkTable(SNMP_Transport *transport, const ObjectArray<SNMP_ObjectId> *columns,
+                                          UINT32 (*handler)(SNMP_Variable **, const UINT32 *, size_t, SNMP_Transport *, void *),
+                                          void *userArg, bool failOnShutdown = false);
 int LIBNXSNMP_EXPORTABLE SnmpWalkCount(SNMP_Transport *transport, const UINT32 *rootOid, size_t rootOidLen);
 int LIBNXSNMP_EXPORTABLE SnmpWalkCount(SNMP_Transport *transport, const TCHAR *rootOid);
 
@@ -0,0 +1,89 @@
+/*
+** NetXMS - Network Management System
+** Copyright (C) 2003-2020 Victor Kirhenshtein
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published
+** by the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: timer_wheel.h
+**
+**/
+
+#ifndef _timer_wheel_h_
+#define _timer_wheel_h_
+
+#include <nms_util.h>
+
+/**
+ * Timer wheel geometry: 4 levels of 256 slots with 1 millisecond resolution
+ * on lowest level cover 2^32 milliseconds (more than 49 days). Timers with
+ * longer delay are placed into last slot of highest level and re-inserted
+ * when it is cascaded.
+ */
+#define TIMER_WHEEL_LEVELS    4
+#define TIMER_WHEEL_BITS      8
+#define TIMER_WHEEL_SLOTS     (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK      (TIMER_WHEEL_SLOTS - 1)
+
+/**
+ * Timer wheel entry (internal)
+ */
+struct TimerWheelEntry;
+
+/**
+ * Timer expiration callback
+ */
+typedef void (*TimerWheelCallback)(void *data, void *context);
+
+/**
+ * Hierarchical timing wheel with millisecond resolution. Timer insertion and
+ * cancellation are O(1) operations. Timer identifiers are never reused within
+ * wheel's lifetime in practice (slot index combined with 32 bit generation
+ * counter), so cancellation of already expired timer is safe.
+ * This class is not thread safe - caller should provide appropriate locking.
+ */
+class LIBNETXMS_EXPORTABLE TimerWheel
+{
+   DISABLE_COPY_CTOR(TimerWheel)
+
+private:
+   TimerWheelEntry *m_slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+   UINT64 m_bitmap[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS / 64];
+   TimerWheelEntry **m_chunks;
+   int m_chunkCount;
+   TimerWheelEntry *m_freeList;
+   INT64 m_currentTick;
+   int m_size;
+
+   TimerWheelEntry *allocateEntry();
+   void releaseEntry(TimerWheelEntry *e);
+   void link(TimerWheelEntry *e);
+   void unlink(TimerWheelEntry *e);
+   TimerWheelEntry *detachSlot(int level, int slot);
+   int findNextSlot(int level, int from) const;
+
+public:
+   TimerWheel(INT64 now);
+   ~TimerWheel();
+
+   UINT64 add(INT64 expirationTime, void *data);
+   bool cancel(UINT64 id, void **data = NULL);
+   int advance(INT64 now, TimerWheelCallback callback, void *context);
+   void clear(TimerWheelCallback callback, void *context);
+
+   INT64 getNextExpirationTime() const;
+   int size() const { return m_size; }
+};
+
+#endif
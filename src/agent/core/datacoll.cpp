@@ -40,6 +40,13 @@ void UpdateProxyConfiguration(UINT64 serverId, HashMap<ServerObjectKey, DataColl
 void ProxyConnectionChecker(void *arg);
 THREAD_RESULT THREAD_CALL ProxyListenerThread(void *arg);
 
+OfflineDataQueue *GetOfflineDataQueue(UINT64 serverId, bool create);
+IntegerArray<UINT64> *LoadOfflineDataQueues();
+void DeleteOfflineDataQueue(UINT64 serverId);
+void DeleteAllOfflineDataQueues();
+void CloseOfflineDataQueues();
+int MigrateOfflineData(DB_HANDLE hdb, void (*handler)(DB_RESULT, int, OfflineDataQueue*));
+
 extern HashMap<ServerObjectKey, DataCollectionProxy> g_proxyList;
 extern Mutex g_proxyListMutex;
 
@@ -402,6 +409,60 @@ class DataElement
       }
    }
 
+   /**
+    * Create data element from offline data queue record
+    */
+   DataElement(UINT64 serverId, ByteStream *record)
+   {
+      m_serverId = serverId;
+      record->readByte();  // record format version
+      m_dciId = record->readUInt32();
+      m_timestamp = static_cast<time_t>(record->readInt64());
+      m_origin = record->readInt16();
+      m_type = record->readInt16();
+      m_statusCode = record->readUInt32();
+      uuid_t guid;
+      if (record->read(guid, UUID_LENGTH) == UUID_LENGTH)
+         m_snmpNode = uuid(guid);
+      switch(m_type)
+      {
+         case DCO_TYPE_ITEM:
+            m_value.item = record->readString();
+            if (m_value.item == NULL)
+               m_value.item = _tcsdup(_T(""));
+            break;
+         case DCO_TYPE_LIST:
+            {
+               m_value.list = new StringList();
+               TCHAR *text = record->readString();
+               if (text != NULL)
+               {
+                  m_value.list->splitAndAdd(text, _T("\n"));
+                  free(text);
+               }
+            }
+            break;
+         case DCO_TYPE_TABLE:
+            {
+               char *xml = record->readStringUtf8();
+               if (xml != NULL)
+               {
+                  m_value.table = Table::createFromXML(xml);
+                  free(xml);
+               }
+               else
+               {
+                  m_value.table = NULL;
+               }
+            }
+            break;
+         default:
+            m_type = DCO_TYPE_ITEM;
+            m_value.item = _tcsdup(_T(""));
+            break;
+      }
+   }
+
    ~DataElement()
    {
       switch(m_type)
@@ -424,36 +485,50 @@ class DataElement
    int getType() { return m_type; }
    UINT32 getStatusCode() { return m_statusCode; }
 
-   void saveToDatabase(DB_STATEMENT hStmt);
+   void saveToQueue(OfflineDataQueue *queue);
    bool sendToServer(bool reconcillation);
    void fillReconciliationMessage(NXCPMessage *msg, UINT32 baseId);
 };
 
 /**
- * Save data element to database
+ * Offline data queue record format version
+ */
+#define QUEUE_RECORD_VERSION  1
+
+/**
+ * Save data element to offline data queue
  */
-void DataElement::saveToDatabase(DB_STATEMENT hStmt)
+void DataElement::saveToQueue(OfflineDataQueue *queue)
 {
-   DBBind(hStmt, 1, DB_SQLTYPE_BIGINT, m_serverId);
-   DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, (LONG)m_dciId);
-   DBBind(hStmt, 3, DB_SQLTYPE_INTEGER, (LONG)m_type);
-   DBBind(hStmt, 4, DB_SQLTYPE_INTEGER, (LONG)m_origin);
-   DBBind(hStmt, 5, DB_SQLTYPE_INTEGER, (LONG)m_statusCode);
-   DBBind(hStmt, 6, DB_SQLTYPE_VARCHAR, m_snmpNode);
-   DBBind(hStmt, 7, DB_SQLTYPE_INTEGER, (LONG)m_timestamp);
+   ByteStream record(256);
+   record.write(static_cast<BYTE>(QUEUE_RECORD_VERSION));
+   record.write(m_dciId);
+   record.write(static_cast<INT64>(m_timestamp));
+   record.write(static_cast<INT16>(m_origin));
+   record.write(static_cast<INT16>(m_type));
+   record.write(m_statusCode);
+   record.write(m_snmpNode.getValue(), UUID_LENGTH);
    switch(m_type)
    {
       case DCO_TYPE_ITEM:
-         DBBind(hStmt, 8, DB_SQLTYPE_TEXT, m_value.item, DB_BIND_STATIC);
+         record.writeString(m_value.item);
          break;
       case DCO_TYPE_LIST:
-         DBBind(hStmt, 8, DB_SQLTYPE_TEXT, m_value.list->join(_T("\n")), DB_BIND_DYNAMIC);
+         {
+            TCHAR *text = m_value.list->join(_T("\n"));
+            record.writeString(text);
+            MemFree(text);
+         }
          break;
       case DCO_TYPE_TABLE:
-         DBBind(hStmt, 8, DB_SQLTYPE_TEXT, m_value.table->createXML(), DB_BIND_DYNAMIC);
+         {
+            TCHAR *xml = (m_value.table != NULL) ? m_value.table->createXML() : NULL;
+            record.writeString(CHECK_NULL_EX(xml));
+            MemFree(xml);
+         }
          break;
    }
-   DBExecute(hStmt);
+   queue->append(record.buffer(), record.size());
 }
 
 /**
@@ -545,47 +620,59 @@ static HashMap<UINT64, ServerSyncStatus> s_serverSyncStatus(Ownership::True);
 static Mutex s_serverSyncStatusLock;
 
 /**
- * Database writer queue
+ * Offline data writer queue
  */
-static ObjectQueue<DataElement> s_databaseWriterQueue;
+static ObjectQueue<DataElement> s_offlineDataWriterQueue;
 
 /**
- * Database writer
+ * Offline data writer
  */
-static THREAD_RESULT THREAD_CALL DatabaseWriter(void *arg)
+static THREAD_RESULT THREAD_CALL OfflineDataWriter(void *arg)
 {
-   DB_HANDLE hdb = GetLocalDatabaseHandle();
-   DebugPrintf(1, _T("Database writer thread started"));
+   nxlog_debug_tag(DEBUG_TAG, 1, _T("Offline data writer thread started"));
 
+   ObjectRefArray<OfflineDataQueue> queues(4, 4);
    while(true)
    {
-      DataElement *e = s_databaseWriterQueue.getOrBlock();
+      DataElement *e = s_offlineDataWriterQueue.getOrBlock();
       if (e == INVALID_POINTER_VALUE)
          break;
 
-      DB_STATEMENT hStmt = DBPrepare(hdb, _T("INSERT INTO dc_queue (server_id,dci_id,dci_type,dci_origin,status_code,snmp_target_guid,timestamp,value) VALUES (?,?,?,?,?,?,?,?)"));
-      if (hStmt == NULL)
-      {
-         delete e;
-         continue;
-      }
-
       UINT32 count = 0;
-      DBBegin(hdb);
       while((e != NULL) && (e != INVALID_POINTER_VALUE))
       {
-         e->saveToDatabase(hStmt);
+         OfflineDataQueue *queue = NULL;
+         for(int i = 0; i < queues.size(); i++)
+         {
+            if (queues.get(i)->getServerId() == e->getServerId())
+            {
+               queue = queues.get(i);
+               break;
+            }
+         }
+         if (queue == NULL)
+         {
+            queue = GetOfflineDataQueue(e->getServerId(), true);
+            queues.add(queue);
+         }
+         e->saveToQueue(queue);
          delete e;
 
          count++;
          if (count == g_dcWriterMaxTransactionSize)
             break;
 
-         e = s_databaseWriterQueue.get();
+         e = s_offlineDataWriterQueue.get();
       }
-      DBCommit(hdb);
-      DBFreeStatement(hStmt);
-      DebugPrintf(7, _T("Database writer: %u records inserted"), count);
+
+      for(int i = 0; i < queues.size(); i++)
+      {
+         OfflineDataQueue *queue = queues.get(i);
+         queue->flush();
+         queue->decRefCount();
+      }
+      queues.clear();
+      nxlog_debug_tag(DEBUG_TAG, 7, _T("Offline data writer: %u records written"), count);
       if (e == INVALID_POINTER_VALUE)
          break;
 
@@ -594,7 +681,7 @@ static THREAD_RESULT THREAD_CALL DatabaseWriter(void *arg)
          ThreadSleepMs(g_dcWriterFlushInterval);
    }
 
-   DebugPrintf(1, _T("Database writer thread stopped"));
+   nxlog_debug_tag(DEBUG_TAG, 1, _T("Offline data writer thread stopped"));
    return THREAD_OK;
 }
 
@@ -619,6 +706,71 @@ static bool SessionComparator_Reconciliation(AbstractCommSession *session, void
    return false;
 }
 
+/**
+ * Send block of DCI values to server in bulk reconciliation mode. Values rejected by server
+ * with retry status are added to retry list. Returns false on communication failure.
+ */
+static bool SendBulkReconciliationData(CommSession *session, ObjectArray<DataElement> *bulkSendList, ObjectArray<DataElement> *retryList)
+{
+   nxlog_debug_tag(DEBUG_TAG, 6, _T("ReconciliationThread: %d records to be sent in bulk mode"), bulkSendList->size());
+
+   NXCPMessage msg(CMD_DCI_DATA, session->generateRequestId(), session->getProtocolVersion());
+   msg.setField(VID_BULK_RECONCILIATION, (INT16)1);
+   msg.setField(VID_NUM_ELEMENTS, (INT16)bulkSendList->size());
+   msg.setField(VID_TIMEOUT, g_dcReconciliationTimeout);
+
+   UINT32 fieldId = VID_ELEMENT_LIST_BASE;
+   for(int i = 0; i < bulkSendList->size(); i++)
+   {
+      bulkSendList->get(i)->fillReconciliationMessage(&msg, fieldId);
+      fieldId += 10;
+   }
+
+   if (!session->sendMessage(&msg))
+   {
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("ReconciliationThread: communication error"));
+      return false;
+   }
+
+   UINT32 rcc;
+   do
+   {
+      NXCPMessage *response = session->waitForMessage(CMD_REQUEST_COMPLETED, msg.getId(), g_dcReconciliationTimeout);
+      if (response != NULL)
+      {
+         rcc = response->getFieldAsUInt32(VID_RCC);
+         if (rcc == ERR_SUCCESS)
+         {
+            // Check status for each data element
+            BYTE status[MAX_BULK_DATA_BLOCK_SIZE];
+            memset(status, 0, MAX_BULK_DATA_BLOCK_SIZE);
+            response->getFieldAsBinary(VID_STATUS, status, MAX_BULK_DATA_BLOCK_SIZE);
+            for(int i = 0; i < bulkSendList->size(); i++)
+            {
+               if (status[i] == BULK_DATA_REC_RETRY)
+                  retryList->add(bulkSendList->get(i));
+            }
+         }
+         else if (rcc == ERR_PROCESSING)
+         {
+            nxlog_debug_tag(DEBUG_TAG, 4, _T("ReconciliationThread: server is processing data (%d%% completed)"), response->getFieldAsInt32(VID_PROGRESS));
+         }
+         else
+         {
+            nxlog_debug_tag(DEBUG_TAG, 4, _T("ReconciliationThread: bulk send failed (%d)"), rcc);
+         }
+         delete response;
+      }
+      else
+      {
+         nxlog_debug_tag(DEBUG_TAG, 4, _T("ReconciliationThread: timeout on bulk send"));
+         rcc = ERR_REQUEST_TIMEOUT;
+      }
+   } while(rcc == ERR_PROCESSING);
+
+   return rcc == ERR_SUCCESS;
+}
+
 /**
  * Data reconciliation thread
  */
@@ -628,7 +780,6 @@ static THREAD_RESULT THREAD_CALL ReconciliationThread(void *arg)
    UINT32 sleepTime = 30000;
    nxlog_debug(1, _T("Data reconciliation thread started (block size %d, timeout %d ms)"), g_dcReconciliationBlockSize, g_dcReconciliationTimeout);
 
-   bool vacuumNeeded = false;
    while(!AgentSleepAndCheckForShutdown(sleepTime))
    {
       // Check if there is something to sync
@@ -656,168 +807,90 @@ static THREAD_RESULT THREAD_CALL ReconciliationThread(void *arg)
             s_pollTimeChanged = false;
          }
          s_itemLock.unlock();
-
-         if (vacuumNeeded)
-         {
-            DebugPrintf(4, _T("ReconciliationThread: vacuum local database"));
-            DBQuery(hdb, _T("VACUUM"));
-            vacuumNeeded = false;
-         }
          sleepTime = 30000;
          continue;
       }
 
-      TCHAR query[1024];
-      _sntprintf(query, 1024, _T("SELECT server_id,dci_id,dci_type,dci_origin,status_code,snmp_target_guid,timestamp,value FROM dc_queue INDEXED BY idx_dc_queue_timestamp WHERE server_id=") UINT64_FMT _T(" ORDER BY timestamp LIMIT %d"), session->getServerId(), g_dcReconciliationBlockSize);
-
-      TCHAR sqlError[DBDRV_MAX_ERROR_TEXT];
-      DB_RESULT hResult = DBSelectEx(hdb, query, sqlError);
-      if (hResult == NULL)
+      OfflineDataQueue *queue = GetOfflineDataQueue(session->getServerId(), false);
+      if (queue == NULL)
       {
-         DebugPrintf(4, _T("ReconciliationThread: database query failed: %s"), sqlError);
-         sleepTime = 30000;
+         // Nothing written to disk yet
          session->decRefCount();
+         sleepTime = 30000;
          continue;
       }
 
-      int count = DBGetNumRows(hResult);
-      if (count > 0)
+      // Read block of records and remember position after each of them
+      OfflineDataQueuePosition position = queue->getReadPosition();
+      ObjectArray<DataElement> elements(g_dcReconciliationBlockSize, 64, Ownership::True);
+      StructArray<OfflineDataQueuePosition> positions(g_dcReconciliationBlockSize, 64);
+      while(elements.size() < static_cast<int>(g_dcReconciliationBlockSize))
+      {
+         ByteStream *record = queue->read(&position);
+         if (record == NULL)
+            break;
+         elements.add(new DataElement(session->getServerId(), record));
+         positions.add(&position);
+         delete record;
+      }
+
+      // Send records in original order. Processing stops on first communication failure, so
+      // records delivered to server always form continuous block at the beginning of the list.
+      int count = elements.size();
+      int processed = 0;
+      ObjectArray<DataElement> bulkSendList(count, 16, Ownership::False);
+      ObjectArray<DataElement> retryList(16, 16, Ownership::False);
+      for(int i = 0; i < count; i++)
       {
-         ObjectArray<DataElement> bulkSendList(count, 10, Ownership::True);
-         ObjectArray<DataElement> deleteList(count, 10, Ownership::True);
-         for(int i = 0; i < count; i++)
+         DataElement *e = elements.get(i);
+         if ((e->getType() == DCO_TYPE_ITEM) && session->isBulkReconciliationSupported())
          {
-            DataElement *e = new DataElement(hResult, i);
-            if ((e->getType() == DCO_TYPE_ITEM) && session->isBulkReconciliationSupported())
-            {
-               bulkSendList.add(e);
-            }
-            else
-            {
-               s_serverSyncStatusLock.lock();
-               ServerSyncStatus *status = s_serverSyncStatus.get(e->getServerId());
-               if (status != NULL)
-               {
-                  if (e->sendToServer(true))
-                  {
-                     status->queueSize--;
-                     status->lastSync = time(NULL);
-                     deleteList.add(e);
-                  }
-                  else
-                  {
-                     delete e;
-                  }
-               }
-               else
-               {
-                  DebugPrintf(5, _T("INTERNAL ERROR: cached DCI value without server sync status object"));
-                  deleteList.add(e);  // record should be deleted
-               }
-               s_serverSyncStatusLock.unlock();
-            }
+            bulkSendList.add(e);
+            continue;
          }
 
-         if (bulkSendList.size() > 0)
+         if (!bulkSendList.isEmpty())
          {
-            DebugPrintf(6, _T("ReconciliationThread: %d records to be sent in bulk mode"), bulkSendList.size());
-
-            NXCPMessage msg(CMD_DCI_DATA, session->generateRequestId(), session->getProtocolVersion());
-            msg.setField(VID_BULK_RECONCILIATION, (INT16)1);
-            msg.setField(VID_NUM_ELEMENTS, (INT16)bulkSendList.size());
-            msg.setField(VID_TIMEOUT, g_dcReconciliationTimeout);
-
-            UINT32 fieldId = VID_ELEMENT_LIST_BASE;
-            for(int i = 0; i < bulkSendList.size(); i++)
-            {
-               bulkSendList.get(i)->fillReconciliationMessage(&msg, fieldId);
-               fieldId += 10;
-            }
-
-            if (session->sendMessage(&msg))
-            {
-               UINT32 rcc;
-               do
-               {
-                  NXCPMessage *response = session->waitForMessage(CMD_REQUEST_COMPLETED, msg.getId(), g_dcReconciliationTimeout);
-                  if (response != NULL)
-                  {
-                     rcc = response->getFieldAsUInt32(VID_RCC);
-                     if (rcc == ERR_SUCCESS)
-                     {
-                        s_serverSyncStatusLock.lock();
-                        ServerSyncStatus *serverSyncStatus = s_serverSyncStatus.get(session->getServerId());
-
-                        // Check status for each data element
-                        BYTE status[MAX_BULK_DATA_BLOCK_SIZE];
-                        memset(status, 0, MAX_BULK_DATA_BLOCK_SIZE);
-                        response->getFieldAsBinary(VID_STATUS, status, MAX_BULK_DATA_BLOCK_SIZE);
-                        bulkSendList.setOwner(Ownership::False);
-                        for(int i = 0; i < bulkSendList.size(); i++)
-                        {
-                           DataElement *e = bulkSendList.get(i);
-                           if (status[i] != BULK_DATA_REC_RETRY)
-                           {
-                              deleteList.add(e);
-                              serverSyncStatus->queueSize--;
-                           }
-                           else
-                           {
-                              delete e;
-                           }
-                        }
-                        serverSyncStatus->lastSync = time(NULL);
-
-                        s_serverSyncStatusLock.unlock();
-                     }
-                     else if (rcc == ERR_PROCESSING)
-                     {
-                        DebugPrintf(4, _T("ReconciliationThread: server is processing data (%d%% completed)"), response->getFieldAsInt32(VID_PROGRESS));
-                     }
-                     else
-                     {
-                        DebugPrintf(4, _T("ReconciliationThread: bulk send failed (%d)"), rcc);
-                     }
-                     delete response;
-                  }
-                  else
-                  {
-                     DebugPrintf(4, _T("ReconciliationThread: timeout on bulk send"));
-                     rcc = ERR_REQUEST_TIMEOUT;
-                  }
-               } while(rcc == ERR_PROCESSING);
-            }
-            else
-            {
-               DebugPrintf(4, _T("ReconciliationThread: communication error"));
-            }
+            if (!SendBulkReconciliationData(session, &bulkSendList, &retryList))
+               break;
+            bulkSendList.clear();
+            processed = i;
          }
 
-         if (deleteList.size() > 0)
+         if (!e->sendToServer(true))
+            break;
+         processed = i + 1;
+      }
+      if ((processed + bulkSendList.size() == count) && !bulkSendList.isEmpty())
+      {
+         if (SendBulkReconciliationData(session, &bulkSendList, &retryList))
+            processed = count;
+      }
+
+      if (processed > 0)
+      {
+         // Records server asked to retry are moved to the end of the queue
+         for(int i = 0; i < retryList.size(); i++)
+            retryList.get(i)->saveToQueue(queue);
+         if (!retryList.isEmpty())
+            queue->flush();
+         queue->acknowledge(*positions.get(processed - 1), processed);
+
+         s_serverSyncStatusLock.lock();
+         ServerSyncStatus *status = s_serverSyncStatus.get(session->getServerId());
+         if (status != NULL)
          {
-            DB_STATEMENT hStmt = DBPrepare(hdb, _T("DELETE FROM dc_queue WHERE server_id=? AND dci_id=? AND timestamp=?"), true);
-            if (hStmt != NULL)
-            {
-               DBBegin(hdb);
-               for(int i = 0; i < deleteList.size(); i++)
-               {
-                  DataElement *e = deleteList.get(i);
-                  DBBind(hStmt, 1, DB_SQLTYPE_BIGINT, e->getServerId());
-                  DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, e->getDciId());
-                  DBBind(hStmt, 3, DB_SQLTYPE_BIGINT, static_cast<INT64>(e->getTimestamp()));
-                  DBExecute(hStmt);
-               }
-               DBCommit(hdb);
-               DBFreeStatement(hStmt);
-               vacuumNeeded = true;
-            }
-            nxlog_debug(4, _T("ReconciliationThread: %d records sent"), deleteList.size());
+            status->queueSize -= processed - retryList.size();
+            status->lastSync = time(NULL);
          }
+         s_serverSyncStatusLock.unlock();
+
+         nxlog_debug_tag(DEBUG_TAG, 4, _T("ReconciliationThread: %d records sent"), processed - retryList.size());
       }
-      DBFreeResult(hResult);
+      queue->decRefCount();
 
       session->decRefCount();
-      sleepTime = (count > 0) ? 50 : 30000;
+      sleepTime = (processed > retryList.size()) ? 50 : 30000;
    }
 
    nxlog_debug(1, _T("Data reconciliation thread stopped"));
@@ -854,14 +927,14 @@ static THREAD_RESULT THREAD_CALL DataSender(void *arg)
          if (!e->sendToServer(false))
          {
             status->queueSize++;
-            s_databaseWriterQueue.put(e);
+            s_offlineDataWriterQueue.put(e);
             e = NULL;
          }
       }
       else
       {
          status->queueSize++;
-         s_databaseWriterQueue.put(e);
+         s_offlineDataWriterQueue.put(e);
          e = NULL;
       }
       s_serverSyncStatusLock.unlock();
@@ -1195,6 +1268,15 @@ void ConfigureDataCollection(UINT64 serverId, NXCPMessage *msg)
    DebugPrintf(4, _T("Data collection for server ") UINT64X_FMT(_T("016")) _T(" reconfigured"), serverId);
 }
 
+/**
+ * Convert dc_queue table row into offline data queue record
+ */
+static void SaveDatabaseRecordToQueue(DB_RESULT hResult, int row, OfflineDataQueue *queue)
+{
+   DataElement e(hResult, row);
+   e.saveToQueue(queue);
+}
+
 /**
  * Load saved state of local data collection
  */
@@ -1224,31 +1306,44 @@ static void LoadState()
       DBFreeResult(hResult);
    }
 
-   hResult = DBSelect(hdb, _T("SELECT server_id,count(*),coalesce(min(timestamp),0) FROM dc_queue GROUP BY server_id"));
-   if (hResult != NULL)
+   MigrateOfflineData(hdb, SaveDatabaseRecordToQueue);
+
+   IntegerArray<UINT64> *servers = LoadOfflineDataQueues();
+   for(int i = 0; i < servers->size(); i++)
    {
-      int count = DBGetNumRows(hResult);
-      for(int i = 0; i < count; i++)
+      UINT64 serverId = servers->get(i);
+      OfflineDataQueue *queue = GetOfflineDataQueue(serverId, false);
+      if (queue == NULL)
+         continue;
+
+      ServerSyncStatus *s = new ServerSyncStatus(serverId);
+      s->queueSize = queue->getSize();
+
+      // Use timestamp of oldest queued element as last sync time
+      OfflineDataQueuePosition position = queue->getReadPosition();
+      ByteStream *record = queue->read(&position);
+      if (record != NULL)
       {
-         UINT64 serverId = DBGetFieldUInt64(hResult, i, 0);
-         ServerSyncStatus *s = new ServerSyncStatus(serverId);
-         s->queueSize = DBGetFieldLong(hResult, i, 1);
-         s->lastSync = static_cast<time_t>(DBGetFieldInt64(hResult, i, 2));
-         s_serverSyncStatus.set(serverId, s);
-         nxlog_debug_tag(DEBUG_TAG, 2, _T("%d elements in queue for server ID ") UINT64X_FMT(_T("016")), s->queueSize, serverId);
+         DataElement e(serverId, record);
+         s->lastSync = e.getTimestamp();
+         delete record;
+      }
+      queue->decRefCount();
+
+      s_serverSyncStatus.set(serverId, s);
+      nxlog_debug_tag(DEBUG_TAG, 2, _T("%d elements in queue for server ID ") UINT64X_FMT(_T("016")), s->queueSize, serverId);
 
 #if HAVE_LOCALTIME_R
-         struct tm tbuffer;
-         struct tm *ltm = localtime_r(&s->lastSync, &tbuffer);
+      struct tm tbuffer;
+      struct tm *ltm = localtime_r(&s->lastSync, &tbuffer);
 #else
-         struct tm *ltm = localtime(&s->lastSync);
+      struct tm *ltm = localtime(&s->lastSync);
 #endif
-         TCHAR ts[64];
-         _tcsftime(ts, 64, _T("%Y.%m.%d %H:%M:%S"), ltm);
-         nxlog_debug_tag(DEBUG_TAG, 2, _T("Oldest timestamp is %s for server ID ") UINT64X_FMT(_T("016")), ts, serverId);
-      }
-      DBFreeResult(hResult);
+      TCHAR ts[64];
+      _tcsftime(ts, 64, _T("%Y.%m.%d %H:%M:%S"), ltm);
+      nxlog_debug_tag(DEBUG_TAG, 2, _T("Oldest timestamp is %s for server ID ") UINT64X_FMT(_T("016")), ts, serverId);
    }
+   delete servers;
 
    LoadProxyConfiguration();
 }
@@ -1288,10 +1383,9 @@ static void ClearStalledOfflineData(void *arg)
       {
          UINT64 serverId = deleteList.get(i);
 
-         DBBegin(hdb);
+         DeleteOfflineDataQueue(serverId);
 
-         _sntprintf(query, 256, _T("DELETE FROM dc_queue WHERE server_id=") UINT64_FMT, serverId);
-         DBQuery(hdb, query);
+         DBBegin(hdb);
 
          _sntprintf(query, 256, _T("DELETE FROM dc_snmp_targets WHERE server_id=") UINT64_FMT, serverId);
          DBQuery(hdb, query);
@@ -1327,7 +1421,7 @@ static void ClearStalledOfflineData(void *arg)
  */
 static THREAD s_dataCollectionSchedulerThread = INVALID_THREAD_HANDLE;
 static THREAD s_dataSenderThread = INVALID_THREAD_HANDLE;
-static THREAD s_databaseWriterThread = INVALID_THREAD_HANDLE;
+static THREAD s_offlineDataWriterThread = INVALID_THREAD_HANDLE;
 static THREAD s_reconciliationThread = INVALID_THREAD_HANDLE;
 static THREAD s_proxyListennerThread = INVALID_THREAD_HANDLE;
 
@@ -1370,7 +1464,7 @@ void StartLocalDataCollector()
    g_dataCollectorPool = ThreadPoolCreate(_T("DATACOLL"), 1, g_dcMaxCollectorPoolSize);
    s_dataCollectionSchedulerThread = ThreadCreateEx(DataCollectionScheduler, 0, NULL);
    s_dataSenderThread = ThreadCreateEx(DataSender, 0, NULL);
-   s_databaseWriterThread = ThreadCreateEx(DatabaseWriter, 0, NULL);
+   s_offlineDataWriterThread = ThreadCreateEx(OfflineDataWriter, 0, NULL);
    s_reconciliationThread = ThreadCreateEx(ReconciliationThread, 0, NULL);
    s_proxyListennerThread = ThreadCreateEx(ProxyListenerThread, 0 ,NULL);
    ThreadPoolScheduleRelative(g_dataCollectorPool, STALLED_DATA_CHECK_INTERVAL, ClearStalledOfflineData, NULL);
@@ -1402,13 +1496,15 @@ void ShutdownLocalDataCollector()
    s_dataSenderQueue.put(INVALID_POINTER_VALUE);
    ThreadJoin(s_dataSenderThread);
 
-   DebugPrintf(5, _T("Waiting for database writer thread termination"));
-   s_databaseWriterQueue.put(INVALID_POINTER_VALUE);
-   ThreadJoin(s_databaseWriterThread);
+   DebugPrintf(5, _T("Waiting for offline data writer thread termination"));
+   s_offlineDataWriterQueue.put(INVALID_POINTER_VALUE);
+   ThreadJoin(s_offlineDataWriterThread);
 
    DebugPrintf(5, _T("Waiting for data reconciliation thread termination"));
    ThreadJoin(s_reconciliationThread);
 
+   CloseOfflineDataQueues();
+
    DebugPrintf(5, _T("Waiting for proxy heartbeat listening thread"));
    ThreadJoin(s_proxyListennerThread);
 }
@@ -1420,7 +1516,6 @@ void ClearDataCollectionConfiguration()
 {
    s_itemLock.lock();
    DB_HANDLE db = GetLocalDatabaseHandle();
-   DBQuery(db, _T("DELETE FROM dc_queue"));
    DBQuery(db, _T("DELETE FROM dc_config"));
    DBQuery(db, _T("DELETE FROM dc_snmp_targets"));
    s_items.clear();
@@ -1429,6 +1524,8 @@ void ClearDataCollectionConfiguration()
    s_serverSyncStatusLock.lock();
    s_serverSyncStatus.clear();
    s_serverSyncStatusLock.unlock();
+
+   DeleteAllOfflineDataQueues();
 }
 
 /**
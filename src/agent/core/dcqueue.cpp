@@ -0,0 +1,819 @@
+/*
+** NetXMS multiplatform core agent
+** Copyright (C) 2003-2020 Raden Solutions
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: dcqueue.cpp
+**
+**/
+
+#include "nxagentd.h"
+#include <nxstat.h>
+
+#define DEBUG_TAG _T("dc.queue")
+
+/**
+ * Queue directory name (relative to data directory)
+ */
+#define QUEUE_DIRECTORY    _T("dcqueue")
+
+/**
+ * Record header size (record size and CRC32 of record data)
+ */
+#define RECORD_HEADER_SIZE 8
+
+/**
+ * Maximum valid record size
+ */
+#define MAX_RECORD_SIZE    (64 * 1024 * 1024)
+
+/**
+ * Minimal segment size
+ */
+#define MIN_SEGMENT_SIZE   65536
+
+/**
+ * Segment size
+ */
+extern UINT64 g_dcOfflineSegmentSize;
+
+/**
+ * Registered queues
+ */
+static RefCountHashMap<UINT64, OfflineDataQueue> s_queues(Ownership::True);
+static Mutex s_queuesLock;
+
+/**
+ * Get root directory for all queues (with trailing separator)
+ */
+static void GetQueueRootDirectory(TCHAR *path)
+{
+   TCHAR tail = g_szDataDirectory[_tcslen(g_szDataDirectory) - 1];
+   _sntprintf(path, MAX_PATH, _T("%s%s") QUEUE_DIRECTORY FS_PATH_SEPARATOR, g_szDataDirectory,
+              ((tail != '\\') && (tail != '/')) ? FS_PATH_SEPARATOR : _T(""));
+}
+
+/**
+ * Truncate file to given size
+ */
+static inline int TruncateFile(int fh, UINT32 size)
+{
+#ifdef _WIN32
+   return _chsize(fh, size);
+#else
+   return ftruncate(fh, size);
+#endif
+}
+
+/**
+ * Flush file data to disk
+ */
+static inline void SyncFile(int fh)
+{
+#ifdef _WIN32
+   _commit(fh);
+#else
+   fsync(fh);
+#endif
+}
+
+/**
+ * Read exactly given number of bytes from file. Returns number of bytes actually read.
+ */
+static size_t ReadFully(int fh, BYTE *buffer, size_t size)
+{
+   size_t total = 0;
+   while(total < size)
+   {
+      int bytes = _read(fh, buffer + total, static_cast<unsigned int>(size - total));
+      if (bytes <= 0)
+         break;
+      total += bytes;
+   }
+   return total;
+}
+
+/**
+ * Read 32 bit integer in network byte order from possibly unaligned location
+ */
+static inline UINT32 ReadUInt32(const BYTE *p)
+{
+   UINT32 value;
+   memcpy(&value, p, sizeof(UINT32));
+   return ntohl(value);
+}
+
+/**
+ * Write 32 bit integer in network byte order to possibly unaligned location
+ */
+static inline void WriteUInt32(BYTE *p, UINT32 value)
+{
+   value = htonl(value);
+   memcpy(p, &value, sizeof(UINT32));
+}
+
+/**
+ * Decode record header
+ */
+static inline void DecodeRecordHeader(const BYTE *header, UINT32 *size, UINT32 *crc)
+{
+   *size = ReadUInt32(header);
+   *crc = ReadUInt32(header + 4);
+}
+
+/**
+ * Queue constructor
+ */
+OfflineDataQueue::OfflineDataQueue(UINT64 serverId) : RefCountObject()
+{
+   m_serverId = serverId;
+   GetQueueRootDirectory(m_path);
+   size_t len = _tcslen(m_path);
+   _sntprintf(&m_path[len], MAX_PATH - len, UINT64X_FMT(_T("016")) FS_PATH_SEPARATOR, serverId);
+   m_firstSegment = 0;
+   m_writeSegment = 0;
+   m_writeOffset = 0;
+   m_writeHandle = -1;
+   m_writeBuffer = NULL;
+   m_writeBufferSize = 0;
+   m_writeBufferAllocated = 0;
+   m_bufferedRecords = 0;
+   m_readPosition.segment = 0;
+   m_readPosition.offset = 0;
+   m_readHandle = -1;
+   m_readHandleSegment = 0;
+   m_size = 0;
+   m_destroyed = false;
+}
+
+/**
+ * Queue destructor
+ */
+OfflineDataQueue::~OfflineDataQueue()
+{
+   if (!m_destroyed)
+      flushBuffer(true);
+   if (m_writeHandle != -1)
+      _close(m_writeHandle);
+   closeReadHandle();
+   MemFree(m_writeBuffer);
+}
+
+/**
+ * Get full name of segment file
+ */
+void OfflineDataQueue::getSegmentFileName(UINT32 segment, TCHAR *fileName)
+{
+   _sntprintf(fileName, MAX_PATH, _T("%s%08X.seg"), m_path, segment);
+}
+
+/**
+ * Scan segment starting at given offset. Returns offset after last complete record. If validate
+ * is true, record data is read and CRC is checked. Number of records found is added to count.
+ */
+UINT32 OfflineDataQueue::scanSegment(UINT32 segment, UINT32 offset, bool validate, INT32 *count)
+{
+   TCHAR fileName[MAX_PATH];
+   getSegmentFileName(segment, fileName);
+   int fh = _topen(fileName, O_RDONLY | O_BINARY);
+   if (fh == -1)
+      return offset;
+
+   BYTE *data = NULL;
+   size_t allocated = 0;
+   if (_lseek(fh, offset, SEEK_SET) == static_cast<off_t>(offset))
+   {
+      while(true)
+      {
+         BYTE header[RECORD_HEADER_SIZE];
+         if (ReadFully(fh, header, RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE)
+            break;
+
+         UINT32 size, crc;
+         DecodeRecordHeader(header, &size, &crc);
+         if (size > MAX_RECORD_SIZE)
+            break;
+
+         if (validate)
+         {
+            if (size > allocated)
+            {
+               allocated = size;
+               data = MemRealloc(data, allocated);
+            }
+            if ((ReadFully(fh, data, size) != size) || (CalculateCRC32(data, size, 0) != crc))
+               break;
+         }
+         else if (_lseek(fh, size, SEEK_CUR) == -1)
+         {
+            break;
+         }
+
+         offset += RECORD_HEADER_SIZE + size;
+         (*count)++;
+      }
+   }
+   _close(fh);
+   MemFree(data);
+   return offset;
+}
+
+/**
+ * Open queue: find existing segments, restore read position, drop incomplete records at the end
+ * of last segment and count records not yet acknowledged.
+ */
+bool OfflineDataQueue::open()
+{
+   TCHAR directory[MAX_PATH];
+   _tcslcpy(directory, m_path, MAX_PATH);
+   directory[_tcslen(directory) - 1] = 0;   // remove trailing separator
+   NX_STAT_STRUCT st;
+   if ((CALL_STAT(directory, &st) != 0) && !CreateFolder(directory))
+   {
+      nxlog_debug_tag(DEBUG_TAG, 1, _T("Cannot create offline data queue directory %s"), directory);
+      return false;
+   }
+
+   bool found = false;
+   UINT32 firstSegment = 0, lastSegment = 0;
+   _TDIR *dir = _topendir(m_path);
+   if (dir != NULL)
+   {
+      struct _tdirent *d;
+      while((d = _treaddir(dir)) != NULL)
+      {
+         TCHAR *eptr;
+         UINT32 segment = _tcstoul(d->d_name, &eptr, 16);
+         if ((eptr == d->d_name) || _tcscmp(eptr, _T(".seg")))
+            continue;
+         if (!found || (segment < firstSegment))
+            firstSegment = segment;
+         if (!found || (segment > lastSegment))
+            lastSegment = segment;
+         found = true;
+      }
+      _tclosedir(dir);
+   }
+
+   if (!found)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("Offline data queue for server ID ") UINT64X_FMT(_T("016")) _T(" is empty"), m_serverId);
+      return true;
+   }
+
+   m_firstSegment = firstSegment;
+   m_writeSegment = lastSegment;
+
+   // Read position is stored as segment, offset and CRC of these two values
+   m_readPosition.segment = firstSegment;
+   m_readPosition.offset = 0;
+   TCHAR fileName[MAX_PATH];
+   _sntprintf(fileName, MAX_PATH, _T("%scursor"), m_path);
+   int fh = _topen(fileName, O_RDONLY | O_BINARY);
+   if (fh != -1)
+   {
+      BYTE data[12];
+      if (ReadFully(fh, data, 12) == 12)
+      {
+         if (CalculateCRC32(data, 8, 0) == ReadUInt32(&data[8]))
+         {
+            UINT32 segment = ReadUInt32(&data[0]);
+            if ((segment >= firstSegment) && (segment <= lastSegment))
+            {
+               m_readPosition.segment = segment;
+               m_readPosition.offset = ReadUInt32(&data[4]);
+            }
+         }
+         else
+         {
+            nxlog_debug_tag(DEBUG_TAG, 2, _T("Read cursor for server ID ") UINT64X_FMT(_T("016")) _T(" is corrupted, queue will be replayed from the beginning"), m_serverId);
+         }
+      }
+      _close(fh);
+   }
+
+   // Remove segments which were fully acknowledged but not deleted
+   for(UINT32 s = m_firstSegment; s < m_readPosition.segment; s++)
+   {
+      getSegmentFileName(s, fileName);
+      _tunlink(fileName);
+   }
+   m_firstSegment = m_readPosition.segment;
+
+   // Validate last segment and cut off partially written record
+   INT32 count = 0;
+   m_writeOffset = scanSegment(m_writeSegment, 0, true, &count);
+   getSegmentFileName(m_writeSegment, fileName);
+   if ((CALL_STAT(fileName, &st) == 0) && (st.st_size > static_cast<off_t>(m_writeOffset)))
+   {
+      nxlog_debug_tag(DEBUG_TAG, 2, _T("Truncating segment %s to %u bytes (incomplete or corrupted record at the end)"), fileName, m_writeOffset);
+      fh = _topen(fileName, O_WRONLY | O_BINARY);
+      if (fh != -1)
+      {
+         TruncateFile(fh, m_writeOffset);
+         _close(fh);
+      }
+   }
+   if ((m_readPosition.segment == m_writeSegment) && (m_readPosition.offset > m_writeOffset))
+      m_readPosition.offset = m_writeOffset;
+
+   // Count records not yet acknowledged
+   m_size = 0;
+   if (m_readPosition.segment == m_writeSegment)
+   {
+      if (m_readPosition.offset == 0)
+      {
+         m_size = count;
+      }
+      else
+      {
+         scanSegment(m_writeSegment, m_readPosition.offset, false, &m_size);
+      }
+   }
+   else
+   {
+      scanSegment(m_readPosition.segment, m_readPosition.offset, false, &m_size);
+      for(UINT32 s = m_readPosition.segment + 1; s < m_writeSegment; s++)
+         scanSegment(s, 0, false, &m_size);
+      m_size += count;
+   }
+
+   nxlog_debug_tag(DEBUG_TAG, 2, _T("Offline data queue for server ID ") UINT64X_FMT(_T("016")) _T(" opened (segments %u..%u, read position %u:%u, %d records)"),
+            m_serverId, m_firstSegment, m_writeSegment, m_readPosition.segment, m_readPosition.offset, m_size);
+   return true;
+}
+
+/**
+ * Write buffered records to current segment file. Queue lock must be held by caller.
+ */
+bool OfflineDataQueue::flushBuffer(bool sync)
+{
+   if (m_writeBufferSize == 0)
+   {
+      if (sync && (m_writeHandle != -1))
+         SyncFile(m_writeHandle);
+      return true;
+   }
+
+   if (m_writeHandle == -1)
+   {
+      TCHAR fileName[MAX_PATH];
+      getSegmentFileName(m_writeSegment, fileName);
+      m_writeHandle = _topen(fileName, O_WRONLY | O_CREAT | O_BINARY, 0600);
+      if (m_writeHandle == -1)
+      {
+         nxlog_debug_tag(DEBUG_TAG, 1, _T("Cannot open segment file %s (%s)"), fileName, _tcserror(errno));
+         return false;
+      }
+      _lseek(m_writeHandle, m_writeOffset, SEEK_SET);
+   }
+
+   int bytes = _write(m_writeHandle, m_writeBuffer, static_cast<unsigned int>(m_writeBufferSize));
+   if (bytes != static_cast<int>(m_writeBufferSize))
+   {
+      // Remove partially written data so segment stays consistent
+      nxlog_debug_tag(DEBUG_TAG, 1, _T("Error writing offline data for server ID ") UINT64X_FMT(_T("016")) _T(" (%s), %d records lost"),
+               m_serverId, _tcserror(errno), m_bufferedRecords);
+      TruncateFile(m_writeHandle, m_writeOffset);
+      _lseek(m_writeHandle, m_writeOffset, SEEK_SET);
+      m_size -= m_bufferedRecords;
+      m_writeBufferSize = 0;
+      m_bufferedRecords = 0;
+      return false;
+   }
+
+   if (sync)
+      SyncFile(m_writeHandle);
+   m_writeOffset += static_cast<UINT32>(m_writeBufferSize);
+   m_writeBufferSize = 0;
+   m_bufferedRecords = 0;
+   return true;
+}
+
+/**
+ * Append record to the queue. Record is written to disk on next flush.
+ */
+void OfflineDataQueue::append(const BYTE *data, size_t size)
+{
+   m_mutex.lock();
+   if (m_destroyed)
+   {
+      m_mutex.unlock();
+      return;
+   }
+
+   // Start new segment if current one is full
+   UINT64 segmentSize = std::max(g_dcOfflineSegmentSize, static_cast<UINT64>(MIN_SEGMENT_SIZE));
+   UINT64 currentSize = static_cast<UINT64>(m_writeOffset) + m_writeBufferSize;
+   if ((currentSize > 0) && (currentSize + RECORD_HEADER_SIZE + size > segmentSize))
+   {
+      flushBuffer(false);
+      if (m_writeHandle != -1)
+      {
+         _close(m_writeHandle);
+         m_writeHandle = -1;
+      }
+      m_writeSegment++;
+      m_writeOffset = 0;
+      nxlog_debug_tag(DEBUG_TAG, 6, _T("Started new segment %u for server ID ") UINT64X_FMT(_T("016")), m_writeSegment, m_serverId);
+   }
+
+   if (m_writeBufferSize + RECORD_HEADER_SIZE + size > m_writeBufferAllocated)
+   {
+      m_writeBufferAllocated = std::max(m_writeBufferAllocated * 2, m_writeBufferSize + RECORD_HEADER_SIZE + size + 65536);
+      m_writeBuffer = MemRealloc(m_writeBuffer, m_writeBufferAllocated);
+   }
+   BYTE *header = &m_writeBuffer[m_writeBufferSize];
+   WriteUInt32(header, static_cast<UINT32>(size));
+   WriteUInt32(header + 4, CalculateCRC32(data, static_cast<UINT32>(size), 0));
+   memcpy(header + RECORD_HEADER_SIZE, data, size);
+   m_writeBufferSize += RECORD_HEADER_SIZE + size;
+   m_bufferedRecords++;
+   m_size++;
+
+   m_mutex.unlock();
+}
+
+/**
+ * Write appended records to disk
+ */
+void OfflineDataQueue::flush(bool sync)
+{
+   m_mutex.lock();
+   if (!m_destroyed)
+      flushBuffer(sync);
+   m_mutex.unlock();
+}
+
+/**
+ * Close read handle. Queue lock must be held by caller.
+ */
+void OfflineDataQueue::closeReadHandle()
+{
+   if (m_readHandle != -1)
+   {
+      _close(m_readHandle);
+      m_readHandle = -1;
+   }
+}
+
+/**
+ * Read next record starting at given position. Position is updated to point to next record.
+ * Returns NULL if there are no more records written to disk.
+ */
+ByteStream *OfflineDataQueue::read(OfflineDataQueuePosition *position)
+{
+   ByteStream *record = NULL;
+   m_mutex.lock();
+   while(!m_destroyed && (position->segment <= m_writeSegment))
+   {
+      if ((position->segment == m_writeSegment) && (position->offset >= m_writeOffset))
+         break;
+
+      if ((m_readHandle == -1) || (m_readHandleSegment != position->segment))
+      {
+         closeReadHandle();
+         TCHAR fileName[MAX_PATH];
+         getSegmentFileName(position->segment, fileName);
+         m_readHandle = _topen(fileName, O_RDONLY | O_BINARY);
+         if (m_readHandle == -1)
+         {
+            if (position->segment == m_writeSegment)
+               break;
+            nxlog_debug_tag(DEBUG_TAG, 2, _T("Cannot open segment file %s (%s)"), fileName, _tcserror(errno));
+            position->segment++;
+            position->offset = 0;
+            continue;
+         }
+         m_readHandleSegment = position->segment;
+      }
+
+      BYTE header[RECORD_HEADER_SIZE];
+      size_t bytes = (_lseek(m_readHandle, position->offset, SEEK_SET) == static_cast<off_t>(position->offset)) ?
+               ReadFully(m_readHandle, header, RECORD_HEADER_SIZE) : 0;
+      if ((bytes == 0) && (position->segment < m_writeSegment))
+      {
+         // End of completed segment
+         position->segment++;
+         position->offset = 0;
+         continue;
+      }
+
+      UINT32 size = 0, crc = 0;
+      if (bytes == RECORD_HEADER_SIZE)
+         DecodeRecordHeader(header, &size, &crc);
+
+      BYTE *data = ((bytes == RECORD_HEADER_SIZE) && (size <= MAX_RECORD_SIZE)) ? MemAllocArrayNoInit<BYTE>(std::max(size, 1u)) : NULL;
+      if ((data != NULL) && (ReadFully(m_readHandle, data, size) == size) && (CalculateCRC32(data, size, 0) == crc))
+      {
+         record = new ByteStream(data, size);
+         MemFree(data);
+         position->offset += RECORD_HEADER_SIZE + size;
+         break;
+      }
+      MemFree(data);
+
+      // Data after corrupted record cannot be trusted, skip to next segment
+      nxlog_debug_tag(DEBUG_TAG, 2, _T("Corrupted record in offline data queue for server ID ") UINT64X_FMT(_T("016")) _T(" at %u:%u"),
+               m_serverId, position->segment, position->offset);
+      if (position->segment == m_writeSegment)
+      {
+         position->offset = m_writeOffset;
+         break;
+      }
+      position->segment++;
+      position->offset = 0;
+   }
+   m_mutex.unlock();
+   return record;
+}
+
+/**
+ * Save read position. Queue lock must be held by caller.
+ */
+void OfflineDataQueue::saveReadPosition()
+{
+   TCHAR fileName[MAX_PATH];
+   _sntprintf(fileName, MAX_PATH, _T("%scursor"), m_path);
+   int fh = _topen(fileName, O_WRONLY | O_CREAT | O_BINARY, 0600);
+   if (fh == -1)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 1, _T("Cannot save read position for server ID ") UINT64X_FMT(_T("016")) _T(" (%s)"), m_serverId, _tcserror(errno));
+      return;
+   }
+
+   // Single small write at file start, torn write will be detected by CRC
+   BYTE data[12];
+   WriteUInt32(&data[0], m_readPosition.segment);
+   WriteUInt32(&data[4], m_readPosition.offset);
+   WriteUInt32(&data[8], CalculateCRC32(data, 8, 0));
+   _write(fh, data, 12);
+   _close(fh);
+}
+
+/**
+ * Acknowledge all records before given position. Fully acknowledged segments are deleted.
+ */
+void OfflineDataQueue::acknowledge(const OfflineDataQueuePosition& position, int count)
+{
+   m_mutex.lock();
+   if (m_destroyed)
+   {
+      m_mutex.unlock();
+      return;
+   }
+
+   m_readPosition = position;
+   m_size -= count;
+   if (((m_readPosition.segment == m_writeSegment) && (m_readPosition.offset >= m_writeOffset) && (m_bufferedRecords == 0)) || (m_size < 0))
+      m_size = m_bufferedRecords;
+   saveReadPosition();
+
+   if (m_readPosition.segment > m_firstSegment)
+   {
+      if (m_readHandleSegment < m_readPosition.segment)
+         closeReadHandle();
+
+      TCHAR fileName[MAX_PATH];
+      for(UINT32 s = m_firstSegment; s < m_readPosition.segment; s++)
+      {
+         getSegmentFileName(s, fileName);
+         _tunlink(fileName);
+      }
+      nxlog_debug_tag(DEBUG_TAG, 6, _T("Deleted segments %u..%u for server ID ") UINT64X_FMT(_T("016")), m_firstSegment, m_readPosition.segment - 1, m_serverId);
+      m_firstSegment = m_readPosition.segment;
+   }
+   m_mutex.unlock();
+}
+
+/**
+ * Delete all queued data. Queue cannot be used after this call.
+ */
+void OfflineDataQueue::destroy()
+{
+   m_mutex.lock();
+   m_destroyed = true;
+   if (m_writeHandle != -1)
+   {
+      _close(m_writeHandle);
+      m_writeHandle = -1;
+   }
+   closeReadHandle();
+
+   TCHAR fileName[MAX_PATH];
+   for(UINT32 s = m_firstSegment; s <= m_writeSegment; s++)
+   {
+      getSegmentFileName(s, fileName);
+      _tunlink(fileName);
+   }
+   _sntprintf(fileName, MAX_PATH, _T("%scursor"), m_path);
+   _tunlink(fileName);
+   _tcslcpy(fileName, m_path, MAX_PATH);
+   fileName[_tcslen(fileName) - 1] = 0;   // remove trailing separator
+   _trmdir(fileName);
+
+   m_writeBufferSize = 0;
+   m_bufferedRecords = 0;
+   m_size = 0;
+   m_mutex.unlock();
+
+   nxlog_debug_tag(DEBUG_TAG, 4, _T("Offline data queue for server ID ") UINT64X_FMT(_T("016")) _T(" deleted"), m_serverId);
+}
+
+/**
+ * Get number of records not yet acknowledged
+ */
+INT32 OfflineDataQueue::getSize()
+{
+   m_mutex.lock();
+   INT32 size = m_size;
+   m_mutex.unlock();
+   return size;
+}
+
+/**
+ * Get current read position
+ */
+OfflineDataQueuePosition OfflineDataQueue::getReadPosition()
+{
+   m_mutex.lock();
+   OfflineDataQueuePosition p = m_readPosition;
+   m_mutex.unlock();
+   return p;
+}
+
+/**
+ * Get offline data queue for given server. If create is true, new queue will be created if needed.
+ * Returned object should be released by calling decRefCount().
+ */
+OfflineDataQueue *GetOfflineDataQueue(UINT64 serverId, bool create)
+{
+   s_queuesLock.lock();
+   OfflineDataQueue *queue = s_queues.get(serverId);
+   if ((queue == NULL) && create)
+   {
+      queue = new OfflineDataQueue(serverId);
+      queue->open();
+      s_queues.set(serverId, queue);
+   }
+   s_queuesLock.unlock();
+   return queue;
+}
+
+/**
+ * Load existing offline data queues. Returns list of server IDs with non-empty queues.
+ */
+IntegerArray<UINT64> *LoadOfflineDataQueues()
+{
+   IntegerArray<UINT64> *servers = new IntegerArray<UINT64>();
+
+   TCHAR path[MAX_PATH];
+   GetQueueRootDirectory(path);
+   _TDIR *dir = _topendir(path);
+   if (dir == NULL)
+      return servers;
+
+   struct _tdirent *d;
+   while((d = _treaddir(dir)) != NULL)
+   {
+      TCHAR *eptr;
+      UINT64 serverId = _tcstoull(d->d_name, &eptr, 16);
+      if ((eptr == d->d_name) || (*eptr != 0) || (_tcslen(d->d_name) != 16))
+         continue;
+
+      OfflineDataQueue *queue = new OfflineDataQueue(serverId);
+      if (queue->open())
+      {
+         s_queuesLock.lock();
+         s_queues.set(serverId, queue);
+         s_queuesLock.unlock();
+         if (queue->getSize() > 0)
+            servers->add(serverId);
+      }
+      queue->decRefCount();
+   }
+   _tclosedir(dir);
+   return servers;
+}
+
+/**
+ * Delete offline data queue for given server
+ */
+void DeleteOfflineDataQueue(UINT64 serverId)
+{
+   s_queuesLock.lock();
+   OfflineDataQueue *queue = s_queues.get(serverId);
+   if (queue != NULL)
+      s_queues.remove(serverId);
+   s_queuesLock.unlock();
+
+   if (queue != NULL)
+   {
+      queue->destroy();
+      queue->decRefCount();
+   }
+}
+
+/**
+ * Delete all offline data queues
+ */
+void DeleteAllOfflineDataQueues()
+{
+   s_queuesLock.lock();
+   Iterator<OfflineDataQueue> *it = s_queues.iterator();
+   while(it->hasNext())
+      it->next()->destroy();
+   delete it;
+   s_queues.clear();
+   s_queuesLock.unlock();
+}
+
+/**
+ * Flush and close all offline data queues
+ */
+void CloseOfflineDataQueues()
+{
+   s_queuesLock.lock();
+   s_queues.clear();
+   s_queuesLock.unlock();
+}
+
+/**
+ * Move data queued by previous agent versions in local database table dc_queue into offline
+ * data queues. Handler is called for each selected row and should append converted record to
+ * given queue. Each block is synced to disk before it is deleted from database, so interrupted
+ * migration can only cause some values to be sent twice. Returns number of migrated records.
+ */
+int MigrateOfflineData(DB_HANDLE hdb, void (*handler)(DB_RESULT, int, OfflineDataQueue*))
+{
+   INT64 lastRowId = 0;
+   int total = 0;
+   while(true)
+   {
+      TCHAR query[512];
+      _sntprintf(query, 512, _T("SELECT server_id,dci_id,dci_type,dci_origin,status_code,snmp_target_guid,timestamp,value,rowid FROM dc_queue WHERE rowid>") INT64_FMT _T(" ORDER BY rowid LIMIT 10000"), lastRowId);
+      DB_RESULT hResult = DBSelect(hdb, query);
+      if (hResult == NULL)
+         break;
+
+      int count = DBGetNumRows(hResult);
+      if (count == 0)
+      {
+         DBFreeResult(hResult);
+         break;
+      }
+
+      ObjectRefArray<OfflineDataQueue> queues(4, 4);
+      for(int i = 0; i < count; i++)
+      {
+         UINT64 serverId = DBGetFieldUInt64(hResult, i, 0);
+         OfflineDataQueue *queue = NULL;
+         for(int j = 0; j < queues.size(); j++)
+         {
+            if (queues.get(j)->getServerId() == serverId)
+            {
+               queue = queues.get(j);
+               break;
+            }
+         }
+         if (queue == NULL)
+         {
+            queue = GetOfflineDataQueue(serverId, true);
+            queues.add(queue);
+         }
+         handler(hResult, i, queue);
+      }
+      lastRowId = DBGetFieldInt64(hResult, count - 1, 8);
+      DBFreeResult(hResult);
+
+      for(int i = 0; i < queues.size(); i++)
+      {
+         queues.get(i)->flush(true);
+         queues.get(i)->decRefCount();
+      }
+
+      _sntprintf(query, 512, _T("DELETE FROM dc_queue WHERE rowid<=") INT64_FMT, lastRowId);
+      DBQuery(hdb, query);
+      total += count;
+   }
+
+   if (total > 0)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 2, _T("%d offline data elements moved from local database to offline data queue"), total);
+      DBQuery(hdb, _T("VACUUM"));
+   }
+   return total;
+}
@@ -31,14 +31,17 @@ class ParameterProvider
 	int m_pollInterval;
 	time_t m_lastPollTime;
 	KeyValueOutputProcessExecutor *m_executor;
+   ExternalProcessPool *m_pool;
    StringMap *m_parameters;
    MUTEX m_mutex;
 
    void lock() { MutexLock(m_mutex); }
    void unlock() { MutexUnlock(m_mutex); }
 
+   void pollPersistentProcess();
+
 public:
-	ParameterProvider(const TCHAR *command, int pollInterval);
+	ParameterProvider(const TCHAR *command, int pollInterval, bool persistent);
 	~ParameterProvider();
 
 	time_t getLastPollTime() { return m_lastPollTime; }
@@ -50,13 +53,23 @@ class ParameterProvider
 };
 
 /**
- * Constructor
+ * Constructor. Persistent provider shares process supervisor with persistent external
+ * parameters and requests all values from running worker instead of starting new process.
  */
-ParameterProvider::ParameterProvider(const TCHAR *command, int pollInterval)
+ParameterProvider::ParameterProvider(const TCHAR *command, int pollInterval, bool persistent)
 {
 	m_pollInterval = pollInterval;
 	m_lastPollTime = 0;
-	m_executor = new KeyValueOutputProcessExecutor(command);
+   if (persistent)
+   {
+      m_executor = NULL;
+      m_pool = GetExternalProcessPool(command);
+   }
+   else
+   {
+      m_executor = new KeyValueOutputProcessExecutor(command);
+      m_pool = NULL;
+   }
 	m_parameters = new StringMap();
    m_mutex = MutexCreate();
 }
@@ -96,6 +109,12 @@ LONG ParameterProvider::getValue(const TCHAR *name, TCHAR *buffer)
  */
 void ParameterProvider::poll()
 {
+   if (m_pool != NULL)
+   {
+      pollPersistentProcess();
+      return;
+   }
+
 	if (m_executor->execute())
 	{
 	   nxlog_debug(4, _T("ParamProvider::poll(): started command \"%s\""), m_executor->getCommand());
@@ -116,6 +135,45 @@ void ParameterProvider::poll()
 	m_lastPollTime = time(NULL);
 }
 
+/**
+ * Poll persistent provider. Worker is expected to respond to request "*" with list of
+ * name=value pairs.
+ */
+void ParameterProvider::pollPersistentProcess()
+{
+   StringList output;
+   LONG rc = m_pool->execute(_T("*"), &output, g_eppTimeout * 1000);
+   if (rc == SYSINFO_RC_SUCCESS)
+   {
+      StringMap *parameters = new StringMap();
+      for(int i = 0; i < output.size(); i++)
+      {
+         TCHAR *line = MemCopyString(output.get(i));
+         TCHAR *ptr = _tcschr(line, _T('='));
+         if (ptr != NULL)
+         {
+            *ptr = 0;
+            ptr++;
+            Trim(line);
+            Trim(ptr);
+            parameters->set(line, ptr);
+         }
+         MemFree(line);
+      }
+
+      lock();
+      delete m_parameters;
+      m_parameters = parameters;
+      unlock();
+      nxlog_debug(4, _T("ParamProvider::poll(): persistent process \"%s\" returned %d values"), m_pool->getCommand(), (int)parameters->size());
+   }
+   else
+   {
+      nxlog_debug(4, _T("ParamProvider::poll(): request to persistent process \"%s\" failed (rc=%d)"), m_pool->getCommand(), (int)rc);
+   }
+	m_lastPollTime = time(NULL);
+}
+
 /**
  * Parameter list callback data
  */
@@ -215,7 +273,7 @@ void StartParamProvidersPoller()
  * command:interval
  * Interval may be omited.
  */
-bool AddParametersProvider(const TCHAR *line)
+bool AddParametersProvider(const TCHAR *line, bool persistent)
 {
 	TCHAR buffer[1024];
 	int interval = 60;
@@ -235,7 +293,7 @@ bool AddParametersProvider(const TCHAR *line)
 		}
 	}
 
-	ParameterProvider *p = new ParameterProvider(buffer, interval);
+	ParameterProvider *p = new ParameterProvider(buffer, interval, persistent);
 	s_providers.add(p);
 
 	return true;
@@ -548,6 +548,47 @@ LONG H_ExternalParameter(const TCHAR *cmd, const TCHAR *arg, TCHAR *value, Abstr
    return status;
 }
 
+/**
+ * Handler function for external parameters served by persistent processes. Request sent
+ * to the worker consists of parameter name and arguments separated by TAB characters.
+ */
+LONG H_PersistentExternalParameter(const TCHAR *cmd, const TCHAR *arg, TCHAR *value, AbstractCommSession *session)
+{
+   session->debugPrintf(4, _T("H_PersistentExternalParameter called for \"%s\""), cmd);
+
+   const TCHAR *p = _tcschr(cmd, _T('('));
+   StringBuffer request;
+   request.append(cmd, (p != NULL) ? p - cmd : _tcslen(cmd));
+
+   // Same limit of 9 arguments as for $1 .. $9 substitution; trailing empty arguments are omitted
+   TCHAR buffer[1024];
+   int emptyArgs = 0;
+   for(int i = 1; i <= 9; i++)
+   {
+      AgentGetParameterArg(cmd, i, buffer, 1024);
+      if (buffer[0] == 0)
+      {
+         emptyArgs++;
+         continue;
+      }
+      for(; emptyArgs > 0; emptyArgs--)
+         request.append(_T('\t'));
+      for(TCHAR *s = buffer; *s != 0; s++)
+         if ((*s == _T('\t')) || (*s == _T('\r')) || (*s == _T('\n')))
+            *s = _T(' ');
+      request.append(_T('\t'));
+      request.append(buffer);
+   }
+
+   StringList values;
+   LONG status = ((ExternalProcessPool *)arg)->execute(request, &values, g_execTimeout);
+   if (status == SYSINFO_RC_SUCCESS)
+   {
+      ret_string(value, values.size() > 0 ? values.get(0) : _T(""));
+   }
+   return status;
+}
+
 /**
  * Handler function for external (user-defined) lists
  */
@@ -22,6 +22,35 @@
 
 #include "nxagentd.h"
 
+/**
+ * Timeout for single request to external subagent (milliseconds)
+ */
+#define REQUEST_TIMEOUT    5000
+
+/**
+ * Maximum number of parameters in one CMD_GET_PARAMETERS request
+ */
+#define MAX_BATCH_SIZE     64
+
+/**
+ * Default limit for concurrently executing requests to single external subagent
+ */
+#define DEFAULT_MAX_ACTIVE_REQUESTS    8
+
+/**
+ * Parameter request waiting for execution. Requests issued while all request slots are busy
+ * are accumulated and sent as single batch once slot becomes available.
+ */
+struct ExtSubagentParameterRequest
+{
+   const TCHAR *name;
+   TCHAR *value;
+   UINT32 rcc;
+   bool completed;
+   bool promoted;       // requesting thread owns request slot and should send next batch
+   CONDITION wakeup;
+};
+
 /**
  *Static data
  */
@@ -30,7 +59,7 @@ static ObjectArray<ExternalSubagent> s_subagents;
 /**
  * Constructor
  */
-ExternalSubagent::ExternalSubagent(const TCHAR *name, const TCHAR *user)
+ExternalSubagent::ExternalSubagent(const TCHAR *name, const TCHAR *user, int maxActiveRequests) : m_pendingParameters(64, 64, Ownership::False)
 {
 	_tcslcpy(m_name, name, MAX_SUBAGENT_NAME);
 	_tcslcpy(m_user, user, MAX_ESA_USER_NAME);
@@ -38,7 +67,11 @@ ExternalSubagent::ExternalSubagent(const TCHAR *name, const TCHAR *user)
 	m_listener = NULL;
 	m_pipe = NULL;
 	m_msgQueue = new MsgWaitQueue();
-	m_requestId = 1;
+	m_requestId = 0;
+   m_slotReleased = ConditionCreate(false);
+   m_maxActiveRequests = maxActiveRequests;
+   m_activeRequests = 0;
+   m_batchSupported = true;
 }
 
 /**
@@ -48,6 +81,7 @@ ExternalSubagent::~ExternalSubagent()
 {
 	delete m_msgQueue;
 	delete m_listener;
+   ConditionDestroy(m_slotReleased);
 }
 
 /**
@@ -98,7 +132,61 @@ bool ExternalSubagent::sendMessage(const NXCPMessage *msg)
  */
 NXCPMessage *ExternalSubagent::waitForMessage(WORD code, UINT32 id)
 {
-	return m_msgQueue->waitForMessage(code, id, 5000);	// 5 sec timeout
+	return m_msgQueue->waitForMessage(code, id, REQUEST_TIMEOUT);
+}
+
+/**
+ * Acquire slot for executing request
+ */
+bool ExternalSubagent::acquireRequestSlot(UINT32 timeout)
+{
+   INT64 deadline = GetCurrentTimeMs() + timeout;
+   m_requestLock.lock();
+   while(m_activeRequests >= m_maxActiveRequests)
+   {
+      INT64 remaining = deadline - GetCurrentTimeMs();
+      if (remaining <= 0)
+      {
+         m_requestLock.unlock();
+         return false;
+      }
+      m_requestLock.unlock();
+      ConditionWait(m_slotReleased, static_cast<UINT32>(remaining));
+      m_requestLock.lock();
+   }
+   m_activeRequests++;
+   m_requestLock.unlock();
+   return true;
+}
+
+/**
+ * Release request slot. If parameter requests are waiting, slot is handed over to first of them
+ * which does not own request slot yet.
+ */
+void ExternalSubagent::releaseRequestSlot()
+{
+   m_requestLock.lock();
+   ExtSubagentParameterRequest *request = NULL;
+   for(int i = 0; i < m_pendingParameters.size(); i++)
+   {
+      ExtSubagentParameterRequest *r = m_pendingParameters.get(i);
+      if (!r->promoted)
+      {
+         request = r;
+         break;
+      }
+   }
+   if (request != NULL)
+   {
+      request->promoted = true;
+      ConditionSet(request->wakeup);
+   }
+   else
+   {
+      m_activeRequests--;
+      ConditionSet(m_slotReleased);
+   }
+   m_requestLock.unlock();
 }
 
 /**
@@ -124,6 +212,9 @@ void ExternalSubagent::connect(NamedPipe *pipe)
 
 	m_pipe = pipe;
 	m_connected = true;
+   m_requestLock.lock();
+   m_batchSupported = true;   // Reconnected subagent may be different version
+   m_requestLock.unlock();
 	AgentWriteDebugLog(2, _T("ExternalSubagent(%s): connection established"), m_name);
    PipeMessageReceiver receiver(pipe->handle(), 8192, 1048576);  // 8K initial, 1M max
 	while(!(g_dwFlags & AF_SHUTDOWN))
@@ -176,7 +267,7 @@ void ExternalSubagent::connect(NamedPipe *pipe)
  */
 void ExternalSubagent::shutdown(bool restart)
 {
-	NXCPMessage msg(CMD_SHUTDOWN, m_requestId++);
+	NXCPMessage msg(CMD_SHUTDOWN, nextRequestId());
    msg.setField(VID_RESTART, restart);
 	sendMessage(&msg);
 }
@@ -186,7 +277,7 @@ void ExternalSubagent::shutdown(bool restart)
  */
 void ExternalSubagent::restart()
 {
-   NXCPMessage msg(CMD_RESTART, m_requestId++);
+   NXCPMessage msg(CMD_RESTART, nextRequestId());
    sendMessage(&msg);
 }
 
@@ -199,7 +290,7 @@ NETXMS_SUBAGENT_PARAM *ExternalSubagent::getSupportedParameters(UINT32 *count)
 	NETXMS_SUBAGENT_PARAM *result = NULL;
 
 	msg.setCode(CMD_GET_PARAMETER_LIST);
-	msg.setId(m_requestId++);
+	msg.setId(nextRequestId());
 	if (sendMessage(&msg))
 	{
 		NXCPMessage *response = waitForMessage(CMD_REQUEST_COMPLETED, msg.getId());
@@ -232,7 +323,7 @@ NETXMS_SUBAGENT_LIST *ExternalSubagent::getSupportedLists(UINT32 *count)
 	NETXMS_SUBAGENT_LIST *result = NULL;
 
 	msg.setCode(CMD_GET_ENUM_LIST);
-	msg.setId(m_requestId++);
+	msg.setId(nextRequestId());
 	if (sendMessage(&msg))
 	{
 		NXCPMessage *response = waitForMessage(CMD_REQUEST_COMPLETED, msg.getId());
@@ -263,7 +354,7 @@ NETXMS_SUBAGENT_TABLE *ExternalSubagent::getSupportedTables(UINT32 *count)
 	NETXMS_SUBAGENT_TABLE *result = NULL;
 
 	msg.setCode(CMD_GET_TABLE_LIST);
-	msg.setId(m_requestId++);
+	msg.setId(nextRequestId());
 	if (sendMessage(&msg))
 	{
 		NXCPMessage *response = waitForMessage(CMD_REQUEST_COMPLETED, msg.getId());
@@ -296,7 +387,7 @@ ACTION *ExternalSubagent::getSupportedActions(UINT32 *count)
 	ACTION *result = NULL;
 
 	msg.setCode(CMD_GET_ACTION_LIST);
-	msg.setId(m_requestId++);
+	msg.setId(nextRequestId());
 	if (sendMessage(&msg))
 	{
 		NXCPMessage *response = waitForMessage(CMD_REQUEST_COMPLETED, msg.getId());
@@ -487,36 +578,192 @@ void ExternalSubagent::listActions(StringList *list)
 }
 
 /**
- * Get parameter value from external subagent
+ * Execute batch of parameter requests. Uses single CMD_GET_PARAMETERS request if supported by
+ * subagent, otherwise pipelines individual CMD_GET_PARAMETER requests. Whole batch is limited
+ * by single request timeout.
+ */
+void ExternalSubagent::executeParameterBatch(ObjectArray<ExtSubagentParameterRequest> *batch)
+{
+   INT64 deadline = GetCurrentTimeMs() + REQUEST_TIMEOUT;
+
+   m_requestLock.lock();
+   bool useBatchRequest = (batch->size() > 1) && m_batchSupported;
+   m_requestLock.unlock();
+
+   bool done = false;
+   if (useBatchRequest)
+   {
+      NXCPMessage msg(CMD_GET_PARAMETERS, nextRequestId());
+      msg.setField(VID_NUM_PARAMETERS, static_cast<UINT32>(batch->size()));
+      for(int i = 0; i < batch->size(); i++)
+         msg.setField(VID_PARAM_LIST_BASE + i, batch->get(i)->name);
+      if (sendMessage(&msg))
+      {
+         NXCPMessage *response = m_msgQueue->waitForMessage(CMD_REQUEST_COMPLETED, msg.getId(), REQUEST_TIMEOUT);
+         if (response != NULL)
+         {
+            UINT32 rcc = response->getFieldAsUInt32(VID_RCC);
+            if (rcc == ERR_SUCCESS)
+            {
+               UINT32 fieldId = VID_PARAM_LIST_BASE;
+               for(int i = 0; i < batch->size(); i++, fieldId += 2)
+               {
+                  ExtSubagentParameterRequest *request = batch->get(i);
+                  request->rcc = response->getFieldAsUInt32(fieldId);
+                  if (request->rcc == ERR_SUCCESS)
+                     response->getFieldAsString(fieldId + 1, request->value, MAX_RESULT_LENGTH);
+               }
+               done = true;
+            }
+            else if (rcc == ERR_UNKNOWN_COMMAND)
+            {
+               AgentWriteDebugLog(4, _T("ExternalSubagent(%s): batch requests not supported, falling back to single requests"), m_name);
+               m_requestLock.lock();
+               m_batchSupported = false;
+               m_requestLock.unlock();
+            }
+            else
+            {
+               for(int i = 0; i < batch->size(); i++)
+                  batch->get(i)->rcc = rcc;
+               done = true;
+            }
+            delete response;
+         }
+         else
+         {
+            for(int i = 0; i < batch->size(); i++)
+               batch->get(i)->rcc = ERR_INTERNAL_ERROR;
+            done = true;
+         }
+      }
+      else
+      {
+         for(int i = 0; i < batch->size(); i++)
+            batch->get(i)->rcc = ERR_CONNECTION_BROKEN;
+         done = true;
+      }
+   }
+
+   if (!done)
+   {
+      // Send all requests first and then collect responses (correlated by request ID)
+      UINT32 *requestIds = MemAllocArrayNoInit<UINT32>(batch->size());
+      for(int i = 0; i < batch->size(); i++)
+      {
+         NXCPMessage msg(CMD_GET_PARAMETER, nextRequestId());
+         msg.setField(VID_PARAMETER, batch->get(i)->name);
+         requestIds[i] = sendMessage(&msg) ? msg.getId() : 0;
+      }
+      for(int i = 0; i < batch->size(); i++)
+      {
+         ExtSubagentParameterRequest *request = batch->get(i);
+         if (requestIds[i] == 0)
+         {
+            request->rcc = ERR_CONNECTION_BROKEN;
+            continue;
+         }
+         INT64 remaining = deadline - GetCurrentTimeMs();
+         NXCPMessage *response = m_msgQueue->waitForMessage(CMD_REQUEST_COMPLETED, requestIds[i], (remaining > 0) ? static_cast<UINT32>(remaining) : 0);
+         if (response != NULL)
+         {
+            request->rcc = response->getFieldAsUInt32(VID_RCC);
+            if (request->rcc == ERR_SUCCESS)
+               response->getFieldAsString(VID_VALUE, request->value, MAX_RESULT_LENGTH);
+            delete response;
+         }
+         else
+         {
+            request->rcc = ERR_INTERNAL_ERROR;
+         }
+      }
+      MemFree(requestIds);
+   }
+
+   // Condition should be signalled under lock because requester destroys it as soon as it sees completion flag
+   m_requestLock.lock();
+   for(int i = 0; i < batch->size(); i++)
+   {
+      ExtSubagentParameterRequest *request = batch->get(i);
+      request->completed = true;
+      ConditionSet(request->wakeup);
+   }
+   m_requestLock.unlock();
+}
+
+/**
+ * Get parameter value from external subagent. If concurrency limit for this subagent is reached,
+ * request is queued and sent together with other queued requests as one batch.
  */
 UINT32 ExternalSubagent::getParameter(const TCHAR *name, TCHAR *buffer)
 {
-	NXCPMessage msg;
-	UINT32 rcc;
+   ExtSubagentParameterRequest request;
+   request.name = name;
+   request.value = buffer;
+   request.rcc = ERR_INTERNAL_ERROR;
+   request.completed = false;
+   request.promoted = false;
+   request.wakeup = ConditionCreate(false);
 
-	msg.setCode(CMD_GET_PARAMETER);
-	msg.setId(m_requestId++);
-	msg.setField(VID_PARAMETER, name);
-	if (sendMessage(&msg))
-	{
-		NXCPMessage *response = waitForMessage(CMD_REQUEST_COMPLETED, msg.getId());
-		if (response != NULL)
-		{
-			rcc = response->getFieldAsUInt32(VID_RCC);
-			if (rcc == ERR_SUCCESS)
-				response->getFieldAsString(VID_VALUE, buffer, MAX_RESULT_LENGTH);
-			delete response;
-		}
-		else
-		{
-			rcc = ERR_INTERNAL_ERROR;
-		}
-	}
-	else
-	{
-		rcc = ERR_CONNECTION_BROKEN;
-	}
-	return rcc;
+   m_requestLock.lock();
+   m_pendingParameters.add(&request);
+   if (m_activeRequests < m_maxActiveRequests)
+   {
+      m_activeRequests++;
+      request.promoted = true;
+   }
+   m_requestLock.unlock();
+
+   INT64 deadline = GetCurrentTimeMs() + REQUEST_TIMEOUT;
+   while(true)
+   {
+      m_requestLock.lock();
+      if (request.promoted)
+      {
+         // This thread owns request slot - send everything queued so far (up to batch size limit)
+         request.promoted = false;
+         int count = std::min(m_pendingParameters.size(), MAX_BATCH_SIZE);
+         ObjectArray<ExtSubagentParameterRequest> batch(count, 16, Ownership::False);
+         for(int i = 0; i < count; i++)
+         {
+            batch.add(m_pendingParameters.get(0));
+            m_pendingParameters.remove(0);
+         }
+         m_requestLock.unlock();
+
+         executeParameterBatch(&batch);
+         releaseRequestSlot();
+         continue;
+      }
+      if (request.completed)
+      {
+         m_requestLock.unlock();
+         break;
+      }
+      m_requestLock.unlock();
+
+      INT64 remaining = deadline - GetCurrentTimeMs();
+      if ((remaining > 0) && ConditionWait(request.wakeup, static_cast<UINT32>(remaining)))
+         continue;
+
+      m_requestLock.lock();
+      if (!request.completed && !request.promoted && m_pendingParameters.contains(&request))
+      {
+         // Still waiting in queue
+         m_pendingParameters.remove(&request);
+         request.rcc = ERR_REQUEST_TIMEOUT;
+         m_requestLock.unlock();
+         break;
+      }
+      m_requestLock.unlock();
+
+      // Request is already being executed by another thread (execution time is limited by batch
+      // timeout) or this thread was just promoted - wait for completion or promotion signal
+      ConditionWait(request.wakeup, INFINITE);
+   }
+
+   ConditionDestroy(request.wakeup);
+   return request.rcc;
 }
 
 /**
@@ -527,8 +774,11 @@ UINT32 ExternalSubagent::getTable(const TCHAR *name, Table *value)
 	NXCPMessage msg;
 	UINT32 rcc;
 
+   if (!acquireRequestSlot(REQUEST_TIMEOUT))
+      return ERR_REQUEST_TIMEOUT;
+
 	msg.setCode(CMD_GET_TABLE);
-	msg.setId(m_requestId++);
+	msg.setId(nextRequestId());
 	msg.setField(VID_PARAMETER, name);
 	if (sendMessage(&msg))
 	{
@@ -549,6 +799,7 @@ UINT32 ExternalSubagent::getTable(const TCHAR *name, Table *value)
 	{
 		rcc = ERR_CONNECTION_BROKEN;
 	}
+   releaseRequestSlot();
 	return rcc;
 }
 
@@ -560,8 +811,11 @@ UINT32 ExternalSubagent::getList(const TCHAR *name, StringList *value)
 	NXCPMessage msg;
 	UINT32 rcc;
 
+   if (!acquireRequestSlot(REQUEST_TIMEOUT))
+      return ERR_REQUEST_TIMEOUT;
+
 	msg.setCode(CMD_GET_LIST);
-	msg.setId(m_requestId++);
+	msg.setId(nextRequestId());
 	msg.setField(VID_PARAMETER, name);
 	if (sendMessage(&msg))
 	{
@@ -586,6 +840,7 @@ UINT32 ExternalSubagent::getList(const TCHAR *name, StringList *value)
 	{
 		rcc = ERR_CONNECTION_BROKEN;
 	}
+   releaseRequestSlot();
 	return rcc;
 }
 
@@ -594,7 +849,7 @@ UINT32 ExternalSubagent::getList(const TCHAR *name, StringList *value)
  */
 UINT32 ExternalSubagent::executeAction(const TCHAR *name, const StringList *args, AbstractCommSession *session, UINT32 requestId, bool sendOutput)
 {
-	NXCPMessage msg(CMD_EXECUTE_ACTION, m_requestId++);
+	NXCPMessage msg(CMD_EXECUTE_ACTION, nextRequestId());
 	msg.setField(VID_ACTION_NAME, name);
    args->fillMessage(&msg, VID_ACTION_ARG_BASE, VID_NUM_ARGS);
    msg.setField(VID_REQUEST_ID, requestId);
@@ -625,12 +880,14 @@ UINT32 ExternalSubagent::executeAction(const TCHAR *name, const StringList *args
 /**
  * Add external subagent from config.
  * Each line in config should be in form 
- * name:user
- * If user part is omited or set to *, connection from any account will be accepted
+ * name:user:maxRequests
+ * If user part is omited or set to *, connection from any account will be accepted.
+ * Optional maxRequests part sets limit for concurrently executing requests to this subagent.
  */
 bool AddExternalSubagent(const TCHAR *config)
 {
 	TCHAR buffer[1024], user[256] = _T("*");
+   int maxRequests = DEFAULT_MAX_ACTIVE_REQUESTS;
 
 	nx_strncpy(buffer, config, 1024);
 	TCHAR *ptr = _tcschr(buffer, _T(':'));
@@ -638,11 +895,25 @@ bool AddExternalSubagent(const TCHAR *config)
 	{
 		*ptr = 0;
 		ptr++;
+      TCHAR *limit = _tcschr(ptr, _T(':'));
+      if (limit != NULL)
+      {
+         *limit = 0;
+         limit++;
+         Trim(limit);
+         TCHAR *eptr;
+         maxRequests = _tcstol(limit, &eptr, 0);
+         if ((*eptr != 0) || (maxRequests < 1))
+         {
+            AgentWriteDebugLog(2, _T("Invalid request limit given for external subagent %s"), buffer);
+            return false;
+         }
+      }
 		_tcsncpy(user, ptr, 256);
 		Trim(user);
 	}
 
-	ExternalSubagent *subagent = new ExternalSubagent(buffer, user);
+	ExternalSubagent *subagent = new ExternalSubagent(buffer, user, maxRequests);
 	s_subagents.add(subagent);
 	subagent->startListener();
 	return true;
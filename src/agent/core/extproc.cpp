@@ -0,0 +1,587 @@
+/*
+** NetXMS multiplatform core agent
+** Copyright (C) 2003-2020 Raden Solutions
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: extproc.cpp
+**
+**/
+
+#include "nxagentd.h"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#if HAVE_POLL_H
+#include <poll.h>
+#endif
+#endif
+
+#define DEBUG_TAG _T("extproc")
+
+/**
+ * Externals
+ */
+extern UINT32 g_externalProcessPoolSize;
+
+/*
+ * Persistent worker protocol
+ *
+ * Agent sends request as single line terminated by LF: request name optionally followed by
+ * arguments, separated by TAB characters. Worker responds with zero or more data lines followed
+ * by status line. Status line starts with dot and is one of:
+ *    .OK
+ *    .ERROR [optional message]
+ *    .UNSUPPORTED
+ * Data lines starting with dot should be escaped by additional dot (".." at the beginning of
+ * the line is received as single dot). Closed standard input means that worker should exit.
+ */
+
+/**
+ * Maximum length of single response line
+ */
+#define WORKER_BUFFER_SIZE    16384
+
+/**
+ * Persistent worker process
+ */
+struct ExternalProcessWorker
+{
+   pid_t pid;
+#ifndef _WIN32
+   int input;     // write end of worker's standard input
+   int output;    // read end of worker's standard output
+#endif
+   size_t bufferSize;
+   UINT32 requests;
+   char buffer[WORKER_BUFFER_SIZE];
+};
+
+#ifndef _WIN32
+
+/**
+ * Start new worker process
+ */
+static ExternalProcessWorker *SpawnWorker(const TCHAR *command)
+{
+   int input[2], output[2];
+   if (pipe(input) == -1)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("SpawnWorker(%s): pipe() call failed (%s)"), command, _tcserror(errno));
+      return NULL;
+   }
+   if (pipe(output) == -1)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("SpawnWorker(%s): pipe() call failed (%s)"), command, _tcserror(errno));
+      close(input[0]);
+      close(input[1]);
+      return NULL;
+   }
+
+   // Agent's ends of the pipes should not be inherited by other child processes,
+   // otherwise worker will not see end of input when agent closes it
+   fcntl(input[1], F_SETFD, fcntl(input[1], F_GETFD) | FD_CLOEXEC);
+   fcntl(output[0], F_SETFD, fcntl(output[0], F_GETFD) | FD_CLOEXEC);
+
+#ifdef UNICODE
+   char *cmdLine = UTF8StringFromWideString(command);
+#else
+   const char *cmdLine = command;
+#endif
+
+   pid_t pid = fork();
+   if (pid == 0)
+   {
+      // child
+      setpgid(0, 0); // new process group
+
+      sigset_t signals;
+      sigemptyset(&signals);
+      sigprocmask(SIG_SETMASK, &signals, NULL);
+
+      dup2(input[0], 0);
+      dup2(output[1], 1);
+      close(input[0]);
+      close(input[1]);
+      close(output[0]);
+      close(output[1]);
+
+      // Do not leak agent's sockets, files, and pipes of other workers into worker process
+      int fdLimit = static_cast<int>(sysconf(_SC_OPEN_MAX));
+      if (fdLimit < 0)
+         fdLimit = 1024;
+      for(int fd = 3; fd < fdLimit; fd++)
+         close(fd);
+
+      execl("/bin/sh", "/bin/sh", "-c", cmdLine, NULL);
+      _exit(127);
+   }
+
+#ifdef UNICODE
+   MemFree(cmdLine);
+#endif
+   close(input[0]);
+   close(output[1]);
+
+   if (pid == -1)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("SpawnWorker(%s): fork() call failed (%s)"), command, _tcserror(errno));
+      close(input[1]);
+      close(output[0]);
+      return NULL;
+   }
+
+   ExternalProcessWorker *worker = new ExternalProcessWorker();
+   worker->pid = pid;
+   worker->input = input[1];
+   worker->output = output[0];
+   worker->bufferSize = 0;
+   worker->requests = 0;
+   nxlog_debug_tag(DEBUG_TAG, 4, _T("Started worker process %d for \"%s\""), (int)pid, command);
+   return worker;
+}
+
+/**
+ * Stop worker process and destroy worker object. If graceful stop requested, worker is given
+ * some time to exit after its standard input is closed.
+ */
+static void DestroyWorker(ExternalProcessWorker *worker, bool graceful)
+{
+   close(worker->input);
+   close(worker->output);
+
+   bool exited = false;
+   if (graceful)
+   {
+      for(int i = 0; (i < 20) && !exited; i++)
+      {
+         if (waitpid(worker->pid, NULL, WNOHANG) != 0)
+            exited = true;
+         else
+            ThreadSleepMs(50);
+      }
+   }
+   if (!exited)
+   {
+      kill(-worker->pid, SIGKILL);  // kill all processes in group
+      kill(worker->pid, SIGKILL);   // in case worker has not yet created its own group
+      waitpid(worker->pid, NULL, 0);
+   }
+
+   nxlog_debug_tag(DEBUG_TAG, 6, _T("Worker process %d stopped (%u requests served)"), (int)worker->pid, worker->requests);
+   delete worker;
+}
+
+/**
+ * Send request line to worker
+ */
+static bool WriteRequest(ExternalProcessWorker *worker, const char *data, size_t size)
+{
+   while(size > 0)
+   {
+      ssize_t bytes = write(worker->input, data, size);
+      if (bytes < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         nxlog_debug_tag(DEBUG_TAG, 5, _T("Cannot send request to worker process %d (%s)"), (int)worker->pid, _tcserror(errno));
+         return false;
+      }
+      data += bytes;
+      size -= bytes;
+   }
+   return true;
+}
+
+/**
+ * Read single line from worker. Line terminator is removed.
+ */
+static bool ReadLine(ExternalProcessWorker *worker, char *line, INT64 deadline)
+{
+   while(true)
+   {
+      char *eol = static_cast<char*>(memchr(worker->buffer, '\n', worker->bufferSize));
+      if (eol != NULL)
+      {
+         size_t len = eol - worker->buffer;
+         memcpy(line, worker->buffer, len);
+         if ((len > 0) && (line[len - 1] == '\r'))
+            len--;
+         line[len] = 0;
+         worker->bufferSize -= eol - worker->buffer + 1;
+         memmove(worker->buffer, eol + 1, worker->bufferSize);
+         return true;
+      }
+
+      if (worker->bufferSize == WORKER_BUFFER_SIZE)
+      {
+         nxlog_debug_tag(DEBUG_TAG, 5, _T("Response line from worker process %d is too long"), (int)worker->pid);
+         return false;
+      }
+
+      INT64 timeout = deadline - GetCurrentTimeMs();
+      if (timeout <= 0)
+      {
+         nxlog_debug_tag(DEBUG_TAG, 5, _T("Timeout waiting for response from worker process %d"), (int)worker->pid);
+         return false;
+      }
+
+      struct pollfd pfd;
+      pfd.fd = worker->output;
+      pfd.events = POLLIN;
+      int rc = poll(&pfd, 1, static_cast<int>(timeout));
+      if (rc < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         nxlog_debug_tag(DEBUG_TAG, 5, _T("poll() call failed for worker process %d (%s)"), (int)worker->pid, _tcserror(errno));
+         return false;
+      }
+      if (rc == 0)
+         continue;   // deadline will be checked on next iteration
+
+      ssize_t bytes = read(worker->output, &worker->buffer[worker->bufferSize], WORKER_BUFFER_SIZE - worker->bufferSize);
+      if (bytes < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         nxlog_debug_tag(DEBUG_TAG, 5, _T("Cannot read response from worker process %d (%s)"), (int)worker->pid, _tcserror(errno));
+         return false;
+      }
+      if (bytes == 0)
+      {
+         nxlog_debug_tag(DEBUG_TAG, 5, _T("Worker process %d closed its output"), (int)worker->pid);
+         return false;
+      }
+      worker->bufferSize += bytes;
+   }
+}
+
+#else /* _WIN32 */
+
+/**
+ * Start new worker process (persistent workers are not supported on Windows yet)
+ */
+static ExternalProcessWorker *SpawnWorker(const TCHAR *command)
+{
+   nxlog_debug_tag(DEBUG_TAG, 4, _T("SpawnWorker(%s): persistent external processes are not supported on this platform"), command);
+   return NULL;
+}
+
+/**
+ * Stop worker process and destroy worker object
+ */
+static void DestroyWorker(ExternalProcessWorker *worker, bool graceful)
+{
+   delete worker;
+}
+
+/**
+ * Send request line to worker
+ */
+static bool WriteRequest(ExternalProcessWorker *worker, const char *data, size_t size)
+{
+   return false;
+}
+
+/**
+ * Read single line from worker
+ */
+static bool ReadLine(ExternalProcessWorker *worker, char *line, INT64 deadline)
+{
+   return false;
+}
+
+#endif /* _WIN32 */
+
+/**
+ * Read response from worker. Returns false on protocol violation or communication failure.
+ */
+static bool ReadResponse(ExternalProcessWorker *worker, StringList *output, INT64 deadline, LONG *rc)
+{
+   char line[WORKER_BUFFER_SIZE + 1];
+   while(ReadLine(worker, line, deadline))
+   {
+      if (line[0] != '.')
+      {
+         output->addMBString(line);
+         continue;
+      }
+
+      if (line[1] == '.')
+      {
+         output->addMBString(&line[1]);
+         continue;
+      }
+
+      if (!strcmp(&line[1], "OK"))
+      {
+         *rc = SYSINFO_RC_SUCCESS;
+      }
+      else if (!strcmp(&line[1], "UNSUPPORTED"))
+      {
+         *rc = SYSINFO_RC_UNSUPPORTED;
+      }
+      else if (!strncmp(&line[1], "ERROR", 5) && ((line[6] == 0) || (line[6] == ' ')))
+      {
+         *rc = SYSINFO_RC_ERROR;
+         if (line[6] != 0)
+            nxlog_debug_tag(DEBUG_TAG, 5, _T("Worker process %d reported error: %hs"), (int)worker->pid, &line[7]);
+      }
+      else
+      {
+         nxlog_debug_tag(DEBUG_TAG, 5, _T("Invalid status line from worker process %d"), (int)worker->pid);
+         return false;
+      }
+      return true;
+   }
+   return false;
+}
+
+/**
+ * Create pool
+ */
+ExternalProcessPool::ExternalProcessPool(const TCHAR *command, int maxWorkers) : m_idleWorkers(maxWorkers, 8, Ownership::False)
+{
+   m_command = MemCopyString(command);
+   m_maxWorkers = maxWorkers;
+   m_workerCount = 0;
+   m_workerReleased = ConditionCreate(false);
+   m_failures = 0;
+   m_restartBlockedUntil = 0;
+   m_shutdown = false;
+}
+
+/**
+ * Destroy pool
+ */
+ExternalProcessPool::~ExternalProcessPool()
+{
+   shutdown();
+   ConditionDestroy(m_workerReleased);
+   MemFree(m_command);
+}
+
+/**
+ * Register worker failure. After several consecutive failures restarts are delayed with
+ * increasing interval to avoid fork storm from constantly crashing worker. Pool mutex must
+ * be held by caller.
+ */
+void ExternalProcessPool::registerFailure()
+{
+   m_failures++;
+   if (m_failures >= 3)
+      m_restartBlockedUntil = time(NULL) + std::min(1 << std::min(m_failures - 3, 6), 60);
+}
+
+/**
+ * Get idle worker or start new one. Waits for other requests to complete if pool is exhausted.
+ */
+ExternalProcessWorker *ExternalProcessPool::acquireWorker(INT64 deadline, bool *reused)
+{
+   ExternalProcessWorker *worker = NULL;
+   m_mutex.lock();
+   while(!m_shutdown)
+   {
+      if (!m_idleWorkers.isEmpty())
+      {
+         worker = m_idleWorkers.get(m_idleWorkers.size() - 1);
+         m_idleWorkers.remove(m_idleWorkers.size() - 1);
+         *reused = true;
+         break;
+      }
+
+      if (m_workerCount < m_maxWorkers)
+      {
+         if (time(NULL) < m_restartBlockedUntil)
+         {
+            nxlog_debug_tag(DEBUG_TAG, 6, _T("Restart of worker processes for \"%s\" is suspended after repeated failures"), m_command);
+            break;
+         }
+
+         m_workerCount++;
+         m_mutex.unlock();
+         worker = SpawnWorker(m_command);
+         m_mutex.lock();
+         if (worker == NULL)
+         {
+            m_workerCount--;
+            registerFailure();
+         }
+         *reused = false;
+         break;
+      }
+
+      INT64 timeout = deadline - GetCurrentTimeMs();
+      if (timeout <= 0)
+      {
+         nxlog_debug_tag(DEBUG_TAG, 5, _T("Timeout waiting for free worker process for \"%s\""), m_command);
+         break;
+      }
+      m_mutex.unlock();
+      ConditionWait(m_workerReleased, static_cast<UINT32>(timeout));
+      m_mutex.lock();
+   }
+   m_mutex.unlock();
+   return worker;
+}
+
+/**
+ * Return worker to the pool. Failed worker is stopped and will be replaced by new process on demand.
+ */
+void ExternalProcessPool::releaseWorker(ExternalProcessWorker *worker, bool success)
+{
+   m_mutex.lock();
+   if (success)
+   {
+      m_failures = 0;
+      if (!m_shutdown)
+      {
+         m_idleWorkers.add(worker);
+         worker = NULL;
+      }
+   }
+   else
+   {
+      registerFailure();
+   }
+   m_mutex.unlock();
+
+   if (worker != NULL)
+   {
+      DestroyWorker(worker, false);
+      m_mutex.lock();
+      m_workerCount--;
+      m_mutex.unlock();
+   }
+   ConditionSet(m_workerReleased);
+}
+
+/**
+ * Execute request using one of pool's workers. Request should not contain line terminators.
+ * Data lines from response are added to output list.
+ */
+LONG ExternalProcessPool::execute(const TCHAR *request, StringList *output, UINT32 timeout)
+{
+   INT64 deadline = GetCurrentTimeMs() + timeout;
+
+#ifdef UNICODE
+   char *line = MBStringFromWideStringSysLocale(request);
+#else
+   char *line = MemCopyStringA(request);
+#endif
+   size_t len = strlen(line);
+   line = MemRealloc(line, len + 2);
+   line[len++] = '\n';
+   line[len] = 0;
+
+   LONG rc = SYSINFO_RC_ERROR;
+   while(true)
+   {
+      bool reused;
+      ExternalProcessWorker *worker = acquireWorker(deadline, &reused);
+      if (worker == NULL)
+         break;
+
+      if (!WriteRequest(worker, line, len))
+      {
+         // Idle worker may have exited since last request, retry with new process in that case
+         nxlog_debug_tag(DEBUG_TAG, 4, _T("Worker process %d for \"%s\" is not accepting requests and will be restarted"), (int)worker->pid, m_command);
+         releaseWorker(worker, false);
+         if (reused)
+            continue;
+         break;
+      }
+
+      worker->requests++;
+      if (ReadResponse(worker, output, deadline, &rc))
+      {
+         releaseWorker(worker, true);
+      }
+      else
+      {
+         nxlog_write(NXLOG_WARNING, _T("Worker process %d for \"%s\" failed to process request and will be restarted"), (int)worker->pid, m_command);
+         output->clear();
+         rc = SYSINFO_RC_ERROR;
+         releaseWorker(worker, false);
+      }
+      break;
+   }
+
+   MemFree(line);
+   return rc;
+}
+
+/**
+ * Stop all idle workers and disable further requests. Workers which are busy will be stopped
+ * when current request completes.
+ */
+void ExternalProcessPool::shutdown()
+{
+   m_mutex.lock();
+   m_shutdown = true;
+   ObjectArray<ExternalProcessWorker> workers(m_idleWorkers.size(), 8, Ownership::False);
+   for(int i = 0; i < m_idleWorkers.size(); i++)
+      workers.add(m_idleWorkers.get(i));
+   m_idleWorkers.clear();
+   m_workerCount -= workers.size();
+   m_mutex.unlock();
+
+   for(int i = 0; i < workers.size(); i++)
+      DestroyWorker(workers.get(i), true);
+   ConditionSet(m_workerReleased);
+}
+
+/**
+ * Registered pools
+ */
+static ObjectArray<ExternalProcessPool> s_pools(8, 8, Ownership::True);
+static Mutex s_poolsLock;
+
+/**
+ * Get pool for given command, creating new one if needed. Pools are shared by all users of same command.
+ */
+ExternalProcessPool *GetExternalProcessPool(const TCHAR *command)
+{
+   ExternalProcessPool *pool = NULL;
+   s_poolsLock.lock();
+   for(int i = 0; i < s_pools.size(); i++)
+   {
+      if (!_tcscmp(s_pools.get(i)->getCommand(), command))
+      {
+         pool = s_pools.get(i);
+         break;
+      }
+   }
+   if (pool == NULL)
+   {
+      pool = new ExternalProcessPool(command, std::max(static_cast<int>(g_externalProcessPoolSize), 1));
+      s_pools.add(pool);
+      nxlog_debug_tag(DEBUG_TAG, 3, _T("Created external process pool for \"%s\""), command);
+   }
+   s_poolsLock.unlock();
+   return pool;
+}
+
+/**
+ * Stop all persistent external processes. Pool objects are kept because parameter handlers may still refer to them.
+ */
+void ShutdownExternalProcessPools()
+{
+   s_poolsLock.lock();
+   for(int i = 0; i < s_pools.size(); i++)
+      s_pools.get(i)->shutdown();
+   s_poolsLock.unlock();
+}
@@ -47,6 +47,7 @@ LONG H_HostName(const TCHAR *cmd, const TCHAR *arg, TCHAR *value, AbstractCommSe
 LONG H_IsExtSubagentConnected(const TCHAR *pszCmd, const TCHAR *pArg, TCHAR *pValue, AbstractCommSession *session);
 LONG H_IsSubagentLoaded(const TCHAR *cmd, const TCHAR *arg, TCHAR *value, AbstractCommSession *session);
 LONG H_MD5Hash(const TCHAR *cmd, const TCHAR *arg, TCHAR *value, AbstractCommSession *session);
+LONG H_PersistentExternalParameter(const TCHAR *cmd, const TCHAR *arg, TCHAR *value, AbstractCommSession *session);
 LONG H_PlatformName(const TCHAR *cmd, const TCHAR *arg, TCHAR *value, AbstractCommSession *session);
 LONG H_PushValue(const TCHAR *cmd, const TCHAR *arg, TCHAR *value, AbstractCommSession *session);
 LONG H_PushValues(const TCHAR *cmd, const TCHAR *arg, StringList *value, AbstractCommSession *session);
@@ -691,6 +692,26 @@ bool AddExternalParameter(TCHAR *config, bool shellExec, bool isList)
    return true;
 }
 
+/**
+ * Add external parameter served by pool of persistent processes
+ */
+bool AddPersistentExternalParameter(TCHAR *config)
+{
+   TCHAR *cmdLine = _tcschr(config, _T(':'));
+   if (cmdLine == NULL)
+      return false;
+
+   *cmdLine = 0;
+   cmdLine++;
+   Trim(config);
+   Trim(cmdLine);
+   if ((*config == 0) || (*cmdLine == 0))
+      return false;
+
+   AddParameter(config, H_PersistentExternalParameter, (const TCHAR *)GetExternalProcessPool(cmdLine), DCI_DT_STRING, _T(""));
+   return true;
+}
+
 /**
  * Add external table
  */
@@ -84,6 +84,102 @@ static void H_GetList(NXCPMessage *pRequest, NXCPMessage *pMsg)
    }
 }
 
+/**
+ * Maximum number of additional pool tasks used to evaluate single CMD_GET_PARAMETERS request
+ */
+#define MAX_BATCH_WORKERS   7
+
+/**
+ * Pool for processing data requests from master agent
+ */
+static ThreadPool *s_requestPool = NULL;
+
+/**
+ * Parameter batch evaluation state shared between request processing thread and helper tasks
+ */
+class ParameterBatch : public RefCountObject
+{
+protected:
+   virtual ~ParameterBatch()
+   {
+      MemFree(names);
+      MemFree(values);
+      MemFree(rcc);
+   }
+
+public:
+   int count;
+   TCHAR (*names)[MAX_RUNTIME_PARAM_NAME];
+   TCHAR (*values)[MAX_RESULT_LENGTH];
+   UINT32 *rcc;
+   VolatileCounter next;
+   VolatileCounter pending;
+   Condition completed;
+
+   ParameterBatch(int _count) : RefCountObject(), completed(true)
+   {
+      count = _count;
+      names = MemAllocArrayNoInit<TCHAR[MAX_RUNTIME_PARAM_NAME]>(std::max(count, 1));
+      values = MemAllocArrayNoInit<TCHAR[MAX_RESULT_LENGTH]>(std::max(count, 1));
+      rcc = MemAllocArray<UINT32>(std::max(count, 1));
+      next = 0;
+      pending = count;
+      if (count == 0)
+         completed.set();
+   }
+
+   void process()
+   {
+      VirtualSession session(0);
+      int index;
+      while((index = InterlockedIncrement(&next) - 1) < count)
+      {
+         rcc[index] = GetParameterValue(names[index], values[index], &session);
+         if (InterlockedDecrement(&pending) == 0)
+            completed.set();
+      }
+   }
+};
+
+/**
+ * Helper task for parameter batch evaluation
+ */
+static void ProcessParameterBatch(ParameterBatch *batch)
+{
+   batch->process();
+   batch->decRefCount();
+}
+
+/**
+ * Handler for CMD_GET_PARAMETERS command (multiple parameters in one request). Parameters
+ * are evaluated in parallel by calling thread and helper tasks.
+ */
+static void H_GetParameters(NXCPMessage *request, NXCPMessage *response)
+{
+   ParameterBatch *batch = new ParameterBatch(request->getFieldAsInt32(VID_NUM_PARAMETERS));
+   for(int i = 0; i < batch->count; i++)
+      request->getFieldAsString(VID_PARAM_LIST_BASE + i, batch->names[i], MAX_RUNTIME_PARAM_NAME);
+
+   int workers = std::min(batch->count - 1, MAX_BATCH_WORKERS);
+   for(int i = 0; i < workers; i++)
+   {
+      batch->incRefCount();
+      ThreadPoolExecute(s_requestPool, ProcessParameterBatch, batch);
+   }
+   batch->process();
+   batch->completed.wait(INFINITE);
+
+   UINT32 fieldId = VID_PARAM_LIST_BASE;
+   for(int i = 0; i < batch->count; i++, fieldId += 2)
+   {
+      response->setField(fieldId, batch->rcc[i]);
+      if (batch->rcc[i] == ERR_SUCCESS)
+         response->setField(fieldId + 1, batch->values[i]);
+   }
+   response->setField(VID_RCC, ERR_SUCCESS);
+   batch->decRefCount();
+}
+
 /**
  * Execute action
  */
@@ -115,6 +211,33 @@ void ExecuteAction(const TCHAR *cmd, const StringList *args)
  * Pipe to master agent
  */
 static NamedPipe *s_pipe = NULL;
+static Mutex s_pipeLock;
+
+/**
+ * Process data collection request from master agent. Such requests are processed in parallel,
+ * and master agent correlates responses by request ID.
+ */
+static void ProcessDataRequest(NXCPMessage *request)
+{
+   NXCPMessage response(CMD_REQUEST_COMPLETED, request->getId());
+   switch(request->getCode())
+   {
+      case CMD_GET_PARAMETER:
+         H_GetParameter(request, &response);
+         break;
+      case CMD_GET_PARAMETERS:
+         H_GetParameters(request, &response);
+         break;
+      case CMD_GET_TABLE:
+         H_GetTable(request, &response);
+         break;
+      case CMD_GET_LIST:
+         H_GetList(request, &response);
+         break;
+   }
+   delete request;
+   SendMessageToMasterAgent(&response);
+}
 
 /**
  * Listener thread for master agent commands
@@ -130,6 +253,7 @@ THREAD_RESULT THREAD_CALL MasterAgentListener(void *arg)
       if (s_pipe != NULL)
       {
 			AgentWriteDebugLog(1, _T("Connected to master agent"));
+         s_requestPool = ThreadPoolCreate(_T("MASTERREQ"), 1, 16);
 
          PipeMessageReceiver receiver(s_pipe->handle(), 8192, 1048576);  // 8K initial, 1M max
 			while(!(g_dwFlags & AF_SHUTDOWN))
@@ -153,20 +277,18 @@ THREAD_RESULT THREAD_CALL MasterAgentListener(void *arg)
             TCHAR buffer[256];
 				AgentWriteDebugLog(6, _T("Received message %s from master agent"), NXCPMessageCodeName(msg->getCode(), buffer));
 
+				if ((msg->getCode() == CMD_GET_PARAMETER) || (msg->getCode() == CMD_GET_PARAMETERS) ||
+				    (msg->getCode() == CMD_GET_TABLE) || (msg->getCode() == CMD_GET_LIST))
+				{
+				   ThreadPoolExecute(s_requestPool, ProcessDataRequest, msg);
+				   continue;
+				}
+
 				NXCPMessage response;
 				response.setCode(CMD_REQUEST_COMPLETED);
 				response.setId(msg->getId());
 				switch(msg->getCode())
 				{
-					case CMD_GET_PARAMETER:
-						H_GetParameter(msg, &response);
-						break;
-					case CMD_GET_TABLE:
-						H_GetTable(msg, &response);
-						break;
-					case CMD_GET_LIST:
-						H_GetList(msg, &response);
-						break;
                case CMD_EXECUTE_ACTION:
                   ExecuteAction(msg, &response, new ProxySession(msg));
                   break;
@@ -205,13 +327,17 @@ THREAD_RESULT THREAD_CALL MasterAgentListener(void *arg)
 				delete msg;
 
 				// Send response to pipe
-				NXCP_MESSAGE *rawMsg = response.serialize();
-            bool sendSuccess = s_pipe->write(rawMsg, ntohl(rawMsg->size));
-            free(rawMsg);
-            if (!sendSuccess)
+            if (!SendMessageToMasterAgent(&response))
                break;
 			}
+
+			// Wait for outstanding requests before closing pipe
+			ThreadPoolDestroy(s_requestPool);
+			s_requestPool = NULL;
+
+			s_pipeLock.lock();
 			delete_and_null(s_pipe);
+			s_pipeLock.unlock();
 			AgentWriteDebugLog(1, _T("Disconnected from master agent"));
 		}
 		else
@@ -240,7 +366,8 @@ bool SendMessageToMasterAgent(NXCPMessage *msg)
  */
 bool SendRawMessageToMasterAgent(NXCP_MESSAGE *msg)
 {
-   if (s_pipe == NULL)
-      return false;
-   return s_pipe->write(msg, ntohl(msg->size));
+   s_pipeLock.lock();
+   bool success = (s_pipe != NULL) ? s_pipe->write(msg, ntohl(msg->size)) : false;
+   s_pipeLock.unlock();
+   return success;
 }
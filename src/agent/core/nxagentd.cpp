@@ -190,6 +190,7 @@ TCHAR g_systemName[MAX_OBJECT_NAME] = _T("");
 ObjectArray<ServerInfo> g_serverList(8, 8, Ownership::True);
 UINT32 g_execTimeout = 2000;     // External process execution timeout in milliseconds
 UINT32 g_eppTimeout = 30;      // External parameter processor timeout in seconds
+UINT32 g_externalProcessPoolSize = 2;  // Maximum number of persistent worker processes per command
 UINT32 g_snmpTimeout = 0;
 UINT16 g_snmpTrapPort = 162;
 time_t g_tmAgentStartTime;
@@ -202,6 +203,7 @@ UINT32 g_dcWriterFlushInterval = 5000;
 UINT32 g_dcWriterMaxTransactionSize = 10000;
 UINT32 g_dcMaxCollectorPoolSize = 64;
 UINT32 g_dcOfflineExpirationTime = 10; // 10 days
+UINT64 g_dcOfflineSegmentSize = 4 * 1024 * 1024;
 UINT32 g_zoneUIN = 0;
 UINT32 g_tunnelKeepaliveInterval = 30;
 UINT16 g_syslogListenPort = 514;
@@ -229,6 +231,8 @@ static TCHAR *m_pszSubagentList = NULL;
 static TCHAR *s_externalParametersConfig = NULL;
 static TCHAR *s_externalShellExecParametersConfig = NULL;
 static TCHAR *s_externalParameterProvidersConfig = NULL;
+static TCHAR *s_persistentExternalParametersConfig = NULL;
+static TCHAR *s_persistentExternalParameterProvidersConfig = NULL;
 static TCHAR *s_externalListsConfig = NULL;
 static TCHAR *s_externalTablesConfig = NULL;
 static TCHAR *s_externalSubAgentsList = NULL;
@@ -300,9 +304,12 @@ static NX_CFG_TEMPLATE m_cfgTemplate[] =
    { _T("ExternalList"), CT_STRING_LIST, '\n', 0, 0, 0, &s_externalListsConfig, NULL },
    { _T("ExternalMasterAgent"), CT_STRING, 0, 0, MAX_PATH, 0, g_masterAgent, NULL },
    { _T("ExternalParameter"), CT_STRING_LIST, '\n', 0, 0, 0, &s_externalParametersConfig, NULL },
+   { _T("ExternalParameterPersistent"), CT_STRING_LIST, '\n', 0, 0, 0, &s_persistentExternalParametersConfig, NULL },
    { _T("ExternalParameterShellExec"), CT_STRING_LIST, '\n', 0, 0, 0, &s_externalShellExecParametersConfig, NULL },
    { _T("ExternalParametersProvider"), CT_STRING_LIST, '\n', 0, 0, 0, &s_externalParameterProvidersConfig, NULL },
+   { _T("ExternalParametersProviderPersistent"), CT_STRING_LIST, '\n', 0, 0, 0, &s_persistentExternalParameterProvidersConfig, NULL },
    { _T("ExternalParameterProviderTimeout"), CT_LONG, 0, 0, 0, 0, &g_eppTimeout, NULL },
+   { _T("ExternalProcessPoolSize"), CT_LONG, 0, 0, 0, 0, &g_externalProcessPoolSize, NULL },
    { _T("ExternalSubagent"), CT_STRING_LIST, '\n', 0, 0, 0, &s_externalSubAgentsList, NULL },
    { _T("ExternalTable"), CT_STRING_LIST, '\n', 0, 0, 0, &s_externalTablesConfig, NULL },
    { _T("FileStore"), CT_STRING, 0, 0, MAX_PATH, 0, g_szFileStore, NULL },
@@ -318,6 +325,7 @@ static NX_CFG_TEMPLATE m_cfgTemplate[] =
    { _T("MaxLogSize"), CT_SIZE_BYTES, 0, 0, 0, 0, &s_maxLogSize, NULL },
    { _T("MaxSessions"), CT_LONG, 0, 0, 0, 0, &g_dwMaxSessions, NULL },
    { _T("OfflineDataExpirationTime"), CT_LONG, 0, 0, 0, 0, &g_dcOfflineExpirationTime, NULL },
+   { _T("OfflineDataSegmentSize"), CT_SIZE_BYTES, 0, 0, 0, 0, &g_dcOfflineSegmentSize, NULL },
    { _T("PlatformSuffix"), CT_STRING, 0, 0, MAX_PSUFFIX_LENGTH, 0, g_szPlatformSuffix, NULL },
    { _T("RequireAuthentication"), CT_BOOLEAN, 0, 0, AF_REQUIRE_AUTH, 0, &g_dwFlags, NULL },
    { _T("RequireEncryption"), CT_BOOLEAN, 0, 0, AF_REQUIRE_ENCRYPTION, 0, &g_dwFlags, NULL },
@@ -1146,6 +1154,19 @@ BOOL Initialize()
       }
       MemFree(s_externalShellExecParametersConfig);
    }
+   if (s_persistentExternalParametersConfig != NULL)
+   {
+      for(pItem = pEnd = s_persistentExternalParametersConfig; pEnd != NULL && *pItem != 0; pItem = pEnd + 1)
+      {
+         pEnd = _tcschr(pItem, _T('\n'));
+         if (pEnd != NULL)
+            *pEnd = 0;
+         Trim(pItem);
+         if (!AddPersistentExternalParameter(pItem))
+            nxlog_write(NXLOG_WARNING, _T("Unable to add external parameter \"%s\""), pItem);
+      }
+      MemFree(s_persistentExternalParametersConfig);
+   }
 
    // Parse external lists
    if (s_externalListsConfig != NULL)
@@ -1186,11 +1207,24 @@ BOOL Initialize()
          if (pEnd != NULL)
             *pEnd = 0;
          Trim(pItem);
-         if (!AddParametersProvider(pItem))
+         if (!AddParametersProvider(pItem, false))
             nxlog_write(NXLOG_WARNING, _T("Unable to add external parameters provider \"%s\""), pItem);
       }
       MemFree(s_externalParameterProvidersConfig);
    }
+   if (s_persistentExternalParameterProvidersConfig != NULL)
+   {
+      for(pItem = pEnd = s_persistentExternalParameterProvidersConfig; pEnd != NULL && *pItem != 0; pItem = pEnd + 1)
+      {
+         pEnd = _tcschr(pItem, _T('\n'));
+         if (pEnd != NULL)
+            *pEnd = 0;
+         Trim(pItem);
+         if (!AddParametersProvider(pItem, true))
+            nxlog_write(NXLOG_WARNING, _T("Unable to add external parameters provider \"%s\""), pItem);
+      }
+      MemFree(s_persistentExternalParameterProvidersConfig);
+   }
 
 	if (!(g_dwFlags & AF_SUBAGENT_LOADER))
 	{
@@ -1416,6 +1450,7 @@ void Shutdown()
    }
    ThreadPoolDestroy(g_executorThreadPool);
 
+   ShutdownExternalProcessPools();
    UnloadAllSubAgents();
    CloseLocalDatabase();
    nxlog_report_event(2, NXLOG_INFO, 0, _T("NetXMS Agent stopped"));
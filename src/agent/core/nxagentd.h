@@ -190,6 +190,8 @@ struct SUBAGENT
    TCHAR szName[MAX_PATH];        // Name of the module  // to TCHAR by LWX
 };
 
+struct ExtSubagentParameterRequest;
+
 /**
  * External subagent information
  */
@@ -202,18 +204,28 @@ class ExternalSubagent
 	NamedPipe *m_pipe;
 	bool m_connected;
 	MsgWaitQueue *m_msgQueue;
-	UINT32 m_requestId;
-
+	VolatileCounter m_requestId;
+   Mutex m_requestLock;
+   CONDITION m_slotReleased;
+   int m_maxActiveRequests;
+   int m_activeRequests;
+   ObjectArray<ExtSubagentParameterRequest> m_pendingParameters;
+   bool m_batchSupported;
+
+   UINT32 nextRequestId() { return static_cast<UINT32>(InterlockedIncrement(&m_requestId)); }
 	bool sendMessage(const NXCPMessage *msg);
 	NXCPMessage *waitForMessage(WORD code, UINT32 id);
 	UINT32 waitForRCC(UINT32 id);
+   bool acquireRequestSlot(UINT32 timeout);
+   void releaseRequestSlot();
+   void executeParameterBatch(ObjectArray<ExtSubagentParameterRequest> *batch);
 	NETXMS_SUBAGENT_PARAM *getSupportedParameters(UINT32 *count);
 	NETXMS_SUBAGENT_LIST *getSupportedLists(UINT32 *count);
 	NETXMS_SUBAGENT_TABLE *getSupportedTables(UINT32 *count);
 	ACTION *getSupportedActions(UINT32 *count);
 
 public:
-	ExternalSubagent(const TCHAR *name, const TCHAR *user);
+	ExternalSubagent(const TCHAR *name, const TCHAR *user, int maxActiveRequests);
 	~ExternalSubagent();
 
 	void startListener();
@@ -221,6 +233,7 @@ class ExternalSubagent
 	void connect(NamedPipe *pipe);
 
 	bool isConnected() { return m_connected; }
+   int getActiveRequestCount() { return m_activeRequests; }
 	const TCHAR *getName() { return m_name; }
 	const TCHAR *getUserName() { return m_user; }
 
@@ -675,6 +688,98 @@ class DataCollectionProxy
    UINT32 getProxyId() const { return m_proxyId; }
 };
 
+/**
+ * Position in offline data queue
+ */
+struct OfflineDataQueuePosition
+{
+   UINT32 segment;
+   UINT32 offset;
+};
+
+/**
+ * Segmented append-only store for data collected while server is not reachable. Each server
+ * has its own queue with persistent read cursor. Every record is protected by CRC, and segment
+ * files are deleted as a whole once all records in them are acknowledged.
+ */
+class OfflineDataQueue : public RefCountObject
+{
+private:
+   UINT64 m_serverId;
+   TCHAR m_path[MAX_PATH];
+   Mutex m_mutex;
+   UINT32 m_firstSegment;
+   UINT32 m_writeSegment;
+   UINT32 m_writeOffset;
+   int m_writeHandle;
+   BYTE *m_writeBuffer;
+   size_t m_writeBufferSize;
+   size_t m_writeBufferAllocated;
+   int m_bufferedRecords;
+   OfflineDataQueuePosition m_readPosition;
+   int m_readHandle;
+   UINT32 m_readHandleSegment;
+   INT32 m_size;
+   bool m_destroyed;
+
+   void getSegmentFileName(UINT32 segment, TCHAR *fileName);
+   UINT32 scanSegment(UINT32 segment, UINT32 offset, bool validate, INT32 *count);
+   bool flushBuffer(bool sync);
+   void closeReadHandle();
+   void saveReadPosition();
+
+protected:
+   virtual ~OfflineDataQueue();
+
+public:
+   OfflineDataQueue(UINT64 serverId);
+
+   bool open();
+   void append(const BYTE *data, size_t size);
+   void flush(bool sync = false);
+   ByteStream *read(OfflineDataQueuePosition *position);
+   void acknowledge(const OfflineDataQueuePosition& position, int count);
+   void destroy();
+
+   UINT64 getServerId() const { return m_serverId; }
+   INT32 getSize();
+   OfflineDataQueuePosition getReadPosition();
+};
+
+struct ExternalProcessWorker;
+
+/**
+ * Supervisor for pool of persistent external processes. Each worker reads requests from its
+ * standard input one line at a time and writes response to standard output. Workers which
+ * crash, hang, or violate protocol are killed and replaced on next request.
+ */
+class ExternalProcessPool
+{
+private:
+   TCHAR *m_command;
+   int m_maxWorkers;
+   int m_workerCount;
+   ObjectArray<ExternalProcessWorker> m_idleWorkers;
+   Mutex m_mutex;
+   CONDITION m_workerReleased;
+   int m_failures;
+   time_t m_restartBlockedUntil;
+   bool m_shutdown;
+
+   void registerFailure();
+   ExternalProcessWorker *acquireWorker(INT64 deadline, bool *reused);
+   void releaseWorker(ExternalProcessWorker *worker, bool success);
+
+public:
+   ExternalProcessPool(const TCHAR *command, int maxWorkers);
+   ~ExternalProcessPool();
+
+   LONG execute(const TCHAR *request, StringList *output, UINT32 timeout);
+   void shutdown();
+
+   const TCHAR *getCommand() const { return m_command; }
+};
+
 /**
  * Functions
  */
@@ -700,6 +805,7 @@ void AddTable(const TCHAR *name, LONG (* handler)(const TCHAR *, const TCHAR *,
               const TCHAR *arg, const TCHAR *instanceColumns, const TCHAR *description,
               int numColumns, NETXMS_SUBAGENT_TABLE_COLUMN *columns);
 bool AddExternalParameter(TCHAR *config, bool shellExec, bool isList);
+bool AddPersistentExternalParameter(TCHAR *config);
 bool AddExternalTable(TCHAR *config, bool shellExec);
 UINT32 GetParameterValue(const TCHAR *param, TCHAR *value, AbstractCommSession *session);
 UINT32 GetListValue(const TCHAR *param, StringList *value, AbstractCommSession *session);
@@ -720,8 +826,11 @@ BOOL AddActionFromConfig(TCHAR *pszLine, BOOL bShellExec);
 UINT32 ExecuteCommand(TCHAR *pszCommand, const StringList *pArgs, pid_t *pid);
 UINT32 ExecuteShellCommand(TCHAR *pszCommand, const StringList *pArgs);
 
+ExternalProcessPool *GetExternalProcessPool(const TCHAR *command);
+void ShutdownExternalProcessPools();
+
 void StartParamProvidersPoller();
-bool AddParametersProvider(const TCHAR *line);
+bool AddParametersProvider(const TCHAR *line, bool persistent);
 LONG GetParameterValueFromExtProvider(const TCHAR *name, TCHAR *buffer);
 void ListParametersFromExtProviders(NXCPMessage *msg, UINT32 *baseId, UINT32 *count);
 void ListParametersFromExtProviders(StringList *list);
@@ -1119,3 +1119,192 @@ void LIBNXDB_EXPORTABLE DBResultToTable(DB_RESULT hResult, Table *table)
       }
    }
 }
+
+/**
+ * Get name of time partition of given table. Partition name is built from base table
+ * name and start time of partition's period.
+ */
+TCHAR LIBNXDB_EXPORTABLE *DBGetTimePartitionName(const TCHAR *table, INT64 start, TCHAR *buffer, size_t size)
+{
+   _sntprintf(buffer, size, _T("%s_p") INT64_FMT, table, start);
+   return buffer;
+}
+
+/**
+ * Compare partition start times
+ */
+static int ComparePartitions(const void *p1, const void *p2)
+{
+   INT64 s1 = *static_cast<const INT64*>(p1);
+   INT64 s2 = *static_cast<const INT64*>(p2);
+   return (s1 < s2) ? -1 : ((s1 > s2) ? 1 : 0);
+}
+
+/**
+ * Get start times of existing time partitions of given table in ascending order.
+ * Only SQLite and PostgreSQL are supported. Returns NULL on failure.
+ */
+IntegerArray<INT64> LIBNXDB_EXPORTABLE *DBGetTimePartitions(DB_HANDLE hdb, const TCHAR *table)
+{
+   TCHAR query[512];
+   switch(DBGetSyntax(hdb))
+   {
+      case DB_SYNTAX_PGSQL:
+         _sntprintf(query, 512, _T("SELECT table_name FROM information_schema.tables WHERE table_catalog=current_database() AND table_schema=current_schema() AND table_type='BASE TABLE' AND lower(table_name) LIKE lower('%s_p%%')"), table);
+         break;
+      case DB_SYNTAX_SQLITE:
+         _sntprintf(query, 512, _T("SELECT name FROM sqlite_master WHERE type='table' AND lower(name) LIKE lower('%s_p%%')"), table);
+         break;
+      default:
+         return NULL;
+   }
+
+   DB_RESULT hResult = DBSelect(hdb, query);
+   if (hResult == NULL)
+      return NULL;
+
+   IntegerArray<INT64> *partitions = new IntegerArray<INT64>(64, 64);
+   size_t prefixLen = _tcslen(table) + 2;
+   int count = DBGetNumRows(hResult);
+   for(int i = 0; i < count; i++)
+   {
+      TCHAR name[256];
+      DBGetField(hResult, i, 0, name, 256);
+
+      // LIKE pattern may match other tables, check that suffix is a number
+      if ((_tcslen(name) <= prefixLen) || _tcsnicmp(name, table, prefixLen - 2) ||
+          (name[prefixLen - 2] != _T('_')) || ((name[prefixLen - 1] != _T('p')) && (name[prefixLen - 1] != _T('P'))))
+         continue;
+      TCHAR *eptr;
+      INT64 start = _tcstoll(&name[prefixLen], &eptr, 10);
+      if (*eptr == 0)
+         partitions->add(start);
+   }
+   DBFreeResult(hResult);
+
+   partitions->sort(ComparePartitions);
+   return partitions;
+}
+
+/**
+ * Find time partition for given timestamp (partition with largest start time not exceeding
+ * given timestamp). Partition list should be sorted in ascending order.
+ *
+ * @return partition index or -1 if timestamp is before start of first partition
+ */
+int LIBNXDB_EXPORTABLE DBFindTimePartition(const IntegerArray<INT64> *partitions, INT64 timestamp)
+{
+   int l = 0, r = partitions->size() - 1, result = -1;
+   while(l <= r)
+   {
+      int m = (l + r) / 2;
+      if (partitions->get(m) <= timestamp)
+      {
+         result = m;
+         l = m + 1;
+      }
+      else
+      {
+         r = m - 1;
+      }
+   }
+   return result;
+}
+
+/**
+ * Maximum number of partitions combined by single compound SELECT (SQLite limits number of
+ * terms in compound SELECT to 500 by default)
+ */
+#define MAX_UNION_TERMS    250
+
+/**
+ * Append UNION ALL of given partitions to query
+ */
+static void AppendPartitionUnion(StringBuffer *query, const TCHAR *table, const IntegerArray<INT64> *partitions, int from, int to)
+{
+   for(int i = from; i < to; i++)
+   {
+      TCHAR name[256];
+      if (i > from)
+         query->append(_T(" UNION ALL "));
+      query->append(_T("SELECT * FROM "));
+      query->append(DBGetTimePartitionName(table, partitions->get(i), name, 256));
+   }
+}
+
+/**
+ * Re-create view which combines all time partitions of given table. View has same name as
+ * base table, so queries which do not need partition routing can use it as regular table.
+ * Existing view is kept if new one cannot be created. Large partition sets are combined
+ * in groups to stay within compound SELECT limits.
+ */
+bool LIBNXDB_EXPORTABLE DBRebuildTimePartitionView(DB_HANDLE hdb, const TCHAR *table, const IntegerArray<INT64> *partitions)
+{
+   StringBuffer query;
+   if (partitions->isEmpty())
+   {
+      query = _T("DROP VIEW IF EXISTS ");
+      query.append(table);
+      return ExecuteQuery(hdb, query);
+   }
+
+   StringBuffer select;
+   if (partitions->size() <= MAX_UNION_TERMS)
+   {
+      AppendPartitionUnion(&select, table, partitions, 0, partitions->size());
+   }
+   else
+   {
+      for(int i = 0; i < partitions->size(); i += MAX_UNION_TERMS)
+      {
+         if (i > 0)
+            select.append(_T(" UNION ALL "));
+         select.append(_T("SELECT * FROM ("));
+         AppendPartitionUnion(&select, table, partitions, i, std::min(i + MAX_UNION_TERMS, partitions->size()));
+         select.append(_T(") g"));
+         select.append(i / MAX_UNION_TERMS);
+      }
+   }
+
+   if (DBGetSyntax(hdb) == DB_SYNTAX_PGSQL)
+   {
+      query = _T("CREATE OR REPLACE VIEW ");
+      query.append(table);
+      query.append(_T(" AS "));
+      query.append(select);
+      return ExecuteQuery(hdb, query);
+   }
+
+   // Use savepoint so that old view is restored if new one cannot be created
+   if (!ExecuteQuery(hdb, _T("SAVEPOINT partition_view")))
+      return false;
+
+   query = _T("DROP VIEW IF EXISTS ");
+   query.append(table);
+   bool success = ExecuteQuery(hdb, query);
+   if (success)
+   {
+      query = _T("CREATE VIEW ");
+      query.append(table);
+      query.append(_T(" AS "));
+      query.append(select);
+      success = ExecuteQuery(hdb, query);
+   }
+   if (success)
+   {
+      // SQLite does not check referenced tables when view is created
+      query = _T("SELECT * FROM ");
+      query.append(table);
+      query.append(_T(" WHERE 1=0"));
+      DB_RESULT hResult = DBSelect(hdb, query);
+      if (hResult != NULL)
+         DBFreeResult(hResult);
+      else
+         success = false;
+   }
+
+   if (!success)
+      ExecuteQuery(hdb, _T("ROLLBACK TO SAVEPOINT partition_view"));
+   ExecuteQuery(hdb, _T("RELEASE SAVEPOINT partition_view"));
+   return success;
+}
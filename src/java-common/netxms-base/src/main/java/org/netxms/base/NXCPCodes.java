@@ -420,6 +420,7 @@
    public static final int CMD_MODIFY_WEB_SERVICE = 0x0193;
    public static final int CMD_DELETE_WEB_SERVICE = 0x0194;
    public static final int CMD_WEB_SERVICE_DEFINITION = 0x0195;
+   public static final int CMD_GET_PARAMETERS = 0x0196;
    
 	// CMD_RS_ - Reporting Server related codes
 	public static final int CMD_RS_LIST_REPORTS = 0x1100;
@@ -1126,6 +1127,11 @@
    public static final long VID_CIP_STATE_TEXT = 692;
    public static final long VID_DUPLICATE = 693;
    public static final long VID_TASK_IS_DISABLED = 694;
+   public static final long VID_OBJECT_REVISION = 696;
+   public static final long VID_OBJECT_SYNC_EPOCH = 697;
+   public static final long VID_OBJECT_UPDATE_GROUPS = 698;
+   public static final long VID_DELTA_OBJECT_UPDATES = 699;
+   public static final long VID_OBJECT_SYNC_RESUMED = 700;
 
 	public static final long VID_ACL_USER_BASE = 0x00001000L;
 	public static final long VID_ACL_USER_LAST = 0x00001FFFL;
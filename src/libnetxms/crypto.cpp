@@ -831,6 +831,89 @@ NXCP_ENCRYPTED_MESSAGE *NXCPEncryptionContext::encryptMessage(NXCP_MESSAGE *msg)
 #endif
 }
 
+/**
+ * Start streaming encryption of serialized message with given size and CRC32
+ * checksum. Unencrypted part of encrypted message header and encrypted payload
+ * header are written to output buffer (output buffer should be at least 64 bytes long).
+ * Encryptor remains locked until encryptStreamEnd() is called. Produced message
+ * is identical to one created by encryptMessage().
+ *
+ * @return true on success
+ */
+bool NXCPEncryptionContext::encryptStreamBegin(size_t msgSize, UINT32 checksum, BYTE *out, size_t *outSize)
+{
+#ifdef _WITH_ENCRYPTION
+   MutexLock(m_encryptorLock);
+
+   if (!EVP_EncryptInit_ex(m_encryptor, NULL, NULL, m_sessionKey, m_iv))
+   {
+      MutexUnlock(m_encryptorLock);
+      return false;
+   }
+
+   // Calculate size of encrypted payload in advance
+   size_t payloadSize = msgSize + NXCP_EH_ENCRYPTED_BYTES;
+   size_t blockSize = EVP_CIPHER_block_size(EVP_CIPHER_CTX_cipher(m_encryptor));
+   if (blockSize > 1)
+      payloadSize = (payloadSize / blockSize + 1) * blockSize;
+   size_t encryptedSize = payloadSize + NXCP_EH_UNENCRYPTED_BYTES;
+   size_t padding = (8 - (encryptedSize % 8)) & 7;
+
+   NXCP_ENCRYPTED_MESSAGE *emsg = reinterpret_cast<NXCP_ENCRYPTED_MESSAGE*>(out);
+   emsg->code = htons(CMD_ENCRYPTED_MESSAGE);
+   emsg->padding = static_cast<BYTE>(padding);
+   emsg->reserved = 0;
+   emsg->size = htonl(static_cast<UINT32>(encryptedSize + padding));
+
+   NXCP_ENCRYPTED_PAYLOAD_HEADER header;
+   header.dwChecksum = htonl(checksum);
+   header.dwReserved = 0;
+
+   int dataSize;
+   EVP_EncryptUpdate(m_encryptor, emsg->data, &dataSize, (BYTE *)&header, NXCP_EH_ENCRYPTED_BYTES);
+   *outSize = NXCP_EH_UNENCRYPTED_BYTES + dataSize;
+   return true;
+#else
+   return false;
+#endif
+}
+
+/**
+ * Encrypt next part of serialized message. Output buffer should be at least
+ * inSize + 32 bytes long.
+ *
+ * @return number of bytes written to output buffer
+ */
+size_t NXCPEncryptionContext::encryptStreamUpdate(const BYTE *in, size_t inSize, BYTE *out)
+{
+#ifdef _WITH_ENCRYPTION
+   int dataSize;
+   EVP_EncryptUpdate(m_encryptor, out, &dataSize, in, static_cast<int>(inSize));
+   return dataSize;
+#else
+   return 0;
+#endif
+}
+
+/**
+ * Finish streaming encryption and unlock encryptor. Final cipher block is
+ * written to output buffer (should be at least 64 bytes long). Caller is
+ * responsible for adding padding bytes as indicated in message header.
+ *
+ * @return number of bytes written to output buffer
+ */
+size_t NXCPEncryptionContext::encryptStreamEnd(BYTE *out)
+{
+#ifdef _WITH_ENCRYPTION
+   int dataSize;
+   EVP_EncryptFinal_ex(m_encryptor, out, &dataSize);
+   MutexUnlock(m_encryptorLock);
+   return dataSize;
+#else
+   return 0;
+#endif
+}
+
 /**
  * Decrypt message
  */
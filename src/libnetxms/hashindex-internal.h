@@ -0,0 +1,174 @@
+/*
+** NetXMS - Network Management System
+** NetXMS Foundation Library
+** Copyright (C) 2003-2020 Victor Kirhenshtein
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published
+** by the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: hashindex-internal.h
+**
+**/
+
+#ifndef _hashindex_internal_h_
+#define _hashindex_internal_h_
+
+/**
+ * Open addressing index used by hash maps. Map entries are stored in dense array in insertion
+ * order, and index maps key hashes to positions in that array using Robin Hood hashing with
+ * backward shift deletion. Each index slot holds 32 bit key hash in upper half and entry
+ * position + 1 in lower half, so probing does not touch entries until hash matches.
+ * Empty slot is represented by 0.
+ */
+
+/**
+ * Minimal index size (must be power of 2)
+ */
+#define HASH_INDEX_MIN_SIZE   16
+
+/**
+ * Maximum number of entries for given index size (maximum load factor is 7/8)
+ */
+#define HASH_INDEX_CAPACITY(mask) static_cast<int>(((mask) + 1) / 8 * 7)
+
+/**
+ * Make index slot value
+ */
+static inline UINT64 HashIndexSlot(UINT32 hash, UINT32 position)
+{
+   return (static_cast<UINT64>(hash) << 32) | static_cast<UINT64>(position + 1);
+}
+
+/**
+ * Get hash from index slot
+ */
+static inline UINT32 HashIndexSlotHash(UINT64 slot)
+{
+   return static_cast<UINT32>(slot >> 32);
+}
+
+/**
+ * Get entry position from index slot
+ */
+static inline UINT32 HashIndexSlotPosition(UINT64 slot)
+{
+   return static_cast<UINT32>(slot & 0xFFFFFFFF) - 1;
+}
+
+/**
+ * Get distance of index slot at given position from its home position
+ */
+static inline UINT32 HashIndexProbeDistance(UINT64 slot, UINT32 pos, UINT32 mask)
+{
+   return (pos - HashIndexSlotHash(slot)) & mask;
+}
+
+/**
+ * Final mixing step of MurmurHash3
+ */
+static inline UINT32 HashIndexMix32(UINT32 h)
+{
+   h ^= h >> 16;
+   h *= 0x85EBCA6B;
+   h ^= h >> 13;
+   h *= 0xC2B2AE35;
+   h ^= h >> 16;
+   return h;
+}
+
+/**
+ * Calculate hash for arbitrary key. Integer sized keys are mixed directly, other keys are
+ * hashed with FNV-1a and mixed to spread entropy to lower bits used for slot selection.
+ */
+static inline UINT32 HashIndexCalculateHash(const void *key, size_t len)
+{
+   if (len == sizeof(UINT32))
+   {
+      UINT32 v;
+      memcpy(&v, key, sizeof(UINT32));
+      return HashIndexMix32(v);
+   }
+   if (len == sizeof(UINT64))
+   {
+      UINT64 v;
+      memcpy(&v, key, sizeof(UINT64));
+      v ^= v >> 33;
+      v *= _ULL(0xFF51AFD7ED558CCD);
+      v ^= v >> 33;
+      v *= _ULL(0xC4CEB9FE1A85EC53);
+      v ^= v >> 33;
+      return static_cast<UINT32>(v);
+   }
+
+   UINT32 h = 2166136261U;
+   const BYTE *p = static_cast<const BYTE*>(key);
+   for(size_t i = 0; i < len; i++)
+   {
+      h ^= p[i];
+      h *= 16777619U;
+   }
+   return HashIndexMix32(h);
+}
+
+/**
+ * Insert entry position into index. Index should have at least one free slot.
+ */
+static inline void HashIndexInsert(UINT64 *index, UINT32 mask, UINT32 hash, UINT32 position)
+{
+   UINT64 slot = HashIndexSlot(hash, position);
+   UINT32 pos = hash & mask;
+   UINT32 distance = 0;
+   while(index[pos] != 0)
+   {
+      // Displace entry which is closer to its home position ("rich" entry)
+      UINT32 d = HashIndexProbeDistance(index[pos], pos, mask);
+      if (d < distance)
+      {
+         UINT64 t = index[pos];
+         index[pos] = slot;
+         slot = t;
+         distance = d;
+      }
+      pos = (pos + 1) & mask;
+      distance++;
+   }
+   index[pos] = slot;
+}
+
+/**
+ * Remove entry position from index
+ */
+static inline void HashIndexRemove(UINT64 *index, UINT32 mask, UINT32 hash, UINT32 position)
+{
+   UINT64 slot = HashIndexSlot(hash, position);
+   UINT32 pos = hash & mask;
+   while(index[pos] != slot)
+   {
+      if (index[pos] == 0)
+         return;  // Not found, should not happen
+      pos = (pos + 1) & mask;
+   }
+
+   // Shift following entries back until empty slot or slot at its home position
+   UINT32 next = (pos + 1) & mask;
+   while((index[next] != 0) && (HashIndexProbeDistance(index[next], next, mask) > 0))
+   {
+      index[pos] = index[next];
+      pos = next;
+      next = (next + 1) & mask;
+   }
+   index[pos] = 0;
+}
+
+#endif
@@ -1,7 +1,7 @@
 /* 
 ** NetXMS - Network Management System
 ** NetXMS Foundation Library
-** Copyright (C) 2003-2018 Victor Kirhenshtein
+** Copyright (C) 2003-2020 Victor Kirhenshtein
 **
 ** This program is free software; you can redistribute it and/or modify
 ** it under the terms of the GNU Lesser General Public License as published
@@ -22,20 +22,21 @@
 **/
 
 #include "libnetxms.h"
-#include <uthash.h>
+#include "hashindex-internal.h"
 
 /**
  * Entry
  */
 struct HashMapEntry
 {
-   UT_hash_handle hh;
    union
    {
       BYTE d[16];
       void *p;
    } key;
    void *value;
+   UINT32 hash;
+   bool deleted;
 };
 
 /**
@@ -62,6 +63,11 @@ static void ObjectDestructor(void *object, HashMapBase *map)
 HashMapBase::HashMapBase(Ownership objectOwner, unsigned int keylen, void (*destructor)(void *, HashMapBase *))
 {
    m_data = NULL;
+   m_index = NULL;
+   m_indexMask = 0;
+   m_used = 0;
+   m_allocated = 0;
+   m_size = 0;
    m_objectOwner = (objectOwner == Ownership::True);
    m_keylen = keylen;
    m_objectDestructor = (destructor != NULL) ? destructor : ObjectDestructor;
@@ -81,28 +87,127 @@ HashMapBase::~HashMapBase()
  */
 void HashMapBase::clear()
 {
-   HashMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   HashMapEntry *data = m_data;
+   int used = m_used;
+   MemFree(m_index);
+   m_data = NULL;
+   m_index = NULL;
+   m_indexMask = 0;
+   m_used = 0;
+   m_allocated = 0;
+   m_size = 0;
+
+   for(int i = 0; i < used; i++)
    {
-      HASH_DEL(m_data, entry);
+      HashMapEntry *entry = &data[i];
+      if (entry->deleted)
+         continue;
       DELETE_KEY(this, entry);
       if (m_objectOwner)
          destroyObject(entry->value);
-      MemFree(entry);
    }
+   MemFree(data);
 }
 
 /**
- * Find entry index by key
+ * Find entry by key and key hash
  */
-HashMapEntry *HashMapBase::find(const void *key) const
+HashMapEntry *HashMapBase::find(const void *key, UINT32 hash) const
 {
-	if (key == NULL)
-		return NULL;
+   if (m_size == 0)
+      return NULL;
+
+   UINT32 pos = hash & m_indexMask;
+   for(UINT32 distance = 0;; distance++)
+   {
+      UINT64 slot = m_index[pos];
+      if ((slot == 0) || (HashIndexProbeDistance(slot, pos, m_indexMask) < distance))
+         return NULL;
+      if (HashIndexSlotHash(slot) == hash)
+      {
+         HashMapEntry *entry = &m_data[HashIndexSlotPosition(slot)];
+         if (!memcmp(GET_KEY(entry), key, m_keylen))
+            return entry;
+      }
+      pos = (pos + 1) & m_indexMask;
+   }
+}
+
+/**
+ * Rebuild index from scratch
+ */
+void HashMapBase::rebuildIndex()
+{
+   memset(m_index, 0, (m_indexMask + 1) * sizeof(UINT64));
+   for(int i = 0; i < m_used; i++)
+      if (!m_data[i].deleted)
+         HashIndexInsert(m_index, m_indexMask, m_data[i].hash, i);
+}
+
+/**
+ * Make room for new entry at the end of entry array. If there are enough deleted
+ * entries they are compacted out, otherwise entry array is extended. Index is grown
+ * when it reaches maximum load factor.
+ */
+void HashMapBase::reserveEntry()
+{
+   bool rebuild = false;
+   if (m_used == m_allocated)
+   {
+      if ((m_used > 0) && (m_used - m_size >= m_used / 4))
+      {
+         int n = 0;
+         for(int i = 0; i < m_used; i++)
+         {
+            if (m_data[i].deleted)
+               continue;
+            if (i != n)
+               m_data[n] = m_data[i];
+            n++;
+         }
+         m_used = n;
+         rebuild = true;
+      }
+      else
+      {
+         m_allocated = (m_allocated > 0) ? m_allocated + m_allocated / 2 : HASH_INDEX_MIN_SIZE;
+         m_data = MemReallocArray(m_data, m_allocated);
+      }
+   }
+
+   if (m_size >= HASH_INDEX_CAPACITY(m_indexMask))
+   {
+      UINT32 indexSize = (m_index != NULL) ? (m_indexMask + 1) * 2 : HASH_INDEX_MIN_SIZE;
+      MemFree(m_index);
+      m_index = MemAllocArrayNoInit<UINT64>(indexSize);
+      m_indexMask = indexSize - 1;
+      rebuild = true;
+   }
 
-   HashMapEntry *entry;
-   HASH_FIND(hh, m_data, key, m_keylen, entry);
-   return entry;
+   if (rebuild)
+      rebuildIndex();
+}
+
+/**
+ * Remove entry at given position
+ */
+void HashMapBase::removeEntry(int position, bool destroyValue)
+{
+   HashMapEntry *entry = &m_data[position];
+   HashIndexRemove(m_index, m_indexMask, entry->hash, position);
+   DELETE_KEY(this, entry);
+   void *value = entry->value;
+   entry->deleted = true;
+   entry->value = NULL;
+
+   m_size--;
+   if (m_size == 0)
+      m_used = 0;
+   else if (position == m_used - 1)
+      m_used--;
+
+   if (m_objectOwner && destroyValue)
+      destroyObject(value);
 }
 
 /**
@@ -113,7 +218,8 @@ void HashMapBase::_set(const void *key, void *value)
    if (key == NULL)
       return;
 
-	HashMapEntry *entry = find(key);
+   UINT32 hash = HashIndexCalculateHash(key, m_keylen);
+	HashMapEntry *entry = find(key, hash);
 	if (entry != NULL)
 	{
 		if (m_objectOwner)
@@ -122,13 +228,18 @@ void HashMapBase::_set(const void *key, void *value)
 	}
 	else
 	{
-      entry = MemAllocStruct<HashMapEntry>();
+      reserveEntry();
+      entry = &m_data[m_used];
       if (m_keylen <= 16)
          memcpy(entry->key.d, key, m_keylen);
       else
          entry->key.p = MemCopyBlock(key, m_keylen);
       entry->value = value;
-      HASH_ADD_KEYPTR(hh, m_data, GET_KEY(entry), m_keylen, entry);
+      entry->hash = hash;
+      entry->deleted = false;
+      HashIndexInsert(m_index, m_indexMask, hash, m_used);
+      m_used++;
+      m_size++;
 	}
 }
 
@@ -137,8 +248,9 @@ void HashMapBase::_set(const void *key, void *value)
  */
 void *HashMapBase::_get(const void *key) const
 {
-   HashMapEntry *entry;
-   HASH_FIND(hh, m_data, key, m_keylen, entry);
+   if (key == NULL)
+      return NULL;
+   HashMapEntry *entry = find(key, HashIndexCalculateHash(key, m_keylen));
    return (entry != NULL) ? entry->value : NULL;
 }
 
@@ -147,16 +259,19 @@ void *HashMapBase::_get(const void *key) const
  */
 void HashMapBase::_remove(const void *key, bool destroyValue)
 {
-   HashMapEntry *entry;
-   HASH_FIND(hh, m_data, key, m_keylen, entry);
+   if (key == NULL)
+      return;
+   HashMapEntry *entry = find(key, HashIndexCalculateHash(key, m_keylen));
    if (entry != NULL)
-   {
-      HASH_DEL(m_data, entry);
-      DELETE_KEY(this, entry);
-		if (m_objectOwner && destroyValue)
-         destroyObject(entry->value);
-      MemFree(entry);
-   }
+      removeEntry(static_cast<int>(entry - m_data), destroyValue);
+}
+
+/**
+ * Check if given key is in the map
+ */
+bool HashMapBase::_contains(const void *key) const
+{
+   return (key != NULL) ? (find(key, HashIndexCalculateHash(key, m_keylen)) != NULL) : false;
 }
 
 /**
@@ -166,9 +281,11 @@ void HashMapBase::_remove(const void *key, bool destroyValue)
 EnumerationCallbackResult HashMapBase::forEach(EnumerationCallbackResult (*cb)(const void *, const void *, void *), void *userData) const
 {
    EnumerationCallbackResult result = _CONTINUE;
-   HashMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   for(int i = 0; i < m_used; i++)
    {
+      HashMapEntry *entry = &m_data[i];
+      if (entry->deleted)
+         continue;
       if (cb(GET_KEY(entry), entry->value, userData) == _STOP)
       {
          result = _STOP;
@@ -184,9 +301,11 @@ EnumerationCallbackResult HashMapBase::forEach(EnumerationCallbackResult (*cb)(c
 const void *HashMapBase::findElement(bool (*comparator)(const void *, const void *, void *), void *userData) const
 {
    const void *result = NULL;
-   HashMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   for(int i = 0; i < m_used; i++)
    {
+      HashMapEntry *entry = &m_data[i];
+      if (entry->deleted)
+         continue;
       if (comparator(GET_KEY(entry), entry->value, userData))
       {
          result = entry->value;
@@ -197,11 +316,16 @@ const void *HashMapBase::findElement(bool (*comparator)(const void *, const void
 }
 
 /**
- * Get size
+ * Get memory used by map internal structures (excluding values)
  */
-int HashMapBase::size() const
+size_t HashMapBase::memoryUsage() const
 {
-   return HASH_COUNT(m_data);
+   if (m_index == NULL)
+      return 0;
+   size_t usage = (m_indexMask + 1) * sizeof(UINT64) + m_allocated * sizeof(HashMapEntry);
+   if (m_keylen > 16)
+      usage += m_size * m_keylen;
+   return usage;
 }
 
 /**
@@ -210,8 +334,7 @@ int HashMapBase::size() const
 HashMapIterator::HashMapIterator(HashMapBase *hashMap)
 {
    m_hashMap = hashMap;
-   m_curr = NULL;
-   m_next = NULL;
+   m_position = -1;
 }
 
 /**
@@ -219,10 +342,10 @@ HashMapIterator::HashMapIterator(HashMapBase *hashMap)
  */
 bool HashMapIterator::hasNext()
 {
-   if (m_hashMap->m_data == NULL)
-      return false;
-
-   return (m_curr != NULL) ? (m_next != NULL) : true;
+   for(int i = m_position + 1; i < m_hashMap->m_used; i++)
+      if (!m_hashMap->m_data[i].deleted)
+         return true;
+   return false;
 }
 
 /**
@@ -230,21 +353,13 @@ bool HashMapIterator::hasNext()
  */
 void *HashMapIterator::next()
 {
-   if (m_hashMap->m_data == NULL)
-      return NULL;
-
-   if (m_curr == NULL)  // iteration not started
+   while(m_position < m_hashMap->m_used)
    {
-      m_curr = m_hashMap->m_data;
+      m_position++;
+      if ((m_position < m_hashMap->m_used) && !m_hashMap->m_data[m_position].deleted)
+         return m_hashMap->m_data[m_position].value;
    }
-   else
-   {
-      if (m_next == NULL)
-         return NULL;
-      m_curr = m_next;
-   }
-   m_next = static_cast<HashMapEntry*>(m_curr->hh.next);
-   return m_curr->value;
+   return NULL;
 }
 
 /**
@@ -252,14 +367,9 @@ void *HashMapIterator::next()
  */
 void HashMapIterator::remove()
 {
-   if (m_curr == NULL)
+   if ((m_position < 0) || (m_position >= m_hashMap->m_used) || m_hashMap->m_data[m_position].deleted)
       return;
-
-   HASH_DEL(m_hashMap->m_data, m_curr);
-   DELETE_KEY(m_hashMap, m_curr);
-   if (m_hashMap->m_objectOwner)
-      m_hashMap->destroyObject(m_curr->value);
-   MemFree(m_curr);
+   m_hashMap->removeEntry(m_position, true);
 }
 
 /**
@@ -267,10 +377,7 @@ void HashMapIterator::remove()
  */
 void HashMapIterator::unlink()
 {
-   if (m_curr == NULL)
+   if ((m_position < 0) || (m_position >= m_hashMap->m_used) || m_hashMap->m_data[m_position].deleted)
       return;
-
-   HASH_DEL(m_hashMap->m_data, m_curr);
-   DELETE_KEY(m_hashMap, m_curr);
-   MemFree(m_curr);
+   m_hashMap->removeEntry(m_position, false);
 }
@@ -83,13 +83,60 @@ static NxLogConsoleWriter m_consoleWriter = DefaultConsoleWriter;
 #else
 static NxLogConsoleWriter m_consoleWriter = (NxLogConsoleWriter)_tprintf;
 #endif
-static StringBuffer s_logBuffer;
 static THREAD s_writerThread = INVALID_THREAD_HANDLE;
-static CONDITION s_writerStopCondition = INVALID_CONDITION_HANDLE;
 static NxLogDebugWriter s_debugWriter = NULL;
 static volatile DebugTagManager s_tagTree;
 static Mutex s_mutexDebugTagTreeWrite;
 
+/**
+ * Debug configuration version (incremented on every debug level change), root debug level,
+ * and maximum debug level set for any tag. Used for fast rejection of disabled debug messages.
+ */
+static VolatileCounter s_debugConfigVersion = 1;
+static volatile int s_rootDebugLevel = 0;
+static volatile int s_maxDebugLevel = 0;
+
+#if HAVE_THREAD_LOCAL_STORAGE
+
+/**
+ * Per-thread cache of tag debug levels. Call sites pass tag as constant string, so
+ * entry is identified by tag pointer and content hash. Entries with outdated
+ * configuration version are ignored.
+ */
+#define TAG_LEVEL_CACHE_SIZE  64
+
+struct TagLevelCacheEntry
+{
+   const TCHAR *tag;
+   UINT32 hash;
+   UINT32 version;
+   int level;
+};
+
+static thread_local TagLevelCacheEntry s_tagLevelCache[TAG_LEVEL_CACHE_SIZE];
+
+#endif
+
+/**
+ * Lock-free queue of formatted log records for background writer
+ */
+#define LOG_QUEUE_SIZE        65536
+#define LOG_QUEUE_MASK        (LOG_QUEUE_SIZE - 1)
+#define LOG_QUEUE_WAKEUP_STEP 4096
+
+struct LogQueueSlot
+{
+   VolatileCounter sequence;
+   char *record;
+};
+
+static LogQueueSlot *s_logQueue = NULL;
+static VolatileCounter s_logQueueTail = 0;
+static UINT32 s_logQueueHead = 0;
+static VolatileCounter s_logQueueProducers = 0;   // Number of threads currently putting records into queue
+static CONDITION s_writerWakeupCondition = INVALID_CONDITION_HANDLE;
+static volatile bool s_writerStopFlag = false;
+
 /**
  * Swaps tag tree pointers and waits till reader count drops to 0
  */
@@ -206,6 +253,86 @@ static void DefaultConsoleWriter(const TCHAR *format, ...)
 
 #endif
 
+/**
+ * Acquire active tag tree for reading
+ */
+inline DebugTagTree *AcquireTagTree()
+{
+   DebugTagTree *tagTree;
+   while(true)
+   {
+      tagTree = s_tagTree.active;
+      InterlockedIncrement(&tagTree->m_readers);
+      if (tagTree->m_writers == 0)
+         break;
+      InterlockedDecrement(&tagTree->m_readers);
+   }
+   return tagTree;
+}
+
+/**
+ * Release previously acquired tag tree
+ */
+inline void ReleaseTagTree(DebugTagTree *tagTree)
+{
+   InterlockedDecrement(&tagTree->m_readers);
+}
+
+/**
+ * Update cached debug configuration data. Should be called after each change with tree write lock held.
+ */
+static void UpdateDebugConfiguration()
+{
+   DebugTagTree *tagTree = AcquireTagTree();
+   int rootLevel = tagTree->getRootDebugLevel();
+   ObjectArray<DebugTagInfo> *tags = tagTree->getAllTags();
+   ReleaseTagTree(tagTree);
+
+   int maxLevel = rootLevel;
+   for(int i = 0; i < tags->size(); i++)
+      maxLevel = std::max(maxLevel, tags->get(i)->level);
+   delete tags;
+
+   s_rootDebugLevel = rootLevel;
+   s_maxDebugLevel = maxLevel;
+   InterlockedIncrement(&s_debugConfigVersion);
+}
+
+/**
+ * Get debug level for given tag using per-thread cache
+ */
+static int GetDebugLevelForTag(const TCHAR *tag)
+{
+#if HAVE_THREAD_LOCAL_STORAGE
+   if (tag == NULL)
+      return s_rootDebugLevel;
+
+   UINT32 hash = 2166136261U;
+   for(const TCHAR *p = tag; *p != 0; p++)
+      hash = (hash ^ static_cast<UINT32>(*p)) * 16777619U;
+
+   UINT32 version = s_debugConfigVersion;
+   TagLevelCacheEntry *e = &s_tagLevelCache[hash % TAG_LEVEL_CACHE_SIZE];
+   if ((e->tag == tag) && (e->hash == hash) && (e->version == version))
+      return e->level;
+
+   DebugTagTree *tagTree = AcquireTagTree();
+   int level = tagTree->getDebugLevel(tag);
+   ReleaseTagTree(tagTree);
+
+   e->tag = tag;
+   e->hash = hash;
+   e->version = version;
+   e->level = level;
+   return level;
+#else
+   DebugTagTree *tagTree = AcquireTagTree();
+   int level = tagTree->getDebugLevel(tag);
+   ReleaseTagTree(tagTree);
+   return level;
+#endif
+}
+
 /**
  * Set debug level
  */
@@ -218,6 +345,7 @@ void LIBNETXMS_EXPORTABLE nxlog_set_debug_level(int level)
       SwapAndWait();
       s_tagTree.secondary->setRootDebugLevel(level); // Update the previously active tree
       InterlockedDecrement(&s_tagTree.secondary->m_writers);
+      UpdateDebugConfiguration();
       s_mutexDebugTagTreeWrite.unlock();
    }
 }
@@ -247,6 +375,7 @@ void LIBNETXMS_EXPORTABLE nxlog_set_debug_level_tag(const TCHAR *tag, int level)
          s_tagTree.secondary->remove(tag);
       }
       InterlockedDecrement(&s_tagTree.secondary->m_writers);
+      UpdateDebugConfiguration();
       s_mutexDebugTagTreeWrite.unlock();
    }
 }
@@ -261,43 +390,16 @@ void LIBNETXMS_EXPORTABLE nxlog_reset_debug_level_tags()
    SwapAndWait();
    s_tagTree.secondary->clear();
    InterlockedDecrement(&s_tagTree.secondary->m_writers);
+   UpdateDebugConfiguration();
    s_mutexDebugTagTreeWrite.unlock();
 }
 
-/**
- * Acquire active tag tree for reading
- */
-inline DebugTagTree *AcquireTagTree()
-{
-   DebugTagTree *tagTree;
-   while(true)
-   {
-      tagTree = s_tagTree.active;
-      InterlockedIncrement(&tagTree->m_readers);
-      if (tagTree->m_writers == 0)
-         break;
-      InterlockedDecrement(&tagTree->m_readers);
-   }
-   return tagTree;
-}
-
-/**
- * Release previously acquired tag tree
- */
-inline void ReleaseTagTree(DebugTagTree *tagTree)
-{
-   InterlockedDecrement(&tagTree->m_readers);
-}
-
 /**
  * Get current debug level
  */
 int LIBNETXMS_EXPORTABLE nxlog_get_debug_level()
 {
-   DebugTagTree *tagTree = AcquireTagTree();
-   int level = tagTree->getRootDebugLevel();
-   ReleaseTagTree(tagTree);
-   return level;
+   return s_rootDebugLevel;
 }
 
 /**
@@ -305,10 +407,7 @@ int LIBNETXMS_EXPORTABLE nxlog_get_debug_level()
  */
 int LIBNETXMS_EXPORTABLE nxlog_get_debug_level_tag(const TCHAR *tag)
 {
-   DebugTagTree *tagTree = AcquireTagTree();
-   int level = tagTree->getDebugLevel(tag);
-   ReleaseTagTree(tagTree);
-   return level;
+   return GetDebugLevelForTag(tag);
 }
 
 /**
@@ -318,10 +417,7 @@ int LIBNETXMS_EXPORTABLE nxlog_get_debug_level_tag_object(const TCHAR *tag, UINT
 {
    TCHAR fullTag[256];
    _sntprintf(fullTag, 256, _T("%s.%u"), tag, objectId);
-   DebugTagTree *tagTree = AcquireTagTree();
-   int level = tagTree->getDebugLevel(fullTag);
-   ReleaseTagTree(tagTree);
-   return level;
+   return GetDebugLevelForTag(fullTag);
 }
 
 /**
@@ -704,6 +800,116 @@ bool LIBNETXMS_EXPORTABLE nxlog_rotate()
    return (s_logFileHandle != -1) ? RotateLog(true) : false;
 }
 
+/**
+ * Create background writer queue
+ */
+static void CreateLogQueue()
+{
+   s_logQueue = MemAllocArrayNoInit<LogQueueSlot>(LOG_QUEUE_SIZE);
+   for(UINT32 i = 0; i < LOG_QUEUE_SIZE; i++)
+   {
+      s_logQueue[i].sequence = i;
+      s_logQueue[i].record = NULL;
+   }
+   s_logQueueTail = 0;
+   s_logQueueHead = 0;
+   s_writerStopFlag = false;
+   s_writerWakeupCondition = ConditionCreate(false);
+}
+
+/**
+ * Put formatted record into background writer queue. Record will be destroyed by writer.
+ * Queue is lock-free for producers. If queue is full caller will wait until writer
+ * frees some space, so records are never lost.
+ */
+static void EnqueueLogRecord(char *record)
+{
+   // Log could be closed after caller checked NXLOG_IS_OPEN flag. Producer counter is
+   // incremented before checking flag again, and nxlog_close() waits for it to drop
+   // to 0 after clearing the flag and before destroying the queue.
+   InterlockedIncrement(&s_logQueueProducers);
+   if (!(s_flags & NXLOG_IS_OPEN))
+   {
+      InterlockedDecrement(&s_logQueueProducers);
+      MemFree(record);
+      return;
+   }
+
+   while(true)
+   {
+      UINT32 pos = s_logQueueTail;
+      LogQueueSlot *slot = &s_logQueue[pos & LOG_QUEUE_MASK];
+      INT32 diff = static_cast<INT32>(InterlockedCompareExchange(&slot->sequence, 0, 0) - pos);
+      if (diff == 0)
+      {
+         if (InterlockedCompareExchange(&s_logQueueTail, pos + 1, pos) == pos)
+         {
+            slot->record = record;
+            InterlockedCompareExchange(&slot->sequence, pos + 1, pos);  // publish record
+            if ((pos & (LOG_QUEUE_WAKEUP_STEP - 1)) == 0)
+               ConditionSet(s_writerWakeupCondition);
+            InterlockedDecrement(&s_logQueueProducers);
+            return;
+         }
+      }
+      else if (diff < 0)
+      {
+         // Queue is full
+         ConditionSet(s_writerWakeupCondition);
+         ThreadSleepMs(1);
+      }
+   }
+}
+
+/**
+ * Collect all records from background writer queue into single buffer.
+ * Should be called only from background writer thread.
+ */
+static char *CollectLogRecords(size_t *size, int *count)
+{
+   *count = 0;
+   char *buffer = NULL;
+   size_t allocated = 0, used = 0;
+   while(true)
+   {
+      LogQueueSlot *slot = &s_logQueue[s_logQueueHead & LOG_QUEUE_MASK];
+      VolatileCounter sequence = InterlockedCompareExchange(&slot->sequence, 0, 0);
+      if (static_cast<INT32>(sequence - (s_logQueueHead + 1)) < 0)
+         break;   // Queue is empty
+
+      char *record = slot->record;
+      slot->record = NULL;
+      InterlockedCompareExchange(&slot->sequence, s_logQueueHead + LOG_QUEUE_SIZE, sequence);
+      s_logQueueHead++;
+
+      size_t len = strlen(record);
+      if (used + len > allocated)
+      {
+         allocated = std::max(allocated * 2, used + len + 65536);
+         buffer = static_cast<char*>(MemRealloc(buffer, allocated));
+      }
+      memcpy(&buffer[used], record, len);
+      used += len;
+      (*count)++;
+      MemFree(record);
+   }
+   *size = used;
+   return buffer;
+}
+
+/**
+ * Destroy background writer queue
+ */
+static void DestroyLogQueue()
+{
+   ConditionDestroy(s_writerWakeupCondition);
+   s_writerWakeupCondition = INVALID_CONDITION_HANDLE;
+   for(UINT32 i = 0; i < LOG_QUEUE_SIZE; i++)
+      MemFree(s_logQueue[i].record);
+   MemFree(s_logQueue);
+   s_logQueue = NULL;
+}
+
 /**
  * Background writer thread - file
  */
@@ -712,7 +918,8 @@ static THREAD_RESULT THREAD_CALL BackgroundWriterThread(void *arg)
    bool stop = false;
    while(!stop)
    {
-      stop = ConditionWait(s_writerStopCondition, 1000);
+      ConditionWait(s_writerWakeupCondition, 1000);
+      stop = s_writerStopFlag;
 
 	   // Check for new day start
       time_t t = time(NULL);
@@ -721,24 +928,21 @@ static THREAD_RESULT THREAD_CALL BackgroundWriterThread(void *arg)
 		   RotateLog(false);
 	   }
 
-      MutexLock(s_mutexLogAccess);
-      if (!s_logBuffer.isEmpty())
+      size_t size;
+      int count;
+      char *data = CollectLogRecords(&size, &count);
+      if (data != NULL)
       {
-         size_t buflen = s_logBuffer.length();
-         char *data = s_logBuffer.getUTF8String();
-         s_logBuffer.clear();
-         MutexUnlock(s_mutexLogAccess);
-
          if (s_logFileHandle != -1)
          {
             if (s_flags & NXLOG_DEBUG_MODE)
             {
                char buffer[256];
-               snprintf(buffer, 256, "##(" INT64_FMTA ")" INT64_FMTA " @" INT64_FMTA "\n", (int64_t)buflen, (int64_t)strlen(data), GetCurrentTimeMs());
+               snprintf(buffer, 256, "##(%d)" INT64_FMTA " @" INT64_FMTA "\n", count, (int64_t)size, GetCurrentTimeMs());
                _write(s_logFileHandle, buffer, strlen(buffer));
             }
 
-            _write(s_logFileHandle, data, strlen(data));
+            _write(s_logFileHandle, data, static_cast<unsigned int>(size));
 
             // Check log size
             if ((s_rotationMode == NXLOG_ROTATION_BY_SIZE) && (s_maxLogSize != 0))
@@ -752,10 +956,6 @@ static THREAD_RESULT THREAD_CALL BackgroundWriterThread(void *arg)
 
 	      MemFree(data);
       }
-      else
-      {
-         MutexUnlock(s_mutexLogAccess);
-      }
    }
    return THREAD_OK;
 }
@@ -768,26 +968,33 @@ static THREAD_RESULT THREAD_CALL BackgroundWriterThreadStdOut(void *arg)
    bool stop = false;
    while(!stop)
    {
-      stop = ConditionWait(s_writerStopCondition, 1000);
+      ConditionWait(s_writerWakeupCondition, 1000);
+      stop = s_writerStopFlag;
 
-      MutexLock(s_mutexLogAccess);
-      if (!s_logBuffer.isEmpty())
+      size_t size;
+      int count;
+      char *data = CollectLogRecords(&size, &count);
+      if (data != NULL)
       {
-         char *data = s_logBuffer.getUTF8String();
-         s_logBuffer.clear();
-         MutexUnlock(s_mutexLogAccess);
-
-         _write(STDOUT_FILENO, data, strlen(data));
+         _write(STDOUT_FILENO, data, static_cast<unsigned int>(size));
          MemFree(data);
       }
-      else
-      {
-         MutexUnlock(s_mutexLogAccess);
-      }
    }
    return THREAD_OK;
 }
 
+/**
+ * Stop background writer thread
+ */
+static void StopBackgroundWriter()
+{
+   s_writerStopFlag = true;
+   ConditionSet(s_writerWakeupCondition);
+   ThreadJoin(s_writerThread);
+   s_writerThread = INVALID_THREAD_HANDLE;
+   DestroyLogQueue();
+}
+
 /**
  * Initialize log
  */
@@ -825,8 +1032,7 @@ bool LIBNETXMS_EXPORTABLE nxlog_open(const TCHAR *logName, UINT32 flags)
       s_flags &= ~NXLOG_PRINT_TO_STDOUT;
       if (s_flags & NXLOG_BACKGROUND_WRITER)
       {
-         s_logBuffer.setAllocationStep(8192);
-         s_writerStopCondition = ConditionCreate(TRUE);
+         CreateLogQueue();
          s_writerThread = ThreadCreateEx(BackgroundWriterThreadStdOut, 0, NULL);
       }
    }
@@ -866,8 +1072,7 @@ bool LIBNETXMS_EXPORTABLE nxlog_open(const TCHAR *logName, UINT32 flags)
 
          if (s_flags & NXLOG_BACKGROUND_WRITER)
          {
-            s_logBuffer.setAllocationStep(8192);
-            s_writerStopCondition = ConditionCreate(TRUE);
+            CreateLogQueue();
             s_writerThread = ThreadCreateEx(BackgroundWriterThread, 0, NULL);
          }
       }
@@ -884,6 +1089,18 @@ void LIBNETXMS_EXPORTABLE nxlog_close()
 {
    if (s_flags & NXLOG_IS_OPEN)
    {
+      // Mark log as closed before stopping background writer so no new records will be queued
+      MutexLock(s_mutexLogAccess);
+      s_flags &= ~NXLOG_IS_OPEN;
+      MutexUnlock(s_mutexLogAccess);
+
+      if (s_flags & NXLOG_BACKGROUND_WRITER)
+      {
+         // Wait for producers which checked flag before it was cleared
+         while(InterlockedCompareExchange(&s_logQueueProducers, 0, 0) > 0)
+            ThreadSleepMs(1);
+      }
+
       if (s_flags & NXLOG_USE_SYSLOG)
       {
 #ifdef _WIN32
@@ -899,24 +1116,12 @@ void LIBNETXMS_EXPORTABLE nxlog_close()
       else if (s_flags & NXLOG_USE_STDOUT)
       {
          if (s_flags & NXLOG_BACKGROUND_WRITER)
-         {
-            ConditionSet(s_writerStopCondition);
-            ThreadJoin(s_writerThread);
-            ConditionDestroy(s_writerStopCondition);
-            s_writerThread = INVALID_THREAD_HANDLE;
-            s_writerStopCondition = INVALID_CONDITION_HANDLE;
-         }
+            StopBackgroundWriter();
       }
       else
       {
          if (s_flags & NXLOG_BACKGROUND_WRITER)
-         {
-            ConditionSet(s_writerStopCondition);
-            ThreadJoin(s_writerThread);
-            ConditionDestroy(s_writerStopCondition);
-            s_writerThread = INVALID_THREAD_HANDLE;
-            s_writerStopCondition = INVALID_CONDITION_HANDLE;
-         }
+            StopBackgroundWriter();
 
          if (s_logFileHandle != -1)
          {
@@ -924,7 +1129,6 @@ void LIBNETXMS_EXPORTABLE nxlog_close()
             s_logFileHandle = -1;
          }
       }
-	   s_flags &= ~NXLOG_IS_OPEN;
    }
 
    if (s_mutexLogAccess != INVALID_MUTEX_HANDLE)
@@ -991,21 +1195,31 @@ static void WriteLogToFileAsText(INT16 severity, const TCHAR *tag, const TCHAR *
    TCHAR tagf[20];
    FormatTag(tag, tagf);
 
-   MutexLock(s_mutexLogAccess);
-
    TCHAR timestamp[64];
-   FormatLogTimestamp(timestamp);
    if (s_flags & NXLOG_BACKGROUND_WRITER)
    {
-      s_logBuffer.append(timestamp);
-      s_logBuffer.append(_T(" "));
-      s_logBuffer.append(loglevel);
-      s_logBuffer.append(tagf);
-      s_logBuffer.append(_T("] "));
-      s_logBuffer.append(message);
-      s_logBuffer.append(_T("\n"));
+      // Record is formatted without holding log lock and passed to writer via lock-free queue
+      FormatLogTimestamp(timestamp);
+      size_t len = _tcslen(message) + 128;
+      TCHAR lineBuffer[LOCAL_MSG_BUFFER_SIZE];
+      TCHAR *line = AllocateStringBuffer(len, lineBuffer);
+      _sntprintf(line, len, _T("%s %s%s] %s\n"), timestamp, loglevel, tagf, message);
+      EnqueueLogRecord(UTF8StringFromTString(line));
+      FreeStringBuffer(line, lineBuffer);
+
+      if (s_flags & NXLOG_PRINT_TO_STDOUT)
+      {
+         MutexLock(s_mutexLogAccess);
+         WriteLogToConsole(severity, timestamp, tag, message);
+         MutexUnlock(s_mutexLogAccess);
+      }
+      return;
    }
-   else if (s_flags & NXLOG_USE_STDOUT)
+
+   MutexLock(s_mutexLogAccess);
+
+   FormatLogTimestamp(timestamp);
+   if (s_flags & NXLOG_USE_STDOUT)
    {
       FileFormattedWrite(STDOUT_FILENO, _T("%s %s%s] %s\n"), timestamp, loglevel, tagf, message);
    }
@@ -1078,13 +1292,24 @@ static void WriteLogToFileAsJSON(INT16 severity, const TCHAR *tag, const TCHAR *
    _tcscat(json, escapedMessage);
    _tcscat(json, _T("\"}\n"));
 
-   MutexLock(s_mutexLogAccess);
-
    if (s_flags & NXLOG_BACKGROUND_WRITER)
    {
-      s_logBuffer.append(json);
+      EnqueueLogRecord(UTF8StringFromTString(json));
+      if (s_flags & NXLOG_PRINT_TO_STDOUT)
+      {
+         MutexLock(s_mutexLogAccess);
+         WriteLogToConsole(severity, timestamp, tag, message);
+         MutexUnlock(s_mutexLogAccess);
+      }
+      FreeStringBuffer(json, jsonBuffer);
+      FreeStringBuffer(escapedMessage, escapedMessageBuffer);
+      FreeStringBuffer(escapedTag, escapedTagBuffer);
+      return;
    }
-   else if (s_flags & NXLOG_USE_STDOUT)
+
+   MutexLock(s_mutexLogAccess);
+
+   if (s_flags & NXLOG_USE_STDOUT)
    {
       FileWrite(STDOUT_FILENO, json);
    }
@@ -1294,7 +1519,7 @@ void LIBNETXMS_EXPORTABLE nxlog_write_tag2(INT16 severity, const TCHAR *tag, con
  */
 void LIBNETXMS_EXPORTABLE nxlog_debug(int level, const TCHAR *format, ...)
 {
-   if (level > nxlog_get_debug_level_tag(_T("*")))
+   if (level > s_rootDebugLevel)
       return;
 
    va_list args;
@@ -1308,7 +1533,7 @@ void LIBNETXMS_EXPORTABLE nxlog_debug(int level, const TCHAR *format, ...)
  */
 void LIBNETXMS_EXPORTABLE nxlog_debug2(int level, const TCHAR *format, va_list args)
 {
-   if (level > nxlog_get_debug_level_tag(_T("*")))
+   if (level > s_rootDebugLevel)
       return;
 
    WriteLog(NXLOG_DEBUG, NULL, format, args);
@@ -1319,7 +1544,7 @@ void LIBNETXMS_EXPORTABLE nxlog_debug2(int level, const TCHAR *format, va_list a
  */
 void LIBNETXMS_EXPORTABLE nxlog_debug_tag(const TCHAR *tag, int level, const TCHAR *format, ...)
 {
-   if (level > nxlog_get_debug_level_tag(tag))
+   if ((level > s_maxDebugLevel) || (level > GetDebugLevelForTag(tag)))
       return;
 
    va_list args;
@@ -1333,7 +1558,7 @@ void LIBNETXMS_EXPORTABLE nxlog_debug_tag(const TCHAR *tag, int level, const TCH
  */
 void LIBNETXMS_EXPORTABLE nxlog_debug_tag2(const TCHAR *tag, int level, const TCHAR *format, va_list args)
 {
-   if (level > nxlog_get_debug_level_tag(tag))
+   if ((level > s_maxDebugLevel) || (level > GetDebugLevelForTag(tag)))
       return;
 
    WriteLog(NXLOG_DEBUG, tag, format, args);
@@ -1344,9 +1569,12 @@ void LIBNETXMS_EXPORTABLE nxlog_debug_tag2(const TCHAR *tag, int level, const TC
  */
 void LIBNETXMS_EXPORTABLE nxlog_debug_tag_object(const TCHAR *tag, UINT32 objectId, int level, const TCHAR *format, ...)
 {
+   if (level > s_maxDebugLevel)
+      return;
+
    TCHAR fullTag[256];
    _sntprintf(fullTag, 256, _T("%s.%u"), tag, objectId);
-   if (level > nxlog_get_debug_level_tag(fullTag))
+   if (level > GetDebugLevelForTag(fullTag))
       return;
 
    va_list args;
@@ -1360,9 +1588,12 @@ void LIBNETXMS_EXPORTABLE nxlog_debug_tag_object(const TCHAR *tag, UINT32 object
  */
 void LIBNETXMS_EXPORTABLE nxlog_debug_tag_object2(const TCHAR *tag, UINT32 objectId, int level, const TCHAR *format, va_list args)
 {
+   if (level > s_maxDebugLevel)
+      return;
+
    TCHAR fullTag[256];
    _sntprintf(fullTag, 256, _T("%s.%u"), tag, objectId);
-   if (level > nxlog_get_debug_level_tag(fullTag))
+   if (level > GetDebugLevelForTag(fullTag))
       return;
 
    WriteLog(NXLOG_DEBUG, fullTag, format, args);
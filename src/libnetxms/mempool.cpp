@@ -21,18 +21,121 @@
 
 #include "libnetxms.h"
 
+/**
+ * Region header
+ */
+struct MemoryPoolRegionHeader
+{
+   void *prev;    // previous region
+   size_t size;   // full region size including header
+};
+
+/**
+ * Largest block size served from free lists
+ */
+#define MAX_FREE_LIST_BLOCK   (MEMPOOL_SIZE_CLASSES * 8)
+
+#if defined(_WIN32) || HAVE_THREAD_LOCAL_SPECIFIER
+#define REGION_CACHE_ENABLED 1
+#endif
+
+#ifdef REGION_CACHE_ENABLED
+
+/**
+ * Number of regions in per-thread cache
+ */
+#define REGION_CACHE_SIZE     4
+
+/**
+ * Largest region size eligible for caching
+ */
+#define REGION_CACHE_MAX_SIZE 65536
+
+/**
+ * Per-thread cache of released regions
+ */
+struct RegionCache
+{
+   void *regions[REGION_CACHE_SIZE];
+   int count;
+
+   RegionCache()
+   {
+      count = 0;
+   }
+
+   ~RegionCache()
+   {
+      for(int i = 0; i < count; i++)
+         MemFree(regions[i]);
+      count = 0;
+   }
+};
+
+/**
+ * Region cache for current thread
+ */
+static thread_local RegionCache s_regionCache;
+
+#endif
+
+/**
+ * Allocate new region with at least given size (including header)
+ */
+void *MemoryPool::allocateRegion(size_t size)
+{
+#ifdef REGION_CACHE_ENABLED
+   // Reuse cached region if it is not much larger than requested
+   RegionCache *cache = &s_regionCache;
+   for(int i = 0; i < cache->count; i++)
+   {
+      void *region = cache->regions[i];
+      size_t rsize = static_cast<MemoryPoolRegionHeader*>(region)->size;
+      if ((rsize >= size) && (rsize <= size * 2))
+      {
+         cache->regions[i] = cache->regions[--cache->count];
+         m_currentRegionSize = rsize;
+         return region;
+      }
+   }
+#endif
+
+   void *region = MemAlloc(size);
+   static_cast<MemoryPoolRegionHeader*>(region)->size = size;
+   m_currentRegionSize = size;
+   return region;
+}
+
+/**
+ * Release region (put into per-thread cache or return to system heap)
+ */
+void MemoryPool::releaseRegion(void *region)
+{
+#ifdef REGION_CACHE_ENABLED
+   RegionCache *cache = &s_regionCache;
+   if ((cache->count < REGION_CACHE_SIZE) && (static_cast<MemoryPoolRegionHeader*>(region)->size <= REGION_CACHE_MAX_SIZE))
+   {
+      cache->regions[cache->count++] = region;
+      return;
+   }
+#endif
+   MemFree(region);
+}
+
+
 /**
  * Create new memory pool
  */
 MemoryPool::MemoryPool(size_t regionSize)
 {
-   m_headerSize = sizeof(void*);
+   m_headerSize = sizeof(MemoryPoolRegionHeader);
    if (m_headerSize % 16 != 0)
       m_headerSize += 16 - m_headerSize % 16;
-   m_regionSize = regionSize;
-   m_currentRegion = MemAlloc(m_regionSize);
-   *((void **)m_currentRegion) = NULL; // pointer to previous region
+   m_regionSize = std::max(regionSize, m_headerSize + 16);
+   m_currentRegion = allocateRegion(m_regionSize);
+   static_cast<MemoryPoolRegionHeader*>(m_currentRegion)->prev = NULL;
    m_allocated = m_headerSize;
+   m_freeLists = NULL;
 }
 
 /**
@@ -43,8 +146,8 @@ MemoryPool::~MemoryPool()
    void *r = m_currentRegion;
    while(r != NULL)
    {
-      void *n = *((void **)r);
-      MemFree(r);
+      void *n = static_cast<MemoryPoolRegionHeader*>(r)->prev;
+      releaseRegion(r);
       r = n;
    }
 }
@@ -55,16 +158,28 @@ MemoryPool::~MemoryPool()
 void *MemoryPool::allocate(size_t size)
 {
    size_t allocationSize = ((size % 8) == 0) ? size : (size + 8 - size % 8);
+
+   if ((m_freeLists != NULL) && (allocationSize > 0) && (allocationSize <= MAX_FREE_LIST_BLOCK))
+   {
+      size_t c = allocationSize / 8 - 1;
+      void *p = m_freeLists[c];
+      if (p != NULL)
+      {
+         m_freeLists[c] = *static_cast<void**>(p);
+         return p;
+      }
+   }
+
    void *p;
-   if (m_allocated + allocationSize <= m_regionSize)
+   if (m_allocated + allocationSize <= m_currentRegionSize)
    {
       p = (char*)m_currentRegion + m_allocated;
       m_allocated += allocationSize;
    }
    else
    {
-      void *region = MemAlloc(std::max(m_regionSize, allocationSize + m_headerSize));
-      *((void **)region) = m_currentRegion;
+      void *region = allocateRegion(std::max(m_regionSize, allocationSize + m_headerSize));
+      static_cast<MemoryPoolRegionHeader*>(region)->prev = m_currentRegion;
       m_currentRegion = region;
       p = (char*)m_currentRegion + m_headerSize;
       m_allocated = m_headerSize + allocationSize;
@@ -72,6 +187,28 @@ void *MemoryPool::allocate(size_t size)
    return p;
 }
 
+/**
+ * Return memory block to pool. Blocks up to MAX_FREE_LIST_BLOCK bytes are placed into
+ * free list of their size class and reused by allocations of same size class, larger
+ * blocks are kept until pool is cleared.
+ */
+void MemoryPool::free(void *p, size_t size)
+{
+   size_t blockSize = ((size % 8) == 0) ? size : (size + 8 - size % 8);
+   if ((p == NULL) || (blockSize == 0) || (blockSize > MAX_FREE_LIST_BLOCK))
+      return;
+
+   if (m_freeLists == NULL)
+   {
+      m_freeLists = allocateArray<void*>(MEMPOOL_SIZE_CLASSES);
+      memset(m_freeLists, 0, sizeof(void*) * MEMPOOL_SIZE_CLASSES);
+   }
+
+   size_t c = blockSize / 8 - 1;
+   *static_cast<void**>(p) = m_freeLists[c];
+   m_freeLists[c] = p;
+}
+
 /**
  * Create copy of given C string within pool
  */
@@ -90,13 +227,32 @@ TCHAR *MemoryPool::copyString(const TCHAR *s)
  */
 void MemoryPool::clear()
 {
-   void *r = *((void **)m_currentRegion);
+   MemoryPoolRegionHeader *header = static_cast<MemoryPoolRegionHeader*>(m_currentRegion);
+   void *r = header->prev;
    while(r != NULL)
    {
-      void *n = *((void **)r);
-      MemFree(r);
+      void *n = static_cast<MemoryPoolRegionHeader*>(r)->prev;
+      releaseRegion(r);
       r = n;
    }
-   *((void **)m_currentRegion) = NULL;
+   header->prev = NULL;
    m_allocated = m_headerSize;
+   m_freeLists = NULL;
+}
+
+/**
+ * Release all memory allocated after given checkpoint. Checkpoint became invalid after
+ * clear() or rollback to earlier checkpoint.
+ */
+void MemoryPool::rollback(const MemoryPoolCheckpoint& cp)
+{
+   while(m_currentRegion != cp.region)
+   {
+      void *r = m_currentRegion;
+      m_currentRegion = static_cast<MemoryPoolRegionHeader*>(r)->prev;
+      releaseRegion(r);
+   }
+   m_currentRegionSize = static_cast<MemoryPoolRegionHeader*>(m_currentRegion)->size;
+   m_allocated = cp.allocated;
+   m_freeLists = NULL;
 }
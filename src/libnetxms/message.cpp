@@ -91,6 +91,93 @@ inline MessageField *CreateMessageField(MemoryPool& pool, size_t fieldSize)
    return entry;
 }
 
+/**
+ * Field offset index entry (used by message views)
+ */
+struct MessageFieldIndexEntry
+{
+   UINT32 id;
+   UINT32 offset;
+   MessageField *decoded;
+};
+
+/**
+ * Compare field index entries (by field ID, then by position in message)
+ */
+static int CompareIndexEntries(const void *e1, const void *e2)
+{
+   const MessageFieldIndexEntry *i1 = static_cast<const MessageFieldIndexEntry*>(e1);
+   const MessageFieldIndexEntry *i2 = static_cast<const MessageFieldIndexEntry*>(e2);
+   if (i1->id != i2->id)
+      return (i1->id < i2->id) ? -1 : 1;
+   return (i1->offset < i2->offset) ? -1 : ((i1->offset > i2->offset) ? 1 : 0);
+}
+
+/**
+ * Validate serialized field at given position and calculate it's size.
+ *
+ * @return field size or 0 if field is not valid
+ */
+static size_t ValidateField(const BYTE *data, size_t dataSize, size_t pos)
+{
+   if (pos + 8 > dataSize)
+      return 0;
+
+   const NXCP_MESSAGE_FIELD *field = reinterpret_cast<const NXCP_MESSAGE_FIELD*>(data + pos);
+   if ((pos + 12 > dataSize) &&
+       ((field->type == NXCP_DT_STRING) || (field->type == NXCP_DT_UTF8_STRING) || (field->type == NXCP_DT_BINARY)))
+      return 0;
+
+   size_t fieldSize = CalculateFieldSize(field, true);
+   return (pos + fieldSize <= dataSize) ? fieldSize : 0;
+}
+
+/**
+ * Create hash entry from serialized field and convert values to host format
+ */
+static MessageField *DecodeField(MemoryPool& pool, const NXCP_MESSAGE_FIELD *field, size_t fieldSize)
+{
+   MessageField *entry = CreateMessageField(pool, fieldSize);
+   entry->id = ntohl(field->fieldId);
+   memcpy(&entry->data, field, fieldSize);
+
+   entry->data.fieldId = ntohl(entry->data.fieldId);
+   switch(field->type)
+   {
+      case NXCP_DT_INT32:
+         entry->data.df_int32 = ntohl(entry->data.df_int32);
+         break;
+      case NXCP_DT_INT64:
+         entry->data.df_int64 = ntohq(entry->data.df_int64);
+         break;
+      case NXCP_DT_INT16:
+         entry->data.df_int16 = ntohs(entry->data.df_int16);
+         break;
+      case NXCP_DT_FLOAT:
+         entry->data.df_real = ntohd(entry->data.df_real);
+         break;
+      case NXCP_DT_STRING:
+#if !(WORDS_BIGENDIAN)
+         entry->data.df_string.length = ntohl(entry->data.df_string.length);
+         bswap_array_16(entry->data.df_string.value, entry->data.df_string.length / 2);
+#endif
+         break;
+      case NXCP_DT_BINARY:
+         entry->data.df_binary.length = ntohl(entry->data.df_binary.length);
+         break;
+      case NXCP_DT_UTF8_STRING:
+         entry->data.df_utf8string.length = ntohl(entry->data.df_utf8string.length);
+         break;
+      case NXCP_DT_INETADDR:
+         if (entry->data.df_inetaddr.family == NXCP_AF_INET)
+         {
+            entry->data.df_inetaddr.addr.v4 = ntohl(entry->data.df_inetaddr.addr.v4);
+         }
+         break;
+   }
+   return entry;
+}
+
 /**
  * Default constructor for NXCPMessage class
  */
@@ -103,6 +190,13 @@ NXCPMessage::NXCPMessage(int version) : m_pool(NXCP_DEFAULT_SIZE_HINT)
    m_version = version;
    m_data = NULL;
    m_dataSize = 0;
+   m_rawFields = NULL;
+   m_rawFieldsSize = 0;
+   m_rawFieldCount = 0;
+   m_external = false;
+   m_buffer = NULL;
+   m_index = NULL;
+   m_indexSize = -1;
 }
 
 /**
@@ -117,6 +211,13 @@ NXCPMessage::NXCPMessage(UINT16 code, UINT32 id, int version) : m_pool(NXCP_DEFA
    m_version = version;
    m_data = NULL;
    m_dataSize = 0;
+   m_rawFields = NULL;
+   m_rawFieldsSize = 0;
+   m_rawFieldCount = 0;
+   m_external = false;
+   m_buffer = NULL;
+   m_index = NULL;
+   m_indexSize = -1;
 }
 
 /**
@@ -129,12 +230,28 @@ NXCPMessage::NXCPMessage(NXCPMessage *msg) : m_pool(msg->m_pool.regionSize())
    m_flags = msg->m_flags;
    m_version = msg->m_version;
    m_fields = NULL;
+   m_rawFields = NULL;
+   m_rawFieldsSize = 0;
+   m_rawFieldCount = 0;
+   m_external = false;
+   m_buffer = NULL;
+   m_index = NULL;
+   m_indexSize = -1;
 
    if (m_flags & MF_BINARY)
    {
       m_dataSize = msg->m_dataSize;
       m_data = m_pool.copyMemoryBlock(msg->m_data, m_dataSize);
    }
+   else if (msg->m_rawFields != NULL)
+   {
+      // Copy serialized fields, index will be rebuilt on first access
+      m_data = NULL;
+      m_dataSize = 0;
+      m_rawFieldsSize = msg->m_rawFieldsSize;
+      m_rawFieldCount = msg->m_rawFieldCount;
+      m_rawFields = m_pool.copyMemoryBlock(msg->m_rawFields, m_rawFieldsSize);
+   }
    else
    {
       m_data = NULL;
@@ -156,7 +273,26 @@ NXCPMessage::NXCPMessage(NXCPMessage *msg) : m_pool(msg->m_pool.regionSize())
  */
 NXCPMessage *NXCPMessage::deserialize(const NXCP_MESSAGE *rawMsg, int version)
 {
-   NXCPMessage *msg = new NXCPMessage(rawMsg, version);
+   NXCPMessage *msg = new NXCPMessage(rawMsg, version, false);
+   if (msg->isValid())
+      return msg;
+   delete msg;
+   return NULL;
+}
+
+/**
+ * Create NXCPMessage object which references serialized message instead of
+ * copying it. Field boundaries are validated on creation, fields are decoded
+ * on first access. Serialized
+ * message should remain valid until message object is destroyed or detach()
+ * is called. Unlike normal messages, views should not be read from multiple
+ * threads concurrently.
+ *
+ * @return message object or NULL on failure
+ */
+NXCPMessage *NXCPMessage::createView(const NXCP_MESSAGE *rawMsg, int version)
+{
+   NXCPMessage *msg = new NXCPMessage(rawMsg, version, true);
    if (msg->isValid())
       return msg;
    delete msg;
@@ -175,12 +311,19 @@ inline size_t SizeHint(const NXCP_MESSAGE *msg)
 /**
  * Create NXCPMessage object from serialized message
  */
-NXCPMessage::NXCPMessage(const NXCP_MESSAGE *msg, int version) : m_pool(SizeHint(msg))
+NXCPMessage::NXCPMessage(const NXCP_MESSAGE *msg, int version, bool view) : m_pool(view ? NXCP_DEFAULT_SIZE_HINT : SizeHint(msg))
 {
    m_flags = ntohs(msg->flags);
    m_code = ntohs(msg->code);
    m_id = ntohl(msg->id);
    m_fields = NULL;
+   m_rawFields = NULL;
+   m_rawFieldsSize = 0;
+   m_rawFieldCount = 0;
+   m_external = false;
+   m_buffer = NULL;
+   m_index = NULL;
+   m_indexSize = -1;
 
    int v = getEncodedProtocolVersion();
    m_version = (v != 0) ? v : version; // Use encoded version if present
@@ -220,6 +363,11 @@ NXCPMessage::NXCPMessage(const NXCP_MESSAGE *msg, int version) : m_pool(SizeHint
          }
          inflateEnd(&stream);
       }
+      else if (view)
+      {
+         m_data = const_cast<BYTE*>(reinterpret_cast<const BYTE*>(msg->fields));
+         m_external = true;
+      }
       else
       {
          m_data = m_pool.copyMemoryBlock(reinterpret_cast<const BYTE*>(msg->fields), m_dataSize);
@@ -271,73 +419,31 @@ NXCPMessage::NXCPMessage(const NXCP_MESSAGE *msg, int version) : m_pool(SizeHint
       }
 
       int fieldCount = (int)ntohl(msg->numFields);
-      size_t pos = 0;
-      for(int f = 0; f < fieldCount; f++)
+      if (view)
       {
-         NXCP_MESSAGE_FIELD *field = (NXCP_MESSAGE_FIELD *)(msgData + pos);
-
-         // Validate position inside message
-         if (pos > msgDataSize - 8)
-         {
-            m_version = -1;   // error indicator
-            break;
-         }
-         if ((pos > msgDataSize - 12) &&
-             ((field->type == NXCP_DT_STRING) || (field->type == NXCP_DT_UTF8_STRING) || (field->type == NXCP_DT_BINARY)))
-         {
+         // Keep reference to serialized fields and validate them while building index
+         m_rawFields = msgData;
+         m_rawFieldsSize = msgDataSize;
+         m_rawFieldCount = fieldCount;
+         m_external = (msgData == (BYTE *)msg + NXCP_HEADER_SIZE);
+         if (!buildIndex())
             m_version = -1;   // error indicator
-            break;
-         }
+         return;
+      }
 
-         // Calculate and validate field size
-         size_t fieldSize = CalculateFieldSize(field, true);
-         if (pos + fieldSize > msgDataSize)
+      size_t pos = 0;
+      for(int f = 0; f < fieldCount; f++)
+      {
+         // Validate position inside message and calculate field size
+         size_t fieldSize = ValidateField(msgData, msgDataSize, pos);
+         if (fieldSize == 0)
          {
             m_version = -1;   // error indicator
             break;
          }
 
          // Create new entry
-         MessageField *entry = CreateMessageField(m_pool, fieldSize);
-         entry->id = ntohl(field->fieldId);
-         memcpy(&entry->data, field, fieldSize);
-
-         // Convert values to host format
-         entry->data.fieldId = ntohl(entry->data.fieldId);
-         switch(field->type)
-         {
-            case NXCP_DT_INT32:
-               entry->data.df_int32 = ntohl(entry->data.df_int32);
-               break;
-            case NXCP_DT_INT64:
-               entry->data.df_int64 = ntohq(entry->data.df_int64);
-               break;
-            case NXCP_DT_INT16:
-               entry->data.df_int16 = ntohs(entry->data.df_int16);
-               break;
-            case NXCP_DT_FLOAT:
-               entry->data.df_real = ntohd(entry->data.df_real);
-               break;
-            case NXCP_DT_STRING:
-#if !(WORDS_BIGENDIAN)
-               entry->data.df_string.length = ntohl(entry->data.df_string.length);
-               bswap_array_16(entry->data.df_string.value, entry->data.df_string.length / 2);
-#endif
-               break;
-            case NXCP_DT_BINARY:
-               entry->data.df_binary.length = ntohl(entry->data.df_binary.length);
-               break;
-            case NXCP_DT_UTF8_STRING:
-               entry->data.df_utf8string.length = ntohl(entry->data.df_utf8string.length);
-               break;
-            case NXCP_DT_INETADDR:
-               if (entry->data.df_inetaddr.family == NXCP_AF_INET)
-               {
-                  entry->data.df_inetaddr.addr.v4 = ntohl(entry->data.df_inetaddr.addr.v4);
-               }
-               break;
-         }
-
+         MessageField *entry = DecodeField(m_pool, reinterpret_cast<NXCP_MESSAGE_FIELD*>(msgData + pos), fieldSize);
          HASH_ADD_INT(m_fields, id, entry);
 
          // Starting from version 2, all variables should be 8-byte aligned
@@ -354,6 +460,152 @@ NXCPMessage::NXCPMessage(const NXCP_MESSAGE *msg, int version) : m_pool(SizeHint
  */
 NXCPMessage::~NXCPMessage()
 {
+   MemFree(m_buffer);
+}
+
+/**
+ * Build field offset index for message view
+ *
+ * @return false if message contains invalid field
+ */
+bool NXCPMessage::buildIndex() const
+{
+   // Each field occupies at least 8 bytes
+   int maxCount = static_cast<int>(std::min(static_cast<size_t>(m_rawFieldCount), m_rawFieldsSize / 8));
+   m_index = m_pool.allocateArray<MessageFieldIndexEntry>(std::max(maxCount, 1));
+   m_indexSize = 0;
+
+   size_t pos = 0;
+   for(int f = 0; f < m_rawFieldCount; f++)
+   {
+      size_t fieldSize = (f < maxCount) ? ValidateField(m_rawFields, m_rawFieldsSize, pos) : 0;
+      if (fieldSize == 0)
+      {
+         TCHAR buffer[64];
+         nxlog_debug(6, _T("NXCPMessage: invalid field at offset %d in message %s with ID %d"), (int)pos, NXCPMessageCodeName(m_code, buffer), m_id);
+         m_indexSize = 0;
+         return false;
+      }
+
+      MessageFieldIndexEntry *e = &m_index[m_indexSize++];
+      e->id = ntohl(reinterpret_cast<const NXCP_MESSAGE_FIELD*>(m_rawFields + pos)->fieldId);
+      e->offset = static_cast<UINT32>(pos);
+      e->decoded = NULL;
+
+      // Starting from version 2, all variables should be 8-byte aligned
+      if (m_version >= 2)
+         pos += fieldSize + ((8 - (fieldSize % 8)) & 7);
+      else
+         pos += fieldSize;
+   }
+
+   qsort(m_index, m_indexSize, sizeof(MessageFieldIndexEntry), CompareIndexEntries);
+   return true;
+}
+
+/**
+ * Find field by ID in message view. Field is decoded on first access.
+ */
+NXCP_MESSAGE_FIELD *NXCPMessage::findInView(UINT32 fieldId) const
+{
+   if (m_indexSize == -1)
+      buildIndex();
+
+   // Find last entry with given ID (later fields override earlier ones)
+   int found = -1;
+   int l = 0, r = m_indexSize - 1;
+   while(l <= r)
+   {
+      int m = (l + r) / 2;
+      if (m_index[m].id <= fieldId)
+      {
+         if (m_index[m].id == fieldId)
+            found = m;
+         l = m + 1;
+      }
+      else
+      {
+         r = m - 1;
+      }
+   }
+   if (found == -1)
+      return NULL;
+
+   MessageFieldIndexEntry *e = &m_index[found];
+   if (e->decoded == NULL)
+   {
+      const NXCP_MESSAGE_FIELD *field = reinterpret_cast<const NXCP_MESSAGE_FIELD*>(m_rawFields + e->offset);
+      e->decoded = DecodeField(m_pool, field, CalculateFieldSize(field, true));
+   }
+   return &e->decoded->data;
+}
+
+/**
+ * Convert message view into regular message (decode all fields and build field hash)
+ */
+void NXCPMessage::materialize()
+{
+   if (m_rawFields == NULL)
+      return;
+
+   if (m_indexSize == -1)
+      buildIndex();
+
+   // Index is ordered by field position within same ID, so last field wins like in fully parsed message
+   for(int i = 0; i < m_indexSize; i++)
+   {
+      MessageFieldIndexEntry *e = &m_index[i];
+      if (e->decoded == NULL)
+      {
+         const NXCP_MESSAGE_FIELD *field = reinterpret_cast<const NXCP_MESSAGE_FIELD*>(m_rawFields + e->offset);
+         e->decoded = DecodeField(m_pool, field, CalculateFieldSize(field, true));
+      }
+      HASH_ADD_INT(m_fields, id, e->decoded);
+   }
+
+   m_rawFields = NULL;
+   m_rawFieldsSize = 0;
+   m_rawFieldCount = 0;
+   m_index = NULL;
+   m_indexSize = -1;
+   if (!(m_flags & MF_BINARY))
+      m_external = false;
+}
+
+/**
+ * Copy referenced serialized data into message's own memory, so message
+ * can outlive receive buffer it was created from. Does nothing for
+ * regular messages.
+ */
+void NXCPMessage::detach()
+{
+   if (!m_external)
+      return;
+
+   if (m_rawFields != NULL)
+      m_rawFields = m_pool.copyMemoryBlock(m_rawFields, m_rawFieldsSize);
+   else if (m_data != NULL)
+      m_data = m_pool.copyMemoryBlock(m_data, m_dataSize);
+   m_external = false;
+}
+
+/**
+ * Take ownership of serialized message this view was created from, so message
+ * can be passed to another thread without copying. Buffer should be allocated
+ * with MemAlloc and will be freed when message object is destroyed.
+ */
+void NXCPMessage::adoptBuffer(NXCP_MESSAGE *rawMsg)
+{
+   if (m_external)
+   {
+      MemFree(m_buffer);
+      m_buffer = rawMsg;
+      m_external = false;
+   }
+   else
+   {
+      MemFree(rawMsg);  // message does not reference this buffer
+   }
 }
 
 /**
@@ -361,6 +613,9 @@ NXCPMessage::~NXCPMessage()
  */
 NXCP_MESSAGE_FIELD *NXCPMessage::find(UINT32 fieldId) const
 {
+   if (m_rawFields != NULL)
+      return findInView(fieldId);
+
    MessageField *entry;
    HASH_FIND_INT(m_fields, &fieldId, entry);
    return (entry != NULL) ? &entry->data : NULL;
@@ -376,6 +631,9 @@ void *NXCPMessage::set(UINT32 fieldId, BYTE type, const void *value, bool isSign
    if (m_flags & MF_BINARY)
       return NULL;
 
+   if (m_rawFields != NULL)
+      materialize();
+
    size_t length, bufferLength;
 #if defined(UNICODE_UCS2) && defined(UNICODE)
 #define __buffer value
@@ -1090,17 +1348,23 @@ uuid NXCPMessage::getFieldAsGUID(UINT32 fieldId) const
 }
 
 /**
- * Build protocol message ready to be send over the wire
+ * Calculate size of serialized (uncompressed) message
  */
-NXCP_MESSAGE *NXCPMessage::serialize(bool allowCompression) const
+size_t NXCPMessage::calculateSerializedSize(UINT32 *fieldCount) const
 {
-   // Calculate message size
    size_t size = NXCP_HEADER_SIZE;
-   UINT32 fieldCount = 0;
+   *fieldCount = 0;
    if (m_flags & MF_BINARY)
    {
       size += m_dataSize;
-      fieldCount = (UINT32)m_dataSize;
+      *fieldCount = (UINT32)m_dataSize;
+      size += (8 - (size % 8)) & 7;
+   }
+   else if (m_rawFields != NULL)
+   {
+      // Message view - fields are already in wire format
+      size += m_rawFieldsSize;
+      *fieldCount = static_cast<UINT32>(m_rawFieldCount);
       size += (8 - (size % 8)) & 7;
    }
    else
@@ -1113,7 +1377,7 @@ NXCP_MESSAGE *NXCPMessage::serialize(bool allowCompression) const
             size += fieldSize + ((8 - (fieldSize % 8)) & 7);
          else
             size += fieldSize;
-         fieldCount++;
+         (*fieldCount)++;
       }
 
       // Message should be aligned to 8 bytes boundary
@@ -1122,6 +1386,17 @@ NXCP_MESSAGE *NXCPMessage::serialize(bool allowCompression) const
       if (m_version < 2)
          size += (8 - (size % 8)) & 7;
    }
+   return size;
+}
+
+/**
+ * Build protocol message ready to be send over the wire
+ */
+NXCP_MESSAGE *NXCPMessage::serialize(bool allowCompression) const
+{
+   // Calculate message size
+   UINT32 fieldCount;
+   size_t size = calculateSerializedSize(&fieldCount);
 
    // Create message
    NXCP_MESSAGE *msg = static_cast<NXCP_MESSAGE*>(MemAlloc(size));
@@ -1137,6 +1412,10 @@ NXCP_MESSAGE *NXCPMessage::serialize(bool allowCompression) const
    {
       memcpy(msg->fields, m_data, m_dataSize);
    }
+   else if (m_rawFields != NULL)
+   {
+      memcpy(msg->fields, m_rawFields, m_rawFieldsSize);
+   }
    else
    {
       NXCP_MESSAGE_FIELD *field = (NXCP_MESSAGE_FIELD *)((char *)msg + NXCP_HEADER_SIZE);
@@ -1235,6 +1514,573 @@ NXCP_MESSAGE *NXCPMessage::serialize(bool allowCompression) const
    return msg;
 }
 
+/**
+ * Maximum number of data blocks in stream writer
+ */
+#define STREAM_WRITER_MAX_BLOCKS    64
+
+/**
+ * Staging buffer size for stream writer
+ */
+#define STREAM_WRITER_BUFFER_SIZE   65536
+
+/**
+ * Minimal size of data block passed to output by reference
+ */
+#define STREAM_WRITER_MIN_REF_SIZE  1024
+
+/**
+ * Zero bytes for padding
+ */
+static const BYTE s_padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+/**
+ * Serialized message stream writer. Fields are converted to network format
+ * in staging buffer, while large binary and UTF-8 string values are passed
+ * to output by reference. Output receives serialized message as sequence of
+ * data blocks.
+ */
+class MessageStreamWriter
+{
+private:
+   SendBlock m_blocks[STREAM_WRITER_MAX_BLOCKS];
+   int m_blockCount;
+   BYTE *m_buffer;
+   size_t m_bufferPos;
+   bool m_success;
+
+protected:
+   virtual bool write(const SendBlock *blocks, int count) = 0;
+
+public:
+   MessageStreamWriter()
+   {
+      m_blockCount = 0;
+      m_buffer = MemAllocArrayNoInit<BYTE>(STREAM_WRITER_BUFFER_SIZE);
+      m_bufferPos = 0;
+      m_success = true;
+   }
+
+   virtual ~MessageStreamWriter()
+   {
+      MemFree(m_buffer);
+   }
+
+   /**
+    * Reserve space in staging buffer (size should not exceed staging buffer size)
+    */
+   BYTE *reserve(size_t size)
+   {
+      if ((STREAM_WRITER_BUFFER_SIZE - m_bufferPos < size) || (m_blockCount == STREAM_WRITER_MAX_BLOCKS))
+         flush();
+      BYTE *p = m_buffer + m_bufferPos;
+      m_bufferPos += size;
+      if ((m_blockCount > 0) && (static_cast<const BYTE*>(m_blocks[m_blockCount - 1].data) + m_blocks[m_blockCount - 1].size == p))
+      {
+         m_blocks[m_blockCount - 1].size += size;
+      }
+      else
+      {
+         m_blocks[m_blockCount].data = p;
+         m_blocks[m_blockCount].size = size;
+         m_blockCount++;
+      }
+      return p;
+   }
+
+   /**
+    * Copy data to staging buffer
+    */
+   void copy(const void *data, size_t size)
+   {
+      const BYTE *curr = static_cast<const BYTE*>(data);
+      while(size > 0)
+      {
+         size_t chunk = std::min(size, STREAM_WRITER_BUFFER_SIZE - m_bufferPos);
+         if (chunk == 0)
+         {
+            flush();
+            continue;
+         }
+         memcpy(reserve(chunk), curr, chunk);
+         curr += chunk;
+         size -= chunk;
+      }
+   }
+
+   /**
+    * Pass data block to output by reference. Data should remain valid until next flush.
+    */
+   void reference(const void *data, size_t size)
+   {
+      if (size < STREAM_WRITER_MIN_REF_SIZE)
+      {
+         copy(data, size);
+         return;
+      }
+      if (m_blockCount == STREAM_WRITER_MAX_BLOCKS)
+         flush();
+      m_blocks[m_blockCount].data = data;
+      m_blocks[m_blockCount].size = size;
+      m_blockCount++;
+   }
+
+   /**
+    * Pass all accumulated blocks to output
+    */
+   bool flush()
+   {
+      if ((m_blockCount > 0) && m_success)
+         m_success = write(m_blocks, m_blockCount);
+      m_blockCount = 0;
+      m_bufferPos = 0;
+      return m_success;
+   }
+};
+
+/**
+ * Stream writer which sends data to socket using scatter/gather I/O
+ */
+class SocketMessageWriter : public MessageStreamWriter
+{
+private:
+   SOCKET m_socket;
+
+protected:
+   virtual bool write(const SendBlock *blocks, int count) override
+   {
+      size_t size = 0;
+      for(int i = 0; i < count; i++)
+         size += blocks[i].size;
+      return SendVectorEx(m_socket, blocks, count, INVALID_MUTEX_HANDLE) == static_cast<ssize_t>(size);
+   }
+
+public:
+   SocketMessageWriter(SOCKET s) : MessageStreamWriter()
+   {
+      m_socket = s;
+   }
+};
+
+/**
+ * Stream writer which calculates CRC32 checksum of serialized message
+ */
+class ChecksumMessageWriter : public MessageStreamWriter
+{
+private:
+   UINT32 m_checksum;
+
+protected:
+   virtual bool write(const SendBlock *blocks, int count) override
+   {
+      for(int i = 0; i < count; i++)
+         m_checksum = CalculateCRC32(static_cast<const BYTE*>(blocks[i].data), static_cast<UINT32>(blocks[i].size), m_checksum);
+      return true;
+   }
+
+public:
+   ChecksumMessageWriter() : MessageStreamWriter()
+   {
+      m_checksum = 0;
+   }
+
+   UINT32 getChecksum()
+   {
+      flush();
+      return m_checksum;
+   }
+};
+
+/**
+ * Stream writer which encrypts serialized message block by block and sends it to socket
+ */
+class EncryptingMessageWriter : public MessageStreamWriter
+{
+private:
+   SOCKET m_socket;
+   NXCPEncryptionContext *m_context;
+   BYTE *m_output;
+   size_t m_outputPos;
+   int m_padding;
+   bool m_started;
+
+   bool sendOutput()
+   {
+      bool success = (SendEx(m_socket, m_output, m_outputPos, 0, INVALID_MUTEX_HANDLE) == static_cast<ssize_t>(m_outputPos));
+      m_outputPos = 0;
+      return success;
+   }
+
+protected:
+   virtual bool write(const SendBlock *blocks, int count) override
+   {
+      for(int i = 0; i < count; i++)
+      {
+         const BYTE *data = static_cast<const BYTE*>(blocks[i].data);
+         size_t size = blocks[i].size;
+         while(size > 0)
+         {
+            size_t chunk = std::min(size, static_cast<size_t>(STREAM_WRITER_BUFFER_SIZE));
+            if (m_outputPos + chunk + 64 > STREAM_WRITER_BUFFER_SIZE * 2)
+            {
+               if (!sendOutput())
+                  return false;
+            }
+            m_outputPos += m_context->encryptStreamUpdate(data, chunk, m_output + m_outputPos);
+            data += chunk;
+            size -= chunk;
+         }
+      }
+      return true;
+   }
+
+public:
+   EncryptingMessageWriter(SOCKET s, NXCPEncryptionContext *context) : MessageStreamWriter()
+   {
+      m_socket = s;
+      m_context = context;
+      m_output = MemAllocArrayNoInit<BYTE>(STREAM_WRITER_BUFFER_SIZE * 2);
+      m_outputPos = 0;
+      m_padding = 0;
+      m_started = false;
+   }
+
+   virtual ~EncryptingMessageWriter()
+   {
+      if (m_started)
+         m_context->encryptStreamEnd(m_output);  // Unlock encryptor
+      MemFree(m_output);
+   }
+
+   bool begin(size_t msgSize, UINT32 checksum)
+   {
+      m_started = m_context->encryptStreamBegin(msgSize, checksum, m_output, &m_outputPos);
+      if (m_started)
+         m_padding = reinterpret_cast<NXCP_ENCRYPTED_MESSAGE*>(m_output)->padding;
+      return m_started;
+   }
+
+   bool finish()
+   {
+      bool success = flush();
+      m_outputPos += m_context->encryptStreamEnd(m_output + m_outputPos);
+      m_started = false;
+      memset(m_output + m_outputPos, 0, m_padding);
+      m_outputPos += m_padding;
+      return sendOutput() && success;
+   }
+};
+
+/**
+ * Stream writer which compresses message payload on the fly. Compressed
+ * message is built in memory because message header should contain size
+ * of compressed message.
+ */
+class DeflateMessageWriter : public MessageStreamWriter
+{
+private:
+   z_stream m_stream;
+   BYTE *m_output;
+   size_t m_outputSize;
+   size_t m_maxOutputSize;
+   bool m_valid;
+
+   bool growOutput()
+   {
+      size_t used = m_outputSize - m_stream.avail_out;
+      if (used >= m_maxOutputSize)
+         return false;  // compression is not beneficial
+      size_t newSize = std::min(m_outputSize * 2, m_maxOutputSize + 64);
+      m_output = MemRealloc(m_output, newSize);
+      m_stream.next_out = m_output + used;
+      m_stream.avail_out = static_cast<UINT32>(newSize - used);
+      m_outputSize = newSize;
+      return true;
+   }
+
+protected:
+   virtual bool write(const SendBlock *blocks, int count) override
+   {
+      for(int i = 0; (i < count) && m_valid; i++)
+      {
+         m_stream.next_in = static_cast<BYTE*>(const_cast<void*>(blocks[i].data));
+         m_stream.avail_in = static_cast<UINT32>(blocks[i].size);
+         while((m_stream.avail_in > 0) && m_valid)
+         {
+            if ((m_stream.avail_out == 0) && !growOutput())
+            {
+               m_valid = false;
+               break;
+            }
+            if (deflate(&m_stream, Z_NO_FLUSH) == Z_STREAM_ERROR)
+               m_valid = false;
+         }
+      }
+      return m_valid;
+   }
+
+public:
+   DeflateMessageWriter(size_t msgSize) : MessageStreamWriter()
+   {
+      // Compressed message should be smaller than original one
+      m_maxOutputSize = msgSize - 4;
+      m_outputSize = std::min(m_maxOutputSize + 64, static_cast<size_t>(STREAM_WRITER_BUFFER_SIZE));
+      m_output = MemAllocArrayNoInit<BYTE>(m_outputSize);
+      m_stream.zalloc = Z_NULL;
+      m_stream.zfree = Z_NULL;
+      m_stream.opaque = Z_NULL;
+      m_stream.avail_in = 0;
+      m_stream.next_in = Z_NULL;
+      m_valid = (deflateInit(&m_stream, 9) == Z_OK);
+      m_stream.next_out = m_output + NXCP_HEADER_SIZE + 4;
+      m_stream.avail_out = static_cast<UINT32>(m_outputSize - NXCP_HEADER_SIZE - 4);
+   }
+
+   virtual ~DeflateMessageWriter()
+   {
+      deflateEnd(&m_stream);
+      MemFree(m_output);
+   }
+
+   /**
+    * Finish compression and build compressed message. Returns NULL if
+    * compression failed or compressed message is not smaller than original.
+    */
+   NXCP_MESSAGE *finish(const NXCP_MESSAGE *header, size_t msgSize)
+   {
+      if (!flush() || !m_valid)
+         return NULL;
+
+      m_stream.next_in = NULL;
+      m_stream.avail_in = 0;
+      while(true)
+      {
+         int rc = deflate(&m_stream, Z_FINISH);
+         if (rc == Z_STREAM_END)
+            break;
+         if (((rc != Z_OK) && (rc != Z_BUF_ERROR)) || ((m_stream.avail_out == 0) && !growOutput()))
+            return NULL;
+      }
+
+      size_t compMsgSize = m_outputSize - m_stream.avail_out;
+      // Message should be aligned to 8 bytes boundary
+      compMsgSize += (8 - (compMsgSize % 8)) & 7;
+      if (compMsgSize >= msgSize - 4)
+         return NULL;
+      if (compMsgSize > m_outputSize)
+         m_output = MemRealloc(m_output, compMsgSize);
+      memset(m_output + m_outputSize - m_stream.avail_out, 0, compMsgSize - (m_outputSize - m_stream.avail_out));
+
+      NXCP_MESSAGE *msg = reinterpret_cast<NXCP_MESSAGE*>(m_output);
+      memcpy(msg, header, NXCP_HEADER_SIZE);
+      msg->flags |= htons(MF_COMPRESSED);
+      memcpy(m_output + NXCP_HEADER_SIZE, &header->size, 4); // Save size of uncompressed message
+      msg->size = htonl(static_cast<UINT32>(compMsgSize));
+      m_output = NULL;
+      return msg;
+   }
+};
+
+/**
+ * Serialize message fields (everything after message header) to stream writer
+ */
+void NXCPMessage::serializeFields(MessageStreamWriter *writer) const
+{
+   size_t size = NXCP_HEADER_SIZE;
+   if (m_flags & MF_BINARY)
+   {
+      writer->reference(m_data, m_dataSize);
+      size += m_dataSize;
+   }
+   else if (m_rawFields != NULL)
+   {
+      writer->reference(m_rawFields, m_rawFieldsSize);
+      size += m_rawFieldsSize;
+   }
+   else
+   {
+      MessageField *entry, *tmp;
+      HASH_ITER(hh, m_fields, entry, tmp)
+      {
+         size_t fieldSize = CalculateFieldSize(&entry->data, false);
+         switch(entry->data.type)
+         {
+            case NXCP_DT_STRING:
+               {
+                  NXCP_MESSAGE_FIELD *field = reinterpret_cast<NXCP_MESSAGE_FIELD*>(writer->reserve(12));
+                  memcpy(field, &entry->data, 12);
+                  field->fieldId = htonl(field->fieldId);
+                  field->df_string.length = htonl(field->df_string.length);
+#if WORDS_BIGENDIAN
+                  writer->reference(entry->data.df_string.value, entry->data.df_string.length);
+#else
+                  // Convert string to network byte order piece by piece
+                  const BYTE *value = reinterpret_cast<const BYTE*>(entry->data.df_string.value);
+                  size_t remaining = entry->data.df_string.length;
+                  while(remaining > 0)
+                  {
+                     size_t chunk = std::min(remaining, static_cast<size_t>(4096));
+                     BYTE *p = writer->reserve(chunk);
+                     memcpy(p, value, chunk);
+                     bswap_array_16(reinterpret_cast<UINT16*>(p), static_cast<int>(chunk / 2));
+                     value += chunk;
+                     remaining -= chunk;
+                  }
+#endif
+               }
+               break;
+            case NXCP_DT_BINARY:
+            case NXCP_DT_UTF8_STRING:
+               {
+                  NXCP_MESSAGE_FIELD *field = reinterpret_cast<NXCP_MESSAGE_FIELD*>(writer->reserve(12));
+                  memcpy(field, &entry->data, 12);
+                  field->fieldId = htonl(field->fieldId);
+                  field->df_binary.length = htonl(field->df_binary.length);
+                  writer->reference(entry->data.df_binary.value, entry->data.df_binary.length);
+               }
+               break;
+            default:
+               {
+                  NXCP_MESSAGE_FIELD *field = reinterpret_cast<NXCP_MESSAGE_FIELD*>(writer->reserve(fieldSize));
+                  memcpy(field, &entry->data, fieldSize);
+                  field->fieldId = htonl(field->fieldId);
+                  switch(field->type)
+                  {
+                     case NXCP_DT_INT32:
+                        field->df_int32 = htonl(field->df_int32);
+                        break;
+                     case NXCP_DT_INT64:
+                        field->df_int64 = htonq(field->df_int64);
+                        break;
+                     case NXCP_DT_INT16:
+                        field->df_int16 = htons(field->df_int16);
+                        break;
+                     case NXCP_DT_FLOAT:
+                        field->df_real = htond(field->df_real);
+                        break;
+                     case NXCP_DT_INETADDR:
+                        if (field->df_inetaddr.family == NXCP_AF_INET)
+                        {
+                           field->df_inetaddr.addr.v4 = htonl(field->df_inetaddr.addr.v4);
+                        }
+                        break;
+                  }
+               }
+               break;
+         }
+         size += fieldSize;
+
+         if (m_version >= 2)
+         {
+            size_t padding = (8 - (fieldSize % 8)) & 7;
+            writer->copy(s_padding, padding);
+            size += padding;
+         }
+      }
+   }
+
+   // Message should be aligned to 8 bytes boundary
+   writer->copy(s_padding, (8 - (size % 8)) & 7);
+}
+
+/**
+ * Serialize message directly to socket. Fields are written in chunks using
+ * scatter/gather I/O, so complete serialized message is never built in memory.
+ * If compression is allowed payload is compressed on the fly (compressed message
+ * still has to be built in memory because message header should contain it's size).
+ * If encryption context is provided message is encrypted chunk by chunk.
+ * Produced byte stream is identical to one produced by serialize().
+ *
+ * @param s socket
+ * @param mutex optional mutex to be locked while message is being sent
+ * @param ctx optional encryption context
+ * @param allowCompression true if message can be compressed
+ * @param wireSize optional pointer to variable which will receive size of sent message (before encryption)
+ * @return true on success
+ */
+bool NXCPMessage::sendTo(SOCKET s, MUTEX mutex, NXCPEncryptionContext *ctx, bool allowCompression, size_t *wireSize) const
+{
+   UINT32 fieldCount;
+   size_t size = calculateSerializedSize(&fieldCount);
+
+   NXCP_MESSAGE header;
+   header.code = htons(m_code);
+   header.flags = htons(m_flags | MF_NXCP_VERSION(m_version));
+   header.size = htonl(static_cast<UINT32>(size));
+   header.id = htonl(m_id);
+   header.numFields = htonl(fieldCount);
+
+   // Compress message payload if requested. Compression supported starting with NXCP version 4.
+   NXCP_MESSAGE *compressedMsg = NULL;
+   if ((m_version >= 4) && allowCompression && (size > 128) && !(m_flags & (MF_STREAM | MF_DONT_COMPRESS)))
+   {
+      DeflateMessageWriter writer(size);
+      serializeFields(&writer);
+      compressedMsg = writer.finish(&header, size);
+   }
+
+   if (wireSize != NULL)
+      *wireSize = (compressedMsg != NULL) ? ntohl(compressedMsg->size) : size;
+
+   bool encrypt = (ctx != NULL) && !(m_flags & MF_DONT_ENCRYPT);
+   bool success;
+
+   // Checksum of entire message is part of encrypted header, so message is serialized
+   // twice. Checksum pass does not touch socket and is done before taking the lock.
+   UINT32 checksum = 0;
+   if (encrypt && (compressedMsg == NULL))
+   {
+      ChecksumMessageWriter checksumWriter;
+      checksumWriter.copy(&header, NXCP_HEADER_SIZE);
+      serializeFields(&checksumWriter);
+      checksum = checksumWriter.getChecksum();
+   }
+
+   if (mutex != INVALID_MUTEX_HANDLE)
+      MutexLock(mutex);
+
+   if (compressedMsg != NULL)
+   {
+      if (encrypt)
+      {
+         NXCP_ENCRYPTED_MESSAGE *emsg = ctx->encryptMessage(compressedMsg);
+         success = (emsg != NULL) && (SendEx(s, emsg, ntohl(emsg->size), 0, INVALID_MUTEX_HANDLE) == static_cast<ssize_t>(ntohl(emsg->size)));
+         MemFree(emsg);
+      }
+      else
+      {
+         success = (SendEx(s, compressedMsg, ntohl(compressedMsg->size), 0, INVALID_MUTEX_HANDLE) == static_cast<ssize_t>(ntohl(compressedMsg->size)));
+      }
+      MemFree(compressedMsg);
+   }
+   else if (encrypt)
+   {
+      EncryptingMessageWriter writer(s, ctx);
+      if (writer.begin(size, checksum))
+      {
+         writer.copy(&header, NXCP_HEADER_SIZE);
+         serializeFields(&writer);
+         success = writer.finish();
+      }
+      else
+      {
+         success = false;
+      }
+   }
+   else
+   {
+      SocketMessageWriter writer(s);
+      writer.copy(&header, NXCP_HEADER_SIZE);
+      serializeFields(&writer);
+      success = writer.flush();
+   }
+
+   if (mutex != INVALID_MUTEX_HANDLE)
+      MutexUnlock(mutex);
+
+   return success;
+}
+
 /**
  * Delete all variables
  */
@@ -1243,6 +2089,12 @@ void NXCPMessage::deleteAllFields()
    m_fields = NULL;
    m_data = NULL;
    m_dataSize = 0;
+   m_rawFields = NULL;
+   m_rawFieldsSize = 0;
+   m_rawFieldCount = 0;
+   m_external = false;
+   m_index = NULL;
+   m_indexSize = -1;
    m_pool.clear();
 }
 
@@ -1605,6 +2457,8 @@ void NXCPMessage::setProtocolVersion(int version)
 {
    if ((m_version >= 5) && (version < 5))
    {
+      materialize();
+
       // Convert all UTF8-STRING fields to STRING
       IntegerArray<UINT32> stringFields(256, 256);
       MessageField *entry, *tmp;
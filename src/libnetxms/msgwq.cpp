@@ -23,57 +23,84 @@
 
 #include "libnetxms.h"
 #include <nxcpapi.h>
+#include <timer_wheel.h>
 
-/** 
- * Interval between checking messages TTL in milliseconds
+/**
+ * Maximum interval between housekeeper runs in milliseconds
  */
 #define TTL_CHECK_INTERVAL    30000
 
 /**
- * Buffer allocation step
+ * Unclaimed message
+ */
+struct MsgWaitQueueElement
+{
+   MsgWaitQueueElement *next;   // Next message with same key
+   void *msg;                   // Pointer to message, either to NXCPMessage object or raw message
+   INT64 expirationTime;
+   UINT64 key;
+};
+
+/**
+ * Thread waiting for message
+ */
+struct MsgWaitQueueWaiter
+{
+   MsgWaitQueueWaiter *next;    // Next waiter with same key or next free waiter
+   CONDITION wakeup;
+   void *msg;                   // Message handed over to this waiter
+};
+
+/**
+ * Make lookup key from message type, code, and ID
  */
-#define ALLOCATION_STEP       16
+static inline UINT64 MessageKey(UINT16 isBinary, UINT16 code, UINT32 id)
+{
+   return (static_cast<UINT64>(id) << 32) | (static_cast<UINT64>(code) << 16) | static_cast<UINT64>(isBinary);
+}
+
+/**
+ * Destroy message
+ */
+static inline void DestroyMessage(UINT64 key, void *msg)
+{
+   if (key & 1)
+      MemFree(msg);
+   else
+      delete static_cast<NXCPMessage*>(msg);
+}
 
 /**
  * Housekeeper data
  */
 MUTEX __EXPORT MsgWaitQueue::m_housekeeperLock = MutexCreate();
-HashMap<UINT64, MsgWaitQueue> __EXPORT *MsgWaitQueue::m_activeQueues = new HashMap<UINT64, MsgWaitQueue>(Ownership::False);
-CONDITION __EXPORT MsgWaitQueue::m_shutdownCondition = ConditionCreate(true);
+TimerWheel __EXPORT *MsgWaitQueue::m_expirationTimers = new TimerWheel(GetCurrentTimeMs());
+CONDITION __EXPORT MsgWaitQueue::m_housekeeperWakeup = ConditionCreate(false);
+INT64 __EXPORT MsgWaitQueue::m_housekeeperWakeupTime = 0;
+bool __EXPORT MsgWaitQueue::m_shutdown = false;
 THREAD __EXPORT MsgWaitQueue::m_housekeeperThread = INVALID_THREAD_HANDLE;
+VolatileCounter __EXPORT MsgWaitQueue::m_activeQueues = 0;
 
 /**
  * Constructor
  */
-MsgWaitQueue::MsgWaitQueue()
+MsgWaitQueue::MsgWaitQueue() : m_elementPool(16)
 {
    m_holdTime = 30000;      // Default message TTL is 30 seconds
    m_size = 0;
-   m_allocated = 0;
-   m_elements = NULL;
-   m_sequence = 1;
+   m_messages = new HashMap<UINT64, MsgWaitQueueElement>(Ownership::False);
+   m_waiters = new HashMap<UINT64, MsgWaitQueueWaiter>(Ownership::False);
+   m_freeWaiters = NULL;
+   m_timerScheduled = false;
+   m_timerId = 0;
 #if defined(_WIN32)
    InitializeCriticalSectionAndSpinCount(&m_mutex, 4000);
-   memset(m_wakeupEvents, 0, MAX_MSGQUEUE_WAITERS * sizeof(HANDLE));
-   m_wakeupEvents[0] = CreateEvent(NULL, FALSE, FALSE, NULL);
-   memset(m_waiters, 0, MAX_MSGQUEUE_WAITERS);
 #elif defined(_USE_GNU_PTH)
    pth_mutex_init(&m_mutex);
-   pth_cond_init(&m_wakeupCondition);
 #else
    pthread_mutex_init(&m_mutex, NULL);
-   pthread_cond_init(&m_wakeupCondition, NULL);
 #endif
-
-   // register new queue
-   MutexLock(m_housekeeperLock);
-   if (m_activeQueues != NULL)
-      m_activeQueues->set(CAST_FROM_POINTER(this, UINT64), this);
-   if (m_housekeeperThread == INVALID_THREAD_HANDLE)
-   {
-      m_housekeeperThread = ThreadCreateEx(MsgWaitQueue::housekeeperThread, 0, NULL);
-   }
-   MutexUnlock(m_housekeeperLock);
+   InterlockedIncrement(&m_activeQueues);
 }
 
 /**
@@ -81,25 +108,33 @@ MsgWaitQueue::MsgWaitQueue()
  */
 MsgWaitQueue::~MsgWaitQueue()
 {
-   // unregister queue
+   // Cancel expiration timer. If timer callback is running for this queue
+   // destructor will wait on housekeeper lock until it completes.
    MutexLock(m_housekeeperLock);
-   if (m_activeQueues != NULL)
-      m_activeQueues->remove(CAST_FROM_POINTER(this, UINT64));
+   if ((m_timerId != 0) && (m_expirationTimers != NULL))
+      m_expirationTimers->cancel(m_timerId);
    MutexUnlock(m_housekeeperLock);
 
    clear();
+   delete m_messages;
+   delete m_waiters;
+
+   while(m_freeWaiters != NULL)
+   {
+      MsgWaitQueueWaiter *w = m_freeWaiters;
+      m_freeWaiters = w->next;
+      ConditionDestroy(w->wakeup);
+      MemFree(w);
+   }
 
 #if defined(_WIN32)
    DeleteCriticalSection(&m_mutex);
-   for(int i = 0; i < MAX_MSGQUEUE_WAITERS; i++)
-      if (m_wakeupEvents[i] != NULL)
-         CloseHandle(m_wakeupEvents[i]);
 #elif defined(_USE_GNU_PTH)
    // nothing to do if libpth is used
 #else
    pthread_mutex_destroy(&m_mutex);
-   pthread_cond_destroy(&m_wakeupCondition);
 #endif
+   InterlockedDecrement(&m_activeQueues);
 }
 
 /**
@@ -108,268 +143,266 @@ MsgWaitQueue::~MsgWaitQueue()
 void MsgWaitQueue::clear()
 {
    lock();
-
-   for(int i = 0; i < m_allocated; i++)
+   Iterator<MsgWaitQueueElement> *it = m_messages->iterator();
+   while(it->hasNext())
    {
-      if (m_elements[i].msg == NULL)
-         continue;
-
-      if (m_elements[i].isBinary)
-      {
-         MemFree(m_elements[i].msg);
-      }
-      else
+      MsgWaitQueueElement *e = it->next();
+      while(e != NULL)
       {
-         delete (NXCPMessage *)(m_elements[i].msg);
+         MsgWaitQueueElement *next = e->next;
+         DestroyMessage(e->key, e->msg);
+         m_elementPool.free(e);
+         e = next;
       }
    }
+   delete it;
+   m_messages->clear();
    m_size = 0;
-   m_allocated = 0;
-   MemFreeAndNull(m_elements);
    unlock();
 }
 
 /**
- * Put message into queue
+ * Put message into queue. If there is thread waiting for this message it will
+ * be handed over directly, otherwise message will be kept until claimed or expired.
  */
-void MsgWaitQueue::put(NXCPMessage *pMsg)
+void MsgWaitQueue::putInternal(UINT16 isBinary, UINT16 code, UINT32 id, void *msg)
 {
+   UINT64 key = MessageKey(isBinary, code, id);
+   INT64 expirationTime = GetCurrentTimeMs() + m_holdTime;
+   bool scheduleTimer = false;
+
    lock();
 
-   int pos;
-   if (m_size == m_allocated)
+   MsgWaitQueueWaiter *waiter = m_waiters->get(key);
+   if (waiter != NULL)
    {
-      pos = m_allocated;
-      m_allocated += ALLOCATION_STEP;
-      m_elements = MemRealloc(m_elements, sizeof(WAIT_QUEUE_ELEMENT) * m_allocated);
-      memset(&m_elements[pos], 0, sizeof(WAIT_QUEUE_ELEMENT) * ALLOCATION_STEP);
+      if (waiter->next != NULL)
+         m_waiters->set(key, waiter->next);
+      else
+         m_waiters->remove(key);
+      waiter->msg = msg;
+      ConditionSet(waiter->wakeup);
    }
    else
    {
-      for(pos = 0; m_elements[pos].msg != NULL; pos++);
-   }
-	
-   m_elements[pos].code = pMsg->getCode();
-   m_elements[pos].isBinary = 0;
-   m_elements[pos].id = pMsg->getId();
-   m_elements[pos].ttl = m_holdTime;
-   m_elements[pos].msg = pMsg;
-   m_elements[pos].sequence = m_sequence++;
-   m_size++;
+      MsgWaitQueueElement *e = m_elementPool.allocate();
+      e->next = NULL;
+      e->msg = msg;
+      e->expirationTime = expirationTime;
+      e->key = key;
+
+      MsgWaitQueueElement *curr = m_messages->get(key);
+      if (curr != NULL)
+      {
+         while(curr->next != NULL)
+            curr = curr->next;
+         curr->next = e;
+      }
+      else
+      {
+         m_messages->set(key, e);
+      }
+      m_size++;
 
-#if defined(_WIN32)
-   for(int i = 0; i < MAX_MSGQUEUE_WAITERS; i++)
-      if (m_waiters[i])
-         SetEvent(m_wakeupEvents[i]);
-#elif defined(_USE_GNU_PTH)
-   pth_cond_notify(&m_wakeupCondition, TRUE);
-#else
-   pthread_cond_broadcast(&m_wakeupCondition);
-#endif
+      if (!m_timerScheduled)
+      {
+         m_timerScheduled = true;
+         scheduleTimer = true;
+      }
+   }
 
    unlock();
+
+   if (scheduleTimer)
+      scheduleExpirationTimer(expirationTime);
 }
 
 /**
- * Put raw message into queue
+ * Wait for message with specific code and ID
+ * Function return pointer to the message on success or
+ * NULL on timeout or error
  */
-void MsgWaitQueue::put(NXCP_MESSAGE *pMsg)
+void *MsgWaitQueue::waitForMessageInternal(UINT16 isBinary, UINT16 code, UINT32 id, UINT32 timeout)
 {
+   UINT64 key = MessageKey(isBinary, code, id);
+
    lock();
 
-   int pos;
-   if (m_size == m_allocated)
+   MsgWaitQueueElement *e = m_messages->get(key);
+   if (e != NULL)
    {
-      pos = m_allocated;
-      m_allocated += ALLOCATION_STEP;
-      m_elements = MemRealloc(m_elements, sizeof(WAIT_QUEUE_ELEMENT) * m_allocated);
-      memset(&m_elements[pos], 0, sizeof(WAIT_QUEUE_ELEMENT) * ALLOCATION_STEP);
+      if (e->next != NULL)
+         m_messages->set(key, e->next);
+      else
+         m_messages->remove(key);
+      void *msg = e->msg;
+      m_elementPool.free(e);
+      m_size--;
+      unlock();
+      return msg;
    }
-   else
+
+   if (timeout == 0)
    {
-      for(pos = 0; m_elements[pos].msg != NULL; pos++);
+      unlock();
+      return NULL;
    }
 
-   m_elements[pos].code = pMsg->code;
-   m_elements[pos].isBinary = 1;
-   m_elements[pos].id = pMsg->id;
-   m_elements[pos].ttl = m_holdTime;
-   m_elements[pos].msg = pMsg;
-   m_elements[pos].sequence = m_sequence++;
-   m_size++;
-
-#ifdef _WIN32
-   for(int i = 0; i < MAX_MSGQUEUE_WAITERS; i++)
-      if (m_waiters[i])
-         SetEvent(m_wakeupEvents[i]);
-#elif defined(_USE_GNU_PTH)
-   pth_cond_notify(&m_wakeupCondition, TRUE);
-#else
-   pthread_cond_broadcast(&m_wakeupCondition);
-#endif
-
-   unlock();
-}
-
-/**
- * Wait for message with specific code and ID
- * Function return pointer to the message on success or
- * NULL on timeout or error
- */
-void *MsgWaitQueue::waitForMessageInternal(UINT16 isBinary, UINT16 wCode, UINT32 dwId, UINT32 dwTimeOut)
-{
-   lock();
+   // Register as waiter for this key
+   MsgWaitQueueWaiter *waiter = m_freeWaiters;
+   if (waiter != NULL)
+   {
+      m_freeWaiters = waiter->next;
+   }
+   else
+   {
+      waiter = MemAllocStruct<MsgWaitQueueWaiter>();
+      waiter->wakeup = ConditionCreate(false);
+   }
+   waiter->next = NULL;
+   waiter->msg = NULL;
 
-#ifdef _WIN32
-   int slot = -1;
-#endif
+   MsgWaitQueueWaiter *curr = m_waiters->get(key);
+   if (curr != NULL)
+   {
+      while(curr->next != NULL)
+         curr = curr->next;
+      curr->next = waiter;
+   }
+   else
+   {
+      m_waiters->set(key, waiter);
+   }
 
-   do
+   INT64 startTime = GetCurrentTimeMs();
+   UINT32 remainingTime = timeout;
+   while(true)
    {
-      UINT64 minSeq = _ULL(0xFFFFFFFFFFFFFFFF);
-      int index = -1;
-      for(int i = 0; i < m_allocated; i++)
-		{
-         if ((m_elements[i].msg != NULL) && 
-             (m_elements[i].id == dwId) &&
-             (m_elements[i].code == wCode) &&
-             (m_elements[i].isBinary == isBinary))
-         {
-            if (m_elements[i].sequence < minSeq)
-            {
-               minSeq = m_elements[i].sequence;
-               index = i;
-            }
-         }
-		}
+      unlock();
+      ConditionWait(waiter->wakeup, remainingTime);
+      lock();
 
-      if (index != -1)
-      {
-         void *msg = m_elements[index].msg;
-         m_elements[index].msg = NULL;
-         m_size--;
-#ifdef _WIN32
-         if (slot != -1)
-            m_waiters[slot] = 0;    // release waiter slot
-#endif
-         unlock();
-         return msg;
-      }
+      // Wakeup could be caused by signal left from previous use of this waiter,
+      // so message presence and elapsed time should be checked explicitly
+      if (waiter->msg != NULL)
+         break;
 
-      INT64 startTime = GetCurrentTimeMs();
-       
-#if defined(_WIN32)
-      // Find free slot if needed
-      if (slot == -1)
+      UINT32 elapsed = static_cast<UINT32>(GetCurrentTimeMs() - startTime);
+      if (elapsed >= timeout)
       {
-         for(slot = 0; slot < MAX_MSGQUEUE_WAITERS; slot++)
-            if (!m_waiters[slot])
+         // Remove from waiter list
+         MsgWaitQueueWaiter *head = m_waiters->get(key);
+         if (head == waiter)
+         {
+            if (waiter->next != NULL)
+               m_waiters->set(key, waiter->next);
+            else
+               m_waiters->remove(key);
+         }
+         else if (head != NULL)
+         {
+            for(curr = head; curr->next != NULL; curr = curr->next)
             {
-               m_waiters[slot] = 1;
-               if (m_wakeupEvents[slot] == NULL)
-                  m_wakeupEvents[slot] = CreateEvent(NULL, FALSE, FALSE, NULL);
-               break;
+               if (curr->next == waiter)
+               {
+                  curr->next = waiter->next;
+                  break;
+               }
             }
-
-         if (slot == MAX_MSGQUEUE_WAITERS)
-         {
-            slot = -1;
          }
+         break;
       }
+      remainingTime = timeout - elapsed;
+   }
 
-      LeaveCriticalSection(&m_mutex);
-      if (slot != -1)
-         WaitForSingleObject(m_wakeupEvents[slot], dwTimeOut);
-      else
-         Sleep(50);  // Just sleep if there are no waiter slots (highly unlikely during normal operation)
-      EnterCriticalSection(&m_mutex);
-#elif HAVE_PTHREAD_COND_RELTIMEDWAIT_NP
-	   struct timespec ts;
-
-	   ts.tv_sec = dwTimeOut / 1000;
-	   ts.tv_nsec = (dwTimeOut % 1000) * 1000000;
-      pthread_cond_reltimedwait_np(&m_wakeupCondition, &m_mutex, &ts);
-#elif defined(_USE_GNU_PTH)
-      pth_event_t ev = pth_event(PTH_EVENT_TIME, pth_timeout(dwTimeOut / 1000, (dwTimeOut % 1000) * 1000));
-      pth_cond_await(&m_wakeupCondition, &m_mutex, ev);
-      pth_event_free(ev, PTH_FREE_ALL);
-#else
-	   struct timeval now;
-	   struct timespec ts;
-
-	   gettimeofday(&now, NULL);
-	   ts.tv_sec = now.tv_sec + (dwTimeOut / 1000);
-
-	   now.tv_usec += (dwTimeOut % 1000) * 1000;
-	   ts.tv_sec += now.tv_usec / 1000000;
-	   ts.tv_nsec = (now.tv_usec % 1000000) * 1000;
-
-	   pthread_cond_timedwait(&m_wakeupCondition, &m_mutex, &ts);
-#endif   /* _WIN32 */
-
-      UINT32 sleepTime = (UINT32)(GetCurrentTimeMs() - startTime);
-      dwTimeOut -= std::min(sleepTime, dwTimeOut);
-   } while(dwTimeOut > 0);
-
-#ifdef _WIN32
-   if (slot != -1)
-      m_waiters[slot] = 0;    // release waiter slot
-#endif
+   void *msg = waiter->msg;
+   waiter->next = m_freeWaiters;
+   m_freeWaiters = waiter;
 
    unlock();
-   return NULL;
+   return msg;
 }
 
 /**
- * Housekeeping run
+ * Expire unclaimed messages. Returns expiration time of oldest remaining message or 0 if queue is empty.
  */
-void MsgWaitQueue::housekeeperRun()
+INT64 MsgWaitQueue::expireMessages(INT64 now)
 {
+   INT64 nextExpirationTime = 0;
    lock();
    if (m_size > 0)
    {
-      for(int i = 0; i < m_allocated; i++)
-	   {
-         if (m_elements[i].msg == NULL)
-            continue;
-
-         if (m_elements[i].ttl <= TTL_CHECK_INTERVAL)
+      Iterator<MsgWaitQueueElement> *it = m_messages->iterator();
+      while(it->hasNext())
+      {
+         MsgWaitQueueElement *head = it->next();
+         MsgWaitQueueElement *e = head, *prev = NULL;
+         while(e != NULL)
          {
-            if (m_elements[i].isBinary)
+            MsgWaitQueueElement *next = e->next;
+            if (e->expirationTime <= now)
             {
-               MemFree(m_elements[i].msg);
+               if (prev != NULL)
+                  prev->next = next;
+               else
+                  head = next;
+               DestroyMessage(e->key, e->msg);
+               m_elementPool.free(e);
+               m_size--;
             }
             else
             {
-               delete (NXCPMessage *)(m_elements[i].msg);
+               if ((nextExpirationTime == 0) || (e->expirationTime < nextExpirationTime))
+                  nextExpirationTime = e->expirationTime;
+               prev = e;
             }
-            m_elements[i].msg = NULL;
-            m_size--;
+            e = next;
          }
+
+         if (head == NULL)
+            it->unlink();
          else
-         {
-            m_elements[i].ttl -= TTL_CHECK_INTERVAL;
-         }
-	   }
+            m_messages->set(head->key, head);   // Replacing value for existing key does not invalidate iterator
+      }
+      delete it;
+   }
+   if (nextExpirationTime == 0)
+      m_timerScheduled = false;
+   unlock();
+   return nextExpirationTime;
+}
 
-      // compact queue if possible
-      if ((m_allocated > ALLOCATION_STEP) && (m_size == 0))
+/**
+ * Schedule expiration timer for this queue
+ */
+void MsgWaitQueue::scheduleExpirationTimer(INT64 expirationTime)
+{
+   MutexLock(m_housekeeperLock);
+   if (m_expirationTimers != NULL)
+   {
+      m_timerId = m_expirationTimers->add(expirationTime, this);
+      if (m_housekeeperThread == INVALID_THREAD_HANDLE)
+      {
+         m_housekeeperWakeupTime = expirationTime;
+         m_housekeeperThread = ThreadCreateEx(MsgWaitQueue::housekeeperThread, 0, NULL);
+      }
+      else if (expirationTime < m_housekeeperWakeupTime)
       {
-         m_allocated = ALLOCATION_STEP;
-         MemFree(m_elements);
-         m_elements = MemAllocArray<WAIT_QUEUE_ELEMENT>(m_allocated);
+         m_housekeeperWakeupTime = expirationTime;
+         ConditionSet(m_housekeeperWakeup);
       }
    }
-   unlock();
+   MutexUnlock(m_housekeeperLock);
 }
 
 /**
- * Callback for enumerating active queues
+ * Expiration timer callback (called with housekeeper lock held)
  */
-EnumerationCallbackResult MsgWaitQueue::houseKeeperCallback(const void *key, const void *object, void *arg)
+void MsgWaitQueue::expirationCallback(void *data, void *context)
 {
-   ((MsgWaitQueue *)object)->housekeeperRun();
-   return _CONTINUE;
+   MsgWaitQueue *queue = static_cast<MsgWaitQueue*>(data);
+   INT64 nextExpirationTime = queue->expireMessages(*static_cast<INT64*>(context));
+   queue->m_timerId = (nextExpirationTime != 0) ? m_expirationTimers->add(nextExpirationTime, queue) : 0;
 }
 
 /**
@@ -378,12 +411,20 @@ EnumerationCallbackResult MsgWaitQueue::houseKeeperCallback(const void *key, con
 THREAD_RESULT THREAD_CALL MsgWaitQueue::housekeeperThread(void *arg)
 {
    ThreadSetName("MsgWaitQueue");
-   while(!ConditionWait(m_shutdownCondition, TTL_CHECK_INTERVAL))
+   MutexLock(m_housekeeperLock);
+   while(!m_shutdown)
    {
-      MutexLock(m_housekeeperLock);
-      m_activeQueues->forEach(MsgWaitQueue::houseKeeperCallback, NULL);
+      INT64 now = GetCurrentTimeMs();
+      m_expirationTimers->advance(now, MsgWaitQueue::expirationCallback, &now);
+
+      INT64 next = m_expirationTimers->getNextExpirationTime();
+      UINT32 sleepTime = (next != -1) ? static_cast<UINT32>(std::min(std::max(next - now, static_cast<INT64>(0)), static_cast<INT64>(TTL_CHECK_INTERVAL))) : TTL_CHECK_INTERVAL;
+      m_housekeeperWakeupTime = now + sleepTime;
       MutexUnlock(m_housekeeperLock);
+      ConditionWait(m_housekeeperWakeup, sleepTime);
+      MutexLock(m_housekeeperLock);
    }
+   MutexUnlock(m_housekeeperLock);
    return THREAD_OK;
 }
 
@@ -392,43 +433,34 @@ THREAD_RESULT THREAD_CALL MsgWaitQueue::housekeeperThread(void *arg)
  */
 void MsgWaitQueue::shutdown()
 {
-   ConditionSet(m_shutdownCondition);
-   ThreadJoin(m_housekeeperThread);
+   MutexLock(m_housekeeperLock);
+   m_shutdown = true;
+   THREAD thread = m_housekeeperThread;
+   MutexUnlock(m_housekeeperLock);
+
+   ConditionSet(m_housekeeperWakeup);
+   ThreadJoin(thread);
+
    MutexLock(m_housekeeperLock);
    m_housekeeperThread = INVALID_THREAD_HANDLE;
-   delete_and_null(m_activeQueues);
+   delete_and_null(m_expirationTimers);
    MutexUnlock(m_housekeeperLock);
-   ConditionDestroy(m_shutdownCondition);
+   ConditionDestroy(m_housekeeperWakeup);
    MutexDestroy(m_housekeeperLock);
 }
 
-/**
- * Diag info callback
- */
-EnumerationCallbackResult MsgWaitQueue::diagInfoCallback(const void *key, const void *object, void *arg)
-{
-   MsgWaitQueue *q = (MsgWaitQueue *)object;
-   TCHAR buffer[256];
-   _sntprintf(buffer, 256, _T("   %p size=%d holdTime=%d\n"), q, q->m_size, q->m_holdTime);
-   static_cast<StringBuffer*>(arg)->append(buffer);
-   return _CONTINUE;
-}
-
 /**
  * Get diagnostic info
  */
 StringBuffer MsgWaitQueue::getDiagInfo()
 {
    StringBuffer out;
+   out.append(static_cast<INT32>(m_activeQueues));
+   out.append(_T(" active queues\n"));
    MutexLock(m_housekeeperLock);
-   out.append(m_activeQueues->size());
-   out.append(_T(" active queues\nHousekeeper thread state is "));
+   out.append((m_expirationTimers != NULL) ? m_expirationTimers->size() : 0);
+   out.append(_T(" queues with unclaimed messages\nHousekeeper thread state is "));
    out.append((m_housekeeperThread != INVALID_THREAD_HANDLE) ? _T("RUNNING\n") : _T("STOPPED\n"));
-   if (m_activeQueues->size() > 0)
-   {
-      out.append(_T("Active queues:\n"));
-      m_activeQueues->forEach(MsgWaitQueue::diagInfoCallback, &out);
-   }
    MutexUnlock(m_housekeeperLock);
    return out;
 }
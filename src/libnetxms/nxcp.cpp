@@ -447,10 +447,11 @@ TCHAR LIBNETXMS_EXPORTABLE *NXCPMessageCodeName(WORD code, TCHAR *pszBuffer)
       _T("CMD_GET_WEB_SERVICES"),
       _T("CMD_MODIFY_WEB_SERVICE"),
       _T("CMD_DELETE_WEB_SERVICE"),
-      _T("CMD_WEB_SERVICE_DEFINITION")
+      _T("CMD_WEB_SERVICE_DEFINITION"),
+      _T("CMD_GET_PARAMETERS")
    };
 
-   if ((code >= CMD_LOGIN) && (code <= CMD_WEB_SERVICE_DEFINITION))
+   if ((code >= CMD_LOGIN) && (code <= CMD_GET_PARAMETERS))
    {
       _tcscpy(pszBuffer, pszMsgNames[code - CMD_LOGIN]);
    }
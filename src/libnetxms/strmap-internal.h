@@ -1,6 +1,6 @@
 /*
 ** NetXMS - Network Management System
-** Copyright (C) 2003-2014 Victor Kirhenshtein
+** Copyright (C) 2003-2020 Victor Kirhenshtein
 **
 ** This program is free software; you can redistribute it and/or modify
 ** it under the terms of the GNU General Public License as published by
@@ -23,17 +23,18 @@
 #ifndef _strmap_internal_h_
 #define _strmap_internal_h_
 
-#include <uthash.h>
+#include "hashindex-internal.h"
 
 /**
  * Entry
  */
 struct StringMapEntry
 {
-   UT_hash_handle hh;
-   TCHAR *key;
-   void *value;
+   TCHAR *key;          // NULL for deleted entry
    TCHAR *originalKey;
+   void *value;
+   UINT32 hash;
+   UINT32 keyLen;       // Key length in bytes
 };
 
 #endif
@@ -34,9 +34,11 @@ StringMap::StringMap(const StringMap &src) : StringMapBase(Ownership::True)
    m_ignoreCase = src.m_ignoreCase;
    m_objectDestructor = src.m_objectDestructor;
 
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, src.m_data, entry, tmp)
+   for(int i = 0; i < src.m_used; i++)
    {
+      StringMapEntry *entry = &src.m_data[i];
+      if (entry->key == NULL)
+         continue;
       setObject(MemCopyString(m_ignoreCase ? entry->originalKey : entry->key), MemCopyString((TCHAR *)entry->value), true);
    }
 }
@@ -59,9 +61,11 @@ StringMap& StringMap::operator =(const StringMap &src)
    m_ignoreCase = src.m_ignoreCase;
    m_objectDestructor = src.m_objectDestructor;
 
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, src.m_data, entry, tmp)
+   for(int i = 0; i < src.m_used; i++)
    {
+      StringMapEntry *entry = &src.m_data[i];
+      if (entry->key == NULL)
+         continue;
       setObject(MemCopyString(m_ignoreCase ? entry->originalKey : entry->key), MemCopyString((TCHAR *)entry->value), true);
    }
 	return *this;
@@ -72,9 +76,11 @@ StringMap& StringMap::operator =(const StringMap &src)
  */
 void StringMap::addAll(const StringMap *src, bool (*filter)(const TCHAR *, const TCHAR *, void *), void *context)
 {
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, src->m_data, entry, tmp)
+   for(int i = 0; i < src->m_used; i++)
    {
+      StringMapEntry *entry = &src->m_data[i];
+      if (entry->key == NULL)
+         continue;
       const TCHAR *k = src->m_ignoreCase ? entry->originalKey : entry->key;
       if ((filter == NULL) || filter(k, static_cast<TCHAR*>(entry->value), context))
       {
@@ -200,9 +206,11 @@ void StringMap::fillMessage(NXCPMessage *msg, UINT32 sizeFieldId, UINT32 baseFie
 {
    msg->setField(sizeFieldId, (UINT32)size());
    UINT32 id = baseFieldId;
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   for(int i = 0; i < m_used; i++)
    {
+      StringMapEntry *entry = &m_data[i];
+      if (entry->key == NULL)
+         continue;
       msg->setField(id++, m_ignoreCase ? entry->originalKey : entry->key);
       msg->setField(id++, static_cast<TCHAR*>(entry->value));
    }
@@ -229,9 +237,11 @@ void StringMap::loadMessage(const NXCPMessage *msg, UINT32 sizeFieldId, UINT32 b
 json_t *StringMap::toJson() const
 {
    json_t *root = json_array();
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   for(int i = 0; i < m_used; i++)
    {
+      StringMapEntry *entry = &m_data[i];
+      if (entry->key == NULL)
+         continue;
       json_t *e = json_array();
       json_array_append_new(e, json_string_t(m_ignoreCase ? entry->originalKey : entry->key));
       json_array_append_new(e, json_string_t((TCHAR *)entry->value));
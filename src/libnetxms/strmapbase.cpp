@@ -38,6 +38,11 @@ static void ObjectDestructor(void *object, StringMapBase *map)
 StringMapBase::StringMapBase(Ownership objectOwner, void (*destructor)(void *, StringMapBase *))
 {
 	m_data = NULL;
+   m_index = NULL;
+   m_indexMask = 0;
+   m_used = 0;
+   m_allocated = 0;
+   m_size = 0;
 	m_objectOwner = (objectOwner == Ownership::True);
    m_ignoreCase = true;
    m_context = NULL;
@@ -57,27 +62,41 @@ StringMapBase::~StringMapBase()
  */
 void StringMapBase::clear()
 {
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   StringMapEntry *data = m_data;
+   int used = m_used;
+   MemFree(m_index);
+   m_data = NULL;
+   m_index = NULL;
+   m_indexMask = 0;
+   m_used = 0;
+   m_allocated = 0;
+   m_size = 0;
+
+   for(int i = 0; i < used; i++)
    {
-      HASH_DEL(m_data, entry);
+      StringMapEntry *entry = &data[i];
+      if (entry->key == NULL)
+         continue;
       MemFree(entry->key);
       MemFree(entry->originalKey);
       if (m_objectOwner)
          destroyObject(entry->value);
-      MemFree(entry);
    }
+   MemFree(data);
 }
 
 /**
- * Find entry index by key
+ * Find entry by key. If hash is not NULL, calculated key hash will be stored there.
  */
-StringMapEntry *StringMapBase::find(const TCHAR *key, size_t keyLen) const
+StringMapEntry *StringMapBase::find(const TCHAR *key, size_t keyLen, UINT32 *hash) const
 {
 	if (key == NULL)
 		return NULL;
 
-   StringMapEntry *entry;
+   if ((m_size == 0) && (hash == NULL))
+      return NULL;
+
+   const TCHAR *k;
    if (m_ignoreCase)
    {
 #if HAVE_ALLOCA
@@ -88,18 +107,123 @@ StringMapEntry *StringMapBase::find(const TCHAR *key, size_t keyLen) const
       memcpy(ukey, key, keyLen);
       *((TCHAR *)((BYTE *)ukey + keyLen)) = 0;
       _tcsupr(ukey);
-      HASH_FIND(hh, m_data, ukey, (unsigned int)keyLen, entry);
-#if !HAVE_ALLOCA
-      MemFree(ukey);
-#endif
+      k = ukey;
    }
    else
    {
-      HASH_FIND(hh, m_data, key, (unsigned int)keyLen, entry);
+      k = key;
    }
+
+   UINT32 h = HashIndexCalculateHash(k, keyLen);
+   if (hash != NULL)
+      *hash = h;
+
+   StringMapEntry *entry = NULL;
+   if (m_size > 0)
+   {
+      UINT32 pos = h & m_indexMask;
+      for(UINT32 distance = 0;; distance++)
+      {
+         UINT64 slot = m_index[pos];
+         if ((slot == 0) || (HashIndexProbeDistance(slot, pos, m_indexMask) < distance))
+            break;
+         if (HashIndexSlotHash(slot) == h)
+         {
+            StringMapEntry *e = &m_data[HashIndexSlotPosition(slot)];
+            if ((e->keyLen == keyLen) && !memcmp(e->key, k, keyLen))
+            {
+               entry = e;
+               break;
+            }
+         }
+         pos = (pos + 1) & m_indexMask;
+      }
+   }
+
+#if !HAVE_ALLOCA
+   if (m_ignoreCase)
+      MemFree(const_cast<TCHAR*>(k));
+#endif
    return entry;
 }
 
+/**
+ * Rebuild index from scratch
+ */
+void StringMapBase::rebuildIndex()
+{
+   memset(m_index, 0, (m_indexMask + 1) * sizeof(UINT64));
+   for(int i = 0; i < m_used; i++)
+      if (m_data[i].key != NULL)
+         HashIndexInsert(m_index, m_indexMask, m_data[i].hash, i);
+}
+
+/**
+ * Make room for new entry at the end of entry array. If there are enough deleted
+ * entries they are compacted out, otherwise entry array is extended. Index is grown
+ * when it reaches maximum load factor.
+ */
+void StringMapBase::reserveEntry()
+{
+   bool rebuild = false;
+   if (m_used == m_allocated)
+   {
+      if ((m_used > 0) && (m_used - m_size >= m_used / 4))
+      {
+         int n = 0;
+         for(int i = 0; i < m_used; i++)
+         {
+            if (m_data[i].key == NULL)
+               continue;
+            if (i != n)
+               m_data[n] = m_data[i];
+            n++;
+         }
+         m_used = n;
+         rebuild = true;
+      }
+      else
+      {
+         m_allocated = (m_allocated > 0) ? m_allocated + m_allocated / 2 : HASH_INDEX_MIN_SIZE;
+         m_data = MemReallocArray(m_data, m_allocated);
+      }
+   }
+
+   if (m_size >= HASH_INDEX_CAPACITY(m_indexMask))
+   {
+      UINT32 indexSize = (m_index != NULL) ? (m_indexMask + 1) * 2 : HASH_INDEX_MIN_SIZE;
+      MemFree(m_index);
+      m_index = MemAllocArrayNoInit<UINT64>(indexSize);
+      m_indexMask = indexSize - 1;
+      rebuild = true;
+   }
+
+   if (rebuild)
+      rebuildIndex();
+}
+
+/**
+ * Remove entry at given position. Returns entry value.
+ */
+void *StringMapBase::removeEntry(int position)
+{
+   StringMapEntry *entry = &m_data[position];
+   HashIndexRemove(m_index, m_indexMask, entry->hash, position);
+   MemFree(entry->key);
+   MemFree(entry->originalKey);
+   void *value = entry->value;
+   entry->key = NULL;
+   entry->originalKey = NULL;
+   entry->value = NULL;
+
+   m_size--;
+   if (m_size == 0)
+      m_used = 0;
+   else if (position == m_used - 1)
+      m_used--;
+   return value;
+}
+
 /**
  * Set value
  */
@@ -112,7 +236,9 @@ void StringMapBase::setObject(TCHAR *key, void *value, bool keyPreAllocated)
       return;
    }
 
-	StringMapEntry *entry = find(key, _tcslen(key) * sizeof(TCHAR));
+   size_t keyLen = _tcslen(key) * sizeof(TCHAR);
+   UINT32 hash;
+	StringMapEntry *entry = find(key, keyLen, &hash);
 	if (entry != NULL)
 	{
 		if (keyPreAllocated)
@@ -138,7 +264,8 @@ void StringMapBase::setObject(TCHAR *key, void *value, bool keyPreAllocated)
 	}
 	else
 	{
-      entry = MemAllocStruct<StringMapEntry>();
+      reserveEntry();
+      entry = &m_data[m_used];
       entry->key = keyPreAllocated ? key : MemCopyString(key);
       if (m_ignoreCase)
       {
@@ -149,9 +276,12 @@ void StringMapBase::setObject(TCHAR *key, void *value, bool keyPreAllocated)
       {
          entry->originalKey = NULL;
       }
-      int keyLen = (int)(_tcslen(key) * sizeof(TCHAR));
       entry->value = value;
-      HASH_ADD_KEYPTR(hh, m_data, entry->key, keyLen, entry);
+      entry->hash = hash;
+      entry->keyLen = static_cast<UINT32>(keyLen);
+      HashIndexInsert(m_index, m_indexMask, hash, m_used);
+      m_used++;
+      m_size++;
 	}
 }
 
@@ -182,15 +312,14 @@ void *StringMapBase::getObject(const TCHAR *key, size_t len) const
  */
 void StringMapBase::remove(const TCHAR *key)
 {
+   if (key == NULL)
+      return;
    StringMapEntry *entry = find(key, _tcslen(key) * sizeof(TCHAR));
    if (entry != NULL)
    {
-      HASH_DEL(m_data, entry);
-      MemFree(entry->key);
-      MemFree(entry->originalKey);
+      void *value = removeEntry(static_cast<int>(entry - m_data));
 		if (m_objectOwner)
-         destroyObject(entry->value);
-      MemFree(entry);
+         destroyObject(value);
    }
 }
 
@@ -199,21 +328,10 @@ void StringMapBase::remove(const TCHAR *key)
  */
 void *StringMapBase::unlink(const TCHAR *key)
 {
+   if (key == NULL)
+      return NULL;
    StringMapEntry *entry = find(key, _tcslen(key) * sizeof(TCHAR));
-   void *value;
-   if (entry != NULL)
-   {
-      HASH_DEL(m_data, entry);
-      MemFree(entry->key);
-      MemFree(entry->originalKey);
-      value = entry->value;
-      MemFree(entry);
-   }
-   else
-   {
-      value = NULL;
-   }
-   return value;
+   return (entry != NULL) ? removeEntry(static_cast<int>(entry - m_data)) : NULL;
 }
 
 /**
@@ -223,9 +341,11 @@ void *StringMapBase::unlink(const TCHAR *key)
 EnumerationCallbackResult StringMapBase::forEach(EnumerationCallbackResult (*cb)(const TCHAR *, const void *, void *), void *userData) const
 {
    EnumerationCallbackResult result = _CONTINUE;
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   for(int i = 0; i < m_used; i++)
    {
+      StringMapEntry *entry = &m_data[i];
+      if (entry->key == NULL)
+         continue;
       if (cb(m_ignoreCase ? entry->originalKey : entry->key, entry->value, userData) == _STOP)
       {
          result = _STOP;
@@ -241,9 +361,11 @@ EnumerationCallbackResult StringMapBase::forEach(EnumerationCallbackResult (*cb)
 const void *StringMapBase::findElement(bool (*comparator)(const TCHAR *, const void *, void *), void *userData) const
 {
    const void *result = NULL;
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   for(int i = 0; i < m_used; i++)
    {
+      StringMapEntry *entry = &m_data[i];
+      if (entry->key == NULL)
+         continue;
       if (comparator(m_ignoreCase ? entry->originalKey : entry->key, entry->value, userData))
       {
          result = entry->value;
@@ -258,17 +380,16 @@ const void *StringMapBase::findElement(bool (*comparator)(const TCHAR *, const v
  */
 void StringMapBase::filterElements(bool (*filter)(const TCHAR *, const void *, void *), void *userData)
 {
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   for(int i = 0; i < m_used; i++)
    {
+      StringMapEntry *entry = &m_data[i];
+      if (entry->key == NULL)
+         continue;
       if (!filter(m_ignoreCase ? entry->originalKey : entry->key, entry->value, userData))
       {
-         HASH_DEL(m_data, entry);
-         MemFree(entry->key);
-         MemFree(entry->originalKey);
+         void *value = removeEntry(i);
          if (m_objectOwner)
-            destroyObject(entry->value);
-         MemFree(entry);
+            destroyObject(value);
       }
    }
 }
@@ -279,9 +400,11 @@ void StringMapBase::filterElements(bool (*filter)(const TCHAR *, const void *, v
 StructArray<KeyValuePair<void>> *StringMapBase::toArray(bool (*filter)(const TCHAR *, const void *, void *), void *userData) const
 {
    StructArray<KeyValuePair<void>> *a = new StructArray<KeyValuePair<void>>();
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   for(int i = 0; i < m_used; i++)
    {
+      StringMapEntry *entry = &m_data[i];
+      if (entry->key == NULL)
+         continue;
       if ((filter == NULL) || filter(m_ignoreCase ? entry->originalKey : entry->key, entry->value, userData))
       {
          KeyValuePair<void> p;
@@ -299,10 +422,11 @@ StructArray<KeyValuePair<void>> *StringMapBase::toArray(bool (*filter)(const TCH
 StringList *StringMapBase::keys() const
 {
    StringList *list = new StringList();
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   for(int i = 0; i < m_used; i++)
    {
-      list->add(m_ignoreCase ? entry->originalKey : entry->key);
+      StringMapEntry *entry = &m_data[i];
+      if (entry->key != NULL)
+         list->add(m_ignoreCase ? entry->originalKey : entry->key);
    }
    return list;
 }
@@ -312,19 +436,29 @@ StringList *StringMapBase::keys() const
  */
 void StringMapBase::fillValues(Array *values) const
 {
-   StringMapEntry *entry, *tmp;
-   HASH_ITER(hh, m_data, entry, tmp)
+   for(int i = 0; i < m_used; i++)
    {
-      values->add(entry->value);
+      StringMapEntry *entry = &m_data[i];
+      if (entry->key != NULL)
+         values->add(entry->value);
    }
 }
 
 /**
- * Get size
+ * Get memory used by map internal structures and keys (excluding values)
  */
-int StringMapBase::size() const
+size_t StringMapBase::memoryUsage() const
 {
-   return HASH_COUNT(m_data);
+   if (m_index == NULL)
+      return 0;
+   size_t usage = (m_indexMask + 1) * sizeof(UINT64) + m_allocated * sizeof(StringMapEntry);
+   for(int i = 0; i < m_used; i++)
+   {
+      StringMapEntry *entry = &m_data[i];
+      if (entry->key != NULL)
+         usage += (entry->keyLen + sizeof(TCHAR)) * ((entry->originalKey != NULL) ? 2 : 1);
+   }
+   return usage;
 }
 
 /**
@@ -336,37 +470,30 @@ void StringMapBase::setIgnoreCase(bool ignore)
       return;  // No change required
 
    m_ignoreCase = ignore;
-   if (m_data == NULL)
+   if (m_size == 0)
       return;  // Empty set
 
-   StringMapEntry *data = NULL;
-   StringMapEntry *entry, *tmp;
-   if (m_ignoreCase)
+   for(int i = 0; i < m_used; i++)
    {
-      // switching to case ignore mode
-      HASH_ITER(hh, m_data, entry, tmp)
+      StringMapEntry *entry = &m_data[i];
+      if (entry->key == NULL)
+         continue;
+      if (m_ignoreCase)
       {
-         HASH_DEL(m_data, entry);
+         // switching to case ignore mode
          entry->originalKey = MemCopyString(entry->key);
          _tcsupr(entry->key);
-         int keyLen = (int)(_tcslen(entry->key) * sizeof(TCHAR));
-         HASH_ADD_KEYPTR(hh, data, entry->key, keyLen, entry);
       }
-   }
-   else
-   {
-      // switching to case sensitive mode
-      HASH_ITER(hh, m_data, entry, tmp)
+      else
       {
-         HASH_DEL(m_data, entry);
+         // switching to case sensitive mode
          MemFree(entry->key);
          entry->key = entry->originalKey;
          entry->originalKey = NULL;
-         int keyLen = (int)(_tcslen(entry->key) * sizeof(TCHAR));
-         HASH_ADD_KEYPTR(hh, data, entry->key, keyLen, entry);
       }
+      entry->hash = HashIndexCalculateHash(entry->key, entry->keyLen);
    }
-   m_data = data;
+   rebuildIndex();
 }
 
 /**
@@ -375,8 +502,7 @@ void StringMapBase::setIgnoreCase(bool ignore)
 StringMapIterator::StringMapIterator(StringMapBase *map)
 {
    m_map = map;
-   m_curr = NULL;
-   m_next = NULL;
+   m_position = -1;
 }
 
 /**
@@ -384,10 +510,10 @@ StringMapIterator::StringMapIterator(StringMapBase *map)
  */
 bool StringMapIterator::hasNext()
 {
-   if (m_map->m_data == NULL)
-      return false;
-
-   return (m_curr != NULL) ? (m_next != NULL) : true;
+   for(int i = m_position + 1; i < m_map->m_used; i++)
+      if (m_map->m_data[i].key != NULL)
+         return true;
+   return false;
 }
 
 /**
@@ -395,23 +521,18 @@ bool StringMapIterator::hasNext()
  */
 void *StringMapIterator::next()
 {
-   if (m_map->m_data == NULL)
-      return NULL;
-
-   if (m_curr == NULL)  // iteration not started
+   while(m_position < m_map->m_used)
    {
-      m_curr = m_map->m_data;
-   }
-   else
-   {
-      if (m_next == NULL)
-         return NULL;
-      m_curr = m_next;
+      m_position++;
+      if ((m_position < m_map->m_used) && (m_map->m_data[m_position].key != NULL))
+      {
+         StringMapEntry *entry = &m_map->m_data[m_position];
+         m_element.first = (m_map->m_ignoreCase ? entry->originalKey : entry->key);
+         m_element.second = static_cast<TCHAR*>(entry->value);
+         return &m_element;
+      }
    }
-   m_next = static_cast<StringMapEntry*>(m_curr->hh.next);
-   m_element.first = (m_map->m_ignoreCase ? m_curr->originalKey : m_curr->key);
-   m_element.second = static_cast<TCHAR*>(m_curr->value);
-   return &m_element;
+   return NULL;
 }
 
 /**
@@ -419,15 +540,12 @@ void *StringMapIterator::next()
  */
 void StringMapIterator::remove()
 {
-   if (m_curr == NULL)
+   if ((m_position < 0) || (m_position >= m_map->m_used) || (m_map->m_data[m_position].key == NULL))
       return;
 
-   HASH_DEL(m_map->m_data, m_curr);
-   MemFree(m_curr->key);
-   MemFree(m_curr->originalKey);
+   void *value = m_map->removeEntry(m_position);
    if (m_map->m_objectOwner)
-      m_map->destroyObject(m_curr->value);
-   MemFree(m_curr);
+      m_map->destroyObject(value);
 }
 
 /**
@@ -435,11 +553,8 @@ void StringMapIterator::remove()
  */
 void StringMapIterator::unlink()
 {
-   if (m_curr == NULL)
+   if ((m_position < 0) || (m_position >= m_map->m_used) || (m_map->m_data[m_position].key == NULL))
       return;
 
-   HASH_DEL(m_map->m_data, m_curr);
-   MemFree(m_curr->key);
-   MemFree(m_curr->originalKey);
-   MemFree(m_curr);
+   m_map->removeEntry(m_position);
 }
@@ -0,0 +1,381 @@
+/*
+** NetXMS - Network Management System
+** Copyright (C) 2003-2020 Victor Kirhenshtein
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published
+** by the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: timer_wheel.cpp
+**
+**/
+
+#include "libnetxms.h"
+#include <timer_wheel.h>
+
+/**
+ * Number of entries in one allocation chunk
+ */
+#define CHUNK_BITS   10
+#define CHUNK_SIZE   (1 << CHUNK_BITS)
+
+/**
+ * Maximum number of chunks (limits number of concurrently active timers to 2^31)
+ */
+#define MAX_CHUNKS   (0x80000000 / CHUNK_SIZE)
+
+/**
+ * Timer wheel entry
+ */
+struct TimerWheelEntry
+{
+   TimerWheelEntry *next;
+   TimerWheelEntry *prev;
+   INT64 expirationTime;
+   void *data;
+   UINT32 index;
+   UINT32 generation;
+   INT16 level;      // -1 for unused entry
+   INT16 slot;
+};
+
+/**
+ * Timer wheel constructor
+ *
+ * @param now current time in milliseconds
+ */
+TimerWheel::TimerWheel(INT64 now)
+{
+   memset(m_slots, 0, sizeof(m_slots));
+   memset(m_bitmap, 0, sizeof(m_bitmap));
+   m_chunks = NULL;
+   m_chunkCount = 0;
+   m_freeList = NULL;
+   m_currentTick = now;
+   m_size = 0;
+}
+
+/**
+ * Timer wheel destructor. Data associated with remaining timers is not destroyed.
+ */
+TimerWheel::~TimerWheel()
+{
+   for(int i = 0; i < m_chunkCount; i++)
+      MemFree(m_chunks[i]);
+   MemFree(m_chunks);
+}
+
+/**
+ * Allocate new entry
+ */
+TimerWheelEntry *TimerWheel::allocateEntry()
+{
+   if (m_freeList == NULL)
+   {
+      if (m_chunkCount == MAX_CHUNKS)
+         return NULL;
+      m_chunks = MemReallocArray(m_chunks, m_chunkCount + 1);
+      TimerWheelEntry *chunk = MemAllocArrayNoInit<TimerWheelEntry>(CHUNK_SIZE);
+      m_chunks[m_chunkCount] = chunk;
+      UINT32 base = static_cast<UINT32>(m_chunkCount) << CHUNK_BITS;
+      for(int i = CHUNK_SIZE - 1; i >= 0; i--)
+      {
+         chunk[i].index = base + i;
+         chunk[i].generation = 1;
+         chunk[i].level = -1;
+         chunk[i].next = m_freeList;
+         m_freeList = &chunk[i];
+      }
+      m_chunkCount++;
+   }
+   TimerWheelEntry *e = m_freeList;
+   m_freeList = e->next;
+   return e;
+}
+
+/**
+ * Return entry to free list. Generation is changed to invalidate outstanding identifiers.
+ */
+void TimerWheel::releaseEntry(TimerWheelEntry *e)
+{
+   e->level = -1;
+   e->data = NULL;
+   if (++e->generation == 0)
+      e->generation = 1;
+   e->next = m_freeList;
+   m_freeList = e;
+}
+
+/**
+ * Link entry into appropriate slot according to its expiration time
+ */
+void TimerWheel::link(TimerWheelEntry *e)
+{
+   INT64 tick = std::max(e->expirationTime, m_currentTick);
+   INT64 delta = tick - m_currentTick;
+   int level = 0;
+   if (delta >= (static_cast<INT64>(1) << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)))
+   {
+      // Too far in the future, will be re-inserted when last level slot is cascaded
+      tick = m_currentTick + (static_cast<INT64>(1) << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+      level = TIMER_WHEEL_LEVELS - 1;
+   }
+   else
+   {
+      while(delta >= (static_cast<INT64>(1) << (TIMER_WHEEL_BITS * (level + 1))))
+         level++;
+   }
+
+   int slot = static_cast<int>(tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+   e->level = static_cast<INT16>(level);
+   e->slot = static_cast<INT16>(slot);
+   e->prev = NULL;
+   e->next = m_slots[level][slot];
+   if (e->next != NULL)
+      e->next->prev = e;
+   m_slots[level][slot] = e;
+   m_bitmap[level][slot >> 6] |= _ULL(1) << (slot & 63);
+}
+
+/**
+ * Unlink entry from its slot
+ */
+void TimerWheel::unlink(TimerWheelEntry *e)
+{
+   if (e->prev != NULL)
+      e->prev->next = e->next;
+   else
+      m_slots[e->level][e->slot] = e->next;
+   if (e->next != NULL)
+      e->next->prev = e->prev;
+   if (m_slots[e->level][e->slot] == NULL)
+      m_bitmap[e->level][e->slot >> 6] &= ~(_ULL(1) << (e->slot & 63));
+}
+
+/**
+ * Detach all entries from given slot and return them as list
+ */
+TimerWheelEntry *TimerWheel::detachSlot(int level, int slot)
+{
+   TimerWheelEntry *list = m_slots[level][slot];
+   m_slots[level][slot] = NULL;
+   m_bitmap[level][slot >> 6] &= ~(_ULL(1) << (slot & 63));
+   return list;
+}
+
+/**
+ * Find first non-empty slot on given level starting from given position.
+ * Returns TIMER_WHEEL_SLOTS if there are no non-empty slots.
+ */
+int TimerWheel::findNextSlot(int level, int from) const
+{
+   for(int i = from >> 6; i < TIMER_WHEEL_SLOTS / 64; i++)
+   {
+      UINT64 bits = m_bitmap[level][i];
+      if (i == (from >> 6))
+         bits &= ~_ULL(0) << (from & 63);
+      if (bits == 0)
+         continue;
+      int bit = 0;
+      while((bits & 1) == 0)
+      {
+         bits >>= 1;
+         bit++;
+      }
+      return (i << 6) + bit;
+   }
+   return TIMER_WHEEL_SLOTS;
+}
+
+/**
+ * Add new timer.
+ *
+ * @param expirationTime timer expiration time in milliseconds
+ * @param data data to be passed to expiration callback
+ * @return timer identifier or 0 on failure
+ */
+UINT64 TimerWheel::add(INT64 expirationTime, void *data)
+{
+   TimerWheelEntry *e = allocateEntry();
+   if (e == NULL)
+      return 0;
+   e->expirationTime = expirationTime;
+   e->data = data;
+   link(e);
+   m_size++;
+   return (static_cast<UINT64>(e->generation) << 32) | static_cast<UINT64>(e->index);
+}
+
+/**
+ * Cancel timer.
+ *
+ * @param id timer identifier
+ * @param data if not NULL, data associated with timer will be stored here
+ * @return true if timer was cancelled and false if timer not found (already expired or cancelled)
+ */
+bool TimerWheel::cancel(UINT64 id, void **data)
+{
+   UINT32 index = static_cast<UINT32>(id & 0xFFFFFFFF);
+   UINT32 generation = static_cast<UINT32>(id >> 32);
+   if ((index >> CHUNK_BITS) >= static_cast<UINT32>(m_chunkCount))
+      return false;
+
+   TimerWheelEntry *e = &m_chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+   if ((e->level == -1) || (e->generation != generation))
+      return false;
+
+   unlink(e);
+   if (data != NULL)
+      *data = e->data;
+   releaseEntry(e);
+   m_size--;
+   return true;
+}
+
+/**
+ * Advance wheel to given time. Callback will be called for each expired timer.
+ * Callback may add new timers but should not cancel existing ones.
+ *
+ * @param now current time in milliseconds
+ * @param callback expiration callback
+ * @param context context for callback
+ * @return number of expired timers
+ */
+int TimerWheel::advance(INT64 now, TimerWheelCallback callback, void *context)
+{
+   int count = 0;
+   while((m_size > 0) && (m_currentTick <= now))
+   {
+      int index = static_cast<int>(m_currentTick & TIMER_WHEEL_MASK);
+      if (index == 0)
+      {
+         // Move timers from higher levels closer to expiration
+         for(int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+         {
+            int slot = static_cast<int>(m_currentTick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+            TimerWheelEntry *e = detachSlot(level, slot);
+            while(e != NULL)
+            {
+               TimerWheelEntry *next = e->next;
+               link(e);
+               e = next;
+            }
+            if (slot != 0)
+               break;
+         }
+      }
+
+      // Tick is advanced before calling callbacks so that new timers
+      // added by callbacks will not be placed into already processed slot
+      TimerWheelEntry *e = detachSlot(0, index);
+      m_currentTick++;
+      while(e != NULL)
+      {
+         TimerWheelEntry *next = e->next;
+         void *data = e->data;
+         releaseEntry(e);
+         m_size--;
+         callback(data, context);
+         count++;
+         e = next;
+      }
+
+      // Skip empty slots up to next expiration or cascade point
+      if (m_size > 0)
+      {
+         INT64 nextTick = getNextExpirationTime();
+         if (nextTick > m_currentTick)
+            m_currentTick = std::min(nextTick, now + 1);
+      }
+   }
+
+   if ((m_size == 0) && (m_currentTick <= now))
+      m_currentTick = now + 1;
+   return count;
+}
+
+/**
+ * Remove all timers. Callback will be called for each removed timer.
+ */
+void TimerWheel::clear(TimerWheelCallback callback, void *context)
+{
+   for(int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+   {
+      for(int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+      {
+         TimerWheelEntry *e = detachSlot(level, slot);
+         while(e != NULL)
+         {
+            TimerWheelEntry *next = e->next;
+            void *data = e->data;
+            releaseEntry(e);
+            m_size--;
+            if (callback != NULL)
+               callback(data, context);
+            e = next;
+         }
+      }
+   }
+}
+
+/**
+ * Get time (in milliseconds) when wheel should be advanced next time. It could be earlier
+ * than actual expiration time of nearest timer if timers on higher levels should be cascaded.
+ *
+ * @return next processing time or -1 if there are no active timers
+ */
+INT64 TimerWheel::getNextExpirationTime() const
+{
+   if (m_size == 0)
+      return -1;
+
+   // Current tick is at slot boundary and higher levels are not cascaded yet
+   int index = static_cast<int>(m_currentTick & TIMER_WHEEL_MASK);
+   if (index == 0)
+      return m_currentTick;
+
+   int slot = findNextSlot(0, index);
+   if (slot < TIMER_WHEEL_SLOTS)
+      return (m_currentTick & ~static_cast<INT64>(TIMER_WHEEL_MASK)) + slot;
+
+   // Timers on lowest level with slot index below current one belong to next rotation
+   INT64 result = -1;
+   slot = findNextSlot(0, 0);
+   if (slot < index)
+      result = (m_currentTick & ~static_cast<INT64>(TIMER_WHEEL_MASK)) + TIMER_WHEEL_SLOTS + slot;
+
+   for(int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+   {
+      int shift = TIMER_WHEEL_BITS * level;
+      index = static_cast<int>(m_currentTick >> shift) & TIMER_WHEEL_MASK;
+      // If current tick is at slot boundary, current slot is not cascaded yet
+      int first = ((m_currentTick & ((static_cast<INT64>(1) << shift) - 1)) == 0) ? index : index + 1;
+      int distance;
+      slot = findNextSlot(level, first);
+      if (slot < TIMER_WHEEL_SLOTS)
+      {
+         distance = slot - index;
+      }
+      else
+      {
+         slot = findNextSlot(level, 0);
+         if (slot >= first)
+            continue;
+         distance = slot + TIMER_WHEEL_SLOTS - index;
+      }
+      INT64 t = ((m_currentTick >> shift) + distance) << shift;
+      if ((result == -1) || (t < result))
+         result = t;
+   }
+   return result;
+}
@@ -50,6 +50,10 @@
 #include <poll.h>
 #endif
 
+#if HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+
 #if HAVE_MALLOC_H && !WITH_JEMALLOC
 #include <malloc.h>
 #endif
@@ -1311,6 +1315,97 @@ ssize_t LIBNETXMS_EXPORTABLE SendEx(SOCKET hSocket, const void *data, size_t len
 	return nLeft == 0 ? len : nRet;
 }
 
+/**
+ * Send multiple data blocks as single piece of data (using scatter/gather I/O where available)
+ *
+ * @param hSocket socket handle
+ * @param blocks data blocks
+ * @param count number of data blocks
+ * @param mutex optional mutex to be locked for the duration of operation
+ * @return total number of bytes sent on success, -1 on error
+ */
+ssize_t LIBNETXMS_EXPORTABLE SendVectorEx(SOCKET hSocket, const SendBlock *blocks, int count, MUTEX mutex)
+{
+   if (mutex != INVALID_MUTEX_HANDLE)
+      MutexLock(mutex);
+
+   ssize_t total = 0;
+#if HAVE_SYS_UIO_H && !defined(_WIN32)
+   struct iovec iov[64];
+   int index = 0;
+   size_t offset = 0;   // offset within current block
+   while(index < count)
+   {
+      // Fill I/O vector starting from current position
+      int iovCount = 0;
+      for(int i = index; (i < count) && (iovCount < 64); i++)
+      {
+         size_t skip = (i == index) ? offset : 0;
+         if (blocks[i].size == skip)
+            continue;
+         iov[iovCount].iov_base = const_cast<char*>(static_cast<const char*>(blocks[i].data)) + skip;
+         iov[iovCount].iov_len = blocks[i].size - skip;
+         iovCount++;
+      }
+      if (iovCount == 0)
+         break;
+
+      struct msghdr mh;
+      memset(&mh, 0, sizeof(mh));
+      mh.msg_iov = iov;
+      mh.msg_iovlen = iovCount;
+#ifdef MSG_NOSIGNAL
+      ssize_t rc = sendmsg(hSocket, &mh, MSG_NOSIGNAL);
+#else
+      ssize_t rc = sendmsg(hSocket, &mh, 0);
+#endif
+      if (rc <= 0)
+      {
+         if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+         {
+            // Wait until socket becomes available for writing
+            SocketPoller p(true);
+            p.add(hSocket);
+            int prc = p.poll(60000);
+            if ((prc > 0) || ((prc == -1) && (errno == EINTR)))
+               continue;
+         }
+         total = -1;
+         break;
+      }
+      total += rc;
+
+      // Advance position
+      size_t sent = static_cast<size_t>(rc);
+      while((index < count) && (sent >= blocks[index].size - offset))
+      {
+         sent -= blocks[index].size - offset;
+         offset = 0;
+         index++;
+      }
+      offset += sent;
+   }
+#else
+   for(int i = 0; i < count; i++)
+   {
+      if (blocks[i].size == 0)
+         continue;
+      ssize_t rc = SendEx(hSocket, blocks[i].data, blocks[i].size, 0, INVALID_MUTEX_HANDLE);
+      if (rc != static_cast<ssize_t>(blocks[i].size))
+      {
+         total = -1;
+         break;
+      }
+      total += rc;
+   }
+#endif
+
+   if (mutex != INVALID_MUTEX_HANDLE)
+      MutexUnlock(mutex);
+
+   return total;
+}
+
 /**
  * Extended recv() - receive data with timeout
  *
@@ -23,6 +23,7 @@
 
 #include "libnetxms.h"
 #include <nxqueue.h>
+#include <timer_wheel.h>
 
 #define DEBUG_TAG _T("threads.pool")
 
@@ -44,13 +45,14 @@ static int s_maintThreadResponsiveness = 12;
 #define MAX_WORKER_IDLE_TIMEOUT  600000
 
 /**
- * Worker thread data
+ * Number of shards in serialization queue map
  */
-struct WorkerThreadInfo
-{
-   ThreadPool *pool;
-   THREAD handle;
-};
+#define SERIALIZATION_SHARDS     32
+
+/**
+ * Initial capacity of worker's task deque
+ */
+#define WORKER_DEQUE_CAPACITY    64
 
 /**
  * Thread work request
@@ -63,6 +65,37 @@ struct WorkRequest
    INT64 runTime;
 };
 
+/**
+ * Worker slot. Each worker thread owns one slot with its own task deque. Slots are
+ * created on demand and never destroyed until pool destruction, so they can be
+ * accessed by other threads without holding pool lock.
+ */
+struct WorkerSlot
+{
+   int index;
+   MUTEX lock;
+   WorkRequest **tasks;       // Ring buffer of tasks (protected by lock)
+   int capacity;
+   int head;
+   VolatileCounter count;     // Modified under lock, may be read without lock as a hint
+   bool active;               // Slot accepts new tasks (protected by lock)
+   bool inUse;                // Slot is assigned to worker thread (protected by pool mutex)
+   CONDITION wakeup;
+   int idlePosition;          // Position in idle list or -1 (protected by pool idle lock)
+   bool searching;            // Woken up to search for new task (protected by pool idle lock)
+   INT64 averageWaitTime;     // Updated only by owning worker
+};
+
+/**
+ * Worker thread data
+ */
+struct WorkerThreadInfo
+{
+   ThreadPool *pool;
+   WorkerSlot *slot;
+   THREAD handle;
+};
+
 /**
  * Request queue for serialized execution
  */
@@ -79,6 +112,15 @@ class SerializationQueue: public Queue
    void updateMaxWaitTime(UINT32 waitTime) { m_maxWaitTime = std::max(waitTime, m_maxWaitTime); }
 };
 
+/**
+ * Shard of serialization queue map
+ */
+struct SerializationShard
+{
+   MUTEX lock;
+   StringObjectMap<SerializationQueue> *queues;
+};
+
 /**
  * Thread pool
  */
@@ -93,15 +135,22 @@ struct ThreadPool
    THREAD maintThread;
    CONDITION maintThreadWakeup;
    HashMap<UINT64, WorkerThreadInfo> *threads;
-   Queue *queue;
-   StringObjectMap<SerializationQueue> *serializationQueues;
-   MUTEX serializationLock;
-   ObjectArray<WorkRequest> *schedulerQueue;
+   WorkerSlot **slots;
+   VolatileCounter slotCount;
+   WorkerSlot **idleList;
+   int idleListSize;
+   VolatileCounter idleWorkers;
+   VolatileCounter searchingWorkers;
+   MUTEX idleLock;
+   Queue *queue;              // Tasks not assigned to any worker
+   SerializationShard serialization[SERIALIZATION_SHARDS];
+   TimerWheel *scheduler;
    MUTEX schedulerLock;
+   INT64 schedulerWakeupTime; // Time when maintenance thread will check scheduled tasks
    TCHAR *name;
    bool shutdownMode;
+   bool stopWorkers;
    INT64 loadAverage[3];
-   INT64 averageWaitTime;
    UINT64 threadStartCount;
    UINT64 threadStopCount;
    VolatileCounter64 taskExecutionCount;
@@ -113,6 +162,321 @@ struct ThreadPool
 static StringObjectMap<ThreadPool> s_registry(Ownership::False);
 static Mutex s_registryLock;
 
+/**
+ * Context of pool worker thread
+ */
+struct WorkerContext
+{
+   ThreadPool *pool;
+   WorkerSlot *slot;
+   UINT32 nextSlot;
+};
+
+#if HAVE_THREAD_LOCAL_STORAGE
+
+/**
+ * Context of current thread (NULL if current thread is not a pool worker)
+ */
+static thread_local WorkerContext *s_workerContext = NULL;
+
+/**
+ * Next slot for distributing tasks submitted from outside of the pool
+ */
+static thread_local UINT32 s_nextSlot = 0;
+
+/**
+ * Get worker context of current thread
+ */
+static inline WorkerContext *GetWorkerContext()
+{
+   return s_workerContext;
+}
+
+/**
+ * Set worker context of current thread
+ */
+static inline void SetWorkerContext(WorkerContext *context)
+{
+   s_workerContext = context;
+}
+
+/**
+ * Get next slot for task submitted from outside of the pool
+ */
+static inline UINT32 NextExternalSlot()
+{
+   return s_nextSlot++;
+}
+
+#else /* HAVE_THREAD_LOCAL_STORAGE */
+
+/**
+ * Key for context of current thread
+ */
+static pthread_key_t s_workerContextKey;
+static pthread_once_t s_workerContextKeyOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Next slot for distributing tasks submitted from outside of the pool
+ */
+static VolatileCounter s_nextSlot = 0;
+
+/**
+ * Create key for worker context
+ */
+static void CreateWorkerContextKey()
+{
+   pthread_key_create(&s_workerContextKey, NULL);
+}
+
+/**
+ * Get worker context of current thread
+ */
+static inline WorkerContext *GetWorkerContext()
+{
+   pthread_once(&s_workerContextKeyOnce, CreateWorkerContextKey);
+   return static_cast<WorkerContext*>(pthread_getspecific(s_workerContextKey));
+}
+
+/**
+ * Set worker context of current thread
+ */
+static inline void SetWorkerContext(WorkerContext *context)
+{
+   pthread_once(&s_workerContextKeyOnce, CreateWorkerContextKey);
+   pthread_setspecific(s_workerContextKey, context);
+}
+
+/**
+ * Get next slot for task submitted from outside of the pool
+ */
+static inline UINT32 NextExternalSlot()
+{
+   return static_cast<UINT32>(InterlockedIncrement(&s_nextSlot));
+}
+
+#endif /* HAVE_THREAD_LOCAL_STORAGE */
+
+/**
+ * Put task to the end of worker's deque. Slot lock must be held by caller.
+ */
+static void PushTask(WorkerSlot *s, WorkRequest *rq)
+{
+   if (s->count == s->capacity)
+   {
+      int capacity = (s->capacity > 0) ? s->capacity * 2 : WORKER_DEQUE_CAPACITY;
+      WorkRequest **tasks = MemAllocArrayNoInit<WorkRequest*>(capacity);
+      for(int i = 0; i < s->count; i++)
+         tasks[i] = s->tasks[(s->head + i) % s->capacity];
+      MemFree(s->tasks);
+      s->tasks = tasks;
+      s->capacity = capacity;
+      s->head = 0;
+   }
+   s->tasks[(s->head + s->count) % s->capacity] = rq;
+   s->count++;
+}
+
+/**
+ * Get task from the front of worker's deque. Slot lock must be held by caller.
+ */
+static WorkRequest *PopTask(WorkerSlot *s)
+{
+   if (s->count == 0)
+      return NULL;
+   WorkRequest *rq = s->tasks[s->head];
+   s->head = (s->head + 1) % s->capacity;
+   s->count--;
+   return rq;
+}
+
+/**
+ * Wake up one idle worker if there are any. Worker is not woken up if another
+ * worker was already woken up and still searching for a task - that worker will
+ * wake up next one when it finds a task and there are more tasks waiting.
+ */
+static void WakeIdleWorker(ThreadPool *p)
+{
+   // Read with full memory barrier - pairs with barrier in worker going idle
+   if ((InterlockedCompareExchange(&p->idleWorkers, 0, 0) == 0) ||
+       (InterlockedCompareExchange(&p->searchingWorkers, 0, 0) > 0))
+      return;
+
+   MutexLock(p->idleLock);
+   if ((p->idleListSize > 0) && (p->searchingWorkers == 0))
+   {
+      WorkerSlot *s = p->idleList[--p->idleListSize];
+      s->idlePosition = -1;
+      s->searching = true;
+      InterlockedIncrement(&p->searchingWorkers);
+      InterlockedDecrement(&p->idleWorkers);
+      ConditionSet(s->wakeup);
+   }
+   MutexUnlock(p->idleLock);
+}
+
+/**
+ * Put request into deque of current worker thread (if called from pool worker)
+ * or into deque of one of the active workers.
+ */
+static bool PushToWorker(ThreadPool *p, WorkRequest *rq)
+{
+   WorkerContext *context = GetWorkerContext();
+   WorkerSlot *s = (context != NULL) ? context->slot : NULL;
+   if ((s != NULL) && (context->pool == p))
+   {
+      MutexLock(s->lock);
+      if (s->active)
+      {
+         PushTask(s, rq);
+         MutexUnlock(s->lock);
+         return true;
+      }
+      MutexUnlock(s->lock);
+   }
+
+   int count = static_cast<int>(p->slotCount);
+   UINT32 start = (context != NULL) ? context->nextSlot++ : NextExternalSlot();
+   for(int i = 0; i < count; i++)
+   {
+      s = p->slots[(start + i) % count];
+      if ((s == NULL) || !s->active)
+         continue;
+      MutexLock(s->lock);
+      if (s->active)
+      {
+         PushTask(s, rq);
+         MutexUnlock(s->lock);
+         return true;
+      }
+      MutexUnlock(s->lock);
+   }
+   return false;
+}
+
+/**
+ * Submit request for execution
+ */
+static void SubmitRequest(ThreadPool *p, WorkRequest *rq)
+{
+   InterlockedIncrement(&p->activeRequests);
+   if (!PushToWorker(p, rq))
+      p->queue->put(rq);
+   WakeIdleWorker(p);
+}
+
+/**
+ * Take next task for given worker - from own deque first, then from shared
+ * queue, and then try to steal task from other workers.
+ */
+static WorkRequest *TakeTask(ThreadPool *p, WorkerSlot *self)
+{
+   WorkRequest *rq;
+   if (self->count > 0)
+   {
+      MutexLock(self->lock);
+      rq = PopTask(self);
+      MutexUnlock(self->lock);
+      if (rq != NULL)
+         return rq;
+   }
+
+   if (p->queue->size() > 0)
+   {
+      rq = static_cast<WorkRequest*>(p->queue->get());
+      if (rq != NULL)
+         return rq;
+   }
+
+   int count = static_cast<int>(p->slotCount);
+   for(int i = 1; i < count; i++)
+   {
+      WorkerSlot *victim = p->slots[(self->index + i) % count];
+      if ((victim == NULL) || (victim->count == 0))
+         continue;
+      MutexLock(victim->lock);
+      rq = PopTask(victim);
+      MutexUnlock(victim->lock);
+      if (rq != NULL)
+         return rq;
+   }
+   return NULL;
+}
+
+/**
+ * Wake up one idle worker if there are tasks waiting in shared queue or in deque
+ * of any worker. Submitters do not wake idle workers while another worker is
+ * searching, so worker which found task should check all sources, not only the
+ * one it took task from.
+ */
+static void WakeIdleWorkerIfPending(ThreadPool *p)
+{
+   bool pending = (p->queue->size() > 0);
+   int count = static_cast<int>(p->slotCount);
+   for(int i = 0; (i < count) && !pending; i++)
+   {
+      WorkerSlot *s = p->slots[i];
+      if ((s != NULL) && (s->count > 0))
+         pending = true;
+   }
+   if (pending)
+      WakeIdleWorker(p);
+}
+
+/**
+ * Leave searching state. If task was found and there are more tasks waiting, next idle worker is woken up.
+ * Searching counter is decremented before checking for waiting tasks, so either submitter sees no
+ * searching workers and wakes idle one, or this check sees submitted task.
+ */
+static inline void StopSearching(ThreadPool *p, bool *searching, bool taskFound)
+{
+   if (!*searching)
+      return;
+   *searching = false;
+   InterlockedDecrement(&p->searchingWorkers);
+   if (taskFound)
+      WakeIdleWorkerIfPending(p);
+}
+
+/**
+ * Stop accepting tasks into given slot and move remaining tasks to shared queue
+ */
+static void DeactivateSlot(ThreadPool *p, WorkerSlot *s)
+{
+   MutexLock(s->lock);
+   s->active = false;
+   bool moved = false;
+   WorkRequest *rq;
+   while((rq = PopTask(s)) != NULL)
+   {
+      p->queue->put(rq);
+      moved = true;
+   }
+   MutexUnlock(s->lock);
+   if (moved)
+      WakeIdleWorker(p);
+}
+
+/**
+ * Get average wait time across all workers (in milliseconds)
+ */
+static INT64 GetAverageWaitTime(ThreadPool *p)
+{
+   INT64 total = 0;
+   int workers = 0;
+   int count = static_cast<int>(p->slotCount);
+   for(int i = 0; i < count; i++)
+   {
+      WorkerSlot *s = p->slots[i];
+      if ((s != NULL) && s->inUse)
+      {
+         total += s->averageWaitTime;
+         workers++;
+      }
+   }
+   return (workers > 0) ? total / workers / EMA_FP_1 : 0;
+}
+
 /**
  * Worker function to join stopped thread
  */
@@ -128,7 +492,12 @@ static void JoinWorkerThread(void *arg)
 static THREAD_RESULT THREAD_CALL WorkerThread(void *arg)
 {
    ThreadPool *p = static_cast<WorkerThreadInfo*>(arg)->pool;
-   Queue *q = p->queue;
+   WorkerSlot *s = static_cast<WorkerThreadInfo*>(arg)->slot;
+   WorkerContext context;
+   context.pool = p;
+   context.slot = s;
+   context.nextSlot = s->index;
+   SetWorkerContext(&context);
 
    char threadName[16];
    threadName[0] = '$';
@@ -140,58 +509,176 @@ static THREAD_RESULT THREAD_CALL WorkerThread(void *arg)
    strlcat(threadName, "/WRK", 16);
    ThreadSetName(threadName);
 
+   bool searching = false;
    while(true)
    {
-      WorkRequest *rq = static_cast<WorkRequest*>(q->getOrBlock(p->workerIdleTimeout));
-
+      WorkRequest *rq = TakeTask(p, s);
+      StopSearching(p, &searching, rq != NULL);
       if (rq == NULL)
       {
-         if (p->shutdownMode)
+         // Register as idle and check for tasks again to avoid missing wakeup
+         MutexLock(p->idleLock);
+         if (p->stopWorkers)
          {
-            // If pool shutdown already activated ignore timeout and wait for stop request
-            nxlog_debug_tag(DEBUG_TAG, 2, _T("Worker thread timeout during shutdown in thread pool %s"), p->name);
-            continue;
+            MutexUnlock(p->idleLock);
+            MutexLock(s->lock);
+            if (s->count > 0)
+            {
+               MutexUnlock(s->lock);
+               continue;
+            }
+            s->active = false;
+            MutexUnlock(s->lock);
+            if (p->queue->size() > 0)
+               continue;
+            break;
          }
+         s->idlePosition = p->idleListSize;
+         p->idleList[p->idleListSize++] = s;
+         InterlockedIncrement(&p->idleWorkers);
+         MutexUnlock(p->idleLock);
+
+         rq = TakeTask(p, s);
+         bool signalled = (rq == NULL) ? ConditionWait(s->wakeup, p->workerIdleTimeout) : false;
 
-         MutexLock(p->mutex);
-         if ((p->threads->size() <= p->minThreads) || (p->averageWaitTime / EMA_FP_1 > s_waitTimeLowWatermark))
+         MutexLock(p->idleLock);
+         if (s->idlePosition != -1)
          {
-            MutexUnlock(p->mutex);
-            continue;
+            WorkerSlot *last = p->idleList[--p->idleListSize];
+            p->idleList[s->idlePosition] = last;
+            last->idlePosition = s->idlePosition;
+            s->idlePosition = -1;
+            InterlockedDecrement(&p->idleWorkers);
          }
-         p->threads->remove(CAST_FROM_POINTER(arg, UINT64));
-         p->threadStopCount++;
-         MutexUnlock(p->mutex);
+         searching = s->searching;
+         s->searching = false;
+         MutexUnlock(p->idleLock);
 
-         nxlog_debug_tag(DEBUG_TAG, 5, _T("Stopping worker thread in thread pool %s due to inactivity"), p->name);
+         if (rq != NULL)
+         {
+            // Submitters could skip wakeup while this worker was searching or registering as idle
+            if (searching)
+               StopSearching(p, &searching, true);
+            else
+               WakeIdleWorkerIfPending(p);
+         }
+         else
+         {
+            if (signalled || searching || p->stopWorkers)
+               continue;
 
-         MemFree(rq);
-         rq = MemAllocStruct<WorkRequest>();
-         rq->func = JoinWorkerThread;
-         rq->arg = arg;
-         rq->queueTime = GetCurrentTimeMs();
-         InterlockedIncrement(&p->activeRequests);
-         p->queue->put(rq);
-         break;
+            if (p->shutdownMode)
+            {
+               // If pool shutdown already activated ignore timeout and wait for stop request
+               nxlog_debug_tag(DEBUG_TAG, 2, _T("Worker thread timeout during shutdown in thread pool %s"), p->name);
+               continue;
+            }
+
+            MutexLock(p->mutex);
+            if ((p->threads->size() <= p->minThreads) || (GetAverageWaitTime(p) > s_waitTimeLowWatermark))
+            {
+               MutexUnlock(p->mutex);
+               continue;
+            }
+            p->threads->remove(CAST_FROM_POINTER(arg, UINT64));
+            p->threadStopCount++;
+            DeactivateSlot(p, s);
+            s->inUse = false;
+            MutexUnlock(p->mutex);
+
+            nxlog_debug_tag(DEBUG_TAG, 5, _T("Stopping worker thread in thread pool %s due to inactivity"), p->name);
+
+            rq = MemAllocStruct<WorkRequest>();
+            rq->func = JoinWorkerThread;
+            rq->arg = arg;
+            rq->queueTime = GetCurrentTimeMs();
+            InterlockedIncrement(&p->activeRequests);
+            p->queue->put(rq);
+            WakeIdleWorker(p);
+            break;
+         }
       }
-      
-      if (rq->func == NULL) // stop indicator
-         break;
-      
+
       INT64 waitTime = (GetCurrentTimeMs() - rq->queueTime) << EMA_FP_SHIFT;
-      MutexLock(p->mutex);
-      UpdateExpMovingAverage(p->averageWaitTime, EMA_EXP_180, waitTime);
-      MutexUnlock(p->mutex);
+      UpdateExpMovingAverage(s->averageWaitTime, EMA_EXP_180, waitTime);
 
       rq->func(rq->arg);
       MemFree(rq);
       InterlockedDecrement(&p->activeRequests);
    }
 
+   SetWorkerContext(NULL);
    nxlog_debug_tag(DEBUG_TAG, 8, _T("Worker thread in thread pool %s stopped"), p->name);
    return THREAD_OK;
 }
 
+/**
+ * Start new worker thread. Pool mutex must be held by caller.
+ */
+static bool StartWorkerThread(ThreadPool *p)
+{
+   WorkerSlot *s = NULL;
+   int count = static_cast<int>(p->slotCount);
+   for(int i = 0; i < count; i++)
+   {
+      if (!p->slots[i]->inUse)
+      {
+         s = p->slots[i];
+         break;
+      }
+   }
+   if (s == NULL)
+   {
+      if (count >= p->maxThreads)
+         return false;
+      s = MemAllocStruct<WorkerSlot>();
+      s->index = count;
+      s->lock = MutexCreateFast();
+      s->wakeup = ConditionCreate(false);
+      s->idlePosition = -1;
+      p->slots[count] = s;
+      InterlockedIncrement(&p->slotCount);
+   }
+
+   s->inUse = true;
+   s->averageWaitTime = 0;
+   MutexLock(s->lock);
+   s->active = true;
+   MutexUnlock(s->lock);
+
+   WorkerThreadInfo *wt = new WorkerThreadInfo;
+   wt->pool = p;
+   wt->slot = s;
+   wt->handle = ThreadCreateEx(WorkerThread, p->stackSize, wt);
+   if (wt->handle == INVALID_THREAD_HANDLE)
+   {
+      DeactivateSlot(p, s);
+      s->inUse = false;
+      delete wt;
+      return false;
+   }
+   p->threads->set(CAST_FROM_POINTER(wt, UINT64), wt);
+   return true;
+}
+
+/**
+ * Submit scheduled request for execution (called by scheduler on timer expiration)
+ */
+static void SubmitScheduledRequest(void *data, void *context)
+{
+   WorkRequest *rq = static_cast<WorkRequest*>(data);
+   rq->queueTime = GetCurrentTimeMs();
+   SubmitRequest(static_cast<ThreadPool*>(context), rq);
+}
+
+/**
+ * Destroy scheduled request which was not executed
+ */
+static void DestroyScheduledRequest(void *data, void *context)
+{
+   MemFree(data);
+}
+
 /**
  * Thread pool maintenance thread
  */
@@ -237,28 +724,20 @@ static THREAD_RESULT THREAD_CALL MaintenanceThread(void *arg)
 
             MutexLock(p->mutex);
             int threadCount = p->threads->size();
-            INT64 averageWaitTime = p->averageWaitTime / EMA_FP_1;
+            INT64 averageWaitTime = GetAverageWaitTime(p);
             if (((averageWaitTime > s_waitTimeHighWatermark) && (threadCount < p->maxThreads)) ||
                 ((threadCount == 0) && (p->activeRequests > 0)))
             {
                int delta = std::min(p->maxThreads - threadCount, std::max((static_cast<int>(p->activeRequests) - threadCount) / 2, 1));
                for(int i = 0; i < delta; i++)
                {
-                  WorkerThreadInfo *wt = new WorkerThreadInfo;
-                  wt->pool = p;
-                  wt->handle = ThreadCreateEx(WorkerThread, p->stackSize, wt);
-                  if (wt->handle != INVALID_THREAD_HANDLE)
+                  if (!StartWorkerThread(p))
                   {
-                     p->threads->set(CAST_FROM_POINTER(wt, UINT64), wt);
-                     p->threadStartCount++;
-                     started++;
-                  }
-                  else
-                  {
-                     delete wt;
                      failure = true;
                      break;
                   }
+                  p->threadStartCount++;
+                  started++;
                }
                if (p->workerIdleTimeout < MAX_WORKER_IDLE_TIMEOUT)
                {
@@ -286,28 +765,17 @@ static THREAD_RESULT THREAD_CALL MaintenanceThread(void *arg)
       }
       sleepTime = 5000 - cycleTime;
 
-      // Check scheduler queue
+      // Check scheduled tasks
       MutexLock(p->schedulerLock);
-      if (p->schedulerQueue->size() > 0)
+      INT64 now = GetCurrentTimeMs();
+      if (p->scheduler->size() > 0)
       {
-         INT64 now = GetCurrentTimeMs();
-         WorkRequest *rq;
-         while(p->schedulerQueue->size() > 0)
-         {
-            rq = p->schedulerQueue->get(0);
-            if (rq->runTime > now)
-            {
-               UINT32 delay = static_cast<UINT32>(rq->runTime - now);
-               if (delay < sleepTime)
-                  sleepTime = delay;
-               break;
-            }
-            p->schedulerQueue->remove(0);
-            InterlockedIncrement(&p->activeRequests);
-            rq->queueTime = now;
-            p->queue->put(rq);
-         }
+         p->scheduler->advance(now, SubmitScheduledRequest, p);
+         INT64 next = p->scheduler->getNextExpirationTime();
+         if ((next != -1) && (next - now < static_cast<INT64>(sleepTime)))
+            sleepTime = static_cast<UINT32>(std::max(next - now, static_cast<INT64>(0)));
       }
+      p->schedulerWakeupTime = now + sleepTime;
       MutexUnlock(p->schedulerLock);
    }
    nxlog_debug_tag(DEBUG_TAG, 3, _T("Maintenance thread for thread pool %s stopped"), p->name);
@@ -321,39 +789,40 @@ ThreadPool LIBNETXMS_EXPORTABLE *ThreadPoolCreate(const TCHAR *name, int minThre
 {
    ThreadPool *p = MemAllocStruct<ThreadPool>();
    p->minThreads = minThreads;
-   p->maxThreads = maxThreads;
+   p->maxThreads = std::max(std::max(maxThreads, minThreads), 1);
    p->stackSize = stackSize;
    p->workerIdleTimeout = MIN_WORKER_IDLE_TIMEOUT;
    p->activeRequests = 0;
    p->threads = new HashMap<UINT64, WorkerThreadInfo>();
+   p->slots = MemAllocArray<WorkerSlot*>(p->maxThreads);
+   p->slotCount = 0;
+   p->idleList = MemAllocArray<WorkerSlot*>(p->maxThreads);
+   p->idleListSize = 0;
+   p->idleWorkers = 0;
+   p->idleLock = MutexCreateFast();
    p->queue = new Queue(64, Ownership::False);
    p->mutex = MutexCreate();
    p->maintThreadWakeup = ConditionCreate(false);
-   p->serializationQueues = new StringObjectMap<SerializationQueue>(Ownership::True);
-   p->serializationQueues->setIgnoreCase(false);
-   p->serializationLock = MutexCreate();
-   p->schedulerQueue = new ObjectArray<WorkRequest>(16, 16, Ownership::False);
-   p->schedulerLock = MutexCreate();
+   for(int i = 0; i < SERIALIZATION_SHARDS; i++)
+   {
+      p->serialization[i].lock = MutexCreateFast();
+      p->serialization[i].queues = new StringObjectMap<SerializationQueue>(Ownership::True);
+      p->serialization[i].queues->setIgnoreCase(false);
+   }
+   p->scheduler = new TimerWheel(GetCurrentTimeMs());
+   p->schedulerLock = MutexCreateFast();
+   p->schedulerWakeupTime = GetCurrentTimeMs() + 5000;
    p->name = (name != NULL) ? MemCopyString(name) : MemCopyString(_T("NONAME"));
    p->shutdownMode = false;
+   p->stopWorkers = false;
 
    p->maintThread = ThreadCreateEx(MaintenanceThread, 256 * 1024, p);
 
    MutexLock(p->mutex);
    for(int i = 0; i < p->minThreads; i++)
    {
-      WorkerThreadInfo *wt = new WorkerThreadInfo;
-      wt->pool = p;
-      wt->handle = ThreadCreateEx(WorkerThread, stackSize, wt);
-      if (wt->handle != INVALID_THREAD_HANDLE)
-      {
-         p->threads->set(CAST_FROM_POINTER(wt, UINT64), wt);
-      }
-      else
-      {
+      if (!StartWorkerThread(p))
          nxlog_debug_tag(DEBUG_TAG, 1, _T("Cannot create worker thread in pool %s"), p->name);
-         delete wt;
-      }
    }
    MutexUnlock(p->mutex);
 
@@ -391,26 +860,45 @@ void LIBNETXMS_EXPORTABLE ThreadPoolDestroy(ThreadPool *p)
    ThreadJoin(p->maintThread);
    ConditionDestroy(p->maintThreadWakeup);
 
-   WorkRequest rq;
-   rq.func = NULL;
-   rq.queueTime = GetCurrentTimeMs();
-   MutexLock(p->mutex);
-   int count = p->threads->size();
-   for(int i = 0; i < count; i++)
-      p->queue->put(&rq);
-   MutexUnlock(p->mutex);
+   // Workers will stop after all queued tasks are processed
+   MutexLock(p->idleLock);
+   p->stopWorkers = true;
+   while(p->idleListSize > 0)
+   {
+      WorkerSlot *s = p->idleList[--p->idleListSize];
+      s->idlePosition = -1;
+      InterlockedDecrement(&p->idleWorkers);
+      ConditionSet(s->wakeup);
+   }
+   MutexUnlock(p->idleLock);
 
    p->threads->forEach(ThreadPoolDestroyCallback, NULL);
 
    nxlog_debug_tag(DEBUG_TAG, 1, _T("Thread pool %s destroyed"), p->name);
    p->threads->setOwner(Ownership::True);
    delete p->threads;
+   for(int i = 0; i < p->slotCount; i++)
+   {
+      WorkerSlot *s = p->slots[i];
+      WorkRequest *rq;
+      while((rq = PopTask(s)) != NULL)
+         MemFree(rq);
+      MemFree(s->tasks);
+      MutexDestroy(s->lock);
+      ConditionDestroy(s->wakeup);
+      MemFree(s);
+   }
+   MemFree(p->slots);
+   MemFree(p->idleList);
+   MutexDestroy(p->idleLock);
    delete p->queue;
-   delete p->serializationQueues;
-   MutexDestroy(p->serializationLock);
-   for(int i = 0; i < p->schedulerQueue->size(); i++)
-      MemFree(p->schedulerQueue->get(i));
-   delete p->schedulerQueue;
+   for(int i = 0; i < SERIALIZATION_SHARDS; i++)
+   {
+      delete p->serialization[i].queues;
+      MutexDestroy(p->serialization[i].lock);
+   }
+   p->scheduler->clear(DestroyScheduledRequest, NULL);
+   delete p->scheduler;
    MutexDestroy(p->schedulerLock);
    MutexDestroy(p->mutex);
    MemFree(p->name);
@@ -425,13 +913,26 @@ void LIBNETXMS_EXPORTABLE ThreadPoolExecute(ThreadPool *p, ThreadPoolWorkerFunct
    if (p->shutdownMode)
       return;
 
-   InterlockedIncrement(&p->activeRequests);
    InterlockedIncrement64(&p->taskExecutionCount);
    WorkRequest *rq = MemAllocStruct<WorkRequest>();
    rq->func = f;
    rq->arg = arg;
    rq->queueTime = GetCurrentTimeMs();
-   p->queue->put(rq);
+   SubmitRequest(p, rq);
+}
+
+/**
+ * Get serialization shard for given key
+ */
+static inline SerializationShard *GetSerializationShard(ThreadPool *p, const TCHAR *key)
+{
+   UINT32 hash = 2166136261U;
+   for(const TCHAR *c = key; *c != 0; c++)
+   {
+      hash ^= static_cast<UINT32>(*c);
+      hash *= 16777619U;
+   }
+   return &p->serialization[hash % SERIALIZATION_SHARDS];
 }
 
 /**
@@ -440,8 +941,8 @@ void LIBNETXMS_EXPORTABLE ThreadPoolExecute(ThreadPool *p, ThreadPoolWorkerFunct
 struct RequestSerializationData
 {
    TCHAR *key;
-   ThreadPool *pool;
-   Queue *queue;
+   SerializationShard *shard;
+   SerializationQueue *queue;
 };
 
 /**
@@ -451,17 +952,16 @@ static void ProcessSerializedRequests(RequestSerializationData *data)
 {
    while(true)
    {
-      MutexLock(data->pool->serializationLock);
+      MutexLock(data->shard->lock);
       WorkRequest *rq = static_cast<WorkRequest*>(data->queue->get());
       if (rq == NULL)
       {
-         data->pool->serializationQueues->remove(data->key);
-         MutexUnlock(data->pool->serializationLock);
+         data->shard->queues->remove(data->key);
+         MutexUnlock(data->shard->lock);
          break;
       }
-      SerializationQueue *q = data->pool->serializationQueues->get(data->key);
-      q->updateMaxWaitTime(static_cast<UINT32>(GetCurrentTimeMs() - rq->queueTime));
-      MutexUnlock(data->pool->serializationLock);
+      data->queue->updateMaxWaitTime(static_cast<UINT32>(GetCurrentTimeMs() - rq->queueTime));
+      MutexUnlock(data->shard->lock);
 
       rq->func(rq->arg);
       MemFree(rq);
@@ -478,47 +978,39 @@ void LIBNETXMS_EXPORTABLE ThreadPoolExecuteSerialized(ThreadPool *p, const TCHAR
    if (p->shutdownMode)
       return;
 
-   MutexLock(p->serializationLock);
-   
-   SerializationQueue *q = p->serializationQueues->get(key);
+   WorkRequest *rq = MemAllocStruct<WorkRequest>();
+   rq->func = f;
+   rq->arg = arg;
+   rq->queueTime = GetCurrentTimeMs();
+
+   SerializationShard *shard = GetSerializationShard(p, key);
+   MutexLock(shard->lock);
+
+   SerializationQueue *q = shard->queues->get(key);
    if (q == NULL)
    {
       q = new SerializationQueue(64);
-      p->serializationQueues->set(key, q);
+      shard->queues->set(key, q);
 
       RequestSerializationData *data = new RequestSerializationData;
       data->key = _tcsdup(key);
-      data->pool = p;
+      data->shard = shard;
       data->queue = q;
       ThreadPoolExecute(p, ProcessSerializedRequests, data);
    }
-
-   WorkRequest *rq = MemAllocStruct<WorkRequest>();
-   rq->func = f;
-   rq->arg = arg;
-   rq->queueTime = GetCurrentTimeMs();
    q->put(rq);
 
-   MutexUnlock(p->serializationLock);
-}
-
-/**
- * Scheduled requests comparator (used for task sorting)
- */
-static int ScheduledRequestsComparator(const WorkRequest **e1, const WorkRequest **e2)
-{
-   time_t t1 = (*e1)->runTime;
-   time_t t2 = (*e2)->runTime;
-   return (t1 < t2) ? -1 : ((t1 > t2) ? 1 : 0);
+   MutexUnlock(shard->lock);
 }
 
 /**
- * Schedule task for execution using absolute time (in milliseconds)
+ * Schedule task for execution using absolute time (in milliseconds).
+ * Returns identifier of scheduled task which can be used for cancellation or 0 on failure.
  */
-void LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsoluteMs(ThreadPool *p, INT64 runTime, ThreadPoolWorkerFunction f, void *arg)
+UINT64 LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsoluteMs(ThreadPool *p, INT64 runTime, ThreadPoolWorkerFunction f, void *arg)
 {
    if (p->shutdownMode)
-      return;
+      return 0;
 
    WorkRequest *rq = MemAllocStruct<WorkRequest>();
    rq->func = f;
@@ -527,29 +1019,59 @@ void LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsoluteMs(ThreadPool *p, INT64 runT
    rq->queueTime = GetCurrentTimeMs();
 
    MutexLock(p->schedulerLock);
-   p->schedulerQueue->add(rq);
-   p->schedulerQueue->sort(ScheduledRequestsComparator);
+   UINT64 id = p->scheduler->add(runTime, rq);
+   // Wake up maintenance thread only if it will not check scheduled tasks in time
+   bool wakeup = (runTime < p->schedulerWakeupTime);
+   if (wakeup)
+      p->schedulerWakeupTime = runTime;
    MutexUnlock(p->schedulerLock);
-   ConditionSet(p->maintThreadWakeup);
+
+   if (id == 0)
+   {
+      MemFree(rq);
+      return 0;
+   }
+   if (wakeup)
+      ConditionSet(p->maintThreadWakeup);
+   return id;
 }
 
 /**
  * Schedule task for execution using absolute time
  */
-void LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsolute(ThreadPool *p, time_t runTime, ThreadPoolWorkerFunction f, void *arg)
+UINT64 LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsolute(ThreadPool *p, time_t runTime, ThreadPoolWorkerFunction f, void *arg)
 {
-   ThreadPoolScheduleAbsoluteMs(p, static_cast<INT64>(runTime) * 1000, f, arg);
+   return ThreadPoolScheduleAbsoluteMs(p, static_cast<INT64>(runTime) * 1000, f, arg);
 }
 
 /**
- * Schedule task for execution using relative time (delay in milliseconds)
+ * Schedule task for execution using relative time (delay in milliseconds).
+ * Task with zero delay is submitted for immediate execution and cannot be cancelled (0 is returned as task ID).
  */
-void LIBNETXMS_EXPORTABLE ThreadPoolScheduleRelative(ThreadPool *p, UINT32 delay, ThreadPoolWorkerFunction f, void *arg)
+UINT64 LIBNETXMS_EXPORTABLE ThreadPoolScheduleRelative(ThreadPool *p, UINT32 delay, ThreadPoolWorkerFunction f, void *arg)
 {
    if (delay > 0)
-      ThreadPoolScheduleAbsoluteMs(p, GetCurrentTimeMs() + delay, f, arg);
-   else
-      ThreadPoolExecute(p, f, arg);
+      return ThreadPoolScheduleAbsoluteMs(p, GetCurrentTimeMs() + delay, f, arg);
+   ThreadPoolExecute(p, f, arg);
+   return 0;
+}
+
+/**
+ * Cancel scheduled task. Returns true if task was cancelled and false if it was not found
+ * (already submitted for execution or cancelled). Task argument is not destroyed.
+ */
+bool LIBNETXMS_EXPORTABLE ThreadPoolCancelScheduledTask(ThreadPool *p, UINT64 taskId)
+{
+   if (taskId == 0)
+      return false;
+
+   void *rq;
+   MutexLock(p->schedulerLock);
+   bool success = p->scheduler->cancel(taskId, &rq);
+   MutexUnlock(p->schedulerLock);
+   if (success)
+      MemFree(rq);
+   return success;
 }
 
 /**
@@ -571,20 +1093,24 @@ void LIBNETXMS_EXPORTABLE ThreadPoolGetInfo(ThreadPool *p, ThreadPoolInfo *info)
    info->loadAvg[0] = GetExpMovingAverageValue(p->loadAverage[0]);
    info->loadAvg[1] = GetExpMovingAverageValue(p->loadAverage[1]);
    info->loadAvg[2] = GetExpMovingAverageValue(p->loadAverage[2]);
-   info->averageWaitTime = static_cast<UINT32>(p->averageWaitTime / EMA_FP_1);
+   info->averageWaitTime = static_cast<UINT32>(GetAverageWaitTime(p));
    MutexUnlock(p->mutex);
 
    MutexLock(p->schedulerLock);
-   info->scheduledRequests = p->schedulerQueue->size();
+   info->scheduledRequests = p->scheduler->size();
    MutexUnlock(p->schedulerLock);
 
    info->serializedRequests = 0;
-   MutexLock(p->serializationLock);
-   Iterator<std::pair<const TCHAR*, SerializationQueue*>> *it = p->serializationQueues->iterator();
-   while(it->hasNext())
-      info->serializedRequests += static_cast<int>(it->next()->second->size());
-   delete it;
-   MutexUnlock(p->serializationLock);
+   for(int i = 0; i < SERIALIZATION_SHARDS; i++)
+   {
+      SerializationShard *shard = &p->serialization[i];
+      MutexLock(shard->lock);
+      Iterator<std::pair<const TCHAR*, SerializationQueue*>> *it = shard->queues->iterator();
+      while(it->hasNext())
+         info->serializedRequests += static_cast<int>(it->next()->second->size());
+      delete it;
+      MutexUnlock(shard->lock);
+   }
 }
 
 /**
@@ -616,10 +1142,11 @@ StringList LIBNETXMS_EXPORTABLE *ThreadPoolGetAllPools()
  */
 int LIBNETXMS_EXPORTABLE ThreadPoolGetSerializedRequestCount(ThreadPool *p, const TCHAR *key)
 {
-   MutexLock(p->serializationLock);
-   SerializationQueue *q = p->serializationQueues->get(key);
+   SerializationShard *shard = GetSerializationShard(p, key);
+   MutexLock(shard->lock);
+   SerializationQueue *q = shard->queues->get(key);
    int count = (q != NULL) ? static_cast<int>(q->size()) : 0;
-   MutexUnlock(p->serializationLock);
+   MutexUnlock(shard->lock);
    return count;
 }
 
@@ -628,10 +1155,11 @@ int LIBNETXMS_EXPORTABLE ThreadPoolGetSerializedRequestCount(ThreadPool *p, cons
  */
 UINT32 LIBNETXMS_EXPORTABLE ThreadPoolGetSerializedRequestMaxWaitTime(ThreadPool *p, const TCHAR *key)
 {
-   MutexLock(p->serializationLock);
-   SerializationQueue *q = p->serializationQueues->get(key);
+   SerializationShard *shard = GetSerializationShard(p, key);
+   MutexLock(shard->lock);
+   SerializationQueue *q = shard->queues->get(key);
    UINT32 waitTime = (q != NULL) ? q->getMaxWaitTime() : 0;
-   MutexUnlock(p->serializationLock);
+   MutexUnlock(shard->lock);
    return waitTime;
 }
 
@@ -35,20 +35,39 @@
 #define READ_BUFFER_SIZE      4096
 
 /**
- * Find byte sequence in the stream
+ * Find byte sequence in the stream. Sequence is treated as single character unit, so only
+ * positions aligned to sequence length are considered. Sequence must contain at least one
+ * non-zero byte, which is located with memchr() instead of comparing every unit.
  */
-static char *FindSequence(char *start, int length, const char *sequence, int seqLength)
+char LIBNXLP_EXPORTABLE *FindSequence(char *start, int length, const char *sequence, int seqLength)
 {
-	char *curr = start;
-	int count = 0;
-	while(length - count >= seqLength)
-	{
-		if (!memcmp(curr, sequence, seqLength))
-			return curr;
-		curr += seqLength;
-		count += seqLength;
-	}
-	return NULL;
+   int keyOffset = 0;
+   while((keyOffset < seqLength - 1) && (sequence[keyOffset] == 0))
+      keyOffset++;
+   char key = sequence[keyOffset];
+
+   char *end = start + (length - length % seqLength);   // only complete units
+   char *curr = start + keyOffset;
+   while(curr < end)
+   {
+      curr = (char *)memchr(curr, key, end - curr);
+      if (curr == NULL)
+         return NULL;
+
+      int unitOffset = (int)(curr - start) - keyOffset;
+      int misalignment = unitOffset % seqLength;
+      if (misalignment == 0)
+      {
+         if (!memcmp(start + unitOffset, sequence, seqLength))
+            return start + unitOffset;
+         curr += seqLength;
+      }
+      else
+      {
+         curr += seqLength - misalignment;   // key byte position in next unit
+      }
+   }
+   return NULL;
 }
 
 /**
@@ -579,10 +598,37 @@ bool LogParser::monitorFile()
 			_lseek(fh, 0, SEEK_END);
 		}
 
+      // Use change notifications where available and fall back to polling otherwise.
+      // Writes into preallocated files do not change file size and are always polled.
+      FileWatch *watch = m_preallocatedFile ? NULL : AddFileWatch(fname, m_fileChangeCondition);
 		while(true)
 		{
-			if (ConditionWait(m_stopCondition, 5000))
-				goto stop_parser;
+         if (watch != NULL)
+         {
+            // Keep same polling interval as without notifications - changes made on
+            // network file systems (NFS, CIFS) are not reported by inotify
+            ConditionWait(m_fileChangeCondition, 5000);
+            if (ConditionWait(m_stopCondition, 0))
+            {
+               RemoveFileWatch(watch);
+               _close(fh);
+               goto stop_parser;
+            }
+
+            UINT32 events = GetFileWatchEvents(watch);
+            if ((events & FILE_EVENT_REPLACED) && !m_rescan)
+            {
+               // File was renamed or deleted - read records written before that, checks below will reopen file
+               nxlog_debug_tag(DEBUG_TAG, 6, _T("Replace notification for file \"%s\""), fname);
+               off_t resetPos = ParseNewRecords(this, fh);
+               _lseek(fh, resetPos, SEEK_SET);
+            }
+         }
+         else if (ConditionWait(m_stopCondition, 5000))
+         {
+            _close(fh);
+            goto stop_parser;
+         }
 
 			// Check if file name was changed
 			ExpandFileName(getFileName(), temp, MAX_PATH, true);
@@ -677,6 +723,7 @@ bool LogParser::monitorFile()
 				break;
 			}
 		}
+      RemoveFileWatch(watch);
 		_close(fh);
 	}
 
@@ -0,0 +1,357 @@
+/*
+** NetXMS - Network Management System
+** Log Parsing Library
+** Copyright (C) 2003-2020 Raden Solutions
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: filewatch.cpp
+**
+**/
+
+#include "libnxlp.h"
+
+#if HAVE_SYS_INOTIFY_H
+
+#include <sys/inotify.h>
+
+#if HAVE_POLL_H
+#include <poll.h>
+#endif
+
+/**
+ * Events watched on file itself
+ */
+#define FILE_WATCH_MASK (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+
+/**
+ * Events watched on directory containing the file
+ */
+#define DIR_WATCH_MASK (IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR)
+
+/**
+ * File watch registration
+ */
+struct FileWatch
+{
+   int fileWd;
+   int dirWd;
+   char *name;          // File name without directory (as reported in directory events)
+   CONDITION wakeup;
+   UINT32 events;
+};
+
+/**
+ * Watcher state
+ */
+static Mutex s_watchLock;
+static ObjectArray<FileWatch> s_watches(64, 64, Ownership::False);
+static int s_inotifyFd = -1;
+static int s_controlPipe[2] = { -1, -1 };
+static THREAD s_watcherThread = INVALID_THREAD_HANDLE;
+static bool s_watcherFailed = false;
+
+/**
+ * Post events to all watches matching given descriptor (and file name for directory events).
+ * Watch lock must be held by caller.
+ */
+static void PostFileEvents(int wd, const char *name, UINT32 events)
+{
+   for(int i = 0; i < s_watches.size(); i++)
+   {
+      FileWatch *w = s_watches.get(i);
+      if (((name == NULL) && (w->fileWd == wd)) || ((name != NULL) && (w->dirWd == wd) && !strcmp(w->name, name)))
+      {
+         w->events |= events;
+         ConditionSet(w->wakeup);
+      }
+   }
+}
+
+/**
+ * Watcher thread. Single thread serves all watched files in the process.
+ */
+static THREAD_RESULT THREAD_CALL FileWatcherThread(void *arg)
+{
+   nxlog_debug_tag(DEBUG_TAG, 3, _T("File watcher thread started"));
+
+   // Buffer should be aligned for struct inotify_event
+   union
+   {
+      struct inotify_event event;
+      char data[65536];
+   } buffer;
+
+   struct pollfd fds[2];
+   fds[0].fd = s_inotifyFd;
+   fds[0].events = POLLIN;
+   fds[1].fd = s_controlPipe[0];
+   fds[1].events = POLLIN;
+   while(true)
+   {
+      int rc = poll(fds, 2, -1);
+      if (rc < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         nxlog_debug_tag(DEBUG_TAG, 1, _T("File watcher: poll() failed (errno=%d)"), errno);
+         break;
+      }
+
+      if (fds[1].revents != 0)
+         break;   // stop request
+
+      if (!(fds[0].revents & POLLIN))
+         continue;
+
+      ssize_t bytes = read(s_inotifyFd, buffer.data, sizeof(buffer.data));
+      if (bytes <= 0)
+         continue;
+
+      s_watchLock.lock();
+      for(char *p = buffer.data; p < buffer.data + bytes;)
+      {
+         struct inotify_event *e = reinterpret_cast<struct inotify_event*>(p);
+         if (e->mask & IN_Q_OVERFLOW)
+         {
+            // Events were lost, let all parsers check their files
+            for(int i = 0; i < s_watches.size(); i++)
+            {
+               FileWatch *w = s_watches.get(i);
+               w->events |= FILE_EVENT_MODIFIED;
+               ConditionSet(w->wakeup);
+            }
+         }
+         else if ((e->len > 0) && (e->mask & (IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)))
+         {
+            PostFileEvents(e->wd, e->name, FILE_EVENT_REPLACED);
+         }
+         else if (e->mask & (IN_MOVE_SELF | IN_DELETE_SELF))
+         {
+            PostFileEvents(e->wd, NULL, FILE_EVENT_REPLACED);
+         }
+         else if (e->mask & (IN_MODIFY | IN_ATTRIB))
+         {
+            PostFileEvents(e->wd, NULL, FILE_EVENT_MODIFIED);
+         }
+         p += sizeof(struct inotify_event) + e->len;
+      }
+      s_watchLock.unlock();
+   }
+
+   nxlog_debug_tag(DEBUG_TAG, 3, _T("File watcher thread stopped"));
+   return THREAD_OK;
+}
+
+/**
+ * Start watcher thread. Watch lock must be held by caller.
+ */
+static bool StartFileWatcher()
+{
+   if (s_watcherThread != INVALID_THREAD_HANDLE)
+      return true;
+   if (s_watcherFailed)
+      return false;
+
+   s_inotifyFd = inotify_init();
+   if (s_inotifyFd == -1)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 2, _T("File watcher: inotify_init() failed (errno=%d), falling back to polling"), errno);
+      s_watcherFailed = true;
+      return false;
+   }
+   fcntl(s_inotifyFd, F_SETFD, fcntl(s_inotifyFd, F_GETFD) | FD_CLOEXEC);
+   if (pipe(s_controlPipe) != 0)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 2, _T("File watcher: pipe() failed (errno=%d), falling back to polling"), errno);
+      close(s_inotifyFd);
+      s_inotifyFd = -1;
+      s_watcherFailed = true;
+      return false;
+   }
+
+   s_watcherThread = ThreadCreateEx(FileWatcherThread, 0, NULL);
+   if (s_watcherThread == INVALID_THREAD_HANDLE)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 2, _T("File watcher: cannot create watcher thread, falling back to polling"));
+      close(s_inotifyFd);
+      close(s_controlPipe[0]);
+      close(s_controlPipe[1]);
+      s_inotifyFd = -1;
+      s_controlPipe[0] = -1;
+      s_controlPipe[1] = -1;
+      s_watcherFailed = true;
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Stop watcher thread
+ */
+void StopFileWatcher()
+{
+   s_watchLock.lock();
+   THREAD thread = s_watcherThread;
+   s_watcherThread = INVALID_THREAD_HANDLE;
+   s_watchLock.unlock();
+   if (thread == INVALID_THREAD_HANDLE)
+      return;
+
+   write(s_controlPipe[1], "S", 1);
+   ThreadJoin(thread);
+
+   s_watchLock.lock();
+   close(s_inotifyFd);
+   close(s_controlPipe[0]);
+   close(s_controlPipe[1]);
+   s_inotifyFd = -1;
+   s_controlPipe[0] = -1;
+   s_controlPipe[1] = -1;
+   s_watchLock.unlock();
+}
+
+/**
+ * Check if watch descriptor is used by any registered watch. Watch lock must be held by caller.
+ */
+static bool IsWatchDescriptorUsed(int wd)
+{
+   for(int i = 0; i < s_watches.size(); i++)
+   {
+      FileWatch *w = s_watches.get(i);
+      if ((w->fileWd == wd) || (w->dirWd == wd))
+         return true;
+   }
+   return false;
+}
+
+/**
+ * Start watching given file. Wakeup condition will be set on every file change. Returns NULL if
+ * file cannot be watched (caller should fall back to polling).
+ */
+FileWatch *AddFileWatch(const TCHAR *path, CONDITION wakeup)
+{
+#ifdef UNICODE
+   char *mbpath = MBStringFromWideStringSysLocale(path);
+#else
+   char *mbpath = MemCopyStringA(path);
+#endif
+
+   FileWatch *watch = NULL;
+   s_watchLock.lock();
+   if (StartFileWatcher())
+   {
+      int fileWd = inotify_add_watch(s_inotifyFd, mbpath, FILE_WATCH_MASK);
+      if (fileWd != -1)
+      {
+         // Directory is watched as well to detect file replacement (rename, delete and create)
+         char *s = strrchr(mbpath, '/');
+         int dirWd;
+         if (s != NULL)
+         {
+            *s = 0;
+            dirWd = inotify_add_watch(s_inotifyFd, (s == mbpath) ? "/" : mbpath, DIR_WATCH_MASK);
+            *s = '/';
+         }
+         else
+         {
+            dirWd = inotify_add_watch(s_inotifyFd, ".", DIR_WATCH_MASK);
+         }
+
+         watch = new FileWatch();
+         watch->fileWd = fileWd;
+         watch->dirWd = dirWd;
+         watch->name = MemCopyStringA((s != NULL) ? s + 1 : mbpath);
+         watch->wakeup = wakeup;
+         watch->events = 0;
+         s_watches.add(watch);
+         nxlog_debug_tag(DEBUG_TAG, 6, _T("File watch for \"%s\" added (wd=%d, dir wd=%d)"), path, fileWd, dirWd);
+      }
+      else
+      {
+         nxlog_debug_tag(DEBUG_TAG, 4, _T("Cannot add file watch for \"%s\" (errno=%d), falling back to polling"), path, errno);
+      }
+   }
+   s_watchLock.unlock();
+
+   MemFree(mbpath);
+   return watch;
+}
+
+/**
+ * Stop watching file
+ */
+void RemoveFileWatch(FileWatch *watch)
+{
+   if (watch == NULL)
+      return;
+
+   s_watchLock.lock();
+   s_watches.remove(watch);
+   if ((s_inotifyFd != -1) && !IsWatchDescriptorUsed(watch->fileWd))
+      inotify_rm_watch(s_inotifyFd, watch->fileWd);
+   if ((s_inotifyFd != -1) && (watch->dirWd != -1) && !IsWatchDescriptorUsed(watch->dirWd))
+      inotify_rm_watch(s_inotifyFd, watch->dirWd);
+   s_watchLock.unlock();
+
+   MemFree(watch->name);
+   delete watch;
+}
+
+/**
+ * Get events accumulated since last call (combination of FILE_EVENT_xxx flags)
+ */
+UINT32 GetFileWatchEvents(FileWatch *watch)
+{
+   s_watchLock.lock();
+   UINT32 events = watch->events;
+   watch->events = 0;
+   s_watchLock.unlock();
+   return events;
+}
+
+#else /* HAVE_SYS_INOTIFY_H */
+
+/**
+ * Stop watcher thread (stub for platforms without inotify)
+ */
+void StopFileWatcher()
+{
+}
+
+/**
+ * Start watching given file (stub for platforms without inotify - always fall back to polling)
+ */
+FileWatch *AddFileWatch(const TCHAR *path, CONDITION wakeup)
+{
+   return NULL;
+}
+
+/**
+ * Stop watching file (stub for platforms without inotify)
+ */
+void RemoveFileWatch(FileWatch *watch)
+{
+}
+
+/**
+ * Get events accumulated since last call (stub for platforms without inotify)
+ */
+UINT32 GetFileWatchEvents(FileWatch *watch)
+{
+   return 0;
+}
+
+#endif /* HAVE_SYS_INOTIFY_H */
@@ -30,6 +30,69 @@
 
 #define DEBUG_TAG _T("logwatch")
 
+/**
+ * Aho-Corasick automaton node used by rule prefilter
+ */
+struct PrefilterNode
+{
+   int edgeCount;
+   int edgeAllocated;
+   TCHAR *edgeChars;
+   int *edgeTargets;
+   int fail;
+   int outputStart;
+   int outputCount;
+};
+
+/**
+ * Multi-pattern prefilter for log parser rules. Holds Aho-Corasick automaton built over
+ * required literals extracted from rule regexps and determines in single pass over the line
+ * which rules can possibly match it. Rules without extractable literal are always checked.
+ */
+class LIBNXLP_EXPORTABLE LogParserPrefilter
+{
+private:
+   int m_ruleCount;
+   int m_literalCount;
+   BYTE *m_alwaysCheck;
+   BYTE *m_candidates;
+   PrefilterNode *m_nodes;
+   int m_nodeCount;
+   int m_nodeAllocated;
+   int *m_outputs;
+
+   int addNode();
+   int findEdge(int node, TCHAR ch) const;
+   void addEdge(int node, TCHAR ch, int target);
+   void addLiteral(const TCHAR *literal, int rule, IntegerArray<int> **outputs);
+   void build(IntegerArray<int> **outputs);
+
+public:
+   LogParserPrefilter(ObjectArray<LogParserRule> *rules);
+   ~LogParserPrefilter();
+
+   void scan(const TCHAR *line);
+   bool isCandidate(int rule) const { return m_candidates[rule] != 0; }
+   int getLiteralCount() const { return m_literalCount; }
+};
+
+TCHAR LIBNXLP_EXPORTABLE *ExtractRequiredLiteral(const TCHAR *regexp, bool ignoreCase);
+
+char LIBNXLP_EXPORTABLE *FindSequence(char *start, int length, const char *sequence, int seqLength);
+
+/**
+ * File change events reported by file watcher
+ */
+#define FILE_EVENT_MODIFIED   0x0001
+#define FILE_EVENT_REPLACED   0x0002
+
+struct FileWatch;
+
+FileWatch *AddFileWatch(const TCHAR *path, CONDITION wakeup);
+void RemoveFileWatch(FileWatch *watch);
+UINT32 GetFileWatchEvents(FileWatch *watch);
+void StopFileWatcher();
+
 #ifdef _WIN32
 
 THREAD_RESULT THREAD_CALL ParserThreadEventLog(void *);
@@ -70,6 +70,8 @@ void LIBNXLP_EXPORTABLE CleanupLogParserLibrary()
    {
       CleanupEventLogParsers();
    }
+#else
+   StopFileWatcher();
 #endif
 }
 
@@ -116,6 +116,7 @@ struct LogParser_XmlParserState
 LogParser::LogParser()
 {
    m_rules = new ObjectArray<LogParserRule>(16, 16, Ownership::True);
+   m_prefilter = NULL;
 	m_cb = NULL;
 	m_userArg = NULL;
 	m_name = NULL;
@@ -127,6 +128,7 @@ LogParser::LogParser()
 	m_eventResolver = NULL;
 	m_thread = INVALID_THREAD_HANDLE;
    m_stopCondition = ConditionCreate(true);
+   m_fileChangeCondition = ConditionCreate(false);
 	m_recordsProcessed = 0;
 	m_recordsMatched = 0;
 	m_processAllRules = false;
@@ -150,6 +152,7 @@ LogParser::LogParser(const LogParser *src)
    m_rules = new ObjectArray<LogParserRule>(count, 16, Ownership::True);
 	for(int i = 0; i < count; i++)
 		m_rules->add(new LogParserRule(src->m_rules->get(i), this));
+   m_prefilter = NULL;
 
 	m_macros.addAll(&src->m_macros);
 	m_contexts.addAll(&src->m_contexts);
@@ -177,6 +180,7 @@ LogParser::LogParser(const LogParser *src)
 	m_eventResolver = src->m_eventResolver;
 	m_thread = INVALID_THREAD_HANDLE;
    m_stopCondition = ConditionCreate(true);
+   m_fileChangeCondition = ConditionCreate(false);
    m_recordsProcessed = 0;
 	m_recordsMatched = 0;
 	m_processAllRules = src->m_processAllRules;
@@ -197,12 +201,14 @@ LogParser::LogParser(const LogParser *src)
 LogParser::~LogParser()
 {
    delete m_rules;
+   delete m_prefilter;
 	MemFree(m_name);
 	MemFree(m_fileName);
 #ifdef _WIN32
    MemFree(m_marker);
 #endif
    ConditionDestroy(m_stopCondition);
+   ConditionDestroy(m_fileChangeCondition);
 }
 
 /**
@@ -228,6 +234,10 @@ bool LogParser::addRule(LogParserRule *rule)
 	if (valid)
 	{
 	   m_rules->add(rule);
+
+	   // Prefilter will be rebuilt on next match
+	   delete m_prefilter;
+	   m_prefilter = NULL;
 	}
 	else
 	{
@@ -283,6 +293,16 @@ bool LogParser::matchLogRecord(bool hasAttributes, const TCHAR *source, UINT32 e
 		trace(5, _T("Match line: \"%s\""), line);
 
 	m_recordsProcessed++;
+
+	// Find rules which required literals are present in the line, so that
+	// full regexp match will be attempted only for those rules
+	if (m_prefilter == NULL)
+	{
+	   m_prefilter = new LogParserPrefilter(m_rules);
+	   trace(4, _T("Rule prefilter created (%d rules, %d literals)"), m_rules->size(), m_prefilter->getLiteralCount());
+	}
+	m_prefilter->scan(line);
+
 	int i;
 	for(i = 0; i < m_rules->size(); i++)
 	{
@@ -290,9 +310,8 @@ bool LogParser::matchLogRecord(bool hasAttributes, const TCHAR *source, UINT32 e
 		trace(6, _T("checking rule %d \"%s\""), i + 1, rule->getDescription());
 		if ((state = checkContext(rule)) != NULL)
 		{
-			bool ruleMatched = hasAttributes ?
-			   rule->matchEx(source, eventId, level, line, variables, recordId, objectId, timestamp, m_cb, m_userArg) :
-				rule->match(line, objectId, m_cb, m_userArg);
+			bool ruleMatched = rule->matchInternal(hasAttributes, source, eventId, level, line, variables, recordId,
+			         objectId, timestamp, m_cb, m_userArg, m_prefilter->isCandidate(i));
 			if (ruleMatched)
 			{
 				trace(5, _T("rule %d \"%s\" matched"), i + 1, rule->getDescription());
@@ -988,6 +1007,7 @@ bool LogParser::isExclusionPeriod()
 void LogParser::stop()
 {
    ConditionSet(m_stopCondition);
+   ConditionSet(m_fileChangeCondition);  // wake up parser waiting for file change notification
    ThreadJoin(m_thread);
    m_thread = INVALID_THREAD_HANDLE;
 }
@@ -0,0 +1,465 @@
+/*
+** NetXMS - Network Management System
+** Log Parsing Library
+** Copyright (C) 2003-2020 Raden Solutions
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: prefilter.cpp
+**
+**/
+
+#include "libnxlp.h"
+
+/**
+ * Minimal length of literal to be used for prefiltering
+ */
+#define MIN_LITERAL_LENGTH    2
+
+/**
+ * Fold character for case insensitive comparison. Only ASCII characters are folded, so
+ * literals for case insensitive rules are limited to ASCII. In UTF mode PCRE also treats
+ * KELVIN SIGN and LATIN SMALL LETTER LONG S as case variants of ASCII k and s.
+ */
+static inline TCHAR FoldChar(TCHAR ch)
+{
+   if ((ch >= _T('A')) && (ch <= _T('Z')))
+      return ch + (_T('a') - _T('A'));
+#ifdef UNICODE
+   if (ch == 0x212A)
+      return _T('k');
+   if (ch == 0x017F)
+      return _T('s');
+#endif
+   return ch;
+}
+
+/**
+ * Check if given character is ASCII letter or digit
+ */
+static inline bool IsAsciiAlnum(TCHAR ch)
+{
+   return ((ch >= _T('a')) && (ch <= _T('z'))) || ((ch >= _T('A')) && (ch <= _T('Z'))) || ((ch >= _T('0')) && (ch <= _T('9')));
+}
+
+/**
+ * Finish current literal run and remember it if it is longest one
+ */
+static void EndLiteralRun(StringBuffer *current, StringBuffer *best)
+{
+   if (current->length() > best->length())
+   {
+      best->clear();
+      best->append(current->getBuffer(), current->length());
+   }
+   current->clear();
+}
+
+/**
+ * Skip character class starting at given position. Returns pointer to closing bracket or NULL if class is not terminated.
+ */
+static const TCHAR *SkipCharacterClass(const TCHAR *p)
+{
+   p++;  // skip [
+   if (*p == _T('^'))
+      p++;
+   if (*p == _T(']'))
+      p++;  // ] as first character is literal
+   for(; *p != 0; p++)
+   {
+      if (*p == _T('\\'))
+      {
+         p++;
+         if (*p == 0)
+            return NULL;
+      }
+      else if ((*p == _T('[')) && (*(p + 1) == _T(':')))
+      {
+         // POSIX class like [:alpha:]
+         const TCHAR *e = _tcsstr(p + 2, _T(":]"));
+         if (e == NULL)
+            return NULL;
+         p = e + 1;
+      }
+      else if (*p == _T(']'))
+      {
+         return p;
+      }
+   }
+   return NULL;
+}
+
+/**
+ * Parse quantifier in form {n}, {n,} or {n,m}. Returns pointer to closing brace or NULL if
+ * text at given position is not a quantifier (in which case PCRE treats { as literal).
+ */
+static const TCHAR *ParseQuantifier(const TCHAR *p, int *minCount)
+{
+   p++;  // skip {
+   if ((*p < _T('0')) || (*p > _T('9')))
+      return NULL;
+   int n = 0;
+   while((*p >= _T('0')) && (*p <= _T('9')))
+   {
+      n = n * 10 + (*p - _T('0'));
+      p++;
+   }
+   if (*p == _T(','))
+   {
+      p++;
+      while((*p >= _T('0')) && (*p <= _T('9')))
+         p++;
+   }
+   if (*p != _T('}'))
+      return NULL;
+   *minCount = n;
+   return p;
+}
+
+/**
+ * Extract literal which must be present in any string matched by given regular expression.
+ * Only top level of the expression is analyzed and longest run of literal characters is
+ * selected. Returns NULL if no suitable literal found or expression uses constructs which
+ * cannot be analyzed reliably (top level alternation, inline options, quoting).
+ * Returned literal is case folded and should be freed by caller.
+ */
+TCHAR LIBNXLP_EXPORTABLE *ExtractRequiredLiteral(const TCHAR *regexp, bool ignoreCase)
+{
+   if (regexp == NULL)
+      return NULL;
+
+   StringBuffer best, current;
+   int depth = 0;
+   for(const TCHAR *p = regexp; *p != 0; p++)
+   {
+      TCHAR ch = *p;
+
+      if (ch == _T('('))
+      {
+         // Only plain groups, non-capturing groups and lookahead assertions are analyzed - inline
+         // options (like (?i) or (?x)), comments and other extensions may change meaning of the rest of expression
+         if ((*(p + 1) == _T('?')) && (*(p + 2) != _T(':')) && (*(p + 2) != _T('=')) && (*(p + 2) != _T('!')))
+            return NULL;
+         if (depth == 0)
+            EndLiteralRun(&current, &best);
+         depth++;
+         continue;
+      }
+
+      if (ch == _T(')'))
+      {
+         if (depth == 0)
+            return NULL;   // unbalanced
+         depth--;
+         continue;
+      }
+
+      if (ch == _T('['))
+      {
+         p = SkipCharacterClass(p);
+         if (p == NULL)
+            return NULL;
+         if (depth == 0)
+            EndLiteralRun(&current, &best);
+         continue;
+      }
+
+      if (ch == _T('\\'))
+      {
+         TCHAR next = *(p + 1);
+         if (next == 0)
+            return NULL;
+         // Quoting, back references and escapes with arguments (character codes, properties) are not analyzed
+         if (_tcschr(_T("QEcgkNopPx0123456789"), next) != NULL)
+            return NULL;
+         p++;
+         if (depth > 0)
+            continue;
+         if (IsAsciiAlnum(next))
+         {
+            // Character type, assertion or special character
+            EndLiteralRun(&current, &best);
+            continue;
+         }
+         ch = next;  // escaped metacharacter
+      }
+      else if (depth > 0)
+      {
+         continue;   // group content (including alternation inside group) does not contribute to top level literals
+      }
+      else if (ch == _T('|'))
+      {
+         return NULL;   // top level alternation - no single required literal
+      }
+      else if ((ch == _T('.')) || (ch == _T('^')) || (ch == _T('$')))
+      {
+         EndLiteralRun(&current, &best);
+         continue;
+      }
+      else if ((ch == _T('*')) || (ch == _T('?')))
+      {
+         // Previous character is optional
+         if (!current.isEmpty())
+            current.shrink(1);
+         EndLiteralRun(&current, &best);
+         continue;
+      }
+      else if (ch == _T('+'))
+      {
+         // Previous character is required but may repeat
+         EndLiteralRun(&current, &best);
+         continue;
+      }
+      else if (ch == _T('{'))
+      {
+         int minCount;
+         const TCHAR *e = ParseQuantifier(p, &minCount);
+         if (e != NULL)
+         {
+            if ((minCount == 0) && !current.isEmpty())
+               current.shrink(1);
+            EndLiteralRun(&current, &best);
+            p = e;
+            continue;
+         }
+      }
+
+      // Literal character
+      if (ignoreCase && (static_cast<UINT32>(ch) >= 128))
+      {
+         EndLiteralRun(&current, &best);
+         continue;
+      }
+      current.append(FoldChar(ch));
+   }
+   if (depth != 0)
+      return NULL;
+   EndLiteralRun(&current, &best);
+
+   return (best.length() >= MIN_LITERAL_LENGTH) ? MemCopyString(best.getBuffer()) : NULL;
+}
+
+/**
+ * Build prefilter for given rule set
+ */
+LogParserPrefilter::LogParserPrefilter(ObjectArray<LogParserRule> *rules)
+{
+   m_ruleCount = rules->size();
+   m_literalCount = 0;
+   m_alwaysCheck = MemAllocArray<BYTE>(std::max(m_ruleCount, 1));
+   m_candidates = MemAllocArray<BYTE>(std::max(m_ruleCount, 1));
+   m_nodes = NULL;
+   m_nodeCount = 0;
+   m_nodeAllocated = 0;
+   m_outputs = NULL;
+
+   IntegerArray<int> **outputs = MemAllocArray<IntegerArray<int>*>(64);
+   int outputsAllocated = 64;
+
+   addNode();  // root
+   for(int i = 0; i < m_ruleCount; i++)
+   {
+      LogParserRule *rule = rules->get(i);
+      TCHAR *literal = ExtractRequiredLiteral(rule->getRegexpSource(), rule->isIgnoreCase());
+      if (literal == NULL)
+      {
+         m_alwaysCheck[i] = 1;
+         continue;
+      }
+
+      int needed = m_nodeCount + static_cast<int>(_tcslen(literal)) + 1;
+      if (needed > outputsAllocated)
+      {
+         int oldSize = outputsAllocated;
+         outputsAllocated = std::max(needed, outputsAllocated * 2);
+         outputs = MemReallocArray(outputs, outputsAllocated);
+         memset(&outputs[oldSize], 0, sizeof(IntegerArray<int>*) * (outputsAllocated - oldSize));
+      }
+      addLiteral(literal, i, outputs);
+      m_literalCount++;
+      MemFree(literal);
+   }
+   build(outputs);
+
+   for(int i = 0; i < m_nodeCount; i++)
+      delete outputs[i];
+   MemFree(outputs);
+}
+
+/**
+ * Destructor
+ */
+LogParserPrefilter::~LogParserPrefilter()
+{
+   for(int i = 0; i < m_nodeCount; i++)
+   {
+      MemFree(m_nodes[i].edgeChars);
+      MemFree(m_nodes[i].edgeTargets);
+   }
+   MemFree(m_nodes);
+   MemFree(m_outputs);
+   MemFree(m_alwaysCheck);
+   MemFree(m_candidates);
+}
+
+/**
+ * Add new node to automaton. Returns index of new node.
+ */
+int LogParserPrefilter::addNode()
+{
+   if (m_nodeCount == m_nodeAllocated)
+   {
+      m_nodeAllocated += 64;
+      m_nodes = MemReallocArray(m_nodes, m_nodeAllocated);
+   }
+   PrefilterNode *n = &m_nodes[m_nodeCount];
+   memset(n, 0, sizeof(PrefilterNode));
+   return m_nodeCount++;
+}
+
+/**
+ * Find transition from given node by given character. Returns -1 if there are no such transition.
+ */
+int LogParserPrefilter::findEdge(int node, TCHAR ch) const
+{
+   const PrefilterNode *n = &m_nodes[node];
+   for(int i = 0; i < n->edgeCount; i++)
+      if (n->edgeChars[i] == ch)
+         return n->edgeTargets[i];
+   return -1;
+}
+
+/**
+ * Add transition
+ */
+void LogParserPrefilter::addEdge(int node, TCHAR ch, int target)
+{
+   PrefilterNode *n = &m_nodes[node];
+   if (n->edgeCount == n->edgeAllocated)
+   {
+      n->edgeAllocated += 4;
+      n->edgeChars = MemReallocArray(n->edgeChars, n->edgeAllocated);
+      n->edgeTargets = MemReallocArray(n->edgeTargets, n->edgeAllocated);
+   }
+   n->edgeChars[n->edgeCount] = ch;
+   n->edgeTargets[n->edgeCount] = target;
+   n->edgeCount++;
+}
+
+/**
+ * Add literal to trie
+ */
+void LogParserPrefilter::addLiteral(const TCHAR *literal, int rule, IntegerArray<int> **outputs)
+{
+   int node = 0;
+   for(const TCHAR *p = literal; *p != 0; p++)
+   {
+      int next = findEdge(node, *p);
+      if (next == -1)
+      {
+         next = addNode();
+         addEdge(node, *p, next);
+      }
+      node = next;
+   }
+   if (outputs[node] == NULL)
+      outputs[node] = new IntegerArray<int>(4, 4);
+   outputs[node]->add(rule);
+}
+
+/**
+ * Calculate failure links (breadth first, so failure target is always processed before node itself)
+ * and merge outputs of failure targets into node outputs.
+ */
+void LogParserPrefilter::build(IntegerArray<int> **outputs)
+{
+   int *queue = MemAllocArray<int>(m_nodeCount);
+   int head = 0, tail = 0;
+
+   PrefilterNode *root = &m_nodes[0];
+   for(int i = 0; i < root->edgeCount; i++)
+   {
+      m_nodes[root->edgeTargets[i]].fail = 0;
+      queue[tail++] = root->edgeTargets[i];
+   }
+
+   while(head < tail)
+   {
+      int node = queue[head++];
+      int fail = m_nodes[node].fail;
+      if (outputs[fail] != NULL)
+      {
+         if (outputs[node] == NULL)
+            outputs[node] = new IntegerArray<int>(4, 4);
+         for(int i = 0; i < outputs[fail]->size(); i++)
+            outputs[node]->add(outputs[fail]->get(i));
+      }
+
+      for(int i = 0; i < m_nodes[node].edgeCount; i++)
+      {
+         TCHAR ch = m_nodes[node].edgeChars[i];
+         int child = m_nodes[node].edgeTargets[i];
+         int f = fail;
+         int target;
+         while(((target = findEdge(f, ch)) == -1) && (f != 0))
+            f = m_nodes[f].fail;
+         m_nodes[child].fail = (target != -1) ? target : 0;
+         queue[tail++] = child;
+      }
+   }
+   MemFree(queue);
+
+   // Flatten outputs
+   int total = 0;
+   for(int i = 0; i < m_nodeCount; i++)
+      if (outputs[i] != NULL)
+         total += outputs[i]->size();
+   m_outputs = MemAllocArray<int>(std::max(total, 1));
+   int pos = 0;
+   for(int i = 0; i < m_nodeCount; i++)
+   {
+      m_nodes[i].outputStart = pos;
+      if (outputs[i] != NULL)
+      {
+         for(int j = 0; j < outputs[i]->size(); j++)
+            m_outputs[pos++] = outputs[i]->get(j);
+      }
+      m_nodes[i].outputCount = pos - m_nodes[i].outputStart;
+   }
+}
+
+/**
+ * Scan line and mark rules which should be checked with full regexp
+ */
+void LogParserPrefilter::scan(const TCHAR *line)
+{
+   memcpy(m_candidates, m_alwaysCheck, m_ruleCount);
+   if (m_literalCount == 0)
+      return;
+
+   int state = 0;
+   for(const TCHAR *p = line; *p != 0; p++)
+   {
+      TCHAR ch = FoldChar(*p);
+      int next;
+      while(((next = findEdge(state, ch)) == -1) && (state != 0))
+         state = m_nodes[state].fail;
+      state = (next != -1) ? next : 0;
+
+      const PrefilterNode *n = &m_nodes[state];
+      for(int i = 0; i < n->outputCount; i++)
+         m_candidates[m_outputs[n->outputStart + i]] = 1;
+   }
+}
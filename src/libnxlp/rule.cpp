@@ -63,14 +63,7 @@ LogParserRule::LogParserRule(LogParser *parser, const TCHAR *name, const TCHAR *
 	m_agentActionArgs = new StringList();
    m_objectCounters = new HashMap<UINT32, ObjectRuleStats>(Ownership::True);
 
-   const char *eptr;
-   int eoffset;
-   m_preg = _pcre_compile_t(reinterpret_cast<const PCRE_TCHAR*>(m_regexp), 
-         m_ignoreCase ? PCRE_COMMON_FLAGS | PCRE_CASELESS : PCRE_COMMON_FLAGS, &eptr, &eoffset, NULL);
-   if (m_preg == NULL)
-   {
-      nxlog_debug_tag(DEBUG_TAG, 3, _T("Regexp \"%s\" compilation error: %hs at offset %d"), m_regexp, eptr, eoffset);
-   }
+   compileRegexp();
 }
 
 /**
@@ -114,6 +107,17 @@ LogParserRule::LogParserRule(LogParserRule *src, LogParser *parser)
    m_objectCounters = new HashMap<UINT32, ObjectRuleStats>(Ownership::True);
    restoreCounters(src);
 
+   compileRegexp();
+}
+
+/**
+ * Compile regular expression. Compiled expression is also studied (with JIT compilation
+ * if supported by PCRE library) because it is matched against every processed record.
+ */
+void LogParserRule::compileRegexp()
+{
+   m_pextra = NULL;
+
    const char *eptr;
    int eoffset;
    m_preg = _pcre_compile_t(reinterpret_cast<const PCRE_TCHAR*>(m_regexp),
@@ -121,6 +125,13 @@ LogParserRule::LogParserRule(LogParserRule *src, LogParser *parser)
    if (m_preg == NULL)
    {
       nxlog_debug_tag(DEBUG_TAG, 3, _T("Regexp \"%s\" compilation error: %hs at offset %d"), m_regexp, eptr, eoffset);
+      return;
+   }
+
+   m_pextra = _pcre_study_t(m_preg, PCRE_COMMON_STUDY_FLAGS, &eptr);
+   if ((m_pextra == NULL) && (eptr != NULL))
+   {
+      nxlog_debug_tag(DEBUG_TAG, 5, _T("Regexp \"%s\" study error: %hs"), m_regexp, eptr);
    }
 }
 
@@ -130,6 +141,8 @@ LogParserRule::LogParserRule(LogParserRule *src, LogParser *parser)
 LogParserRule::~LogParserRule()
 {
    MemFree(m_name);
+   if (m_pextra != NULL)
+      _pcre_free_study_t(m_pextra);
 	if (m_preg != NULL)
 		_pcre_free_t(m_preg);
 	MemFree(m_pmatch);
@@ -150,7 +163,8 @@ LogParserRule::~LogParserRule()
  * Match line
  */
 bool LogParserRule::matchInternal(bool extMode, const TCHAR *source, UINT32 eventId, UINT32 level, const TCHAR *line,
-         StringList *variables, UINT64 recordId, UINT32 objectId, time_t timestamp, LogParserCallback cb, void *context)
+         StringList *variables, UINT64 recordId, UINT32 objectId, time_t timestamp, LogParserCallback cb, void *context,
+         bool literalFound)
 {
    incCheckCount(objectId);
    if (extMode)
@@ -184,10 +198,14 @@ bool LogParserRule::matchInternal(bool extMode, const TCHAR *source, UINT32 even
 		return false;
 	}
 
+   // Regexp cannot match if required literal was not found in line by prefilter
+   if (!literalFound)
+      m_parser->trace(6, _T("  required literal not found"));
+
 	if (m_isInverted)
 	{
 		m_parser->trace(6, _T("  negated matching against regexp %s"), m_regexp);
-		if ((_pcre_exec_t(m_preg, NULL, reinterpret_cast<const PCRE_TCHAR*>(line), static_cast<int>(_tcslen(line)), 0, 0, m_pmatch, MAX_PARAM_COUNT * 3) < 0) && matchRepeatCount())
+		if ((!literalFound || _pcre_exec_t(m_preg, m_pextra, reinterpret_cast<const PCRE_TCHAR*>(line), static_cast<int>(_tcslen(line)), 0, 0, m_pmatch, MAX_PARAM_COUNT * 3) < 0) && matchRepeatCount())
 		{
 			m_parser->trace(6, _T("  matched"));
 			if ((cb != NULL) && ((m_eventCode != 0) || (m_eventName != NULL)))
@@ -200,7 +218,9 @@ bool LogParserRule::matchInternal(bool extMode, const TCHAR *source, UINT32 even
 	else
 	{
 		m_parser->trace(6, _T("  matching against regexp %s"), m_regexp);
-		int cgcount = _pcre_exec_t(m_preg, NULL, reinterpret_cast<const PCRE_TCHAR*>(line), static_cast<int>(_tcslen(line)), 0, 0, m_pmatch, MAX_PARAM_COUNT * 3);
+		int cgcount = literalFound ?
+		         _pcre_exec_t(m_preg, m_pextra, reinterpret_cast<const PCRE_TCHAR*>(line), static_cast<int>(_tcslen(line)), 0, 0, m_pmatch, MAX_PARAM_COUNT * 3) :
+		         PCRE_ERROR_NOMATCH;
       m_parser->trace(7, _T("  pcre_exec returns %d"), cgcount);
 		if ((cgcount >= 0) && matchRepeatCount())
 		{
@@ -240,7 +260,7 @@ bool LogParserRule::matchInternal(bool extMode, const TCHAR *source, UINT32 even
  */
 bool LogParserRule::match(const TCHAR *line, UINT32 objectId, LogParserCallback cb, void *context)
 {
-   return matchInternal(false, NULL, 0, 0, line, NULL, 0, objectId, 0, cb, context);
+   return matchInternal(false, NULL, 0, 0, line, NULL, 0, objectId, 0, cb, context, true);
 }
 
 /**
@@ -249,7 +269,7 @@ bool LogParserRule::match(const TCHAR *line, UINT32 objectId, LogParserCallback
 bool LogParserRule::matchEx(const TCHAR *source, UINT32 eventId, UINT32 level, const TCHAR *line, StringList *variables,
                             UINT64 recordId, UINT32 objectId, time_t timestamp, LogParserCallback cb, void *context)
 {
-   return matchInternal(true, source, eventId, level, line, variables, recordId, objectId, timestamp, cb, context);
+   return matchInternal(true, source, eventId, level, line, variables, recordId, objectId, timestamp, cb, context, true);
 }
 
 /**
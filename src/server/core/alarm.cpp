@@ -142,6 +142,7 @@ struct CLIENT_NOTIFICATION_DATA
 {
    UINT32 code;
    const Alarm *alarm;
+   ClientBroadcastMessage *msg;
 };
 
 /**
@@ -150,7 +151,8 @@ struct CLIENT_NOTIFICATION_DATA
 static void SendAlarmNotification(ClientSession *session, void *arg)
 {
    session->onAlarmUpdate(((CLIENT_NOTIFICATION_DATA *)arg)->code,
-                          ((CLIENT_NOTIFICATION_DATA *)arg)->alarm);
+                          ((CLIENT_NOTIFICATION_DATA *)arg)->alarm,
+                          ((CLIENT_NOTIFICATION_DATA *)arg)->msg);
 }
 
 /**
@@ -158,7 +160,7 @@ static void SendAlarmNotification(ClientSession *session, void *arg)
  */
 static void SendBulkAlarmTerminateNotification(ClientSession *session, void *arg)
 {
-   session->sendMessage((NXCPMessage *)arg);
+   session->postMessage((NXCPMessage *)arg);
 }
 
 /**
@@ -167,11 +169,20 @@ static void SendBulkAlarmTerminateNotification(ClientSession *session, void *arg
 static void NotifyClients(UINT32 code, const Alarm *alarm)
 {
    CALL_ALL_MODULES(pfAlarmChangeHook, (code, alarm));
+   if (!IsClientChannelSubscribed(NXC_CHANNEL_ALARMS))
+      return;
+
+   // Message is prepared once and shared between all sessions
+   ClientBroadcastMessage *msg = new ClientBroadcastMessage(CMD_ALARM_UPDATE);
+   Alarm tmp(alarm, false, code);
+   tmp.fillMessage(msg->getMessage());
 
    CLIENT_NOTIFICATION_DATA data;
    data.code = code;
    data.alarm = alarm;
+   data.msg = msg;
    EnumerateClientSessions(SendAlarmNotification, &data);
+   msg->decRefCount();
 }
 
 /**
@@ -1590,7 +1601,7 @@ void SendAlarmsToClient(UINT32 dwRqId, ClientSession *pSession)
           alarm->checkCategoryAccess(pSession))
       {
          alarm->fillMessage(&msg);
-         pSession->sendMessage(&msg);
+         pSession->postMessage(&msg);
          msg.deleteAllFields();
       }
    }
@@ -1598,7 +1609,7 @@ void SendAlarmsToClient(UINT32 dwRqId, ClientSession *pSession)
 
    // Send end-of-list indicator
    msg.setField(VID_ALARM_ID, (UINT32)0);
-   pSession->sendMessage(&msg);
+   pSession->postMessage(&msg);
 }
 
 /**
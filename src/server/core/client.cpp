@@ -30,12 +30,63 @@
  */
 NXCORE_EXPORTABLE_VAR(ThreadPool *g_clientThreadPool) = NULL;
 
+/**
+ * Size limit (in bytes) for client session outbound queue
+ */
+UINT64 g_clientOutboundQueueSize = 4194304;
+
+/**
+ * Maximum time (in seconds) message can wait in client session outbound queue before client is asked to re-synchronize objects
+ */
+UINT32 g_clientOutboundQueueMaxLag = 60;
+
 /**
  * Static data
  */
 static ClientSession *s_sessionList[MAX_CLIENT_SESSIONS];
 static RWLOCK s_sessionListLock;
 
+/**
+ * Create broadcast message with given code
+ */
+ClientBroadcastMessage::ClientBroadcastMessage(UINT16 code) : m_msg(code, 0)
+{
+   m_serialized[0] = NULL;
+   m_serialized[1] = NULL;
+}
+
+/**
+ * Create broadcast message as copy of existing message
+ */
+ClientBroadcastMessage::ClientBroadcastMessage(NXCPMessage *msg) : m_msg(msg)
+{
+   m_serialized[0] = NULL;
+   m_serialized[1] = NULL;
+}
+
+/**
+ * Broadcast message destructor
+ */
+ClientBroadcastMessage::~ClientBroadcastMessage()
+{
+   MemFree(m_serialized[0]);
+   MemFree(m_serialized[1]);
+}
+
+/**
+ * Get serialized message. Message is serialized on first call for each
+ * compression mode. Message content should not be changed after first call.
+ */
+const NXCP_MESSAGE *ClientBroadcastMessage::getSerializedMessage(bool compressed)
+{
+   int index = compressed ? 1 : 0;
+   m_mutex.lock();
+   if (m_serialized[index] == NULL)
+      m_serialized[index] = m_msg.serialize(compressed);
+   m_mutex.unlock();
+   return m_serialized[index];
+}
+
 /**
  * Register new session in list
  */
@@ -108,6 +159,8 @@ void InitClientListeners()
    g_clientThreadPool = ThreadPoolCreate(_T("CLIENT"),
             ConfigReadInt(_T("ThreadPool.Client.BaseSize"), 16),
             ConfigReadInt(_T("ThreadPool.Client.MaxSize"), MAX_CLIENT_SESSIONS * 8));
+   g_clientOutboundQueueSize = static_cast<UINT64>(ConfigReadULong(_T("Client.OutboundQueue.MaxSize"), 4096)) * 1024;
+   g_clientOutboundQueueMaxLag = ConfigReadULong(_T("Client.OutboundQueue.MaxLag"), 60);
 
    memset(s_sessionList, 0, sizeof(s_sessionList));
 
@@ -209,6 +262,29 @@ void DumpClientSessions(CONSOLE_CTX pCtx)
    ConsolePrintf(pCtx, _T("\n%d active session%s\n\n"), iCount, iCount == 1 ? _T("") : _T("s"));
 }
 
+/**
+ * Dump client session outbound queues to screen
+ */
+void DumpClientSessionQueues(CONSOLE_CTX pCtx)
+{
+   ConsolePrintf(pCtx, _T("ID  QUEUED  SIZE(KB) OBJUPD  LAG(ms)  MAXLAG(ms) SENT       SENT(KB)   COALESCED  DROPPED  RESYNC\n"));
+   RWLockReadLock(s_sessionListLock);
+   for(int i = 0; i < MAX_CLIENT_SESSIONS; i++)
+   {
+      if (s_sessionList[i] == NULL)
+         continue;
+
+      ClientOutboundQueueStats stats;
+      s_sessionList[i]->getOutboundQueueStats(&stats);
+      ConsolePrintf(pCtx, _T("%-3d %-7u %-8u %-7u %-8u %-10u %-10u %-10u %-10u %-8u %u\n"), i,
+               stats.queuedMessages, static_cast<UINT32>(stats.queuedBytes / 1024), stats.pendingObjectUpdates,
+               stats.currentLag, stats.maxLag, static_cast<UINT32>(stats.messagesSent), static_cast<UINT32>(stats.bytesSent / 1024),
+               static_cast<UINT32>(stats.coalescedUpdates), stats.droppedMessages, stats.resyncCount);
+   }
+   RWLockUnlock(s_sessionListLock);
+   ConsolePrintf(pCtx, _T("\n"));
+}
+
 /**
  * Kill client session
  */
@@ -245,23 +321,46 @@ void NXCORE_EXPORTABLE EnumerateClientSessions(void (*pHandler)(ClientSession *,
    RWLockUnlock(s_sessionListLock);
 }
 
+/**
+ * Check if any authenticated session is subscribed to given notification channel
+ * (used to avoid building broadcast messages nobody will receive)
+ */
+bool NXCORE_EXPORTABLE IsClientChannelSubscribed(const TCHAR *channel)
+{
+   bool subscribed = false;
+   RWLockReadLock(s_sessionListLock);
+   for(int i = 0; (i < MAX_CLIENT_SESSIONS) && !subscribed; i++)
+   {
+      ClientSession *session = s_sessionList[i];
+      if ((session != NULL) && session->isAuthenticated() && !session->isTerminated() && session->isSubscribedTo(channel))
+         subscribed = true;
+   }
+   RWLockUnlock(s_sessionListLock);
+   return subscribed;
+}
+
 /**
  * Send user database update notification to all clients
  */
 void SendUserDBUpdate(int code, UINT32 id, UserDatabaseObject *object)
 {
-   NXCPMessage msg;
-   msg.setCode(CMD_USER_DB_UPDATE);
-   msg.setId(0);
-   msg.setField(VID_UPDATE_TYPE, (WORD)code);
+   // Changes in user database may change set of objects visible to users
+   if (code != USER_DB_CREATE)
+      InvalidateObjectRevisions();
+
+   if (!IsClientChannelSubscribed(NXC_CHANNEL_USERDB))
+      return;
+
+   ClientBroadcastMessage *msg = new ClientBroadcastMessage(CMD_USER_DB_UPDATE);
+   msg->getMessage()->setField(VID_UPDATE_TYPE, (WORD)code);
    switch(code)
    {
       case USER_DB_CREATE:
       case USER_DB_MODIFY:
-         object->fillMessage(&msg);
+         object->fillMessage(msg->getMessage());
          break;
       default:
-         msg.setField(VID_USER_ID, id);
+         msg->getMessage()->setField(VID_USER_ID, id);
          break;
    }
 
@@ -271,8 +370,9 @@ void SendUserDBUpdate(int code, UINT32 id, UserDatabaseObject *object)
           s_sessionList[i]->isAuthenticated() &&
           !s_sessionList[i]->isTerminated() &&
           s_sessionList[i]->isSubscribedTo(NXC_CHANNEL_USERDB))
-         s_sessionList[i]->postMessage(&msg);
+         s_sessionList[i]->postBroadcastMessage(msg);
    RWLockUnlock(s_sessionListLock);
+   msg->decRefCount();
 }
 
 /**
@@ -280,29 +380,43 @@ void SendUserDBUpdate(int code, UINT32 id, UserDatabaseObject *object)
  */
 void NXCORE_EXPORTABLE NotifyClientsOnGraphUpdate(NXCPMessage *update, UINT32 graphId)
 {
+   ClientBroadcastMessage *msg = NULL;   // Created on first match
    RWLockReadLock(s_sessionListLock);
    for(int i = 0; i < MAX_CLIENT_SESSIONS; i++)
       if ((s_sessionList[i] != NULL) &&
           s_sessionList[i]->isAuthenticated() &&
           !s_sessionList[i]->isTerminated() &&
           (GetGraphAccessCheckResult(graphId, s_sessionList[i]->getUserId()) == RCC_SUCCESS))
-         s_sessionList[i]->postMessage(update);
+      {
+         if (msg == NULL)
+            msg = new ClientBroadcastMessage(update);
+         s_sessionList[i]->postBroadcastMessage(msg);
+      }
    RWLockUnlock(s_sessionListLock);
+   if (msg != NULL)
+      msg->decRefCount();
 }
 
 /**
  * Send policy update/create to all sessions
  */
-void NotifyClientsOnPolicyUpdate(NXCPMessage *msg, Template *object)
+void NotifyClientsOnPolicyUpdate(NXCPMessage *update, Template *object)
 {
+   ClientBroadcastMessage *msg = NULL;   // Created on first match
    RWLockReadLock(s_sessionListLock);
    for(int i = 0; i < MAX_CLIENT_SESSIONS; i++)
       if ((s_sessionList[i] != NULL) &&
           s_sessionList[i]->isAuthenticated() &&
           !s_sessionList[i]->isTerminated() &&
           object->checkAccessRights(s_sessionList[i]->getUserId(), OBJECT_ACCESS_MODIFY))
-         s_sessionList[i]->postMessage(msg);
+      {
+         if (msg == NULL)
+            msg = new ClientBroadcastMessage(update);
+         s_sessionList[i]->postBroadcastMessage(msg);
+      }
    RWLockUnlock(s_sessionListLock);
+   if (msg != NULL)
+      msg->decRefCount();
 }
 
 /**
@@ -360,6 +474,7 @@ void NotifyClientsOnDCIStatusChange(DataCollectionOwner *object, UINT32 dcoId, i
  */
 void NotifyClientsOnDCIUpdate(NXCPMessage *update, NetObj *object)
 {
+   ClientBroadcastMessage *msg = NULL;   // Created on first match
    RWLockReadLock(s_sessionListLock);
    for(int i = 0; i < MAX_CLIENT_SESSIONS; i++)
    {
@@ -367,13 +482,17 @@ void NotifyClientsOnDCIUpdate(NXCPMessage *update, NetObj *object)
       if ((session != NULL) &&
           session->isAuthenticated() &&
           !session->isTerminated() &&
-          object->checkAccessRights(session->getUserId(), OBJECT_ACCESS_MODIFY) &&
-          session->isDCOpened(object->getId()))
+          session->isDCOpened(object->getId()) &&
+          object->checkAccessRights(session->getUserId(), OBJECT_ACCESS_MODIFY))
       {
-         session->postMessage(update);
+         if (msg == NULL)
+            msg = new ClientBroadcastMessage(update);
+         session->postBroadcastMessage(msg);
       }
    }
    RWLockUnlock(s_sessionListLock);
+   if (msg != NULL)
+      msg->decRefCount();
 }
 
 /**
@@ -382,16 +501,16 @@ void NotifyClientsOnDCIUpdate(NXCPMessage *update, NetObj *object)
 void NotifyClientsOnThresholdChange(UINT32 objectId, UINT32 dciId, UINT32 thresholdId, const TCHAR *instance, ThresholdCheckResult change)
 {
    NetObj *object = FindObjectById(objectId);
-   if (object == NULL)
+   if ((object == NULL) || !IsClientChannelSubscribed(NXC_CHANNEL_DC_THRESHOLDS))
       return;
 
-   NXCPMessage msg(CMD_THRESHOLD_UPDATE, 0);
-   msg.setField(VID_OBJECT_ID, objectId);
-   msg.setField(VID_DCI_ID, dciId);
-   msg.setField(VID_THRESHOLD_ID, thresholdId);
+   ClientBroadcastMessage *msg = new ClientBroadcastMessage(CMD_THRESHOLD_UPDATE);
+   msg->getMessage()->setField(VID_OBJECT_ID, objectId);
+   msg->getMessage()->setField(VID_DCI_ID, dciId);
+   msg->getMessage()->setField(VID_THRESHOLD_ID, thresholdId);
    if (instance != NULL)
-      msg.setField(VID_INSTANCE, instance);
-   msg.setField(VID_STATE, change == ThresholdCheckResult::ACTIVATED);
+      msg->getMessage()->setField(VID_INSTANCE, instance);
+   msg->getMessage()->setField(VID_STATE, change == ThresholdCheckResult::ACTIVATED);
 
    RWLockReadLock(s_sessionListLock);
    for(int i = 0; i < MAX_CLIENT_SESSIONS; i++)
@@ -403,10 +522,11 @@ void NotifyClientsOnThresholdChange(UINT32 objectId, UINT32 dciId, UINT32 thresh
           session->isSubscribedTo(NXC_CHANNEL_DC_THRESHOLDS) &&
           object->checkAccessRights(session->getUserId(), OBJECT_ACCESS_READ))
       {
-         session->postMessage(&msg);
+         session->postBroadcastMessage(msg);
       }
    }
    RWLockUnlock(s_sessionListLock);
+   msg->decRefCount();
 }
 
 /**
@@ -91,6 +91,22 @@ ColumnFilter::~ColumnFilter()
 	}
 }
 
+/**
+ * Check if this filter is OR set of non-negated equality checks
+ */
+bool ColumnFilter::isEqualsSet()
+{
+	if ((m_type != FILTER_SET) || (m_value.set.operation != SET_OPERATION_OR) || (m_value.set.count < 2))
+		return false;
+	for(int i = 0; i < m_value.set.count; i++)
+	{
+		ColumnFilter *f = m_value.set.filters[i];
+		if ((f->m_type != FILTER_EQUALS) || f->m_negated || _tcscmp(f->m_column, m_column))
+			return false;
+	}
+	return true;
+}
+
 /**
  * Generate SQL for column filter
  */
@@ -101,24 +117,20 @@ StringBuffer ColumnFilter::generateSql()
 	switch(m_type)
 	{
 		case FILTER_EQUALS:
-			if (m_negated)
-				sql.append(_T("NOT "));
-			sql.appendFormattedString(_T("%s = ") INT64_FMT, m_column, m_value.numericValue);
+			sql.appendFormattedString(m_negated ? _T("%s <> ") INT64_FMT : _T("%s = ") INT64_FMT, m_column, m_value.numericValue);
 			break;
 		case FILTER_LESS:
-			if (m_negated)
-            sql.append(_T("NOT "));
-			sql.appendFormattedString(_T("%s < ") INT64_FMT, m_column, m_value.numericValue);
+			sql.appendFormattedString(m_negated ? _T("%s >= ") INT64_FMT : _T("%s < ") INT64_FMT, m_column, m_value.numericValue);
 			break;
 		case FILTER_GREATER:
-			if (m_negated)
-            sql.append(_T("NOT "));
-			sql.appendFormattedString(_T("%s > ") INT64_FMT, m_column, m_value.numericValue);
+			sql.appendFormattedString(m_negated ? _T("%s <= ") INT64_FMT : _T("%s > ") INT64_FMT, m_column, m_value.numericValue);
 			break;
 		case FILTER_RANGE:
+			// Negation is expanded into two comparisons so that database can use index on column
 			if (m_negated)
-            sql.append(_T("NOT "));
-			sql.appendFormattedString(_T("%s BETWEEN ") INT64_FMT _T(" AND ") INT64_FMT, m_column, m_value.range.start, m_value.range.end);
+				sql.appendFormattedString(_T("(%s < ") INT64_FMT _T(") OR (%s > ") INT64_FMT _T(")"), m_column, m_value.range.start, m_column, m_value.range.end);
+			else
+				sql.appendFormattedString(_T("%s BETWEEN ") INT64_FMT _T(" AND ") INT64_FMT, m_column, m_value.range.start, m_value.range.end);
 			break;
 		case FILTER_LIKE:
 			if (m_value.like[0] == 0)
@@ -136,7 +148,20 @@ StringBuffer ColumnFilter::generateSql()
 			}
 			break;
 		case FILTER_SET:
-			if (m_value.set.count > 0)
+			if (isEqualsSet())
+			{
+				// OR of simple equality checks is converted into single IN predicate
+				sql.append(m_column);
+				sql.append(_T(" IN ("));
+				for(int i = 0; i < m_value.set.count; i++)
+				{
+					if (i > 0)
+						sql.append(_T(","));
+					sql.append(m_value.set.filters[i]->m_value.numericValue);
+				}
+				sql.append(_T(")"));
+			}
+			else if (m_value.set.count > 0)
 			{
 				bool first = true;
 				for(int i = 0; i < m_value.set.count; i++)
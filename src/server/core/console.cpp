@@ -1176,6 +1176,8 @@ int ProcessConsoleCommand(const TCHAR *pszCmdLine, CONSOLE_CTX pCtx)
       {
          ConsoleWrite(pCtx, _T("\x1b[1mCLIENT SESSIONS\x1b[0m\n============================================================\n"));
          DumpClientSessions(pCtx);
+         ConsoleWrite(pCtx, _T("\x1b[1mCLIENT SESSION OUTBOUND QUEUES\x1b[0m\n============================================================\n"));
+         DumpClientSessionQueues(pCtx);
          ConsoleWrite(pCtx, _T("\n\x1b[1mMOBILE DEVICE SESSIONS\x1b[0m\n============================================================\n"));
          DumpMobileDeviceSessions(pCtx);
       }
@@ -44,6 +44,7 @@ struct DELAYED_IDATA_INSERT
    time_t timestamp;
    UINT32 nodeId;
    UINT32 dciId;
+   DCObjectStorageClass storageClass;
    TCHAR rawValue[MAX_RESULT_LENGTH];
    TCHAR transformedValue[MAX_RESULT_LENGTH];
 };
@@ -183,8 +184,10 @@ void QueueIDataInsert(time_t timestamp, UINT32 nodeId, UINT32 dciId, const TCHAR
 	rq->timestamp = timestamp;
 	rq->nodeId = nodeId;
 	rq->dciId = dciId;
+	rq->storageClass = storageClass;
    _tcslcpy(rq->rawValue, rawValue, MAX_RESULT_LENGTH);
    _tcslcpy(rq->transformedValue, transformedValue, MAX_RESULT_LENGTH);
+   RegisterPendingDataRollupValue(timestamp);
    if ((g_flags & AF_SINGLE_TABLE_PERF_DATA) && (g_dbSyntax == DB_SYNTAX_TSDB))
    {
       s_idataWriters[static_cast<int>(storageClass)].queue->put(rq);
@@ -281,6 +284,35 @@ static THREAD_RESULT THREAD_CALL DBWriteThread(void *arg)
    return THREAD_OK;
 }
 
+/**
+ * Discard request which was not written to database
+ */
+static inline void DiscardIDataRequest(DELAYED_IDATA_INSERT *rq)
+{
+   ReleasePendingDataRollupValue(rq->timestamp);
+   MemFree(rq);
+}
+
+/**
+ * Update data rollups with values from written batch (only if batch was committed) and release requests.
+ * Rollups are updated after commit so that they never include values not yet visible in raw data.
+ */
+static void CompleteIDataBatch(DELAYED_IDATA_INSERT **batch, int count, bool committed)
+{
+   for(int i = 0; i < count; i++)
+   {
+      if (committed)
+      {
+         UpdateDataRollups(batch[i]->nodeId, batch[i]->dciId, batch[i]->storageClass, batch[i]->timestamp, batch[i]->transformedValue);
+         MemFree(batch[i]);
+      }
+      else
+      {
+         DiscardIDataRequest(batch[i]);
+      }
+   }
+}
+
 /**
  * Database "lazy" write thread for idata_xxx INSERTs
  */
@@ -289,6 +321,8 @@ static THREAD_RESULT THREAD_CALL IDataWriteThread(void *arg)
    ThreadSetName("DBWriter/IData");
    IDataWriter *writer = static_cast<IDataWriter*>(arg);
    int maxRecords = ConfigReadInt(_T("DBWriter.MaxRecordsPerTransaction"), 1000);
+   DELAYED_IDATA_INSERT **batch = MemAllocArrayNoInit<DELAYED_IDATA_INSERT*>(std::max(maxRecords, 0) + 1);
+   StructArray<NewDataPartition> newPartitions(0, 16);
    while(true)
    {
 		DELAYED_IDATA_INSERT *rq = writer->queue->getOrBlock();
@@ -305,10 +339,15 @@ static THREAD_RESULT THREAD_CALL IDataWriteThread(void *arg)
 
 				// For Oracle preparing statement even for one time execution is preferred
 				// For other databases it will actually slow down inserts
-				if (g_dbSyntax == DB_SYNTAX_ORACLE)
+				TCHAR table[64];
+				if (!GetDataInsertTable(hdb, DCO_TYPE_ITEM, rq->nodeId, rq->timestamp, table, 64, &newPartitions))
+				{
+				   success = false;
+				}
+				else if (g_dbSyntax == DB_SYNTAX_ORACLE)
 				{
 	            TCHAR query[256];
-               _sntprintf(query, 256, _T("INSERT INTO idata_%d (item_id,idata_timestamp,idata_value,raw_value) VALUES (?,?,?,?)"), (int)rq->nodeId);
+               _sntprintf(query, 256, _T("INSERT INTO %s (item_id,idata_timestamp,idata_value,raw_value) VALUES (?,?,?,?)"), table);
                DB_STATEMENT hStmt = DBPrepare(hdb, query);
                if (hStmt != NULL)
                {
@@ -327,34 +366,43 @@ static THREAD_RESULT THREAD_CALL IDataWriteThread(void *arg)
 				else
 				{
                TCHAR query[1024];
-               _sntprintf(query, 1024, _T("INSERT INTO idata_%d (item_id,idata_timestamp,idata_value,raw_value) VALUES (%d,%d,%s,%s)"),
-                          (int)rq->nodeId, (int)rq->dciId, (int)rq->timestamp,
+               _sntprintf(query, 1024, _T("INSERT INTO %s (item_id,idata_timestamp,idata_value,raw_value) VALUES (%d,%d,%s,%s)"),
+                          table, (int)rq->dciId, (int)rq->timestamp,
                           (const TCHAR *)DBPrepareString(hdb, rq->transformedValue),
                           (const TCHAR *)DBPrepareString(hdb, rq->rawValue));
                success = DBQuery(hdb, query);
 				}
 
-				MemFree(rq);
+				if (!success)
+				{
+				   DiscardIDataRequest(rq);
+				   // Conversion of non-partitioned table done within this transaction may be lost
+				   ResetDataPartitionCache();
+				   break;
+				}
 
-				count++;
-				if (!success || (count > maxRecords))
+				batch[count++] = rq;
+				if (count > maxRecords)
 					break;
 
 				rq = writer->queue->getOrBlock(500);
 				if ((rq == NULL) || (rq == INVALID_POINTER_VALUE))
 					break;
 			}
-			DBCommit(hdb);
+			bool committed = DBCommit(hdb);
+			CompleteDataPartitionCreation(&newPartitions, committed);
+			CompleteIDataBatch(batch, count, committed);
 		}
 		else
 		{
-			MemFree(rq);
+			DiscardIDataRequest(rq);
 		}
 		DBConnectionPoolReleaseConnection(hdb);
       if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
          break;
 	}
 
+   MemFree(batch);
    return THREAD_OK;
 }
 
@@ -367,6 +415,7 @@ static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_Generic(void *arg)
    IDataWriter *writer = static_cast<IDataWriter*>(arg);
    int maxRecords = ConfigReadInt(_T("DBWriter.MaxRecordsPerTransaction"), 1000);
 
+   DELAYED_IDATA_INSERT **batch = MemAllocArrayNoInit<DELAYED_IDATA_INSERT*>(std::max(maxRecords, 0) + 1);
    TCHAR query[1024];
    while(true)
    {
@@ -384,29 +433,32 @@ static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_Generic(void *arg)
                        (int)rq->dciId, (int)rq->timestamp,
                        (const TCHAR *)DBPrepareString(hdb, rq->transformedValue),
                        (const TCHAR *)DBPrepareString(hdb, rq->rawValue));
-            bool success = DBQuery(hdb, query);
-
-            MemFree(rq);
+            if (!DBQuery(hdb, query))
+            {
+               DiscardIDataRequest(rq);
+               break;
+            }
 
-            count++;
-            if (!success || (count > maxRecords))
+            batch[count++] = rq;
+            if (count > maxRecords)
                break;
 
             rq = writer->queue->getOrBlock(500);
             if ((rq == NULL) || (rq == INVALID_POINTER_VALUE))
                break;
          }
-         DBCommit(hdb);
+         CompleteIDataBatch(batch, count, DBCommit(hdb));
       }
       else
       {
-         MemFree(rq);
+         DiscardIDataRequest(rq);
       }
       DBConnectionPoolReleaseConnection(hdb);
       if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
          break;
    }
 
+   MemFree(batch);
    return THREAD_OK;
 }
 
@@ -432,6 +484,7 @@ static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_PostgreSQL(void *ar
 
    TCHAR data[1024];
 
+   DELAYED_IDATA_INSERT **batch = MemAllocArrayNoInit<DELAYED_IDATA_INSERT*>(std::max(maxRecordsPerTxn, 1));
    while(true)
    {
       DELAYED_IDATA_INSERT *rq = writer->queue->getOrBlock();
@@ -443,6 +496,7 @@ static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_PostgreSQL(void *ar
       {
          query = queryBase;
          int countTxn = 0, countStmt = 0;
+         bool success = true;
          while(true)
          {
             _sntprintf(data, 1024, _T("%c(%u,%u,%s,%s)"),
@@ -451,9 +505,7 @@ static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_PostgreSQL(void *ar
                        (const TCHAR *)DBPrepareString(hdb, rq->transformedValue),
                        (const TCHAR *)DBPrepareString(hdb, rq->rawValue));
             query.append(data);
-            MemFree(rq);
-
-            countTxn++;
+            batch[countTxn++] = rq;
             countStmt++;
 
             if (countStmt >= maxRecordsPerStmt)
@@ -461,7 +513,10 @@ static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_PostgreSQL(void *ar
                countStmt = 0;
                query.append(_T(" ON CONFLICT DO NOTHING"));
                if (!DBQuery(hdb, query))
+               {
+                  success = false;
                   break;
+               }
                query = queryBase;
             }
 
@@ -475,19 +530,22 @@ static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_PostgreSQL(void *ar
          if (countStmt > 0)
          {
             query.append(_T(" ON CONFLICT DO NOTHING"));
-            DBQuery(hdb, query);
+            success = DBQuery(hdb, query);
          }
-         DBCommit(hdb);
+         // Failed statement aborts whole transaction on PostgreSQL
+         bool committed = DBCommit(hdb) && success;
+         CompleteIDataBatch(batch, countTxn, committed);
       }
       else
       {
-         MemFree(rq);
+         DiscardIDataRequest(rq);
       }
       DBConnectionPoolReleaseConnection(hdb);
       if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
          break;
    }
 
+   MemFree(batch);
    return THREAD_OK;
 }
 
@@ -499,6 +557,7 @@ static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_Oracle(void *arg)
    ThreadSetName("DBWriter/IData");
    IDataWriter *writer = static_cast<IDataWriter*>(arg);
    int maxRecords = ConfigReadInt(_T("DBWriter.MaxRecordsPerTransaction"), 1000);
+   DELAYED_IDATA_INSERT **batch = MemAllocArrayNoInit<DELAYED_IDATA_INSERT*>(std::max(maxRecords, 0) + 1);
    while(true)
    {
       DELAYED_IDATA_INSERT *rq = writer->queue->getOrBlock();
@@ -518,12 +577,14 @@ static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_Oracle(void *arg)
                DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, (INT64)rq->timestamp);
                DBBind(hStmt, 3, DB_SQLTYPE_VARCHAR, rq->transformedValue, DB_BIND_STATIC);
                DBBind(hStmt, 4, DB_SQLTYPE_VARCHAR, rq->rawValue, DB_BIND_STATIC);
-               bool success = DBExecute(hStmt);
-
-               MemFree(rq);
+               if (!DBExecute(hStmt))
+               {
+                  DiscardIDataRequest(rq);
+                  break;
+               }
 
-               count++;
-               if (!success || (count > maxRecords))
+               batch[count++] = rq;
+               if (count > maxRecords)
                   break;
 
                rq = writer->queue->getOrBlock(500);
@@ -534,19 +595,20 @@ static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_Oracle(void *arg)
          }
          else
          {
-            MemFree(rq);
+            DiscardIDataRequest(rq);
          }
-         DBCommit(hdb);
+         CompleteIDataBatch(batch, count, DBCommit(hdb));
       }
       else
       {
-         MemFree(rq);
+         DiscardIDataRequest(rq);
       }
       DBConnectionPoolReleaseConnection(hdb);
       if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
          break;
    }
 
+   MemFree(batch);
    return THREAD_OK;
 }
 
@@ -657,6 +719,9 @@ static THREAD_RESULT THREAD_CALL RawDataWriteThread(void *arg)
  */
 void StartDBWriter()
 {
+   InitDataPartitioning();
+   InitDataRollups();
+
    s_writerThread = ThreadCreateEx(DBWriteThread, 0, NULL);
 	s_rawDataWriterThread = ThreadCreateEx(RawDataWriteThread, 0, NULL);
 
@@ -722,6 +787,7 @@ void StopDBWriter()
       delete s_idataWriters[i].queue;
    }
    ThreadJoin(s_rawDataWriterThread);
+   StopDataRollupWriter();
    nxlog_debug_tag(DEBUG_TAG, 1, _T("All background database writers stopped"));
 }
 
@@ -1,6 +1,6 @@
 /*
 ** NetXMS - Network Management System
-** Copyright (C) 2003-2019 Victor Kirhenshtein
+** Copyright (C) 2003-2020 Victor Kirhenshtein
 **
 ** This program is free software; you can redistribute it and/or modify
 ** it under the terms of the GNU General Public License as published by
@@ -48,65 +48,22 @@ DCIRecalculationJob::~DCIRecalculationJob()
 }
 
 /**
- * Run job
+ * Recalculate values read by given query and store them using given update query.
+ * Progress is reported as part of overall progress according to stage number.
  */
-ServerJobResult DCIRecalculationJob::run()
+bool DCIRecalculationJob::recalculate(DB_HANDLE hdb, const TCHAR *selectQuery, const TCHAR *updateQuery, int stage, int stageCount)
 {
-   DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
-
-   TCHAR query[256];
-   if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
-   {
-      if (g_dbSyntax == DB_SYNTAX_TSDB)
-      {
-         _sntprintf(query, 256, _T("SELECT idata_timestamp,raw_value FROM idata_sc_%s WHERE node_id=%d AND item_id=%d ORDER BY idata_timestamp"),
-                  DCObject::getStorageClassName(m_dci->getStorageClass()), m_object->getId(), m_dci->getId());
-      }
-      else
-      {
-         _sntprintf(query, 256, _T("SELECT idata_timestamp,raw_value FROM idata WHERE node_id=%d AND item_id=%d ORDER BY idata_timestamp"),
-                  m_object->getId(), m_dci->getId());
-      }
-   }
-   else
-   {
-      _sntprintf(query, 256, _T("SELECT idata_timestamp,raw_value FROM idata_%d WHERE item_id=%d ORDER BY idata_timestamp"),
-               m_object->getId(), m_dci->getId());
-   }
-   DB_RESULT hResult = DBSelect(hdb, query);
+   DB_RESULT hResult = DBSelect(hdb, selectQuery);
    if (hResult == NULL)
-   {
-      DBConnectionPoolReleaseConnection(hdb);
-      return JOB_RESULT_FAILED;
-   }
+      return false;
 
    bool success = true;
    int count = DBGetNumRows(hResult);
    if (count > 0)
    {
-      DB_STATEMENT hStmt;
-      if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
-      {
-         if (g_dbSyntax == DB_SYNTAX_TSDB)
-         {
-            TCHAR query[256];
-            _sntprintf(query, 256, _T("UPDATE idata_sc_%s SET idata_value=? WHERE node_id=? AND item_id=? AND idata_timestamp=?"),
-                     DCObject::getStorageClassName(m_dci->getStorageClass()));
-            hStmt = DBPrepare(hdb, query);
-         }
-         else
-         {
-            hStmt = DBPrepare(hdb, _T("UPDATE idata SET idata_value=? WHERE node_id=? AND item_id=? AND idata_timestamp=?"));
-         }
-      }
-      else
-      {
-         _sntprintf(query, 256, _T("UPDATE idata_%d SET idata_value=? WHERE item_id=? AND idata_timestamp=?"), m_object->getId());
-         hStmt = DBPrepare(hdb, query);
-      }
+      DB_STATEMENT hStmt = DBPrepare(hdb, updateQuery);
       if (hStmt != NULL)
       {
-         m_dci->prepareForRecalc();
          DBBegin(hdb);
          for(int i = 0; (i < count) && !m_cancelled; i++)
          {
@@ -126,7 +83,7 @@ ServerJobResult DCIRecalculationJob::run()
 
             if (i % 10 == 0)
             {
-               markProgress(i * 100 / count);
+               markProgress((stage * 100 + i * 100 / count) / stageCount);
             }
 
             if (i % 1000 == 0)
@@ -145,6 +102,54 @@ ServerJobResult DCIRecalculationJob::run()
    }
 
    DBFreeResult(hResult);
+   return success;
+}
+
+/**
+ * Run job
+ */
+ServerJobResult DCIRecalculationJob::run()
+{
+   DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+   m_dci->prepareForRecalc();
+
+   bool success;
+   TCHAR query[256], updateQuery[256];
+   if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
+   {
+      if (g_dbSyntax == DB_SYNTAX_TSDB)
+      {
+         _sntprintf(query, 256, _T("SELECT idata_timestamp,raw_value FROM idata_sc_%s WHERE node_id=%d AND item_id=%d ORDER BY idata_timestamp"),
+                  DCObject::getStorageClassName(m_dci->getStorageClass()), m_object->getId(), m_dci->getId());
+         _sntprintf(updateQuery, 256, _T("UPDATE idata_sc_%s SET idata_value=? WHERE node_id=? AND item_id=? AND idata_timestamp=?"),
+                  DCObject::getStorageClassName(m_dci->getStorageClass()));
+      }
+      else
+      {
+         _sntprintf(query, 256, _T("SELECT idata_timestamp,raw_value FROM idata WHERE node_id=%d AND item_id=%d ORDER BY idata_timestamp"),
+                  m_object->getId(), m_dci->getId());
+         _tcscpy(updateQuery, _T("UPDATE idata SET idata_value=? WHERE node_id=? AND item_id=? AND idata_timestamp=?"));
+      }
+      success = recalculate(hdb, query, updateQuery, 0, 1);
+   }
+   else
+   {
+      // Data partitions (if any) are processed in chronological order
+      StringList *tables = GetDataPartitionTables(hdb, DCO_TYPE_ITEM, m_object->getId(), 0, 0);
+      success = true;
+      for(int i = 0; (i < tables->size()) && success && !m_cancelled; i++)
+      {
+         _sntprintf(query, 256, _T("SELECT idata_timestamp,raw_value FROM %s WHERE item_id=%d ORDER BY idata_timestamp"),
+                  tables->get(i), m_dci->getId());
+         _sntprintf(updateQuery, 256, _T("UPDATE %s SET idata_value=? WHERE item_id=? AND idata_timestamp=?"), tables->get(i));
+         success = recalculate(hdb, query, updateQuery, i, tables->size());
+      }
+      delete tables;
+   }
+
+   if (success && !m_cancelled)
+      success = RebuildDataRollups(hdb, m_object->getId(), m_dci->getId(), m_dci->getStorageClass());
+
    DBConnectionPoolReleaseConnection(hdb);
 
    if (success)
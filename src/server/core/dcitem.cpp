@@ -542,6 +542,7 @@ void DCItem::deleteFromDatabase()
    _sntprintf(szQuery, sizeof(szQuery) / sizeof(TCHAR), _T("DELETE FROM thresholds WHERE item_id=%d"), m_id);
    QueueSQLRequest(szQuery);
    QueueRawDciDataDelete(m_id);
+   DeleteDataRollups(m_owner->getId(), m_id);
 
    if (m_owner->isDataCollectionTarget())
       static_cast<DataCollectionTarget*>(m_owner)->scheduleItemDataCleanup(m_id);
@@ -1549,6 +1550,9 @@ ItemValue *DCItem::getInternalLastValue()
  */
 TCHAR *DCItem::getAggregateValue(AggregationFunction func, time_t periodStart, time_t periodEnd)
 {
+   if (IsDataRollupEnabled() && (func != DCI_AGG_LAST) && (m_dataType != DCI_DT_STRING))
+      return GetDataRollupAggregateValue(m_owner->getId(), m_id, getStorageClass(), func, periodStart, periodEnd);
+
 	DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
 	TCHAR query[1024];
    TCHAR *result = NULL;
@@ -1656,14 +1660,16 @@ bool DCItem::deleteAllData()
    }
    else
    {
-      _sntprintf(query, 256, _T("DELETE FROM idata_%d WHERE item_id=%d"), m_owner->getId(), m_id);
+      _sntprintf(query, 256, _T("item_id=%d"), m_id);
    }
-	bool success = DBQuery(hdb, query);
+	bool success = (g_flags & AF_SINGLE_TABLE_PERF_DATA) ? DBQuery(hdb, query) : DeleteFromDataPartitions(hdb, DCO_TYPE_ITEM, m_owner->getId(), query, 0, 0);
 	clearCache();
 	updateCacheSizeInternal(true);
    unlock();
 
    DBConnectionPoolReleaseConnection(hdb);
+   if (success)
+      DeleteDataRollups(m_owner->getId(), m_id);
 	return success;
 }
 
@@ -1690,16 +1696,25 @@ bool DCItem::deleteEntry(time_t timestamp)
    }
    else
    {
-      _sntprintf(query, 256, _T("DELETE FROM idata_%d WHERE item_id=%d AND idata_timestamp=%d"), m_owner->getId(), m_id, (int)timestamp);
+      _sntprintf(query, 256, _T("item_id=%d AND idata_timestamp=%d"), m_id, (int)timestamp);
    }
+   UINT32 ownerId = m_owner->getId();
+   DCObjectStorageClass storageClass = getStorageClass();
    unlock();
 
-   bool success = DBQuery(hdb, query);
+   // Totals of deleted values are needed to adjust rollups
+   INT32 deletedCount = 0;
+   double deletedSum = 0;
+   bool success = ReadDataRollupDeletionTotals(hdb, ownerId, m_id, storageClass, timestamp, &deletedCount, &deletedSum);
+   if (success)
+      success = (g_flags & AF_SINGLE_TABLE_PERF_DATA) ? DBQuery(hdb, query) : DeleteFromDataPartitions(hdb, DCO_TYPE_ITEM, ownerId, query, timestamp, timestamp);
    DBConnectionPoolReleaseConnection(hdb);
 
    if (!success)
       return false;
 
+   RemoveFromDataRollups(ownerId, m_id, storageClass, timestamp, deletedCount, deletedSum);
+
    lock();
    for(UINT32 i = 0; i < m_cacheSize; i++)
    {
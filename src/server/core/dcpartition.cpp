@@ -0,0 +1,643 @@
+/*
+** NetXMS - Network Management System
+** Copyright (C) 2003-2020 Victor Kirhenshtein
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: dcpartition.cpp
+**
+**/
+
+#include "nxcore.h"
+
+#define DEBUG_TAG _T("dc.partitions")
+
+/**
+ * Minimal allowed partition interval (in seconds)
+ */
+#define MIN_PARTITION_INTERVAL   3600
+
+/**
+ * Maximum number of partitions expected within longest retention period. Partition interval
+ * is increased when necessary to keep number of partitions within this limit.
+ */
+#define MAX_PARTITIONS_PER_TABLE 200
+
+/**
+ * Partition interval in seconds (0 if partitioning is disabled)
+ */
+static INT64 s_partitionInterval = 0;
+
+/**
+ * Known partitions for each idata_xxx and tdata_xxx table. Key is object type combined with node ID.
+ * Each element contains sorted list of partition start times.
+ */
+static HashMap<UINT64, IntegerArray<INT64>> s_partitions(Ownership::True);
+static Mutex s_partitionLock;
+
+/**
+ * Get partition cache key
+ */
+static inline UINT64 PartitionKey(int type, UINT32 nodeId)
+{
+   return (static_cast<UINT64>(type) << 32) | static_cast<UINT64>(nodeId);
+}
+
+/**
+ * Get name of data table (or view if partitioning is enabled) for given node
+ */
+static inline TCHAR *GetDataTableName(int type, UINT32 nodeId, TCHAR *buffer)
+{
+   _sntprintf(buffer, 64, (type == DCO_TYPE_ITEM) ? _T("idata_%u") : _T("tdata_%u"), nodeId);
+   return buffer;
+}
+
+/**
+ * Get end time (exclusive) for data stored in partition with given index. Partition with start
+ * time 0 holds data converted from non-partitioned table and may contain records up to the moment
+ * of conversion, so extra interval is added for it.
+ */
+static inline INT64 GetPartitionEnd(const IntegerArray<INT64> *partitions, int index)
+{
+   if (index == partitions->size() - 1)
+      return _LL(0x7FFFFFFFFFFFFFFF);
+   INT64 end = partitions->get(index + 1);
+   return (partitions->get(index) == 0) ? end + s_partitionInterval : end;
+}
+
+static void ScheduleNextPartitionCreation();
+
+/**
+ * Compare partition start times
+ */
+static int ComparePartitionStart(const void *p1, const void *p2)
+{
+   INT64 s1 = *static_cast<const INT64*>(p1);
+   INT64 s2 = *static_cast<const INT64*>(p2);
+   return (s1 < s2) ? -1 : ((s1 > s2) ? 1 : 0);
+}
+
+/**
+ * Get longest configured data retention time (in days)
+ */
+static INT32 GetMaxRetentionTime()
+{
+   INT32 retentionTime = ConfigReadInt(_T("DefaultDCIRetentionTime"), 30);
+   DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+   DB_RESULT hResult = DBSelect(hdb, _T("SELECT max(retention_time) FROM items UNION ALL SELECT max(retention_time) FROM dc_tables"));
+   if (hResult != NULL)
+   {
+      int count = DBGetNumRows(hResult);
+      for(int i = 0; i < count; i++)
+         retentionTime = std::max(retentionTime, DBGetFieldLong(hResult, i, 0));
+      DBFreeResult(hResult);
+   }
+   DBConnectionPoolReleaseConnection(hdb);
+   return retentionTime;
+}
+
+/**
+ * Initialize data partitioning. Partition interval is fixed when first partition is created and
+ * subsequent changes of configuration parameter are ignored.
+ */
+void InitDataPartitioning()
+{
+   INT32 interval = MetaDataReadInt32(_T("DataPartitionInterval"), 0);
+   INT32 configuredInterval = ConfigReadInt(_T("DataCollection.PartitionInterval"), 0);
+   if (interval == 0)
+   {
+      if (configuredInterval <= 0)
+         return;
+
+      if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
+      {
+         nxlog_write_tag(NXLOG_WARNING, DEBUG_TAG, _T("Data partitioning is not supported when performance data stored in single table"));
+         return;
+      }
+      if ((g_dbSyntax != DB_SYNTAX_PGSQL) && (g_dbSyntax != DB_SYNTAX_SQLITE))
+      {
+         nxlog_write_tag(NXLOG_WARNING, DEBUG_TAG, _T("Data partitioning is not supported for current database type"));
+         return;
+      }
+
+      interval = std::max(configuredInterval, MIN_PARTITION_INTERVAL);
+      INT32 retentionTime = GetMaxRetentionTime();
+      INT32 minInterval = static_cast<INT32>((static_cast<INT64>(retentionTime) * 86400 + MAX_PARTITIONS_PER_TABLE - 1) / MAX_PARTITIONS_PER_TABLE);
+      if (interval < minInterval)
+      {
+         interval = minInterval - minInterval % MIN_PARTITION_INTERVAL + MIN_PARTITION_INTERVAL;
+         nxlog_write_tag(NXLOG_WARNING, DEBUG_TAG, _T("Data partition interval increased to %d seconds to limit number of partitions within %d days retention period"),
+                  interval, retentionTime);
+      }
+      MetaDataWriteInt32(_T("DataPartitionInterval"), interval);
+   }
+   else if ((configuredInterval != interval) && (configuredInterval != 0))
+   {
+      nxlog_write_tag(NXLOG_WARNING, DEBUG_TAG, _T("Data partition interval cannot be changed after partitioning was enabled (using %d seconds)"), interval);
+   }
+   else if (configuredInterval == 0)
+   {
+      nxlog_write_tag(NXLOG_WARNING, DEBUG_TAG, _T("Data partitioning cannot be disabled after it was enabled"));
+   }
+
+   s_partitionInterval = interval;
+   nxlog_debug_tag(DEBUG_TAG, 1, _T("Data partitioning enabled (interval %d seconds)"), interval);
+   ScheduleNextPartitionCreation();
+}
+
+/**
+ * Check if data partitioning is enabled
+ */
+bool IsDataPartitioningEnabled()
+{
+   return s_partitionInterval != 0;
+}
+
+/**
+ * Execute table or index creation command from metadata for given partition.
+ * Returns true if command is not defined.
+ */
+static bool ExecuteCreationCommand(DB_HANDLE hdb, const TCHAR *name, const TCHAR *suffix)
+{
+   TCHAR queryTemplate[256];
+   MetaDataReadStr(name, queryTemplate, 255, _T(""));
+   if (queryTemplate[0] == 0)
+      return true;
+
+   StringBuffer query(queryTemplate);
+   query.replace(_T("%d"), suffix);
+   return DBQuery(hdb, query);
+}
+
+/**
+ * Create new partition
+ */
+static bool CreatePartition(DB_HANDLE hdb, int type, UINT32 nodeId, INT64 start)
+{
+   TCHAR suffix[64];
+   _sntprintf(suffix, 64, _T("%u_p") INT64_FMT, nodeId, start);
+
+   // Partition may be already created by another writer
+   TCHAR name[64];
+   _sntprintf(name, 64, (type == DCO_TYPE_ITEM) ? _T("idata_%s") : _T("tdata_%s"), suffix);
+   if (DBIsTableExist(hdb, name) == DBIsTableExist_Found)
+      return true;
+
+   bool success = true;
+   if (type == DCO_TYPE_ITEM)
+   {
+      success = ExecuteCreationCommand(hdb, _T("IDataTableCreationCommand"), suffix);
+      for(int i = 0; (i < 10) && success; i++)
+      {
+         _sntprintf(name, 64, _T("IDataIndexCreationCommand_%d"), i);
+         success = ExecuteCreationCommand(hdb, name, suffix);
+      }
+   }
+   else
+   {
+      for(int i = 0; (i < 10) && success; i++)
+      {
+         _sntprintf(name, 64, _T("TDataTableCreationCommand_%d"), i);
+         success = ExecuteCreationCommand(hdb, name, suffix);
+      }
+      for(int i = 0; (i < 10) && success; i++)
+      {
+         _sntprintf(name, 64, _T("TDataIndexCreationCommand_%d"), i);
+         success = ExecuteCreationCommand(hdb, name, suffix);
+      }
+   }
+
+   nxlog_debug_tag(DEBUG_TAG, 5, _T("Creation of partition %s_%s %s"), (type == DCO_TYPE_ITEM) ? _T("idata") : _T("tdata"),
+            suffix, success ? _T("successful") : _T("failed"));
+   return success;
+}
+
+/**
+ * Load list of existing partitions from database. Existing non-partitioned table is converted
+ * into partition with start time 0. Partition lock should be held by caller.
+ */
+static IntegerArray<INT64> *LoadPartitions(DB_HANDLE hdb, int type, UINT32 nodeId)
+{
+   TCHAR table[64];
+   GetDataTableName(type, nodeId, table);
+   IntegerArray<INT64> *partitions = DBGetTimePartitions(hdb, table);
+   if (partitions == NULL)
+      return NULL;
+
+   if (partitions->isEmpty() && (DBIsTableExist(hdb, table) == DBIsTableExist_Found))
+   {
+      TCHAR name[96];
+      DBGetTimePartitionName(table, 0, name, 96);
+      if (!DBRenameTable(hdb, table, name))
+      {
+         nxlog_debug_tag(DEBUG_TAG, 3, _T("Cannot convert table %s into partition"), table);
+         delete partitions;
+         return NULL;
+      }
+      partitions->add(0);
+      DBRebuildTimePartitionView(hdb, table, partitions);
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("Table %s converted into partition %s"), table, name);
+   }
+   return partitions;
+}
+
+/**
+ * Get cached list of partitions. Partition lock should be held by caller.
+ * Database connection will be acquired from pool if hdb is NULL and database access is needed.
+ */
+static IntegerArray<INT64> *GetPartitions(DB_HANDLE hdb, int type, UINT32 nodeId)
+{
+   IntegerArray<INT64> *partitions = s_partitions.get(PartitionKey(type, nodeId));
+   if (partitions != NULL)
+      return partitions;
+
+   DB_HANDLE hdbLocal = (hdb != NULL) ? hdb : DBConnectionPoolAcquireConnection();
+   partitions = LoadPartitions(hdbLocal, type, nodeId);
+   if (hdb == NULL)
+      DBConnectionPoolReleaseConnection(hdbLocal);
+   if (partitions != NULL)
+      s_partitions.set(PartitionKey(type, nodeId), partitions);
+   return partitions;
+}
+
+/**
+ * Add new partition starting at given time. Partition lock should be held by caller.
+ */
+static bool AddPartition(DB_HANDLE hdb, IntegerArray<INT64> *partitions, int type, UINT32 nodeId, INT64 start)
+{
+   DB_HANDLE hdbLocal = (hdb != NULL) ? hdb : DBConnectionPoolAcquireConnection();
+   bool success = CreatePartition(hdbLocal, type, nodeId, start);
+   if (success)
+   {
+      partitions->add(start);
+      TCHAR table[64];
+      success = DBRebuildTimePartitionView(hdbLocal, GetDataTableName(type, nodeId, table), partitions);
+   }
+   if (hdb == NULL)
+      DBConnectionPoolReleaseConnection(hdbLocal);
+   return success;
+}
+
+/**
+ * Callback for collecting keys of cached partition lists
+ */
+static EnumerationCallbackResult CollectPartitionKeys(const void *key, const void *value, void *context)
+{
+   static_cast<IntegerArray<UINT64>*>(context)->add(*static_cast<const UINT64*>(key));
+   return _CONTINUE;
+}
+
+/**
+ * Create partitions for next interval in advance, so that data writers do not have to create
+ * them inside their transactions. Only tables already known to partition cache are processed,
+ * partition for other tables will be created on first insert if needed.
+ */
+static void CreateNextDataPartitions(void *arg)
+{
+   time_t now = time(NULL);
+   INT64 start = now - now % s_partitionInterval + s_partitionInterval;
+
+   IntegerArray<UINT64> keys(256, 256);
+   s_partitionLock.lock();
+   s_partitions.forEach(CollectPartitionKeys, &keys);
+   s_partitionLock.unlock();
+
+   nxlog_debug_tag(DEBUG_TAG, 5, _T("Creating partitions starting at ") INT64_FMT _T(" for %d tables"), start, keys.size());
+   DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+   for(int i = 0; i < keys.size(); i++)
+   {
+      int type = static_cast<int>(keys.get(i) >> 32);
+      UINT32 nodeId = static_cast<UINT32>(keys.get(i));
+
+      // Lock is held per table to avoid blocking data writers for whole run
+      s_partitionLock.lock();
+      IntegerArray<INT64> *partitions = s_partitions.get(keys.get(i));
+      if ((partitions != NULL) && (partitions->isEmpty() || (partitions->get(partitions->size() - 1) < start)))
+         AddPartition(hdb, partitions, type, nodeId, start);
+      s_partitionLock.unlock();
+   }
+   DBConnectionPoolReleaseConnection(hdb);
+
+   ScheduleNextPartitionCreation();
+}
+
+/**
+ * Schedule creation of partitions for next interval. Partitions are created when a quarter
+ * of current interval remains.
+ */
+static void ScheduleNextPartitionCreation()
+{
+   time_t now = time(NULL);
+   time_t runTime = now - now % s_partitionInterval + s_partitionInterval - s_partitionInterval / 4;
+   if (runTime <= now)
+      runTime += s_partitionInterval;
+   ThreadPoolScheduleAbsolute(g_mainThreadPool, runTime, CreateNextDataPartitions, NULL);
+}
+
+/**
+ * Reset partition cache. Should be called after failed transaction which may have created
+ * partitions, so that partition lists are reloaded from database.
+ */
+void ResetDataPartitionCache()
+{
+   if (s_partitionInterval == 0)
+      return;
+
+   s_partitionLock.lock();
+   s_partitions.clear();
+   s_partitionLock.unlock();
+}
+
+/**
+ * Create data tables for new node
+ */
+void CreateDataPartitions(DB_HANDLE hdb, UINT32 nodeId)
+{
+   time_t now = time(NULL);
+   INT64 start = now - now % s_partitionInterval;
+
+   s_partitionLock.lock();
+   IntegerArray<INT64> *partitions = new IntegerArray<INT64>(16, 16);
+   s_partitions.set(PartitionKey(DCO_TYPE_ITEM, nodeId), partitions);
+   AddPartition(hdb, partitions, DCO_TYPE_ITEM, nodeId, start);
+
+   partitions = new IntegerArray<INT64>(16, 16);
+   s_partitions.set(PartitionKey(DCO_TYPE_TABLE, nodeId), partitions);
+   AddPartition(hdb, partitions, DCO_TYPE_TABLE, nodeId, start);
+   s_partitionLock.unlock();
+}
+
+/**
+ * Get name of the table where record with given timestamp should be inserted. Records go to
+ * partition with greatest start time not exceeding record's timestamp, new partition is created
+ * when record's timestamp is beyond current partition interval. Records with timestamp far in
+ * the future do not cause partition creation and are stored in latest existing partition.
+ * Missing partition is created using provided connection (normally within caller's transaction)
+ * and added to given list instead of partition cache. Caller should call CompleteDataPartitionCreation
+ * once transaction is finished, so that other writers do not use partitions which are not committed yet.
+ */
+bool GetDataInsertTable(DB_HANDLE hdb, int type, UINT32 nodeId, time_t timestamp, TCHAR *buffer, size_t size, StructArray<NewDataPartition> *newPartitions)
+{
+   TCHAR table[64];
+   GetDataTableName(type, nodeId, table);
+   if (s_partitionInterval == 0)
+   {
+      _tcslcpy(buffer, table, size);
+      return true;
+   }
+
+   s_partitionLock.lock();
+   IntegerArray<INT64> *partitions = GetPartitions(hdb, type, nodeId);
+   if (partitions == NULL)
+   {
+      s_partitionLock.unlock();
+      return false;
+   }
+
+   int index = DBFindTimePartition(partitions, timestamp);
+   INT64 start = (index != -1) ? partitions->get(index) : (partitions->isEmpty() ? -1 : partitions->get(0));
+   INT64 latest = partitions->isEmpty() ? -1 : partitions->get(partitions->size() - 1);
+
+   // Partitions created within caller's transaction always follow cached ones
+   for(int i = 0; i < newPartitions->size(); i++)
+   {
+      NewDataPartition *p = newPartitions->get(i);
+      if ((p->type != type) || (p->nodeId != nodeId))
+         continue;
+      if ((p->start <= timestamp) || (start == -1))
+         start = std::max(start, p->start);
+      latest = std::max(latest, p->start);
+   }
+
+   IntegerArray<INT64> *viewPartitions = NULL;
+   if ((latest == -1) || ((timestamp >= latest + s_partitionInterval) && (timestamp <= time(NULL) + s_partitionInterval)))
+      viewPartitions = new IntegerArray<INT64>(partitions);
+   s_partitionLock.unlock();
+
+   if (viewPartitions != NULL)
+   {
+      // Database objects are created without holding partition lock, because creation may block
+      // until concurrent transaction which creates same partition is finished
+      INT64 newStart = timestamp - timestamp % s_partitionInterval;
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("Partition for timestamp ") INT64_FMT _T(" was not created in advance"), static_cast<INT64>(timestamp));
+      for(int i = 0; i < newPartitions->size(); i++)
+      {
+         NewDataPartition *p = newPartitions->get(i);
+         if ((p->type == type) && (p->nodeId == nodeId))
+            viewPartitions->add(p->start);
+      }
+      viewPartitions->add(newStart);
+      bool success = CreatePartition(hdb, type, nodeId, newStart) && DBRebuildTimePartitionView(hdb, table, viewPartitions);
+      delete viewPartitions;
+      if (!success)
+         return false;
+
+      NewDataPartition p;
+      p.type = type;
+      p.nodeId = nodeId;
+      p.start = newStart;
+      newPartitions->add(&p);
+      start = newStart;
+   }
+
+   DBGetTimePartitionName(table, start, buffer, size);
+   return true;
+}
+
+/**
+ * Complete creation of partitions by data writer. Partitions are added to partition cache
+ * if writer's transaction was committed.
+ */
+void CompleteDataPartitionCreation(StructArray<NewDataPartition> *newPartitions, bool committed)
+{
+   if (newPartitions->isEmpty())
+      return;
+
+   if (committed)
+   {
+      s_partitionLock.lock();
+      for(int i = 0; i < newPartitions->size(); i++)
+      {
+         NewDataPartition *p = newPartitions->get(i);
+         IntegerArray<INT64> *partitions = s_partitions.get(PartitionKey(p->type, p->nodeId));
+         if ((partitions != NULL) && !partitions->contains(p->start))
+         {
+            partitions->add(p->start);
+            partitions->sort(ComparePartitionStart);
+         }
+      }
+      s_partitionLock.unlock();
+   }
+   newPartitions->clear();
+}
+
+/**
+ * Get list of partition tables which may contain records within given time range
+ * (0 in timeFrom or timeTo means no limit). Tables are listed in partition order.
+ */
+StringList *GetDataPartitionTables(DB_HANDLE hdb, int type, UINT32 nodeId, time_t timeFrom, time_t timeTo)
+{
+   StringList *tables = new StringList();
+   TCHAR table[64], name[96];
+   GetDataTableName(type, nodeId, table);
+
+   if (s_partitionInterval == 0)
+   {
+      tables->add(table);
+      return tables;
+   }
+
+   s_partitionLock.lock();
+   IntegerArray<INT64> *partitions = GetPartitions(hdb, type, nodeId);
+   if (partitions != NULL)
+   {
+      for(int i = 0; i < partitions->size(); i++)
+      {
+         if (((timeTo == 0) || (i == 0) || (partitions->get(i) <= timeTo)) && (GetPartitionEnd(partitions, i) > timeFrom))
+            tables->add(DBGetTimePartitionName(table, partitions->get(i), name, 96));
+      }
+   }
+   s_partitionLock.unlock();
+   return tables;
+}
+
+/**
+ * Get table expression for reading data within given time range. Returns data table (or view)
+ * name if all partitions should be read and UNION of relevant partitions otherwise.
+ */
+String GetDataSelectSource(int type, UINT32 nodeId, time_t timeFrom, time_t timeTo)
+{
+   TCHAR table[64];
+   GetDataTableName(type, nodeId, table);
+   if ((s_partitionInterval == 0) || ((timeFrom == 0) && (timeTo == 0)))
+      return String(table);
+
+   StringList *tables = GetDataPartitionTables(NULL, type, nodeId, timeFrom, timeTo);
+
+   StringBuffer source;
+   if (tables->size() == 1)
+   {
+      source = tables->get(0);
+   }
+   else if (tables->isEmpty())
+   {
+      source = table;
+   }
+   else
+   {
+      source = _T("(");
+      for(int i = 0; i < tables->size(); i++)
+      {
+         if (i > 0)
+            source.append(_T(" UNION ALL "));
+         source.append(_T("SELECT * FROM "));
+         source.append(tables->get(i));
+      }
+      source.append(_T(") d"));
+   }
+   delete tables;
+   return source;
+}
+
+/**
+ * Drop partitions which contain only records older than given cutoff time. Latest partition is never dropped.
+ */
+void DropExpiredDataPartitions(DB_HANDLE hdb, int type, UINT32 nodeId, time_t cutoffTime)
+{
+   if (s_partitionInterval == 0)
+      return;
+
+   TCHAR table[64];
+   GetDataTableName(type, nodeId, table);
+
+   s_partitionLock.lock();
+   IntegerArray<INT64> *partitions = GetPartitions(hdb, type, nodeId);
+   int count = 0;
+   if (partitions != NULL)
+   {
+      while((count < partitions->size() - 1) && (GetPartitionEnd(partitions, count) <= cutoffTime))
+         count++;
+   }
+   if (count == 0)
+   {
+      s_partitionLock.unlock();
+      return;
+   }
+
+   // View should be updated before dropping partition tables
+   IntegerArray<INT64> expired(count, 16);
+   for(int i = 0; i < count; i++)
+   {
+      expired.add(partitions->get(0));
+      partitions->remove(0);
+   }
+   DBRebuildTimePartitionView(hdb, table, partitions);
+   s_partitionLock.unlock();
+
+   for(int i = 0; i < expired.size(); i++)
+   {
+      TCHAR name[96], query[256];
+      _sntprintf(query, 256, _T("DROP TABLE %s"), DBGetTimePartitionName(table, expired.get(i), name, 96));
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("Dropping expired partition %s"), name);
+      DBQuery(hdb, query);
+   }
+}
+
+/**
+ * Queue drop of all data partitions for given node
+ */
+void QueueDropDataPartitions(UINT32 nodeId)
+{
+   static int types[] = { DCO_TYPE_ITEM, DCO_TYPE_TABLE };
+   for(int t = 0; t < 2; t++)
+   {
+      StringList *tables = GetDataPartitionTables(NULL, types[t], nodeId, 0, 0);
+
+      TCHAR table[64], query[256];
+      _sntprintf(query, 256, _T("DROP VIEW %s"), GetDataTableName(types[t], nodeId, table));
+      QueueSQLRequest(query);
+      for(int i = 0; i < tables->size(); i++)
+      {
+         _sntprintf(query, 256, _T("DROP TABLE %s"), tables->get(i));
+         QueueSQLRequest(query);
+      }
+      delete tables;
+
+      s_partitionLock.lock();
+      s_partitions.remove(PartitionKey(types[t], nodeId));
+      s_partitionLock.unlock();
+   }
+}
+
+/**
+ * Delete records matching given condition from all data tables of given node which may contain
+ * records within given time range (0 in timeFrom or timeTo means no limit)
+ */
+bool DeleteFromDataPartitions(DB_HANDLE hdb, int type, UINT32 nodeId, const TCHAR *condition, time_t timeFrom, time_t timeTo)
+{
+   StringList *tables = GetDataPartitionTables(hdb, type, nodeId, timeFrom, timeTo);
+   bool success = true;
+   for(int i = 0; i < tables->size(); i++)
+   {
+      StringBuffer query(_T("DELETE FROM "));
+      query.append(tables->get(i));
+      query.append(_T(" WHERE "));
+      query.append(condition);
+      if (!DBQuery(hdb, query))
+         success = false;
+   }
+   delete tables;
+   return success;
+}
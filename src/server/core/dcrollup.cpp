@@ -0,0 +1,1228 @@
+/*
+** NetXMS - Network Management System
+** Copyright (C) 2003-2020 Victor Kirhenshtein
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: dcrollup.cpp
+**
+**/
+
+#include "nxcore.h"
+#include <nms_rollup.h>
+
+#define DEBUG_TAG _T("dc.rollup")
+
+/**
+ * Maximum number of rollup tiers
+ */
+#define MAX_ROLLUP_TIERS         8
+
+/**
+ * Minimal allowed rollup resolution (in seconds)
+ */
+#define MIN_ROLLUP_RESOLUTION    60
+
+/**
+ * Interval between rollup flushes (in seconds)
+ */
+#define ROLLUP_FLUSH_INTERVAL    60
+
+/**
+ * Number of bucket map shards
+ */
+#define ROLLUP_BUCKET_SHARDS     32
+
+/**
+ * Configured tiers sorted by resolution (finest first)
+ */
+static RollupTier s_tiers[MAX_ROLLUP_TIERS];
+static int s_tierCount = 0;
+
+/**
+ * Rollup bucket key
+ */
+struct RollupKey
+{
+   UINT32 dciId;
+   UINT32 tier;
+   INT64 periodStart;
+};
+
+/**
+ * Rollup bucket. Bucket holds totals for whole period (including values written to database
+ * before bucket was created, once they are merged on first flush).
+ */
+struct RollupBucket : public RollupAggregate
+{
+   RollupKey key;
+   UINT32 nodeId;
+   DCObjectStorageClass storageClass;
+   bool dirty;          // Bucket was updated since last flush
+   bool persisted;      // Bucket was written to database (or merged with existing record)
+   bool resetMinMax;    // Values were deleted, minimum and maximum should be recalculated from raw data
+};
+
+/**
+ * Shard of buckets for currently active periods. Buckets are distributed between shards by DCI ID.
+ */
+struct RollupBucketShard
+{
+   HashMap<RollupKey, RollupBucket> buckets;
+   Mutex lock;
+
+   RollupBucketShard() : buckets(Ownership::True) { }
+};
+static RollupBucketShard s_bucketShards[ROLLUP_BUCKET_SHARDS];
+
+/**
+ * Get bucket shard for given DCI
+ */
+static inline RollupBucketShard *GetBucketShard(UINT32 dciId)
+{
+   return &s_bucketShards[dciId % ROLLUP_BUCKET_SHARDS];
+}
+
+/**
+ * Period of finest tier with values not yet included into flushed rollups
+ */
+struct PendingRollupPeriod
+{
+   INT64 periodStart;
+   INT32 queued;        // Values waiting in data writer queue
+   INT32 committed;     // Values committed to raw data (or deleted from it) but not flushed yet
+   INT32 flushing;      // Values included into running flush
+};
+
+/**
+ * Pending periods. Rollup data is only used for time before oldest pending period, so late values
+ * (for example, values sent from agent cache) are read from raw data until they are flushed.
+ */
+static HashMap<INT64, PendingRollupPeriod> s_pendingPeriods(Ownership::True);
+static INT64 s_oldestPendingPeriod = 0;
+static Mutex s_pendingLock;
+
+/**
+ * Flush boundary as of last completed flush (used when there are no pending periods)
+ */
+static INT64 s_flushedUntil = 0;
+
+/**
+ * Flush boundary stored in database. Rollups for periods after it are rebuilt from raw data on startup.
+ */
+static INT64 s_persistedFlushBoundary = 0;
+static Mutex s_persistLock;
+
+/**
+ * Rollup writer thread
+ */
+static THREAD s_writerThread = INVALID_THREAD_HANDLE;
+
+/**
+ * Rollup writer thread
+ */
+static THREAD_RESULT THREAD_CALL RollupWriterThread(void *arg);
+
+/**
+ * Rebuild rollups for given DCI from raw data
+ */
+static bool RebuildDataRollups(DB_HANDLE hdb, UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass, INT64 since);
+
+/**
+ * Store flush boundary in database. Callers are serialized, so that last write always stores most recent value.
+ */
+static void PersistFlushBoundary()
+{
+   s_persistLock.lock();
+   s_pendingLock.lock();
+   INT64 boundary = s_persistedFlushBoundary;
+   s_pendingLock.unlock();
+   MetaDataWriteInt32(_T("DataRollupFlushBoundary"), static_cast<INT32>(boundary));
+   s_persistLock.unlock();
+}
+
+/**
+ * Rebuild rollups for periods which may not have been flushed before server was stopped unexpectedly
+ */
+static void RecoverDataRollups(INT64 since)
+{
+   nxlog_write_tag(NXLOG_WARNING, DEBUG_TAG, _T("Server was not stopped properly, rebuilding data rollups since ") INT64_FMT, since);
+
+   DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+   DB_RESULT hResult = DBSelect(hdb, _T("SELECT item_id,node_id,retention_type,retention_time FROM items"));
+   if (hResult != NULL)
+   {
+      int count = DBGetNumRows(hResult);
+      int failed = 0;
+      for(int i = 0; i < count; i++)
+      {
+         int retentionType = DBGetFieldLong(hResult, i, 2);
+         if (retentionType == DC_RETENTION_NONE)
+            continue;
+         DCObjectStorageClass storageClass = (retentionType == DC_RETENTION_CUSTOM) ?
+                  DCObject::storageClassFromRetentionTime(DBGetFieldLong(hResult, i, 3)) : DCObjectStorageClass::DEFAULT;
+         if (!RebuildDataRollups(hdb, DBGetFieldULong(hResult, i, 1), DBGetFieldULong(hResult, i, 0), storageClass, since))
+            failed++;
+      }
+      DBFreeResult(hResult);
+      if (failed > 0)
+         nxlog_write_tag(NXLOG_WARNING, DEBUG_TAG, _T("Data rollup rebuild failed for %d of %d DCIs"), failed, count);
+      else
+         nxlog_debug_tag(DEBUG_TAG, 1, _T("Data rollups for %d DCIs rebuilt"), count);
+   }
+   DBConnectionPoolReleaseConnection(hdb);
+}
+
+/**
+ * Initialize data rollups. Tiers are read from configuration parameter DataCollection.RollupTiers
+ * as comma separated list of resolutions. Time of first use of each resolution is stored in
+ * metadata, so that queries will not use rollup data for periods where it is incomplete.
+ */
+void InitDataRollups()
+{
+   TCHAR config[256];
+   ConfigReadStr(_T("DataCollection.RollupTiers"), config, 256, _T(""));
+   StringList *elements = String(config).split(_T(","));
+   for(int i = 0; (i < elements->size()) && (s_tierCount < MAX_ROLLUP_TIERS); i++)
+   {
+      TCHAR element[64];
+      _tcslcpy(element, elements->get(i), 64);
+      StrStrip(element);
+      if (element[0] == 0)
+         continue;
+
+      INT64 resolution = ParseRollupResolution(element);
+      if (resolution < MIN_ROLLUP_RESOLUTION)
+      {
+         nxlog_write_tag(NXLOG_WARNING, DEBUG_TAG, _T("Invalid data rollup resolution \"%s\" (should be at least %d seconds)"), element, MIN_ROLLUP_RESOLUTION);
+         continue;
+      }
+
+      int pos;
+      for(pos = 0; (pos < s_tierCount) && (s_tiers[pos].resolution < resolution); pos++);
+      if ((pos < s_tierCount) && (s_tiers[pos].resolution == resolution))
+         continue;   // duplicate
+      memmove(&s_tiers[pos + 1], &s_tiers[pos], (s_tierCount - pos) * sizeof(RollupTier));
+      s_tiers[pos].resolution = resolution;
+      s_tierCount++;
+   }
+   delete elements;
+
+   if (s_tierCount == 0)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 1, _T("Data rollups disabled"));
+      return;
+   }
+
+   time_t now = time(NULL);
+   for(int i = 0; i < s_tierCount; i++)
+   {
+      TCHAR name[64];
+      _sntprintf(name, 64, _T("DataRollupStart.") INT64_FMT, s_tiers[i].resolution);
+      INT64 start = MetaDataReadInt32(name, 0);
+      if (start == 0)
+      {
+         start = now;
+         MetaDataWriteInt32(name, static_cast<INT32>(now));
+      }
+      s_tiers[i].coverageStart = RollupAlignUp(start, s_tiers[i].resolution);
+      nxlog_debug_tag(DEBUG_TAG, 1, _T("Data rollup tier ") INT64_FMT _T(" seconds enabled"), s_tiers[i].resolution);
+   }
+
+   // Flush boundary is reset to 0 on clean shutdown
+   s_flushedUntil = now;
+   s_persistedFlushBoundary = RollupAlignDown(now, s_tiers[0].resolution);
+   INT64 boundary = MetaDataReadInt32(_T("DataRollupFlushBoundary"), 0);
+   if (boundary > 0)
+      RecoverDataRollups(std::min(boundary, s_persistedFlushBoundary));
+   PersistFlushBoundary();
+
+   s_writerThread = ThreadCreateEx(RollupWriterThread, 0, NULL);
+}
+
+/**
+ * Check if data rollups are enabled
+ */
+bool IsDataRollupEnabled()
+{
+   return s_tierCount > 0;
+}
+
+/**
+ * Get pending period for given timestamp, creating new one if needed. Pending period lock should be held by caller.
+ */
+static PendingRollupPeriod *GetPendingPeriod(time_t timestamp)
+{
+   INT64 periodStart = RollupAlignDown(timestamp, s_tiers[0].resolution);
+   PendingRollupPeriod *p = s_pendingPeriods.get(periodStart);
+   if (p == NULL)
+   {
+      p = new PendingRollupPeriod();
+      p->periodStart = periodStart;
+      s_pendingPeriods.set(periodStart, p);
+      if ((s_pendingPeriods.size() == 1) || (periodStart < s_oldestPendingPeriod))
+         s_oldestPendingPeriod = periodStart;
+   }
+   return p;
+}
+
+/**
+ * Remove pending periods without values and find oldest remaining one. Pending period lock should be held by caller.
+ */
+static void PurgePendingPeriods()
+{
+   Iterator<PendingRollupPeriod> *it = s_pendingPeriods.iterator();
+   bool first = true;
+   while(it->hasNext())
+   {
+      PendingRollupPeriod *p = it->next();
+      if ((p->queued == 0) && (p->committed == 0) && (p->flushing == 0))
+      {
+         it->remove();
+      }
+      else if (first || (p->periodStart < s_oldestPendingPeriod))
+      {
+         s_oldestPendingPeriod = p->periodStart;
+         first = false;
+      }
+   }
+   delete it;
+}
+
+/**
+ * Add pending value. If value belongs to period before stored flush boundary, boundary is moved
+ * back before value is committed, so that rollups for that period will be rebuilt if server
+ * stops unexpectedly before next flush.
+ */
+static void AddPendingValue(time_t timestamp, bool committed)
+{
+   s_pendingLock.lock();
+   PendingRollupPeriod *p = GetPendingPeriod(timestamp);
+   if (committed)
+      p->committed++;
+   else
+      p->queued++;
+   bool persist = (p->periodStart < s_persistedFlushBoundary);
+   if (persist)
+      s_persistedFlushBoundary = p->periodStart;
+   s_pendingLock.unlock();
+
+   if (persist)
+      PersistFlushBoundary();
+}
+
+/**
+ * Register value queued for writing to raw data (including late values received from agent cache)
+ */
+void RegisterPendingDataRollupValue(time_t timestamp)
+{
+   if (s_tierCount > 0)
+      AddPendingValue(timestamp, false);
+}
+
+/**
+ * Release pending value which was not written to raw data
+ */
+void ReleasePendingDataRollupValue(time_t timestamp)
+{
+   if (s_tierCount == 0)
+      return;
+
+   s_pendingLock.lock();
+   GetPendingPeriod(timestamp)->queued--;
+   s_pendingLock.unlock();
+}
+
+/**
+ * Parse numeric value. Returns false if value is not a number.
+ */
+static bool ParseNumericValue(const TCHAR *value, double *result)
+{
+   TCHAR *eptr;
+   double v = _tcstod(value, &eptr);
+   if ((eptr == value) || (*eptr != 0) || (v != v) || (v - v != 0))
+      return false;   // not a number, NaN, or infinity
+   *result = v;
+   return true;
+}
+
+/**
+ * Get bucket for given DCI and period, creating new one if needed. Shard lock should be held by caller.
+ */
+static RollupBucket *GetBucket(RollupBucketShard *shard, UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass, int tier, time_t timestamp)
+{
+   RollupKey key;
+   key.dciId = dciId;
+   key.tier = tier;
+   key.periodStart = RollupAlignDown(timestamp, s_tiers[tier].resolution);
+   RollupBucket *b = shard->buckets.get(key);
+   if (b == NULL)
+   {
+      b = new RollupBucket();
+      memset(b, 0, sizeof(RollupBucket));
+      b->reset();
+      b->key = key;
+      b->nodeId = nodeId;
+      b->storageClass = storageClass;
+      shard->buckets.set(key, b);
+   }
+   return b;
+}
+
+/**
+ * Update rollups with new value. Should be called after value is committed to database.
+ * Non-numeric values are ignored.
+ */
+void UpdateDataRollups(UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass, time_t timestamp, const TCHAR *value)
+{
+   if (s_tierCount == 0)
+      return;
+
+   double v;
+   if (ParseNumericValue(value, &v))
+   {
+      RollupBucketShard *shard = GetBucketShard(dciId);
+      shard->lock.lock();
+      for(int i = 0; i < s_tierCount; i++)
+      {
+         RollupBucket *b = GetBucket(shard, nodeId, dciId, storageClass, i, timestamp);
+         b->update(v);
+         b->dirty = true;
+      }
+      shard->lock.unlock();
+   }
+
+   // Value stays pending until bucket is flushed (bucket should be updated first, see FlushDataRollups)
+   s_pendingLock.lock();
+   PendingRollupPeriod *p = GetPendingPeriod(timestamp);
+   p->queued--;
+   p->committed++;
+   s_pendingLock.unlock();
+}
+
+/**
+ * Raw data value handler
+ */
+typedef void (*RawValueHandler)(time_t timestamp, double value, void *context);
+
+/**
+ * Read raw numeric values for given DCI within given time range (end time is exclusive).
+ * Values are passed to handler in descending or ascending timestamp order. Non-numeric values are skipped.
+ */
+static bool ReadRawValues(DB_HANDLE hdb, UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass,
+         INT64 from, INT64 to, bool descending, RawValueHandler handler, void *context)
+{
+   StringBuffer query = _T("SELECT idata_timestamp,idata_value FROM ");
+   if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
+   {
+      if (g_dbSyntax == DB_SYNTAX_TSDB)
+      {
+         query.append(_T("idata_sc_"));
+         query.append(DCObject::getStorageClassName(storageClass));
+      }
+      else
+      {
+         query.append(_T("idata"));
+      }
+   }
+   else
+   {
+      query.append(GetDataSelectSource(DCO_TYPE_ITEM, nodeId, static_cast<time_t>(from), static_cast<time_t>(to)));
+   }
+   query.append(_T(" WHERE item_id=? AND idata_timestamp>=? AND idata_timestamp<? ORDER BY idata_timestamp"));
+   if (descending)
+      query.append(_T(" DESC"));
+
+   DB_STATEMENT hStmt = DBPrepare(hdb, query);
+   if (hStmt == NULL)
+      return false;
+
+   DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, dciId);
+   DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, from);
+   DBBind(hStmt, 3, DB_SQLTYPE_INTEGER, to);
+   DB_UNBUFFERED_RESULT hResult = DBSelectPreparedUnbuffered(hStmt);
+   if (hResult == NULL)
+   {
+      DBFreeStatement(hStmt);
+      return false;
+   }
+
+   while(DBFetch(hResult))
+   {
+      TCHAR buffer[MAX_DB_STRING];
+      double value;
+      if (ParseNumericValue(DBGetField(hResult, 1, buffer, MAX_DB_STRING), &value))
+         handler(static_cast<time_t>(DBGetFieldInt64(hResult, 0)), value, context);
+   }
+   DBFreeResult(hResult);
+   DBFreeStatement(hStmt);
+   return true;
+}
+
+/**
+ * Add raw value to aggregate
+ */
+static void AggregateRawValue(time_t timestamp, double value, void *context)
+{
+   static_cast<RollupAggregate*>(context)->update(value);
+}
+
+/**
+ * Read totals of numeric values of given DCI with given timestamp. Should be called before
+ * values are deleted, so that rollups can be adjusted with RemoveFromDataRollups.
+ */
+bool ReadDataRollupDeletionTotals(DB_HANDLE hdb, UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass,
+         time_t timestamp, INT32 *count, double *sum)
+{
+   RollupAggregate totals;
+   totals.reset();
+   if ((s_tierCount > 0) && !ReadRawValues(hdb, nodeId, dciId, storageClass, timestamp, static_cast<INT64>(timestamp) + 1, false, AggregateRawValue, &totals))
+      return false;
+   *count = totals.count;
+   *sum = totals.sum;
+   return true;
+}
+
+/**
+ * Remove deleted values from rollups. Count and sum are adjusted immediately, and minimum and
+ * maximum of affected periods are recalculated from raw data on next flush.
+ */
+void RemoveFromDataRollups(UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass, time_t timestamp, INT32 count, double sum)
+{
+   if ((s_tierCount == 0) || (count == 0))
+      return;
+
+   RollupBucketShard *shard = GetBucketShard(dciId);
+   shard->lock.lock();
+   for(int i = 0; i < s_tierCount; i++)
+   {
+      RollupBucket *b = GetBucket(shard, nodeId, dciId, storageClass, i, timestamp);
+      b->subtract(count, sum);
+      b->storageClass = storageClass;
+      b->resetMinMax = true;
+      b->dirty = true;
+   }
+   shard->lock.unlock();
+   AddPendingValue(timestamp, true);
+   nxlog_debug_tag(DEBUG_TAG, 6, _T("RemoveFromDataRollups(%u): %d values removed from period containing ") INT64_FMT,
+            dciId, count, static_cast<INT64>(timestamp));
+}
+
+/**
+ * Format double value for storing in database
+ */
+static inline const TCHAR *FormatValue(double value, TCHAR *buffer)
+{
+   _sntprintf(buffer, 64, _T("%.15g"), value);
+   return buffer;
+}
+
+/**
+ * Prepared statements for rollup flush
+ */
+struct RollupStatements
+{
+   DB_STATEMENT hSelect;
+   DB_STATEMENT hUpdate;
+   DB_STATEMENT hInsert;
+   DB_STATEMENT hDelete;
+};
+
+/**
+ * Write rollup record. Records for buckets which were not persisted before are merged with
+ * existing database records (left from previous server run or removed bucket). Minimum and
+ * maximum for buckets with deleted values are recalculated from raw data. Adjustments made to
+ * flushed copy of bucket are applied to live bucket as well.
+ */
+static bool WriteRollup(DB_HANDLE hdb, RollupBucket *b, RollupStatements *stmts)
+{
+   RollupAggregate adjustment;
+   adjustment.reset();
+   bool adjust = false;
+
+   bool exist = b->persisted;
+   if (!exist)
+   {
+      DBBind(stmts->hSelect, 1, DB_SQLTYPE_INTEGER, b->key.dciId);
+      DBBind(stmts->hSelect, 2, DB_SQLTYPE_INTEGER, static_cast<INT32>(s_tiers[b->key.tier].resolution));
+      DBBind(stmts->hSelect, 3, DB_SQLTYPE_INTEGER, b->key.periodStart);
+      DB_RESULT hResult = DBSelectPrepared(stmts->hSelect);
+      if (hResult == NULL)
+         return false;
+      if (DBGetNumRows(hResult) > 0)
+      {
+         adjustment.minValue = DBGetFieldDouble(hResult, 0, 0);
+         adjustment.maxValue = DBGetFieldDouble(hResult, 0, 1);
+         adjustment.sum = DBGetFieldDouble(hResult, 0, 2);
+         adjustment.count = DBGetFieldLong(hResult, 0, 3);
+         adjust = true;
+         b->persisted = true;
+         exist = true;
+      }
+      DBFreeResult(hResult);
+   }
+
+   if (b->resetMinMax)
+   {
+      // Raw data includes all values already added to bucket because buckets are updated after commit
+      RollupAggregate raw;
+      raw.reset();
+      if (!ReadRawValues(hdb, b->nodeId, b->key.dciId, b->storageClass, b->key.periodStart,
+               b->key.periodStart + s_tiers[b->key.tier].resolution, false, AggregateRawValue, &raw))
+         return false;
+      adjustment.minValue = raw.minValue;
+      adjustment.maxValue = raw.maxValue;
+      adjust = true;
+   }
+
+   if (adjust)
+   {
+      b->merge(&adjustment);
+
+      RollupBucketShard *shard = GetBucketShard(b->key.dciId);
+      shard->lock.lock();
+      RollupBucket *live = shard->buckets.get(b->key);
+      if (live != NULL)
+         live->merge(&adjustment);
+      shard->lock.unlock();
+   }
+
+   if (b->count <= 0)
+   {
+      // All values for this period were deleted
+      if (exist)
+      {
+         DBBind(stmts->hDelete, 1, DB_SQLTYPE_INTEGER, b->key.dciId);
+         DBBind(stmts->hDelete, 2, DB_SQLTYPE_INTEGER, static_cast<INT32>(s_tiers[b->key.tier].resolution));
+         DBBind(stmts->hDelete, 3, DB_SQLTYPE_INTEGER, b->key.periodStart);
+         if (!DBExecute(stmts->hDelete))
+            return false;
+      }
+
+      RollupBucketShard *shard = GetBucketShard(b->key.dciId);
+      shard->lock.lock();
+      RollupBucket *live = shard->buckets.get(b->key);
+      if (live != NULL)
+         live->persisted = false;
+      shard->lock.unlock();
+      b->persisted = false;
+      return true;
+   }
+
+   TCHAR minValue[64], maxValue[64], sum[64];
+   DB_STATEMENT hStmt = exist ? stmts->hUpdate : stmts->hInsert;
+   int pos = 1;
+   if (!exist)
+   {
+      DBBind(hStmt, pos++, DB_SQLTYPE_INTEGER, b->key.dciId);
+      DBBind(hStmt, pos++, DB_SQLTYPE_INTEGER, static_cast<INT32>(s_tiers[b->key.tier].resolution));
+      DBBind(hStmt, pos++, DB_SQLTYPE_INTEGER, b->key.periodStart);
+      DBBind(hStmt, pos++, DB_SQLTYPE_INTEGER, b->nodeId);
+   }
+   DBBind(hStmt, pos++, DB_SQLTYPE_VARCHAR, FormatValue(b->minValue, minValue), DB_BIND_STATIC);
+   DBBind(hStmt, pos++, DB_SQLTYPE_VARCHAR, FormatValue(b->maxValue, maxValue), DB_BIND_STATIC);
+   DBBind(hStmt, pos++, DB_SQLTYPE_VARCHAR, FormatValue(b->sum, sum), DB_BIND_STATIC);
+   DBBind(hStmt, pos++, DB_SQLTYPE_INTEGER, b->count);
+   if (exist)
+   {
+      DBBind(hStmt, pos++, DB_SQLTYPE_INTEGER, b->key.dciId);
+      DBBind(hStmt, pos++, DB_SQLTYPE_INTEGER, static_cast<INT32>(s_tiers[b->key.tier].resolution));
+      DBBind(hStmt, pos++, DB_SQLTYPE_INTEGER, b->key.periodStart);
+   }
+   return DBExecute(hStmt);
+}
+
+/**
+ * Complete rollup flush. Values included into successful flush are released, and flush boundary
+ * is moved to oldest period with values still pending.
+ */
+static void CompleteFlush(INT64 flushTime, bool success)
+{
+   s_pendingLock.lock();
+   Iterator<PendingRollupPeriod> *it = s_pendingPeriods.iterator();
+   while(it->hasNext())
+   {
+      PendingRollupPeriod *p = it->next();
+      if (!success)
+         p->committed += p->flushing;
+      p->flushing = 0;
+   }
+   delete it;
+   if (success)
+      s_flushedUntil = flushTime;
+   PurgePendingPeriods();
+   INT64 boundary = (s_pendingPeriods.size() > 0) ? std::min(s_oldestPendingPeriod, s_flushedUntil) : s_flushedUntil;
+   boundary = RollupAlignDown(boundary, s_tiers[0].resolution);
+   bool persist = (boundary != s_persistedFlushBoundary);
+   s_persistedFlushBoundary = boundary;
+   s_pendingLock.unlock();
+
+   if (persist)
+      PersistFlushBoundary();
+}
+
+/**
+ * Get rollup flush boundary. All values before that time are included into rollups stored in database.
+ */
+static INT64 GetFlushedUntil()
+{
+   s_pendingLock.lock();
+   INT64 t = (s_pendingPeriods.size() > 0) ? std::min(s_oldestPendingPeriod, s_flushedUntil) : s_flushedUntil;
+   s_pendingLock.unlock();
+   return t;
+}
+
+/**
+ * Write updated buckets to database and remove buckets for periods which are long finished
+ */
+static void FlushDataRollups()
+{
+   INT64 now = time(NULL);
+
+   // Values committed so far are already added to buckets (buckets are updated before values are marked as committed)
+   s_pendingLock.lock();
+   Iterator<PendingRollupPeriod> *pit = s_pendingPeriods.iterator();
+   while(pit->hasNext())
+   {
+      PendingRollupPeriod *p = pit->next();
+      p->flushing += p->committed;
+      p->committed = 0;
+   }
+   delete pit;
+   s_pendingLock.unlock();
+
+   StructArray<RollupBucket> batch(256, 256);
+
+   for(int i = 0; i < ROLLUP_BUCKET_SHARDS; i++)
+   {
+      RollupBucketShard *shard = &s_bucketShards[i];
+      shard->lock.lock();
+      Iterator<RollupBucket> *it = shard->buckets.iterator();
+      while(it->hasNext())
+      {
+         RollupBucket *b = it->next();
+         if (b->dirty)
+         {
+            // Extremes are collected anew from this point and combined with recalculated ones after write
+            if (b->resetMinMax)
+               b->resetExtremes();
+            batch.add(b);
+            b->dirty = false;
+            b->persisted = true;
+            b->resetMinMax = false;
+         }
+         else if (b->key.periodStart + 2 * s_tiers[b->key.tier].resolution < now)
+         {
+            it->remove();
+         }
+      }
+      delete it;
+      shard->lock.unlock();
+   }
+
+   if (batch.isEmpty())
+   {
+      CompleteFlush(now, true);
+      return;
+   }
+
+   nxlog_debug_tag(DEBUG_TAG, 7, _T("%d records in rollup batch"), batch.size());
+   int maxRecords = ConfigReadInt(_T("DBWriter.MaxRecordsPerTransaction"), 1000);
+   bool success = false;
+   DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+   RollupStatements stmts;
+   stmts.hSelect = DBPrepare(hdb, _T("SELECT min_value,max_value,sum_value,value_count FROM idata_rollup WHERE item_id=? AND resolution=? AND period_start=?"), true);
+   stmts.hUpdate = DBPrepare(hdb, _T("UPDATE idata_rollup SET min_value=?,max_value=?,sum_value=?,value_count=? WHERE item_id=? AND resolution=? AND period_start=?"), true);
+   stmts.hInsert = DBPrepare(hdb, _T("INSERT INTO idata_rollup (item_id,resolution,period_start,node_id,min_value,max_value,sum_value,value_count) VALUES (?,?,?,?,?,?,?,?)"), true);
+   stmts.hDelete = DBPrepare(hdb, _T("DELETE FROM idata_rollup WHERE item_id=? AND resolution=? AND period_start=?"), true);
+   int committed = 0;
+   if ((stmts.hSelect != NULL) && (stmts.hUpdate != NULL) && (stmts.hInsert != NULL) && (stmts.hDelete != NULL) && DBBegin(hdb))
+   {
+      success = true;
+      for(int i = 0; (i < batch.size()) && success; i++)
+      {
+         success = WriteRollup(hdb, batch.get(i), &stmts);
+         if (success && ((i + 1) % maxRecords == 0))
+         {
+            success = DBCommit(hdb);
+            if (success)
+               committed = i + 1;
+            success = success && DBBegin(hdb);
+         }
+      }
+      if (success)
+         success = DBCommit(hdb);
+      else
+         DBRollback(hdb);
+   }
+   if (stmts.hSelect != NULL)
+      DBFreeStatement(stmts.hSelect);
+   if (stmts.hUpdate != NULL)
+      DBFreeStatement(stmts.hUpdate);
+   if (stmts.hInsert != NULL)
+      DBFreeStatement(stmts.hInsert);
+   if (stmts.hDelete != NULL)
+      DBFreeStatement(stmts.hDelete);
+   DBConnectionPoolReleaseConnection(hdb);
+
+   CompleteFlush(now, success);
+   if (!success)
+   {
+      // Buckets which were not committed will be written again on next flush
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("Rollup batch write failed (%d of %d records committed)"), committed, batch.size());
+      for(int i = committed; i < batch.size(); i++)
+      {
+         RollupBucket *b = batch.get(i);
+         RollupBucketShard *shard = GetBucketShard(b->key.dciId);
+         shard->lock.lock();
+         RollupBucket *live = shard->buckets.get(b->key);
+         if (live != NULL)
+         {
+            live->dirty = true;
+            live->persisted = b->persisted;
+            if (b->resetMinMax)
+               live->resetMinMax = true;
+         }
+         shard->lock.unlock();
+      }
+   }
+}
+
+/**
+ * Rollup writer thread
+ */
+static THREAD_RESULT THREAD_CALL RollupWriterThread(void *arg)
+{
+   ThreadSetName("DBWriter/Rollup");
+   while(!SleepAndCheckForShutdown(ROLLUP_FLUSH_INTERVAL))
+   {
+      FlushDataRollups();
+   }
+   FlushDataRollups();
+   nxlog_debug_tag(DEBUG_TAG, 1, _T("Data rollup writer stopped"));
+   return THREAD_OK;
+}
+
+/**
+ * Stop rollup writer and flush remaining data
+ */
+void StopDataRollupWriter()
+{
+   ThreadJoin(s_writerThread);
+   s_writerThread = INVALID_THREAD_HANDLE;
+
+   // Data writers are already stopped, so there will be no new values
+   if (s_tierCount == 0)
+      return;
+   s_pendingLock.lock();
+   bool clean = (s_pendingPeriods.size() == 0);
+   s_pendingLock.unlock();
+   if (clean)
+      MetaDataWriteInt32(_T("DataRollupFlushBoundary"), 0);
+}
+
+/**
+ * Remove buckets from given shard for given DCI (or all DCIs of given node if DCI ID is 0)
+ */
+static void RemoveBuckets(RollupBucketShard *shard, UINT32 nodeId, UINT32 dciId)
+{
+   shard->lock.lock();
+   Iterator<RollupBucket> *it = shard->buckets.iterator();
+   while(it->hasNext())
+   {
+      RollupBucket *b = it->next();
+      if ((dciId != 0) ? (b->key.dciId == dciId) : (b->nodeId == nodeId))
+         it->remove();
+   }
+   delete it;
+   shard->lock.unlock();
+}
+
+/**
+ * Remove buckets for given DCI (or all DCIs of given node if DCI ID is 0)
+ */
+static void RemoveBuckets(UINT32 nodeId, UINT32 dciId)
+{
+   if (dciId != 0)
+   {
+      RemoveBuckets(GetBucketShard(dciId), nodeId, dciId);
+   }
+   else
+   {
+      for(int i = 0; i < ROLLUP_BUCKET_SHARDS; i++)
+         RemoveBuckets(&s_bucketShards[i], nodeId, 0);
+   }
+}
+
+/**
+ * Delete rollup data for given DCI (or all DCIs of given node if DCI ID is 0)
+ */
+void DeleteDataRollups(UINT32 nodeId, UINT32 dciId)
+{
+   if (s_tierCount == 0)
+      return;
+
+   RemoveBuckets(nodeId, dciId);
+   TCHAR query[256];
+   if (dciId != 0)
+      _sntprintf(query, 256, _T("DELETE FROM idata_rollup WHERE item_id=%u"), dciId);
+   else
+      _sntprintf(query, 256, _T("DELETE FROM idata_rollup WHERE node_id=%u"), nodeId);
+   QueueSQLRequest(query);
+}
+
+/**
+ * Delete expired rollup data
+ */
+void DeleteExpiredDataRollups(DB_HANDLE hdb)
+{
+   UINT32 retentionTime = ConfigReadULong(_T("DataCollection.RollupRetentionTime"), 365);
+   if (retentionTime == 0)
+      return;
+
+   nxlog_debug_tag(DEBUG_TAG, 2, _T("Clearing data rollups (retention time %u days)"), retentionTime);
+   TCHAR query[256];
+   _sntprintf(query, 256, _T("DELETE FROM idata_rollup WHERE period_start<") INT64_FMT, static_cast<INT64>(time(NULL)) - static_cast<INT64>(retentionTime) * 86400);
+   DBQuery(hdb, query);
+}
+
+/**
+ * Read rollup records from given tier for given time range (end time is exclusive).
+ * Records are returned in descending order.
+ */
+static DB_RESULT ReadRollups(DB_HANDLE hdb, UINT32 dciId, int tier, INT64 from, INT64 to)
+{
+   DB_STATEMENT hStmt = DBPrepare(hdb, _T("SELECT period_start,min_value,max_value,sum_value,value_count FROM idata_rollup WHERE item_id=? AND resolution=? AND period_start>=? AND period_start<? ORDER BY period_start DESC"));
+   if (hStmt == NULL)
+      return NULL;
+
+   DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, dciId);
+   DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, static_cast<INT32>(s_tiers[tier].resolution));
+   DBBind(hStmt, 3, DB_SQLTYPE_INTEGER, from);
+   DBBind(hStmt, 4, DB_SQLTYPE_INTEGER, to);
+   DB_RESULT hResult = DBSelectPrepared(hStmt);
+   DBFreeStatement(hStmt);
+   return hResult;
+}
+
+/**
+ * Context for range aggregation
+ */
+struct AggregationContext
+{
+   DB_HANDLE hdb;
+   UINT32 nodeId;
+   UINT32 dciId;
+   DCObjectStorageClass storageClass;
+   RollupAggregate result;
+};
+
+/**
+ * Aggregate range segment either from rollup tier or from raw data
+ */
+static bool AggregateSegment(int tier, INT64 from, INT64 to, void *ctx)
+{
+   AggregationContext *context = static_cast<AggregationContext*>(ctx);
+   if (tier == -1)
+      return ReadRawValues(context->hdb, context->nodeId, context->dciId, context->storageClass, from, to, false, AggregateRawValue, &context->result);
+
+   DB_RESULT hResult = ReadRollups(context->hdb, context->dciId, tier, from, to);
+   if (hResult == NULL)
+      return false;
+   int count = DBGetNumRows(hResult);
+   for(int i = 0; i < count; i++)
+   {
+      RollupAggregate a;
+      a.minValue = DBGetFieldDouble(hResult, i, 1);
+      a.maxValue = DBGetFieldDouble(hResult, i, 2);
+      a.sum = DBGetFieldDouble(hResult, i, 3);
+      a.count = DBGetFieldLong(hResult, i, 4);
+      context->result.merge(&a);
+   }
+   DBFreeResult(hResult);
+   nxlog_debug_tag(DEBUG_TAG, 7, _T("AggregateSegment(%u): %d records from tier ") INT64_FMT _T(" for range ") INT64_FMT _T("..") INT64_FMT,
+            context->dciId, count, s_tiers[tier].resolution, from, to);
+   return true;
+}
+
+/**
+ * Get aggregated value of DCI for given period (both ends inclusive) using rollup data where possible.
+ * Only minimum, maximum, average, and sum are supported.
+ *
+ * @return dynamically allocated value or NULL on error or if there are no values in given period
+ */
+TCHAR *GetDataRollupAggregateValue(UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass,
+         AggregationFunction func, time_t periodStart, time_t periodEnd)
+{
+   AggregationContext context;
+   context.nodeId = nodeId;
+   context.dciId = dciId;
+   context.storageClass = storageClass;
+   context.result.reset();
+
+   context.hdb = DBConnectionPoolAcquireConnection();
+   bool success = SplitRollupRange(s_tiers, s_tierCount - 1, periodStart, static_cast<INT64>(periodEnd) + 1,
+            GetFlushedUntil(), AggregateSegment, &context);
+   DBConnectionPoolReleaseConnection(context.hdb);
+
+   if (!success || (context.result.count <= 0))
+      return NULL;
+
+   double value;
+   switch(func)
+   {
+      case DCI_AGG_MIN:
+         value = context.result.minValue;
+         break;
+      case DCI_AGG_MAX:
+         value = context.result.maxValue;
+         break;
+      case DCI_AGG_AVG:
+         value = context.result.sum / context.result.count;
+         break;
+      default:
+         value = context.result.sum;
+         break;
+   }
+
+   TCHAR buffer[64];
+   if ((value == floor(value)) && (fabs(value) < 1e15))
+      _sntprintf(buffer, 64, INT64_FMT, static_cast<INT64>(value));
+   else
+      _sntprintf(buffer, 64, _T("%f"), value);
+   return MemCopyString(buffer);
+}
+
+/**
+ * Context for reading raw values into series
+ */
+struct SeriesContext
+{
+   StructArray<DciValue> *values;
+   int maxRows;
+};
+
+/**
+ * Add raw value to series
+ */
+static void AddRawValueToSeries(time_t timestamp, double value, void *context)
+{
+   SeriesContext *c = static_cast<SeriesContext*>(context);
+   if (c->values->size() < c->maxRows)
+   {
+      DciValue v;
+      v.timestamp = timestamp;
+      v.value = value;
+      c->values->add(&v);
+   }
+}
+
+/**
+ * Get DCI value series for given time range (both ends inclusive) from rollup data. Rollups are
+ * used only when range contains more raw values than requested. Finest tier which fits
+ * into requested number of rows is used, and values outside complete rollup periods are
+ * read from raw data. Each rollup period is represented by average value with timestamp of
+ * period start. Values are returned in descending timestamp order.
+ *
+ * @return series or NULL if rollup data should not be used for this request
+ */
+StructArray<DciValue> *GetDataRollupSeries(UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass,
+         time_t timeFrom, time_t timeTo, int pollingInterval, int maxRows)
+{
+   if ((s_tierCount == 0) || (timeFrom == 0) || (maxRows <= 0))
+      return NULL;
+
+   INT64 from = timeFrom;
+   INT64 to = (timeTo != 0) ? static_cast<INT64>(timeTo) + 1 : static_cast<INT64>(time(NULL)) + 1;
+   if ((from >= to) || ((to - from) / std::max(pollingInterval, 1) <= maxRows))
+      return NULL;   // raw data fits into requested number of rows
+
+   int tier = SelectRollupTier(s_tiers, s_tierCount, to - from, maxRows);
+   INT64 resolution = s_tiers[tier].resolution;
+   INT64 start = RollupAlignUp(std::max(from, s_tiers[tier].coverageStart), resolution);
+   INT64 end = RollupAlignDown(std::min(to, GetFlushedUntil()), resolution);
+   if (start >= end)
+      return NULL;
+
+   SeriesContext context;
+   context.values = new StructArray<DciValue>(maxRows);
+   context.maxRows = maxRows;
+
+   DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+   bool success = ReadRawValues(hdb, nodeId, dciId, storageClass, end, to, true, AddRawValueToSeries, &context);
+   if (success && (context.values->size() < maxRows))
+   {
+      DB_RESULT hResult = ReadRollups(hdb, dciId, tier, start, end);
+      if (hResult != NULL)
+      {
+         int count = DBGetNumRows(hResult);
+         for(int i = 0; (i < count) && (context.values->size() < maxRows); i++)
+         {
+            INT32 valueCount = DBGetFieldLong(hResult, i, 4);
+            if (valueCount <= 0)
+               continue;
+            DciValue v;
+            v.timestamp = static_cast<time_t>(DBGetFieldInt64(hResult, i, 0));
+            v.value = DBGetFieldDouble(hResult, i, 3) / valueCount;
+            context.values->add(&v);
+         }
+         DBFreeResult(hResult);
+      }
+      else
+      {
+         success = false;
+      }
+   }
+   if (success && (context.values->size() < maxRows))
+      success = ReadRawValues(hdb, nodeId, dciId, storageClass, from, start, true, AddRawValueToSeries, &context);
+   DBConnectionPoolReleaseConnection(hdb);
+
+   if (!success)
+   {
+      delete context.values;
+      return NULL;
+   }
+
+   nxlog_debug_tag(DEBUG_TAG, 6, _T("GetDataRollupSeries(%u): %d values using tier ") INT64_FMT, dciId, context.values->size(), resolution);
+   return context.values;
+}
+
+/**
+ * Context for rollup rebuild
+ */
+struct RebuildContext
+{
+   DB_STATEMENT hStmt;
+   UINT32 nodeId;
+   RollupBucket buckets[MAX_ROLLUP_TIERS];
+   INT64 rebuildFrom[MAX_ROLLUP_TIERS];
+   bool success;
+};
+
+/**
+ * Write bucket during rebuild
+ */
+static void WriteRebuiltBucket(RebuildContext *context, RollupBucket *b)
+{
+   if ((b->count == 0) || !context->success)
+      return;
+
+   TCHAR minValue[64], maxValue[64], sum[64];
+   DBBind(context->hStmt, 1, DB_SQLTYPE_INTEGER, b->key.dciId);
+   DBBind(context->hStmt, 2, DB_SQLTYPE_INTEGER, static_cast<INT32>(s_tiers[b->key.tier].resolution));
+   DBBind(context->hStmt, 3, DB_SQLTYPE_INTEGER, b->key.periodStart);
+   DBBind(context->hStmt, 4, DB_SQLTYPE_INTEGER, context->nodeId);
+   DBBind(context->hStmt, 5, DB_SQLTYPE_VARCHAR, FormatValue(b->minValue, minValue), DB_BIND_STATIC);
+   DBBind(context->hStmt, 6, DB_SQLTYPE_VARCHAR, FormatValue(b->maxValue, maxValue), DB_BIND_STATIC);
+   DBBind(context->hStmt, 7, DB_SQLTYPE_VARCHAR, FormatValue(b->sum, sum), DB_BIND_STATIC);
+   DBBind(context->hStmt, 8, DB_SQLTYPE_INTEGER, b->count);
+   context->success = DBExecute(context->hStmt);
+}
+
+/**
+ * Add raw value to rebuilt rollups
+ */
+static void RebuildRawValue(time_t timestamp, double value, void *ctx)
+{
+   RebuildContext *context = static_cast<RebuildContext*>(ctx);
+   for(int i = 0; i < s_tierCount; i++)
+   {
+      RollupBucket *b = &context->buckets[i];
+      INT64 periodStart = RollupAlignDown(timestamp, s_tiers[i].resolution);
+      if ((periodStart < s_tiers[i].coverageStart) || (periodStart < context->rebuildFrom[i]))
+         continue;
+      if (b->key.periodStart != periodStart)
+      {
+         WriteRebuiltBucket(context, b);
+         b->key.periodStart = periodStart;
+         b->reset();
+      }
+      b->update(value);
+   }
+}
+
+/**
+ * Rebuild rollups for given DCI from raw data for all periods starting at given time or later.
+ * Raw data is read via provided connection while new records are written via separate one.
+ */
+static bool RebuildDataRollups(DB_HANDLE hdb, UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass, INT64 since)
+{
+   RebuildContext context;
+   memset(&context, 0, sizeof(RebuildContext));
+   context.nodeId = nodeId;
+   context.success = true;
+   INT64 readFrom = since;
+   for(int i = 0; i < s_tierCount; i++)
+   {
+      context.buckets[i].reset();
+      context.buckets[i].key.dciId = dciId;
+      context.buckets[i].key.tier = i;
+      context.buckets[i].key.periodStart = -1;
+      context.rebuildFrom[i] = RollupAlignDown(since, s_tiers[i].resolution);
+      readFrom = std::min(readFrom, context.rebuildFrom[i]);
+   }
+
+   DB_HANDLE hdbWrite = DBConnectionPoolAcquireConnection();
+   if (!DBBegin(hdbWrite))
+   {
+      DBConnectionPoolReleaseConnection(hdbWrite);
+      return false;
+   }
+
+   // Old records are deleted within same transaction, so they are kept if rebuild fails
+   bool success = true;
+   for(int i = 0; (i < s_tierCount) && success; i++)
+   {
+      TCHAR query[256];
+      _sntprintf(query, 256, _T("DELETE FROM idata_rollup WHERE item_id=%u AND resolution=%d AND period_start>=") INT64_FMT,
+               dciId, static_cast<int>(s_tiers[i].resolution), context.rebuildFrom[i]);
+      success = DBQuery(hdbWrite, query);
+   }
+
+   if (success)
+   {
+      context.hStmt = DBPrepare(hdbWrite, _T("INSERT INTO idata_rollup (item_id,resolution,period_start,node_id,min_value,max_value,sum_value,value_count) VALUES (?,?,?,?,?,?,?,?)"), true);
+      success = (context.hStmt != NULL);
+   }
+   if (success)
+   {
+      success = ReadRawValues(hdb, nodeId, dciId, storageClass, readFrom, time(NULL) + 1, false, RebuildRawValue, &context);
+      for(int i = 0; i < s_tierCount; i++)
+         WriteRebuiltBucket(&context, &context.buckets[i]);
+      success = success && context.success;
+      DBFreeStatement(context.hStmt);
+   }
+
+   if (success)
+      success = DBCommit(hdbWrite);
+   else
+      DBRollback(hdbWrite);
+   DBConnectionPoolReleaseConnection(hdbWrite);
+   return success;
+}
+
+/**
+ * Rebuild rollups for given DCI from raw data (used after DCI values were changed by recalculation).
+ */
+bool RebuildDataRollups(DB_HANDLE hdb, UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass)
+{
+   if (s_tierCount == 0)
+      return true;
+
+   RemoveBuckets(nodeId, dciId);
+   bool success = RebuildDataRollups(hdb, nodeId, dciId, storageClass, 0);
+   nxlog_debug_tag(DEBUG_TAG, 4, _T("Rollup data for DCI [%u] %s"), dciId, success ? _T("rebuilt") : _T("rebuild failed"));
+   return success;
+}
@@ -22,6 +22,80 @@
 
 #include "nxcore.h"
 
+/**
+ * Summary table query cache key
+ */
+struct SummaryTableCacheKey
+{
+   INT32 tableId;
+   UINT32 objectId;
+   UINT32 userId;
+};
+
+/**
+ * Summary table query cache entry. Entry is placed into cache before evaluation starts, so
+ * concurrent identical queries wait for single evaluation instead of starting their own.
+ */
+class SummaryTableCacheEntry : public RefCountObject
+{
+protected:
+   virtual ~SummaryTableCacheEntry() { delete data; }
+
+public:
+   LONG tableId;
+   Table *data;
+   UINT32 rcc;
+   time_t timestamp;
+   bool ready;
+   Condition completed;
+
+   SummaryTableCacheEntry(LONG _tableId) : RefCountObject(), completed(true)
+   {
+      tableId = _tableId;
+      data = NULL;
+      rcc = RCC_SUCCESS;
+      timestamp = 0;
+      ready = false;
+   }
+};
+
+/**
+ * Summary table query cache
+ */
+static RefCountHashMap<SummaryTableCacheKey, SummaryTableCacheEntry> s_cache(Ownership::True);
+static Mutex s_cacheLock;
+
+/**
+ * Remove expired entries from summary table query cache. Cache lock must be held by caller.
+ */
+static void PurgeSummaryTableCache(time_t now, int cacheTime)
+{
+   Iterator<SummaryTableCacheEntry> *it = s_cache.iterator();
+   while(it->hasNext())
+   {
+      SummaryTableCacheEntry *entry = it->next();
+      if (entry->ready && (entry->timestamp + cacheTime <= now))
+         it->remove();
+   }
+   delete it;
+}
+
+/**
+ * Remove all cached results for given summary table
+ */
+static void InvalidateSummaryTableCache(LONG tableId)
+{
+   s_cacheLock.lock();
+   Iterator<SummaryTableCacheEntry> *it = s_cache.iterator();
+   while(it->hasNext())
+   {
+      if (it->next()->tableId == tableId)
+         it->remove();
+   }
+   delete it;
+   s_cacheLock.unlock();
+}
+
 /**
  * Modify DCI summary table. Will create new table if id is 0.
  *
@@ -67,7 +141,10 @@ UINT32 ModifySummaryTable(NXCPMessage *msg, LONG *newId)
 
       rcc = DBExecute(hStmt) ? RCC_SUCCESS : RCC_DB_FAILURE;
       if (rcc == RCC_SUCCESS)
+      {
+         InvalidateSummaryTableCache(id);
          NotifyClientSessions(NX_NOTIFY_DCISUMTBL_CHANGED, (UINT32)id);
+      }
 
       DBFreeStatement(hStmt);
    }
@@ -94,6 +171,7 @@ UINT32 DeleteSummaryTable(LONG tableId)
       if (DBExecute(hStmt))
       {
          rcc = RCC_SUCCESS;
+         InvalidateSummaryTableCache(tableId);
          NotifyClientSessions(NX_NOTIFY_DCISUMTBL_DELETED, (UINT32)tableId);
       }
       DBFreeStatement(hStmt);
@@ -228,7 +306,7 @@ SummaryTable::SummaryTable(INT32 id, DB_RESULT hResult)
       if (*m_filterSource != 0)
       {
          TCHAR errorText[1024];
-         m_filter = NXSLCompileAndCreateVM(m_filterSource, errorText, 1024, new NXSL_ServerEnv);
+         m_filter = NXSLCompile(m_filterSource, errorText, 1024, NULL);
          if (m_filter == NULL)
          {
             nxlog_debug(4, _T("Error compiling filter script for DCI summary table: %s"), errorText);
@@ -318,18 +396,37 @@ SummaryTable::~SummaryTable()
 }
 
 /**
- * Pass node through filter
+ * Create VM for filter script. Compiled script is shared, so each thread evaluating
+ * this table should use its own VM. Returns NULL if table has no filter.
  */
-bool SummaryTable::filter(DataCollectionTarget *object)
+NXSL_VM *SummaryTable::createFilterVM()
 {
    if (m_filter == NULL)
+      return NULL;
+
+   NXSL_VM *vm = new NXSL_VM(new NXSL_ServerEnv());
+   if (!vm->load(m_filter))
+   {
+      nxlog_debug(4, _T("Error loading filter script for DCI summary table: %s"), vm->getErrorText());
+      delete vm;
+      return NULL;
+   }
+   return vm;
+}
+
+/**
+ * Pass node through filter using given VM (created by createFilterVM)
+ */
+bool SummaryTable::filter(DataCollectionTarget *object, NXSL_VM *vm)
+{
+   if (vm == NULL)
       return true;   // no filtering
 
    bool result = true;
-   SetupServerScriptVM(m_filter, object, NULL);
-   if (m_filter->run())
+   SetupServerScriptVM(vm, object, NULL);
+   if (vm->run())
    {
-      NXSL_Value *value = m_filter->getResult();
+      NXSL_Value *value = vm->getResult();
       if (value != NULL)
       {
          result = value->getValueAsBoolean();
@@ -337,7 +434,7 @@ bool SummaryTable::filter(DataCollectionTarget *object)
    }
    else
    {
-      nxlog_debug(4, _T("Error executing filter script for DCI summary table: %s"), m_filter->getErrorText());
+      nxlog_debug(4, _T("Error executing filter script for DCI summary table: %s"), vm->getErrorText());
    }
    return result;
 }
@@ -393,6 +490,253 @@ void SummaryTable::createExportRecord(StringBuffer &xml) const
    xml.append(_T("\t\t\t</columns>\n\t\t</table>\n"));
 }
 
+/**
+ * Maximum number of additional pool tasks used to evaluate single summary table query
+ */
+#define MAX_SUMMARY_TABLE_WORKERS   7
+
+/**
+ * Summary table evaluation state shared between calling thread and worker tasks. Each target
+ * is evaluated into its own partial result table, so workers do not need any synchronization
+ * except for picking next target.
+ */
+class SummaryTableEvaluation : public RefCountObject
+{
+private:
+   SummaryTable *m_tableDefinition;
+   ObjectArray<DataCollectionTarget> *m_targets;
+   UINT32 m_userId;
+   int m_count;
+   Table **m_results;
+   VolatileCounter m_nextTarget;
+   VolatileCounter m_pendingTargets;
+   Condition m_completed;
+
+protected:
+   virtual ~SummaryTableEvaluation();
+
+public:
+   SummaryTableEvaluation(SummaryTable *tableDefinition, ObjectArray<DataCollectionTarget> *targets, UINT32 userId);
+
+   void process();
+   void waitForCompletion() { m_completed.wait(INFINITE); }
+   Table *mergeResults();
+};
+
+/**
+ * Summary table evaluation constructor
+ */
+SummaryTableEvaluation::SummaryTableEvaluation(SummaryTable *tableDefinition, ObjectArray<DataCollectionTarget> *targets, UINT32 userId) :
+         RefCountObject(), m_completed(true)
+{
+   m_tableDefinition = tableDefinition;
+   m_targets = targets;
+   m_userId = userId;
+   m_count = targets->size();
+   m_results = MemAllocArray<Table*>(std::max(m_count, 1));
+   m_nextTarget = 0;
+   m_pendingTargets = m_count;
+   if (m_count == 0)
+      m_completed.set();
+}
+
+/**
+ * Summary table evaluation destructor
+ */
+SummaryTableEvaluation::~SummaryTableEvaluation()
+{
+   for(int i = 0; i < m_count; i++)
+      delete m_results[i];
+   MemFree(m_results);
+}
+
+/**
+ * Evaluate targets until none left. Can be called concurrently from multiple threads. Table definition
+ * and target list are only accessed after successful target pick, so late starting workers are safe
+ * even if calling thread already completed evaluation.
+ */
+void SummaryTableEvaluation::process()
+{
+   NXSL_VM *vm = NULL;
+   bool vmCreated = false;
+   while(true)
+   {
+      int index = InterlockedIncrement(&m_nextTarget) - 1;
+      if (index >= m_count)
+         break;
+
+      if (!vmCreated)
+      {
+         vm = m_tableDefinition->createFilterVM();
+         vmCreated = true;
+      }
+
+      DataCollectionTarget *target = m_targets->get(index);
+      if (m_tableDefinition->filter(target, vm))
+      {
+         Table *partialResult = m_tableDefinition->createEmptyResultTable();
+         target->getDciValuesSummary(m_tableDefinition, partialResult, m_userId);
+         m_results[index] = partialResult;
+      }
+
+      if (InterlockedDecrement(&m_pendingTargets) == 0)
+         m_completed.set();
+   }
+   delete vm;
+}
+
+/**
+ * Merge partial results in target order
+ */
+Table *SummaryTableEvaluation::mergeResults()
+{
+   Table *result = m_tableDefinition->createEmptyResultTable();
+   bool tableDciSource = m_tableDefinition->isTableDciSource();
+   for(int i = 0; i < m_count; i++)
+   {
+      Table *partialResult = m_results[i];
+      if (partialResult == NULL)
+         continue;
+
+      // Column set is fixed for single value DCI source, but column names may be not unique,
+      // so rows are copied by position; for table DCI source columns are matched by name
+      if (!tableDciSource)
+      {
+         for(int c = 0; c < partialResult->getNumColumns(); c++)
+         {
+            INT32 dataType = partialResult->getColumnDataType(c);
+            if (dataType != DCI_DT_STRING)
+               result->setColumnDataType(c, dataType);
+         }
+      }
+
+      int offset = result->getNumRows();
+      for(int r = 0; r < partialResult->getNumRows(); r++)
+      {
+         int row = tableDciSource ? result->mergeRow(partialResult, r) : result->copyRow(partialResult, r);
+         result->setObjectIdAt(row, partialResult->getObjectId(r));
+         int baseRow = partialResult->getBaseRow(r);
+         if (baseRow != -1)
+            result->setBaseRowAt(row, baseRow + offset);
+      }
+   }
+   return result;
+}
+
+/**
+ * Summary table evaluation worker
+ */
+static void SummaryTableEvaluationWorker(SummaryTableEvaluation *evaluation)
+{
+   evaluation->process();
+   evaluation->decRefCount();
+}
+
+/**
+ * Evaluate summary table for all data collection targets under given object. Targets are
+ * distributed between calling thread and tasks in main thread pool; calling thread
+ * participates in evaluation, so query completes even if thread pool is saturated.
+ */
+static Table *EvaluateSummaryTable(SummaryTable *tableDefinition, NetObj *object, UINT32 userId)
+{
+   ObjectArray<NetObj> *childObjects = object->getAllChildren(true, true);
+   ObjectArray<DataCollectionTarget> targets(childObjects->size(), 64, Ownership::False);
+   for(int i = 0; i < childObjects->size(); i++)
+   {
+      NetObj *obj = childObjects->get(i);
+      if (obj->isDataCollectionTarget() && obj->checkAccessRights(userId, OBJECT_ACCESS_READ))
+         targets.add(static_cast<DataCollectionTarget*>(obj));
+      else
+         obj->decRefCount();
+   }
+   delete childObjects;
+
+   SummaryTableEvaluation *evaluation = new SummaryTableEvaluation(tableDefinition, &targets, userId);
+   int workers = std::min(targets.size() - 1, MAX_SUMMARY_TABLE_WORKERS);
+   for(int i = 0; i < workers; i++)
+   {
+      evaluation->incRefCount();
+      ThreadPoolExecute(g_mainThreadPool, SummaryTableEvaluationWorker, evaluation);
+   }
+   evaluation->process();
+   evaluation->waitForCompletion();
+
+   Table *result = evaluation->mergeResults();
+   evaluation->decRefCount();
+
+   for(int i = 0; i < targets.size(); i++)
+      targets.get(i)->decRefCount();
+
+   return result;
+}
+
+/**
+ * Query stored summary table using result cache
+ */
+static Table *QueryCachedSummaryTable(LONG tableId, NetObj *object, UINT32 userId, int cacheTime, UINT32 *rcc)
+{
+   SummaryTableCacheKey key;
+   memset(&key, 0, sizeof(key));
+   key.tableId = tableId;
+   key.objectId = object->getId();
+   key.userId = userId;
+
+   time_t now = time(NULL);
+   s_cacheLock.lock();
+   SummaryTableCacheEntry *entry = s_cache.get(key);
+   if ((entry != NULL) && entry->ready && (entry->timestamp + cacheTime <= now))
+   {
+      s_cache.remove(key);
+      entry->decRefCount();
+      entry = NULL;
+   }
+   bool owner = (entry == NULL);
+   if (owner)
+   {
+      PurgeSummaryTableCache(now, cacheTime);
+      entry = new SummaryTableCacheEntry(tableId);
+      s_cache.set(key, entry);
+   }
+   s_cacheLock.unlock();
+
+   if (owner)
+   {
+      SummaryTable *tableDefinition = SummaryTable::loadFromDB(tableId, &entry->rcc);
+      if (tableDefinition != NULL)
+      {
+         entry->data = EvaluateSummaryTable(tableDefinition, object, userId);
+         delete tableDefinition;
+      }
+
+      s_cacheLock.lock();
+      entry->timestamp = time(NULL);
+      entry->ready = true;
+      if ((entry->data == NULL) && (s_cache.peek(key) == entry))
+         s_cache.remove(key);   // Do not cache failures
+      s_cacheLock.unlock();
+      entry->completed.set();
+   }
+   else
+   {
+      nxlog_debug(6, _T("QuerySummaryTable: using shared result for table %d object %u user %u"), tableId, key.objectId, userId);
+      entry->completed.wait(INFINITE);
+   }
+
+   Table *result;
+   if (entry->data != NULL)
+   {
+      result = new Table(entry->data);
+      *rcc = RCC_SUCCESS;
+   }
+   else
+   {
+      result = NULL;
+      *rcc = entry->rcc;
+   }
+   entry->decRefCount();
+   return result;
+}
+
 /**
  * Query summary table. If ad-hoc definition is provided it will be deleted by this function.
  */
@@ -420,31 +764,17 @@ Table *QuerySummaryTable(LONG tableId, SummaryTable *adHocDefinition, UINT32 bas
       return NULL;
    }
 
+   // Only stored tables are cached - ad-hoc definitions are not identifiable between requests
+   int cacheTime = (adHocDefinition == NULL) ? ConfigReadInt(_T("DataCollection.SummaryTableCacheTime"), 0) : 0;
+   if (cacheTime > 0)
+      return QueryCachedSummaryTable(tableId, object, userId, cacheTime, rcc);
+
    SummaryTable *tableDefinition = (adHocDefinition != NULL) ? adHocDefinition : SummaryTable::loadFromDB(tableId, rcc);
    if (tableDefinition == NULL)
       return NULL;
 
-   ObjectArray<NetObj> *childObjects = object->getAllChildren(true, true);
-   Table *tableData = tableDefinition->createEmptyResultTable();
-   for(int i = 0; i < childObjects->size(); i++)
-   {
-      NetObj *obj = childObjects->get(i);
-      if (!obj->isDataCollectionTarget() || !obj->checkAccessRights(userId, OBJECT_ACCESS_READ))
-      {
-         obj->decRefCount();
-         continue;
-      }
-
-      if (tableDefinition->filter((DataCollectionTarget *)obj))
-      {
-         static_cast<DataCollectionTarget*>(obj)->getDciValuesSummary(tableDefinition, tableData, userId);
-      }
-      obj->decRefCount();
-   }
-
-   delete childObjects;
+   Table *tableData = EvaluateSummaryTable(tableDefinition, object, userId);
    delete tableDefinition;
-
    return tableData;
 }
 
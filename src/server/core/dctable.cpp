@@ -296,9 +296,9 @@ bool DCTable::deleteAllData()
    }
    else
    {
-      _sntprintf(query, 256, _T("DELETE FROM tdata_%u WHERE item_id=%u"), m_owner->getId(), m_id);
+      _sntprintf(query, 256, _T("item_id=%u"), m_id);
    }
-	bool success = DBQuery(hdb, query);
+	bool success = (g_flags & AF_SINGLE_TABLE_PERF_DATA) ? DBQuery(hdb, query) : DeleteFromDataPartitions(hdb, DCO_TYPE_TABLE, m_owner->getId(), query, 0, 0);
    unlock();
 
    DBConnectionPoolReleaseConnection(hdb);
@@ -328,9 +328,9 @@ bool DCTable::deleteEntry(time_t timestamp)
    }
    else
    {
-      _sntprintf(query, 256, _T("DELETE FROM tdata_%u WHERE item_id=%u AND tdata_timestamp=%u"), m_owner->getId(), m_id, (UINT32)timestamp);
+      _sntprintf(query, 256, _T("item_id=%u AND tdata_timestamp=%u"), m_id, (UINT32)timestamp);
    }
-   bool success = DBQuery(hdb, query);
+   bool success = (g_flags & AF_SINGLE_TABLE_PERF_DATA) ? DBQuery(hdb, query) : DeleteFromDataPartitions(hdb, DCO_TYPE_TABLE, m_owner->getId(), query, timestamp, timestamp);
    unlock();
 
    DBConnectionPoolReleaseConnection(hdb);
@@ -398,6 +398,7 @@ bool DCTable::processNewValue(time_t timestamp, void *value, bool *updateStatus)
 
       bool success = false;
 	   Table *data = static_cast<Table*>(value);
+      StructArray<NewDataPartition> newPartitions(0, 4);
 
 	   DB_STATEMENT hStmt;
 	   if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
@@ -416,9 +417,17 @@ bool DCTable::processNewValue(time_t timestamp, void *value, bool *updateStatus)
 	   }
 	   else
 	   {
-	      TCHAR query[256];
-	      _sntprintf(query, 256, _T("INSERT INTO tdata_%u (item_id,tdata_timestamp,tdata_value) VALUES (?,?,?)"), nodeId);
-	      hStmt = DBPrepare(hdb, query);
+	      TCHAR table[64];
+	      if (GetDataInsertTable(hdb, DCO_TYPE_TABLE, nodeId, timestamp, table, 64, &newPartitions))
+	      {
+	         TCHAR query[256];
+	         _sntprintf(query, 256, _T("INSERT INTO %s (item_id,tdata_timestamp,tdata_value) VALUES (?,?,?)"), table);
+	         hStmt = DBPrepare(hdb, query);
+	      }
+	      else
+	      {
+	         hStmt = NULL;
+	      }
 	   }
 	   if (hStmt != NULL)
 	   {
@@ -430,9 +439,15 @@ bool DCTable::processNewValue(time_t timestamp, void *value, bool *updateStatus)
 	   }
 
       if (success)
-         DBCommit(hdb);
+      {
+         CompleteDataPartitionCreation(&newPartitions, DBCommit(hdb));
+      }
       else
+      {
          DBRollback(hdb);
+         CompleteDataPartitionCreation(&newPartitions, false);
+         ResetDataPartitionCache();
+      }
 
 	   DBConnectionPoolReleaseConnection(hdb);
    }
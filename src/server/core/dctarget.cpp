@@ -55,6 +55,9 @@ DataCollectionTarget::DataCollectionTarget() : super(), m_statusPollState(_T("st
    m_scriptErrorReports = new StringMap();
    m_hPollerMutex = MutexCreate();
    m_proxyLoadFactor = 0;
+   m_dciConfigGeneration = 0;
+   m_userSpecificDataGeneration = -1;
+   m_hasUserSpecificData = false;
 }
 
 /**
@@ -68,6 +71,9 @@ DataCollectionTarget::DataCollectionTarget(const TCHAR *name) : super(name), m_s
    m_scriptErrorReports = new StringMap();
    m_hPollerMutex = MutexCreate();
    m_proxyLoadFactor = 0;
+   m_dciConfigGeneration = 0;
+   m_userSpecificDataGeneration = -1;
+   m_hasUserSpecificData = false;
 }
 
 /**
@@ -89,7 +95,11 @@ bool DataCollectionTarget::deleteFromDatabase(DB_HANDLE hdb)
    bool success = executeQueryOnObject(hdb, _T("DELETE FROM dct_node_map WHERE node_id=?"));
 
    // TSDB: to avoid heavy query on idata tables let collected data expire instead of deleting it immediately
-   if (success && ((g_dbSyntax != DB_SYNTAX_TSDB) || !(g_flags & AF_SINGLE_TABLE_PERF_DATA)))
+   if (success && IsDataPartitioningEnabled())
+   {
+      QueueDropDataPartitions(m_id);
+   }
+   else if (success && ((g_dbSyntax != DB_SYNTAX_TSDB) || !(g_flags & AF_SINGLE_TABLE_PERF_DATA)))
    {
       TCHAR query[256];
       _sntprintf(query, 256, (g_flags & AF_SINGLE_TABLE_PERF_DATA) ? _T("DELETE FROM idata WHERE item_id IN (SELECT item_id FROM items WHERE node_id=%u)") : _T("DROP TABLE idata_%u"), m_id);
@@ -100,7 +110,10 @@ bool DataCollectionTarget::deleteFromDatabase(DB_HANDLE hdb)
    }
 
    if (success)
+   {
+      DeleteDataRollups(m_id, 0);
       success = super::deleteFromDatabase(hdb);
+   }
 
    return success;
 }
@@ -200,88 +213,75 @@ void DataCollectionTarget::calculateDciCutoffTimes(time_t *cutoffTimeIData, time
 }
 
 /**
- * Clean expired DCI data
+ * Clean expired DCI data. If data partitioning is enabled, partitions containing only records older
+ * than longest retention time are dropped and remaining expired records are deleted only from
+ * partitions which may contain them.
  */
 void DataCollectionTarget::cleanDCIData(DB_HANDLE hdb)
 {
-   StringBuffer queryItems = _T("DELETE FROM idata");
-   if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
-   {
-      queryItems.append(_T(" WHERE node_id="));
-      queryItems.append(m_id);
-      queryItems.append(_T(" AND "));
-   }
-   else
-   {
-      queryItems.append(_T('_'));
-      queryItems.append(m_id);
-      queryItems.append(_T(" WHERE "));
-   }
-
-   StringBuffer queryTables = _T("DELETE FROM tdata");
-   if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
-   {
-      queryTables.append(_T(" WHERE node_id="));
-      queryTables.append(m_id);
-      queryTables.append(_T(" AND "));
-   }
-   else
-   {
-      queryTables.append(_T('_'));
-      queryTables.append(m_id);
-      queryTables.append(_T(" WHERE "));
-   }
-
+   StringBuffer conditionItems, conditionTables;
    int itemCount = 0;
    int tableCount = 0;
    time_t now = time(NULL);
+   time_t dropCutoffItems = now, dropCutoffTables = now;
+   time_t deleteCutoffItems = 0, deleteCutoffTables = 0;
 
    lockDciAccess(false);
    for(int i = 0; i < m_dcObjects->size(); i++)
    {
       DCObject *o = m_dcObjects->get(i);
+      time_t cutoffTime = now - o->getEffectiveRetentionTime() * 86400;
       if (o->getType() == DCO_TYPE_ITEM)
       {
          if (itemCount > 0)
-            queryItems.append(_T(" OR "));
-         queryItems.append(_T("(item_id="));
-         queryItems.append(o->getId());
-         queryItems.append(_T(" AND idata_timestamp<"));
-         queryItems.append((INT64)(now - o->getEffectiveRetentionTime() * 86400));
-         queryItems.append(_T(')'));
+            conditionItems.append(_T(" OR "));
+         conditionItems.append(_T("(item_id="));
+         conditionItems.append(o->getId());
+         conditionItems.append(_T(" AND idata_timestamp<"));
+         conditionItems.append((INT64)cutoffTime);
+         conditionItems.append(_T(')'));
          itemCount++;
+         dropCutoffItems = std::min(dropCutoffItems, cutoffTime);
+         deleteCutoffItems = std::max(deleteCutoffItems, cutoffTime);
       }
       else if (o->getType() == DCO_TYPE_TABLE)
       {
          if (tableCount > 0)
-            queryTables.append(_T(" OR "));
-         queryTables.append(_T("(item_id="));
-         queryTables.append(o->getId());
-         queryTables.append(_T(" AND tdata_timestamp<"));
-         queryTables.append((INT64)(now - o->getEffectiveRetentionTime() * 86400));
-         queryTables.append(_T(')'));
+            conditionTables.append(_T(" OR "));
+         conditionTables.append(_T("(item_id="));
+         conditionTables.append(o->getId());
+         conditionTables.append(_T(" AND tdata_timestamp<"));
+         conditionTables.append((INT64)cutoffTime);
+         conditionTables.append(_T(')'));
          tableCount++;
+         dropCutoffTables = std::min(dropCutoffTables, cutoffTime);
+         deleteCutoffTables = std::max(deleteCutoffTables, cutoffTime);
       }
    }
    unlockDciAccess();
 
+   // Records for deleted objects can be in any partition
    lockProperties();
+   if (!m_deletedItems->isEmpty())
+      deleteCutoffItems = 0;
    for(int i = 0; i < m_deletedItems->size(); i++)
    {
       if (itemCount > 0)
-         queryItems.append(_T(" OR "));
-      queryItems.append(_T("item_id="));
-      queryItems.append(m_deletedItems->get(i));
+         conditionItems.append(_T(" OR "));
+      conditionItems.append(_T("item_id="));
+      conditionItems.append(m_deletedItems->get(i));
       itemCount++;
    }
    m_deletedItems->clear();
 
+   if (!m_deletedTables->isEmpty())
+      deleteCutoffTables = 0;
    for(int i = 0; i < m_deletedTables->size(); i++)
    {
       if (tableCount > 0)
-         queryTables.append(_T(" OR "));
-      queryTables.append(_T("item_id="));
-      queryTables.append(m_deletedItems->get(i));
+         conditionTables.append(_T(" OR "));
+      conditionTables.append(_T("item_id="));
+      conditionTables.append(m_deletedTables->get(i));
       tableCount++;
    }
    m_deletedTables->clear();
@@ -289,16 +289,44 @@ void DataCollectionTarget::cleanDCIData(DB_HANDLE hdb)
 
    if (itemCount > 0)
    {
-      nxlog_debug_tag(_T("housekeeper"), 6, _T("DataCollectionTarget::cleanDCIData(%s [%d]): running query \"%s\""), m_name, m_id, (const TCHAR *)queryItems);
-      DBQuery(hdb, queryItems);
+      if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
+      {
+         StringBuffer query = _T("DELETE FROM idata WHERE node_id=");
+         query.append(m_id);
+         query.append(_T(" AND "));
+         query.append(conditionItems);
+         nxlog_debug_tag(_T("housekeeper"), 6, _T("DataCollectionTarget::cleanDCIData(%s [%d]): running query \"%s\""), m_name, m_id, (const TCHAR *)query);
+         DBQuery(hdb, query);
+      }
+      else
+      {
+         if (dropCutoffItems < now)
+            DropExpiredDataPartitions(hdb, DCO_TYPE_ITEM, m_id, dropCutoffItems);
+         nxlog_debug_tag(_T("housekeeper"), 6, _T("DataCollectionTarget::cleanDCIData(%s [%d]): deleting from idata_%u where %s"), m_name, m_id, m_id, (const TCHAR *)conditionItems);
+         DeleteFromDataPartitions(hdb, DCO_TYPE_ITEM, m_id, conditionItems, 0, deleteCutoffItems);
+      }
       if (!ThrottleHousekeeper())
          return;
    }
 
    if (tableCount > 0)
    {
-      nxlog_debug_tag(_T("housekeeper"), 6, _T("DataCollectionTarget::cleanDCIData(%s [%d]): running query \"%s\""), m_name, m_id, (const TCHAR *)queryTables);
-      DBQuery(hdb, queryTables);
+      if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
+      {
+         StringBuffer query = _T("DELETE FROM tdata WHERE node_id=");
+         query.append(m_id);
+         query.append(_T(" AND "));
+         query.append(conditionTables);
+         nxlog_debug_tag(_T("housekeeper"), 6, _T("DataCollectionTarget::cleanDCIData(%s [%d]): running query \"%s\""), m_name, m_id, (const TCHAR *)query);
+         DBQuery(hdb, query);
+      }
+      else
+      {
+         if (dropCutoffTables < now)
+            DropExpiredDataPartitions(hdb, DCO_TYPE_TABLE, m_id, dropCutoffTables);
+         nxlog_debug_tag(_T("housekeeper"), 6, _T("DataCollectionTarget::cleanDCIData(%s [%d]): deleting from tdata_%u where %s"), m_name, m_id, m_id, (const TCHAR *)conditionTables);
+         DeleteFromDataPartitions(hdb, DCO_TYPE_TABLE, m_id, conditionTables, 0, deleteCutoffTables);
+      }
    }
 }
 
@@ -1499,6 +1527,51 @@ bool DataCollectionTarget::isDataCollectionTarget()
    return true;
 }
 
+/**
+ * Check if object's NXCP message contains user specific data (DCIs with access restrictions
+ * shown on overview page or in tooltips). Result is cached until DCI configuration changes.
+ */
+bool DataCollectionTarget::hasUserSpecificData()
+{
+   VolatileCounter generation = m_dciConfigGeneration;
+   if (m_userSpecificDataGeneration == generation)
+      return m_hasUserSpecificData;
+
+   bool result = false;
+   lockDciAccess(false);
+   for(int i = 0; i < m_dcObjects->size(); i++)
+   {
+      DCObject *dci = m_dcObjects->get(i);
+      if ((dci->getType() == DCO_TYPE_ITEM) && dci->hasAccessList() &&
+          (dci->isShowInObjectOverview() || dci->isShowOnObjectTooltip()))
+      {
+         result = true;
+         break;
+      }
+   }
+   unlockDciAccess();
+
+   // Configuration generation is changed under properties lock, so cached value
+   // will not be overwritten with stale result if DCIs were changed during scan
+   lockProperties();
+   if (m_dciConfigGeneration == generation)
+   {
+      m_hasUserSpecificData = result;
+      m_userSpecificDataGeneration = generation;
+   }
+   unlockProperties();
+   return result;
+}
+
+/**
+ * Invalidate cached user specific data flag. Called by setModified() when
+ * data collection configuration changes.
+ */
+void DataCollectionTarget::invalidateUserSpecificData()
+{
+   InterlockedIncrement(&m_dciConfigGeneration);
+}
+
 /**
  * Add data collection element to proxy info structure
  */
@@ -26,6 +26,12 @@
 #pragma warning(disable : 4700)
 #endif
 
+/**
+ * Region size for event's parameter memory pool. Most events have few short parameters,
+ * so one small region usually holds all of them.
+ */
+#define EVENT_POOL_REGION_SIZE   512
+
 /**
  * Event processing queue
  */
@@ -192,7 +198,7 @@ bool EventTemplate::saveToDatabase() const
 /**
  * Default constructor for event
  */
-Event::Event()
+Event::Event() : m_pool(EVENT_POOL_REGION_SIZE)
 {
    m_id = 0;
 	m_name[0] = 0;
@@ -209,13 +215,12 @@ Event::Event()
    m_timestamp = 0;
    m_originTimestamp = 0;
 	m_customMessage = NULL;
-	m_parameters.setOwner(Ownership::True);
 }
 
 /**
  * Copy constructor for event
  */
-Event::Event(const Event *src)
+Event::Event(const Event *src) : m_pool(EVENT_POOL_REGION_SIZE)
 {
    m_id = src->m_id;
    _tcscpy(m_name, src->m_name);
@@ -233,10 +238,9 @@ Event::Event(const Event *src)
    m_originTimestamp = src->m_originTimestamp;
    m_tags.addAll(src->m_tags);
 	m_customMessage = MemCopyString(src->m_customMessage);
-	m_parameters.setOwner(Ownership::True);
    for(int i = 0; i < src->m_parameters.size(); i++)
    {
-      m_parameters.add(MemCopyString((TCHAR *)src->m_parameters.get(i)));
+      addParameterValue(static_cast<TCHAR*>(src->m_parameters.get(i)));
    }
    m_parameterNames.addAll(&src->m_parameterNames);
 }
@@ -328,16 +332,16 @@ Event *Event::createFromJson(json_t *json)
          if (json_unpack(p, "{s:s, s:s}", "name", &name, "value", &value) != -1)
          {
 #ifdef UNICODE
-            event->m_parameters.add(WideStringFromUTF8String(CHECK_NULL_EX_A(value)));
+            event->addPreallocatedParameterValue(WideStringFromUTF8String(CHECK_NULL_EX_A(value)));
             event->m_parameterNames.addPreallocated(WideStringFromUTF8String(CHECK_NULL_EX_A(name)));
 #else
-            event->m_parameters.add(MBStringFromUTF8String(CHECK_NULL_EX_A(value)));
+            event->addPreallocatedParameterValue(MBStringFromUTF8String(CHECK_NULL_EX_A(value)));
             event->m_parameterNames.addPreallocated(MBStringFromUTF8String(CHECK_NULL_EX_A(name)));
 #endif
          }
          else
          {
-            event->m_parameters.add(MemCopyString(_T("")));
+            event->addParameterValue(_T(""));
             event->m_parameterNames.add(_T(""));
          }
       }
@@ -350,7 +354,7 @@ Event *Event::createFromJson(json_t *json)
  * Construct event from template
  */
 Event::Event(const EventTemplate *eventTemplate, EventOrigin origin, time_t originTimestamp, UINT32 sourceId,
-         UINT32 dciId, const TCHAR *tag, const char *format, const TCHAR **names, va_list args)
+         UINT32 dciId, const TCHAR *tag, const char *format, const TCHAR **names, va_list args) : m_pool(EVENT_POOL_REGION_SIZE)
 {
    init(eventTemplate, origin, originTimestamp, sourceId, dciId, tag);
 
@@ -367,16 +371,19 @@ Event::Event(const EventTemplate *eventTemplate, EventOrigin origin, time_t orig
             case 's':
                {
                   const TCHAR *s = va_arg(args, const TCHAR *);
-					   m_parameters.add(MemCopyString(CHECK_NULL_EX(s)));
+					   addParameterValue(CHECK_NULL_EX(s));
                }
                break;
             case 'm':	// multibyte string
                {
                   const char *s = va_arg(args, const char *);
 #ifdef UNICODE
-                  m_parameters.add((s != NULL) ? WideStringFromMBString(s) : MemCopyStringW(L""));
+                  if (s != NULL)
+                     addPreallocatedParameterValue(WideStringFromMBString(s));
+                  else
+                     addParameterValue(L"");
 #else
-					   m_parameters.add(MemCopyStringA(CHECK_NULL_EX_A(s)));
+					   addParameterValue(CHECK_NULL_EX_A(s));
 #endif
                }
                break;
@@ -384,60 +391,63 @@ Event::Event(const EventTemplate *eventTemplate, EventOrigin origin, time_t orig
                {
                   const WCHAR *s = va_arg(args, const WCHAR *);
 #ifdef UNICODE
-		   			m_parameters.add(MemCopyStringW(CHECK_NULL_EX_W(s)));
+		   			addParameterValue(CHECK_NULL_EX_W(s));
 #else
-                  m_parameters.add((s != NULL) ? MBStringFromWideString(s) : MemCopyStringA(""));
+                  if (s != NULL)
+                     addPreallocatedParameterValue(MBStringFromWideString(s));
+                  else
+                     addParameterValue("");
 #endif
                }
                break;
             case 'd':
-               buffer = MemAllocString(16);
+               buffer = m_pool.allocateString(16);
                _sntprintf(buffer, 16, _T("%d"), va_arg(args, LONG));
 					m_parameters.add(buffer);
                break;
             case 'D':
-               buffer = MemAllocString(32);
+               buffer = m_pool.allocateString(32);
                _sntprintf(buffer, 32, INT64_FMT, va_arg(args, INT64));
 					m_parameters.add(buffer);
                break;
             case 't':
-               buffer = MemAllocString(32);
+               buffer = m_pool.allocateString(32);
                _sntprintf(buffer, 32, INT64_FMT, (INT64)va_arg(args, time_t));
 					m_parameters.add(buffer);
                break;
             case 'x':
             case 'i':
-               buffer = MemAllocString(16);
+               buffer = m_pool.allocateString(16);
                _sntprintf(buffer, 16, _T("0x%08X"), va_arg(args, UINT32));
 					m_parameters.add(buffer);
                break;
             case 'a':   // IPv4 address
-               buffer = MemAllocString(16);
+               buffer = m_pool.allocateString(16);
                IpToStr(va_arg(args, UINT32), buffer);
 					m_parameters.add(buffer);
                break;
             case 'A':   // InetAddress object
-               buffer = MemAllocString(64);
+               buffer = m_pool.allocateString(64);
                (va_arg(args, InetAddress *))->toString(buffer);
 					m_parameters.add(buffer);
                break;
             case 'h':
-               buffer = MemAllocString(64);
+               buffer = m_pool.allocateString(64);
                MACToStr(va_arg(args, BYTE *), buffer);
 					m_parameters.add(buffer);
                break;
             case 'H':
-               buffer = MemAllocString(64);
+               buffer = m_pool.allocateString(64);
                (va_arg(args, MacAddress *))->toString(buffer);
                m_parameters.add(buffer);
                break;
             case 'G':   // uuid object (GUID)
-               buffer = MemAllocString(48);
+               buffer = m_pool.allocateString(48);
                (va_arg(args, uuid *))->toString(buffer);
                m_parameters.add(buffer);
                break;
             default:
-               buffer = MemAllocString(64);
+               buffer = m_pool.allocateString(64);
                _sntprintf(buffer, 64, _T("BAD FORMAT \"%c\" [value = 0x%08X]"), format[i], va_arg(args, UINT32));
 					m_parameters.add(buffer);
                break;
@@ -451,7 +461,7 @@ Event::Event(const EventTemplate *eventTemplate, EventOrigin origin, time_t orig
  * Create event from template
  */
 Event::Event(const EventTemplate *eventTemplate, EventOrigin origin, time_t originTimestamp, UINT32 sourceId,
-         UINT32 dciId, const TCHAR *tag, StringMap *args)
+         UINT32 dciId, const TCHAR *tag, StringMap *args) : m_pool(EVENT_POOL_REGION_SIZE)
 {
    init(eventTemplate, origin, originTimestamp, sourceId, dciId, tag);
    Iterator<std::pair<const TCHAR*, const TCHAR*>> *it = args->iterator();
@@ -459,7 +469,7 @@ Event::Event(const EventTemplate *eventTemplate, EventOrigin origin, time_t orig
    {
       auto p = it->next();
       m_parameterNames.add(p->first);
-      m_parameters.add(MemCopyString(p->second));
+      addParameterValue(p->second);
    }
    delete it;
 }
@@ -489,7 +499,6 @@ void Event::init(const EventTemplate *eventTemplate, EventOrigin origin, time_t
       m_tags.add(tag);
 
    m_customMessage = NULL;
-   m_parameters.setOwner(Ownership::True);
 
    // Zone UIN
    NetObj *source = FindObjectById(sourceId);
@@ -567,10 +576,30 @@ StringBuffer Event::expandText(const TCHAR *textTemplate, const Alarm *alarm) co
  */
 void Event::addParameter(const TCHAR *name, const TCHAR *value)
 {
-	m_parameters.add(MemCopyString(value));
+	addParameterValue(value);
 	m_parameterNames.add(name);
 }
 
+/**
+ * Add parameter value allocated on heap (value will be moved into event's memory pool)
+ */
+void Event::addPreallocatedParameterValue(TCHAR *value)
+{
+   m_parameters.add(m_pool.copyString(value));
+   MemFree(value);
+}
+
+/**
+ * Replace value of parameter at given index. Memory used by old value is returned to pool.
+ */
+void Event::replaceParameterValue(int index, const TCHAR *value)
+{
+   TCHAR *oldValue = static_cast<TCHAR*>(m_parameters.get(index));
+   if (oldValue != NULL)
+      m_pool.free(oldValue, (_tcslen(oldValue) + 1) * sizeof(TCHAR));
+   m_parameters.replace(index, m_pool.copyString(value));
+}
+
 /**
  * Set value of named parameter
  */
@@ -582,11 +611,11 @@ void Event::setNamedParameter(const TCHAR *name, const TCHAR *value)
 	int index = m_parameterNames.indexOfIgnoreCase(name);
 	if (index != -1)
 	{
-		m_parameters.replace(index, MemCopyString(value));
+		replaceParameterValue(index, value);
 	}
 	else
 	{
-		m_parameters.add(MemCopyString(value));
+		addParameterValue(value);
 		m_parameterNames.add(name);
 	}
 }
@@ -606,17 +635,17 @@ void Event::setParameter(int index, const TCHAR *name, const TCHAR *value)
    int addup = index - m_parameters.size();
    for(int i = 0; i < addup; i++)
    {
-		m_parameters.add(MemCopyString(_T("")));
+		addParameterValue(_T(""));
 		m_parameterNames.add(_T(""));
    }
    if (index < m_parameters.size())
    {
-		m_parameters.replace(index, MemCopyString(value));
+		replaceParameterValue(index, value);
 		m_parameterNames.replace(index, CHECK_NULL_EX(name));
    }
    else
    {
-		m_parameters.add(MemCopyString(value));
+		addParameterValue(value);
 		m_parameterNames.add(CHECK_NULL_EX(name));
    }
 }
@@ -40,13 +40,22 @@ static THREAD s_threadStormDetector = INVALID_THREAD_HANDLE;
 static THREAD s_threadLogger = INVALID_THREAD_HANDLE;
 static ObjectQueue<Event> s_loggerQueue;
 
+/**
+ * Event broadcast context
+ */
+struct EventBroadcastContext
+{
+   Event *event;
+   ClientBroadcastMessage *msg;
+};
+
 /**
  * Handler for EnumerateSessions()
  */
 static void BroadcastEvent(ClientSession *pSession, void *pArg)
 {
    if (pSession->isAuthenticated())
-      pSession->onNewEvent((Event *)pArg);
+      pSession->onNewEvent(((EventBroadcastContext *)pArg)->event, ((EventBroadcastContext *)pArg)->msg);
 }
 
 /**
@@ -250,7 +259,15 @@ THREAD_RESULT THREAD_CALL EventProcessor(void *arg)
       }
 
       // Send event to all connected clients
-      EnumerateClientSessions(BroadcastEvent, pEvent);
+      if (IsClientChannelSubscribed(NXC_CHANNEL_EVENTS))
+      {
+         EventBroadcastContext context;
+         context.event = pEvent;
+         context.msg = new ClientBroadcastMessage(CMD_EVENTLOG_RECORDS);
+         pEvent->prepareMessage(context.msg->getMessage());
+         EnumerateClientSessions(BroadcastEvent, &context);
+         context.msg->decRefCount();
+      }
 
       // Write event information to debug
       if (nxlog_get_debug_level_tag(DEBUG_TAG) >= 5)
@@ -422,6 +422,8 @@ static THREAD_RESULT THREAD_CALL HouseKeeper(void *pArg)
             g_idxNodeById.forEach(CleanDciData, hdb);
             g_idxSensorById.forEach(CleanDciData, hdb);
          }
+         if (IsDataRollupEnabled())
+            DeleteExpiredDataRollups(hdb);
       }
       else
       {
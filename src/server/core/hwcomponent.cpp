@@ -47,6 +47,19 @@ int HardwareComponentComparator(const HardwareComponent **c1, const HardwareComp
    return _tcscmp((*c1)->getVendor(), (*c2)->getVendor());
 }
 
+/**
+ * Comparator for hardware components using only database key (category and index)
+ */
+int HardwareComponentKeyComparator(const HardwareComponent **c1, const HardwareComponent **c2)
+{
+   int rc = static_cast<int>((*c1)->getCategory()) - static_cast<int>((*c2)->getCategory());
+   if (rc != 0)
+      return rc;
+   if ((*c1)->getIndex() != (*c2)->getIndex())
+      return (*c1)->getIndex() < (*c2)->getIndex() ? -1 : 1;
+   return 0;
+}
+
 /**
  * Calculate hardware changes
  */
@@ -220,3 +233,26 @@ bool HardwareComponent::saveToDatabase(DB_STATEMENT hStmt) const
    DBBind(hStmt, 11, DB_SQLTYPE_VARCHAR, m_description, DB_BIND_STATIC);
    return DBExecute(hStmt);
 }
+
+/**
+ * Delete from database
+ * Field order: node_id,category,component_index
+ */
+bool HardwareComponent::deleteFromDatabase(DB_STATEMENT hStmt) const
+{
+   DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, m_category);
+   DBBind(hStmt, 3, DB_SQLTYPE_INTEGER, m_index);
+   return DBExecute(hStmt);
+}
+
+/**
+ * Check if all stored attributes of this component are equal to attributes of given component
+ */
+bool HardwareComponent::equals(const HardwareComponent *c) const
+{
+   return (m_category == c->m_category) && (m_index == c->m_index) && (m_capacity == c->m_capacity) &&
+          !_tcscmp(getType(), c->getType()) && !_tcscmp(getVendor(), c->getVendor()) &&
+          !_tcscmp(getModel(), c->getModel()) && !_tcscmp(getLocation(), c->getLocation()) &&
+          !_tcscmp(getPartNumber(), c->getPartNumber()) && !_tcscmp(getSerialNumber(), c->getSerialNumber()) &&
+          !_tcscmp(getDescription(), c->getDescription());
+}
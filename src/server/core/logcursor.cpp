@@ -0,0 +1,99 @@
+/*
+** NetXMS - Network Management System
+** Copyright (C) 2003-2020 Victor Kirhenshtein
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: logcursor.cpp
+**
+**/
+
+#include <nms_common.h>
+#include <nms_util.h>
+#include <nxcpapi.h>
+#include <nxcore_logs.h>
+
+/**
+ * Add condition selecting rows with given value in key column
+ */
+static void AppendEquals(StringBuffer *sql, const TCHAR *column, const TCHAR *value)
+{
+   if (*value == 0)
+      sql->appendFormattedString(_T("%s IS NULL"), column);
+   else
+      sql->appendFormattedString(_T("%s=%s"), column, value);
+}
+
+/**
+ * Build condition selecting rows following cursor position in given sort order. Condition on
+ * first key column is duplicated as simple range predicate to allow index range scan.
+ *
+ * Comparison with NULL is never true, so rows with NULL in key column are handled explicitly:
+ * they are placed after all other values if nullsSortedLast is true (as done by PostgreSQL,
+ * Oracle and DB2 for ascending order) and before all other values otherwise (MySQL, SQLite,
+ * Microsoft SQL Server, Informix). Descending order reverses NULL placement.
+ */
+StringBuffer LogQueryCursor::buildCondition(const StructArray<OrderingColumn> *keyColumns, bool nullsSortedLast) const
+{
+   StringBuffer sql;
+
+   const OrderingColumn *c = keyColumns->get(0);
+   const TCHAR *value = key.get(0);
+   bool nullsAfter = (nullsSortedLast != c->descending);
+   if (*value != 0)
+   {
+      if (nullsAfter)
+         sql.appendFormattedString(_T("(%s%s%s OR %s IS NULL) AND "), c->name, c->descending ? _T("<=") : _T(">="), value, c->name);
+      else
+         sql.appendFormattedString(_T("%s%s%s AND "), c->name, c->descending ? _T("<=") : _T(">="), value);
+   }
+   else if (nullsAfter)
+   {
+      sql.appendFormattedString(_T("%s IS NULL AND "), c->name);
+   }
+
+   sql.append(_T("("));
+   bool first = true;
+   for(int i = 0; i < keyColumns->size(); i++)
+   {
+      c = keyColumns->get(i);
+      value = key.get(i);
+      nullsAfter = (nullsSortedLast != c->descending);
+      if ((*value == 0) && nullsAfter)
+         continue;   // no values after NULL in this column
+
+      if (!first)
+         sql.append(_T(" OR "));
+      first = false;
+
+      sql.append(_T("("));
+      for(int j = 0; j < i; j++)
+      {
+         AppendEquals(&sql, keyColumns->get(j)->name, key.get(j));
+         sql.append(_T(" AND "));
+      }
+      if (*value == 0)
+         sql.appendFormattedString(_T("%s IS NOT NULL"), c->name);
+      else if (nullsAfter)
+         sql.appendFormattedString(_T("(%s%s%s OR %s IS NULL)"), c->name, c->descending ? _T("<") : _T(">"), value, c->name);
+      else
+         sql.appendFormattedString(_T("%s%s%s"), c->name, c->descending ? _T("<") : _T(">"), value);
+      sql.append(_T(")"));
+   }
+   if (first)
+      sql.append(_T("1=0"));   // cursor is at the end of result set
+   sql.append(_T(")"));
+   return sql;
+}
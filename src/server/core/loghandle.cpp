@@ -1,6 +1,6 @@
 /* 
 ** NetXMS - Network Management System
-** Copyright (C) 2003-2013 Victor Kirhenshtein
+** Copyright (C) 2003-2020 Victor Kirhenshtein
 **
 ** This program is free software; you can redistribute it and/or modify
 ** it under the terms of the GNU General Public License as published by
@@ -22,18 +22,26 @@
 
 #include "nxcore.h"
 
+/**
+ * Default number of rows fetched from database at once
+ */
+#define LOG_WINDOW_SIZE    1000
 
 /**
  * Constructor
  */
-LogHandle::LogHandle(NXCORE_LOG *info) : RefCountObject()
+LogHandle::LogHandle(NXCORE_LOG *info) : RefCountObject(), m_keyColumns(4, 4), m_checkpoints(64, 64, Ownership::True)
 {
 	m_log = info;
 	m_filter = NULL;
 	m_lock = MutexCreate();
-	m_resultSet = NULL;
-	m_rowCountLimit = 1000;
+	m_keysetEnabled = false;
+	m_windowSize = LOG_WINDOW_SIZE;
 	m_maxRecordId = 0;
+	m_queryValid = false;
+	m_window = NULL;
+	m_windowStart = 0;
+	m_totalRows = -1;
 }
 
 /**
@@ -71,15 +79,31 @@ void LogHandle::getColumnInfo(NXCPMessage &msg)
  */
 void LogHandle::deleteQueryResults()
 {
-	if (m_resultSet != NULL)
-	{
-		DBFreeResult(m_resultSet);
-		m_resultSet = NULL;
-	}
+   delete m_window;
+   m_window = NULL;
+   m_windowStart = 0;
+   m_totalRows = -1;
+   m_checkpoints.clear();
+   m_checkpoints.add(new LogQueryCursor(0));
+   m_queryValid = false;
 }
 
 /**
- * Build query column list
+ * Find column definition by name
+ */
+const LOG_COLUMN *LogHandle::findColumn(const TCHAR *name)
+{
+   for(LOG_COLUMN *column = m_log->columns; column->name != NULL; column++)
+      if (!_tcsicmp(column->name, name))
+         return column;
+   return NULL;
+}
+
+/**
+ * Build query column list and list of ordering key columns. Record ID column is added as last key
+ * column (unless already present) to make ordering unique, so that result set position can be
+ * defined by key values of preceding row. Keyset pagination is only possible when all key columns
+ * are numeric.
  */
 void LogHandle::buildQueryColumnList()
 {
@@ -105,6 +129,40 @@ void LogHandle::buildQueryColumnList()
 		m_queryColumns.append(column->name);
 		column++;
 	}
+
+   m_keyColumns.clear();
+   m_keysetEnabled = true;
+   bool idColumnFound = false;
+   for(int i = 0; (i < m_filter->getNumOrderingColumns()) && !idColumnFound; i++)
+   {
+      const OrderingColumn *c = m_filter->getOrderingColumn(i);
+      const LOG_COLUMN *lc = findColumn(c->name);
+      if ((lc == NULL) || (lc->type == LC_TEXT))
+         m_keysetEnabled = false;
+      m_keyColumns.add(c);
+      if (!_tcsicmp(c->name, m_log->idColumn))
+         idColumnFound = true;   // Record ID is unique, following columns cannot affect order
+   }
+   if (!idColumnFound)
+   {
+      OrderingColumn c;
+      _tcslcpy(c.name, m_log->idColumn, MAX_COLUMN_NAME_LEN);
+      c.descending = m_keyColumns.isEmpty() ? true : m_keyColumns.get(m_keyColumns.size() - 1)->descending;
+      m_keyColumns.add(&c);
+   }
+
+   m_orderClause = _T(" ORDER BY ");
+   for(int i = 0; i < m_keyColumns.size(); i++)
+   {
+      const OrderingColumn *c = m_keyColumns.get(i);
+      if (i > 0)
+         m_orderClause.append(_T(","));
+      m_orderClause.append(c->name);
+      if (c->descending)
+         m_orderClause.append(_T(" DESC"));
+      if (m_keysetEnabled)
+         m_queryColumns.appendFormattedString(_T(",%s AS k%d"), c->name, i);
+   }
 }
 
 /**
@@ -133,7 +191,11 @@ bool LogHandle::query(LogFilter *filter, INT64 *rowCount, const UINT32 userId)
 	if (m_maxRecordId < 0)
 		return false;
 
-	return queryInternal(rowCount, userId);
+	buildWhereClause(userId);
+	m_queryValid = fetch(0, m_windowSize);
+	if (m_queryValid)
+	   *rowCount = m_window->getNumRows();
+	return m_queryValid;
 }
 
 /**
@@ -184,28 +246,25 @@ StringBuffer LogHandle::buildObjectAccessConstraint(const UINT32 userId)
          constraint += _T("NOT (");
       }
 
-      if (list->size() < 1000)
+      // Long lists are split into several IN clauses (some databases limit number of IN list elements)
+      constraint += _T("(");
+      for(int i = 0; i < list->size(); i++)
       {
-         constraint.appendFormattedString(_T("%s IN ("), m_log->relatedObjectIdColumn);
-         for(int i = 0; i < list->size(); i++)
+         if (i % 1000 == 0)
          {
-            TCHAR buffer[32];
-            _sntprintf(buffer, 32, _T("%d,"), list->get(i));
-            constraint += buffer;
+            if (i > 0)
+            {
+               constraint.shrink();
+               constraint += _T(") OR ");
+            }
+            constraint.appendFormattedString(_T("%s IN ("), m_log->relatedObjectIdColumn);
          }
-         constraint.shrink();
-         constraint += _T(")");
-      }
-      else
-      {
-         for(int i = 0; i < list->size(); i++)
-         {
-            TCHAR buffer[32];
-   			constraint.appendFormattedString(_T("(%s=%d)OR"), m_log->relatedObjectIdColumn, list->get(i));
-            constraint += buffer;
-         }
-         constraint.shrink(2);
+         TCHAR buffer[32];
+         _sntprintf(buffer, 32, _T("%u,"), list->get(i));
+         constraint += buffer;
       }
+      constraint.shrink();
+      constraint += _T("))");
       if (allowed->size() >= restricted->size())
       {
          constraint += _T(")");
@@ -217,19 +276,58 @@ StringBuffer LogHandle::buildObjectAccessConstraint(const UINT32 userId)
 }
 
 /**
- * Do query with current filter and column set
+ * Build WHERE clause from current filter
+ */
+void LogHandle::buildWhereClause(const UINT32 userId)
+{
+   m_whereClause = _T(" WHERE ");
+	m_whereClause.appendFormattedString(_T("%s<=") INT64_FMT, m_log->idColumn, m_maxRecordId);
+
+	int filterSize = m_filter->getNumColumnFilter();
+	for(int i = 0; i < filterSize; i++)
+	{
+      StringBuffer sql = m_filter->getColumnFilter(i)->generateSql();
+      if (!sql.isEmpty())
+      {
+         m_whereClause.append(_T(" AND ("));
+         m_whereClause.append(sql);
+         m_whereClause.append(_T(")"));
+      }
+	}
+
+	if ((userId != 0) && (m_log->relatedObjectIdColumn != NULL) && ConfigReadBoolean(_T("ExtendedLogQueryAccessControl"), false))
+   {
+		String constraint = buildObjectAccessConstraint(userId);
+		if (!constraint.isEmpty())
+      {
+		   m_whereClause += _T(" AND (");
+		   m_whereClause += constraint;
+		   m_whereClause += _T(")");
+		}
+	}
+}
+
+/**
+ * Check if database places NULL values after all other values when sorting in ascending order
+ */
+static inline bool IsNullSortedLast()
+{
+   return (g_dbSyntax == DB_SYNTAX_PGSQL) || (g_dbSyntax == DB_SYNTAX_TSDB) || (g_dbSyntax == DB_SYNTAX_ORACLE) || (g_dbSyntax == DB_SYNTAX_DB2);
+}
+
+/**
+ * Build query for reading given number of rows starting at given cursor position
  */
-bool LogHandle::queryInternal(INT64 *rowCount, const UINT32 userId)
+StringBuffer LogHandle::buildQuery(const LogQueryCursor *cursor, INT64 limit)
 {
-	QWORD qwTimeStart = GetCurrentTimeMs();
 	StringBuffer query;
 	switch(g_dbSyntax)
 	{
 		case DB_SYNTAX_MSSQL:
-			query.appendFormattedString(_T("SELECT TOP %u %s FROM %s "), m_rowCountLimit, (const TCHAR *)m_queryColumns, m_log->table);
+			query.appendFormattedString(_T("SELECT TOP ") INT64_FMT _T(" %s FROM %s"), limit, (const TCHAR *)m_queryColumns, m_log->table);
 			break;
 		case DB_SYNTAX_INFORMIX:
-			query.appendFormattedString(_T("SELECT FIRST %u %s FROM %s "), m_rowCountLimit, (const TCHAR *)m_queryColumns, m_log->table);
+			query.appendFormattedString(_T("SELECT FIRST ") INT64_FMT _T(" %s FROM %s"), limit, (const TCHAR *)m_queryColumns, m_log->table);
 			break;
 		case DB_SYNTAX_ORACLE:
 			query.appendFormattedString(_T("SELECT * FROM (SELECT %s FROM %s"), (const TCHAR *)m_queryColumns, m_log->table);
@@ -243,32 +341,14 @@ bool LogHandle::queryInternal(INT64 *rowCount, const UINT32 userId)
 			break;
 	}
 
-	query.appendFormattedString(_T(" WHERE %s<=") INT64_FMT, m_log->idColumn, m_maxRecordId);
-
-	int filterSize = m_filter->getNumColumnFilter();
-	if (filterSize > 0)
+	query.append(m_whereClause);
+	if (!cursor->key.isEmpty())
 	{
-		for(int i = 0; i < filterSize; i++)
-		{
-			ColumnFilter *cf = m_filter->getColumnFilter(i);
-			query.append(_T(" AND ("));
-			query.append(cf->generateSql());
-			query.append(_T(")"));
-		}
+	   query.append(_T(" AND ("));
+	   query.append(cursor->buildCondition(&m_keyColumns, IsNullSortedLast()));
+	   query.append(_T(")"));
 	}
-
-	if ((userId != 0) && (m_log->relatedObjectIdColumn != NULL) && ConfigReadBoolean(_T("ExtendedLogQueryAccessControl"), false))
-   {
-		String constraint = buildObjectAccessConstraint(userId);
-		if (!constraint.isEmpty()) 
-      {
-			query += _T(" AND (");
-			query += constraint;
-			query += _T(")");
-		}
-	}
-
-	query += m_filter->buildOrderClause();
+	query.append(m_orderClause);
 
 	// Limit record count
 	switch(g_dbSyntax)
@@ -276,37 +356,130 @@ bool LogHandle::queryInternal(INT64 *rowCount, const UINT32 userId)
 		case DB_SYNTAX_MYSQL:
 		case DB_SYNTAX_PGSQL:
 		case DB_SYNTAX_SQLITE:
-			query.appendFormattedString(_T(" LIMIT %u"), m_rowCountLimit);
+		case DB_SYNTAX_TSDB:
+			query.appendFormattedString(_T(" LIMIT ") INT64_FMT, limit);
 			break;
 		case DB_SYNTAX_ORACLE:
-			query.appendFormattedString(_T(") WHERE ROWNUM<=%u"), m_rowCountLimit);
+			query.appendFormattedString(_T(") WHERE ROWNUM<=") INT64_FMT, limit);
 			break;
 		case DB_SYNTAX_DB2:
-			query.appendFormattedString(_T(" FETCH FIRST %u ROWS ONLY"), m_rowCountLimit);
+			query.appendFormattedString(_T(" FETCH FIRST ") INT64_FMT _T(" ROWS ONLY"), limit);
 			break;
 	}
+	return query;
+}
+
+/**
+ * Check if key value can be used in keyset condition. NULL values (returned by some drivers as
+ * empty strings) are valid and handled by condition builder.
+ */
+static bool IsValidKeyValue(const TCHAR *value)
+{
+   if ((value == NULL) || (*value == 0))
+      return true;
+   for(const TCHAR *p = (*value == _T('-')) ? value + 1 : value; *p != 0; p++)
+      if (((*p < _T('0')) || (*p > _T('9'))) && (*p != _T('.')))
+         return false;
+   return true;
+}
+
+/**
+ * Fetch rows from database into window. Query is started from nearest known position before
+ * requested row (keyset pagination), rows between that position and requested row are skipped
+ * while streaming result set, so only fetched window is kept in memory.
+ */
+bool LogHandle::fetch(INT64 startRow, INT64 numRows)
+{
+   INT64 count = std::max(numRows, static_cast<INT64>(m_windowSize));
+   Table *window = createTable(true);
+   int keyCount = m_keysetEnabled ? m_keyColumns.size() : 0;
+   int numColumns = window->getNumColumns() - keyCount;   // visible columns only
+
+   // Find nearest position before requested row - either within current window or one of saved checkpoints
+   LogQueryCursor windowCursor(startRow);
+   const LogQueryCursor *cursor = m_checkpoints.get(0);
+   if (m_keysetEnabled && (m_window != NULL) && (startRow > m_windowStart) && (startRow <= m_windowStart + m_window->getNumRows()))
+   {
+      int row = static_cast<int>(startRow - m_windowStart - 1);
+      for(int i = 0; i < keyCount; i++)
+      {
+         const TCHAR *value = m_window->getAsString(row, numColumns + i);
+         if (!IsValidKeyValue(value))
+            break;
+         windowCursor.key.add(CHECK_NULL_EX(value));
+      }
+      if (windowCursor.key.size() == keyCount)
+         cursor = &windowCursor;
+   }
+   if (cursor != &windowCursor)
+   {
+      for(int i = 1; i < m_checkpoints.size(); i++)
+      {
+         if (m_checkpoints.get(i)->row > startRow)
+            break;
+         cursor = m_checkpoints.get(i);
+      }
+   }
 
+   INT64 skip = startRow - cursor->row;
+   StringBuffer query = buildQuery(cursor, skip + count);
 	DbgPrintf(4, _T("LOG QUERY: %s"), (const TCHAR *)query);
 
-	DB_HANDLE dbHandle = DBConnectionPoolAcquireConnection();
-	bool ret = false;
-	DbgPrintf(7, _T("LogHandle::query(): DB connection acquired"));
-	m_resultSet = DBSelect(dbHandle, (const TCHAR *)query);
-	if (m_resultSet != NULL)
+   INT64 startTime = GetCurrentTimeMs();
+	DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+	DB_UNBUFFERED_RESULT hResult = DBSelectUnbuffered(hdb, query);
+	if (hResult == NULL)
 	{
-		*rowCount = DBGetNumRows(m_resultSet);
-		ret = true;
-		DbgPrintf(4, _T("Log query successful, %d rows fetched in %d ms"), (int)(*rowCount), (int)(GetCurrentTimeMs() - qwTimeStart));
+	   DBConnectionPoolReleaseConnection(hdb);
+	   delete window;
+	   return false;
 	}
-	DBConnectionPoolReleaseConnection(dbHandle);
 
-	return ret;
+	INT64 row = cursor->row;
+	while(DBFetch(hResult))
+	{
+	   if (row++ < startRow)
+	      continue;   // skip rows before requested one
+	   window->addRow();
+      for(int i = 0; i < numColumns + keyCount; i++)
+         window->setPreallocated(i, DBGetField(hResult, i, NULL, 0));
+	}
+	DBFreeResult(hResult);
+	DBConnectionPoolReleaseConnection(hdb);
+
+   if (row < cursor->row + skip + count)
+      m_totalRows = row;   // end of result set reached
+
+	delete m_window;
+	m_window = window;
+	m_windowStart = startRow;
+
+	// Save position after last fetched row as checkpoint for subsequent queries
+	if ((keyCount > 0) && (window->getNumRows() > 0) && (row > m_checkpoints.get(m_checkpoints.size() - 1)->row))
+	{
+	   LogQueryCursor *checkpoint = new LogQueryCursor(row);
+      for(int i = 0; i < keyCount; i++)
+      {
+         const TCHAR *value = window->getAsString(window->getNumRows() - 1, numColumns + i);
+         if (!IsValidKeyValue(value))
+            break;
+         checkpoint->key.add(CHECK_NULL_EX(value));
+      }
+      if (checkpoint->key.size() == keyCount)
+         m_checkpoints.add(checkpoint);
+      else
+         delete checkpoint;
+	}
+
+	DbgPrintf(4, _T("Log query successful, %d rows fetched in %d ms"), window->getNumRows(), static_cast<int>(GetCurrentTimeMs() - startTime));
+	return true;
 }
 
 /**
- * Create table for sending data to client
+ * Create table for sending data to client. If withKeyColumns is true, ordering key columns are
+ * added after visible columns.
  */
-Table *LogHandle::createTable()
+Table *LogHandle::createTable(bool withKeyColumns)
 {
 	Table *table = new Table();
 
@@ -323,6 +496,16 @@ Table *LogHandle::createTable()
 		column++;
 	}
 
+	if (withKeyColumns && m_keysetEnabled)
+	{
+	   for(int i = 0; i < m_keyColumns.size(); i++)
+	   {
+	      TCHAR name[16];
+	      _sntprintf(name, 16, _T("k%d"), i);
+	      table->addColumn(name);
+	   }
+	}
+
 	return table;
 }
 
@@ -334,39 +517,36 @@ Table *LogHandle::getData(INT64 startRow, INT64 numRows, bool refresh, const UIN
 	DbgPrintf(4, _T("Log data request: startRow=%d, numRows=%d, refresh=%s, userId=%d"),
 	          (int)startRow, (int)numRows, refresh ? _T("true") : _T("false"), userId);
 
-	if (m_resultSet == NULL)
+	if (!m_queryValid)
 		return createTable();	// send empty table to indicate end of data
 
-	int resultSize = DBGetNumRows(m_resultSet);
-	if (((int)(startRow + numRows) >= resultSize) || refresh)
+	if (refresh)
 	{
-		if ((resultSize < (int)m_rowCountLimit) && !refresh)
-		{
-			if (startRow >= resultSize)
-				return createTable();	// send empty table to indicate end of data
-		}
-		else
-		{
-			// possibly we have more rows or refresh was requested
-			UINT32 newLimit = (UINT32)(startRow + numRows);
-			if (newLimit > m_rowCountLimit)
-				m_rowCountLimit = (newLimit - m_rowCountLimit < 1000) ? (m_rowCountLimit + 1000) : newLimit;
-			deleteQueryResults();
-			INT64 rowCount;
-			if (!queryInternal(&rowCount, userId))
-				return NULL;
-			resultSize = DBGetNumRows(m_resultSet);
-		}
+	   deleteQueryResults();
+	   buildWhereClause(userId);
+	   m_queryValid = true;
+	}
+
+	if ((m_totalRows >= 0) && (startRow >= m_totalRows))
+	   return createTable();   // send empty table to indicate end of data
+
+	INT64 windowEnd = (m_window != NULL) ? m_windowStart + m_window->getNumRows() : 0;
+	if ((m_window == NULL) || (startRow < m_windowStart) || ((startRow + numRows > windowEnd) && (windowEnd != m_totalRows)))
+	{
+	   if (!fetch(startRow, numRows))
+	      return NULL;
+	   windowEnd = m_windowStart + m_window->getNumRows();
 	}
 
 	Table *table = createTable();
-	int maxRow = std::min((int)(startRow + numRows), resultSize);
-	for(int i = (int)startRow; i < maxRow; i++)
+	INT64 maxRow = std::min(startRow + numRows, windowEnd);
+	for(INT64 i = startRow; i < maxRow; i++)
 	{
 		table->addRow();
+		int row = static_cast<int>(i - m_windowStart);
 		for(int j = 0; j < table->getNumColumns(); j++)
 		{
-			table->setPreallocated(j, DBGetField(m_resultSet, i, j, NULL, 0));
+			table->set(j, m_window->getAsString(row, j));
 		}
 	}
 
@@ -181,6 +181,7 @@ static THREAD s_eventProcessorThread = INVALID_THREAD_HANDLE;
 static THREAD s_statCollectorThread = INVALID_THREAD_HANDLE;
 static int m_nShutdownReason = SHUTDOWN_DEFAULT;
 static StringSet s_components;
+static SNMP_AsyncEngine *s_snmpEngine = NULL;
 
 #ifndef _WIN32
 static pthread_t m_signalHandlerThread;
@@ -406,6 +407,33 @@ static void LoadGlobalConfig()
 
    UINT32 snmpTimeout = ConfigReadInt(_T("SNMPRequestTimeout"), 1500);
    SnmpSetDefaultTimeout(snmpTimeout);
+   SnmpSetBulkWalkOptions(ConfigReadBoolean(_T("SNMP.Walk.UseBulkRequests"), true), ConfigReadULong(_T("SNMP.Walk.MaxRepetitions"), 64));
+}
+
+/**
+ * Start asynchronous SNMP engine. When running, all SNMP requests to UDP
+ * transports are multiplexed over engine's shared sockets.
+ */
+static void StartSnmpEngine()
+{
+   int numSockets = ConfigReadInt(_T("SNMP.Engine.SharedSockets"), 4);
+   if (numSockets <= 0)
+   {
+      nxlog_debug(1, _T("Asynchronous SNMP engine disabled"));
+      return;
+   }
+
+   s_snmpEngine = new SNMP_AsyncEngine(numSockets);
+   if (s_snmpEngine->start())
+   {
+      SnmpSetDefaultAsyncEngine(s_snmpEngine);
+      nxlog_debug(1, _T("Asynchronous SNMP engine started"));
+   }
+   else
+   {
+      nxlog_write(NXLOG_WARNING, _T("Cannot start asynchronous SNMP engine, SNMP transports will use own sockets"));
+      delete_and_null(s_snmpEngine);
+   }
 }
 
 /**
@@ -909,6 +937,8 @@ BOOL NXCORE_EXPORTABLE Initialize()
    CASReadSettings();
    nxlog_debug(1, _T("Global configuration loaded"));
 
+   StartSnmpEngine();
+
    // Setup thread pool resize parameters
    ThreadPoolSetResizeParameters(
             ConfigReadInt(_T("ThreadPool.Global.Responsiveness"), 12),
@@ -1257,6 +1287,14 @@ void NXCORE_EXPORTABLE Shutdown()
    if (g_discoveryThreadPool != NULL)
       ThreadPoolDestroy(g_discoveryThreadPool);
 
+   // Engine object is not destroyed because other threads still may hold reference to it
+   if (s_snmpEngine != NULL)
+   {
+      SnmpSetDefaultAsyncEngine(NULL);
+      s_snmpEngine->stop();
+      nxlog_debug(1, _T("Asynchronous SNMP engine stopped"));
+   }
+
 	StopDBWriter();
 	nxlog_debug(1, _T("Database writer stopped"));
 
@@ -83,6 +83,9 @@ NetObj::NetObj()
    m_statusShift = 0;
    m_statusSingleThreshold = 75;
    m_timestamp = 0;
+   m_revision = NextObjectRevision();
+   for(int i = 0; i < 3; i++)
+      m_groupRevision[i] = m_revision;
    for(int i = 0; i < 4; i++)
    {
       m_statusTranslation[i] = i + 1;
@@ -493,17 +496,128 @@ bool NetObj::loadCommonProperties(DB_HANDLE hdb)
 }
 
 /**
- * Callback for saving custom attribute in database
+ * Custom attribute changes to be written to database
  */
-static EnumerationCallbackResult SaveAttributeCallback(const TCHAR *key, const CustomAttribute *value, DB_STATEMENT hStmt)
+struct CustomAttributeChanges
+{
+   StringObjectMap<CustomAttribute> *saved;     // Attributes stored in database (only deleted ones remain after comparison)
+   StringObjectMap<CustomAttribute> *updated;
+   StringObjectMap<CustomAttribute> *inserted;
+};
+
+/**
+ * Callback for comparing custom attribute with database content
+ */
+static EnumerationCallbackResult CompareAttributeCallback(const TCHAR *key, const CustomAttribute *value, CustomAttributeChanges *changes)
 {
    if(value->sourceObject != 0 && (value->flags & CAF_REDEFINED) == 0) //do not save inherited attributes
       return _CONTINUE;
 
-   DBBind(hStmt, 2, DB_SQLTYPE_VARCHAR, key, DB_BIND_STATIC);
-   DBBind(hStmt, 3, DB_SQLTYPE_VARCHAR, value->value, DB_BIND_STATIC);
-   DBBind(hStmt, 4, DB_SQLTYPE_INTEGER, value->flags);
-   return DBExecute(hStmt) ? _CONTINUE : _STOP;
+   CustomAttribute *saved = changes->saved->get(key);
+   if (saved == NULL)
+   {
+      changes->inserted->set(key, new CustomAttribute(value->value, value->flags));
+      return _CONTINUE;
+   }
+
+   if ((saved->flags != value->flags) || _tcscmp(saved->value.cstr(), value->value.cstr()))
+      changes->updated->set(key, new CustomAttribute(value->value, value->flags));
+   changes->saved->remove(key);
+   return _CONTINUE;
+}
+
+/**
+ * Callback for deleting custom attribute from database
+ */
+static EnumerationCallbackResult DeleteAttributeCallback(const TCHAR *key, const void *value, void *hStmt)
+{
+   DBBind(static_cast<DB_STATEMENT>(hStmt), 2, DB_SQLTYPE_VARCHAR, key, DB_BIND_STATIC);
+   return DBExecute(static_cast<DB_STATEMENT>(hStmt)) ? _CONTINUE : _STOP;
+}
+
+/**
+ * Callback for updating custom attribute in database
+ */
+static EnumerationCallbackResult UpdateAttributeCallback(const TCHAR *key, const void *value, void *hStmt)
+{
+   DBBind(static_cast<DB_STATEMENT>(hStmt), 1, DB_SQLTYPE_VARCHAR, static_cast<const CustomAttribute*>(value)->value, DB_BIND_STATIC);
+   DBBind(static_cast<DB_STATEMENT>(hStmt), 2, DB_SQLTYPE_INTEGER, static_cast<const CustomAttribute*>(value)->flags);
+   DBBind(static_cast<DB_STATEMENT>(hStmt), 4, DB_SQLTYPE_VARCHAR, key, DB_BIND_STATIC);
+   return DBExecute(static_cast<DB_STATEMENT>(hStmt)) ? _CONTINUE : _STOP;
+}
+
+/**
+ * Callback for saving custom attribute in database
+ */
+static EnumerationCallbackResult InsertAttributeCallback(const TCHAR *key, const void *value, void *hStmt)
+{
+   DBBind(static_cast<DB_STATEMENT>(hStmt), 2, DB_SQLTYPE_VARCHAR, key, DB_BIND_STATIC);
+   DBBind(static_cast<DB_STATEMENT>(hStmt), 3, DB_SQLTYPE_VARCHAR, static_cast<const CustomAttribute*>(value)->value, DB_BIND_STATIC);
+   DBBind(static_cast<DB_STATEMENT>(hStmt), 4, DB_SQLTYPE_INTEGER, static_cast<const CustomAttribute*>(value)->flags);
+   return DBExecute(static_cast<DB_STATEMENT>(hStmt)) ? _CONTINUE : _STOP;
+}
+
+/**
+ * Apply custom attribute changes to database
+ */
+static bool ApplyAttributeChanges(DB_HANDLE hdb, UINT32 objectId, const TCHAR *query, int idPos,
+         StringObjectMap<CustomAttribute> *attributes, EnumerationCallbackResult (*cb)(const TCHAR *, const void *, void *))
+{
+   if (attributes->isEmpty())
+      return true;
+
+   DB_STATEMENT hStmt = DBPrepare(hdb, query, attributes->size() > 1);
+   if (hStmt == NULL)
+      return false;
+
+   DBBind(hStmt, idPos, DB_SQLTYPE_INTEGER, objectId);
+   bool success = (attributes->forEach(cb, hStmt) == _CONTINUE);
+   DBFreeStatement(hStmt);
+   return success;
+}
+
+/**
+ * Save custom attributes to database. Current database content is compared with attributes
+ * in memory and only changed attributes are written.
+ */
+bool NetObj::saveCustomAttributes(DB_HANDLE hdb)
+{
+   DB_STATEMENT hStmt = DBPrepare(hdb, _T("SELECT attr_name,attr_value,flags FROM object_custom_attributes WHERE object_id=?"));
+   if (hStmt == NULL)
+      return false;
+   DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, m_id);
+   DB_RESULT hResult = DBSelectPrepared(hStmt);
+   DBFreeStatement(hStmt);
+   if (hResult == NULL)
+      return false;
+
+   StringObjectMap<CustomAttribute> saved(Ownership::True), updated(Ownership::True), inserted(Ownership::True);
+   int count = DBGetNumRows(hResult);
+   for(int i = 0; i < count; i++)
+   {
+      TCHAR *name = DBGetField(hResult, i, 0, NULL, 0);
+      if (name == NULL)
+         continue;
+      TCHAR *value = DBGetField(hResult, i, 1, NULL, 0);
+      saved.setPreallocated(name, new CustomAttribute(value, DBGetFieldULong(hResult, i, 2)));
+      MemFree(value);
+   }
+   DBFreeResult(hResult);
+
+   CustomAttributeChanges changes;
+   changes.saved = &saved;
+   changes.updated = &updated;
+   changes.inserted = &inserted;
+   forEachCustomAttribute(CompareAttributeCallback, &changes);
+
+   // Deletes go first so that re-inserted attribute cannot clash with old one on case insensitive collation
+   bool success = ApplyAttributeChanges(hdb, m_id, _T("DELETE FROM object_custom_attributes WHERE object_id=? AND attr_name=?"), 1, &saved, DeleteAttributeCallback) &&
+            ApplyAttributeChanges(hdb, m_id, _T("UPDATE object_custom_attributes SET attr_value=?,flags=? WHERE object_id=? AND attr_name=?"), 3, &updated, UpdateAttributeCallback) &&
+            ApplyAttributeChanges(hdb, m_id, _T("INSERT INTO object_custom_attributes (object_id,attr_name,attr_value,flags) VALUES (?,?,?,?)"), 1, &inserted, InsertAttributeCallback);
+
+   nxlog_debug_tag(_T("obj.sync"), 6, _T("NetObj::saveCustomAttributes(%s [%u]): %d deleted, %d updated, %d inserted"),
+            m_name, m_id, saved.size(), updated.size(), inserted.size());
+   return success;
 }
 
 /**
@@ -534,88 +648,81 @@ bool NetObj::saveModuleData(DB_HANDLE hdb)
 bool NetObj::saveCommonProperties(DB_HANDLE hdb)
 {
    // Save custom attributes
+   if ((m_modified & MODIFY_CUSTOM_ATTRIBUTES) && !saveCustomAttributes(hdb))
+      return false;
+
+   if (!(m_modified & (MODIFY_COMMON_PROPERTIES | MODIFY_ASSOCIATIONS)))
+      return saveModuleData(hdb);
+
    bool success = true;
-   if (m_modified & MODIFY_CUSTOM_ATTRIBUTES)
-   {
-      success = executeQueryOnObject(hdb, _T("DELETE FROM object_custom_attributes WHERE object_id=?"));
-      if (success && getCustomAttributeSize() != 0)
+   if (m_modified & MODIFY_COMMON_PROPERTIES)
+   {
+      static const TCHAR *columns[] = {
+         _T("name"), _T("status"), _T("is_deleted"), _T("inherit_access_rights"), _T("last_modified"), _T("status_calc_alg"),
+         _T("status_prop_alg"), _T("status_fixed_val"), _T("status_shift"), _T("status_translation"), _T("status_single_threshold"),
+         _T("status_thresholds"), _T("comments"), _T("is_system"), _T("location_type"), _T("latitude"), _T("longitude"),
+         _T("location_accuracy"), _T("location_timestamp"), _T("guid"), _T("image"), _T("submap_id"), _T("country"), _T("city"),
+         _T("street_address"), _T("postcode"), _T("maint_event_id"), _T("state_before_maint"), _T("state"), _T("flags"),
+         _T("creation_time"), NULL
+      };
+
+      DB_STATEMENT hStmt = DBPrepareMerge(hdb, _T("object_properties"), _T("object_id"), m_id, columns);
+      if (hStmt == NULL)
+         return false;
+
+      TCHAR szTranslation[16], szThresholds[16], lat[32], lon[32];
+      for(int i = 0, j = 0; i < 4; i++, j += 2)
       {
-         DB_STATEMENT hStmt = DBPrepare(hdb, _T("INSERT INTO object_custom_attributes (object_id,attr_name,attr_value,flags) VALUES (?,?,?,?)"), true);
-         if (hStmt != NULL)
-         {
-            DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, m_id);
-            success = (forEachCustomAttribute(SaveAttributeCallback, hStmt) == _CONTINUE);
-            DBFreeStatement(hStmt);
-         }
-         else
-         {
-            success = false;
-         }
+         _sntprintf(&szTranslation[j], 16 - j, _T("%02X"), (BYTE)m_statusTranslation[i]);
+         _sntprintf(&szThresholds[j], 16 - j, _T("%02X"), (BYTE)m_statusThresholds[i]);
       }
-      if (!success)
-         return false;
-   }
+      _sntprintf(lat, 32, _T("%f"), m_geoLocation.getLatitude());
+      _sntprintf(lon, 32, _T("%f"), m_geoLocation.getLongitude());
 
-   if (!(m_modified & MODIFY_COMMON_PROPERTIES))
-      return saveModuleData(hdb);
+      DBBind(hStmt, 1, DB_SQLTYPE_VARCHAR, m_name, DB_BIND_STATIC);
+      DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, (LONG)m_status);
+      DBBind(hStmt, 3, DB_SQLTYPE_INTEGER, (LONG)(m_isDeleted ? 1 : 0));
+      DBBind(hStmt, 4, DB_SQLTYPE_INTEGER, (LONG)(m_inheritAccessRights ? 1 : 0));
+      DBBind(hStmt, 5, DB_SQLTYPE_INTEGER, (LONG)m_timestamp);
+      DBBind(hStmt, 6, DB_SQLTYPE_INTEGER, (LONG)m_statusCalcAlg);
+      DBBind(hStmt, 7, DB_SQLTYPE_INTEGER, (LONG)m_statusPropAlg);
+      DBBind(hStmt, 8, DB_SQLTYPE_INTEGER, (LONG)m_fixedStatus);
+      DBBind(hStmt, 9, DB_SQLTYPE_INTEGER, (LONG)m_statusShift);
+      DBBind(hStmt, 10, DB_SQLTYPE_VARCHAR, szTranslation, DB_BIND_STATIC);
+      DBBind(hStmt, 11, DB_SQLTYPE_INTEGER, (LONG)m_statusSingleThreshold);
+      DBBind(hStmt, 12, DB_SQLTYPE_VARCHAR, szThresholds, DB_BIND_STATIC);
+      DBBind(hStmt, 13, DB_SQLTYPE_VARCHAR, m_comments, DB_BIND_STATIC);
+      DBBind(hStmt, 14, DB_SQLTYPE_INTEGER, (LONG)(m_isSystem ? 1 : 0));
+      DBBind(hStmt, 15, DB_SQLTYPE_INTEGER, (LONG)m_geoLocation.getType());
+      DBBind(hStmt, 16, DB_SQLTYPE_VARCHAR, lat, DB_BIND_STATIC);
+      DBBind(hStmt, 17, DB_SQLTYPE_VARCHAR, lon, DB_BIND_STATIC);
+      DBBind(hStmt, 18, DB_SQLTYPE_INTEGER, (LONG)m_geoLocation.getAccuracy());
+      DBBind(hStmt, 19, DB_SQLTYPE_INTEGER, (UINT32)m_geoLocation.getTimestamp());
+      DBBind(hStmt, 20, DB_SQLTYPE_VARCHAR, m_guid);
+      DBBind(hStmt, 21, DB_SQLTYPE_VARCHAR, m_image);
+      DBBind(hStmt, 22, DB_SQLTYPE_INTEGER, m_submapId);
+      DBBind(hStmt, 23, DB_SQLTYPE_VARCHAR, m_postalAddress->getCountry(), DB_BIND_STATIC);
+      DBBind(hStmt, 24, DB_SQLTYPE_VARCHAR, m_postalAddress->getCity(), DB_BIND_STATIC);
+      DBBind(hStmt, 25, DB_SQLTYPE_VARCHAR, m_postalAddress->getStreetAddress(), DB_BIND_STATIC);
+      DBBind(hStmt, 26, DB_SQLTYPE_VARCHAR, m_postalAddress->getPostCode(), DB_BIND_STATIC);
+      DBBind(hStmt, 27, DB_SQLTYPE_BIGINT, m_maintenanceEventId);
+      DBBind(hStmt, 28, DB_SQLTYPE_INTEGER, m_stateBeforeMaintenance);
+      DBBind(hStmt, 29, DB_SQLTYPE_INTEGER, m_state);
+      DBBind(hStmt, 30, DB_SQLTYPE_INTEGER, m_flags);
+      DBBind(hStmt, 31, DB_SQLTYPE_INTEGER, (LONG)m_creationTime);
+      DBBind(hStmt, 32, DB_SQLTYPE_INTEGER, m_id);
 
-   static const TCHAR *columns[] = {
-      _T("name"), _T("status"), _T("is_deleted"), _T("inherit_access_rights"), _T("last_modified"), _T("status_calc_alg"),
-      _T("status_prop_alg"), _T("status_fixed_val"), _T("status_shift"), _T("status_translation"), _T("status_single_threshold"),
-      _T("status_thresholds"), _T("comments"), _T("is_system"), _T("location_type"), _T("latitude"), _T("longitude"),
-      _T("location_accuracy"), _T("location_timestamp"), _T("guid"), _T("image"), _T("submap_id"), _T("country"), _T("city"),
-      _T("street_address"), _T("postcode"), _T("maint_event_id"), _T("state_before_maint"), _T("state"), _T("flags"),
-      _T("creation_time"), NULL
-   };
+      success = DBExecute(hStmt);
+      DBFreeStatement(hStmt);
+   }
 
-	DB_STATEMENT hStmt = DBPrepareMerge(hdb, _T("object_properties"), _T("object_id"), m_id, columns);
-	if (hStmt == NULL)
-		return false;
+   if (!success)
+      return false;
 
-   TCHAR szTranslation[16], szThresholds[16], lat[32], lon[32];
-   for(int i = 0, j = 0; i < 4; i++, j += 2)
-   {
-      _sntprintf(&szTranslation[j], 16 - j, _T("%02X"), (BYTE)m_statusTranslation[i]);
-      _sntprintf(&szThresholds[j], 16 - j, _T("%02X"), (BYTE)m_statusThresholds[i]);
-   }
-	_sntprintf(lat, 32, _T("%f"), m_geoLocation.getLatitude());
-	_sntprintf(lon, 32, _T("%f"), m_geoLocation.getLongitude());
-
-	DBBind(hStmt, 1, DB_SQLTYPE_VARCHAR, m_name, DB_BIND_STATIC);
-	DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, (LONG)m_status);
-   DBBind(hStmt, 3, DB_SQLTYPE_INTEGER, (LONG)(m_isDeleted ? 1 : 0));
-	DBBind(hStmt, 4, DB_SQLTYPE_INTEGER, (LONG)(m_inheritAccessRights ? 1 : 0));
-	DBBind(hStmt, 5, DB_SQLTYPE_INTEGER, (LONG)m_timestamp);
-	DBBind(hStmt, 6, DB_SQLTYPE_INTEGER, (LONG)m_statusCalcAlg);
-	DBBind(hStmt, 7, DB_SQLTYPE_INTEGER, (LONG)m_statusPropAlg);
-	DBBind(hStmt, 8, DB_SQLTYPE_INTEGER, (LONG)m_fixedStatus);
-	DBBind(hStmt, 9, DB_SQLTYPE_INTEGER, (LONG)m_statusShift);
-	DBBind(hStmt, 10, DB_SQLTYPE_VARCHAR, szTranslation, DB_BIND_STATIC);
-	DBBind(hStmt, 11, DB_SQLTYPE_INTEGER, (LONG)m_statusSingleThreshold);
-	DBBind(hStmt, 12, DB_SQLTYPE_VARCHAR, szThresholds, DB_BIND_STATIC);
-	DBBind(hStmt, 13, DB_SQLTYPE_VARCHAR, m_comments, DB_BIND_STATIC);
-   DBBind(hStmt, 14, DB_SQLTYPE_INTEGER, (LONG)(m_isSystem ? 1 : 0));
-	DBBind(hStmt, 15, DB_SQLTYPE_INTEGER, (LONG)m_geoLocation.getType());
-	DBBind(hStmt, 16, DB_SQLTYPE_VARCHAR, lat, DB_BIND_STATIC);
-	DBBind(hStmt, 17, DB_SQLTYPE_VARCHAR, lon, DB_BIND_STATIC);
-	DBBind(hStmt, 18, DB_SQLTYPE_INTEGER, (LONG)m_geoLocation.getAccuracy());
-	DBBind(hStmt, 19, DB_SQLTYPE_INTEGER, (UINT32)m_geoLocation.getTimestamp());
-	DBBind(hStmt, 20, DB_SQLTYPE_VARCHAR, m_guid);
-	DBBind(hStmt, 21, DB_SQLTYPE_VARCHAR, m_image);
-	DBBind(hStmt, 22, DB_SQLTYPE_INTEGER, m_submapId);
-	DBBind(hStmt, 23, DB_SQLTYPE_VARCHAR, m_postalAddress->getCountry(), DB_BIND_STATIC);
-	DBBind(hStmt, 24, DB_SQLTYPE_VARCHAR, m_postalAddress->getCity(), DB_BIND_STATIC);
-	DBBind(hStmt, 25, DB_SQLTYPE_VARCHAR, m_postalAddress->getStreetAddress(), DB_BIND_STATIC);
-	DBBind(hStmt, 26, DB_SQLTYPE_VARCHAR, m_postalAddress->getPostCode(), DB_BIND_STATIC);
-   DBBind(hStmt, 27, DB_SQLTYPE_BIGINT, m_maintenanceEventId);
-   DBBind(hStmt, 28, DB_SQLTYPE_INTEGER, m_stateBeforeMaintenance);
-	DBBind(hStmt, 29, DB_SQLTYPE_INTEGER, m_state);
-	DBBind(hStmt, 30, DB_SQLTYPE_INTEGER, m_flags);
-	DBBind(hStmt, 31, DB_SQLTYPE_INTEGER, (LONG)m_creationTime);
-	DBBind(hStmt, 32, DB_SQLTYPE_INTEGER, m_id);
-
-   success = DBExecute(hStmt);
-	DBFreeStatement(hStmt);
+   if (!(m_modified & MODIFY_ASSOCIATIONS))
+      return saveModuleData(hdb);
+
+   DB_STATEMENT hStmt;
 
    // Save dashboard associations
    if (success)
@@ -716,6 +823,7 @@ void NetObj::addChild(NetObj *object)
    super::addChild(object);
 	incRefCount();
 	markAsModified(MODIFY_RELATIONS);
+   InvalidateObjectRevisions();  // Inherited access rights may change
    DbgPrintf(7, _T("NetObj::addChild: this=%s [%d]; object=%s [%d]"), m_name, m_id, object->m_name, object->m_id);
 }
 
@@ -727,6 +835,7 @@ void NetObj::addParent(NetObj *object)
    super::addParent(object);
 	incRefCount();
 	markAsModified(MODIFY_RELATIONS);
+   InvalidateObjectRevisions();  // Inherited access rights may change
    DbgPrintf(7, _T("NetObj::addParent: this=%s [%d]; object=%s [%d]"), m_name, m_id, object->m_name, object->m_id);
 }
 
@@ -739,6 +848,7 @@ void NetObj::deleteChild(NetObj *object)
    super::deleteChild(object);
 	decRefCount();
 	markAsModified(MODIFY_RELATIONS);
+   InvalidateObjectRevisions();  // Inherited access rights may change
 }
 
 /**
@@ -750,6 +860,7 @@ void NetObj::deleteParent(NetObj *object)
    super::deleteParent(object);
 	decRefCount();
 	markAsModified(MODIFY_RELATIONS);
+   InvalidateObjectRevisions();  // Inherited access rights may change
 }
 
 /**
@@ -894,7 +1005,7 @@ void NetObj::onObjectDelete(UINT32 objectId)
       {
          nxlog_debug(5, _T("NetObj::onObjectDelete(%s [%u]): deleted object %u was listed as trusted node"), m_name, m_id, objectId);
          m_trustedNodes->remove(index);
-         setModified(MODIFY_COMMON_PROPERTIES);
+         setModified(MODIFY_ASSOCIATIONS);
       }
    }
    unlockProperties();
@@ -1096,45 +1207,130 @@ bool NetObj::loadACLFromDB(DB_HANDLE hdb)
 }
 
 /**
- * ACL enumeration parameters structure
+ * ACL elements as two parallel arrays
  */
-struct SAVE_PARAM
+struct ACLElements
 {
-   DB_HANDLE hdb;
-   UINT32 dwObjectId;
+   IntegerArray<UINT32> users;
+   IntegerArray<UINT32> rights;
 };
 
 /**
  * Handler for ACL elements enumeration
  */
-static void EnumerationHandler(UINT32 dwUserId, UINT32 dwAccessRights, void *pArg)
+static void CopyACLElement(UINT32 userId, UINT32 accessRights, void *context)
 {
-   TCHAR szQuery[256];
-
-   _sntprintf(szQuery, sizeof(szQuery) / sizeof(TCHAR), _T("INSERT INTO acl (object_id,user_id,access_rights) VALUES (%d,%d,%d)"),
-           ((SAVE_PARAM *)pArg)->dwObjectId, dwUserId, dwAccessRights);
-   DBQuery(((SAVE_PARAM *)pArg)->hdb, szQuery);
+   static_cast<ACLElements*>(context)->users.add(userId);
+   static_cast<ACLElements*>(context)->rights.add(accessRights);
 }
 
 /**
- * Save ACL to database
+ * Save ACL to database. Current database content is compared with ACL in memory
+ * and only changed elements are written.
  */
 bool NetObj::saveACLToDB(DB_HANDLE hdb)
 {
    if (!(m_modified & MODIFY_ACCESS_LIST))
       return true;
 
-   bool success = executeQueryOnObject(hdb, _T("DELETE FROM acl WHERE object_id=?"));
-   if (success)
+   DB_STATEMENT hStmt = DBPrepare(hdb, _T("SELECT user_id,access_rights FROM acl WHERE object_id=?"));
+   if (hStmt == NULL)
+      return false;
+   DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, m_id);
+   DB_RESULT hResult = DBSelectPrepared(hStmt);
+   DBFreeStatement(hStmt);
+   if (hResult == NULL)
+      return false;
+
+   ACLElements current;
+   lockACL();
+   m_accessList->enumerateElements(CopyACLElement, &current);
+   unlockACL();
+
+   // After this loop current contains only elements missing in database
+   ACLElements deleted, updated;
+   int count = DBGetNumRows(hResult);
+   for(int i = 0; i < count; i++)
+   {
+      UINT32 userId = DBGetFieldULong(hResult, i, 0);
+      int index = current.users.indexOf(userId);
+      if (index == -1)
+      {
+         deleted.users.add(userId);
+         continue;
+      }
+      if (current.rights.get(index) != DBGetFieldULong(hResult, i, 1))
+      {
+         updated.users.add(userId);
+         updated.rights.add(current.rights.get(index));
+      }
+      current.users.remove(index);
+      current.rights.remove(index);
+   }
+   DBFreeResult(hResult);
+
+   bool success = true;
+   if (!deleted.users.isEmpty())
    {
-      SAVE_PARAM sp;
-      sp.dwObjectId = m_id;
-      sp.hdb = hdb;
+      hStmt = DBPrepare(hdb, _T("DELETE FROM acl WHERE object_id=? AND user_id=?"), deleted.users.size() > 1);
+      if (hStmt != NULL)
+      {
+         DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, m_id);
+         for(int i = 0; success && (i < deleted.users.size()); i++)
+         {
+            DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, deleted.users.get(i));
+            success = DBExecute(hStmt);
+         }
+         DBFreeStatement(hStmt);
+      }
+      else
+      {
+         success = false;
+      }
+   }
 
-      lockACL();
-      m_accessList->enumerateElements(EnumerationHandler, &sp);
-      unlockACL();
+   if (success && !updated.users.isEmpty())
+   {
+      hStmt = DBPrepare(hdb, _T("UPDATE acl SET access_rights=? WHERE object_id=? AND user_id=?"), updated.users.size() > 1);
+      if (hStmt != NULL)
+      {
+         DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, m_id);
+         for(int i = 0; success && (i < updated.users.size()); i++)
+         {
+            DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, updated.rights.get(i));
+            DBBind(hStmt, 3, DB_SQLTYPE_INTEGER, updated.users.get(i));
+            success = DBExecute(hStmt);
+         }
+         DBFreeStatement(hStmt);
+      }
+      else
+      {
+         success = false;
+      }
    }
+
+   if (success && !current.users.isEmpty())
+   {
+      hStmt = DBPrepare(hdb, _T("INSERT INTO acl (object_id,user_id,access_rights) VALUES (?,?,?)"), current.users.size() > 1);
+      if (hStmt != NULL)
+      {
+         DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, m_id);
+         for(int i = 0; success && (i < current.users.size()); i++)
+         {
+            DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, current.users.get(i));
+            DBBind(hStmt, 3, DB_SQLTYPE_INTEGER, current.rights.get(i));
+            success = DBExecute(hStmt);
+         }
+         DBFreeStatement(hStmt);
+      }
+      else
+      {
+         success = false;
+      }
+   }
+
+   nxlog_debug_tag(_T("obj.sync"), 6, _T("NetObj::saveACLToDB(%s [%u]): %d deleted, %d updated, %d inserted"),
+            m_name, m_id, deleted.users.size(), updated.users.size(), current.users.size());
    return success;
 }
 
@@ -1268,35 +1464,75 @@ void NetObj::fillMessageInternalStage2(NXCPMessage *pMsg, UINT32 userId)
 /**
  * Fill NXCP message with object's data
  */
-void NetObj::fillMessage(NXCPMessage *msg, UINT32 userId)
+void NetObj::fillMessage(NXCPMessage *msg, UINT32 userId, UINT32 groups)
 {
-   lockProperties();
-   fillMessageInternal(msg, userId);
-   unlockProperties();
-   fillMessageInternalStage2(msg, userId);
+   if (groups & OBJECT_UPDATE_PROPERTIES)
+   {
+      lockProperties();
+      fillMessageInternal(msg, userId);
+      unlockProperties();
+      fillMessageInternalStage2(msg, userId);
 
-   lockACL();
-   m_accessList->fillMessage(msg);
-   unlockACL();
+      lockResponsibleUsersList(false);
+      msg->setFieldFromInt32Array(VID_RESPONSIBLE_USERS, m_responsibleUsers);
+      unlockResponsibleUsersList();
+   }
+   else
+   {
+      msg->setField(VID_OBJECT_CLASS, (WORD)getObjectClass());
+      msg->setField(VID_OBJECT_ID, m_id);
+   }
 
-   UINT32 dwId;
-   int i;
+   if (groups & OBJECT_UPDATE_ACCESS_LIST)
+   {
+      lockACL();
+      m_accessList->fillMessage(msg);
+      unlockACL();
+   }
 
-   lockParentList(false);
-   msg->setField(VID_PARENT_CNT, getParentList()->size());
-   for(i = 0, dwId = VID_PARENT_ID_BASE; i < getParentList()->size(); i++, dwId++)
-      msg->setField(dwId, static_cast<NetObj *>(getParentList()->get(i))->getId());
-   unlockParentList();
+   if (groups & OBJECT_UPDATE_RELATIONS)
+   {
+      UINT32 dwId;
+      int i;
 
-   lockChildList(false);
-   msg->setField(VID_CHILD_CNT, getChildList()->size());
-   for(i = 0, dwId = VID_CHILD_ID_BASE; i < getChildList()->size(); i++, dwId++)
-      msg->setField(dwId, static_cast<NetObj *>(getChildList()->get(i))->getId());
-   unlockChildList();
+      lockParentList(false);
+      msg->setField(VID_PARENT_CNT, getParentList()->size());
+      for(i = 0, dwId = VID_PARENT_ID_BASE; i < getParentList()->size(); i++, dwId++)
+         msg->setField(dwId, static_cast<NetObj *>(getParentList()->get(i))->getId());
+      unlockParentList();
 
-   lockResponsibleUsersList(false);
-   msg->setFieldFromInt32Array(VID_RESPONSIBLE_USERS, m_responsibleUsers);
-   unlockResponsibleUsersList();
+      lockChildList(false);
+      msg->setField(VID_CHILD_CNT, getChildList()->size());
+      for(i = 0, dwId = VID_CHILD_ID_BASE; i < getChildList()->size(); i++, dwId++)
+         msg->setField(dwId, static_cast<NetObj *>(getChildList()->get(i))->getId());
+      unlockChildList();
+   }
+
+   if (groups != OBJECT_UPDATE_ALL)
+      msg->setField(VID_OBJECT_UPDATE_GROUPS, groups);
+   msg->setField(VID_OBJECT_REVISION, m_revision);
+}
+
+/**
+ * Get property groups changed after given revision
+ */
+UINT32 NetObj::getChangedGroups(UINT64 baseRevision) const
+{
+   UINT32 groups = 0;
+   for(int i = 0; i < 3; i++)
+      if (m_groupRevision[i] >= baseRevision)
+         groups |= (1 << i);
+   return groups;
+}
+
+/**
+ * Check if object's NXCP message contains user specific data (other than
+ * data masked based on object access rights). Default implementation
+ * always returns false.
+ */
+bool NetObj::hasUserSpecificData()
+{
+   return false;
 }
 
 /**
@@ -1307,12 +1543,32 @@ static void BroadcastObjectChange(ClientSession *session, void *context)
    session->onObjectChange(static_cast<NetObj*>(context));
 }
 
+/**
+ * Update object revision and revisions of property groups affected by given modification flags.
+ * Should be called on any change visible to clients, including ones not saved to database.
+ */
+void NetObj::updateRevision(UINT32 flags)
+{
+   UINT64 revision = NextObjectRevision();
+   UINT32 groups = ObjectModificationFlagsToUpdateGroups(flags);
+   for(int i = 0; i < 3; i++)
+      if (groups & (1 << i))
+         m_groupRevision[i] = revision;
+   m_revision = revision;
+}
+
 /**
  * Mark object as modified and put on client's notification queue
  * We assume that object is locked at the time of function call
  */
 void NetObj::setModified(UINT32 flags, bool notify)
 {
+   // Revision should be updated even if modifications are locked because
+   // in-memory object still changes and resuming clients should get it
+   updateRevision(flags);
+   if (flags & MODIFY_DATA_COLLECTION)
+      invalidateUserSpecificData();
+
    if (g_bModificationsLocked)
       return;
 
@@ -1380,6 +1636,7 @@ UINT32 NetObj::modifyFromMessageInternal(NXCPMessage *pRequest)
          m_accessList->addElement(pRequest->getFieldAsUInt32(VID_ACL_USER_BASE + i),
                                   pRequest->getFieldAsUInt32(VID_ACL_RIGHTS_BASE + i));
       unlockACL();
+      InvalidateObjectRevisions();
    }
 
 	// Change trusted nodes list
@@ -1554,6 +1811,7 @@ void NetObj::dropUserAccess(UINT32 dwUserId)
       lockProperties();
       setModified(MODIFY_ACCESS_LIST);
       unlockProperties();
+      InvalidateObjectRevisions();
    }
 }
 
@@ -1704,6 +1962,7 @@ void NetObj::unhide()
 {
    lockProperties();
    m_isHidden = false;
+   updateRevision(MODIFY_ALL);   // object was not visible to clients, so resuming clients should get it
    if (!m_isSystem)
       EnumerateClientSessions(BroadcastObjectChange, this);
    unlockProperties();
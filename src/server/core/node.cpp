@@ -57,6 +57,7 @@ ObjectArray<SoftwarePackage> *CalculatePackageChanges(ObjectArray<SoftwarePackag
  * Hardware inventory management functions
  */
 int HardwareComponentComparator(const HardwareComponent **c1, const HardwareComponent **c2);
+int HardwareComponentKeyComparator(const HardwareComponent **c1, const HardwareComponent **c2);
 ObjectArray<HardwareComponent> *CalculateHardwareChanges(ObjectArray<HardwareComponent> *oldSet, ObjectArray<HardwareComponent> *newSet);
 
 /**
@@ -834,6 +835,115 @@ static EnumerationCallbackResult SaveIcmpStatCollector(const TCHAR *target, cons
    return collector->saveToDatabase(context->second, context->first, target) ? _CONTINUE : _STOP;
 }
 
+/**
+ * Save inventory list (software packages or hardware components) to database. Current database content
+ * is read and compared with given list, and only rows that were removed, added, or changed are written.
+ * Comparator should compare only fields that form primary key of inventory table.
+ */
+template<typename T> static bool SaveInventory(DB_HANDLE hdb, UINT32 nodeId, const ObjectArray<T> *inventory,
+         int (*comparator)(const T **, const T **), const TCHAR *selectQuery, const TCHAR *deleteQuery, const TCHAR *insertQuery)
+{
+   DB_STATEMENT hStmt = DBPrepare(hdb, selectQuery);
+   if (hStmt == NULL)
+      return false;
+   DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, nodeId);
+   DB_RESULT hResult = DBSelectPrepared(hStmt);
+   DBFreeStatement(hStmt);
+   if (hResult == NULL)
+      return false;
+
+   int count = DBGetNumRows(hResult);
+   ObjectArray<T> saved(std::max(count, 16), 16, Ownership::True);
+   for(int i = 0; i < count; i++)
+      saved.add(new T(hResult, i));
+   DBFreeResult(hResult);
+   saved.sort(comparator);
+
+   ObjectArray<T> current((inventory != NULL) ? std::max(inventory->size(), 16) : 16, 16, Ownership::False);
+   if (inventory != NULL)
+   {
+      for(int i = 0; i < inventory->size(); i++)
+         current.add(inventory->get(i));
+   }
+   current.sort(comparator);
+
+   // Merge both sorted lists to find changed rows
+   ObjectArray<T> deleteList(16, 16, Ownership::False);
+   ObjectArray<T> insertList(16, 16, Ownership::False);
+   int i = 0, j = 0;
+   while((i < saved.size()) || (j < current.size()))
+   {
+      const T *s = saved.get(i);  // get() returns NULL for out of range index
+      const T *c = current.get(j);
+      if ((c != NULL) && (j > 0))
+      {
+         const T *p = current.get(j - 1);
+         if (comparator(&p, &c) == 0)
+         {
+            j++;  // ignore duplicate keys - only first element can be stored
+            continue;
+         }
+      }
+
+      int rc = (s == NULL) ? 1 : ((c == NULL) ? -1 : comparator(&s, &c));
+      if (rc < 0)
+      {
+         deleteList.add(saved.get(i++));
+      }
+      else if (rc > 0)
+      {
+         insertList.add(current.get(j++));
+      }
+      else
+      {
+         if (!s->equals(c))
+         {
+            deleteList.add(saved.get(i));
+            insertList.add(current.get(j));
+         }
+         i++;
+         j++;
+      }
+   }
+
+   bool success = true;
+   if (!deleteList.isEmpty())
+   {
+      hStmt = DBPrepare(hdb, deleteQuery, deleteList.size() > 1);
+      if (hStmt != NULL)
+      {
+         DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, nodeId);
+         for(int k = 0; success && (k < deleteList.size()); k++)
+            success = deleteList.get(k)->deleteFromDatabase(hStmt);
+         DBFreeStatement(hStmt);
+      }
+      else
+      {
+         success = false;
+      }
+   }
+
+   if (success && !insertList.isEmpty())
+   {
+      hStmt = DBPrepare(hdb, insertQuery, insertList.size() > 1);
+      if (hStmt != NULL)
+      {
+         DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, nodeId);
+         for(int k = 0; success && (k < insertList.size()); k++)
+            success = insertList.get(k)->saveToDatabase(hStmt);
+         DBFreeStatement(hStmt);
+      }
+      else
+      {
+         success = false;
+      }
+   }
+
+   nxlog_debug_tag(_T("obj.sync"), 6, _T("SaveInventory(%u): %d rows in database, %d rows deleted, %d rows inserted"),
+            nodeId, count, deleteList.size(), insertList.size());
+   return success;
+}
+
 /**
  * Save object to database
  */
@@ -1001,42 +1111,18 @@ bool Node::saveToDatabase(DB_HANDLE hdb)
 
    if (success && (m_modified & MODIFY_SOFTWARE_INVENTORY))
    {
-      success = executeQueryOnObject(hdb, _T("DELETE FROM software_inventory WHERE node_id=?"));
-      if ((m_softwarePackages != NULL) && !m_softwarePackages->isEmpty())
-      {
-         DB_STATEMENT hStmt = DBPrepare(hdb,
-                  _T("INSERT INTO software_inventory (node_id,name,version,vendor,install_date,url,description) VALUES (?,?,?,?,?,?,?)"),
-                  m_softwarePackages->size() > 1);
-         if (hStmt != NULL)
-         {
-            DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, m_id);
-            for(int i = 0; success && (i < m_softwarePackages->size()); i++)
-               success = m_softwarePackages->get(i)->saveToDatabase(hStmt);
-            DBFreeStatement(hStmt);
-         }
-         else
-         {
-            success = false;
-         }
-      }
+      success = SaveInventory(hdb, m_id, m_softwarePackages, PackageNameVersionComparator,
+               _T("SELECT name,version,vendor,install_date,url,description FROM software_inventory WHERE node_id=?"),
+               _T("DELETE FROM software_inventory WHERE node_id=? AND name=? AND version=?"),
+               _T("INSERT INTO software_inventory (node_id,name,version,vendor,install_date,url,description) VALUES (?,?,?,?,?,?,?)"));
    }
 
    if (success && (m_modified & MODIFY_HARDWARE_INVENTORY))
    {
-      success = executeQueryOnObject(hdb, _T("DELETE FROM hardware_inventory WHERE node_id=?"));
-      if (success && (m_hardwareComponents != NULL) && !m_hardwareComponents->isEmpty())
-      {
-         DB_STATEMENT hStmt = DBPrepare(hdb,
-                  _T("INSERT INTO hardware_inventory (node_id,category,component_index,hw_type,vendor,model,location,capacity,part_number,serial_number,description) VALUES (?,?,?,?,?,?,?,?,?,?,?)"),
-                  m_hardwareComponents->size() > 1);
-         if (hStmt != NULL)
-         {
-            DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, m_id);
-            for(int i = 0; success && i < m_hardwareComponents->size(); i++)
-               success = m_hardwareComponents->get(i)->saveToDatabase(hStmt);
-            DBFreeStatement(hStmt);
-         }
-      }
+      success = SaveInventory(hdb, m_id, m_hardwareComponents, HardwareComponentKeyComparator,
+               _T("SELECT category,component_index,hw_type,vendor,model,location,capacity,part_number,serial_number,description FROM hardware_inventory WHERE node_id=?"),
+               _T("DELETE FROM hardware_inventory WHERE node_id=? AND category=? AND component_index=?"),
+               _T("INSERT INTO hardware_inventory (node_id,category,component_index,hw_type,vendor,model,location,capacity,part_number,serial_number,description) VALUES (?,?,?,?,?,?,?,?,?,?,?)"));
    }
 
    unlockProperties();
@@ -5402,112 +5488,98 @@ DataCollectionError Node::getItemFromSNMP(UINT16 port, SNMP_Version version, con
 }
 
 /**
- * Read one row for SNMP table
+ * Context for SNMP table walk in Node::getTableFromSNMP
  */
-static UINT32 ReadSNMPTableRow(SNMP_Transport *snmp, const SNMP_ObjectId *rowOid, size_t baseOidLen, UINT32 index,
-                               ObjectArray<DCTableColumn> *columns, Table *table)
+struct SNMPTableWalkContext
 {
-   SNMP_PDU request(SNMP_GET_REQUEST, SnmpNewRequestId(), snmp->getSnmpVersion());
-   for(int i = 0; i < columns->size(); i++)
+   ObjectArray<DCTableColumn> columns;   // Table columns with SNMP OID
+   IntegerArray<int> valueIndex;         // Position of column's value in walked row
+   Table *table;
+
+   SNMPTableWalkContext() : columns(16, 16, Ownership::False), valueIndex(16, 16) { table = NULL; }
+};
+
+/**
+ * Row handler for SnmpWalkTable in Node::getTableFromSNMP. Rows which do not exist in instance column are ignored.
+ */
+static UINT32 SNMPGetTableRowCallback(SNMP_Variable **values, const UINT32 *index, size_t indexLen, SNMP_Transport *snmp, void *arg)
+{
+   SNMPTableWalkContext *context = static_cast<SNMPTableWalkContext*>(arg);
+   if (values[0] == NULL)
+      return SNMP_ERR_SUCCESS;
+
+   Table *table = context->table;
+   table->addRow();
+   for(int i = 0; i < context->columns.size(); i++)
    {
-      DCTableColumn *c = columns->get(i);
-      if (c->getSnmpOid() != NULL)
+      SNMP_Variable *v = values[context->valueIndex.get(i)];
+      if ((v == NULL) || (v->getType() == ASN_NO_SUCH_OBJECT) || (v->getType() == ASN_NO_SUCH_INSTANCE))
+         continue;
+
+      DCTableColumn *c = context->columns.get(i);
+      if (c->isConvertSnmpStringToHex())
       {
-         UINT32 oid[MAX_OID_LEN];
-         size_t oidLen = c->getSnmpOid()->length();
-         memcpy(oid, c->getSnmpOid()->value(), oidLen * sizeof(UINT32));
-         if (rowOid != NULL)
-         {
-            size_t suffixLen = rowOid->length() - baseOidLen;
-            memcpy(&oid[oidLen], rowOid->value() + baseOidLen, suffixLen * sizeof(UINT32));
-            oidLen += suffixLen;
-         }
-         else
-         {
-            oid[oidLen++] = index;
-         }
-         request.bindVariable(new SNMP_Variable(oid, oidLen));
+         size_t size = v->getValueLength();
+         TCHAR *buffer = (TCHAR *)malloc((size * 2 + 1) * sizeof(TCHAR));
+         BinToStr(v->getValue(), size, buffer);
+         table->setPreallocated(i, buffer);
       }
-   }
-
-   SNMP_PDU *response;
-   UINT32 rc = snmp->doRequest(&request, &response, SnmpGetDefaultTimeout(), 3);
-   if (rc == SNMP_ERR_SUCCESS)
-   {
-      if (((int)response->getNumVariables() >= columns->size()) &&
-          (response->getErrorCode() == SNMP_PDU_ERR_SUCCESS))
+      else
       {
-         table->addRow();
-         for(int i = 0; i < response->getNumVariables(); i++)
-         {
-            SNMP_Variable *v = response->getVariable(i);
-            if ((v != NULL) && (v->getType() != ASN_NO_SUCH_OBJECT) && (v->getType() != ASN_NO_SUCH_INSTANCE))
-            {
-               DCTableColumn *c = columns->get(i);
-               if ((c != NULL) && c->isConvertSnmpStringToHex())
-               {
-                  size_t size = v->getValueLength();
-                  TCHAR *buffer = (TCHAR *)malloc((size * 2 + 1) * sizeof(TCHAR));
-                  BinToStr(v->getValue(), size, buffer);
-                  table->set(i, buffer);
-               }
-               else
-               {
-                  bool convert = false;
-                  TCHAR buffer[256];
-                  table->set(i, v->getValueAsPrintableString(buffer, 256, &convert));
-               }
-            }
-         }
+         bool convert = false;
+         TCHAR buffer[256];
+         table->set(i, v->getValueAsPrintableString(buffer, 256, &convert));
       }
-      delete response;
    }
-   return rc;
-}
-
-/**
- * Callback for SnmpWalk in Node::getTableFromSNMP
- */
-static UINT32 SNMPGetTableCallback(SNMP_Variable *varbind, SNMP_Transport *snmp, void *arg)
-{
-   ((ObjectArray<SNMP_ObjectId> *)arg)->add(new SNMP_ObjectId(varbind->getName()));
    return SNMP_ERR_SUCCESS;
 }
 
 /**
- * Get table from SNMP
+ * Get table from SNMP. Instance column and all table columns are walked in parallel
+ * and rows are assembled by index.
  */
 DataCollectionError Node::getTableFromSNMP(UINT16 port, SNMP_Version version, const TCHAR *oid, ObjectArray<DCTableColumn> *columns, Table **table)
 {
    *table = NULL;
 
+   UINT32 instanceOid[MAX_OID_LEN];
+   size_t instanceOidLen = SNMPParseOID(oid, instanceOid, MAX_OID_LEN);
+   if (instanceOidLen == 0)
+      return DCErrorFromSNMPError(SNMP_ERR_BAD_OID);
+
    SNMP_Transport *snmp = createSnmpTransport(port, version);
    if (snmp == NULL)
       return DCE_COMM_ERROR;
 
-   ObjectArray<SNMP_ObjectId> oidList(64, 64, Ownership::True);
-   UINT32 rc = SnmpWalk(snmp, oid, SNMPGetTableCallback, &oidList, FALSE);
-   if (rc == SNMP_ERR_SUCCESS)
+   SNMPTableWalkContext context;
+   context.table = new Table;
+
+   ObjectArray<SNMP_ObjectId> walkColumns(16, 16, Ownership::True);
+   walkColumns.add(new SNMP_ObjectId(instanceOid, instanceOidLen));
+   for(int i = 0; i < columns->size(); i++)
    {
-      *table = new Table;
-      for(int i = 0; i < columns->size(); i++)
+      DCTableColumn *c = columns->get(i);
+      if (c->getSnmpOid() == NULL)
+         continue;
+
+      context.table->addColumn(c->getName(), c->getDataType(), c->getDisplayName(), c->isInstanceColumn());
+      context.columns.add(c);
+      if (c->getSnmpOid()->compare(instanceOid, instanceOidLen) == OID_EQUAL)
       {
-         DCTableColumn *c = columns->get(i);
-         if (c->getSnmpOid() != NULL)
-            (*table)->addColumn(c->getName(), c->getDataType(), c->getDisplayName(), c->isInstanceColumn());
+         context.valueIndex.add(0);
       }
-
-      size_t baseOidLen = SNMPGetOIDLength(oid);
-      for(int i = 0; i < oidList.size(); i++)
+      else
       {
-         rc = ReadSNMPTableRow(snmp, oidList.get(i), baseOidLen, 0, columns, *table);
-         if (rc != SNMP_ERR_SUCCESS)
-         {
-            delete_and_null(*table);
-            break;
-         }
+         context.valueIndex.add(walkColumns.size());
+         walkColumns.add(new SNMP_ObjectId(*c->getSnmpOid()));
       }
    }
+
+   UINT32 rc = SnmpWalkTable(snmp, &walkColumns, SNMPGetTableRowCallback, &context);
+   if (rc == SNMP_ERR_SUCCESS)
+      *table = context.table;
+   else
+      delete context.table;
    delete snmp;
    return DCErrorFromSNMPError(rc);
 }
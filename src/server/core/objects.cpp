@@ -194,6 +194,8 @@ static THREAD_RESULT THREAD_CALL MapUpdateThread(void *pArg)
  */
 void ObjectsInit()
 {
+   InitObjectSync();
+
    // Load default status calculation info
    m_iStatusCalcAlg = ConfigReadInt(_T("StatusCalculationAlgorithm"), SA_CALCULATE_MOST_CRITICAL);
    m_iStatusPropAlg = ConfigReadInt(_T("StatusPropagationAlgorithm"), SA_PROPAGATE_UNCHANGED);
@@ -243,7 +245,13 @@ void NetObjInsert(NetObj *pObject, bool newObject, bool importedObject)
          pObject->generateGuid();
 
       // Create tables for storing data collection values
-      if (pObject->isDataCollectionTarget() && !(g_flags & AF_SINGLE_TABLE_PERF_DATA))
+      if (pObject->isDataCollectionTarget() && IsDataPartitioningEnabled())
+      {
+         DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+         CreateDataPartitions(hdb, pObject->getId());
+         DBConnectionPoolReleaseConnection(hdb);
+      }
+      else if (pObject->isDataCollectionTarget() && !(g_flags & AF_SINGLE_TABLE_PERF_DATA))
       {
          TCHAR szQuery[256], szQueryTemplate[256];
          UINT32 i;
@@ -2456,6 +2464,7 @@ void NetObjDelete(NetObj *object)
    // Delete object from index by ID and object itself
 	g_idxObjectById.remove(object->getId());
 	g_idxObjectByGUID.remove(object->getGuid());
+   RegisterDeletedObject(object->getId(), object->getRevision());
 	if (object->getRefCount() == 0)
 	{
 	   delete object;
@@ -0,0 +1,252 @@
+/*
+** NetXMS - Network Management System
+** Copyright (C) 2003-2020 Raden Solutions
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: objsync.cpp
+**
+**/
+
+#include "nxcore.h"
+#include <nxcore_objsync.h>
+#include <uthash.h>
+
+#define DEBUG_TAG _T("obj.sync")
+
+/**
+ * Object revisions and deleted object history
+ */
+static ObjectRevisionTracker s_revisionTracker;
+
+/**
+ * Object message cache key
+ */
+struct ObjectMessageCacheKey
+{
+   UINT32 objectId;
+   UINT32 groups;
+   UINT32 accessKey;
+   UINT16 code;
+   UINT16 flags;
+};
+
+/**
+ * Object message cache entry
+ */
+struct ObjectMessageCacheEntry
+{
+   UT_hash_handle hh;
+   ObjectMessageCacheKey key;
+   UINT64 revision;
+   time_t timestamp;
+   NXCP_MESSAGE *msg;
+};
+
+/**
+ * Object message cache
+ */
+static ObjectMessageCacheEntry *s_messageCache = NULL;
+static size_t s_messageCacheSize = 0;
+static size_t s_messageCacheMaxSize = 0;
+static time_t s_messageCacheTTL = 0;
+static Mutex s_messageCacheLock;
+
+/**
+ * Initialize object synchronization infrastructure
+ */
+void InitObjectSync()
+{
+   int historySize = ConfigReadInt(_T("Objects.Sync.DeletedObjectHistorySize"), 65536);
+   s_revisionTracker.setHistorySize(std::max(historySize, 1024));
+
+   s_messageCacheMaxSize = static_cast<size_t>(ConfigReadULong(_T("Objects.Sync.MessageCacheSize"), 64)) * 1024 * 1024;
+   s_messageCacheTTL = ConfigReadInt(_T("Objects.Sync.MessageCacheTTL"), 60);
+   nxlog_debug_tag(DEBUG_TAG, 2, _T("Object message cache size %u MB, TTL %d seconds"),
+            static_cast<UINT32>(s_messageCacheMaxSize / 1024 / 1024), static_cast<int>(s_messageCacheTTL));
+}
+
+/**
+ * Get next object revision
+ */
+UINT64 NextObjectRevision()
+{
+   return s_revisionTracker.next();
+}
+
+/**
+ * Get current object revision
+ */
+UINT64 GetCurrentObjectRevision()
+{
+   return s_revisionTracker.current();
+}
+
+/**
+ * Check if client synchronized up to given revision can resume synchronization
+ */
+bool CanResumeObjectSync(UINT64 baseRevision)
+{
+   return s_revisionTracker.canResume(baseRevision);
+}
+
+/**
+ * Invalidate all object revisions issued so far. Should be called on changes
+ * which may affect set of objects visible to users (access lists, user database,
+ * object hierarchy). Clients synchronized before this call will have to do full synchronization.
+ */
+void InvalidateObjectRevisions()
+{
+   s_revisionTracker.invalidate();
+}
+
+/**
+ * Convert object modification flags into set of changed property groups
+ */
+UINT32 ObjectModificationFlagsToUpdateGroups(UINT32 flags)
+{
+   UINT32 groups = 0;
+   if (flags & MODIFY_ACCESS_LIST)
+      groups |= OBJECT_UPDATE_ACCESS_LIST;
+   if (flags & MODIFY_RELATIONS)
+      groups |= OBJECT_UPDATE_RELATIONS;
+   if ((flags & ~(MODIFY_ACCESS_LIST | MODIFY_RELATIONS)) || (flags == MODIFY_RUNTIME))
+      groups |= OBJECT_UPDATE_PROPERTIES;
+   return groups;
+}
+
+/**
+ * Register finally deleted object (one removed from object index)
+ */
+void RegisterDeletedObject(UINT32 id, UINT64 revision)
+{
+   s_revisionTracker.registerDeletedObject(id, revision);
+}
+
+/**
+ * Get list of objects deleted after given revision
+ */
+void GetDeletedObjects(UINT64 baseRevision, IntegerArray<UINT32> *list)
+{
+   s_revisionTracker.getDeletedObjects(baseRevision, list);
+}
+
+/**
+ * Remove entry from message cache. Cache lock must be held by caller.
+ */
+static inline void RemoveCacheEntry(ObjectMessageCacheEntry *entry)
+{
+   HASH_DEL(s_messageCache, entry);
+   s_messageCacheSize -= ntohl(entry->msg->size) + sizeof(ObjectMessageCacheEntry);
+   MemFree(entry->msg);
+   MemFree(entry);
+}
+
+/**
+ * Get serialized object message from cache. Returned message is a copy and
+ * should be destroyed by caller with MemFree. Cache entry considered valid only
+ * if it was created for current object revision.
+ *
+ * @param object object
+ * @param code message code
+ * @param groups property groups included into message
+ * @param accessKey key identifying set of access rights message was prepared for
+ * @param flags additional message preparation flags (session specific)
+ * @return copy of cached message or NULL
+ */
+NXCP_MESSAGE *GetCachedObjectMessage(NetObj *object, UINT16 code, UINT32 groups, UINT32 accessKey, UINT32 flags)
+{
+   if (s_messageCacheMaxSize == 0)
+      return NULL;
+
+   ObjectMessageCacheKey key;
+   memset(&key, 0, sizeof(key));
+   key.objectId = object->getId();
+   key.groups = groups;
+   key.accessKey = accessKey;
+   key.code = code;
+   key.flags = static_cast<UINT16>(flags);
+
+   NXCP_MESSAGE *msg = NULL;
+   s_messageCacheLock.lock();
+   ObjectMessageCacheEntry *entry;
+   HASH_FIND(hh, s_messageCache, &key, sizeof(ObjectMessageCacheKey), entry);
+   if (entry != NULL)
+   {
+      if ((entry->revision == object->getRevision()) && (entry->timestamp + s_messageCacheTTL >= time(NULL)))
+      {
+         msg = static_cast<NXCP_MESSAGE*>(MemCopyBlock(entry->msg, ntohl(entry->msg->size)));
+
+         // Move entry to the end of the list to keep list sorted by last access time
+         HASH_DEL(s_messageCache, entry);
+         HASH_ADD(hh, s_messageCache, key, sizeof(ObjectMessageCacheKey), entry);
+      }
+      else
+      {
+         RemoveCacheEntry(entry);
+      }
+   }
+   s_messageCacheLock.unlock();
+   return msg;
+}
+
+/**
+ * Put serialized object message into cache
+ *
+ * @param object object
+ * @param revision object revision message was created from (should be read before message was filled)
+ * @param code message code
+ * @param groups property groups included into message
+ * @param accessKey key identifying set of access rights message was prepared for
+ * @param flags additional message preparation flags (session specific)
+ * @param msg serialized message
+ */
+void PutObjectMessageToCache(NetObj *object, UINT64 revision, UINT16 code, UINT32 groups, UINT32 accessKey, UINT32 flags, const NXCP_MESSAGE *msg)
+{
+   size_t size = ntohl(msg->size);
+   if ((s_messageCacheMaxSize == 0) || (size > s_messageCacheMaxSize / 16))
+      return;
+
+   ObjectMessageCacheEntry *entry = MemAllocStruct<ObjectMessageCacheEntry>();
+   entry->key.objectId = object->getId();
+   entry->key.groups = groups;
+   entry->key.accessKey = accessKey;
+   entry->key.code = code;
+   entry->key.flags = static_cast<UINT16>(flags);
+   entry->revision = revision;
+   entry->timestamp = time(NULL);
+   entry->msg = static_cast<NXCP_MESSAGE*>(MemCopyBlock(msg, size));
+
+   s_messageCacheLock.lock();
+
+   ObjectMessageCacheEntry *curr;
+   HASH_FIND(hh, s_messageCache, &entry->key, sizeof(ObjectMessageCacheKey), curr);
+   if (curr != NULL)
+      RemoveCacheEntry(curr);
+
+   // Evict least recently used entries
+   s_messageCacheSize += size + sizeof(ObjectMessageCacheEntry);
+   ObjectMessageCacheEntry *tmp;
+   HASH_ITER(hh, s_messageCache, curr, tmp)
+   {
+      if (s_messageCacheSize <= s_messageCacheMaxSize)
+         break;
+      RemoveCacheEntry(curr);
+   }
+
+   HASH_ADD(hh, s_messageCache, key, sizeof(ObjectMessageCacheKey), entry);
+   s_messageCacheLock.unlock();
+}
+
@@ -208,9 +208,20 @@ ClientSession::ClientSession(SOCKET hSocket, const InetAddress& addr) : m_agentC
    m_tcpProxyConnections = new ObjectArray<TcpProxy>(0, 16, Ownership::True);
    m_tcpProxyLock = MutexCreate();
    m_tcpProxyChannelId = 0;
-   m_pendingObjectNotifications = new HashSet<UINT32>();
-   m_pendingObjectNotificationsLock = MutexCreate();
+   m_outboundQueueLock = MutexCreate();
+   m_outboundQueueHead = NULL;
+   m_outboundQueueTail = NULL;
+   m_outboundSendTimestamp = 0;
+   m_pendingObjectUpdates = new HashMap<UINT32, ClientPendingObjectUpdate>(Ownership::True);
+   m_objectUpdateSizeEstimate = 1024;
    m_objectNotificationDelay = 200;
+   m_outboundQueueWorkerActive = false;
+   m_outboundQueueTimerActive = false;
+   m_outboundQueueDrops = 0;
+   memset(&m_outboundQueueStats, 0, sizeof(ClientOutboundQueueStats));
+   m_pendingAlarmUpdates = new ObjectArray<ClientPendingAlarmUpdate>(0, 64, Ownership::True);
+   m_pendingAlarmUpdateIndex = new HashMap<UINT32, ClientPendingAlarmUpdate>(Ownership::False);
+   m_pendingAlarmUpdatesLock = MutexCreate();
 }
 
 /**
@@ -252,8 +263,23 @@ ClientSession::~ClientSession()
    delete m_downloadFileMap;
    delete m_tcpProxyConnections;
    MutexDestroy(m_tcpProxyLock);
-   delete m_pendingObjectNotifications;
-   MutexDestroy(m_pendingObjectNotificationsLock);
+   while(m_outboundQueueHead != NULL)
+   {
+      ClientOutboundMessage *m = m_outboundQueueHead;
+      m_outboundQueueHead = m->next;
+      MemFree(m->msg);
+      if (m->broadcast != NULL)
+         m->broadcast->decRefCount();
+      MemFree(m);
+   }
+   dropPendingObjectUpdates();
+   delete m_pendingObjectUpdates;
+   MutexDestroy(m_outboundQueueLock);
+   for(int i = 0; i < m_pendingAlarmUpdates->size(); i++)
+      m_pendingAlarmUpdates->get(i)->msg->decRefCount();
+   delete m_pendingAlarmUpdates;
+   delete m_pendingAlarmUpdateIndex;
+   MutexDestroy(m_pendingAlarmUpdatesLock);
 }
 
 /**
@@ -558,7 +584,7 @@ void ClientSession::readThread()
    }
 
    // Mark as terminated (sendMessage calls will not work after that point)
-   m_dwFlags |= CSF_TERMINATED;
+   InterlockedOr(&m_dwFlags, CSF_TERMINATED);
 
    // remove all pending file transfers from reporting server
    RemovePendingFileTransferRequests(this);
@@ -1488,39 +1514,23 @@ bool ClientSession::sendMessage(NXCPMessage *msg)
    if (isTerminated())
       return false;
 
-	NXCP_MESSAGE *rawMsg = msg->serialize((m_dwFlags & CSF_COMPRESSION_ENABLED) != 0);
-
-   if ((nxlog_get_debug_level_tag_object(DEBUG_TAG, m_id) >= 6) && (msg->getCode() != CMD_ADM_MESSAGE))
+   if ((nxlog_get_debug_level_tag_object(DEBUG_TAG, m_id) >= 8) && (msg->getCode() != CMD_ADM_MESSAGE))
    {
-      TCHAR buffer[128];
-      debugPrintf(6, _T("Sending%s message %s (%d bytes)"),
-               (ntohs(rawMsg->flags) & MF_COMPRESSED) ? _T(" compressed") : _T(""), NXCPMessageCodeName(msg->getCode(), buffer), ntohl(rawMsg->size));
-      if (nxlog_get_debug_level_tag_object(DEBUG_TAG, m_id) >= 8)
-      {
-         String msgDump = NXCPMessage::dump(rawMsg, NXCP_VERSION);
-         debugPrintf(8, _T("Message dump:\n%s"), (const TCHAR *)msgDump);
-      }
+      // Serialize message in memory to produce message dump
+      NXCP_MESSAGE *rawMsg = msg->serialize((m_dwFlags & CSF_COMPRESSION_ENABLED) != 0);
+      bool result = sendRawMessage(rawMsg);
+      MemFree(rawMsg);
+      return result;
    }
 
-   bool result;
-   if (m_pCtx != NULL)
-   {
-      NXCP_ENCRYPTED_MESSAGE *enMsg = m_pCtx->encryptMessage(rawMsg);
-      if (enMsg != NULL)
-      {
-         result = (SendEx(m_hSocket, (char *)enMsg, ntohl(enMsg->size), 0, m_mutexSocketWrite) == (int)ntohl(enMsg->size));
-         free(enMsg);
-      }
-      else
-      {
-         result = false;
-      }
-   }
-   else
+   size_t size;
+   bool result = msg->sendTo(m_hSocket, m_mutexSocketWrite, m_pCtx, (m_dwFlags & CSF_COMPRESSION_ENABLED) != 0, &size);
+
+   if ((nxlog_get_debug_level_tag_object(DEBUG_TAG, m_id) >= 6) && (msg->getCode() != CMD_ADM_MESSAGE))
    {
-      result = (SendEx(m_hSocket, (const char *)rawMsg, ntohl(rawMsg->size), 0, m_mutexSocketWrite) == (int)ntohl(rawMsg->size));
+      TCHAR buffer[128];
+      debugPrintf(6, _T("Sent message %s (%d bytes)"), NXCPMessageCodeName(msg->getCode(), buffer), static_cast<int>(size));
    }
-   free(rawMsg);
 
    if (!result)
    {
@@ -1533,10 +1543,10 @@ bool ClientSession::sendMessage(NXCPMessage *msg)
 /**
  * Send raw message to client
  */
-void ClientSession::sendRawMessage(NXCP_MESSAGE *msg)
+bool ClientSession::sendRawMessage(NXCP_MESSAGE *msg)
 {
    if (isTerminated())
-      return;
+      return false;
 
    UINT16 code = htons(msg->code);
    if ((code != CMD_ADM_MESSAGE) && (nxlog_get_debug_level_tag_object(DEBUG_TAG, m_id) >= 6))
@@ -1575,16 +1585,7 @@ void ClientSession::sendRawMessage(NXCP_MESSAGE *msg)
       closesocket(m_hSocket);
       m_hSocket = -1;
    }
-}
-
-/**
- * Send raw message to client and delete message after sending
- */
-void ClientSession::sendRawMessageAndDelete(NXCP_MESSAGE *msg)
-{
-   sendRawMessage(msg);
-   MemFree(msg);
-   decRefCount();
+   return result;
 }
 
 /**
@@ -1593,7 +1594,7 @@ void ClientSession::sendRawMessageAndDelete(NXCP_MESSAGE *msg)
 void ClientSession::postMessage(NXCPMessage *msg)
 {
    if (!isTerminated())
-      postRawMessageAndDelete(msg->serialize((m_dwFlags & CSF_COMPRESSION_ENABLED) != 0));
+      enqueueOutboundMessage(msg->serialize((m_dwFlags & CSF_COMPRESSION_ENABLED) != 0), NULL);
 }
 
 /**
@@ -1601,10 +1602,265 @@ void ClientSession::postMessage(NXCPMessage *msg)
  */
 void ClientSession::postRawMessageAndDelete(NXCP_MESSAGE *msg)
 {
-   TCHAR key[32];
-   _sntprintf(key, 32, _T("POST/%u"), m_id);
+   enqueueOutboundMessage(msg, NULL);
+}
+
+/**
+ * Post message shared between multiple sessions. Droppable messages (like
+ * event or syslog log records) are dropped if session outbound queue is
+ * already over its size limit.
+ */
+void ClientSession::postBroadcastMessage(ClientBroadcastMessage *msg, bool droppable)
+{
+   if (isTerminated())
+      return;
+
+   if (droppable)
+   {
+      MutexLock(m_outboundQueueLock);
+      bool overflow = isOutboundQueueOverflow();
+      if (overflow)
+      {
+         m_outboundQueueStats.droppedMessages++;
+         if (m_outboundQueueDrops++ == 0)
+            debugPrintf(4, _T("Outbound queue size limit reached, dropping log records"));
+      }
+      MutexUnlock(m_outboundQueueLock);
+      if (overflow)
+         return;
+   }
+
+   msg->incRefCount();
+   enqueueOutboundMessage(NULL, msg);
+}
+
+/**
+ * Add message to outbound queue. Queue takes ownership of raw message and
+ * one reference to broadcast message.
+ */
+void ClientSession::enqueueOutboundMessage(NXCP_MESSAGE *msg, ClientBroadcastMessage *broadcast)
+{
+   ClientOutboundMessage *m = MemAllocStruct<ClientOutboundMessage>();
+   m->msg = msg;
+   m->broadcast = broadcast;
+   m->timestamp = GetCurrentTimeMs();
+   m->size = ntohl((msg != NULL) ? msg->size : broadcast->getSerializedMessage((m_dwFlags & CSF_COMPRESSION_ENABLED) != 0)->size);
+
+   MutexLock(m_outboundQueueLock);
+   if (m_outboundQueueTail != NULL)
+      m_outboundQueueTail->next = m;
+   else
+      m_outboundQueueHead = m;
+   m_outboundQueueTail = m;
+   m_outboundQueueStats.queuedMessages++;
+   m_outboundQueueStats.queuedBytes += m->size;
+   scheduleOutboundQueueProcessing();
+   MutexUnlock(m_outboundQueueLock);
+}
+
+/**
+ * Check if outbound queue is over its size limit (estimated size of pending
+ * object updates included). Outbound queue lock must be held by caller.
+ */
+bool ClientSession::isOutboundQueueOverflow() const
+{
+   return m_outboundQueueStats.queuedBytes +
+            static_cast<UINT64>(m_pendingObjectUpdates->size()) * m_objectUpdateSizeEstimate > g_clientOutboundQueueSize;
+}
+
+/**
+ * Get time in milliseconds since oldest unsent message (including messages
+ * in batch being sent) was queued. Outbound queue lock must be held by caller.
+ */
+INT64 ClientSession::getOutboundQueueLag() const
+{
+   INT64 oldest = (m_outboundSendTimestamp != 0) ? m_outboundSendTimestamp : ((m_outboundQueueHead != NULL) ? m_outboundQueueHead->timestamp : 0);
+   return (oldest != 0) ? GetCurrentTimeMs() - oldest : 0;
+}
+
+/**
+ * Start outbound queue worker if it is not running already. Outbound queue
+ * lock must be held by caller.
+ */
+void ClientSession::scheduleOutboundQueueProcessing()
+{
+   if (m_outboundQueueWorkerActive)
+      return;
+   m_outboundQueueWorkerActive = true;
    incRefCount();
-   ThreadPoolExecuteSerialized(g_clientThreadPool, key, this, &ClientSession::sendRawMessageAndDelete, msg);
+   ThreadPoolExecute(g_clientThreadPool, this, &ClientSession::processOutboundQueue);
+}
+
+/**
+ * Outbound queue timer (executed in thread pool when delayed object updates become due)
+ */
+void ClientSession::onOutboundQueueTimer()
+{
+   MutexLock(m_outboundQueueLock);
+   m_outboundQueueTimerActive = false;
+   if (m_pendingObjectUpdates->size() > 0)
+      scheduleOutboundQueueProcessing();
+   MutexUnlock(m_outboundQueueLock);
+   decRefCount();
+}
+
+/**
+ * Process outbound queue (executed in thread pool). Only one instance of
+ * this method is running for given session at any time. Queued messages are
+ * sent in order, followed by object updates which stayed in queue longer
+ * than current notification delay.
+ */
+void ClientSession::processOutboundQueue()
+{
+   while(true)
+   {
+      MutexLock(m_outboundQueueLock);
+
+      ClientOutboundMessage *messages = m_outboundQueueHead;
+      m_outboundQueueHead = NULL;
+      m_outboundQueueTail = NULL;
+      m_outboundSendTimestamp = (messages != NULL) ? messages->timestamp : 0;
+
+      INT64 now = GetCurrentTimeMs();
+      INT64 nextUpdateTime = 0;
+      ObjectArray<ClientPendingObjectUpdate> updates(0, 64, Ownership::True);
+      Iterator<ClientPendingObjectUpdate> *it = m_pendingObjectUpdates->iterator();
+      while(it->hasNext())
+      {
+         ClientPendingObjectUpdate *u = it->next();
+         INT64 dueTime = u->timestamp + m_objectNotificationDelay;
+         if (dueTime <= now)
+         {
+            updates.add(u);
+            it->unlink();
+         }
+         else if ((nextUpdateTime == 0) || (dueTime < nextUpdateTime))
+         {
+            nextUpdateTime = dueTime;
+         }
+      }
+      delete it;
+
+      if ((messages == NULL) && updates.isEmpty())
+      {
+         m_outboundQueueWorkerActive = false;
+         if ((nextUpdateTime != 0) && !m_outboundQueueTimerActive)
+         {
+            m_outboundQueueTimerActive = true;
+            incRefCount();
+            ThreadPoolScheduleRelative(g_clientThreadPool, static_cast<UINT32>(nextUpdateTime - now), this, &ClientSession::onOutboundQueueTimer);
+         }
+         MutexUnlock(m_outboundQueueLock);
+         break;
+      }
+
+      MutexUnlock(m_outboundQueueLock);
+
+      UINT32 count = 0;
+      UINT64 bytes = 0;
+      INT64 lag = 0;
+      while(messages != NULL)
+      {
+         ClientOutboundMessage *m = messages;
+         messages = m->next;
+         if (m->msg != NULL)
+         {
+            sendRawMessage(m->msg);
+            MemFree(m->msg);
+         }
+         else
+         {
+            sendRawMessage(const_cast<NXCP_MESSAGE*>(m->broadcast->getSerializedMessage((m_dwFlags & CSF_COMPRESSION_ENABLED) != 0)));
+            m->broadcast->decRefCount();
+         }
+         count++;
+         bytes += m->size;
+         lag = GetCurrentTimeMs() - m->timestamp;
+         MemFree(m);
+
+         MutexLock(m_outboundQueueLock);
+         m_outboundSendTimestamp = (messages != NULL) ? messages->timestamp : 0;
+         MutexUnlock(m_outboundQueueLock);
+      }
+
+      UINT64 updateBytes = 0;
+      INT64 updateDelay = 0;
+      for(int i = 0; i < updates.size(); i++)
+      {
+         ClientPendingObjectUpdate *u = updates.get(i);
+         updateBytes += sendObjectUpdate(u->object, u->baseRevision);
+         u->object->decRefCount();
+         INT64 t = GetCurrentTimeMs() - u->timestamp;
+         if (t > lag)
+            lag = t;
+         t -= m_objectNotificationDelay;
+         if (t > updateDelay)
+            updateDelay = t;
+      }
+
+      MutexLock(m_outboundQueueLock);
+
+      m_outboundQueueStats.queuedMessages -= count;
+      m_outboundQueueStats.queuedBytes -= bytes;
+      m_outboundQueueStats.messagesSent += count + updates.size();
+      m_outboundQueueStats.bytesSent += bytes + updateBytes;
+      m_outboundQueueStats.currentLag = static_cast<UINT32>(lag);
+      if (m_outboundQueueStats.currentLag > m_outboundQueueStats.maxLag)
+         m_outboundQueueStats.maxLag = m_outboundQueueStats.currentLag;
+      if ((m_outboundQueueDrops > 0) && (m_outboundQueueHead == NULL))
+      {
+         debugPrintf(4, _T("%u log records were dropped because of outbound queue size limit"), m_outboundQueueDrops);
+         m_outboundQueueDrops = 0;
+      }
+
+      if (!updates.isEmpty())
+      {
+         m_objectUpdateSizeEstimate = (m_objectUpdateSizeEstimate * 7 + static_cast<UINT32>(updateBytes / updates.size())) / 8;
+
+         // Increase notification delay if client cannot keep up with updates and decrease it back when it catches up
+         if ((updateDelay > m_objectNotificationDelay * 2) && (m_objectNotificationDelay < 1600))
+         {
+            m_objectNotificationDelay *= 2;
+         }
+         if ((updateDelay < m_objectNotificationDelay / 2) && (m_objectNotificationDelay > 200))
+         {
+            m_objectNotificationDelay /= 2;
+         }
+      }
+
+      MutexUnlock(m_outboundQueueLock);
+   }
+   decRefCount();
+}
+
+/**
+ * Drop all pending object updates. Outbound queue lock must be held by caller.
+ */
+void ClientSession::dropPendingObjectUpdates()
+{
+   Iterator<ClientPendingObjectUpdate> *it = m_pendingObjectUpdates->iterator();
+   while(it->hasNext())
+      it->next()->object->decRefCount();
+   delete it;
+   m_pendingObjectUpdates->clear();
+}
+
+/**
+ * Get outbound queue statistics
+ */
+void ClientSession::getOutboundQueueStats(ClientOutboundQueueStats *stats)
+{
+   MutexLock(m_outboundQueueLock);
+   memcpy(stats, &m_outboundQueueStats, sizeof(ClientOutboundQueueStats));
+   stats->pendingObjectUpdates = m_pendingObjectUpdates->size();
+   if (m_outboundQueueHead != NULL)
+   {
+      // Lag of messages waiting in queue is more important than lag of last sent message
+      UINT32 lag = static_cast<UINT32>(GetCurrentTimeMs() - m_outboundQueueHead->timestamp);
+      if (lag > stats->currentLag)
+         stats->currentLag = lag;
+   }
+   MutexUnlock(m_outboundQueueLock);
 }
 
 /**
@@ -1900,7 +2156,7 @@ void ClientSession::login(NXCPMessage *pRequest)
 
       if (dwResult == RCC_SUCCESS)
       {
-         m_dwFlags |= CSF_AUTHENTICATED;
+         InterlockedOr(&m_dwFlags, CSF_AUTHENTICATED);
          nx_strncpy(m_loginName, szLogin, MAX_USER_NAME);
          _sntprintf(m_sessionName, MAX_SESSION_NAME, _T("%s@%s"), szLogin, m_workstation);
          m_loginTime = time(NULL);
@@ -1927,7 +2183,7 @@ void ClientSession::login(NXCPMessage *pRequest)
          if (pRequest->getFieldAsBoolean(VID_ENABLE_COMPRESSION))
          {
             debugPrintf(3, _T("Protocol level compression is supported by client"));
-            m_dwFlags |= CSF_COMPRESSION_ENABLED;
+            InterlockedOr(&m_dwFlags, CSF_COMPRESSION_ENABLED);
             msg.setField(VID_ENABLE_COMPRESSION, true);
          }
          else
@@ -2199,10 +2455,11 @@ struct SessionObjectFilterData
 {
    ClientSession *session;
    time_t baseTimeStamp;
+   UINT64 baseRevision;
 };
 
 /**
- * Object filter for ClientSession::sendAllObjects
+ * Object filter for ClientSession::getObjects
  */
 static bool SessionObjectFilter(NetObj *object, void *data)
 {
@@ -2211,6 +2468,65 @@ static bool SessionObjectFilter(NetObj *object, void *data)
           object->checkAccessRights(((SessionObjectFilterData *)data)->session->getUserId(), OBJECT_ACCESS_READ);
 }
 
+/**
+ * Object filter for ClientSession::getObjects when client resumes synchronization from known revision
+ */
+static bool SessionObjectRevisionFilter(NetObj *object, void *data)
+{
+   return !object->isHidden() && !object->isSystem() &&
+          (object->getRevision() > ((SessionObjectFilterData *)data)->baseRevision) &&
+          (object->isDeleted() || object->checkAccessRights(((SessionObjectFilterData *)data)->session->getUserId(), OBJECT_ACCESS_READ));
+}
+
+/**
+ * Get access key for object message cache. Messages prepared for sessions
+ * with same access key are identical.
+ */
+UINT32 ClientSession::getObjectAccessKey(NetObj *object)
+{
+   if (object->hasUserSpecificData())
+      return m_dwUserId;
+   if ((object->getObjectClass() == OBJECT_NODE) && !object->checkAccessRights(m_dwUserId, OBJECT_ACCESS_MODIFY))
+      return 0xFFFFFFFE;   // passwords masked
+   return 0xFFFFFFFF;
+}
+
+/**
+ * Send object message to client. Serialized messages are cached and shared
+ * between sessions with same access rights.
+ */
+bool ClientSession::sendObjectMessage(NetObj *object, UINT16 code, UINT32 groups, UINT32 *size)
+{
+   UINT32 accessKey = getObjectAccessKey(object);
+   UINT32 flags = ((m_dwFlags & CSF_SYNC_OBJECT_COMMENTS) ? 1 : 0) | ((m_dwFlags & CSF_COMPRESSION_ENABLED) ? 2 : 0);
+
+   NXCP_MESSAGE *rawMsg = GetCachedObjectMessage(object, code, groups, accessKey, flags);
+   if (rawMsg == NULL)
+   {
+      UINT64 revision = object->getRevision();
+
+      NXCPMessage msg(code, 0);
+      object->fillMessage(&msg, m_dwUserId, groups);
+      if ((m_dwFlags & CSF_SYNC_OBJECT_COMMENTS) && (groups & OBJECT_UPDATE_PROPERTIES))
+         object->commentsToMessage(&msg);
+      if ((accessKey == 0xFFFFFFFE) && (groups & OBJECT_UPDATE_PROPERTIES))
+      {
+         // mask passwords
+         msg.setField(VID_SHARED_SECRET, _T("********"));
+         msg.setField(VID_SNMP_AUTH_PASSWORD, _T("********"));
+         msg.setField(VID_SNMP_PRIV_PASSWORD, _T("********"));
+      }
+      rawMsg = msg.serialize((m_dwFlags & CSF_COMPRESSION_ENABLED) != 0);
+      PutObjectMessageToCache(object, revision, code, groups, accessKey, flags, rawMsg);
+   }
+
+   if (size != NULL)
+      *size = ntohl(rawMsg->size);
+   bool success = sendRawMessage(rawMsg);
+   MemFree(rawMsg);
+   return success;
+}
+
 /**
  * Send all objects to client
  */
@@ -2218,64 +2534,98 @@ void ClientSession::getObjects(NXCPMessage *request)
 {
    NXCPMessage msg;
 
-   // Send confirmation message
-   msg.setCode(CMD_REQUEST_COMPLETED);
-   msg.setId(request->getId());
-   msg.setField(VID_RCC, RCC_SUCCESS);
-   sendMessage(&msg);
-   msg.deleteAllFields();
-
    // Change "sync comments" flag
    if (request->getFieldAsBoolean(VID_SYNC_COMMENTS))
-      m_dwFlags |= CSF_SYNC_OBJECT_COMMENTS;
+      InterlockedOr(&m_dwFlags, CSF_SYNC_OBJECT_COMMENTS);
+   else
+      InterlockedAnd(&m_dwFlags, ~CSF_SYNC_OBJECT_COMMENTS);
+
+   // Set delta updates flag
+   if (request->getFieldAsBoolean(VID_DELTA_OBJECT_UPDATES))
+      InterlockedOr(&m_dwFlags, CSF_DELTA_OBJECT_UPDATES);
    else
-      m_dwFlags &= ~CSF_SYNC_OBJECT_COMMENTS;
+      InterlockedAnd(&m_dwFlags, ~CSF_DELTA_OBJECT_UPDATES);
+
+   // Object updates will be queued again after full synchronization
+   InterlockedAnd(&m_dwFlags, ~CSF_OBJECTS_OUT_OF_SYNC);
 
    // Set sync components flag
    bool syncNodeComponents = false;
    if (request->getFieldAsBoolean(VID_SYNC_NODE_COMPONENTS))
       syncNodeComponents = true;
 
-   // Prepare message
-   msg.setCode(CMD_OBJECT);
-
-   // Send objects, one per message
+   // Check if client can resume synchronization from known revision
    SessionObjectFilterData data;
    data.session = this;
    data.baseTimeStamp = request->getFieldAsTime(VID_TIMESTAMP);
-	ObjectArray<NetObj> *objects = g_idxObjectById.getObjects(true, SessionObjectFilter, &data);
-	for(int i = 0; i < objects->size(); i++)
-	{
+   data.baseRevision = request->getFieldAsUInt64(VID_OBJECT_REVISION);
+   bool resume = (request->getFieldAsInt64(VID_OBJECT_SYNC_EPOCH) == static_cast<INT64>(g_serverStartTime)) &&
+            CanResumeObjectSync(data.baseRevision);
+   UINT64 currentRevision = GetCurrentObjectRevision();
+
+   // Send confirmation message
+   msg.setCode(CMD_REQUEST_COMPLETED);
+   msg.setId(request->getId());
+   msg.setField(VID_RCC, RCC_SUCCESS);
+   msg.setField(VID_OBJECT_SYNC_RESUMED, resume);
+   sendMessage(&msg);
+   msg.deleteAllFields();
+
+   if (resume)
+      debugPrintf(4, _T("Resuming object synchronization from revision ") UINT64_FMT _T(" (current revision ") UINT64_FMT _T(")"), data.baseRevision, currentRevision);
+
+   // Send objects, one per message
+   ObjectArray<NetObj> *objects = g_idxObjectById.getObjects(true, resume ? SessionObjectRevisionFilter : SessionObjectFilter, &data);
+   for(int i = 0; i < objects->size(); i++)
+   {
       NetObj *object = objects->get(i);
-	   if (!syncNodeComponents && (object->getObjectClass() == OBJECT_INTERFACE ||
-	         object->getObjectClass() == OBJECT_ACCESSPOINT || object->getObjectClass() == OBJECT_VPNCONNECTOR ||
-	         object->getObjectClass() == OBJECT_NETWORKSERVICE))
-	   {
-	      object->decRefCount();
+      if (!syncNodeComponents && (object->getObjectClass() == OBJECT_INTERFACE ||
+            object->getObjectClass() == OBJECT_ACCESSPOINT || object->getObjectClass() == OBJECT_VPNCONNECTOR ||
+            object->getObjectClass() == OBJECT_NETWORKSERVICE))
+      {
+         object->decRefCount();
          continue;
-	   }
+      }
 
-      object->fillMessage(&msg, m_dwUserId);
-      if (m_dwFlags & CSF_SYNC_OBJECT_COMMENTS)
-         object->commentsToMessage(&msg);
-      if ((object->getObjectClass() == OBJECT_NODE) && !object->checkAccessRights(m_dwUserId, OBJECT_ACCESS_MODIFY))
+      if (object->isDeleted())
       {
-         // mask passwords
-         msg.setField(VID_SHARED_SECRET, _T("********"));
-         msg.setField(VID_SNMP_AUTH_PASSWORD, _T("********"));
-         msg.setField(VID_SNMP_PRIV_PASSWORD, _T("********"));
+         msg.setCode(CMD_OBJECT_UPDATE);
+         msg.setField(VID_OBJECT_ID, object->getId());
+         msg.setField(VID_IS_DELETED, (UINT16)1);
+         sendMessage(&msg);
+         msg.deleteAllFields();
+      }
+      else
+      {
+         sendObjectMessage(object, CMD_OBJECT, OBJECT_UPDATE_ALL);
       }
-      sendMessage(&msg);
-      msg.deleteAllFields();
       object->decRefCount();
-	}
-	delete objects;
+   }
+   delete objects;
+
+   // Notify client about objects removed from index since base revision
+   if (resume)
+   {
+      IntegerArray<UINT32> deletedObjects;
+      GetDeletedObjects(data.baseRevision, &deletedObjects);
+      msg.setCode(CMD_OBJECT_UPDATE);
+      for(int i = 0; i < deletedObjects.size(); i++)
+      {
+         msg.setField(VID_OBJECT_ID, deletedObjects.get(i));
+         msg.setField(VID_IS_DELETED, (UINT16)1);
+         sendMessage(&msg);
+         msg.deleteAllFields();
+      }
+   }
 
    // Send end of list notification
    msg.setCode(CMD_OBJECT_LIST_END);
+   msg.setField(VID_OBJECT_REVISION, currentRevision);
+   msg.setField(VID_OBJECT_SYNC_EPOCH, static_cast<INT64>(g_serverStartTime));
+   msg.setField(VID_OBJECT_SYNC_RESUMED, resume);
    sendMessage(&msg);
 
-   m_dwFlags |= CSF_OBJECT_SYNC_FINISHED;
+   InterlockedOr(&m_dwFlags, CSF_OBJECT_SYNC_FINISHED);
 }
 
 /**
@@ -2294,9 +2644,9 @@ void ClientSession::getSelectedObjects(NXCPMessage *request)
 
    // Change "sync comments" flag
    if (request->getFieldAsBoolean(VID_SYNC_COMMENTS))
-      m_dwFlags |= CSF_SYNC_OBJECT_COMMENTS;
+      InterlockedOr(&m_dwFlags, CSF_SYNC_OBJECT_COMMENTS);
    else
-      m_dwFlags &= ~CSF_SYNC_OBJECT_COMMENTS;
+      InterlockedAnd(&m_dwFlags, ~CSF_SYNC_OBJECT_COMMENTS);
 
    UINT32 dwTimeStamp = request->getFieldAsUInt32(VID_TIMESTAMP);
 	UINT32 numObjects = request->getFieldAsUInt32(VID_NUM_OBJECTS);
@@ -2331,7 +2681,7 @@ void ClientSession::getSelectedObjects(NXCPMessage *request)
       }
 	}
 
-   m_dwFlags |= CSF_OBJECT_SYNC_FINISHED;
+   InterlockedOr(&m_dwFlags, CSF_OBJECT_SYNC_FINISHED);
 	free(objects);
 
 	if (options & OBJECT_SYNC_DUAL_CONFIRM)
@@ -2744,116 +3094,104 @@ void ClientSession::kill()
 /**
  * Handler for new events
  */
-void ClientSession::onNewEvent(Event *pEvent)
+void ClientSession::onNewEvent(Event *event, ClientBroadcastMessage *msg)
 {
    if (isAuthenticated() && isSubscribedTo(NXC_CHANNEL_EVENTS) && (m_systemAccessRights & SYSTEM_ACCESS_VIEW_EVENT_LOG))
    {
-      NetObj *object = FindObjectById(pEvent->getSourceId());
+      NetObj *object = FindObjectById(event->getSourceId());
       // If can't find object - just send to all events, if object found send to thous who have rights
       if ((object == NULL) || object->checkAccessRights(m_dwUserId, OBJECT_ACCESS_READ))
       {
-         NXCPMessage msg(CMD_EVENTLOG_RECORDS, 0);
-         pEvent->prepareMessage(&msg);
-         postMessage(&msg);
+         postBroadcastMessage(msg, true);
       }
    }
 }
 
 /**
- * Send object update (executed in thread pool)
+ * Send object update. Returns number of bytes sent.
  */
-void ClientSession::sendObjectUpdate(NetObj *object)
+UINT32 ClientSession::sendObjectUpdate(NetObj *object, UINT64 baseRevision)
 {
-   StringBuffer key(_T("ObjectUpdate"));
-   key.append(m_id);
-   UINT32 waitTime = ThreadPoolGetSerializedRequestMaxWaitTime(g_clientThreadPool, key);
-
-   MutexLock(m_pendingObjectNotificationsLock);
-   m_pendingObjectNotifications->remove(object->getId());
-
-   if ((waitTime > m_objectNotificationDelay * 2) && (m_objectNotificationDelay < 1600))
-   {
-      m_objectNotificationDelay *= 2;
-   }
-
-   if ((waitTime < m_objectNotificationDelay / 2) && (m_objectNotificationDelay > 200))
-   {
-      m_objectNotificationDelay /= 2;
-   }
-
-   MutexUnlock(m_pendingObjectNotificationsLock);
-   debugPrintf(5, _T("Sending update for object %s [%d]"), object->getName(), object->getId());
-
-   NXCPMessage msg(CMD_OBJECT_UPDATE, 0);
+   UINT32 size;
    if (!object->isDeleted())
    {
-      object->fillMessage(&msg, m_dwUserId);
-      if (m_dwFlags & CSF_SYNC_OBJECT_COMMENTS)
-         object->commentsToMessage(&msg);
-      if ((object->getObjectClass() == OBJECT_NODE) && !object->checkAccessRights(m_dwUserId, OBJECT_ACCESS_MODIFY))
+      // Send only property groups changed since first pending notification if client supports it.
+      // Changes in access list may change object visibility so full update is sent in that case.
+      UINT32 groups = OBJECT_UPDATE_ALL;
+      if ((m_dwFlags & CSF_DELTA_OBJECT_UPDATES) && (baseRevision != 0))
       {
-         // mask passwords
-         msg.setField(VID_SHARED_SECRET, _T("********"));
-         msg.setField(VID_SNMP_AUTH_PASSWORD, _T("********"));
-         msg.setField(VID_SNMP_PRIV_PASSWORD, _T("********"));
+         groups = object->getChangedGroups(baseRevision);
+         if ((groups == 0) || (groups & OBJECT_UPDATE_ACCESS_LIST))
+            groups = OBJECT_UPDATE_ALL;
       }
+      debugPrintf(5, _T("Sending update for object %s [%d] (groups 0x%04X)"), object->getName(), object->getId(), groups);
+      sendObjectMessage(object, CMD_OBJECT_UPDATE, groups, &size);
    }
    else
    {
+      debugPrintf(5, _T("Sending delete notification for object %s [%d]"), object->getName(), object->getId());
+      NXCPMessage msg(CMD_OBJECT_UPDATE, 0);
       msg.setField(VID_OBJECT_ID, object->getId());
       msg.setField(VID_IS_DELETED, (UINT16)1);
+      NXCP_MESSAGE *rawMsg = msg.serialize((m_dwFlags & CSF_COMPRESSION_ENABLED) != 0);
+      size = ntohl(rawMsg->size);
+      sendRawMessage(rawMsg);
+      MemFree(rawMsg);
    }
-   sendMessage(&msg);
-   object->decRefCount();
-   decRefCount();
+   return size;
 }
 
 /**
- * Schedule object update (executed in thread pool relative schedule)
+ * Handler for object changes. Changes are accumulated in outbound queue and
+ * repeated changes of same object are coalesced into single update. If
+ * client falls too far behind pending updates are dropped and client is
+ * notified that it should re-synchronize objects.
  */
-void ClientSession::scheduleObjectUpdate(NetObj *object)
+void ClientSession::onObjectChange(NetObj *object)
 {
-   TCHAR key[64];
-   _sntprintf(key, 64, _T("ObjectUpdate_%d"), m_id);
-   if (ThreadPoolGetSerializedRequestCount(g_clientThreadPool, key) < 500)
+   if (((m_dwFlags & CSF_OBJECT_SYNC_FINISHED) == 0) || ((m_dwFlags & CSF_OBJECTS_OUT_OF_SYNC) != 0) ||
+       !isAuthenticated() || !isSubscribedTo(NXC_CHANNEL_OBJECTS) ||
+       (!object->isDeleted() && !object->checkAccessRights(m_dwUserId, OBJECT_ACCESS_READ)))
+      return;
+
+   bool resync = false;
+   MutexLock(m_outboundQueueLock);
+   if (m_dwFlags & CSF_OBJECTS_OUT_OF_SYNC)
    {
-      debugPrintf(5, _T("Scheduling update for object %s [%d]"), object->getName(), object->getId());
-      ThreadPoolExecuteSerialized(g_clientThreadPool, key, this, &ClientSession::sendObjectUpdate, object);
+      // Updates were dropped by another thread after initial check
+   }
+   else if (m_pendingObjectUpdates->contains(object->getId()))
+   {
+      m_outboundQueueStats.coalescedUpdates++;
+   }
+   else if (isOutboundQueueOverflow() || (getOutboundQueueLag() > static_cast<INT64>(g_clientOutboundQueueMaxLag) * 1000))
+   {
+      dropPendingObjectUpdates();
+      InterlockedOr(&m_dwFlags, CSF_OBJECTS_OUT_OF_SYNC);
+      m_outboundQueueStats.resyncCount++;
+      resync = true;
    }
    else
    {
-      debugPrintf(5, _T("Drop update for object %s [%d]"), object->getName(), object->getId());
-      MutexLock(m_pendingObjectNotificationsLock);
-      m_pendingObjectNotifications->remove(object->getId());
-      MutexUnlock(m_pendingObjectNotificationsLock);
-      if ((m_dwFlags & CSF_OBJECTS_OUT_OF_SYNC) == 0)
+      ClientPendingObjectUpdate *u = new ClientPendingObjectUpdate;
+      u->object = object;
+      u->baseRevision = object->getRevision();
+      u->timestamp = GetCurrentTimeMs();
+      object->incRefCount();
+      m_pendingObjectUpdates->set(object->getId(), u);
+      if (!m_outboundQueueWorkerActive && !m_outboundQueueTimerActive)
       {
-         m_dwFlags |= CSF_OBJECTS_OUT_OF_SYNC;
-         notify(NX_NOTIFY_OBJECTS_OUT_OF_SYNC);
+         m_outboundQueueTimerActive = true;
+         incRefCount();
+         ThreadPoolScheduleRelative(g_clientThreadPool, m_objectNotificationDelay, this, &ClientSession::onOutboundQueueTimer);
       }
-      object->decRefCount();
-      decRefCount();
    }
-}
+   MutexUnlock(m_outboundQueueLock);
 
-/**
- * Handler for object changes
- */
-void ClientSession::onObjectChange(NetObj *object)
-{
-   if (((m_dwFlags & CSF_OBJECT_SYNC_FINISHED) > 0) && isAuthenticated() &&
-         isSubscribedTo(NXC_CHANNEL_OBJECTS) &&
-      (object->isDeleted() || object->checkAccessRights(m_dwUserId, OBJECT_ACCESS_READ)))
+   if (resync)
    {
-      MutexLock(m_pendingObjectNotificationsLock);
-      if (!m_pendingObjectNotifications->contains(object->getId()))
-      {
-         m_pendingObjectNotifications->put(object->getId());
-         object->incRefCount();
-         incRefCount();
-         ThreadPoolScheduleRelative(g_clientThreadPool, m_objectNotificationDelay, this, &ClientSession::scheduleObjectUpdate, object);
-      }
-      MutexUnlock(m_pendingObjectNotificationsLock);
+      debugPrintf(4, _T("Client cannot keep up with object updates, requesting object re-synchronization"));
+      notify(NX_NOTIFY_OBJECTS_OUT_OF_SYNC);
    }
 }
 
@@ -3257,7 +3595,7 @@ void ClientSession::lockUserDB(UINT32 dwRqId, BOOL bLock)
          }
          else
          {
-            m_dwFlags |= CSF_USER_DB_LOCKED;
+            InterlockedOr(&m_dwFlags, CSF_USER_DB_LOCKED);
             msg.setField(VID_RCC, RCC_SUCCESS);
          }
       }
@@ -3266,7 +3604,7 @@ void ClientSession::lockUserDB(UINT32 dwRqId, BOOL bLock)
          if (m_dwFlags & CSF_USER_DB_LOCKED)
          {
             UnlockComponent(CID_USER_DB);
-            m_dwFlags &= ~CSF_USER_DB_LOCKED;
+            InterlockedAnd(&m_dwFlags, ~CSF_USER_DB_LOCKED);
          }
          msg.setField(VID_RCC, RCC_SUCCESS);
       }
@@ -4190,44 +4528,46 @@ void ClientSession::sendDCIThresholds(NXCPMessage *request)
 /**
  * Prepare statement for reading data from idata/tdata table
  */
-static DB_STATEMENT PrepareDataSelect(DB_HANDLE hdb, UINT32 nodeId, int dciType, DCObjectStorageClass storageClass,
+static DB_STATEMENT PrepareDataSelect(DB_HANDLE hdb, const TCHAR *table, int dciType, DCObjectStorageClass storageClass,
          UINT32 maxRows, HistoricalDataType historicalDataType, const TCHAR *condition)
 {
    const TCHAR *tablePrefix = (dciType == DCO_TYPE_ITEM) ? _T("idata") : _T("tdata");
-	TCHAR query[512];
+   size_t size = _tcslen(table) + 512;
+	TCHAR *query = MemAllocString(size);
 	if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
 	{
       switch(g_dbSyntax)
       {
          case DB_SYNTAX_MSSQL:
-            _sntprintf(query, 512, _T("SELECT TOP %d %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC"),
+            _sntprintf(query, size, _T("SELECT TOP %d %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC"),
                      (int)maxRows, tablePrefix, SELECTION_COLUMNS,
                      tablePrefix, condition, tablePrefix);
             break;
          case DB_SYNTAX_ORACLE:
-            _sntprintf(query, 512, _T("SELECT * FROM (SELECT %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC) WHERE ROWNUM<=%d"),
+            _sntprintf(query, size, _T("SELECT * FROM (SELECT %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC) WHERE ROWNUM<=%d"),
                      tablePrefix, SELECTION_COLUMNS,
                      tablePrefix, condition, tablePrefix, (int)maxRows);
             break;
          case DB_SYNTAX_MYSQL:
          case DB_SYNTAX_PGSQL:
          case DB_SYNTAX_SQLITE:
-            _sntprintf(query, 512, _T("SELECT %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC LIMIT %d"),
+            _sntprintf(query, size, _T("SELECT %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC LIMIT %d"),
                      tablePrefix, SELECTION_COLUMNS,
                      tablePrefix, condition, tablePrefix, (int)maxRows);
             break;
          case DB_SYNTAX_TSDB:
-            _sntprintf(query, 512, _T("SELECT %s_timestamp,%s%s FROM %s_sc_%s WHERE item_id=?%s ORDER BY %s_timestamp DESC LIMIT %d"),
+            _sntprintf(query, size, _T("SELECT %s_timestamp,%s%s FROM %s_sc_%s WHERE item_id=?%s ORDER BY %s_timestamp DESC LIMIT %d"),
                      tablePrefix, SELECTION_COLUMNS,
                      tablePrefix, DCObject::getStorageClassName(storageClass), condition, tablePrefix, (int)maxRows);
             break;
          case DB_SYNTAX_DB2:
-            _sntprintf(query, 512, _T("SELECT %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC FETCH FIRST %d ROWS ONLY"),
+            _sntprintf(query, size, _T("SELECT %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC FETCH FIRST %d ROWS ONLY"),
                      tablePrefix, SELECTION_COLUMNS,
                      tablePrefix, condition, tablePrefix, (int)maxRows);
             break;
          default:
             DbgPrintf(1, _T("INTERNAL ERROR: unsupported database in PrepareDataSelect"));
+            MemFree(query);
             return NULL;   // Unsupported database
       }
 	}
@@ -4236,34 +4576,37 @@ static DB_STATEMENT PrepareDataSelect(DB_HANDLE hdb, UINT32 nodeId, int dciType,
       switch(g_dbSyntax)
       {
          case DB_SYNTAX_MSSQL:
-            _sntprintf(query, 512, _T("SELECT TOP %d %s_timestamp,%s%s FROM %s_%d WHERE item_id=?%s ORDER BY %s_timestamp DESC"),
+            _sntprintf(query, size, _T("SELECT TOP %d %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC"),
                      (int)maxRows, tablePrefix, SELECTION_COLUMNS,
-                     tablePrefix, (int)nodeId, condition, tablePrefix);
+                     table, condition, tablePrefix);
             break;
          case DB_SYNTAX_ORACLE:
-            _sntprintf(query, 512, _T("SELECT * FROM (SELECT %s_timestamp,%s%s FROM %s_%d WHERE item_id=?%s ORDER BY %s_timestamp DESC) WHERE ROWNUM<=%d"),
+            _sntprintf(query, size, _T("SELECT * FROM (SELECT %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC) WHERE ROWNUM<=%d"),
                      tablePrefix, SELECTION_COLUMNS,
-                     tablePrefix, (int)nodeId, condition, tablePrefix, (int)maxRows);
+                     table, condition, tablePrefix, (int)maxRows);
             break;
          case DB_SYNTAX_MYSQL:
          case DB_SYNTAX_PGSQL:
          case DB_SYNTAX_SQLITE:
          case DB_SYNTAX_TSDB:
-            _sntprintf(query, 512, _T("SELECT %s_timestamp,%s%s FROM %s_%d WHERE item_id=?%s ORDER BY %s_timestamp DESC LIMIT %d"),
+            _sntprintf(query, size, _T("SELECT %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC LIMIT %d"),
                      tablePrefix, SELECTION_COLUMNS,
-                     tablePrefix, (int)nodeId, condition, tablePrefix, (int)maxRows);
+                     table, condition, tablePrefix, (int)maxRows);
             break;
          case DB_SYNTAX_DB2:
-            _sntprintf(query, 512, _T("SELECT %s_timestamp,%s%s FROM %s_%d WHERE item_id=?%s ORDER BY %s_timestamp DESC FETCH FIRST %d ROWS ONLY"),
+            _sntprintf(query, size, _T("SELECT %s_timestamp,%s%s FROM %s WHERE item_id=?%s ORDER BY %s_timestamp DESC FETCH FIRST %d ROWS ONLY"),
                      tablePrefix, SELECTION_COLUMNS,
-                     tablePrefix, (int)nodeId, condition, tablePrefix, (int)maxRows);
+                     table, condition, tablePrefix, (int)maxRows);
             break;
          default:
             DbgPrintf(1, _T("INTERNAL ERROR: unsupported database in PrepareDataSelect"));
+            MemFree(query);
             return NULL;	// Unsupported database
       }
 	}
-	return DBPrepare(hdb, query);
+	DB_STATEMENT hStmt = DBPrepare(hdb, query);
+	MemFree(query);
+	return hStmt;
 }
 
 /**
@@ -4445,6 +4788,46 @@ bool ClientSession::getCollectedDataFromDB(NXCPMessage *request, NXCPMessage *re
 read_from_db:
    debugPrintf(7, _T("getCollectedDataFromDB: will read from database (maxRows = %d)"), maxRows);
 
+   // Use rollup data for numeric DCIs if raw data for requested period does not fit into requested number of rows
+   if ((dciType == DCO_TYPE_ITEM) && (historicalDataType == DCO_TYPE_PROCESSED) && IsDataRollupEnabled() &&
+       (static_cast<DCItem*>(dci.get())->getDataType() != DCI_DT_STRING))
+   {
+      StructArray<DciValue> *values = GetDataRollupSeries(dcTarget->getId(), dci->getId(), dci->getStorageClass(),
+               timeFrom, timeTo, dci->getEffectivePollingInterval(), maxRows);
+      if (values != NULL)
+      {
+         debugPrintf(7, _T("getCollectedDataFromDB: %d values read from rollup data"), values->size());
+
+         response->setField(VID_RCC, RCC_SUCCESS);
+         static_cast<DCItem*>(dci.get())->fillMessageWithThresholds(response, false);
+         sendMessage(response);
+
+         // Rollup values are averages, so they are always sent as floating point numbers
+         pData = (DCI_DATA_HEADER *)MemAlloc(values->size() * s_rowSize[DCI_DT_FLOAT] + sizeof(DCI_DATA_HEADER));
+         pData->dataType = htonl((UINT32)DCI_DT_FLOAT);
+         pData->dciId = htonl(dci->getId());
+         pData->numRows = htonl(values->size());
+         pCurr = (DCI_DATA_ROW *)(((char *)pData) + sizeof(DCI_DATA_HEADER));
+         for(int i = 0; i < values->size(); i++)
+         {
+            DciValue *v = values->get(i);
+            pCurr->timeStamp = htonl((UINT32)v->timestamp);
+            pCurr->value.ext.v64.real = htond(v->value);
+            pCurr = (DCI_DATA_ROW *)(((char *)pCurr) + s_rowSize[DCI_DT_FLOAT]);
+         }
+
+         NXCP_MESSAGE *msg =
+            CreateRawNXCPMessage(CMD_DCI_DATA, request->getId(), 0,
+                                 pData, values->size() * s_rowSize[DCI_DT_FLOAT] + sizeof(DCI_DATA_HEADER),
+                                 NULL, isCompressionEnabled());
+         MemFree(pData);
+         sendRawMessage(msg);
+         MemFree(msg);
+         delete values;
+         return true;
+      }
+   }
+
 	TCHAR condition[256] = _T("");
 	if (timeFrom != 0)
 		_tcscpy(condition, (dciType == DCO_TYPE_TABLE) ? _T(" AND tdata_timestamp>=?") : _T(" AND idata_timestamp>=?"));
@@ -4453,7 +4836,8 @@ bool ClientSession::getCollectedDataFromDB(NXCPMessage *request, NXCPMessage *re
 
 	bool success = false;
 	DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
-	DB_STATEMENT hStmt = PrepareDataSelect(hdb, dcTarget->getId(), dciType, dci->getStorageClass(), maxRows, historicalDataType, condition);
+	String table = GetDataSelectSource(dciType, dcTarget->getId(), timeFrom, timeTo);
+	DB_STATEMENT hStmt = PrepareDataSelect(hdb, table, dciType, dci->getStorageClass(), maxRows, historicalDataType, condition);
 	if (hStmt != NULL)
 	{
 		TCHAR dataColumn[MAX_COLUMN_NAME] = _T("");
@@ -5001,7 +5385,7 @@ void ClientSession::openEventProcessingPolicy(NXCPMessage *request)
       {
          if (!readOnly)
          {
-            m_dwFlags |= CSF_EPP_LOCKED;
+            InterlockedOr(&m_dwFlags, CSF_EPP_LOCKED);
          }
          msg.setField(VID_RCC, RCC_SUCCESS);
          msg.setField(VID_NUM_RULES, g_pEventPolicy->getNumRules());
@@ -5051,7 +5435,7 @@ void ClientSession::closeEventProcessingPolicy(NXCPMessage *request)
             }
             MemFreeAndNull(m_ppEPPRuleList);
          }
-         m_dwFlags &= ~(CSF_EPP_LOCKED | CSF_EPP_UPLOAD);
+         InterlockedAnd(&m_dwFlags, ~(CSF_EPP_LOCKED | CSF_EPP_UPLOAD));
          UnlockComponent(CID_EPP);
       }
       msg.setField(VID_RCC, RCC_SUCCESS);
@@ -5104,7 +5488,7 @@ void ClientSession::saveEventProcessingPolicy(NXCPMessage *request)
          }
          else
          {
-            m_dwFlags |= CSF_EPP_UPLOAD;
+            InterlockedOr(&m_dwFlags, CSF_EPP_UPLOAD);
             m_ppEPPRuleList = MemAllocArray<EPRule*>(m_dwNumRecordsToUpload);
          }
          debugPrintf(5, _T("Accepted EPP upload request for %d rules"), m_dwNumRecordsToUpload);
@@ -5164,7 +5548,7 @@ void ClientSession::processEventProcessingPolicyRecord(NXCPMessage *request)
             msg.setField(VID_RCC, success ? RCC_SUCCESS : RCC_DB_FAILURE);
             sendMessage(&msg);
 
-            m_dwFlags &= ~CSF_EPP_UPLOAD;
+            InterlockedAnd(&m_dwFlags, ~CSF_EPP_UPLOAD);
 
             writeAuditLogWithValues(AUDIT_SYSCFG, true, 0, oldVersion, newVersion, _T("Event processing policy updated"));
             json_decref(oldVersion);
@@ -5794,22 +6178,38 @@ void ClientSession::deleteObject(NXCPMessage *pRequest)
 }
 
 /**
- * Alarm update worker function (executed in thread pool)
+ * Send pending alarm updates (executed in thread pool). Updates are passed
+ * to outbound queue, so they are sent in order with alarm list.
  */
-void ClientSession::alarmUpdateWorker(Alarm *alarm)
+void ClientSession::sendPendingAlarmUpdates()
 {
-   NXCPMessage msg(CMD_ALARM_UPDATE, 0);
-   alarm->fillMessage(&msg);
    MutexLock(m_mutexSendAlarms);
-   sendMessage(&msg);
+
+   MutexLock(m_pendingAlarmUpdatesLock);
+   ObjectArray<ClientPendingAlarmUpdate> *updates = m_pendingAlarmUpdates;
+   m_pendingAlarmUpdates = new ObjectArray<ClientPendingAlarmUpdate>(0, 64, Ownership::True);
+   m_pendingAlarmUpdateIndex->clear();
+   MutexUnlock(m_pendingAlarmUpdatesLock);
+
+   for(int i = 0; i < updates->size(); i++)
+   {
+      ClientBroadcastMessage *msg = updates->get(i)->msg;
+      postBroadcastMessage(msg, false);
+      msg->decRefCount();
+   }
+   delete updates;
+
    MutexUnlock(m_mutexSendAlarms);
-   delete alarm;
+   decRefCount();
 }
 
 /**
- * Process changes in alarms
+ * Process changes in alarms. Updates are sent in order of arrival. Update
+ * for alarm which already has pending update with same notification code
+ * replaces it, so creation or termination of alarm is never hidden by
+ * subsequent change.
  */
-void ClientSession::onAlarmUpdate(UINT32 code, const Alarm *alarm)
+void ClientSession::onAlarmUpdate(UINT32 code, const Alarm *alarm, ClientBroadcastMessage *msg)
 {
    if (isAuthenticated() && isSubscribedTo(NXC_CHANNEL_ALARMS))
    {
@@ -5818,7 +6218,29 @@ void ClientSession::onAlarmUpdate(UINT32 code, const Alarm *alarm)
           object->checkAccessRights(m_dwUserId, OBJECT_ACCESS_READ_ALARMS) &&
           alarm->checkCategoryAccess(this))
       {
-         ThreadPoolExecute(g_clientThreadPool, this, &ClientSession::alarmUpdateWorker, new Alarm(alarm, false, code));
+         MutexLock(m_pendingAlarmUpdatesLock);
+         bool schedule = m_pendingAlarmUpdates->isEmpty();
+         ClientPendingAlarmUpdate *u = m_pendingAlarmUpdateIndex->get(alarm->getAlarmId());
+         if ((u != NULL) && (u->code == code))
+         {
+            u->msg->decRefCount();
+         }
+         else
+         {
+            u = new ClientPendingAlarmUpdate;
+            u->alarmId = alarm->getAlarmId();
+            u->code = code;
+            m_pendingAlarmUpdates->add(u);
+            m_pendingAlarmUpdateIndex->set(u->alarmId, u);
+         }
+         msg->incRefCount();
+         u->msg = msg;
+         MutexUnlock(m_pendingAlarmUpdatesLock);
+         if (schedule)
+         {
+            incRefCount();
+            ThreadPoolExecute(g_clientThreadPool, this, &ClientSession::sendPendingAlarmUpdates);
+         }
       }
    }
 }
@@ -8635,17 +9057,15 @@ void ClientSession::KillSession(NXCPMessage *pRequest)
 /**
  * Handler for new syslog messages
  */
-void ClientSession::onSyslogMessage(NX_SYSLOG_RECORD *pRec)
+void ClientSession::onSyslogMessage(const NX_SYSLOG_RECORD *rec, ClientBroadcastMessage *msg)
 {
    if (isAuthenticated() && isSubscribedTo(NXC_CHANNEL_SYSLOG) && (m_systemAccessRights & SYSTEM_ACCESS_VIEW_SYSLOG))
    {
-      NetObj *object = FindObjectById(pRec->dwSourceObject);
+      NetObj *object = FindObjectById(rec->dwSourceObject);
       // If can't find object - just send to all events, if object found send to thous who have rights
       if (object == NULL || object->checkAccessRights(m_dwUserId, OBJECT_ACCESS_READ_ALARMS))
       {
-         NXCPMessage msg(CMD_SYSLOG_RECORDS, 0);
-         CreateMessageFromSyslogMsg(&msg, pRec);
-         postMessage(&msg);
+         postBroadcastMessage(msg, true);
       }
    }
 }
@@ -8653,15 +9073,15 @@ void ClientSession::onSyslogMessage(NX_SYSLOG_RECORD *pRec)
 /**
  * Handler for new traps
  */
-void ClientSession::onNewSNMPTrap(NXCPMessage *pMsg)
+void ClientSession::onNewSNMPTrap(ClientBroadcastMessage *msg)
 {
    if (isAuthenticated() && isSubscribedTo(NXC_CHANNEL_SNMP_TRAPS) && (m_systemAccessRights & SYSTEM_ACCESS_VIEW_TRAP_LOG))
    {
-      NetObj *object = FindObjectById(pMsg->getFieldAsUInt32(VID_TRAP_LOG_MSG_BASE + 3));
+      NetObj *object = FindObjectById(msg->getMessage()->getFieldAsUInt32(VID_TRAP_LOG_MSG_BASE + 3));
       // If can't find object - just send to all events, if object found send to thous who have rights
       if ((object == NULL) || object->checkAccessRights(m_dwUserId, OBJECT_ACCESS_READ_ALARMS))
       {
-         postMessage(pMsg);
+         postBroadcastMessage(msg, true);
       }
    }
 }
@@ -9914,7 +10334,7 @@ void ClientSession::importConfiguration(NXCPMessage *pRequest)
             // Lock all required components
             if (LockComponent(CID_EPP, m_id, m_sessionName, NULL, szLockInfo))
             {
-               m_dwFlags |= CSF_EPP_LOCKED;
+               InterlockedOr(&m_dwFlags, CSF_EPP_LOCKED);
 
                // Validate and import configuration
                dwFlags = pRequest->getFieldAsUInt32(VID_FLAGS);
@@ -9929,7 +10349,7 @@ void ClientSession::importConfiguration(NXCPMessage *pRequest)
                }
 
 					UnlockComponent(CID_EPP);
-               m_dwFlags &= ~CSF_EPP_LOCKED;
+               InterlockedAnd(&m_dwFlags, ~CSF_EPP_LOCKED);
             }
             else
             {
@@ -12624,7 +13044,7 @@ void ClientSession::openConsole(UINT32 rqId)
 	{
       if (!(m_dwFlags & CSF_CONSOLE_OPEN))
       {
-         m_dwFlags |= CSF_CONSOLE_OPEN;
+         InterlockedOr(&m_dwFlags, CSF_CONSOLE_OPEN);
          m_console = new ClientSessionConsole(this);
       }
       msg.setField(VID_RCC, RCC_SUCCESS);
@@ -12651,7 +13071,7 @@ void ClientSession::closeConsole(UINT32 rqId)
 	{
 		if (m_dwFlags & CSF_CONSOLE_OPEN)
 		{
-			m_dwFlags &= ~CSF_CONSOLE_OPEN;
+			InterlockedAnd(&m_dwFlags, ~CSF_CONSOLE_OPEN);
 			delete_and_null(m_console);
 			msg.setField(VID_RCC, RCC_SUCCESS);
 		}
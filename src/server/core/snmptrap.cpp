@@ -45,6 +45,7 @@ static ObjectArray<SNMPTrapConfiguration> m_trapCfgList(16, 4, Ownership::True);
 static bool s_logAllTraps = false;
 static VolatileCounter64 s_trapId = 0; // Next free trap ID
 static bool s_allowVarbindConversion = true;
+static SNMP_MIBIndex *s_mibIndex = NULL;
 static UINT16 m_wTrapPort = 162;
 
 /**
@@ -402,6 +403,19 @@ void InitTraps()
 	s_logAllTraps = ConfigReadBoolean(_T("LogAllSNMPTraps"), false);
 	s_allowVarbindConversion = ConfigReadBoolean(_T("AllowTrapVarbindsConversion"), true);
 
+	if (ConfigReadBoolean(_T("SNMP.Traps.ResolveVarbindNames"), false))
+	{
+	   TCHAR mibFile[MAX_PATH];
+	   _tcscpy(mibFile, g_netxmsdDataDir);
+	   _tcscat(mibFile, DFILE_MIB_INDEX);
+	   UINT32 rcc;
+	   s_mibIndex = SNMP_MIBIndex::load(mibFile, &rcc);
+	   if (s_mibIndex != NULL)
+	      nxlog_debug_tag(DEBUG_TAG, 2, _T("MIB index loaded from %s (%u objects)"), mibFile, s_mibIndex->getNodeCount());
+	   else
+	      nxlog_debug_tag(DEBUG_TAG, 2, _T("Cannot load MIB index from %s (%s), varbind names will not be resolved"), mibFile, SNMPGetErrorText(rcc));
+	}
+
 	DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
 	DB_RESULT hResult = DBSelect(hdb, _T("SELECT max(trap_id) FROM snmp_trap_log"));
 	if (hResult != NULL)
@@ -502,7 +516,7 @@ static void GenerateTrapEvent(Node *node, UINT32 dwIndex, SNMP_PDU *pdu, int sou
 /**
  * Handler for EnumerateSessions()
  */
-static void BroadcastNewTrap(ClientSession *pSession, NXCPMessage *msg)
+static void BroadcastNewTrap(ClientSession *pSession, ClientBroadcastMessage *msg)
 {
    pSession->onNewSNMPTrap(msg);
 }
@@ -521,7 +535,10 @@ static StringBuffer BuildVarbindList(SNMP_PDU *pdu)
       if (!out.isEmpty())
          out.append(_T("; "));
 
-      v->getName().toString(oidText, 1024);
+      if (s_mibIndex != NULL)
+         s_mibIndex->getSymbolicName(v->getName(), oidText, 1024);
+      else
+         v->getName().toString(oidText, 1024);
 
       bool convertToHex = true;
       if (s_allowVarbindConversion)
@@ -592,16 +609,21 @@ void ProcessTrap(SNMP_PDU *pdu, const InetAddress& srcAddr, UINT32 zoneUIN, int
       QueueSQLRequest(szQuery);
 
       // Notify connected clients
-      msg.setCode(CMD_TRAP_LOG_RECORDS);
-      msg.setField(VID_NUM_RECORDS, (UINT32)1);
-      msg.setField(VID_RECORDS_ORDER, (WORD)RECORD_ORDER_NORMAL);
-      msg.setField(VID_TRAP_LOG_MSG_BASE, trapId);
-      msg.setField(VID_TRAP_LOG_MSG_BASE + 1, dwTimeStamp);
-      msg.setField(VID_TRAP_LOG_MSG_BASE + 2, srcAddr);
-      msg.setField(VID_TRAP_LOG_MSG_BASE + 3, (node != NULL) ? node->getId() : (UINT32)0);
-      msg.setField(VID_TRAP_LOG_MSG_BASE + 4, pdu->getTrapId()->toString(oidText, 1024));
-      msg.setField(VID_TRAP_LOG_MSG_BASE + 5, varbinds);
-      EnumerateClientSessions(BroadcastNewTrap, &msg);
+      if (IsClientChannelSubscribed(NXC_CHANNEL_SNMP_TRAPS))
+      {
+         msg.setCode(CMD_TRAP_LOG_RECORDS);
+         msg.setField(VID_NUM_RECORDS, (UINT32)1);
+         msg.setField(VID_RECORDS_ORDER, (WORD)RECORD_ORDER_NORMAL);
+         msg.setField(VID_TRAP_LOG_MSG_BASE, trapId);
+         msg.setField(VID_TRAP_LOG_MSG_BASE + 1, dwTimeStamp);
+         msg.setField(VID_TRAP_LOG_MSG_BASE + 2, srcAddr);
+         msg.setField(VID_TRAP_LOG_MSG_BASE + 3, (node != NULL) ? node->getId() : (UINT32)0);
+         msg.setField(VID_TRAP_LOG_MSG_BASE + 4, pdu->getTrapId()->toString(oidText, 1024));
+         msg.setField(VID_TRAP_LOG_MSG_BASE + 5, varbinds);
+         ClientBroadcastMessage *bmsg = new ClientBroadcastMessage(&msg);
+         EnumerateClientSessions(BroadcastNewTrap, bmsg);
+         bmsg->decRefCount();
+      }
    }
    else if (nxlog_get_debug_level_tag(DEBUG_TAG) >= 5)
    {
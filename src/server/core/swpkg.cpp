@@ -226,3 +226,27 @@ bool SoftwarePackage::saveToDatabase(DB_STATEMENT hStmt) const
    DBBind(hStmt, 7, DB_SQLTYPE_VARCHAR, m_description, DB_BIND_STATIC, 255);
    return DBExecute(hStmt);
 }
+
+/**
+ * Delete software package data from database. Statement should have node ID bound at position 1
+ * and expect package name and version at positions 2 and 3.
+ */
+bool SoftwarePackage::deleteFromDatabase(DB_STATEMENT hStmt) const
+{
+   DBBind(hStmt, 2, DB_SQLTYPE_VARCHAR, m_name, DB_BIND_STATIC, 127);
+   DBBind(hStmt, 3, DB_SQLTYPE_VARCHAR, m_version, DB_BIND_STATIC, 63);
+   return DBExecute(hStmt);
+}
+
+/**
+ * Check if all stored attributes of this package are equal to attributes of given package
+ */
+bool SoftwarePackage::equals(const SoftwarePackage *p) const
+{
+   return !_tcscmp(CHECK_NULL_EX(m_name), CHECK_NULL_EX(p->m_name)) &&
+          !_tcscmp(CHECK_NULL_EX(m_version), CHECK_NULL_EX(p->m_version)) &&
+          !_tcscmp(CHECK_NULL_EX(m_vendor), CHECK_NULL_EX(p->m_vendor)) &&
+          (m_date == p->m_date) &&
+          !_tcscmp(CHECK_NULL_EX(m_url), CHECK_NULL_EX(p->m_url)) &&
+          !_tcscmp(CHECK_NULL_EX(m_description), CHECK_NULL_EX(p->m_description));
+}
@@ -64,22 +64,80 @@ void NXCORE_EXPORTABLE ObjectTransactionEnd()
 }
 
 /**
- * Save object to database on separate thread
+ * Maximum number of objects saved in single transaction
  */
-static void SaveObject(NetObj *object)
+#define MAX_OBJECTS_PER_TRANSACTION    256
+
+/**
+ * Save single object to database in separate transaction
+ */
+static void SaveObject(DB_HANDLE hdb, NetObj *object)
 {
-   DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+   UINT32 flags = object->getModifiedFlags();
    DBBegin(hdb);
    if (object->saveToDatabase(hdb))
    {
       DBCommit(hdb);
-      object->markAsSaved();
+      object->markAsSaved(flags);
+   }
+   else
+   {
+      DBRollback(hdb);
+      nxlog_debug_tag(DEBUG_TAG_OBJECT_SYNC, 4, _T("Call to saveToDatabase() failed for object %s [%u], transaction rollback"), object->getName(), object->getId());
+   }
+}
+
+/**
+ * Save group of objects to database in single transaction. If transaction fails,
+ * objects are saved again one by one, so that single failing object will not prevent
+ * other objects from being saved.
+ */
+static void SaveObjectGroup(DB_HANDLE hdb, ObjectArray<NetObj> *objects)
+{
+   if (objects->size() == 1)
+   {
+      SaveObject(hdb, objects->get(0));
+      return;
+   }
+
+   // Modification flags are captured before saving so that changes made
+   // while transaction is in progress will not be lost
+   UINT32 *flags = MemAllocArrayNoInit<UINT32>(objects->size());
+   bool success = DBBegin(hdb);
+   for(int i = 0; success && (i < objects->size()); i++)
+   {
+      NetObj *object = objects->get(i);
+      flags[i] = object->getModifiedFlags();
+      success = object->saveToDatabase(hdb);
+      if (!success)
+         nxlog_debug_tag(DEBUG_TAG_OBJECT_SYNC, 4, _T("Call to saveToDatabase() failed for object %s [%u] within object group"), object->getName(), object->getId());
+   }
+
+   if (success && DBCommit(hdb))
+   {
+      for(int i = 0; i < objects->size(); i++)
+         objects->get(i)->markAsSaved(flags[i]);
+      nxlog_debug_tag(DEBUG_TAG_OBJECT_SYNC, 6, _T("%d objects saved in single transaction"), objects->size());
    }
    else
    {
       DBRollback(hdb);
+      nxlog_debug_tag(DEBUG_TAG_OBJECT_SYNC, 4, _T("Transaction for group of %d objects failed, saving objects individually"), objects->size());
+      for(int i = 0; i < objects->size(); i++)
+         SaveObject(hdb, objects->get(i));
    }
+   MemFree(flags);
+}
+
+/**
+ * Save group of objects to database on separate thread
+ */
+static void SaveObjectGroupCallback(ObjectArray<NetObj> *objects)
+{
+   DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+   SaveObjectGroup(hdb, objects);
    DBConnectionPoolReleaseConnection(hdb);
+   delete objects;
    InterlockedDecrement(&s_outstandingSaveRequests);
 }
 
@@ -93,6 +151,7 @@ void SaveObjects(DB_HANDLE hdb, UINT32 watchdogId, bool saveRuntimeData)
    if (g_flags & AF_ENABLE_OBJECT_TRANSACTIONS)
       RWLockWriteLock(s_objectTxnLock);
 
+   ObjectArray<NetObj> modifiedObjects(1024, 1024, Ownership::False);
 	ObjectArray<NetObj> *objects = g_idxObjectById.getObjects(false);
    nxlog_debug_tag(DEBUG_TAG_SYNC, 5, _T("%d objects to process"), objects->size());
 	for(int i = 0; i < objects->size(); i++)
@@ -127,24 +186,7 @@ void SaveObjects(DB_HANDLE hdb, UINT32 watchdogId, bool saveRuntimeData)
 		else if (object->isModified())
 		{
 		   nxlog_debug_tag(DEBUG_TAG_OBJECT_SYNC, 5, _T("Object %s [%d] modified"), object->getName(), object->getId());
-		   if (g_syncerThreadPool != NULL)
-		   {
-		      InterlockedIncrement(&s_outstandingSaveRequests);
-		      ThreadPoolExecute(g_syncerThreadPool, SaveObject, object);
-		   }
-		   else
-		   {
-            DBBegin(hdb);
-            if (object->saveToDatabase(hdb))
-            {
-               DBCommit(hdb);
-               object->markAsSaved();
-            }
-            else
-            {
-               DBRollback(hdb);
-            }
-		   }
+		   modifiedObjects.add(object);
 		}
 		else if (saveRuntimeData)
 		{
@@ -152,6 +194,34 @@ void SaveObjects(DB_HANDLE hdb, UINT32 watchdogId, bool saveRuntimeData)
 		}
    }
 
+   // Split modified objects into groups saved in single transaction. If thread pool
+   // is available, objects are distributed evenly between pool threads.
+   int groupSize = MAX_OBJECTS_PER_TRANSACTION;
+   if (g_syncerThreadPool != NULL)
+   {
+      ThreadPoolInfo info;
+      ThreadPoolGetInfo(g_syncerThreadPool, &info);
+      groupSize = std::min((modifiedObjects.size() + info.maxThreads - 1) / info.maxThreads, MAX_OBJECTS_PER_TRANSACTION);
+   }
+   nxlog_debug_tag(DEBUG_TAG_SYNC, 5, _T("%d modified objects to save (up to %d objects per transaction)"), modifiedObjects.size(), groupSize);
+   for(int i = 0; i < modifiedObjects.size(); i += groupSize)
+   {
+      WatchdogNotify(watchdogId);
+      ObjectArray<NetObj> *group = new ObjectArray<NetObj>(groupSize, 16, Ownership::False);
+      for(int j = i; (j < i + groupSize) && (j < modifiedObjects.size()); j++)
+         group->add(modifiedObjects.get(j));
+      if (g_syncerThreadPool != NULL)
+      {
+         InterlockedIncrement(&s_outstandingSaveRequests);
+         ThreadPoolExecute(g_syncerThreadPool, SaveObjectGroupCallback, group);
+      }
+      else
+      {
+         SaveObjectGroup(hdb, group);
+         delete group;
+      }
+   }
+
 	if (g_syncerThreadPool != NULL)
 	{
 	   while(s_outstandingSaveRequests > 0)
@@ -373,13 +373,22 @@ static Node *BindMsgToNode(NX_SYSLOG_RECORD *pRec, const InetAddress& sourceAddr
    return node;
 }
 
+/**
+ * Syslog message broadcast context
+ */
+struct SyslogBroadcastContext
+{
+   const NX_SYSLOG_RECORD *record;
+   ClientBroadcastMessage *msg;
+};
+
 /**
  * Handler for EnumerateSessions()
  */
 static void BroadcastSyslogMessage(ClientSession *pSession, void *pArg)
 {
    if (pSession->isAuthenticated())
-      pSession->onSyslogMessage((NX_SYSLOG_RECORD *)pArg);
+      pSession->onSyslogMessage(((SyslogBroadcastContext *)pArg)->record, ((SyslogBroadcastContext *)pArg)->msg);
 }
 
 /**
@@ -467,7 +476,15 @@ static void ProcessSyslogMessage(QueuedSyslogMessage *msg)
       g_syslogWriteQueue.put(MemCopyBlock(&record, sizeof(NX_SYSLOG_RECORD)));
 
       // Send message to all connected clients
-      EnumerateClientSessions(BroadcastSyslogMessage, &record);
+      if (IsClientChannelSubscribed(NXC_CHANNEL_SYSLOG))
+      {
+         SyslogBroadcastContext context;
+         context.record = &record;
+         context.msg = new ClientBroadcastMessage(CMD_SYSLOG_RECORDS);
+         CreateMessageFromSyslogMsg(context.msg->getMessage(), &record);
+         EnumerateClientSessions(BroadcastSyslogMessage, &context);
+         context.msg->decRefCount();
+      }
 
 		TCHAR ipAddr[64];
 		nxlog_debug_tag(DEBUG_TAG, 6, _T("Syslog message: ipAddr=%s zone=%d objectId=%d tag=\"%hs\" msg=\"%hs\""),
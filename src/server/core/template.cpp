@@ -62,6 +62,7 @@ Template::Template() : super(), AutoBindTarget(this), VersionableObject(this)
 {
    m_policyList = new HashMap<uuid, GenericAgentPolicy>(Ownership::True);
    m_deletedPolicyList = new ObjectArray<GenericAgentPolicy>(0, 16, Ownership::True);
+   m_savedDeletedPolicyCount = 0;
 }
 
 /**
@@ -81,6 +82,7 @@ Template::Template(ConfigEntry *config) : super(config), AutoBindTarget(this, co
 
    m_policyList = new HashMap<uuid, GenericAgentPolicy>(Ownership::True);
    m_deletedPolicyList = new ObjectArray<GenericAgentPolicy>(0, 16, Ownership::True);
+   m_savedDeletedPolicyCount = 0;
    ObjectArray<ConfigEntry> *dcis = config->getSubEntries(_T("agentPolicy#*"));
    for(int i = 0; i < dcis->size(); i++)
    {
@@ -102,6 +104,7 @@ Template::Template(const TCHAR *pszName) : super(pszName), AutoBindTarget(this),
 {
    m_policyList = new HashMap<uuid, GenericAgentPolicy>(Ownership::True);
    m_deletedPolicyList = new ObjectArray<GenericAgentPolicy>(0, 16, Ownership::True);
+   m_savedDeletedPolicyCount = 0;
 }
 
 /**
@@ -176,11 +179,10 @@ bool Template::saveToDatabase(DB_HANDLE hdb)
    {
       lockProperties();
 
+      // Deleted policies are removed from list in markAsSaved() after transaction is committed
       for(int i = 0; (i < m_deletedPolicyList->size()) && success; i++)
          success = m_deletedPolicyList->get(i)->deleteFromDatabase(hdb);
-
-      if (success)
-         m_deletedPolicyList->clear();
+      m_savedDeletedPolicyCount = success ? m_deletedPolicyList->size() : 0;
 
       Iterator<GenericAgentPolicy> *it = m_policyList->iterator();
       while(it->hasNext() && success)
@@ -196,6 +198,23 @@ bool Template::saveToDatabase(DB_HANDLE hdb)
    return success;
 }
 
+/**
+ * Mark template as saved. Called after transaction with changes is committed.
+ */
+void Template::markAsSaved(UINT32 flags)
+{
+   if (flags & MODIFY_POLICY)
+   {
+      lockProperties();
+      // Policies deleted after last save are still pending
+      for(int i = 0; (i < m_savedDeletedPolicyCount) && !m_deletedPolicyList->isEmpty(); i++)
+         m_deletedPolicyList->remove(0);
+      m_savedDeletedPolicyCount = 0;
+      unlockProperties();
+   }
+   super::markAsSaved(flags);
+}
+
 /**
  * Delete template object from database
  */
@@ -179,6 +179,7 @@
 #define CSF_SYNC_OBJECT_COMMENTS ((UINT32)0x00000400)
 #define CSF_OBJECT_SYNC_FINISHED ((UINT32)0x00000800)
 #define CSF_OBJECTS_OUT_OF_SYNC  ((UINT32)0x00001000)
+#define CSF_DELTA_OBJECT_UPDATES ((UINT32)0x00002000)
 #define CSF_CUSTOM_LOCK_1        ((UINT32)0x01000000)
 #define CSF_CUSTOM_LOCK_2        ((UINT32)0x02000000)
 #define CSF_CUSTOM_LOCK_3        ((UINT32)0x04000000)
@@ -479,6 +480,78 @@ typedef int session_id_t;
 template class NXCORE_EXPORTABLE AbstractIndex<AgentConnection>;
 #endif
 
+/**
+ * Message broadcasted to multiple client sessions. Message is serialized
+ * once for each compression mode and serialized buffer is shared by all
+ * sessions it is posted to.
+ */
+class NXCORE_EXPORTABLE ClientBroadcastMessage : public RefCountObject
+{
+private:
+   NXCPMessage m_msg;
+   NXCP_MESSAGE *m_serialized[2];
+   Mutex m_mutex;
+
+protected:
+   virtual ~ClientBroadcastMessage();
+
+public:
+   ClientBroadcastMessage(UINT16 code);
+   ClientBroadcastMessage(NXCPMessage *msg);
+
+   NXCPMessage *getMessage() { return &m_msg; }
+   const NXCP_MESSAGE *getSerializedMessage(bool compressed);
+};
+
+/**
+ * Message in client session outbound queue
+ */
+struct ClientOutboundMessage
+{
+   ClientOutboundMessage *next;
+   NXCP_MESSAGE *msg;                  // Serialized message owned by queue or NULL
+   ClientBroadcastMessage *broadcast;  // Shared message or NULL
+   INT64 timestamp;
+   UINT32 size;
+};
+
+/**
+ * Pending object update in client session outbound queue
+ */
+struct ClientPendingObjectUpdate
+{
+   NetObj *object;
+   UINT64 baseRevision; // Revision of first pending change
+   INT64 timestamp;     // Time of first pending change
+};
+
+/**
+ * Pending alarm update
+ */
+struct ClientPendingAlarmUpdate
+{
+   UINT32 alarmId;
+   UINT32 code;                  // Notification code
+   ClientBroadcastMessage *msg;
+};
+
+/**
+ * Client session outbound queue statistics
+ */
+struct ClientOutboundQueueStats
+{
+   UINT32 queuedMessages;
+   UINT32 pendingObjectUpdates;
+   UINT64 queuedBytes;
+   UINT64 messagesSent;
+   UINT64 bytesSent;
+   UINT64 coalescedUpdates;
+   UINT32 droppedMessages;
+   UINT32 resyncCount;
+   UINT32 currentLag;   // milliseconds
+   UINT32 maxLag;       // milliseconds
+};
+
 /**
  * Client (user) session
  */
@@ -489,7 +562,7 @@ class NXCORE_EXPORTABLE ClientSession
    session_id_t m_id;
    UINT32 m_dwUserId;
    UINT64 m_systemAccessRights; // User's system access rights
-   UINT32 m_dwFlags;            // Session flags
+   VolatileCounter m_dwFlags;   // Session flags
 	int m_clientType;				  // Client system type - desktop, web, mobile, etc.
    NXCPEncryptionContext *m_pCtx;
 	BYTE m_challenge[CLIENT_CHALLENGE_SIZE];
@@ -526,9 +599,20 @@ class NXCORE_EXPORTABLE ClientSession
 	ObjectArray<TcpProxy> *m_tcpProxyConnections;
 	MUTEX m_tcpProxyLock;
 	VolatileCounter m_tcpProxyChannelId;
-	HashSet<UINT32> *m_pendingObjectNotifications;
-   MUTEX m_pendingObjectNotificationsLock;
+   MUTEX m_outboundQueueLock;
+   ClientOutboundMessage *m_outboundQueueHead;
+   ClientOutboundMessage *m_outboundQueueTail;
+   INT64 m_outboundSendTimestamp;   // Queue time of oldest message in batch being sent (0 if none)
+   HashMap<UINT32, ClientPendingObjectUpdate> *m_pendingObjectUpdates;  // Object ID -> pending update
+   UINT32 m_objectUpdateSizeEstimate;
    UINT32 m_objectNotificationDelay;
+   bool m_outboundQueueWorkerActive;
+   bool m_outboundQueueTimerActive;
+   UINT32 m_outboundQueueDrops;   // Messages dropped since last report
+   ClientOutboundQueueStats m_outboundQueueStats;
+   ObjectArray<ClientPendingAlarmUpdate> *m_pendingAlarmUpdates;   // In order of arrival
+   HashMap<UINT32, ClientPendingAlarmUpdate> *m_pendingAlarmUpdateIndex;  // Alarm ID -> last pending update
+   MUTEX m_pendingAlarmUpdatesLock;
 
    static THREAD_RESULT THREAD_CALL readThreadStarter(void *);
    static void pollerThreadStarter(void *);
@@ -539,7 +623,13 @@ class NXCORE_EXPORTABLE ClientSession
    void processRequest(NXCPMessage *request);
 
    void postRawMessageAndDelete(NXCP_MESSAGE *msg);
-   void sendRawMessageAndDelete(NXCP_MESSAGE *msg);
+   void enqueueOutboundMessage(NXCP_MESSAGE *msg, ClientBroadcastMessage *broadcast);
+   bool isOutboundQueueOverflow() const;
+   INT64 getOutboundQueueLag() const;
+   void scheduleOutboundQueueProcessing();
+   void processOutboundQueue();
+   void onOutboundQueueTimer();
+   void dropPendingObjectUpdates();
 
    void debugPrintf(int level, const TCHAR *format, ...);
 
@@ -816,10 +906,11 @@ class NXCORE_EXPORTABLE ClientSession
 
    void registerServerCommand(ProcessExecutor *command) { m_serverCommands->set(command->getStreamId(), command); }
 
-   void alarmUpdateWorker(Alarm *alarm);
+   void sendPendingAlarmUpdates();
    void sendActionDBUpdateMessage(NXCP_MESSAGE *msg);
-   void sendObjectUpdate(NetObj *object);
-   void scheduleObjectUpdate(NetObj *object);
+   UINT32 sendObjectUpdate(NetObj *object, UINT64 baseRevision);
+   UINT32 getObjectAccessKey(NetObj *object);
+   bool sendObjectMessage(NetObj *object, UINT16 code, UINT32 groups, UINT32 *size = NULL);
 
 public:
    ClientSession(SOCKET hSocket, const InetAddress& addr);
@@ -831,8 +922,9 @@ class NXCORE_EXPORTABLE ClientSession
    bool start();
 
    void postMessage(NXCPMessage *msg);
+   void postBroadcastMessage(ClientBroadcastMessage *msg, bool droppable = false);
    bool sendMessage(NXCPMessage *msg);
-   void sendRawMessage(NXCP_MESSAGE *msg);
+   bool sendRawMessage(NXCP_MESSAGE *msg);
    void sendPollerMsg(UINT32 dwRqId, const TCHAR *pszMsg);
 	BOOL sendFile(const TCHAR *file, UINT32 dwRqId, long offset, bool allowCompression = true);
 
@@ -858,6 +950,7 @@ class NXCORE_EXPORTABLE ClientSession
    int getCipher() const { return (m_pCtx == NULL) ? -1 : m_pCtx->getCipher(); }
 	int getClientType() const { return m_clientType; }
    time_t getLoginTime() const { return m_loginTime; }
+   void getOutboundQueueStats(ClientOutboundQueueStats *stats);
    bool isSubscribedTo(const TCHAR *channel) const;
    bool isDCOpened(UINT32 dcId) const;
 
@@ -870,9 +963,9 @@ class NXCORE_EXPORTABLE ClientSession
    void setCustomLock(UINT32 bit, bool value)
    {
       if (value)
-         m_dwFlags |= (bit & 0xFF000000);
+         InterlockedOr(&m_dwFlags, (bit & 0xFF000000));
       else
-         m_dwFlags &= ~(bit & 0xFF000000);
+         InterlockedAnd(&m_dwFlags, ~(bit & 0xFF000000));
    }
 
    void kill();
@@ -880,11 +973,11 @@ class NXCORE_EXPORTABLE ClientSession
 
    void updateSystemAccessRights();
 
-   void onNewEvent(Event *pEvent);
-   void onSyslogMessage(NX_SYSLOG_RECORD *pRec);
-   void onNewSNMPTrap(NXCPMessage *pMsg);
+   void onNewEvent(Event *event, ClientBroadcastMessage *msg);
+   void onSyslogMessage(const NX_SYSLOG_RECORD *rec, ClientBroadcastMessage *msg);
+   void onNewSNMPTrap(ClientBroadcastMessage *msg);
    void onObjectChange(NetObj *pObject);
-   void onAlarmUpdate(UINT32 dwCode, const Alarm *alarm);
+   void onAlarmUpdate(UINT32 code, const Alarm *alarm, ClientBroadcastMessage *msg);
    void onActionDBUpdate(UINT32 dwCode, const Action *action);
    void onLibraryImageChange(const uuid& guid, bool removed = false);
    void processTcpProxyData(AgentConnectionEx *conn, UINT32 agentChannelId, const void *data, size_t size);
@@ -1081,6 +1174,42 @@ UINT64 GetRawDataWriterMemoryUsage();
 void StartDBWriter();
 void StopDBWriter();
 
+/**
+ * Data partition created within data writer's transaction
+ */
+struct NewDataPartition
+{
+   int type;
+   UINT32 nodeId;
+   INT64 start;
+};
+
+void InitDataPartitioning();
+bool IsDataPartitioningEnabled();
+void CreateDataPartitions(DB_HANDLE hdb, UINT32 nodeId);
+bool GetDataInsertTable(DB_HANDLE hdb, int type, UINT32 nodeId, time_t timestamp, TCHAR *buffer, size_t size, StructArray<NewDataPartition> *newPartitions);
+void CompleteDataPartitionCreation(StructArray<NewDataPartition> *newPartitions, bool committed);
+void ResetDataPartitionCache();
+StringList *GetDataPartitionTables(DB_HANDLE hdb, int type, UINT32 nodeId, time_t timeFrom, time_t timeTo);
+String GetDataSelectSource(int type, UINT32 nodeId, time_t timeFrom, time_t timeTo);
+bool DeleteFromDataPartitions(DB_HANDLE hdb, int type, UINT32 nodeId, const TCHAR *condition, time_t timeFrom, time_t timeTo);
+void DropExpiredDataPartitions(DB_HANDLE hdb, int type, UINT32 nodeId, time_t cutoffTime);
+void QueueDropDataPartitions(UINT32 nodeId);
+
+void InitDataRollups();
+bool IsDataRollupEnabled();
+void StopDataRollupWriter();
+void RegisterPendingDataRollupValue(time_t timestamp);
+void ReleasePendingDataRollupValue(time_t timestamp);
+void UpdateDataRollups(UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass, time_t timestamp, const TCHAR *value);
+bool ReadDataRollupDeletionTotals(DB_HANDLE hdb, UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass, time_t timestamp, INT32 *count, double *sum);
+void RemoveFromDataRollups(UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass, time_t timestamp, INT32 count, double sum);
+void DeleteDataRollups(UINT32 nodeId, UINT32 dciId);
+void DeleteExpiredDataRollups(DB_HANDLE hdb);
+bool RebuildDataRollups(DB_HANDLE hdb, UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass);
+TCHAR *GetDataRollupAggregateValue(UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass, AggregationFunction func, time_t periodStart, time_t periodEnd);
+StructArray<DciValue> *GetDataRollupSeries(UINT32 nodeId, UINT32 dciId, DCObjectStorageClass storageClass, time_t timeFrom, time_t timeTo, int pollingInterval, int maxRows);
+
 void PerfDataStorageRequest(DCItem *dci, time_t timestamp, const TCHAR *value);
 void PerfDataStorageRequest(DCTable *dci, time_t timestamp, Table *value);
 
@@ -1123,6 +1252,7 @@ Node NXCORE_EXPORTABLE *PollNewNode(NewNodeData *newNodeData);
 INT64 GetDiscoveryPollerQueueSize();
 
 void NXCORE_EXPORTABLE EnumerateClientSessions(void (*handler)(ClientSession *, void *), void *context);
+bool NXCORE_EXPORTABLE IsClientChannelSubscribed(const TCHAR *channel);
 template <typename C> void EnumerateClientSessions(void (*handler)(ClientSession *, C *), C *context)
 {
    EnumerateClientSessions(reinterpret_cast<void (*)(ClientSession *, void *)>(handler), context);
@@ -1244,6 +1374,7 @@ THREAD_RESULT NXCORE_EXPORTABLE THREAD_CALL SignalHandler(void *);
 #endif   /* not _WIN32 */
 
 void DumpClientSessions(CONSOLE_CTX console);
+void DumpClientSessionQueues(CONSOLE_CTX console);
 void DumpMobileDeviceSessions(CONSOLE_CTX console);
 void ShowServerStats(CONSOLE_CTX console);
 void ShowQueueStats(CONSOLE_CTX console, Queue *pQueue, const TCHAR *pszName);
@@ -1420,6 +1551,8 @@ extern FileMonitoringList g_monitoringList;
 
 extern NXCORE_EXPORTABLE_VAR(ThreadPool *g_mainThreadPool);
 extern NXCORE_EXPORTABLE_VAR(ThreadPool *g_clientThreadPool);
+extern UINT64 g_clientOutboundQueueSize;
+extern UINT32 g_clientOutboundQueueMaxLag;
 
 #endif   /* MODULE_NXDBMGR_EXTENSION */
 
@@ -367,6 +367,7 @@ class NXCORE_EXPORTABLE DCObject
    INT16 getAgentCacheMode();
    bool hasValue();
    bool hasAccess(UINT32 userId);
+   bool hasAccessList() const { return !m_accessList->isEmpty(); }
    UINT32 getRelatedObject() const { return m_relatedObject; }
 
 	bool matchClusterResource();
@@ -100,10 +100,14 @@ class NXCORE_EXPORTABLE Event
    time_t m_originTimestamp;
    StringSet m_tags;
 	TCHAR *m_customMessage;
+   MemoryPool m_pool;         // storage for parameter values
 	Array m_parameters;
 	StringList m_parameterNames;
 
 	void init(const EventTemplate *eventTemplate, EventOrigin origin, time_t originTimestamp, UINT32 sourceId, UINT32 dciId, const TCHAR *tag);
+   void addParameterValue(const TCHAR *value) { m_parameters.add(m_pool.copyString(value)); }
+   void addPreallocatedParameterValue(TCHAR *value);
+   void replaceParameterValue(int index, const TCHAR *value);
 
 public:
    Event();
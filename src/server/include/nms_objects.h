@@ -588,6 +588,8 @@ class SoftwarePackage
 
 	void fillMessage(NXCPMessage *msg, UINT32 baseId) const;
 	bool saveToDatabase(DB_STATEMENT hStmt) const;
+	bool deleteFromDatabase(DB_STATEMENT hStmt) const;
+	bool equals(const SoftwarePackage *p) const;
 
 	const TCHAR *getName() const { return m_name; }
 	const TCHAR *getVersion() const { return m_version; }
@@ -639,6 +641,8 @@ class HardwareComponent
 
    void fillMessage(NXCPMessage *msg, UINT32 baseId) const;
    bool saveToDatabase(DB_STATEMENT hStmt) const;
+   bool deleteFromDatabase(DB_STATEMENT hStmt) const;
+   bool equals(const HardwareComponent *c) const;
 
    ChangeCode getChangeCode() const { return m_changeCode; };
    HardwareComponentCategory getCategory() const { return m_category; };
@@ -729,8 +733,17 @@ struct NXCORE_EXPORTABLE NewNodeData
 #define MODIFY_HARDWARE_INVENTORY   0x004000
 #define MODIFY_COMPONENTS           0x008000
 #define MODIFY_ICMP_POLL_SETTINGS   0x010000
+#define MODIFY_ASSOCIATIONS         0x020000
 #define MODIFY_ALL                  0xFFFFFF
 
+/**
+ * Object property groups for client updates
+ */
+#define OBJECT_UPDATE_PROPERTIES    0x0001
+#define OBJECT_UPDATE_ACCESS_LIST   0x0002
+#define OBJECT_UPDATE_RELATIONS     0x0004
+#define OBJECT_UPDATE_ALL           0x0007
+
 /**
  * Column definition for DCI summary table
  */
@@ -760,7 +773,7 @@ class NXCORE_EXPORTABLE SummaryTable
    UINT32 m_flags;
    ObjectArray<SummaryTableColumn> *m_columns;
    TCHAR *m_filterSource;
-   NXSL_VM *m_filter;
+   NXSL_Program *m_filter;
    AggregationFunction m_aggregationFunction;
    time_t m_periodStart;
    time_t m_periodEnd;
@@ -775,7 +788,8 @@ class NXCORE_EXPORTABLE SummaryTable
    SummaryTable(NXCPMessage *msg);
    ~SummaryTable();
 
-   bool filter(DataCollectionTarget *node);
+   NXSL_VM *createFilterVM();
+   bool filter(DataCollectionTarget *node, NXSL_VM *vm);
    Table *createEmptyResultTable();
 
    int getNumColumns() const { return m_columns->size(); }
@@ -834,6 +848,8 @@ class NXCORE_EXPORTABLE NetObj : public NObject
 
 protected:
    time_t m_timestamp;       // Last change time stamp
+   UINT64 m_revision;        // Revision of last change (not persistent)
+   UINT64 m_groupRevision[3]; // Revision of last change for each property group
    VolatileCounter m_refCount;        // Number of references. Object can be destroyed only when this counter is zero
    TCHAR *m_comments;      // User comments
    int m_status;
@@ -894,9 +910,12 @@ class NXCORE_EXPORTABLE NetObj : public NObject
    void unlockResponsibleUsersList() { RWLockUnlock(m_rwlockResponsibleUsers); }
 
    void setModified(UINT32 flags, bool notify = true);                  // Used to mark object as modified
+   void updateRevision(UINT32 flags);
+   virtual void invalidateUserSpecificData() { }
 
    bool loadACLFromDB(DB_HANDLE hdb);
    bool saveACLToDB(DB_HANDLE hdb);
+   bool saveCustomAttributes(DB_HANDLE hdb);
    bool loadCommonProperties(DB_HANDLE hdb);
    bool saveCommonProperties(DB_HANDLE hdb);
    bool saveModuleData(DB_HANDLE hdb);
@@ -941,6 +960,8 @@ class NXCORE_EXPORTABLE NetObj : public NObject
    UINT32 getFlags() const { return m_flags; }
    int getPropagatedStatus();
    time_t getTimeStamp() const { return m_timestamp; }
+   UINT64 getRevision() const { return m_revision; }
+   UINT32 getChangedGroups(UINT64 baseRevision) const;
 	const TCHAR *getComments() const { return CHECK_NULL_EX(m_comments); }
 
 	const GeoLocation& getGeoLocation() const { return m_geoLocation; }
@@ -987,7 +1008,8 @@ class NXCORE_EXPORTABLE NetObj : public NObject
    void hide();
    void unhide();
    void markAsModified(UINT32 flags) { setModified(flags); }  // external API to mark object as modified
-   void markAsSaved() { m_modified = 0; }
+   virtual void markAsSaved(UINT32 flags) { InterlockedAnd(&m_modified, ~flags); }  // clear only flags that were actually saved; called after commit
+   UINT32 getModifiedFlags() const { return m_modified; }
 
    virtual bool saveToDatabase(DB_HANDLE hdb);
    virtual bool saveRuntimeData(DB_HANDLE hdb);
@@ -1008,8 +1030,9 @@ class NXCORE_EXPORTABLE NetObj : public NObject
    virtual void enterMaintenanceMode(const TCHAR *comments);
    virtual void leaveMaintenanceMode();
 
-   void fillMessage(NXCPMessage *msg, UINT32 userId);
+   void fillMessage(NXCPMessage *msg, UINT32 userId, UINT32 groups = OBJECT_UPDATE_ALL);
    UINT32 modifyFromMessage(NXCPMessage *msg);
+   virtual bool hasUserSpecificData();
 
 	virtual void postModify();
 
@@ -1326,6 +1349,7 @@ class NXCORE_EXPORTABLE Template : public DataCollectionOwner, public AutoBindTa
 protected:
    HashMap<uuid, GenericAgentPolicy> *m_policyList;
    ObjectArray<GenericAgentPolicy> *m_deletedPolicyList;
+   int m_savedDeletedPolicyCount;   // Number of deleted policies removed from database by last save
 
    virtual void prepareForDeletion() override;
    virtual void onDataCollectionChange() override;
@@ -1344,6 +1368,7 @@ class NXCORE_EXPORTABLE Template : public DataCollectionOwner, public AutoBindTa
    virtual bool saveToDatabase(DB_HANDLE hdb) override;
    virtual bool deleteFromDatabase(DB_HANDLE hdb) override;
    virtual bool loadFromDatabase(DB_HANDLE hdb, UINT32 id) override;
+   virtual void markAsSaved(UINT32 flags) override;
    virtual void applyDCIChanges() override;
    virtual BOOL applyToTarget(DataCollectionTarget *pNode) override;
 
@@ -1865,6 +1890,9 @@ class NXCORE_EXPORTABLE DataCollectionTarget : public DataCollectionOwner
    PollState m_instancePollState;
    MUTEX m_hPollerMutex;
    double m_proxyLoadFactor;
+   VolatileCounter m_dciConfigGeneration;
+   VolatileCounter m_userSpecificDataGeneration;
+   bool m_hasUserSpecificData;
 
 	virtual void fillMessageInternal(NXCPMessage *pMsg, UINT32 userId) override;
 	virtual void fillMessageInternalStage2(NXCPMessage *pMsg, UINT32 userId) override;
@@ -1873,6 +1901,7 @@ class NXCORE_EXPORTABLE DataCollectionTarget : public DataCollectionOwner
    virtual void onDataCollectionLoad() override;
    virtual void onDataCollectionChange() override;
 	virtual bool isDataCollectionDisabled();
+   virtual void invalidateUserSpecificData() override;
 
    virtual void statusPoll(PollerInfo *poller, ClientSession *session, UINT32 rqId);
    virtual void configurationPoll(PollerInfo *poller, ClientSession *session, UINT32 rqId);
@@ -1914,6 +1943,7 @@ class NXCORE_EXPORTABLE DataCollectionTarget : public DataCollectionOwner
    virtual bool setMgmtStatus(BOOL isManaged) override;
    virtual void calculateCompoundStatus(BOOL bForcedRecalc = FALSE) override;
    virtual bool isDataCollectionTarget() override;
+   virtual bool hasUserSpecificData() override;
 
    virtual void enterMaintenanceMode(const TCHAR *comments) override;
    virtual void leaveMaintenanceMode() override;
@@ -4077,6 +4107,18 @@ void NXCORE_EXPORTABLE NetObjInsert(NetObj *object, bool newObject, bool importe
 void NetObjDeleteFromIndexes(NetObj *object);
 void NetObjDelete(NetObj *object);
 
+void InitObjectSync();
+UINT64 NextObjectRevision();
+UINT64 GetCurrentObjectRevision();
+bool CanResumeObjectSync(UINT64 baseRevision);
+void InvalidateObjectRevisions();
+UINT32 ObjectModificationFlagsToUpdateGroups(UINT32 flags);
+void RegisterDeletedObject(UINT32 id, UINT64 revision);
+void GetDeletedObjects(UINT64 baseRevision, IntegerArray<UINT32> *list);
+
+NXCP_MESSAGE *GetCachedObjectMessage(NetObj *object, UINT16 code, UINT32 groups, UINT32 accessKey, UINT32 flags);
+void PutObjectMessageToCache(NetObj *object, UINT64 revision, UINT16 code, UINT32 groups, UINT32 accessKey, UINT32 flags, const NXCP_MESSAGE *msg);
+
 void UpdateInterfaceIndex(const InetAddress& oldIpAddr, const InetAddress& newIpAddr, Interface *iface);
 void UpdateNodeIndex(const InetAddress& oldIpAddr, const InetAddress& newIpAddr, Node *node);
 
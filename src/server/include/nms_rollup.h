@@ -0,0 +1,192 @@
+/*
+** NetXMS - Network Management System
+** Copyright (C) 2003-2020 Victor Kirhenshtein
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: nms_rollup.h
+**
+**/
+
+#ifndef _nms_rollup_h_
+#define _nms_rollup_h_
+
+#include <math.h>
+
+/**
+ * Rollup tier
+ */
+struct RollupTier
+{
+   INT64 resolution;
+   INT64 coverageStart;   // Start of first period for which rollup data is complete
+};
+
+/**
+ * Aggregated values for rollup period. Minimum and maximum are undefined (minimum is greater
+ * than maximum) when no values were added since last reset.
+ */
+struct RollupAggregate
+{
+   INT32 count;
+   double minValue;
+   double maxValue;
+   double sum;
+
+   void reset()
+   {
+      count = 0;
+      minValue = HUGE_VAL;
+      maxValue = -HUGE_VAL;
+      sum = 0;
+   }
+
+   void resetExtremes()
+   {
+      minValue = HUGE_VAL;
+      maxValue = -HUGE_VAL;
+   }
+
+   bool hasExtremes() const
+   {
+      return minValue <= maxValue;
+   }
+
+   void update(double value)
+   {
+      if (value < minValue)
+         minValue = value;
+      if (value > maxValue)
+         maxValue = value;
+      sum += value;
+      count++;
+   }
+
+   void merge(const RollupAggregate *a)
+   {
+      if (a->minValue < minValue)
+         minValue = a->minValue;
+      if (a->maxValue > maxValue)
+         maxValue = a->maxValue;
+      sum += a->sum;
+      count += a->count;
+   }
+
+   /**
+    * Remove deleted values from totals. Minimum and maximum cannot be adjusted and should be
+    * recalculated by caller.
+    */
+   void subtract(INT32 c, double s)
+   {
+      count -= c;
+      sum -= s;
+   }
+};
+
+/**
+ * Align time to beginning of period
+ */
+inline INT64 RollupAlignDown(INT64 t, INT64 resolution)
+{
+   return t - t % resolution;
+}
+
+/**
+ * Align time to beginning of next period unless already aligned
+ */
+inline INT64 RollupAlignUp(INT64 t, INT64 resolution)
+{
+   return RollupAlignDown(t + resolution - 1, resolution);
+}
+
+/**
+ * Parse tier resolution. Suffixes s, m, h, and d are accepted. Returns 0 on parse error.
+ */
+inline INT64 ParseRollupResolution(const TCHAR *s)
+{
+   TCHAR *eptr;
+   INT64 value = _tcstol(s, &eptr, 10);
+   while(*eptr == _T(' '))
+      eptr++;
+   switch(*eptr)
+   {
+      case _T('d'):
+      case _T('D'):
+         value *= 86400;
+         eptr++;
+         break;
+      case _T('h'):
+      case _T('H'):
+         value *= 3600;
+         eptr++;
+         break;
+      case _T('m'):
+      case _T('M'):
+         value *= 60;
+         eptr++;
+         break;
+      case _T('s'):
+      case _T('S'):
+         eptr++;
+         break;
+   }
+   return (*eptr == 0) ? value : 0;
+}
+
+/**
+ * Handler for rollup range segment (end time is exclusive). Tier index -1 means raw data.
+ */
+typedef bool (*RollupSegmentHandler)(int tier, INT64 from, INT64 to, void *context);
+
+/**
+ * Split time range (end time is exclusive) into segments covered by rollup tiers. Coarsest tier
+ * (starting from given one) which has at least one complete period within range is used for the
+ * middle part, and remaining edges are split recursively using finer tiers and finally raw data.
+ * Segments are passed to handler in ascending time order. Processing stops when handler returns false.
+ */
+inline bool SplitRollupRange(const RollupTier *tiers, int tier, INT64 from, INT64 to, INT64 flushedUntil,
+         RollupSegmentHandler handler, void *context)
+{
+   if (from >= to)
+      return true;
+
+   for(int t = tier; t >= 0; t--)
+   {
+      INT64 start = RollupAlignUp(std::max(from, tiers[t].coverageStart), tiers[t].resolution);
+      INT64 end = RollupAlignDown(std::min(to, flushedUntil), tiers[t].resolution);
+      if (start >= end)
+         continue;
+
+      return SplitRollupRange(tiers, t - 1, from, start, flushedUntil, handler, context) &&
+             handler(t, start, end, context) &&
+             SplitRollupRange(tiers, t - 1, end, to, flushedUntil, handler, context);
+   }
+
+   return handler(-1, from, to, context);
+}
+
+/**
+ * Select finest tier which fits given time range into requested number of rows
+ * (coarsest tier is returned if none fits)
+ */
+inline int SelectRollupTier(const RollupTier *tiers, int count, INT64 range, int maxRows)
+{
+   for(int i = 0; i < count; i++)
+      if (range / tiers[i].resolution <= maxRows)
+         return i;
+   return count - 1;
+}
+
+#endif
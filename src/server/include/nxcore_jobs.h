@@ -258,6 +258,8 @@ class DCIRecalculationJob : public ServerJob
    DCItem *m_dci;
    bool m_cancelled;
 
+   bool recalculate(DB_HANDLE hdb, const TCHAR *selectQuery, const TCHAR *updateQuery, int stage, int stageCount);
+
 protected:
    virtual ServerJobResult run();
    virtual bool onCancel();
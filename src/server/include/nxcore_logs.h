@@ -1,6 +1,6 @@
 /* 
 ** NetXMS - Network Management System
-** Copyright (C) 2003-2013 Victor Kirhenshtein
+** Copyright (C) 2003-2020 Victor Kirhenshtein
 **
 ** This program is free software; you can redistribute it and/or modify
 ** it under the terms of the GNU General Public License as published by
@@ -25,6 +25,8 @@
 
 #define MAX_COLUMN_NAME_LEN    64
 
+class ClientSession;
+
 /**
  * Column types
  */
@@ -116,6 +118,8 @@ class ColumnFilter
 		} set;
 	} m_value;
 
+	bool isEqualsSet();
+
 public:
 	ColumnFilter(NXCPMessage *msg, const TCHAR *column, UINT32 baseId);
 	~ColumnFilter();
@@ -156,6 +160,24 @@ class LogFilter
 	{
 		return m_numOrderingColumns;
 	}
+
+	const OrderingColumn *getOrderingColumn(int index) const
+	{
+		return &m_orderingColumns[index];
+	}
+};
+
+/**
+ * Position in log query result: row number and values of ordering key columns in preceding row
+ */
+struct LogQueryCursor
+{
+   INT64 row;
+   StringList key;   // empty for cursor at the beginning of result set, NULL values are stored as empty strings
+
+   LogQueryCursor(INT64 _row) : key() { row = _row; }
+
+   StringBuffer buildCondition(const StructArray<OrderingColumn> *keyColumns, bool nullsSortedLast) const;
 };
 
 /**
@@ -168,15 +190,26 @@ class LogHandle : public RefCountObject
 	LogFilter *m_filter;
 	MUTEX m_lock;
    StringBuffer m_queryColumns;
-	UINT32 m_rowCountLimit;
+   StringBuffer m_whereClause;
+   StringBuffer m_orderClause;
+   StructArray<OrderingColumn> m_keyColumns;
+   bool m_keysetEnabled;
+	UINT32 m_windowSize;
 	INT64 m_maxRecordId;
-	DB_RESULT m_resultSet;
+	bool m_queryValid;
+	Table *m_window;
+	INT64 m_windowStart;
+	INT64 m_totalRows;
+	ObjectArray<LogQueryCursor> m_checkpoints;
 
+	const LOG_COLUMN *findColumn(const TCHAR *name);
 	void buildQueryColumnList();
 	StringBuffer buildObjectAccessConstraint(const UINT32 userId);
+	void buildWhereClause(const UINT32 userId);
+	StringBuffer buildQuery(const LogQueryCursor *cursor, INT64 limit);
 	void deleteQueryResults();
-	bool queryInternal(INT64 *rowCount, const UINT32 userId);
-	Table *createTable();
+	bool fetch(INT64 startRow, INT64 numRows);
+	Table *createTable(bool withKeyColumns = false);
 
 public:
 	LogHandle(NXCORE_LOG *log);
@@ -0,0 +1,150 @@
+/*
+** NetXMS - Network Management System
+** Copyright (C) 2003-2020 Raden Solutions
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: nxcore_objsync.h
+**
+**/
+
+#ifndef _nxcore_objsync_h_
+#define _nxcore_objsync_h_
+
+#include <nms_util.h>
+#include <nms_threads.h>
+
+/**
+ * Object revision tracker. Issues object revisions and keeps limited history of deleted objects,
+ * so clients synchronized up to known revision can receive only changes made after it.
+ */
+class ObjectRevisionTracker
+{
+private:
+   /**
+    * Deleted object record
+    */
+   struct DeletedObjectRecord
+   {
+      UINT32 id;
+      UINT64 revision;
+   };
+
+   VolatileCounter64 m_revision;
+   VolatileCounter64 m_minResumableRevision;
+   DeletedObjectRecord *m_deletedObjects;   // Ring buffer of recently deleted objects
+   int m_capacity;
+   int m_start;
+   int m_count;
+   Mutex m_lock;
+
+public:
+   ObjectRevisionTracker()
+   {
+      m_revision = 0;
+      m_minResumableRevision = 0;
+      m_deletedObjects = NULL;
+      m_capacity = 0;
+      m_start = 0;
+      m_count = 0;
+   }
+
+   ~ObjectRevisionTracker()
+   {
+      MemFree(m_deletedObjects);
+   }
+
+   /**
+    * Set size of deleted object history. Existing history is discarded, so clients
+    * synchronized before this call will have to do full synchronization.
+    */
+   void setHistorySize(int capacity)
+   {
+      m_lock.lock();
+      MemFree(m_deletedObjects);
+      m_deletedObjects = MemAllocArrayNoInit<DeletedObjectRecord>(capacity);
+      m_capacity = capacity;
+      m_start = 0;
+      m_count = 0;
+      m_minResumableRevision = InterlockedIncrement64(&m_revision);
+      m_lock.unlock();
+   }
+
+   UINT64 next() { return InterlockedIncrement64(&m_revision); }
+   UINT64 current() const { return m_revision; }
+   UINT64 minResumable() const { return m_minResumableRevision; }
+
+   /**
+    * Invalidate all revisions issued so far
+    */
+   void invalidate()
+   {
+      m_minResumableRevision = InterlockedIncrement64(&m_revision);
+   }
+
+   /**
+    * Check if client synchronized up to given revision can receive only changes made after it
+    */
+   bool canResume(UINT64 baseRevision) const
+   {
+      return (baseRevision != 0) && (baseRevision >= m_minResumableRevision) && (baseRevision <= m_revision);
+   }
+
+   /**
+    * Register finally deleted object. If history is full oldest record is dropped
+    * and clients synchronized before it cannot resume anymore.
+    */
+   void registerDeletedObject(UINT32 id, UINT64 revision)
+   {
+      m_lock.lock();
+      if (m_deletedObjects != NULL)
+      {
+         if (m_count == m_capacity)
+         {
+            UINT64 lostRevision = m_deletedObjects[m_start].revision;
+            if (lostRevision >= m_minResumableRevision)
+               m_minResumableRevision = lostRevision + 1;
+            m_start = (m_start + 1) % m_capacity;
+            m_count--;
+         }
+         DeletedObjectRecord *r = &m_deletedObjects[(m_start + m_count) % m_capacity];
+         r->id = id;
+         r->revision = revision;
+         m_count++;
+      }
+      else
+      {
+         invalidate();
+      }
+      m_lock.unlock();
+   }
+
+   /**
+    * Get list of objects deleted after given revision
+    */
+   void getDeletedObjects(UINT64 baseRevision, IntegerArray<UINT32> *list)
+   {
+      m_lock.lock();
+      for(int i = 0; i < m_count; i++)
+      {
+         DeletedObjectRecord *r = &m_deletedObjects[(m_start + i) % m_capacity];
+         if (r->revision > baseRevision)
+            list->add(r->id);
+      }
+      m_lock.unlock();
+   }
+};
+
+#endif
@@ -56,6 +56,7 @@
 #define DDIR_BACKGROUNDS      _T("\\backgrounds")
 #define DFILE_KEYS            _T("\\server_key")
 #define DFILE_COMPILED_MIB    _T("\\netxms.mib")
+#define DFILE_MIB_INDEX       _T("\\netxms.mibx")
 #define DDIR_IMAGES           _T("\\images")
 #define DDIR_FILES            _T("\\files")
 
@@ -92,6 +93,7 @@
 #define DDIR_BACKGROUNDS      _T("/backgrounds")
 #define DFILE_KEYS            _T("/.server_key")
 #define DFILE_COMPILED_MIB    _T("/netxms.mib")
+#define DFILE_MIB_INDEX       _T("/netxms.mibx")
 #define DDIR_IMAGES           _T("/images")
 #define DDIR_FILES            _T("/files")
 
@@ -174,6 +174,16 @@ void AgentConnection::debugPrintf(int level, const TCHAR *format, ...)
    va_end(args);
 }
 
+/**
+ * Pass receive buffer to message view created over it and allocate new receive buffer,
+ * so message can be processed by another thread without copying
+ */
+static inline void HandOverReceiveBuffer(NXCPMessage *msg, NXCP_MESSAGE **rawMsg, UINT32 bufferSize)
+{
+   msg->adoptBuffer(*rawMsg);
+   *rawMsg = static_cast<NXCP_MESSAGE*>(MemAlloc(bufferSize));
+}
+
 /**
  * Receiver thread
  */
@@ -362,8 +372,8 @@ void AgentConnection::receiverThread()
       }
       else
       {
-         // Create message object from raw message
-         NXCPMessage *msg = NXCPMessage::deserialize(rawMsg, m_nProtocolVersion);
+         // Create message view over receive buffer, fields will be decoded on access
+         NXCPMessage *msg = NXCPMessage::createView(rawMsg, m_nProtocolVersion);
          if (msg != NULL)
          {
             if (nxlog_get_debug_level_tag_object(DEBUG_TAG, m_debugId) >= 6)
@@ -372,16 +382,21 @@ void AgentConnection::receiverThread()
                debugPrintf(6, _T("Received message %s (%d) from agent at %s"),
                   NXCPMessageCodeName(msg->getCode(), buffer), msg->getId(), (const TCHAR *)m_addr.toString());
             }
+
+            // Message passed to another thread takes over receive buffer
+            // and new one is allocated for next message
             switch(msg->getCode())
             {
                case CMD_REQUEST_COMPLETED:
                case CMD_SESSION_KEY:
+                  HandOverReceiveBuffer(msg, &rawMsg, msgBufferSize);
                   m_pMsgWaitQueue->put(msg);
                   break;
                case CMD_TRAP:
                   if (g_agentConnectionThreadPool != NULL)
                   {
                      incInternalRefCount();
+                     HandOverReceiveBuffer(msg, &rawMsg, msgBufferSize);
                      ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onTrapCallback, msg);
                   }
                   else
@@ -393,6 +408,7 @@ void AgentConnection::receiverThread()
                   if (g_agentConnectionThreadPool != NULL)
                   {
                      incInternalRefCount();
+                     HandOverReceiveBuffer(msg, &rawMsg, msgBufferSize);
                      ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onSyslogMessageCallback, msg);
                   }
                   else
@@ -404,6 +420,7 @@ void AgentConnection::receiverThread()
                   if (g_agentConnectionThreadPool != NULL)
                   {
                      incInternalRefCount();
+                     HandOverReceiveBuffer(msg, &rawMsg, msgBufferSize);
                      ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onDataPushCallback, msg);
                   }
                   else
@@ -415,6 +432,7 @@ void AgentConnection::receiverThread()
                   if (g_agentConnectionThreadPool != NULL)
                   {
                      incInternalRefCount();
+                     HandOverReceiveBuffer(msg, &rawMsg, msgBufferSize);
                      ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::processCollectedDataCallback, msg);
                   }
                   else
@@ -433,6 +451,7 @@ void AgentConnection::receiverThread()
                   if (g_agentConnectionThreadPool != NULL)
                   {
                      incInternalRefCount();
+                     HandOverReceiveBuffer(msg, &rawMsg, msgBufferSize);
                      ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onSnmpTrapCallback, msg);
                   }
                   else
@@ -446,9 +465,14 @@ void AgentConnection::receiverThread()
                   break;
                default:
                   if (processCustomMessage(msg))
+                  {
                      delete msg;
+                  }
                   else
+                  {
+                     HandOverReceiveBuffer(msg, &rawMsg, msgBufferSize);
                      m_pMsgWaitQueue->put(msg);
+                  }
                   break;
             }
          }
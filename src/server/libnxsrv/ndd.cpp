@@ -377,6 +377,41 @@ static UINT32 HandlerIpAddressPrefixTable(SNMP_Variable *var, SNMP_Transport *sn
    return SNMP_ERR_SUCCESS;
 }
 
+/**
+ * ifTable and ifXTable columns read during interface enumeration
+ */
+static const TCHAR *s_interfaceColumns[] =
+{
+   _T(".1.3.6.1.2.1.2.2.1.2"),      // ifDescr
+   _T(".1.3.6.1.2.1.2.2.1.3"),      // ifType
+   _T(".1.3.6.1.2.1.2.2.1.4"),      // ifMtu
+   _T(".1.3.6.1.2.1.2.2.1.5"),      // ifSpeed
+   _T(".1.3.6.1.2.1.2.2.1.6"),      // ifPhysAddress
+   _T(".1.3.6.1.2.1.31.1.1.1.1"),   // ifName
+   _T(".1.3.6.1.2.1.31.1.1.1.15"),  // ifHighSpeed
+   _T(".1.3.6.1.2.1.31.1.1.1.18"),  // ifAlias
+   NULL
+};
+
+/**
+ * Read interface attribute from ifTable/ifXTable snapshot, or with SNMP GET if snapshot is not available
+ * or does not contain requested object (some agents skip entries during table walk but answer GET requests)
+ */
+static UINT32 ReadInterfaceAttribute(SNMP_Transport *snmp, const SNMP_Snapshot *snapshot, const TCHAR *oid, void *value, size_t size, UINT32 flags)
+{
+   const SNMP_Variable *v = (snapshot != NULL) ? snapshot->get(oid) : NULL;
+   if (v == NULL)
+      return SnmpGet(snmp->getSnmpVersion(), snmp, oid, NULL, 0, value, size, flags);
+
+   if (flags & SG_RAW_RESULT)
+      v->getRawValue(static_cast<BYTE*>(value), size);
+   else if (v->getType() == ASN_OCTET_STRING)
+      v->getValueAsString(static_cast<TCHAR*>(value), size / sizeof(TCHAR));
+   else if (size >= sizeof(UINT32))
+      *static_cast<UINT32*>(value) = v->getValueAsUInt();
+   return SNMP_ERR_SUCCESS;
+}
+
 /**
  * Get list of interfaces for given node
  *
@@ -413,6 +448,18 @@ InterfaceList *NetworkDeviceDriver::getInterfaces(SNMP_Transport *snmp, NObject
       // Gather additional interfaces from ifXTable
       SnmpWalk(snmp, _T(".1.3.6.1.2.1.31.1.1.1.1"), HandlerIndexIfXTable, ifList);
 
+      // Read interface attributes with single parallel walk of ifTable and ifXTable columns
+      ObjectArray<SNMP_ObjectId> columns(16, 16, Ownership::True);
+      for(int i = 0; s_interfaceColumns[i] != NULL; i++)
+      {
+         UINT32 oid[MAX_OID_LEN];
+         size_t oidLen = SNMPParseOID(s_interfaceColumns[i], oid, MAX_OID_LEN);
+         columns.add(new SNMP_ObjectId(oid, oidLen));
+      }
+      SNMP_Snapshot *snapshot = SNMP_Snapshot::create(snmp, &columns);
+      if (snapshot == NULL)
+         nxlog_debug_tag(DEBUG_TAG, 6, _T("NetworkDeviceDriver::getInterfaces(%p): parallel walk of interface tables failed, falling back to individual requests"), snmp);
+
       // Enumerate interfaces
 		for(int i = 0; i < ifList->size(); i++)
       {
@@ -421,11 +468,11 @@ InterfaceList *NetworkDeviceDriver::getInterfaces(SNMP_Transport *snmp, NObject
 			// Get interface description
 		   TCHAR oid[128];
 	      _sntprintf(oid, 128, _T(".1.3.6.1.2.1.2.2.1.2.%d"), iface->index);
-	      if (SnmpGet(snmp->getSnmpVersion(), snmp, oid, NULL, 0, iface->description, MAX_DB_STRING * sizeof(TCHAR), 0) != SNMP_ERR_SUCCESS)
+	      if (ReadInterfaceAttribute(snmp, snapshot, oid, iface->description, MAX_DB_STRING * sizeof(TCHAR), 0) != SNMP_ERR_SUCCESS)
          {
             // Try to get name from ifXTable
 	         _sntprintf(oid, 128, _T(".1.3.6.1.2.1.31.1.1.1.1.%d"), iface->index);
-	         if (SnmpGet(snmp->getSnmpVersion(), snmp, oid, NULL, 0, iface->description, MAX_DB_STRING * sizeof(TCHAR), 0) != SNMP_ERR_SUCCESS)
+	         if (ReadInterfaceAttribute(snmp, snapshot, oid, iface->description, MAX_DB_STRING * sizeof(TCHAR), 0) != SNMP_ERR_SUCCESS)
 	         {
 	            nxlog_debug_tag(DEBUG_TAG, 6, _T("NetworkDeviceDriver::getInterfaces(%p): cannot read interface description for interface %u"), snmp, iface->index);
    	         continue;
@@ -434,7 +481,7 @@ InterfaceList *NetworkDeviceDriver::getInterfaces(SNMP_Transport *snmp, NObject
 
          // Get interface alias
 	      _sntprintf(oid, 128, _T(".1.3.6.1.2.1.31.1.1.1.18.%d"), iface->index);
-			if (SnmpGet(snmp->getSnmpVersion(), snmp, oid, NULL, 0,
+			if (ReadInterfaceAttribute(snmp, snapshot, oid,
 	                  iface->alias, MAX_DB_STRING * sizeof(TCHAR), 0) == SNMP_ERR_SUCCESS)
          {
             StrStrip(iface->alias);
@@ -454,7 +501,7 @@ InterfaceList *NetworkDeviceDriver::getInterfaces(SNMP_Transport *snmp, NObject
          TCHAR buffer[256];
          _sntprintf(oid, 128, _T(".1.3.6.1.2.1.31.1.1.1.1.%d"), iface->index);
          if (!useIfXTable ||
-				 (SnmpGet(snmp->getSnmpVersion(), snmp, oid, NULL, 0, buffer, sizeof(buffer), 0) != SNMP_ERR_SUCCESS))
+				 (ReadInterfaceAttribute(snmp, snapshot, oid, buffer, sizeof(buffer), 0) != SNMP_ERR_SUCCESS))
          {
 		      _tcslcpy(buffer, iface->description, 256);
 		   }
@@ -503,14 +550,14 @@ InterfaceList *NetworkDeviceDriver::getInterfaces(SNMP_Transport *snmp, NObject
 
          // Interface type
          _sntprintf(oid, 128, _T(".1.3.6.1.2.1.2.2.1.3.%d"), iface->index);
-         if (SnmpGet(snmp->getSnmpVersion(), snmp, oid, NULL, 0, &iface->type, sizeof(UINT32), 0) != SNMP_ERR_SUCCESS)
+         if (ReadInterfaceAttribute(snmp, snapshot, oid, &iface->type, sizeof(UINT32), 0) != SNMP_ERR_SUCCESS)
 			{
 				iface->type = IFTYPE_OTHER;
 			}
 
          // Interface MTU
          _sntprintf(oid, 128, _T(".1.3.6.1.2.1.2.2.1.4.%d"), iface->index);
-         if (SnmpGet(snmp->getSnmpVersion(), snmp, oid, NULL, 0, &iface->mtu, sizeof(UINT32), 0) != SNMP_ERR_SUCCESS)
+         if (ReadInterfaceAttribute(snmp, snapshot, oid, &iface->mtu, sizeof(UINT32), 0) != SNMP_ERR_SUCCESS)
 			{
 				iface->mtu = 0;
 			}
@@ -518,14 +565,14 @@ InterfaceList *NetworkDeviceDriver::getInterfaces(SNMP_Transport *snmp, NObject
          // Interface speed
          _sntprintf(oid, 128, _T(".1.3.6.1.2.1.31.1.1.1.15.%d"), iface->index);  // try ifHighSpeed first
          UINT32 speed;
-         if (SnmpGet(snmp->getSnmpVersion(), snmp, oid, NULL, 0, &speed, sizeof(UINT32), 0) != SNMP_ERR_SUCCESS)
+         if (ReadInterfaceAttribute(snmp, snapshot, oid, &speed, sizeof(UINT32), 0) != SNMP_ERR_SUCCESS)
 			{
 				speed = 0;
 			}
          if (speed < 2000)  // ifHighSpeed not supported or slow interface
          {
             _sntprintf(oid, 128, _T(".1.3.6.1.2.1.2.2.1.5.%d"), iface->index);  // ifSpeed
-            if (SnmpGet(snmp->getSnmpVersion(), snmp, oid, NULL, 0, &speed, sizeof(UINT32), 0) == SNMP_ERR_SUCCESS)
+            if (ReadInterfaceAttribute(snmp, snapshot, oid, &speed, sizeof(UINT32), 0) == SNMP_ERR_SUCCESS)
             {
                iface->speed = (UINT64)speed;
             }
@@ -542,7 +589,7 @@ InterfaceList *NetworkDeviceDriver::getInterfaces(SNMP_Transport *snmp, NObject
          // MAC address
          _sntprintf(oid, 128, _T(".1.3.6.1.2.1.2.2.1.6.%d"), iface->index);
          memset(buffer, 0, MAC_ADDR_LENGTH);
-         if (SnmpGet(snmp->getSnmpVersion(), snmp, oid, NULL, 0, buffer, 256, SG_RAW_RESULT) == SNMP_ERR_SUCCESS)
+         if (ReadInterfaceAttribute(snmp, snapshot, oid, buffer, 256, SG_RAW_RESULT) == SNMP_ERR_SUCCESS)
 			{
 	         memcpy(iface->macAddr, buffer, MAC_ADDR_LENGTH);
 			}
@@ -552,6 +599,7 @@ InterfaceList *NetworkDeviceDriver::getInterfaces(SNMP_Transport *snmp, NObject
 	         memset(iface->macAddr, 0, MAC_ADDR_LENGTH);
 			}
       }
+      delete snapshot;
 
       // Interface IP address'es and netmasks
 		UINT32 error = SnmpWalk(snmp, _T(".1.3.6.1.2.1.4.20.1.1"), HandlerIpAddr, ifList);
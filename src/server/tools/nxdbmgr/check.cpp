@@ -985,6 +985,51 @@ bool IsDataTableExist(const TCHAR *format, UINT32 id)
    return rc != DBIsTableExist_NotFound;
 }
 
+/**
+ * Get list of physical tables holding data of given data table. With data partitioning enabled
+ * data table is a view over time partitions, and partitions are returned instead of the view.
+ */
+StringList *GetDataTableStorage(DB_HANDLE hdb, const TCHAR *table, bool *partitioned)
+{
+   StringList *storage = new StringList();
+   IntegerArray<INT64> *partitions = DBGetTimePartitions(hdb, table);
+   if ((partitions != NULL) && !partitions->isEmpty())
+   {
+      TCHAR name[256];
+      for(int i = 0; i < partitions->size(); i++)
+         storage->add(DBGetTimePartitionName(table, partitions->get(i), name, 256));
+      *partitioned = true;
+   }
+   else
+   {
+      if (DBIsTableExist(hdb, table) != DBIsTableExist_NotFound)
+         storage->add(table);
+      *partitioned = false;
+   }
+   delete partitions;
+   return storage;
+}
+
+/**
+ * Convert newly created data table into time partition with start time 0 if data partitioning
+ * is enabled, so database is consistent without waiting for server to do the same on first access.
+ */
+bool ConvertDataTableToPartition(const TCHAR *table)
+{
+   if ((DBMgrMetaDataReadInt32(_T("DataPartitionInterval"), 0) == 0) ||
+       ((g_dbSyntax != DB_SYNTAX_PGSQL) && (g_dbSyntax != DB_SYNTAX_SQLITE)))
+      return true;
+
+   TCHAR name[256];
+   DBGetTimePartitionName(table, 0, name, 256);
+   if (!DBRenameTable(g_dbHandle, table, name))
+      return false;
+
+   IntegerArray<INT64> partitions(1, 1);
+   partitions.add(0);
+   return DBRebuildTimePartitionView(g_dbHandle, table, &partitions);
+}
+
 /**
  * Check data tables
  */
@@ -993,6 +1038,9 @@ static void CheckDataTables()
    if (DBMgrMetaDataReadInt32(_T("SingeTablePerfData"), 0))
       return;  // Single table mode
 
+   if (DBMgrMetaDataReadInt32(_T("DataPartitionInterval"), 0))
+      return;  // Time partitioned tables are created by server on demand
+
    StartStage(_T("Data tables"));
 
 	IntegerArray<UINT32> *targets = GetDataCollectionTargets();
@@ -27,13 +27,36 @@
  */
 extern const TCHAR *g_tables[];
 
+/**
+ * Drop data table. Time partitioned data table is dropped together with all partitions.
+ */
+static bool DropDataTable(const TCHAR *format, UINT32 id)
+{
+   TCHAR table[64], query[256];
+   _sntprintf(table, 64, format, id);
+
+   bool partitioned;
+   StringList *storage = GetDataTableStorage(g_dbHandle, table, &partitioned);
+   if (partitioned)
+   {
+      _sntprintf(query, 256, _T("DROP VIEW IF EXISTS %s"), table);
+      CHK_EXEC_NO_SP_WITH_HOOK(SQLQuery(query), delete storage);
+   }
+   for(int i = 0; i < storage->size(); i++)
+   {
+      _sntprintf(query, 256, _T("DROP TABLE %s"), storage->get(i));
+      CHK_EXEC_NO_SP_WITH_HOOK(SQLQuery(query), delete storage);
+   }
+   delete storage;
+   return true;
+}
+
 /**
  * Delete idata_xx tables
  */
 static bool DeleteDataTables()
 {
 	DB_RESULT hResult;
-	TCHAR query[256];
 	int i, count;
 
 	hResult = SQLSelect(_T("SELECT id FROM nodes"));
@@ -43,15 +66,10 @@ static bool DeleteDataTables()
 		for(i = 0; i < count; i++)
 		{
          UINT32 id = DBGetFieldULong(hResult, i, 0);
-         if (IsDataTableExist(_T("idata_%d"), id))
-         {
-            _sntprintf(query, 256, _T("DROP TABLE idata_%d"), id);
-            CHK_EXEC(SQLQuery(query));
-         }
-         if (IsDataTableExist(_T("tdata_%d"), id))
+         if (!DropDataTable(_T("idata_%u"), id) || !DropDataTable(_T("tdata_%u"), id))
          {
-            _sntprintf(query, 256, _T("DROP TABLE tdata_%d"), id);
-            CHK_EXEC(SQLQuery(query));
+            DBFreeResult(hResult);
+            return false;
          }
 		}
 		DBFreeResult(hResult);
@@ -65,9 +65,10 @@ static TCHAR *EscapeString(const TCHAR *str)
 }
 
 /**
- * Export single database table
+ * Export single database table. Records are written into table with given target name
+ * (same as source table if target name is NULL).
  */
-static BOOL ExportTable(sqlite3 *db, const TCHAR *name)
+static BOOL ExportTable(sqlite3 *db, const TCHAR *name, const TCHAR *target = NULL)
 {
 	StringBuffer query;
 	TCHAR buffer[256];
@@ -90,7 +91,7 @@ static BOOL ExportTable(sqlite3 *db, const TCHAR *name)
 
 				// Column names
 				columnCount = DBGetColumnCount(hResult);
-				query.appendFormattedString(_T("INSERT INTO %s ("), name);
+				query.appendFormattedString(_T("INSERT INTO %s ("), (target != NULL) ? target : name);
 				for(i = 0; i < columnCount; i++)
 				{
 					DBGetColumnName(hResult, i, buffer, 256);
@@ -162,6 +163,20 @@ static BOOL ExportTable(sqlite3 *db, const TCHAR *name)
 	return success;
 }
 
+/**
+ * Export data table. Time partitioned data table is exported as single table.
+ */
+static bool ExportDataTable(sqlite3 *db, const TCHAR *table)
+{
+   bool partitioned;
+   StringList *storage = GetDataTableStorage(g_dbHandle, table, &partitioned);
+   bool success = true;
+   for(int i = 0; (i < storage->size()) && success; i++)
+      success = ExportTable(db, storage->get(i), table) ? true : false;
+   delete storage;
+   return success;
+}
+
 /**
  * Callback for getting schema version
  */
@@ -384,7 +399,7 @@ void ExportDatabase(char *file, bool skipAudit, bool skipAlarms, bool skipEvent,
             _sntprintf(idataTable, 128, _T("idata_%d"), id);
             if (!excludedTables.contains(idataTable))
             {
-               if (!ExportTable(db, idataTable))
+               if (!ExportDataTable(db, idataTable))
                {
                   goto cleanup;
                }
@@ -397,7 +412,7 @@ void ExportDatabase(char *file, bool skipAudit, bool skipAlarms, bool skipEvent,
             _sntprintf(idataTable, 128, _T("tdata_%d"), id);
             if (!excludedTables.contains(idataTable))
             {
-               if (!ExportTable(db, idataTable))
+               if (!ExportDataTable(db, idataTable))
                {
                   goto cleanup;
                }
@@ -212,6 +212,11 @@ static bool ImportDataTables(sqlite3 *db, const StringList& excludedTables)
 		{
          _tprintf(_T("Skipping table %s\n"), table);
 		}
+      if (!ConvertDataTableToPartition(table))
+      {
+         success = false;
+         break;
+      }
 
       if (!CreateTDataTable(id))
       {
@@ -231,6 +236,11 @@ static bool ImportDataTables(sqlite3 *db, const StringList& excludedTables)
       else
       {
          _tprintf(_T("Skipping table %s\n"), table);
+      }
+      if (!ConvertDataTableToPartition(table))
+      {
+         success = false;
+         break;
       }
 	}
 
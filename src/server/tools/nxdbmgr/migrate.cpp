@@ -112,9 +112,10 @@ static bool ConnectToSource()
 }
 
 /**
- * Migrate single database table
+ * Migrate single database table. Records are written into table with given target name
+ * (same as source table if target name is NULL).
  */
-static bool MigrateTable(const TCHAR *table)
+static bool MigrateTable(const TCHAR *table, const TCHAR *target = NULL)
 {
 	WriteToTerminalEx(_T("Migrating table \x1b[1m%s\x1b[0m\n"), table);
 
@@ -137,7 +138,7 @@ static bool MigrateTable(const TCHAR *table)
 
    // build INSERT query
    StringBuffer query = _T("INSERT INTO ");
-   query += table;
+   query += (target != NULL) ? target : table;
    query += _T(" (");
 	int columnCount = DBGetColumnCount(hResult);
 	for(int i = 0; i < columnCount; i++)
@@ -219,6 +220,37 @@ static bool MigrateTable(const TCHAR *table)
 	return success;
 }
 
+/**
+ * Get name of table in target database where records for given data table should be inserted.
+ * If data table in target database is a view over time partitions (possible only when migrating
+ * data into existing database), records are inserted into oldest partition.
+ */
+static TCHAR *GetDataMigrationTarget(const TCHAR *table, TCHAR *buffer, size_t size)
+{
+   bool partitioned;
+   StringList *storage = GetDataTableStorage(g_dbHandle, table, &partitioned);
+   _tcslcpy(buffer, partitioned ? storage->get(0) : table, size);
+   delete storage;
+   return buffer;
+}
+
+/**
+ * Migrate data table. Time partitioned data table in source database is migrated partition by partition.
+ */
+static bool MigrateDataTable(const TCHAR *table)
+{
+   TCHAR target[256];
+   GetDataMigrationTarget(table, target, 256);
+
+   bool partitioned;
+   StringList *storage = GetDataTableStorage(s_hdbSource, table, &partitioned);
+   bool success = true;
+   for(int i = 0; (i < storage->size()) && success; i++)
+      success = MigrateTable(storage->get(i), target);
+   delete storage;
+   return success;
+}
+
 /**
  * Migrate data tables
  */
@@ -240,13 +272,15 @@ static bool MigrateDataTables()
 			   break;	// Failed to create idata_xx table
       }
 
+      TCHAR table[32];
+      _sntprintf(table, 32, _T("idata_%u"), id);
       if (!g_skipDataMigration)
       {
-         TCHAR table[32];
-		   _sntprintf(table, 32, _T("idata_%u"), id);
-		   if (!MigrateTable(table))
+		   if (!MigrateDataTable(table))
 			   break;
       }
+      if (!g_dataOnlyMigration && !ConvertDataTableToPartition(table))
+         break;
 
       if (!g_dataOnlyMigration)
       {
@@ -254,13 +288,14 @@ static bool MigrateDataTables()
 			   break;	// Failed to create tdata tables
       }
 
+      _sntprintf(table, 32, _T("tdata_%u"), id);
       if (!g_skipDataMigration)
       {
-         TCHAR table[32];
-		   _sntprintf(table, 32, _T("tdata_%u"), id);
-		   if (!MigrateTable(table))
+		   if (!MigrateDataTable(table))
 			   break;
       }
+      if (!g_dataOnlyMigration && !ConvertDataTableToPartition(table))
+         break;
 	}
 
 	delete targets;
@@ -718,10 +753,13 @@ static bool MigrateDataFromSingleTable(UINT32 nodeId, bool tdata)
       return false;
    }
 
+   TCHAR table[32], target[256];
+   _sntprintf(table, 32, _T("%s_%u"), prefix, nodeId);
+   GetDataMigrationTarget(table, target, 256);
    if (tdata)
-      _sntprintf(buffer, 256, _T("INSERT INTO tdata_%u (item_id,tdata_timestamp,tdata_value) VALUES (?,?,?)"), nodeId);
+      _sntprintf(buffer, 256, _T("INSERT INTO %s (item_id,tdata_timestamp,tdata_value) VALUES (?,?,?)"), target);
    else
-      _sntprintf(buffer, 256, _T("INSERT INTO idata_%u (item_id,idata_timestamp,idata_value,raw_value) VALUES (?,?,?,?)"), nodeId);
+      _sntprintf(buffer, 256, _T("INSERT INTO %s (item_id,idata_timestamp,idata_value,raw_value) VALUES (?,?,?,?)"), target);
    DB_STATEMENT hStmt = DBPrepareEx(g_dbHandle, buffer, true, errorText);
    if (hStmt != NULL)
    {
@@ -808,11 +846,15 @@ static bool MigrateDataTablesFromSingleTable()
             break;   // Failed to create idata_xx table
       }
 
+      TCHAR table[32];
+      _sntprintf(table, 32, _T("idata_%u"), id);
       if (!g_skipDataMigration)
       {
          if (!MigrateDataFromSingleTable(id, false))
             break;
       }
+      if (!g_dataOnlyMigration && !ConvertDataTableToPartition(table))
+         break;
 
       if (!g_dataOnlyMigration)
       {
@@ -820,11 +862,14 @@ static bool MigrateDataTablesFromSingleTable()
             break;   // Failed to create tdata tables
       }
 
+      _sntprintf(table, 32, _T("tdata_%u"), id);
       if (!g_skipDataMigration)
       {
          if (!MigrateDataFromSingleTable(id, true))
             break;
       }
+      if (!g_dataOnlyMigration && !ConvertDataTableToPartition(table))
+         break;
    }
 
    delete targets;
@@ -905,7 +950,7 @@ void MigrateDatabase(const TCHAR *sourceConfig, TCHAR *destConfFields, bool skip
 	   // Migrate tables
 	   for(int i = 0; g_tables[i] != NULL; i++)
 	   {
-	      if (!_tcsncmp(g_tables[i], _T("idata"), 5) ||
+	      if ((!_tcsncmp(g_tables[i], _T("idata"), 5) && _tcscmp(g_tables[i], _T("idata_rollup"))) ||
              !_tcsncmp(g_tables[i], _T("tdata"), 5))
 	         continue;  // idata and tdata migrated separately
 
@@ -917,7 +962,7 @@ void MigrateDatabase(const TCHAR *sourceConfig, TCHAR *destConfFields, bool skip
 	          (skipTrapLog && !_tcscmp(g_tables[i], _T("snmp_trap_log"))) ||
 	          (skipSysLog && !_tcscmp(g_tables[i], _T("syslog"))) ||
 	          ((g_skipDataMigration || g_skipDataSchemaMigration) &&
-	                   !_tcscmp(g_tables[i], _T("raw_dci_values"))) ||
+	                   (!_tcscmp(g_tables[i], _T("raw_dci_values")) || !_tcscmp(g_tables[i], _T("idata_rollup")))) ||
 	          excludedTables.contains(g_tables[i]))
 	      {
 	         WriteToTerminalEx(_T("Skipping table \x1b[1m%s\x1b[0m\n"), g_tables[i]);
@@ -72,6 +72,8 @@ void RunPendingOnlineUpgrades();
 
 IntegerArray<UINT32> *GetDataCollectionTargets();
 bool IsDataTableExist(const TCHAR *format, UINT32 id);
+StringList *GetDataTableStorage(DB_HANDLE hdb, const TCHAR *table, bool *partitioned);
+bool ConvertDataTableToPartition(const TCHAR *table);
 
 BOOL CreateIDataTable(DWORD nodeId);
 BOOL CreateTDataTable(DWORD nodeId);
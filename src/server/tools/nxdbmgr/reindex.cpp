@@ -202,20 +202,31 @@ static void ReindexIDataForClass(const TCHAR *objectTable)
 	{
 		DWORD id = DBGetFieldULong(hResult, i, 0);
 		_sntprintf(table, 32, _T("idata_%d"), id);
-		_tprintf(_T("Reindexing table %s\n"), table);
 
-		DropAllIndexesFromTable(table);
-
-      for(int j = 0; j < 10; j++)
+      // Time partitioned data table is a view, indexes are created on each partition
+      bool partitioned;
+      StringList *storage = GetDataTableStorage(g_dbHandle, table, &partitioned);
+      for(int k = 0; k < storage->size(); k++)
       {
-         _sntprintf(query, 256, _T("IDataIndexCreationCommand_%d"), j);
-         DBMgrMetaDataReadStr(query, queryTemplate, 256, _T(""));
-         if (queryTemplate[0] != 0)
+         const TCHAR *name = storage->get(k);
+         _tprintf(_T("Reindexing table %s\n"), name);
+
+         DropAllIndexesFromTable(name);
+
+         for(int j = 0; j < 10; j++)
          {
-            _sntprintf(query, 256, queryTemplate, id, id);
-            SQLQuery(query);
+            _sntprintf(query, 256, _T("IDataIndexCreationCommand_%d"), j);
+            DBMgrMetaDataReadStr(query, queryTemplate, 256, _T(""));
+            if (queryTemplate[0] != 0)
+            {
+               // Index creation command uses table suffix (object ID) as placeholder
+               StringBuffer command(queryTemplate);
+               command.replace(_T("%d"), &name[6]);
+               SQLQuery(command);
+            }
          }
       }
+      delete storage;
 	}
 
 	DBFreeResult(hResult);
@@ -23,6 +23,131 @@
 #include "nxdbmgr.h"
 #include <nxevent.h>
 
+/**
+ * Upgrade from 32.16 to 32.17
+ */
+static bool H_UpgradeFromV16()
+{
+   CHK_EXEC(CreateConfigParam(_T("SNMP.Engine.SharedSockets"), _T("4"),
+            _T("Number of shared UDP sockets used by asynchronous SNMP engine to multiplex requests to SNMP agents (0 to disable asynchronous engine)."),
+            NULL, 'I', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(17));
+   return true;
+}
+
+/**
+ * Upgrade from 32.15 to 32.16
+ */
+static bool H_UpgradeFromV15()
+{
+   CHK_EXEC(CreateConfigParam(_T("SNMP.Walk.MaxRepetitions"), _T("64"),
+            _T("Maximum number of repetitions in GETBULK requests used for walking SNMP agents."),
+            NULL, 'I', true, true, false, false));
+   CHK_EXEC(CreateConfigParam(_T("SNMP.Walk.UseBulkRequests"), _T("1"),
+            _T("Use GETBULK requests for walking SNMPv2c and SNMPv3 agents."),
+            NULL, 'B', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(16));
+   return true;
+}
+
+/**
+ * Upgrade from 32.14 to 32.15
+ */
+static bool H_UpgradeFromV14()
+{
+   CHK_EXEC(CreateConfigParam(_T("Client.OutboundQueue.MaxLag"), _T("60"),
+            _T("Maximum time oldest message can stay in client session outbound queue before pending object updates are dropped and client is asked to re-synchronize objects."),
+            _T("seconds"), 'I', true, true, false, false));
+   CHK_EXEC(CreateConfigParam(_T("Client.OutboundQueue.MaxSize"), _T("4096"),
+            _T("Maximum size of client session outbound queue. Log records are dropped and object re-synchronization is requested when queue grows over this limit."),
+            _T("kilobytes"), 'I', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(15));
+   return true;
+}
+
+/**
+ * Upgrade from 32.13 to 32.14
+ */
+static bool H_UpgradeFromV13()
+{
+   CHK_EXEC(CreateConfigParam(_T("Objects.Sync.DeletedObjectHistorySize"), _T("65536"),
+            _T("Number of deleted objects remembered for clients resuming object synchronization. Clients synchronized before oldest remembered deletion have to do full synchronization."),
+            _T("objects"), 'I', true, true, false, false));
+   CHK_EXEC(CreateConfigParam(_T("Objects.Sync.MessageCacheSize"), _T("64"),
+            _T("Size of cache for serialized object messages shared between client sessions (0 to disable caching)."),
+            _T("megabytes"), 'I', true, true, false, false));
+   CHK_EXEC(CreateConfigParam(_T("Objects.Sync.MessageCacheTTL"), _T("60"),
+            _T("Time to live for entries in serialized object message cache."),
+            _T("seconds"), 'I', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(14));
+   return true;
+}
+
+/**
+ * Upgrade from 32.12 to 32.13
+ */
+static bool H_UpgradeFromV12()
+{
+   CHK_EXEC(CreateConfigParam(_T("SNMP.Traps.ResolveVarbindNames"), _T("0"),
+            _T("Enable/disable resolving of trap varbind OIDs to symbolic names using compiled MIB index file."),
+            _T(""), 'B', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(13));
+   return true;
+}
+
+/**
+ * Upgrade from 32.11 to 32.12
+ */
+static bool H_UpgradeFromV11()
+{
+   CHK_EXEC(CreateConfigParam(_T("DataCollection.SummaryTableCacheTime"), _T("0"),
+            _T("Time for which results of DCI summary table queries are cached and shared between identical requests (0 to disable caching)."),
+            _T("seconds"), 'I', true, false, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(12));
+   return true;
+}
+
+/**
+ * Upgrade from 32.10 to 32.11
+ */
+static bool H_UpgradeFromV10()
+{
+   CHK_EXEC(CreateTable(
+         _T("CREATE TABLE idata_rollup (")
+         _T("item_id integer not null,")
+         _T("resolution integer not null,")
+         _T("period_start integer not null,")
+         _T("node_id integer not null,")
+         _T("min_value varchar(64) null,")
+         _T("max_value varchar(64) null,")
+         _T("sum_value varchar(64) null,")
+         _T("value_count integer not null,")
+         _T("PRIMARY KEY(item_id,resolution,period_start))")));
+   CHK_EXEC(SQLQuery(_T("CREATE INDEX idx_idata_rollup_node_id ON idata_rollup(node_id)")));
+   CHK_EXEC(SQLQuery(_T("CREATE INDEX idx_idata_rollup_period_start ON idata_rollup(period_start)")));
+
+   CHK_EXEC(CreateConfigParam(_T("DataCollection.RollupRetentionTime"), _T("365"),
+            _T("Retention time for pre-aggregated collected data (rollups)."),
+            _T("days"), 'I', true, false, false, false));
+   CHK_EXEC(CreateConfigParam(_T("DataCollection.RollupTiers"), _T("300,3600,86400"),
+            _T("Comma separated list of resolutions for pre-aggregated collected data (rollups), like 300,1h,1d. Empty list disables rollups."),
+            _T(""), 'S', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(11));
+   return true;
+}
+
+/**
+ * Upgrade from 32.9 to 32.10
+ */
+static bool H_UpgradeFromV9()
+{
+   CHK_EXEC(CreateConfigParam(_T("DataCollection.PartitionInterval"), _T("0"),
+            _T("Time interval covered by single partition of collected data tables (0 to disable partitioning). Supported only for PostgreSQL and SQLite. Cannot be changed after partitioning is enabled."),
+            _T("seconds"), 'I', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(10));
+   return true;
+}
+
 /**
  * Upgrade from 32.8 to 32.9
  */
@@ -218,6 +343,14 @@ static struct
    bool (* upgradeProc)();
 } s_dbUpgradeMap[] =
 {
+   { 16, 32, 17, H_UpgradeFromV16 },
+   { 15, 32, 16, H_UpgradeFromV15 },
+   { 14, 32, 15, H_UpgradeFromV14 },
+   { 13, 32, 14, H_UpgradeFromV13 },
+   { 12, 32, 13, H_UpgradeFromV12 },
+   { 11, 32, 12, H_UpgradeFromV11 },
+   { 10, 32, 11, H_UpgradeFromV10 },
+   { 9,  32, 10, H_UpgradeFromV9 },
    { 8,  32, 9, H_UpgradeFromV8 },
    { 7,  32, 8, H_UpgradeFromV7 },
    { 6,  32, 7, H_UpgradeFromV6 },
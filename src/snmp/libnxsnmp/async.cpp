@@ -0,0 +1,655 @@
+/*
+** NetXMS - Network Management System
+** SNMP support library
+** Copyright (C) 2003-2020 Raden Solutions
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: async.cpp
+**
+**/
+
+#include "libnxsnmp.h"
+
+/**
+ * Timer wheel tick (milliseconds)
+ */
+#define TIMER_TICK   10
+
+/**
+ * Maximum number of shared sockets per address family
+ */
+#define MAX_SHARED_SOCKETS   (SOCKET_POLLER_MAX_SOCKETS / 2)
+
+/**
+ * Pending asynchronous request
+ */
+struct SNMP_AsyncRequest
+{
+   SNMP_AsyncRequest *prev;   // Timer wheel slot list
+   SNMP_AsyncRequest *next;
+   UINT32 id;
+   SNMP_Transport *transport;
+   SNMP_PDU *pdu;
+   bool ownsPdu;
+   SOCKET socket;
+   SockAddrBuffer peer;
+   SNMP_AsyncCallback callback;
+   void *context;
+   UINT32 timeout;
+   int retries;
+   int timeSyncRetries;
+   int slot;
+   UINT32 rounds;
+};
+
+/**
+ * Default engine
+ */
+static SNMP_AsyncEngine *s_defaultEngine = NULL;
+
+/**
+ * Set default asynchronous engine. If set, SNMP_Transport::doRequest will send
+ * requests through this engine when possible, and new UDP transports will not
+ * create own sockets.
+ */
+void LIBNXSNMP_EXPORTABLE SnmpSetDefaultAsyncEngine(SNMP_AsyncEngine *engine)
+{
+   s_defaultEngine = engine;
+}
+
+/**
+ * Get default asynchronous engine (NULL if not set or not running)
+ */
+SNMP_AsyncEngine LIBNXSNMP_EXPORTABLE *SnmpGetDefaultAsyncEngine()
+{
+   SNMP_AsyncEngine *engine = s_defaultEngine;
+   return ((engine != NULL) && engine->isRunning()) ? engine : NULL;
+}
+
+/**
+ * Decode BER element header with bounds checking and advance current position past element
+ */
+static bool DecodeElement(const BYTE **curr, size_t *remaining, UINT32 *type, const BYTE **content, size_t *length)
+{
+   size_t idLength;
+   if ((*remaining < 2) || !BER_DecodeIdentifier(*curr, *remaining, type, length, content, &idLength))
+      return false;
+   if ((idLength > *remaining) || (*length > *remaining - idLength))
+      return false;
+   *curr += idLength + *length;
+   *remaining -= idLength + *length;
+   return true;
+}
+
+/**
+ * Extract ID used for matching response to request without full parsing of message -
+ * message ID from header for SNMPv3 or request ID from PDU for SNMPv1 and SNMPv2c.
+ */
+static bool ExtractMessageId(const BYTE *data, size_t size, UINT32 *id)
+{
+   UINT32 type, version;
+   const BYTE *content;
+   size_t length;
+
+   // Message: SEQUENCE { version, ... }
+   if (!DecodeElement(&data, &size, &type, &content, &length) || (type != ASN_SEQUENCE))
+      return false;
+
+   const BYTE *curr = content;
+   size_t remaining = length;
+   if (!DecodeElement(&curr, &remaining, &type, &content, &length) || (type != ASN_INTEGER) ||
+       !BER_DecodeContent(type, content, length, (BYTE *)&version))
+      return false;
+
+   if (version == SNMP_VERSION_3)
+   {
+      // msgGlobalData: SEQUENCE { msgID, ... }
+      if (!DecodeElement(&curr, &remaining, &type, &content, &length) || (type != ASN_SEQUENCE))
+         return false;
+      curr = content;
+      remaining = length;
+   }
+   else
+   {
+      // Skip community string and enter PDU
+      if (!DecodeElement(&curr, &remaining, &type, &content, &length) || (type != ASN_OCTET_STRING))
+         return false;
+      if (!DecodeElement(&curr, &remaining, &type, &content, &length))
+         return false;
+      curr = content;
+      remaining = length;
+   }
+
+   return DecodeElement(&curr, &remaining, &type, &content, &length) && (type == ASN_INTEGER) &&
+          BER_DecodeContent(type, content, length, (BYTE *)id);
+}
+
+/**
+ * Create shared socket for given address family
+ */
+static SOCKET CreateSharedSocket(int family)
+{
+   SOCKET s = CreateSocket(family, SOCK_DGRAM, 0);
+   if (s == INVALID_SOCKET)
+      return INVALID_SOCKET;
+
+   SockAddrBuffer localAddr;
+   memset(&localAddr, 0, sizeof(SockAddrBuffer));
+   if (family == AF_INET)
+   {
+      localAddr.sa4.sin_family = AF_INET;
+      localAddr.sa4.sin_addr.s_addr = htonl(INADDR_ANY);
+   }
+#ifdef WITH_IPV6
+   else
+   {
+      localAddr.sa6.sin6_family = AF_INET6;
+   }
+#endif
+   if (bind(s, (struct sockaddr *)&localAddr, SA_LEN((struct sockaddr *)&localAddr)) != 0)
+   {
+      closesocket(s);
+      return INVALID_SOCKET;
+   }
+   SetSocketNonBlocking(s);
+   return s;
+}
+
+/**
+ * Create engine. Sockets are not created until engine is started.
+ *
+ * @param numSockets number of shared sockets per address family
+ */
+SNMP_AsyncEngine::SNMP_AsyncEngine(int numSockets)
+{
+   m_numSockets = std::max(1, std::min(numSockets, MAX_SHARED_SOCKETS));
+   m_sockets = MemAllocArrayNoInit<SOCKET>(m_numSockets);
+   m_sockets6 = MemAllocArrayNoInit<SOCKET>(m_numSockets);
+   for(int i = 0; i < m_numSockets; i++)
+   {
+      m_sockets[i] = INVALID_SOCKET;
+      m_sockets6[i] = INVALID_SOCKET;
+   }
+   m_nextSocket = 0;
+   m_requests = new HashMap<UINT32, SNMP_AsyncRequest>(Ownership::False);
+   memset(m_timerWheel, 0, sizeof(m_timerWheel));
+   m_timerPosition = 0;
+   m_timerTime = 0;
+   m_mutex = MutexCreate();
+   m_thread = INVALID_THREAD_HANDLE;
+   m_buffer = MemAllocArrayNoInit<BYTE>(SNMP_DEFAULT_MSG_MAX_SIZE);
+   m_running = false;
+   m_shutdown = false;
+}
+
+/**
+ * Destructor
+ */
+SNMP_AsyncEngine::~SNMP_AsyncEngine()
+{
+   stop();
+   MemFree(m_sockets);
+   MemFree(m_sockets6);
+   delete m_requests;
+   MutexDestroy(m_mutex);
+   MemFree(m_buffer);
+}
+
+/**
+ * Start engine
+ */
+bool SNMP_AsyncEngine::start()
+{
+   if (m_running)
+      return true;
+
+   for(int i = 0; i < m_numSockets; i++)
+   {
+      m_sockets[i] = CreateSharedSocket(AF_INET);
+      if (m_sockets[i] == INVALID_SOCKET)
+      {
+         nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 1, _T("SNMP_AsyncEngine: cannot create shared socket (%s)"), _tcserror(errno));
+         for(int j = 0; j < i; j++)
+         {
+            closesocket(m_sockets[j]);
+            m_sockets[j] = INVALID_SOCKET;
+            if (m_sockets6[j] != INVALID_SOCKET)
+            {
+               closesocket(m_sockets6[j]);
+               m_sockets6[j] = INVALID_SOCKET;
+            }
+         }
+         return false;
+      }
+#ifdef WITH_IPV6
+      m_sockets6[i] = CreateSharedSocket(AF_INET6);  // IPv6 may be unavailable, will fall back to own sockets
+#endif
+   }
+
+   m_shutdown = false;
+   m_timerTime = GetCurrentTimeMs();
+   m_running = true;
+   m_thread = ThreadCreateEx(workerThreadStarter, 0, this);
+   nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 2, _T("SNMP_AsyncEngine: started with %d shared socket(s) per address family"), m_numSockets);
+   return true;
+}
+
+/**
+ * Stop engine. All pending requests will be completed with SNMP_ERR_ABORTED.
+ */
+void SNMP_AsyncEngine::stop()
+{
+   if (!m_running)
+      return;
+
+   MutexLock(m_mutex);
+   m_running = false;
+   m_shutdown = true;
+   MutexUnlock(m_mutex);
+   ThreadJoin(m_thread);
+   m_thread = INVALID_THREAD_HANDLE;
+
+   ObjectArray<SNMP_AsyncRequest> pending(64, 64, Ownership::False);
+   MutexLock(m_mutex);
+   Iterator<SNMP_AsyncRequest> *it = m_requests->iterator();
+   while(it->hasNext())
+      pending.add(it->next());
+   delete it;
+   m_requests->clear();
+   memset(m_timerWheel, 0, sizeof(m_timerWheel));
+   MutexUnlock(m_mutex);
+   for(int i = 0; i < pending.size(); i++)
+      complete(pending.get(i), SNMP_ERR_ABORTED, NULL);
+
+   for(int i = 0; i < m_numSockets; i++)
+   {
+      if (m_sockets[i] != INVALID_SOCKET)
+      {
+         closesocket(m_sockets[i]);
+         m_sockets[i] = INVALID_SOCKET;
+      }
+      if (m_sockets6[i] != INVALID_SOCKET)
+      {
+         closesocket(m_sockets6[i]);
+         m_sockets6[i] = INVALID_SOCKET;
+      }
+   }
+   nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 2, _T("SNMP_AsyncEngine: stopped"));
+}
+
+/**
+ * Check if given transport can be served by this engine
+ */
+bool SNMP_AsyncEngine::isTransportSupported(SNMP_Transport *transport)
+{
+   if (!m_running)
+      return false;
+   SockAddrBuffer addr;
+   if (!transport->getPeerSocketAddress(&addr))
+      return false;
+   return (((struct sockaddr *)&addr)->sa_family == AF_INET) || (m_sockets6[0] != INVALID_SOCKET);
+}
+
+/**
+ * Get number of pending requests
+ */
+int SNMP_AsyncEngine::getPendingRequestCount()
+{
+   MutexLock(m_mutex);
+   int count = m_requests->size();
+   MutexUnlock(m_mutex);
+   return count;
+}
+
+/**
+ * Send asynchronous request. Callback will be called from engine's thread when
+ * response is received or request times out. Engine takes ownership of request PDU.
+ * Transport should remain valid and should not be used for other requests until
+ * callback is called.
+ *
+ * @return true if request was sent (callback will be called), false on error (callback will not be called)
+ */
+bool SNMP_AsyncEngine::request(SNMP_Transport *transport, SNMP_PDU *request, SNMP_AsyncCallback callback, void *context, UINT32 timeout, int numRetries)
+{
+   return submit(transport, request, true, timeout, numRetries, callback, context);
+}
+
+/**
+ * Synchronous request context
+ */
+struct SyncRequestContext
+{
+   CONDITION completed;
+   UINT32 rcc;
+   SNMP_PDU *response;
+};
+
+/**
+ * Synchronous request callback
+ */
+static void SyncRequestCallback(UINT32 rcc, SNMP_PDU *response, void *context)
+{
+   SyncRequestContext *ctx = static_cast<SyncRequestContext*>(context);
+   ctx->rcc = rcc;
+   ctx->response = response;
+   ConditionSet(ctx->completed);
+}
+
+/**
+ * Send request via engine and wait for response. Has same semantics as SNMP_Transport::doRequest.
+ */
+UINT32 SNMP_AsyncEngine::doRequest(SNMP_Transport *transport, SNMP_PDU *request, SNMP_PDU **response, UINT32 timeout, int numRetries)
+{
+   SyncRequestContext ctx;
+   ctx.completed = ConditionCreate(false);
+   ctx.rcc = SNMP_ERR_COMM;
+   ctx.response = NULL;
+   if (submit(transport, request, false, timeout, numRetries, SyncRequestCallback, &ctx))
+      ConditionWait(ctx.completed, INFINITE);
+   ConditionDestroy(ctx.completed);
+   *response = ctx.response;
+   return ctx.rcc;
+}
+
+/**
+ * Submit request
+ */
+bool SNMP_AsyncEngine::submit(SNMP_Transport *transport, SNMP_PDU *request, bool ownsRequest, UINT32 timeout,
+         int numRetries, SNMP_AsyncCallback callback, void *context)
+{
+   SNMP_AsyncRequest *r = MemAllocStruct<SNMP_AsyncRequest>();
+   if (!transport->getPeerSocketAddress(&r->peer))
+   {
+      MemFree(r);
+      if (ownsRequest)
+         delete request;
+      return false;
+   }
+
+   r->id = SnmpNewRequestId() & 0x7FFFFFFF;
+   r->transport = transport;
+   r->pdu = request;
+   r->ownsPdu = ownsRequest;
+   r->callback = callback;
+   r->context = context;
+   r->timeout = (timeout != 0) ? timeout : SnmpGetDefaultTimeout();
+   r->retries = std::max(numRetries, 1) - 1;
+   r->timeSyncRetries = 3;
+   r->slot = -1;
+
+   SOCKET *sockets = (((struct sockaddr *)&r->peer)->sa_family == AF_INET) ? m_sockets : m_sockets6;
+   r->socket = sockets[static_cast<UINT32>(InterlockedIncrement(&m_nextSocket)) % m_numSockets];
+
+   transport->prepareRequest(request);
+   request->setRequestId(r->id);
+   request->setMessageId(r->id);
+
+   BYTE *buffer;
+   size_t size = request->encode(&buffer, transport->m_securityContext);
+   if (size == 0)
+   {
+      MemFree(r);
+      if (ownsRequest)
+         delete request;
+      return false;
+   }
+
+   // Request is sent while holding lock, otherwise engine's thread may destroy it before send completes
+   bool success = false;
+   MutexLock(m_mutex);
+   if (m_running && (r->socket != INVALID_SOCKET))
+   {
+      m_requests->set(r->id, r);
+      schedule(r);
+      if (sendto(r->socket, (char *)buffer, (int)size, 0, (struct sockaddr *)&r->peer, SA_LEN((struct sockaddr *)&r->peer)) > 0)
+      {
+         success = true;
+      }
+      else
+      {
+         m_requests->remove(r->id);
+         unschedule(r);
+      }
+   }
+   MutexUnlock(m_mutex);
+   MemFree(buffer);
+
+   if (!success)
+   {
+      MemFree(r);
+      if (ownsRequest)
+         delete request;
+   }
+   return success;
+}
+
+/**
+ * Encode and send request (called only from engine's thread)
+ */
+bool SNMP_AsyncEngine::send(SNMP_AsyncRequest *request)
+{
+   BYTE *buffer;
+   size_t size = request->pdu->encode(&buffer, request->transport->m_securityContext);
+   if (size == 0)
+      return false;
+   int bytes = sendto(request->socket, (char *)buffer, (int)size, 0, (struct sockaddr *)&request->peer, SA_LEN((struct sockaddr *)&request->peer));
+   MemFree(buffer);
+   return bytes > 0;
+}
+
+/**
+ * Put request into timer wheel. Engine's mutex must be held by caller.
+ */
+void SNMP_AsyncEngine::schedule(SNMP_AsyncRequest *request)
+{
+   if (request->timeout == INFINITE)
+      return;
+
+   UINT32 ticks = std::max((request->timeout + TIMER_TICK - 1) / TIMER_TICK, static_cast<UINT32>(1));
+   request->slot = (m_timerPosition + ticks) % SNMP_ASYNC_TIMER_SLOTS;
+   request->rounds = (ticks - 1) / SNMP_ASYNC_TIMER_SLOTS;
+   request->prev = NULL;
+   request->next = m_timerWheel[request->slot];
+   if (request->next != NULL)
+      request->next->prev = request;
+   m_timerWheel[request->slot] = request;
+}
+
+/**
+ * Remove request from timer wheel. Engine's mutex must be held by caller.
+ */
+void SNMP_AsyncEngine::unschedule(SNMP_AsyncRequest *request)
+{
+   if (request->slot == -1)
+      return;
+
+   if (request->prev != NULL)
+      request->prev->next = request->next;
+   else
+      m_timerWheel[request->slot] = request->next;
+   if (request->next != NULL)
+      request->next->prev = request->prev;
+   request->slot = -1;
+}
+
+/**
+ * Complete request. Request should already be removed from request index and timer wheel.
+ */
+void SNMP_AsyncEngine::complete(SNMP_AsyncRequest *request, UINT32 rcc, SNMP_PDU *response)
+{
+   if (rcc != SNMP_ERR_SUCCESS)
+      delete_and_null(response);
+   request->callback(rcc, response, request->context);
+   if (request->ownsPdu)
+      delete request->pdu;
+   MemFree(request);
+}
+
+/**
+ * Receive and process incoming messages on given socket
+ */
+void SNMP_AsyncEngine::receive(SOCKET s)
+{
+   while(true)
+   {
+      SockAddrBuffer sender;
+      socklen_t addrLen = sizeof(SockAddrBuffer);
+      int bytes = recvfrom(s, (char *)m_buffer, SNMP_DEFAULT_MSG_MAX_SIZE, 0, (struct sockaddr *)&sender, &addrLen);
+      if (bytes <= 0)
+         break;
+
+      UINT32 id;
+      if (!ExtractMessageId(m_buffer, bytes, &id))
+      {
+         nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 7, _T("SNMP_AsyncEngine: malformed message received"));
+         continue;
+      }
+
+      // Requests can be removed from index only by engine's thread, so request
+      // object remains valid after unlock
+      MutexLock(m_mutex);
+      SNMP_AsyncRequest *r = m_requests->get(id);
+      MutexUnlock(m_mutex);
+
+      // Some devices respond from port other than one request was sent to, so only IP address is validated
+      if ((r == NULL) || !SocketAddressEquals((struct sockaddr *)&sender, (struct sockaddr *)&r->peer))
+      {
+         nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 7, _T("SNMP_AsyncEngine: unexpected message with ID %u"), id);
+         continue;
+      }
+
+      SNMP_Transport *transport = r->transport;
+      SNMP_PDU *response = new SNMP_PDU();
+      UINT32 rcc;
+      if (response->parse(m_buffer, bytes, transport->m_securityContext, transport->m_enableEngineIdAutoupdate))
+      {
+         bool resend;
+         rcc = transport->processResponse(r->pdu, response, &r->timeSyncRetries, &resend);
+         if (resend)
+         {
+            delete response;
+            MutexLock(m_mutex);
+            unschedule(r);
+            schedule(r);
+            MutexUnlock(m_mutex);
+            send(r);
+            continue;
+         }
+      }
+      else
+      {
+         rcc = SNMP_ERR_PARSE;
+      }
+
+      MutexLock(m_mutex);
+      m_requests->remove(id);
+      unschedule(r);
+      MutexUnlock(m_mutex);
+      complete(r, rcc, response);
+   }
+}
+
+/**
+ * Process expired timers: retransmit requests with remaining retries and complete others with timeout
+ */
+void SNMP_AsyncEngine::processTimers()
+{
+   INT64 now = GetCurrentTimeMs();
+   ObjectArray<SNMP_AsyncRequest> expired(16, 16, Ownership::False);
+   ObjectArray<SNMP_AsyncRequest> resend(16, 16, Ownership::False);
+
+   MutexLock(m_mutex);
+   while(m_timerTime + TIMER_TICK <= now)
+   {
+      m_timerTime += TIMER_TICK;
+      m_timerPosition = (m_timerPosition + 1) % SNMP_ASYNC_TIMER_SLOTS;
+
+      SNMP_AsyncRequest *r = m_timerWheel[m_timerPosition];
+      while(r != NULL)
+      {
+         SNMP_AsyncRequest *next = r->next;
+         if (r->rounds > 0)
+         {
+            r->rounds--;
+         }
+         else
+         {
+            unschedule(r);
+            if (r->retries > 0)
+            {
+               r->retries--;
+               resend.add(r);
+            }
+            else
+            {
+               m_requests->remove(r->id);
+               expired.add(r);
+            }
+         }
+         r = next;
+      }
+   }
+
+   // Requests to be resent are scheduled again before sending so response cannot outrun timer
+   for(int i = 0; i < resend.size(); i++)
+      schedule(resend.get(i));
+   MutexUnlock(m_mutex);
+
+   for(int i = 0; i < resend.size(); i++)
+      send(resend.get(i));
+   for(int i = 0; i < expired.size(); i++)
+      complete(expired.get(i), SNMP_ERR_TIMEOUT, NULL);
+}
+
+/**
+ * Engine's worker thread
+ */
+void SNMP_AsyncEngine::workerThread()
+{
+   SocketPoller sp;
+   while(!m_shutdown)
+   {
+      sp.reset();
+      for(int i = 0; i < m_numSockets; i++)
+      {
+         sp.add(m_sockets[i]);
+         if (m_sockets6[i] != INVALID_SOCKET)
+            sp.add(m_sockets6[i]);
+      }
+
+      if (sp.poll(TIMER_TICK) > 0)
+      {
+         for(int i = 0; i < m_numSockets; i++)
+         {
+            if (sp.isSet(m_sockets[i]))
+               receive(m_sockets[i]);
+            if ((m_sockets6[i] != INVALID_SOCKET) && sp.isSet(m_sockets6[i]))
+               receive(m_sockets6[i]);
+         }
+      }
+
+      processTimers();
+   }
+}
+
+/**
+ * Worker thread starter
+ */
+THREAD_RESULT THREAD_CALL SNMP_AsyncEngine::workerThreadStarter(void *arg)
+{
+   static_cast<SNMP_AsyncEngine*>(arg)->workerThread();
+   return THREAD_OK;
+}
@@ -79,6 +79,55 @@ typedef struct
 
 #define MIB_END_OF_TAG             0x80
 
+/**
+ * Indexed compiled MIB file constants
+ */
+#define MIB_INDEX_FILE_MAGIC        "NXMIBX"
+#define MIB_INDEX_FILE_VERSION      1
+#define MIB_INDEX_BYTE_ORDER_MARK   0x01020304
+
+/**
+ * Header of indexed compiled MIB file. All values are in host byte order
+ * (file written on platform with different byte order will be rejected).
+ * All offsets are from the beginning of the file.
+ */
+struct SNMP_MIB_INDEX_HEADER
+{
+   char magic[6];
+   BYTE headerSize;
+   BYTE version;
+   UINT32 byteOrderMark;
+   UINT32 timestamp;
+   UINT32 flags;
+   UINT32 nodeCount;
+   UINT32 nodeOffset;
+   UINT32 hashSize;        // Number of buckets in name hash (power of 2)
+   UINT32 hashOffset;
+   UINT32 stringsOffset;
+   UINT32 stringsSize;
+   UINT32 fileSize;
+};
+
+/**
+ * Node of indexed compiled MIB file. Nodes are stored in breadth-first order,
+ * so children of any node occupy continuous range sorted by sub-identifier.
+ */
+struct SNMP_MIB_INDEX_NODE
+{
+   UINT32 subId;
+   UINT32 parent;
+   UINT32 firstChild;
+   UINT32 childCount;
+   UINT32 name;               // Offsets within string table (0 is empty string)
+   UINT32 description;
+   UINT32 textualConvention;
+   UINT32 nextByName;         // Next node in same name hash bucket
+   BYTE type;
+   BYTE status;
+   BYTE access;
+   BYTE reserved;
+};
+
 /**
  * Class for compressed/uncompressed I/O
  */
@@ -0,0 +1,583 @@
+/*
+** NetXMS - Network Management System
+** SNMP support library
+** Copyright (C) 2003-2020 Victor Kirhenshtein
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: mibindex.cpp
+**
+**/
+
+#include "libnxsnmp.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+/**
+ * Hash function for object names (FNV-1a)
+ */
+static inline UINT32 HashName(const char *name)
+{
+   UINT32 hash = 2166136261U;
+   for(const BYTE *p = reinterpret_cast<const BYTE*>(name); *p != 0; p++)
+   {
+      hash ^= *p;
+      hash *= 16777619U;
+   }
+   return hash;
+}
+
+/**
+ * Compare MIB objects by sub-identifier
+ */
+static int CompareObjectsBySubId(const void *e1, const void *e2)
+{
+   UINT32 id1 = (*static_cast<SNMP_MIBObject* const*>(e1))->getObjectId();
+   UINT32 id2 = (*static_cast<SNMP_MIBObject* const*>(e2))->getObjectId();
+   return (id1 < id2) ? -1 : ((id1 > id2) ? 1 : 0);
+}
+
+/**
+ * Add string to string table and return its offset. Empty strings are not stored.
+ */
+static UINT32 AddString(ByteStream *strings, const TCHAR *s)
+{
+   if ((s == NULL) || (*s == 0))
+      return 0;
+   UINT32 offset = static_cast<UINT32>(strings->size());
+   char *utf8 = UTF8StringFromTString(s);
+   strings->write(utf8, strlen(utf8) + 1);
+   MemFree(utf8);
+   return offset;
+}
+
+/**
+ * Save MIB tree to indexed file which can be mapped into memory by SNMP_MIBIndex.
+ * Only SMT_SKIP_DESCRIPTIONS flag is supported, indexed file is never compressed.
+ */
+UINT32 LIBNXSNMP_EXPORTABLE SNMPSaveIndexedMIBTree(const TCHAR *fileName, SNMP_MIBObject *root, UINT32 flags)
+{
+   // Build list of objects in breadth-first order, children sorted by sub-identifier
+   ObjectArray<SNMP_MIBObject> objects(4096, 4096, Ownership::False);
+   objects.add(root);
+   SNMP_MIBObject **children = MemAllocArrayNoInit<SNMP_MIBObject*>(256);
+   int childrenCapacity = 256;
+   UINT32 nodeCount = 1;
+   SNMP_MIB_INDEX_NODE *nodes = MemAllocArray<SNMP_MIB_INDEX_NODE>(1);
+   ByteStream strings(65536);
+   strings.write(static_cast<BYTE>(0));   // offset 0 is empty string
+   for(int i = 0; i < objects.size(); i++)
+   {
+      SNMP_MIBObject *object = objects.get(i);
+
+      int count = 0;
+      for(SNMP_MIBObject *c = object->getFirstChild(); c != NULL; c = c->getNext())
+      {
+         if (count == childrenCapacity)
+         {
+            childrenCapacity *= 2;
+            children = MemReallocArray(children, childrenCapacity);
+         }
+         children[count++] = c;
+      }
+      qsort(children, count, sizeof(SNMP_MIBObject*), CompareObjectsBySubId);
+
+      SNMP_MIB_INDEX_NODE *n = &nodes[i];
+      n->subId = object->getObjectId();
+      n->firstChild = nodeCount;
+      n->childCount = count;
+      n->name = AddString(&strings, object->getName());
+      if (!(flags & SMT_SKIP_DESCRIPTIONS))
+      {
+         n->description = AddString(&strings, object->getDescription());
+         n->textualConvention = AddString(&strings, object->getTextualConvention());
+      }
+      n->type = static_cast<BYTE>(object->getType());
+      n->status = static_cast<BYTE>(object->getStatus());
+      n->access = static_cast<BYTE>(object->getAccess());
+
+      if (count > 0)
+      {
+         nodes = MemReallocArray(nodes, nodeCount + count);
+         memset(&nodes[nodeCount], 0, sizeof(SNMP_MIB_INDEX_NODE) * count);
+         for(int j = 0; j < count; j++)
+         {
+            nodes[nodeCount + j].parent = i;
+            objects.add(children[j]);
+         }
+         nodeCount += count;
+      }
+   }
+   MemFree(children);
+   nodes[0].parent = SNMP_MIB_INVALID_NODE;
+
+   // Build name hash, chains are built in reverse order so that
+   // objects closer to root are found first
+   UINT32 hashSize = 16;
+   while(hashSize < nodeCount)
+      hashSize <<= 1;
+   UINT32 *hash = MemAllocArrayNoInit<UINT32>(hashSize);
+   memset(hash, 0xFF, sizeof(UINT32) * hashSize);
+   for(UINT32 i = nodeCount; i > 0; i--)
+   {
+      SNMP_MIB_INDEX_NODE *n = &nodes[i - 1];
+      if (n->name == 0)
+      {
+         n->nextByName = SNMP_MIB_INVALID_NODE;
+         continue;
+      }
+      UINT32 bucket = HashName(reinterpret_cast<const char*>(strings.buffer()) + n->name) & (hashSize - 1);
+      n->nextByName = hash[bucket];
+      hash[bucket] = i - 1;
+   }
+
+   SNMP_MIB_INDEX_HEADER header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, MIB_INDEX_FILE_MAGIC, 6);
+   header.headerSize = sizeof(SNMP_MIB_INDEX_HEADER);
+   header.version = MIB_INDEX_FILE_VERSION;
+   header.byteOrderMark = MIB_INDEX_BYTE_ORDER_MARK;
+   header.timestamp = static_cast<UINT32>(time(NULL));
+   header.flags = flags & SMT_SKIP_DESCRIPTIONS;
+   header.nodeCount = nodeCount;
+   header.nodeOffset = sizeof(SNMP_MIB_INDEX_HEADER);
+   header.hashSize = hashSize;
+   header.hashOffset = header.nodeOffset + nodeCount * sizeof(SNMP_MIB_INDEX_NODE);
+   header.stringsOffset = header.hashOffset + hashSize * sizeof(UINT32);
+   header.stringsSize = static_cast<UINT32>(strings.size());
+   header.fileSize = header.stringsOffset + header.stringsSize;
+
+   // Existing file may be mapped into memory by running processes, so new content is written
+   // into temporary file which then replaces existing one
+   TCHAR tempFileName[MAX_PATH];
+   _sntprintf(tempFileName, MAX_PATH, _T("%s.tmp"), fileName);
+
+   UINT32 rc = SNMP_ERR_SUCCESS;
+   FILE *file = _tfopen(tempFileName, _T("wb"));
+   if (file != NULL)
+   {
+      if ((fwrite(&header, sizeof(header), 1, file) != 1) ||
+          (fwrite(nodes, sizeof(SNMP_MIB_INDEX_NODE), nodeCount, file) != nodeCount) ||
+          (fwrite(hash, sizeof(UINT32), hashSize, file) != hashSize) ||
+          (fwrite(strings.buffer(), 1, strings.size(), file) != strings.size()))
+      {
+         rc = SNMP_ERR_FILE_IO;
+      }
+      if (fclose(file) != 0)
+         rc = SNMP_ERR_FILE_IO;
+
+      if (rc == SNMP_ERR_SUCCESS)
+      {
+#ifdef _WIN32
+         if (!MoveFileEx(tempFileName, fileName, MOVEFILE_REPLACE_EXISTING))
+            rc = SNMP_ERR_FILE_IO;
+#else
+         if (_trename(tempFileName, fileName) != 0)
+            rc = SNMP_ERR_FILE_IO;
+#endif
+      }
+      if (rc != SNMP_ERR_SUCCESS)
+         _tremove(tempFileName);
+   }
+   else
+   {
+      rc = SNMP_ERR_FILE_IO;
+   }
+
+   MemFree(nodes);
+   MemFree(hash);
+   return rc;
+}
+
+/**
+ * Check that block of given size at given offset is within file
+ */
+static inline bool IsValidBlock(UINT64 offset, UINT64 elementSize, UINT64 count, UINT64 fileSize)
+{
+   return offset + elementSize * count <= fileSize;
+}
+
+/**
+ * Internal constructor
+ */
+SNMP_MIBIndex::SNMP_MIBIndex()
+{
+   m_data = NULL;
+   m_size = 0;
+   m_mapped = false;
+#ifdef _WIN32
+   m_mapping = NULL;
+#endif
+   m_header = NULL;
+   m_nodes = NULL;
+   m_hash = NULL;
+   m_strings = NULL;
+   m_nodeCount = 0;
+   m_hashSize = 0;
+   m_stringsSize = 0;
+}
+
+/**
+ * Destructor
+ */
+SNMP_MIBIndex::~SNMP_MIBIndex()
+{
+   if (m_mapped)
+   {
+#ifdef _WIN32
+      UnmapViewOfFile(m_data);
+      CloseHandle(m_mapping);
+#elif HAVE_SYS_MMAN_H
+      munmap(const_cast<BYTE*>(m_data), m_size);
+#endif
+   }
+   else
+   {
+      MemFree(const_cast<BYTE*>(m_data));
+   }
+}
+
+/**
+ * Load indexed MIB file. File is mapped into memory if possible, otherwise read as
+ * a single block. Only header is validated on load, all node and string references
+ * are range checked on access.
+ *
+ * @param fileName file name
+ * @param rcc optional pointer to variable for error code
+ * @return loaded MIB index or NULL on error
+ */
+SNMP_MIBIndex *SNMP_MIBIndex::load(const TCHAR *fileName, UINT32 *rcc)
+{
+   SNMP_MIBIndex *index = new SNMP_MIBIndex();
+
+#if defined(_WIN32)
+   HANDLE hFile = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if (hFile != INVALID_HANDLE_VALUE)
+   {
+      LARGE_INTEGER size;
+      if (GetFileSizeEx(hFile, &size) && (size.QuadPart > 0) && (size.QuadPart < 0x7FFFFFFF))
+      {
+         index->m_mapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+         if (index->m_mapping != NULL)
+         {
+            index->m_data = static_cast<const BYTE*>(MapViewOfFile(index->m_mapping, FILE_MAP_READ, 0, 0, 0));
+            if (index->m_data != NULL)
+            {
+               index->m_size = static_cast<size_t>(size.QuadPart);
+               index->m_mapped = true;
+            }
+            else
+            {
+               CloseHandle(index->m_mapping);
+               index->m_mapping = NULL;
+            }
+         }
+      }
+      CloseHandle(hFile);
+   }
+#elif HAVE_SYS_MMAN_H
+   int fd = _topen(fileName, O_RDONLY);
+   if (fd != -1)
+   {
+      struct stat st;
+      if ((fstat(fd, &st) == 0) && (st.st_size > 0) && (st.st_size < 0x7FFFFFFF))
+      {
+         void *data = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+         if (data != MAP_FAILED)
+         {
+            index->m_data = static_cast<const BYTE*>(data);
+            index->m_size = static_cast<size_t>(st.st_size);
+            index->m_mapped = true;
+         }
+      }
+      _close(fd);
+   }
+#endif
+
+   if (index->m_data == NULL)
+   {
+      UINT32 size;
+      index->m_data = LoadFile(fileName, &size);
+      if (index->m_data == NULL)
+      {
+         delete index;
+         if (rcc != NULL)
+            *rcc = SNMP_ERR_FILE_IO;
+         return NULL;
+      }
+      index->m_size = size;
+   }
+
+   const SNMP_MIB_INDEX_HEADER *header = reinterpret_cast<const SNMP_MIB_INDEX_HEADER*>(index->m_data);
+   if ((index->m_size < sizeof(SNMP_MIB_INDEX_HEADER)) || memcmp(header->magic, MIB_INDEX_FILE_MAGIC, 6) ||
+       (header->version != MIB_INDEX_FILE_VERSION) || (header->headerSize != sizeof(SNMP_MIB_INDEX_HEADER)) ||
+       (header->byteOrderMark != MIB_INDEX_BYTE_ORDER_MARK))
+   {
+      delete index;
+      if (rcc != NULL)
+         *rcc = SNMP_ERR_BAD_FILE_HEADER;
+      return NULL;
+   }
+
+   if ((header->fileSize != index->m_size) || (header->nodeCount == 0) ||
+       (header->hashSize == 0) || ((header->hashSize & (header->hashSize - 1)) != 0) || (header->stringsSize == 0) ||
+       ((header->nodeOffset % 4) != 0) || ((header->hashOffset % 4) != 0) ||
+       !IsValidBlock(header->nodeOffset, sizeof(SNMP_MIB_INDEX_NODE), header->nodeCount, index->m_size) ||
+       !IsValidBlock(header->hashOffset, sizeof(UINT32), header->hashSize, index->m_size) ||
+       !IsValidBlock(header->stringsOffset, 1, header->stringsSize, index->m_size) ||
+       (index->m_data[header->stringsOffset] != 0) || (index->m_data[header->stringsOffset + header->stringsSize - 1] != 0))
+   {
+      delete index;
+      if (rcc != NULL)
+         *rcc = SNMP_ERR_BAD_FILE_DATA;
+      return NULL;
+   }
+
+   index->m_header = header;
+   index->m_nodes = reinterpret_cast<const SNMP_MIB_INDEX_NODE*>(index->m_data + header->nodeOffset);
+   index->m_hash = reinterpret_cast<const UINT32*>(index->m_data + header->hashOffset);
+   index->m_strings = reinterpret_cast<const char*>(index->m_data + header->stringsOffset);
+   index->m_nodeCount = header->nodeCount;
+   index->m_hashSize = header->hashSize;
+   index->m_stringsSize = header->stringsSize;
+
+   if (rcc != NULL)
+      *rcc = SNMP_ERR_SUCCESS;
+   return index;
+}
+
+/**
+ * Get timestamp of MIB file creation
+ */
+UINT32 SNMP_MIBIndex::getTimestamp() const
+{
+   return m_header->timestamp;
+}
+
+/**
+ * Get parent node
+ */
+UINT32 SNMP_MIBIndex::getParent(UINT32 node) const
+{
+   return (node < m_nodeCount) ? m_nodes[node].parent : SNMP_MIB_INVALID_NODE;
+}
+
+/**
+ * Get number of child nodes
+ */
+UINT32 SNMP_MIBIndex::getChildCount(UINT32 node) const
+{
+   if (node >= m_nodeCount)
+      return 0;
+   const SNMP_MIB_INDEX_NODE *n = &m_nodes[node];
+   return ((n->firstChild <= m_nodeCount) && (n->childCount <= m_nodeCount - n->firstChild)) ? n->childCount : 0;
+}
+
+/**
+ * Get child node by position (children are ordered by sub-identifier)
+ */
+UINT32 SNMP_MIBIndex::getChild(UINT32 node, UINT32 index) const
+{
+   return (index < getChildCount(node)) ? m_nodes[node].firstChild + index : SNMP_MIB_INVALID_NODE;
+}
+
+/**
+ * Find child node by sub-identifier
+ */
+UINT32 SNMP_MIBIndex::findChild(UINT32 node, UINT32 subId) const
+{
+   UINT32 count = getChildCount(node);
+   if (count == 0)
+      return SNMP_MIB_INVALID_NODE;
+
+   const SNMP_MIB_INDEX_NODE *children = &m_nodes[m_nodes[node].firstChild];
+   UINT32 l = 0, r = count;
+   while(l < r)
+   {
+      UINT32 m = (l + r) / 2;
+      if (children[m].subId < subId)
+         l = m + 1;
+      else
+         r = m;
+   }
+   return ((l < count) && (children[l].subId == subId)) ? m_nodes[node].firstChild + l : SNMP_MIB_INVALID_NODE;
+}
+
+/**
+ * Find node with longest match for given OID. Returns root node if no part of OID
+ * was matched. Number of matched OID elements is stored in matchedLength if provided.
+ */
+UINT32 SNMP_MIBIndex::findNode(const UINT32 *oid, size_t length, size_t *matchedLength) const
+{
+   UINT32 node = 0;
+   size_t i;
+   for(i = 0; i < length; i++)
+   {
+      UINT32 child = findChild(node, oid[i]);
+      if (child == SNMP_MIB_INVALID_NODE)
+         break;
+      node = child;
+   }
+   if (matchedLength != NULL)
+      *matchedLength = i;
+   return node;
+}
+
+/**
+ * Find node with longest match for given OID
+ */
+UINT32 SNMP_MIBIndex::findNode(const SNMP_ObjectId& oid, size_t *matchedLength) const
+{
+   return findNode(oid.value(), oid.length(), matchedLength);
+}
+
+/**
+ * Find node by object name. If there are multiple objects with same name, one closest to root will be returned.
+ */
+UINT32 SNMP_MIBIndex::findNodeByName(const char *name) const
+{
+   UINT32 node = m_hash[HashName(name) & (m_hashSize - 1)];
+   for(UINT32 steps = 0; (node < m_nodeCount) && (steps < m_nodeCount); steps++)
+   {
+      if (!strcmp(string(m_nodes[node].name), name))
+         return node;
+      node = m_nodes[node].nextByName;
+   }
+   return SNMP_MIB_INVALID_NODE;
+}
+
+/**
+ * Get node's sub-identifier
+ */
+UINT32 SNMP_MIBIndex::getSubId(UINT32 node) const
+{
+   return (node < m_nodeCount) ? m_nodes[node].subId : 0;
+}
+
+/**
+ * Get node name
+ */
+const char *SNMP_MIBIndex::getName(UINT32 node) const
+{
+   return (node < m_nodeCount) ? string(m_nodes[node].name) : "";
+}
+
+/**
+ * Get node description
+ */
+const char *SNMP_MIBIndex::getDescription(UINT32 node) const
+{
+   return (node < m_nodeCount) ? string(m_nodes[node].description) : "";
+}
+
+/**
+ * Get node textual convention
+ */
+const char *SNMP_MIBIndex::getTextualConvention(UINT32 node) const
+{
+   return (node < m_nodeCount) ? string(m_nodes[node].textualConvention) : "";
+}
+
+/**
+ * Get node type (-1 if not set)
+ */
+int SNMP_MIBIndex::getType(UINT32 node) const
+{
+   return ((node < m_nodeCount) && (m_nodes[node].type != 0xFF)) ? m_nodes[node].type : -1;
+}
+
+/**
+ * Get node status (-1 if not set)
+ */
+int SNMP_MIBIndex::getStatus(UINT32 node) const
+{
+   return ((node < m_nodeCount) && (m_nodes[node].status != 0xFF)) ? m_nodes[node].status : -1;
+}
+
+/**
+ * Get node access (-1 if not set)
+ */
+int SNMP_MIBIndex::getAccess(UINT32 node) const
+{
+   return ((node < m_nodeCount) && (m_nodes[node].access != 0xFF)) ? m_nodes[node].access : -1;
+}
+
+/**
+ * Get full object identifier of given node. Returns OID length or 0 if buffer is too small
+ * or parent chain is broken (path from any node to root cannot be longer than node count).
+ */
+size_t SNMP_MIBIndex::getObjectId(UINT32 node, UINT32 *buffer, size_t size) const
+{
+   size_t length = 0;
+   for(UINT32 n = node; (n != 0) && (n < m_nodeCount); n = m_nodes[n].parent)
+   {
+      if ((++length > size) || (length >= m_nodeCount))
+         return 0;
+   }
+
+   size_t pos = length;
+   for(UINT32 n = node; (n != 0) && (n < m_nodeCount); n = m_nodes[n].parent)
+      buffer[--pos] = m_nodes[n].subId;
+   return length;
+}
+
+/**
+ * Convert OID to symbolic form - name of most specific known object followed by
+ * remaining sub-identifiers (like ifDescr.3). If no part of OID is known, it is
+ * converted to numeric form.
+ */
+TCHAR *SNMP_MIBIndex::getSymbolicName(const UINT32 *oid, size_t length, TCHAR *buffer, size_t size) const
+{
+   size_t matched;
+   UINT32 node = findNode(oid, length, &matched);
+   while((matched > 0) && (m_nodes[node].name == 0))
+   {
+      node = m_nodes[node].parent;
+      matched--;
+   }
+
+   if (matched == 0)
+      return SNMPConvertOIDToText(length, oid, buffer, size);
+
+   const char *name = getName(node);
+#ifdef UNICODE
+   size_t pos = utf8_to_wchar(name, strlen(name), buffer, size - 1);
+#else
+   size_t pos = utf8_to_mb(name, strlen(name), buffer, size - 1);
+#endif
+   buffer[pos] = 0;
+
+   for(size_t i = matched; i < length; i++)
+   {
+      int len = _sntprintf(&buffer[pos], size - pos, _T(".%u"), oid[i]);
+      if ((len < 0) || (pos + len >= size))
+      {
+         buffer[pos] = 0;   // do not leave partially written sub-identifier
+         break;
+      }
+      pos += len;
+   }
+   return buffer;
+}
+
+/**
+ * Convert OID to symbolic form
+ */
+TCHAR *SNMP_MIBIndex::getSymbolicName(const SNMP_ObjectId& oid, TCHAR *buffer, size_t size) const
+{
+   return getSymbolicName(oid.value(), oid.length(), buffer, size);
+}
@@ -140,6 +140,45 @@ SNMP_Snapshot *SNMP_Snapshot::create(SNMP_Transport *transport, const UINT32 *ba
    return s;
 }
 
+/**
+ * Create snapshot of multiple columns (subtrees) walked in parallel
+ */
+SNMP_Snapshot *SNMP_Snapshot::create(SNMP_Transport *transport, const ObjectArray<SNMP_ObjectId> *columns)
+{
+   int numColumns = columns->size();
+   ObjectArray<SNMP_Variable> **results = MemAllocArrayNoInit<ObjectArray<SNMP_Variable>*>(numColumns);
+   if (SnmpWalkColumns(transport, columns, results) != SNMP_ERR_SUCCESS)
+   {
+      MemFree(results);
+      return NULL;
+   }
+
+   // Add columns in OID order to keep snapshot values sorted
+   int *order = MemAllocArrayNoInit<int>(numColumns);
+   for(int i = 0; i < numColumns; i++)
+   {
+      int j = i;
+      for(; (j > 0) && (columns->get(order[j - 1])->compare(*columns->get(i)) == OID_FOLLOWING); j--)
+         order[j] = order[j - 1];
+      order[j] = i;
+   }
+
+   SNMP_Snapshot *s = new SNMP_Snapshot();
+   for(int i = 0; i < numColumns; i++)
+   {
+      ObjectArray<SNMP_Variable> *values = results[order[i]];
+      for(int j = 0; j < values->size(); j++)
+         s->m_values->add(values->get(j));
+      values->setOwner(Ownership::False);
+      delete values;
+   }
+   s->buildIndex();
+
+   MemFree(order);
+   MemFree(results);
+   return s;
+}
+
 /**
  * Get variable
  */
@@ -83,18 +83,11 @@ void SNMP_Transport::setSecurityContext(SNMP_SecurityContext *ctx)
 }
 
 /**
- * Send a request and wait for response with respect for timeouts and retransmissions
+ * Prepare request for sending: create dummy security context if needed and
+ * update SNMPv3 request with cached context engine ID.
  */
-UINT32 SNMP_Transport::doRequest(SNMP_PDU *request, SNMP_PDU **response, UINT32 timeout, int numRetries)
+void SNMP_Transport::prepareRequest(SNMP_PDU *request)
 {
-   UINT32 rc, remainingWaitTime;
-   int bytes;
-
-   if ((request == NULL) || (response == NULL) || (numRetries <= 0))
-      return SNMP_ERR_PARAM;
-
-   *response = NULL;
-
 	// Create dummy context
 	if (m_securityContext == NULL)
 		m_securityContext = new SNMP_SecurityContext();
@@ -107,6 +100,112 @@ UINT32 SNMP_Transport::doRequest(SNMP_PDU *request, SNMP_PDU **response, UINT32
 			request->setContextEngineId(m_contextEngine->getId(), m_contextEngine->getIdLen());
 		}
 	}
+}
+
+/**
+ * Process response matched to request. For SNMPv3 caches engine information
+ * and handles reports. If request should be sent again (engine ID discovery or
+ * time window synchronization) sets resend flag to true.
+ *
+ * @param request original request
+ * @param response response received for this request
+ * @param timeSyncRetries remaining number of time synchronization retries
+ * @param resend will be set to true if request should be re-sent
+ * @return SNMP error code
+ */
+UINT32 SNMP_Transport::processResponse(SNMP_PDU *request, SNMP_PDU *response, int *timeSyncRetries, bool *resend)
+{
+   *resend = false;
+   if (request->getVersion() != SNMP_VERSION_3)
+      return SNMP_ERR_SUCCESS;
+
+   // Cache authoritative engine ID
+   if ((m_authoritativeEngine == NULL) && (response->getAuthoritativeEngine().getIdLen() != 0))
+   {
+      m_authoritativeEngine = new SNMP_Engine(response->getAuthoritativeEngine());
+      m_securityContext->setAuthoritativeEngine(*m_authoritativeEngine);
+   }
+
+   // Cache context engine ID
+   if (((m_contextEngine == NULL) || (m_contextEngine->getIdLen() == 0)) && (response->getContextEngineIdLength() != 0))
+   {
+      delete m_contextEngine;
+      m_contextEngine = new SNMP_Engine(response->getContextEngineId(), response->getContextEngineIdLength());
+   }
+
+   if (response->getCommand() != SNMP_REPORT)
+      return (response->getCommand() == SNMP_RESPONSE) ? SNMP_ERR_SUCCESS : SNMP_ERR_BAD_RESPONSE;
+
+   SNMP_Variable *var = response->getVariable(0);
+   UINT32 rc = SNMP_ERR_AGENT;
+   const SNMP_ObjectId& oid = var->getName();
+   for(int i = 0; s_oidToErrorMap[i].oidLen != 0; i++)
+   {
+      if (oid.compare(s_oidToErrorMap[i].oid, s_oidToErrorMap[i].oidLen) == OID_EQUAL)
+      {
+         rc = s_oidToErrorMap[i].errorCode;
+         break;
+      }
+   }
+
+   // Engine ID discovery - if request contains empty engine ID,
+   // replace it with correct one and retry
+   if (rc == SNMP_ERR_ENGINE_ID)
+   {
+      if (request->getContextEngineIdLength() == 0)
+      {
+         // Use provided context engine ID if set in response
+         // Use authoritative engine ID if response has no context engine id
+         if (response->getContextEngineIdLength() > 0)
+            request->setContextEngineId(response->getContextEngineId(), response->getContextEngineIdLength());
+         else if (response->getAuthoritativeEngine().getIdLen() != 0)
+            request->setContextEngineId(response->getAuthoritativeEngine().getId(), response->getAuthoritativeEngine().getIdLen());
+         *resend = true;
+      }
+      if (m_securityContext->getAuthoritativeEngine().getIdLen() == 0)
+      {
+         m_securityContext->setAuthoritativeEngine(response->getAuthoritativeEngine());
+         *resend = true;
+      }
+   }
+   else if (rc == SNMP_ERR_TIME_WINDOW)
+   {
+      // Update cached authoritative engine with new boots and time
+      assert(m_authoritativeEngine != NULL);
+      if ((*timeSyncRetries > 0) &&
+          ((response->getAuthoritativeEngine().getBoots() != m_authoritativeEngine->getBoots()) ||
+           (response->getAuthoritativeEngine().getTime() != m_authoritativeEngine->getTime())))
+      {
+         m_authoritativeEngine->setBoots(response->getAuthoritativeEngine().getBoots());
+         m_authoritativeEngine->setTime(response->getAuthoritativeEngine().getTime());
+         m_securityContext->setAuthoritativeEngine(*m_authoritativeEngine);
+         (*timeSyncRetries)--;
+         *resend = true;
+      }
+   }
+   return rc;
+}
+
+/**
+ * Send a request and wait for response with respect for timeouts and retransmissions.
+ * If default asynchronous engine is running and transport can be served by it,
+ * request will be sent via engine's shared sockets.
+ */
+UINT32 SNMP_Transport::doRequest(SNMP_PDU *request, SNMP_PDU **response, UINT32 timeout, int numRetries)
+{
+   UINT32 rc, remainingWaitTime;
+   int bytes;
+
+   if ((request == NULL) || (response == NULL) || (numRetries <= 0))
+      return SNMP_ERR_PARAM;
+
+   *response = NULL;
+
+   SNMP_AsyncEngine *engine = SnmpGetDefaultAsyncEngine();
+   if ((engine != NULL) && engine->isTransportSupported(this))
+      return engine->doRequest(this, request, response, timeout, numRetries);
+
+   prepareRequest(request);
 
 	if (m_reliable)
 	   numRetries = 1;   // Don't do retry on reliable transport
@@ -133,108 +232,25 @@ UINT32 SNMP_Transport::doRequest(SNMP_PDU *request, SNMP_PDU **response, UINT32
       {
          if (*response != NULL)
          {
-            if (request->getVersion() == SNMP_VERSION_3)
+            bool match = (request->getVersion() == SNMP_VERSION_3) ?
+                     ((*response)->getMessageId() == request->getMessageId()) :
+                     ((*response)->getRequestId() == request->getRequestId());
+            if (match)
             {
-               if ((*response)->getMessageId() == request->getMessageId())
-               {
-                  // Cache authoritative engine ID
-                  if ((m_authoritativeEngine == NULL) && ((*response)->getAuthoritativeEngine().getIdLen() != 0))
-                  {
-                     m_authoritativeEngine = new SNMP_Engine((*response)->getAuthoritativeEngine());
-                     m_securityContext->setAuthoritativeEngine(*m_authoritativeEngine);
-                  }
-
-                  // Cache context engine ID
-                  if (((m_contextEngine == NULL) || (m_contextEngine->getIdLen() == 0)) && ((*response)->getContextEngineIdLength() != 0))
-                  {
-                     delete m_contextEngine;
-                     m_contextEngine = new SNMP_Engine((*response)->getContextEngineId(), (*response)->getContextEngineIdLength());
-                  }
-
-                  if ((*response)->getCommand() == SNMP_REPORT)
-                  {
-                     SNMP_Variable *var = (*response)->getVariable(0);
-                     rc = SNMP_ERR_AGENT;
-                     const SNMP_ObjectId& oid = var->getName();
-                     for(int i = 0; s_oidToErrorMap[i].oidLen != 0; i++)
-                     {
-                        if (oid.compare(s_oidToErrorMap[i].oid, s_oidToErrorMap[i].oidLen) == OID_EQUAL)
-                        {
-                           rc = s_oidToErrorMap[i].errorCode;
-                           break;
-                        }
-                     }
-
-                     // Engine ID discovery - if request contains empty engine ID,
-                     // replace it with correct one and retry
-                     if (rc == SNMP_ERR_ENGINE_ID)
-                     {
-                        bool canRetry = false;
-
-                        if (request->getContextEngineIdLength() == 0)
-                        {
-                           // Use provided context engine ID if set in response
-                           // Use authoritative engine ID if response has no context engine id
-                           if ((*response)->getContextEngineIdLength() > 0)
-                              request->setContextEngineId((*response)->getContextEngineId(), (*response)->getContextEngineIdLength());
-                           else if ((*response)->getAuthoritativeEngine().getIdLen() != 0)
-                              request->setContextEngineId((*response)->getAuthoritativeEngine().getId(), (*response)->getAuthoritativeEngine().getIdLen());
-                           canRetry = true;
-                        }
-                        if (m_securityContext->getAuthoritativeEngine().getIdLen() == 0)
-                        {
-                           m_securityContext->setAuthoritativeEngine((*response)->getAuthoritativeEngine());
-                           canRetry = true;
-                        }
-                        if (canRetry)
-                           goto retry;
-                     }
-                     else if (rc == SNMP_ERR_TIME_WINDOW)
-                     {
-                        // Update cached authoritative engine with new boots and time
-                        assert(m_authoritativeEngine != NULL);
-                        if ((timeSyncRetries > 0) &&
-                            (((*response)->getAuthoritativeEngine().getBoots() != m_authoritativeEngine->getBoots()) ||
-                             ((*response)->getAuthoritativeEngine().getTime() != m_authoritativeEngine->getTime())))
-                        {
-                           m_authoritativeEngine->setBoots((*response)->getAuthoritativeEngine().getBoots());
-                           m_authoritativeEngine->setTime((*response)->getAuthoritativeEngine().getTime());
-                           m_securityContext->setAuthoritativeEngine(*m_authoritativeEngine);
-                           timeSyncRetries--;
-                           goto retry;
-                        }
-                     }
-                  }
-                  else if ((*response)->getCommand() != SNMP_RESPONSE)
-                  {
-                     rc = SNMP_ERR_BAD_RESPONSE;
-                  }
-                  break;
-               }
-               else  // message ID do not match
-               {
-                  UINT32 elapsedTime = (UINT32)(GetCurrentTimeMs() - startTime);
-                  if (elapsedTime < remainingWaitTime)
-                  {
-                     remainingWaitTime -= elapsedTime;
-                     goto retry_wait;
-                  }
-                  rc = SNMP_ERR_TIMEOUT;
-               }
+               bool resend;
+               rc = processResponse(request, *response, &timeSyncRetries, &resend);
+               if (resend)
+                  goto retry;
+               break;
             }
-            else  // not SNMPv3
+
+            UINT32 elapsedTime = (UINT32)(GetCurrentTimeMs() - startTime);
+            if (elapsedTime < remainingWaitTime)
             {
-               if ((*response)->getRequestId() == request->getRequestId())
-                  break;
-
-               UINT32 elapsedTime = (UINT32)(GetCurrentTimeMs() - startTime);
-               if (elapsedTime < remainingWaitTime)
-               {
-                  remainingWaitTime -= elapsedTime;
-                  goto retry_wait;
-               }
-               rc = SNMP_ERR_TIMEOUT;
+               remainingWaitTime -= elapsedTime;
+               goto retry_wait;
             }
+            rc = SNMP_ERR_TIMEOUT;
          }
          else
          {
@@ -290,7 +306,10 @@ UINT32 SNMP_UDPTransport::createUDPTransport(const TCHAR *hostName, UINT16 port)
 }
 
 /**
- * Create SNMP_UDPTransport transport connected to given host
+ * Create SNMP_UDPTransport transport connected to given host. If default
+ * asynchronous engine is running own socket will not be created - requests
+ * will be sent via engine's shared sockets, and socket will be created on
+ * first direct use of transport.
  */
 UINT32 SNMP_UDPTransport::createUDPTransport(const InetAddress& hostAddr, UINT16 port)
 {
@@ -299,54 +318,75 @@ UINT32 SNMP_UDPTransport::createUDPTransport(const InetAddress& hostAddr, UINT16
 
    m_port = port;
    hostAddr.fillSockAddr(&m_peerAddr, port);
+   m_connected = true;
 
-   UINT32 dwResult;
+   SNMP_AsyncEngine *engine = SnmpGetDefaultAsyncEngine();
+   if ((engine != NULL) && engine->isTransportSupported(this))
+      return SNMP_ERR_SUCCESS;
 
-   // Create and connect socket
-   m_hSocket = CreateSocket(hostAddr.getFamily(), SOCK_DGRAM, 0);
-   if (m_hSocket != INVALID_SOCKET)
+   if (!createSocket())
    {
-      SockAddrBuffer localAddr;
+      m_connected = false;
+      return SNMP_ERR_SOCKET;
+   }
+   return SNMP_ERR_SUCCESS;
+}
 
-		memset(&localAddr, 0, sizeof(SockAddrBuffer));
-      if (hostAddr.getFamily() == AF_INET)
-      {
-		   localAddr.sa4.sin_family = AF_INET;
-		   localAddr.sa4.sin_addr.s_addr = htonl(INADDR_ANY);
-      }
-#ifdef WITH_IPV6
-      else
-      {
-		   localAddr.sa6.sin6_family = AF_INET6;
-      }
-#endif
+/**
+ * Create socket for connected transport
+ */
+bool SNMP_UDPTransport::createSocket()
+{
+   m_hSocket = CreateSocket(((struct sockaddr *)&m_peerAddr)->sa_family, SOCK_DGRAM, 0);
+   if (m_hSocket == INVALID_SOCKET)
+   {
+      m_hSocket = -1;
+      return false;
+   }
 
-      // We use bind() and later sendto() instead of connect()
-		// to handle cases with some strange devices responding to SNMP
-		// requests from random port insted of 161 where request was sent
-		// (currently only one such device known is AS/400)
-      if (bind(m_hSocket, (struct sockaddr *)&localAddr, SA_LEN((struct sockaddr *)&localAddr)) == 0)
-      {
-			// Set non-blocking mode
-#ifdef _WIN32
-			u_long one = 1;
-			ioctlsocket(m_hSocket, FIONBIO, &one);
-#endif
-			m_connected = true;
-         dwResult = SNMP_ERR_SUCCESS;
-      }
-      else
-      {
-         closesocket(m_hSocket);
-         m_hSocket = -1;
-         dwResult = SNMP_ERR_SOCKET;
-      }
+   SockAddrBuffer localAddr;
+   memset(&localAddr, 0, sizeof(SockAddrBuffer));
+   if (((struct sockaddr *)&m_peerAddr)->sa_family == AF_INET)
+   {
+      localAddr.sa4.sin_family = AF_INET;
+      localAddr.sa4.sin_addr.s_addr = htonl(INADDR_ANY);
    }
+#ifdef WITH_IPV6
    else
    {
-      dwResult = SNMP_ERR_SOCKET;
+      localAddr.sa6.sin6_family = AF_INET6;
    }
-   return dwResult;
+#endif
+
+   // We use bind() and later sendto() instead of connect()
+   // to handle cases with some strange devices responding to SNMP
+   // requests from random port insted of 161 where request was sent
+   // (currently only one such device known is AS/400)
+   if (bind(m_hSocket, (struct sockaddr *)&localAddr, SA_LEN((struct sockaddr *)&localAddr)) != 0)
+   {
+      closesocket(m_hSocket);
+      m_hSocket = -1;
+      return false;
+   }
+
+   // Set non-blocking mode
+#ifdef _WIN32
+   u_long one = 1;
+   ioctlsocket(m_hSocket, FIONBIO, &one);
+#endif
+   return true;
+}
+
+/**
+ * Get peer socket address. Only connected transports which do not update peer address
+ * on receive can be served by asynchronous engine.
+ */
+bool SNMP_UDPTransport::getPeerSocketAddress(SockAddrBuffer *addr)
+{
+   if (!m_connected || m_updatePeerOnRecv)
+      return false;
+   memcpy(addr, &m_peerAddr, sizeof(SockAddrBuffer));
+   return true;
 }
 
 #undef HOSTNAME_VAR
@@ -377,6 +417,9 @@ int SNMP_UDPTransport::recvData(UINT32 dwTimeout, struct sockaddr *pSender, sock
 {
    SockAddrBuffer srcAddrBuffer;
 
+   if (m_hSocket == -1)
+      return -1;
+
 retry_wait:
    if (dwTimeout != INFINITE)
    {
@@ -507,6 +550,9 @@ int SNMP_UDPTransport::readMessage(SNMP_PDU **ppData, UINT32 dwTimeout,
  */
 int SNMP_UDPTransport::sendMessage(SNMP_PDU *pdu, UINT32 timeout)
 {
+   if ((m_hSocket == -1) && (!m_connected || !createSocket()))
+      return -1;
+
    int bytes = 0;
    BYTE *buffer;
    size_t size = pdu->encode(&buffer, m_securityContext);
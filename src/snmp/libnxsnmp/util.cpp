@@ -56,6 +56,118 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpGetDefaultTimeout()
    return s_snmpTimeout;
 }
 
+/**
+ * Bulk walk options
+ */
+static bool s_bulkWalkEnabled = true;
+static UINT32 s_bulkMaxRepetitions = 64;
+
+/**
+ * Initial number of repetitions for agents without known capabilities
+ */
+#define BULK_INITIAL_REPETITIONS          10
+
+/**
+ * Desired size of GETBULK response (chosen to fit into single datagram on typical network)
+ */
+#define BULK_TARGET_RESPONSE_SIZE         1400
+
+/**
+ * Interval (in seconds) after which agent previously failed to process GETBULK is checked again
+ */
+#define BULK_CAPABILITY_RECHECK_INTERVAL  3600
+
+/**
+ * GETBULK capabilities of SNMP agent
+ */
+struct BulkWalkCapabilities
+{
+   bool supported;         // false if agent failed to process GETBULK request
+   bool confirmed;         // true if agent had successfully processed GETBULK request
+   UINT32 maxRepetitions;  // Last used number of repetitions
+   UINT32 repetitionLimit; // Number of repetitions agent can handle (lowered on "too big" errors and on timeouts fixed by smaller request)
+   time_t timestamp;
+};
+
+/**
+ * Known agent capabilities (indexed by agent address and port)
+ */
+static StringObjectMap<BulkWalkCapabilities> s_bulkCapabilities(Ownership::True);
+static Mutex s_bulkCapabilitiesLock;
+
+/**
+ * Set options for bulk walk
+ */
+void LIBNXSNMP_EXPORTABLE SnmpSetBulkWalkOptions(bool enabled, UINT32 maxRepetitions)
+{
+   s_bulkWalkEnabled = enabled;
+   s_bulkMaxRepetitions = std::max(maxRepetitions, static_cast<UINT32>(1));
+}
+
+/**
+ * Forget all learned GETBULK capabilities of agents
+ */
+void LIBNXSNMP_EXPORTABLE SnmpResetBulkWalkCapabilities()
+{
+   s_bulkCapabilitiesLock.lock();
+   s_bulkCapabilities.clear();
+   s_bulkCapabilitiesLock.unlock();
+}
+
+/**
+ * Build capability cache key for given transport
+ */
+static TCHAR *BulkCapabilitiesKey(SNMP_Transport *transport, TCHAR *key)
+{
+   transport->getPeerIpAddress().toString(key);
+   size_t len = _tcslen(key);
+   _sntprintf(&key[len], 64 - len, _T(":%u"), transport->getPort());
+   return key;
+}
+
+/**
+ * Get known GETBULK capabilities for agent. Returns false if agent is known
+ * to not support GETBULK requests.
+ */
+static bool GetBulkCapabilities(SNMP_Transport *transport, BulkWalkCapabilities *caps)
+{
+   TCHAR key[64];
+   BulkCapabilitiesKey(transport, key);
+
+   s_bulkCapabilitiesLock.lock();
+   BulkWalkCapabilities *c = s_bulkCapabilities.get(key);
+   if ((c != NULL) && (c->supported || (time(NULL) - c->timestamp < BULK_CAPABILITY_RECHECK_INTERVAL)))
+   {
+      memcpy(caps, c, sizeof(BulkWalkCapabilities));
+   }
+   else
+   {
+      caps->supported = true;
+      caps->confirmed = false;
+      caps->maxRepetitions = std::min(static_cast<UINT32>(BULK_INITIAL_REPETITIONS), s_bulkMaxRepetitions);
+      caps->repetitionLimit = s_bulkMaxRepetitions;
+      caps->timestamp = time(NULL);
+   }
+   s_bulkCapabilitiesLock.unlock();
+   return caps->supported;
+}
+
+/**
+ * Update known GETBULK capabilities for agent
+ */
+static void UpdateBulkCapabilities(SNMP_Transport *transport, const BulkWalkCapabilities *caps)
+{
+   TCHAR key[64];
+   BulkCapabilitiesKey(transport, key);
+
+   BulkWalkCapabilities *c = MemCopyBlock(caps, sizeof(BulkWalkCapabilities));
+   c->timestamp = time(NULL);
+
+   s_bulkCapabilitiesLock.lock();
+   s_bulkCapabilities.set(key, c);
+   s_bulkCapabilitiesLock.unlock();
+}
+
 /**
  * Get value for SNMP variable
  * If szOidStr is not NULL, string representation of OID is used, otherwise -
@@ -255,7 +367,10 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const TCHAR *roo
 }
 
 /**
- * Enumerate multiple values by walking through MIB, starting at given root
+ * Enumerate multiple values by walking through MIB, starting at given root.
+ * GETBULK requests are used for SNMPv2c and SNMPv3 agents, with number of
+ * repetitions adapted to response size. Agents which reject GETBULK requests
+ * with error response are remembered and walked with GETNEXT requests.
  */
 UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const UINT32 *rootOid, size_t rootOidLen,
                                      UINT32 (* handler)(SNMP_Variable *, SNMP_Transport *, void *),
@@ -269,12 +384,19 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const UINT32 *ro
    memcpy(pdwName, rootOid, rootOidLen * sizeof(UINT32));
    size_t nameLength = rootOidLen;
 
+   BulkWalkCapabilities caps;
+   memset(&caps, 0, sizeof(caps));
+   bool useBulk = s_bulkWalkEnabled && (transport->getSnmpVersion() != SNMP_VERSION_1) && GetBulkCapabilities(transport, &caps);
+   bool capsChanged = false;
+   bool bulkFailed = false;   // Set if GETBULK request failed and walk switched to GETNEXT
+   UINT32 timedOutRepetitions = 0;  // Number of repetitions in timed out request being retried with smaller size
+
    // Walk the MIB
    UINT32 dwResult;
-   BOOL bRunning = TRUE;
+   bool running = true;
    UINT32 firstObjectName[MAX_OID_LEN];
    size_t firstObjectNameLen = 0;
-   while(bRunning)
+   while(running)
    {
       if (failOnShutdown && IsShutdownInProgress())
       {
@@ -282,54 +404,141 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const UINT32 *ro
          break;
       }
 
-      SNMP_PDU *pRqPDU = new SNMP_PDU(SNMP_GET_NEXT_REQUEST, (UINT32)InterlockedIncrement(&s_requestId) & 0x7FFFFFFF, transport->getSnmpVersion());
+      SNMP_PDU *pRqPDU = new SNMP_PDU(useBulk ? SNMP_GET_BULK_REQUEST : SNMP_GET_NEXT_REQUEST,
+               (UINT32)InterlockedIncrement(&s_requestId) & 0x7FFFFFFF, transport->getSnmpVersion());
+      if (useBulk)
+      {
+         pRqPDU->setNonRepeaters(0);
+         pRqPDU->setMaxRepetitions(caps.maxRepetitions);
+      }
       pRqPDU->bindVariable(new SNMP_Variable(pdwName, nameLength));
 	   SNMP_PDU *pRespPDU;
       dwResult = transport->doRequest(pRqPDU, &pRespPDU, s_snmpTimeout, 3);
 
+      if (useBulk)
+      {
+         UINT32 errorCode = (dwResult == SNMP_ERR_SUCCESS) ? pRespPDU->getErrorCode() : SNMP_PDU_ERR_SUCCESS;
+         bool retry = false;
+         if ((errorCode == SNMP_PDU_ERR_TOO_BIG) && (caps.maxRepetitions > 1))
+         {
+            // Response does not fit into agent's message size limit
+            caps.repetitionLimit = caps.maxRepetitions - 1;
+            caps.maxRepetitions /= 2;
+            retry = true;
+         }
+         else if (!caps.confirmed && (dwResult == SNMP_ERR_SUCCESS) &&
+                  (((errorCode != SNMP_PDU_ERR_SUCCESS) && (errorCode != SNMP_PDU_ERR_NO_SUCH_NAME)) || (pRespPDU->getNumVariables() == 0)))
+         {
+            // Agent never processed GETBULK request successfully and rejected it, retry with GETNEXT.
+            // Timeouts are not considered as rejection - agent may be just unreachable.
+            nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 6, _T("SnmpWalk: GETBULK request failed (error %u, PDU error %u), switching to GETNEXT"), dwResult, errorCode);
+            useBulk = false;
+            bulkFailed = true;
+            retry = true;
+         }
+         else if ((dwResult == SNMP_ERR_TIMEOUT) && (caps.maxRepetitions > 1) && (timedOutRepetitions == 0))
+         {
+            // Large responses may be lost on the way (fragmentation, message size limits on agent).
+            // Retry once with smaller request, limit is lowered only if smaller request succeeds.
+            nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 6, _T("SnmpWalk: GETBULK request with %u repetitions timed out, retrying with %u"),
+                     caps.maxRepetitions, caps.maxRepetitions / 2);
+            timedOutRepetitions = caps.maxRepetitions;
+            caps.maxRepetitions /= 2;
+            delete pRespPDU;
+            delete pRqPDU;
+            continue;
+         }
+
+         if (retry)
+         {
+            capsChanged = true;
+            delete pRespPDU;
+            delete pRqPDU;
+            continue;
+         }
+      }
+
       // Analyze response
       if (dwResult == SNMP_ERR_SUCCESS)
       {
          if ((pRespPDU->getNumVariables() > 0) &&
              (pRespPDU->getErrorCode() == SNMP_PDU_ERR_SUCCESS))
          {
-            SNMP_Variable *pVar = pRespPDU->getVariable(0);
+            if (useBulk && !caps.confirmed)
+            {
+               caps.confirmed = true;
+               capsChanged = true;
+            }
+            else if (bulkFailed && caps.supported)
+            {
+               // Agent responds to GETNEXT but not to GETBULK
+               nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 5, _T("SnmpWalk: agent at %s does not support GETBULK requests"),
+                        (const TCHAR *)transport->getPeerIpAddress().toString());
+               caps.supported = false;
+               capsChanged = true;
+            }
 
-            if ((pVar->getType() != ASN_NO_SUCH_OBJECT) &&
-                (pVar->getType() != ASN_NO_SUCH_INSTANCE) &&
-                (pVar->getType() != ASN_END_OF_MIBVIEW))
+            if (useBulk && (timedOutRepetitions != 0))
+            {
+               // Smaller request succeeded after timeout, do not go above this size
+               caps.repetitionLimit = caps.maxRepetitions;
+               capsChanged = true;
+               timedOutRepetitions = 0;
+            }
+
+            size_t responseSize = 0;
+            int numVariables = pRespPDU->getNumVariables();
+            for(int i = 0; (i < numVariables) && running; i++)
             {
+               SNMP_Variable *pVar = pRespPDU->getVariable(i);
+               if ((pVar->getType() == ASN_NO_SUCH_OBJECT) ||
+                   (pVar->getType() == ASN_NO_SUCH_INSTANCE) ||
+                   (pVar->getType() == ASN_END_OF_MIBVIEW))
+               {
+                  // Consider no object/no instance as end of walk signal instead of failure
+                  running = false;
+                  break;
+               }
+
                // Should we stop walking?
-					// Some buggy SNMP agents may return first value after last one
-					// (Toshiba Strata CTX do that for example), so last check is here
+               // Some buggy SNMP agents may return first value after last one
+               // (Toshiba Strata CTX do that for example), so last check is here
                if ((pVar->getName().length() < rootOidLen) ||
                    (memcmp(rootOid, pVar->getName().value(), rootOidLen * sizeof(UINT32))) ||
-						 (pVar->getName().compare(pdwName, nameLength) == OID_EQUAL) ||
-						 (pVar->getName().compare(firstObjectName, firstObjectNameLen) == OID_EQUAL))
+                   (pVar->getName().compare(pdwName, nameLength) == OID_EQUAL) ||
+                   (pVar->getName().compare(firstObjectName, firstObjectNameLen) == OID_EQUAL))
                {
-                  delete pRespPDU;
-                  delete pRqPDU;
+                  running = false;
                   break;
                }
                nameLength = pVar->getName().length();
                memcpy(pdwName, pVar->getName().value(), nameLength * sizeof(UINT32));
-					if (firstObjectNameLen == 0)
-					{
-						firstObjectNameLen = nameLength;
-						memcpy(firstObjectName, pdwName, nameLength * sizeof(UINT32));
-					}
+               if (firstObjectNameLen == 0)
+               {
+                  firstObjectNameLen = nameLength;
+                  memcpy(firstObjectName, pdwName, nameLength * sizeof(UINT32));
+               }
+               responseSize += nameLength + pVar->getValueLength() + 8;  // Approximate encoded size of variable binding
 
                // Call user's callback function for processing
                dwResult = handler(pVar, transport, userArg);
                if (dwResult != SNMP_ERR_SUCCESS)
                {
-                  bRunning = FALSE;
+                  running = false;
                }
             }
-            else
+
+            if (useBulk && running)
             {
-               // Consider no object/no instance as end of walk signal instead of failure
-               bRunning = FALSE;
+               // Adjust number of repetitions so that response will be close to desired size
+               UINT32 varSize = std::max(static_cast<UINT32>(responseSize / numVariables), static_cast<UINT32>(1));
+               UINT32 repetitions = std::min(BULK_TARGET_RESPONSE_SIZE / varSize, caps.maxRepetitions * 2);
+               repetitions = std::max(std::min(repetitions, std::min(caps.repetitionLimit, s_bulkMaxRepetitions)), static_cast<UINT32>(1));
+               if (repetitions != caps.maxRepetitions)
+               {
+                  caps.maxRepetitions = repetitions;
+                  capsChanged = true;
+               }
             }
          }
          else
@@ -337,17 +546,20 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const UINT32 *ro
             // Some SNMP agents sends NO_SUCH_NAME PDU error after last element in MIB
             if (pRespPDU->getErrorCode() != SNMP_PDU_ERR_NO_SUCH_NAME)
                dwResult = SNMP_ERR_AGENT;
-            bRunning = FALSE;
+            running = false;
          }
          delete pRespPDU;
       }
       else
       {
          nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 7, _T("Error %u processing SNMP GET request"), dwResult);
-         bRunning = FALSE;
+         running = false;
       }
       delete pRqPDU;
    }
+
+   if (capsChanged)
+      UpdateBulkCapabilities(transport, &caps);
    return dwResult;
 }
 
@@ -381,3 +593,333 @@ int LIBNXSNMP_EXPORTABLE SnmpWalkCount(SNMP_Transport *transport, const TCHAR *r
       return -1;
    return count;
 }
+
+/**
+ * State of single column in multi-column walk
+ */
+struct ColumnWalkState
+{
+   const SNMP_ObjectId *root;
+   SNMP_ObjectId last;
+   bool done;
+};
+
+/**
+ * Walk multiple independent columns (subtrees) at once. Each request carries one variable binding
+ * per active column, so table with N columns is retrieved with roughly N times less round trips
+ * than walking columns one by one. Each column stops independently when agent returns object
+ * outside of column's subtree. GETBULK requests are used for SNMPv2c and SNMPv3 agents in same
+ * way as in SnmpWalk.
+ *
+ * @param transport SNMP transport
+ * @param columns list of column root OIDs (should not overlap)
+ * @param results array of columns->size() elements; on success each element will be set to list
+ *                of values for corresponding column (should be destroyed by caller)
+ * @param failOnShutdown if true, walk will be aborted when process shutdown is initiated
+ * @return SNMP error code
+ */
+UINT32 LIBNXSNMP_EXPORTABLE SnmpWalkColumns(SNMP_Transport *transport, const ObjectArray<SNMP_ObjectId> *columns,
+                                            ObjectArray<SNMP_Variable> **results, bool failOnShutdown)
+{
+   int numColumns = columns->size();
+   for(int i = 0; i < numColumns; i++)
+      results[i] = NULL;
+
+   if (transport == NULL)
+      return SNMP_ERR_COMM;
+   if (numColumns == 0)
+      return SNMP_ERR_PARAM;
+
+   ColumnWalkState *state = new ColumnWalkState[numColumns];
+   for(int i = 0; i < numColumns; i++)
+   {
+      state[i].root = columns->get(i);
+      state[i].last = *state[i].root;
+      state[i].done = false;
+      results[i] = new ObjectArray<SNMP_Variable>(64, 64, Ownership::True);
+   }
+   int *batch = MemAllocArrayNoInit<int>(numColumns);
+   int maxColumns = numColumns;   // Maximum number of columns in single request (lowered when agent cannot fit response into message)
+
+   BulkWalkCapabilities caps;
+   memset(&caps, 0, sizeof(caps));
+   bool useBulk = s_bulkWalkEnabled && (transport->getSnmpVersion() != SNMP_VERSION_1) && GetBulkCapabilities(transport, &caps);
+   bool capsChanged = false;
+   bool bulkFailed = false;
+   UINT32 timedOutRepetitions = 0;  // Number of repetitions in timed out request being retried with smaller size
+
+   UINT32 rc = SNMP_ERR_SUCCESS;
+   while(true)
+   {
+      if (failOnShutdown && IsShutdownInProgress())
+      {
+         rc = SNMP_ERR_ABORTED;
+         break;
+      }
+
+      int batchSize = 0;
+      for(int i = 0; (i < numColumns) && (batchSize < maxColumns); i++)
+      {
+         if (!state[i].done)
+            batch[batchSize++] = i;
+      }
+      if (batchSize == 0)
+         break;
+
+      UINT32 repetitions = useBulk ? std::max(caps.maxRepetitions / batchSize, static_cast<UINT32>(1)) : 1;
+      SNMP_PDU *request = new SNMP_PDU(useBulk ? SNMP_GET_BULK_REQUEST : SNMP_GET_NEXT_REQUEST,
+               (UINT32)InterlockedIncrement(&s_requestId) & 0x7FFFFFFF, transport->getSnmpVersion());
+      if (useBulk)
+      {
+         request->setNonRepeaters(0);
+         request->setMaxRepetitions(repetitions);
+      }
+      for(int i = 0; i < batchSize; i++)
+         request->bindVariable(new SNMP_Variable(state[batch[i]].last));
+
+      SNMP_PDU *response;
+      rc = transport->doRequest(request, &response, s_snmpTimeout, 3);
+      delete request;
+
+      UINT32 errorCode = (rc == SNMP_ERR_SUCCESS) ? response->getErrorCode() : SNMP_PDU_ERR_SUCCESS;
+      if (errorCode == SNMP_PDU_ERR_TOO_BIG)
+      {
+         delete response;
+         if (repetitions > 1)
+         {
+            caps.repetitionLimit = caps.maxRepetitions - 1;
+            caps.maxRepetitions /= 2;
+            capsChanged = true;
+            continue;
+         }
+         if (batchSize > 1)
+         {
+            maxColumns = batchSize / 2;
+            continue;
+         }
+         rc = SNMP_ERR_AGENT;
+         break;
+      }
+
+      if (useBulk)
+      {
+         if (!caps.confirmed && (rc == SNMP_ERR_SUCCESS) &&
+             (((errorCode != SNMP_PDU_ERR_SUCCESS) && (errorCode != SNMP_PDU_ERR_NO_SUCH_NAME)) || (response->getNumVariables() == 0)))
+         {
+            // Agent rejected GETBULK request, retry with GETNEXT
+            nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 6, _T("SnmpWalkColumns: GETBULK request failed (error %u, PDU error %u), switching to GETNEXT"), rc, errorCode);
+            delete response;
+            useBulk = false;
+            bulkFailed = true;
+            capsChanged = true;
+            continue;
+         }
+         if ((rc == SNMP_ERR_TIMEOUT) && (caps.maxRepetitions > 1) && (timedOutRepetitions == 0))
+         {
+            // Retry once with smaller request, limit is lowered only if smaller request succeeds
+            nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 6, _T("SnmpWalkColumns: GETBULK request with %u repetitions timed out, retrying with %u"),
+                     caps.maxRepetitions, caps.maxRepetitions / 2);
+            timedOutRepetitions = caps.maxRepetitions;
+            caps.maxRepetitions /= 2;
+            continue;
+         }
+      }
+
+      if (rc != SNMP_ERR_SUCCESS)
+      {
+         nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 7, _T("SnmpWalkColumns: error %u processing SNMP request"), rc);
+         break;
+      }
+
+      if (errorCode == SNMP_PDU_ERR_NO_SUCH_NAME)
+      {
+         // SNMPv1 agents report end of MIB with error pointing to variable binding of finished column
+         int errorIndex = (int)response->getErrorIndex();
+         if ((errorIndex >= 1) && (errorIndex <= batchSize))
+         {
+            state[batch[errorIndex - 1]].done = true;
+         }
+         else
+         {
+            for(int i = 0; i < batchSize; i++)
+               state[batch[i]].done = true;
+         }
+         delete response;
+         continue;
+      }
+
+      if ((errorCode != SNMP_PDU_ERR_SUCCESS) || (response->getNumVariables() == 0))
+      {
+         delete response;
+         rc = SNMP_ERR_AGENT;
+         break;
+      }
+
+      if (useBulk && !caps.confirmed)
+      {
+         caps.confirmed = true;
+         capsChanged = true;
+      }
+      else if (bulkFailed && caps.supported)
+      {
+         nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 5, _T("SnmpWalkColumns: agent at %s does not support GETBULK requests"),
+                  (const TCHAR *)transport->getPeerIpAddress().toString());
+         caps.supported = false;
+         capsChanged = true;
+      }
+
+      if (useBulk && (timedOutRepetitions != 0))
+      {
+         // Smaller request succeeded after timeout, do not go above this size
+         caps.repetitionLimit = caps.maxRepetitions;
+         capsChanged = true;
+         timedOutRepetitions = 0;
+      }
+
+      // Variable bindings in response are ordered by repetition, then by column
+      size_t responseSize = 0;
+      int numVariables = response->getNumVariables();
+      for(int i = 0; i < numVariables; i++)
+      {
+         int column = batch[i % batchSize];
+         ColumnWalkState *s = &state[column];
+         if (s->done)
+            continue;
+
+         SNMP_Variable *v = response->getVariable(i);
+         const SNMP_ObjectId& name = v->getName();
+         int order = name.compare(s->last);
+         if ((v->getType() == ASN_NO_SUCH_OBJECT) || (v->getType() == ASN_NO_SUCH_INSTANCE) ||
+             (v->getType() == ASN_END_OF_MIBVIEW) ||
+             (name.length() <= s->root->length()) ||
+             memcmp(name.value(), s->root->value(), s->root->length() * sizeof(UINT32)) ||
+             ((order != OID_FOLLOWING) && (order != OID_LONGER)))
+         {
+            s->done = true;
+            continue;
+         }
+
+         s->last = name;
+         responseSize += name.length() + v->getValueLength() + 8;
+         results[column]->add(new SNMP_Variable(v));
+      }
+
+      if (useBulk)
+      {
+         UINT32 varSize = std::max(static_cast<UINT32>(responseSize / numVariables), static_cast<UINT32>(1));
+         UINT32 maxRepetitions = std::min(BULK_TARGET_RESPONSE_SIZE / varSize, caps.maxRepetitions * 2);
+         maxRepetitions = std::max(std::min(maxRepetitions, std::min(caps.repetitionLimit, s_bulkMaxRepetitions)), static_cast<UINT32>(1));
+         if (maxRepetitions != caps.maxRepetitions)
+         {
+            caps.maxRepetitions = maxRepetitions;
+            capsChanged = true;
+         }
+      }
+      delete response;
+   }
+
+   if (capsChanged)
+      UpdateBulkCapabilities(transport, &caps);
+
+   delete[] state;
+   MemFree(batch);
+
+   if (rc != SNMP_ERR_SUCCESS)
+   {
+      for(int i = 0; i < numColumns; i++)
+         delete_and_null(results[i]);
+   }
+   return rc;
+}
+
+/**
+ * Compare table row indexes
+ */
+static inline int CompareRowIndex(const UINT32 *i1, size_t l1, const UINT32 *i2, size_t l2)
+{
+   size_t len = std::min(l1, l2);
+   for(size_t i = 0; i < len; i++)
+   {
+      if (i1[i] != i2[i])
+         return (i1[i] < i2[i]) ? -1 : 1;
+   }
+   return (l1 == l2) ? 0 : ((l1 < l2) ? -1 : 1);
+}
+
+/**
+ * Walk table columns and assemble rows by index (OID suffix after column root). Handler is
+ * called once for each row, in index order, with array of values for each column (NULL if
+ * row has no value in particular column). Values are owned by walker and are valid only
+ * during handler call.
+ *
+ * @param transport SNMP transport
+ * @param columns list of column root OIDs (should not overlap)
+ * @param handler row handler
+ * @param userArg user argument for handler
+ * @param failOnShutdown if true, walk will be aborted when process shutdown is initiated
+ * @return SNMP error code
+ */
+UINT32 LIBNXSNMP_EXPORTABLE SnmpWalkTable(SNMP_Transport *transport, const ObjectArray<SNMP_ObjectId> *columns,
+                                          UINT32 (*handler)(SNMP_Variable **, const UINT32 *, size_t, SNMP_Transport *, void *),
+                                          void *userArg, bool failOnShutdown)
+{
+   int numColumns = columns->size();
+   if (numColumns == 0)
+      return SNMP_ERR_PARAM;
+
+   ObjectArray<SNMP_Variable> **results = MemAllocArrayNoInit<ObjectArray<SNMP_Variable>*>(numColumns);
+   UINT32 rc = SnmpWalkColumns(transport, columns, results, failOnShutdown);
+   if (rc == SNMP_ERR_SUCCESS)
+   {
+      int *pos = MemAllocArray<int>(numColumns);
+      SNMP_Variable **row = MemAllocArrayNoInit<SNMP_Variable*>(numColumns);
+      while(true)
+      {
+         // Find smallest index among current positions in each column
+         const UINT32 *index = NULL;
+         size_t indexLen = 0;
+         for(int i = 0; i < numColumns; i++)
+         {
+            SNMP_Variable *v = results[i]->get(pos[i]);
+            if (v == NULL)
+               continue;
+            size_t rootLen = columns->get(i)->length();
+            const UINT32 *vindex = v->getName().value() + rootLen;
+            size_t vindexLen = v->getName().length() - rootLen;
+            if ((index == NULL) || (CompareRowIndex(vindex, vindexLen, index, indexLen) < 0))
+            {
+               index = vindex;
+               indexLen = vindexLen;
+            }
+         }
+         if (index == NULL)
+            break;
+
+         for(int i = 0; i < numColumns; i++)
+         {
+            SNMP_Variable *v = results[i]->get(pos[i]);
+            size_t rootLen = columns->get(i)->length();
+            if ((v != NULL) && (CompareRowIndex(v->getName().value() + rootLen, v->getName().length() - rootLen, index, indexLen) == 0))
+            {
+               row[i] = v;
+               pos[i]++;
+            }
+            else
+            {
+               row[i] = NULL;
+            }
+         }
+
+         rc = handler(row, index, indexLen, transport, userArg);
+         if (rc != SNMP_ERR_SUCCESS)
+            break;
+      }
+      MemFree(pos);
+      MemFree(row);
+
+      for(int i = 0; i < numColumns; i++)
+         delete results[i];
+   }
+   MemFree(results);
+   return rc;
+}
@@ -47,6 +47,7 @@ int ParseMIBFiles(StringList *fileList, SNMP_MIBObject **ppRoot);
  * Static data
  */
 static char m_szOutFile[MAX_PATH] = "netxms.mib";
+static char s_indexFile[MAX_PATH] = "";
 static StringList s_fileList;
 static bool s_pauseBeforeExit = false;
 
@@ -120,6 +121,7 @@ static void Help()
 		      _T("   -o <file> : Set output file name (default is netxms.mib)\n")
 		      _T("   -P        : Pause before exit\n")
 		      _T("   -s        : Strip descriptions from MIB objects\n")
+		      _T("   -x <file> : Also write indexed (memory mappable) MIB file\n")
 		      _T("   -z        : Compress output file\n")
 		      _T("\n"));
    exit(0);
@@ -198,7 +200,7 @@ int main(int argc, char *argv[])
 
    // Parse command line
    opterr = 1;
-   while((ch = getopt(argc, argv, "rd:ho:e:Psz")) != -1)
+   while((ch = getopt(argc, argv, "rd:ho:e:Pszx:")) != -1)
    {
       switch(ch)
       {
@@ -241,6 +243,10 @@ int main(int argc, char *argv[])
          case 's':
             dwFlags |= SMT_SKIP_DESCRIPTIONS;
             break;
+         case 'x':
+            strncpy(s_indexFile, optarg, MAX_PATH);
+            s_indexFile[MAX_PATH - 1] = 0;
+            break;
          case 'z':
             dwFlags |= SMT_COMPRESS_DATA;
             break;
@@ -281,12 +287,28 @@ int main(int argc, char *argv[])
 #else
          dwRet = SNMPSaveMIBTree(m_szOutFile, pRoot, dwFlags);
 #endif
-         delete pRoot;
          if (dwRet != SNMP_ERR_SUCCESS)
          {
             _tprintf(_T("ERROR: Cannot save output file %hs (%s)\n"), m_szOutFile, SNMPGetErrorText(dwRet));
             rc = 1;
          }
+
+         if (s_indexFile[0] != 0)
+         {
+#ifdef UNICODE
+            WCHAR *wname = WideStringFromMBString(s_indexFile);
+            dwRet = SNMPSaveIndexedMIBTree(wname, pRoot, dwFlags);
+            free(wname);
+#else
+            dwRet = SNMPSaveIndexedMIBTree(s_indexFile, pRoot, dwFlags);
+#endif
+            if (dwRet != SNMP_ERR_SUCCESS)
+            {
+               _tprintf(_T("ERROR: Cannot save indexed output file %hs (%s)\n"), s_indexFile, SNMPGetErrorText(dwRet));
+               rc = 1;
+            }
+         }
+         delete pRoot;
       }
    }
    else
@@ -70,6 +70,126 @@ void TestMemoryPool()
 
    delete pool;
    EndTest();
+
+   StartTest(_T("Memory pool - block reuse"));
+   pool = new MemoryPool(1024);
+   void *b1 = pool->allocate(40);
+   void *b2 = pool->allocate(100);
+   pool->free(b1, 40);
+   pool->free(b2, 100);
+   AssertEquals(pool->allocate(100), b2);
+   AssertEquals(pool->allocate(33), b1);  // same size class as 40 bytes
+   void *b3 = pool->allocate(40);
+   AssertNotEquals(b3, b1);
+   void *large = pool->allocate(600);
+   pool->free(large, 600);  // not reused
+   AssertNotEquals(pool->allocate(600), large);
+   object = pool->create<TestClass>();
+   pool->destroy(object);
+   AssertEquals(pool->create<TestClass>(), object);
+   pool->clear();
+   void *b4 = pool->allocate(40);
+   pool->free(b4, 40);
+   pool->clear();
+   AssertNotNull(pool->allocate(8));
+   delete pool;
+   EndTest();
+
+   StartTest(_T("Memory pool - scope"));
+   pool = new MemoryPool(256);
+   char *s1 = static_cast<char*>(pool->allocate(16));
+   char *s2;
+   {
+      MemoryPoolScope scope(pool);
+      s2 = static_cast<char*>(pool->allocate(16));
+      for(int i = 0; i < 100; i++)
+         memset(pool->allocate(64), 0xFF, 64);
+   }
+   AssertEquals(pool->allocate(16), s2);
+   {
+      MemoryPoolScope outer(pool);
+      char *p = static_cast<char*>(pool->allocate(8));
+      {
+         MemoryPoolScope inner(pool);
+         pool->allocate(1000);
+         pool->allocate(200);
+      }
+      AssertEquals(pool->allocate(8), p + 8);
+   }
+   AssertNotEquals(s1, s2);
+   delete pool;
+   EndTest();
+}
+
+/**
+ * Number of simulated requests and allocations per request in memory pool performance test
+ */
+#define MEMPOOL_PERF_REQUESTS    200000
+#define MEMPOOL_PERF_BLOCKS      20
+
+/**
+ * Test memory pool performance against system heap on request-like allocation pattern
+ */
+void TestMemoryPoolPerformance()
+{
+   void *blocks[MEMPOOL_PERF_BLOCKS];
+
+   StartTest(_T("Memory pool performance - system heap"));
+   INT64 start = GetCurrentTimeMs();
+   for(int i = 0; i < MEMPOOL_PERF_REQUESTS; i++)
+   {
+      for(int j = 0; j < MEMPOOL_PERF_BLOCKS; j++)
+      {
+         blocks[j] = MemAlloc(16 + j * 24);
+         *static_cast<int*>(blocks[j]) = j;
+      }
+      for(int j = 0; j < MEMPOOL_PERF_BLOCKS; j++)
+         MemFree(blocks[j]);
+   }
+   EndTest(GetCurrentTimeMs() - start);
+
+   StartTest(_T("Memory pool performance - pool per request"));
+   start = GetCurrentTimeMs();
+   for(int i = 0; i < MEMPOOL_PERF_REQUESTS; i++)
+   {
+      MemoryPool pool(4096);
+      for(int j = 0; j < MEMPOOL_PERF_BLOCKS; j++)
+      {
+         blocks[j] = pool.allocate(16 + j * 24);
+         *static_cast<int*>(blocks[j]) = j;
+      }
+   }
+   EndTest(GetCurrentTimeMs() - start);
+
+   StartTest(_T("Memory pool performance - scoped arena"));
+   MemoryPool *pool = new MemoryPool(4096);
+   start = GetCurrentTimeMs();
+   for(int i = 0; i < MEMPOOL_PERF_REQUESTS; i++)
+   {
+      MemoryPoolScope scope(pool);
+      for(int j = 0; j < MEMPOOL_PERF_BLOCKS; j++)
+      {
+         blocks[j] = pool->allocate(16 + j * 24);
+         *static_cast<int*>(blocks[j]) = j;
+      }
+   }
+   EndTest(GetCurrentTimeMs() - start);
+
+   StartTest(_T("Memory pool performance - free list reuse"));
+   start = GetCurrentTimeMs();
+   for(int i = 0; i < MEMPOOL_PERF_REQUESTS; i++)
+   {
+      for(int j = 0; j < MEMPOOL_PERF_BLOCKS; j++)
+      {
+         blocks[j] = pool->allocate(16 + j * 24);
+         *static_cast<int*>(blocks[j]) = j;
+      }
+      for(int j = 0; j < MEMPOOL_PERF_BLOCKS; j++)
+         pool->free(blocks[j], 16 + j * 24);
+   }
+   AssertTrue(pool->regionSize() == 4096);
+   EndTest(GetCurrentTimeMs() - start);
+   delete pool;
 }
 
 /**
@@ -37,6 +37,80 @@ static THREAD_RESULT THREAD_CALL PosterThread(void *arg)
    return THREAD_OK;
 }
 
+/**
+ * Number of waiter threads and messages per thread for message wait queue test
+ */
+#define MSGWQ_TEST_WAITERS    16
+#define MSGWQ_TEST_MESSAGES   100
+
+/**
+ * Waiter thread data
+ */
+struct WaiterThreadData
+{
+   MsgWaitQueue *queue;
+   UINT32 id;
+   int received;
+};
+
+/**
+ * Waiter thread
+ */
+static THREAD_RESULT THREAD_CALL WaiterThread(void *arg)
+{
+   WaiterThreadData *data = static_cast<WaiterThreadData*>(arg);
+   for(int i = 0; i < MSGWQ_TEST_MESSAGES; i++)
+   {
+      NXCPMessage *msg = data->queue->waitForMessage(CMD_REQUEST_COMPLETED, data->id, 5000);
+      if (msg == NULL)
+         break;
+      delete msg;
+      data->received++;
+   }
+   return THREAD_OK;
+}
+
+/**
+ * Number of pipelined requests for message wait queue test
+ */
+#define MSGWQ_TEST_PIPELINE   32
+
+/**
+ * Pipelined response poster thread - posts responses in reverse order with delays,
+ * skipping response for request with ID 1
+ */
+static THREAD_RESULT THREAD_CALL PipelinePosterThread(void *arg)
+{
+   for(UINT32 i = MSGWQ_TEST_PIPELINE; i > 1; i--)
+   {
+      if (i % 8 == 0)
+         ThreadSleepMs(50);
+      static_cast<MsgWaitQueue*>(arg)->put(new NXCPMessage(CMD_REQUEST_COMPLETED, i));
+   }
+   return THREAD_OK;
+}
+
+/**
+ * Wait for pipelined responses with single deadline for whole batch
+ */
+static int WaitForPipelinedResponses(MsgWaitQueue *queue, UINT32 firstId, UINT32 lastId, UINT32 timeout)
+{
+   int received = 0;
+   INT64 deadline = GetCurrentTimeMs() + timeout;
+   for(UINT32 id = firstId; id <= lastId; id++)
+   {
+      INT64 remaining = deadline - GetCurrentTimeMs();
+      NXCPMessage *msg = queue->waitForMessage(CMD_REQUEST_COMPLETED, id, (remaining > 0) ? static_cast<UINT32>(remaining) : 0);
+      if (msg != NULL)
+      {
+         if (msg->getId() == id)
+            received++;
+         delete msg;
+      }
+   }
+   return received;
+}
+
 /**
  * Test message wait queue
  */
@@ -56,8 +130,142 @@ void TestMsgWaitQueue()
    delete queue;
 
    EndTest();
+
+   StartTest(_T("Message wait queue - multiple waiters"));
+   queue = new MsgWaitQueue();
+   WaiterThreadData data[MSGWQ_TEST_WAITERS];
+   THREAD threads[MSGWQ_TEST_WAITERS];
+   for(int i = 0; i < MSGWQ_TEST_WAITERS; i++)
+   {
+      data[i].queue = queue;
+      data[i].id = i + 1;
+      data[i].received = 0;
+      threads[i] = ThreadCreateEx(WaiterThread, 0, &data[i]);
+   }
+   for(int n = 0; n < MSGWQ_TEST_MESSAGES; n++)
+   {
+      // Post messages in reverse order of waiter IDs
+      for(int i = MSGWQ_TEST_WAITERS; i > 0; i--)
+      {
+         NXCPMessage *m = new NXCPMessage(CMD_REQUEST_COMPLETED, i);
+         queue->put(m);
+      }
+   }
+   for(int i = 0; i < MSGWQ_TEST_WAITERS; i++)
+   {
+      ThreadJoin(threads[i]);
+      AssertEquals(data[i].received, MSGWQ_TEST_MESSAGES);
+   }
+   AssertNull(queue->waitForMessage(CMD_REQUEST_COMPLETED, 1, 0));
+   delete queue;
+   EndTest();
+
+   StartTest(_T("Message wait queue - pipelined responses"));
+   queue = new MsgWaitQueue();
+   THREAD poster = ThreadCreateEx(PipelinePosterThread, 0, queue);
+   AssertEquals(WaitForPipelinedResponses(queue, 2, MSGWQ_TEST_PIPELINE, 5000), MSGWQ_TEST_PIPELINE - 1);
+   ThreadJoin(poster);
+
+   // Missing response should not extend waiting time beyond batch deadline
+   poster = ThreadCreateEx(PipelinePosterThread, 0, queue);
+   INT64 batchStartTime = GetCurrentTimeMs();
+   AssertEquals(WaitForPipelinedResponses(queue, 1, MSGWQ_TEST_PIPELINE, 1000), MSGWQ_TEST_PIPELINE - 1);
+   AssertTrue(GetCurrentTimeMs() - batchStartTime < 1500);
+   ThreadJoin(poster);
+   delete queue;
+   EndTest();
+
+   StartTest(_T("Message wait queue - expiration"));
+   queue = new MsgWaitQueue();
+   queue->setHoldTime(300);
+   queue->put(new NXCPMessage(CMD_REQUEST_COMPLETED, 1));
+   queue->put(new NXCPMessage(CMD_REQUEST_COMPLETED, 2));
+   msg = queue->waitForMessage(CMD_REQUEST_COMPLETED, 2, 0);
+   AssertNotNull(msg);
+   delete msg;
+   ThreadSleepMs(1000);
+   AssertNull(queue->waitForMessage(CMD_REQUEST_COMPLETED, 1, 0));
+   queue->setHoldTime(30000);
+   queue->put(new NXCPMessage(CMD_REQUEST_COMPLETED, 3));
+   delete queue;   // Should cancel pending expiration timer
+   EndTest();
+
+   StartTest(_T("Message wait queue - performance"));
+   queue = new MsgWaitQueue();
+   INT64 startTime = GetCurrentTimeMs();
+   for(UINT32 n = 0; n < 100; n++)
+   {
+      for(UINT32 i = 1; i <= 1000; i++)
+         queue->put(new NXCPMessage(CMD_REQUEST_COMPLETED, n * 1000 + i));
+      for(UINT32 i = 1000; i > 0; i--)
+      {
+         msg = queue->waitForMessage(CMD_REQUEST_COMPLETED, n * 1000 + i, 0);
+         AssertNotNull(msg);
+         delete msg;
+      }
+   }
+   delete queue;
+   EndTest(GetCurrentTimeMs() - startTime);
+}
+
+#ifndef _WIN32
+
+/**
+ * Data for message sender thread
+ */
+struct MessageSenderData
+{
+   NXCPMessage *msg;
+   SOCKET socket;
+   NXCPEncryptionContext *ctx;
+   bool compress;
+   bool success;
+};
+
+/**
+ * Message sender thread
+ */
+static THREAD_RESULT THREAD_CALL MessageSender(void *arg)
+{
+   MessageSenderData *data = static_cast<MessageSenderData*>(arg);
+   data->success = data->msg->sendTo(data->socket, INVALID_MUTEX_HANDLE, data->ctx, data->compress);
+   return THREAD_OK;
 }
 
+/**
+ * Send message via socket pair using NXCPMessage::sendTo and read raw bytes from other end
+ */
+static BYTE *SendAndReceive(NXCPMessage *msg, SOCKET *sockets, NXCPEncryptionContext *ctx, bool compress, size_t expectedSize)
+{
+   MessageSenderData data;
+   data.msg = msg;
+   data.socket = sockets[0];
+   data.ctx = ctx;
+   data.compress = compress;
+   data.success = false;
+   THREAD thread = ThreadCreateEx(MessageSender, 0, &data);
+
+   BYTE *buffer = MemAllocArrayNoInit<BYTE>(expectedSize);
+   size_t bytes = 0;
+   while(bytes < expectedSize)
+   {
+      ssize_t rc = RecvEx(sockets[1], buffer + bytes, expectedSize - bytes, 0, 5000);
+      if (rc <= 0)
+         break;
+      bytes += rc;
+   }
+   ThreadJoin(thread);
+
+   if (!data.success || (bytes != expectedSize))
+   {
+      MemFree(buffer);
+      return NULL;
+   }
+   return buffer;
+}
+
+#endif
+
 /**
  * Test message class
  */
@@ -123,8 +331,206 @@ void TestMessageClass()
 
    EndTest();
 
+   StartTest(_T("NXCP message view"));
+   INT64 start;
+
+   NXCPMessage vmsg(CMD_REQUEST_COMPLETED, 17);
+   vmsg.setField(1, (UINT32)1234);
+   vmsg.setField(2, _T("test text"));
+   vmsg.setField(3, (UINT64)_ULL(1234567890123));
+   vmsg.setField(4, 3.5);
+   vmsg.setField(100, longText);
+   binMsg = vmsg.serialize(false);
+   AssertNotNull(binMsg);
+
+   NXCPMessage *view = NXCPMessage::createView(binMsg);
+   AssertNotNull(view);
+   AssertTrue(view->isView());
+   AssertFalse(view->isDetached());
+   AssertEquals(view->getCode(), CMD_REQUEST_COMPLETED);
+   AssertEquals(view->getId(), 17);
+   AssertEquals(view->getFieldAsUInt32(1), 1234);
+   AssertTrue(!safe_tcscmp(view->getFieldAsString(2, buffer, 64), _T("test text")));
+   AssertFalse(view->isFieldExist(5));
+
+   view->detach();
+   AssertTrue(view->isDetached());
+   memset(binMsg->fields, 0, ntohl(binMsg->size) - NXCP_HEADER_SIZE);
+   MemFree(binMsg);
+   AssertEquals(view->getFieldAsUInt32(1), 1234);
+   AssertEquals(view->getFieldAsUInt64(3), _ULL(1234567890123));
+   AssertEquals(view->getFieldAsDouble(4), 3.5);
+
+   // Serialized view should be identical to serialized original message
+   binMsg = view->serialize(false);
+   NXCPMessage *copy = NXCPMessage::deserialize(binMsg);
+   AssertNotNull(copy);
+   AssertTrue(!safe_tcscmp(copy->getFieldAsString(2, buffer, 64), _T("test text")));
+   longTextOut = copy->getFieldAsString(100);
+   AssertTrue(!_tcscmp(longTextOut, longText));
+   MemFree(longTextOut);
+   delete copy;
+   MemFree(binMsg);
+
+   // Modification converts view into regular message
+   view->setField(1, (UINT32)4321);
+   AssertFalse(view->isView());
+   AssertEquals(view->getFieldAsUInt32(1), 4321);
+   AssertTrue(!safe_tcscmp(view->getFieldAsString(2, buffer, 64), _T("test text")));
+   delete view;
+
+   // View over compressed message
+   binMsg = vmsg.serialize(true);
+   AssertTrue((ntohs(binMsg->flags) & MF_COMPRESSED) != 0);
+   view = NXCPMessage::createView(binMsg);
+   AssertNotNull(view);
+   AssertTrue(view->isDetached());
+   MemFree(binMsg);
+   longTextOut = view->getFieldAsString(100);
+   AssertTrue(!_tcscmp(longTextOut, longText));
+   MemFree(longTextOut);
+   delete view;
+
+   // View owning its receive buffer
+   binMsg = vmsg.serialize(false);
+   view = NXCPMessage::createView(binMsg);
+   AssertNotNull(view);
+   view->adoptBuffer(binMsg);
+   AssertTrue(view->isView());
+   AssertTrue(view->isDetached());
+   AssertEquals(view->getFieldAsUInt64(3), _ULL(1234567890123));
+   longTextOut = view->getFieldAsString(100);
+   AssertTrue(!_tcscmp(longTextOut, longText));
+   MemFree(longTextOut);
+   delete view;
+
+   // Malformed message should be rejected like by deserialize()
+   binMsg = vmsg.serialize(false);
+   binMsg->numFields = htonl(ntohl(binMsg->numFields) + 1);
+   AssertNull(NXCPMessage::deserialize(binMsg));
+   AssertNull(NXCPMessage::createView(binMsg));
+   MemFree(binMsg);
+
+   binMsg = vmsg.serialize(false);
+   binMsg->size = htonl(ntohl(binMsg->size) - 16);
+   AssertNull(NXCPMessage::createView(binMsg));
+   MemFree(binMsg);
+
+   EndTest();
+
+   binMsg = vmsg.serialize(false);
+   StartTest(_T("NXCP message deserialization performance"));
+   start = GetCurrentTimeMs();
+   for(int i = 0; i < 100000; i++)
+   {
+      NXCPMessage *m = NXCPMessage::deserialize(binMsg);
+      m->getFieldAsUInt32(1);
+      delete m;
+   }
+   EndTest(GetCurrentTimeMs() - start);
+
+   StartTest(_T("NXCP message view performance"));
+   start = GetCurrentTimeMs();
+   for(int i = 0; i < 100000; i++)
+   {
+      NXCPMessage *m = NXCPMessage::createView(binMsg);
+      m->getFieldAsUInt32(1);
+      delete m;
+   }
+   EndTest(GetCurrentTimeMs() - start);
+   MemFree(binMsg);
+
+#ifndef _WIN32
+   StartTest(_T("NXCP message streaming"));
+
+   SOCKET sockets[2];
+   AssertTrue(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+
+   BYTE *largeBinary = MemAllocArrayNoInit<BYTE>(300000);
+   for(int i = 0; i < 300000; i++)
+      largeBinary[i] = static_cast<BYTE>(i % 251);
+   vmsg.setField(200, largeBinary, 300000);
+   vmsg.setFieldFromUtf8String(201, "UTF-8 string");
+   InetAddress addr = InetAddress::parse("10.0.0.1");
+   vmsg.setField(202, addr);
+
+   // Streamed message should be identical to serialized one
+   binMsg = vmsg.serialize(false);
+   BYTE *received = SendAndReceive(&vmsg, sockets, NULL, false, ntohl(binMsg->size));
+   AssertNotNull(received);
+   AssertTrue(!memcmp(received, binMsg, ntohl(binMsg->size)));
+   MemFree(received);
+   MemFree(binMsg);
+
+   binMsg = vmsg.serialize(true);
+   AssertTrue((ntohs(binMsg->flags) & MF_COMPRESSED) != 0);
+   received = SendAndReceive(&vmsg, sockets, NULL, true, ntohl(binMsg->size));
+   AssertNotNull(received);
+   AssertTrue((ntohs(reinterpret_cast<NXCP_MESSAGE*>(received)->flags) & MF_COMPRESSED) != 0);
+   copy = NXCPMessage::deserialize(reinterpret_cast<NXCP_MESSAGE*>(received));
+   AssertNotNull(copy);
+   AssertEquals(copy->getFieldAsUInt32(1), 1234);
+   longTextOut = copy->getFieldAsString(100);
+   AssertTrue(!_tcscmp(longTextOut, longText));
+   MemFree(longTextOut);
+   size_t size;
+   const BYTE *binaryOut = copy->getBinaryFieldPtr(200, &size);
+   AssertEquals(size, 300000);
+   AssertTrue(!memcmp(binaryOut, largeBinary, 300000));
+   delete copy;
+   MemFree(received);
+   MemFree(binMsg);
+
+   // Streaming from view
+   binMsg = vmsg.serialize(false);
+   view = NXCPMessage::createView(binMsg);
+   received = SendAndReceive(view, sockets, NULL, false, ntohl(binMsg->size));
+   AssertNotNull(received);
+   AssertTrue(!memcmp(received, binMsg, ntohl(binMsg->size)));
+   MemFree(received);
+   delete view;
+   MemFree(binMsg);
+
+   // Encrypted stream
+   InitCryptoLib(0xFFFF);
+   NXCPEncryptionContext *ctx = NXCPEncryptionContext::create(NXCP_SUPPORT_AES_256);
+   AssertNotNull(ctx);
+   MessageSenderData data;
+   data.msg = &vmsg;
+   data.socket = sockets[0];
+   data.ctx = ctx;
+   data.compress = false;
+   data.success = false;
+   THREAD thread = ThreadCreateEx(MessageSender, 0, &data);
+   SocketMessageReceiver receiver(sockets[1], 4096, 1024 * 1024);
+   receiver.setEncryptionContext(ctx);
+   MessageReceiverResult result;
+   copy = receiver.readMessage(5000, &result);
+   ThreadJoin(thread);
+   AssertTrue(data.success);
+   AssertNotNull(copy);
+   AssertEquals(copy->getId(), 17);
+   AssertEquals(copy->getFieldAsUInt64(3), _ULL(1234567890123));
+   longTextOut = copy->getFieldAsString(100);
+   AssertTrue(!_tcscmp(longTextOut, longText));
+   MemFree(longTextOut);
+   binaryOut = copy->getBinaryFieldPtr(200, &size);
+   AssertNotNull(binaryOut);
+   AssertEquals(size, 300000);
+   AssertTrue(!memcmp(binaryOut, largeBinary, 300000));
+   AssertTrue(copy->getFieldAsInetAddress(202).equals(addr));
+   delete copy;
+   ctx->decRefCount();
+
+   MemFree(largeBinary);
+   closesocket(sockets[0]);
+   closesocket(sockets[1]);
+
+   EndTest();
+#endif
+
    StartTest(_T("NXCP message compression performance"));
-   INT64 start = GetCurrentTimeMs();
+   start = GetCurrentTimeMs();
    for(int i = 0; i < 10000; i++)
    {
       NXCP_MESSAGE *binMsg = msg.serialize(true);
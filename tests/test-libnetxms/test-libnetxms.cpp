@@ -7,11 +7,13 @@
 #include <nxqueue.h>
 #include <nxcpapi.h>
 #include <nxproc.h>
+#include <nxstat.h>
 #include <testtools.h>
 
 NETXMS_EXECUTABLE_HEADER(test-libnetxms)
 
 void TestMemoryPool();
+void TestMemoryPoolPerformance();
 void TestObjectMemoryPool();
 void TestThreadPool();
 void TestMsgWaitQueue();
@@ -21,6 +23,11 @@ void TestMutexWrapper();
 void TestRWLockWrapper();
 void TestConditionWrapper();
 void TestThreadCountAndMaxWaitTime();
+void TestThreadPoolSerialization();
+void TestThreadPoolPerformance();
+void TestThreadPoolBurst();
+void TestTimerWheel();
+void TestThreadPoolScheduler();
 void TestProcessExecutor(const char *procname);
 void TestProcessExecutorWorker();
 void TestSubProcess(const char *procname);
@@ -1231,6 +1238,123 @@ static void TestHashMap()
    EndTest();
 }
 
+/**
+ * Number of elements for hash map performance tests
+ */
+#define HASH_MAP_PERF_ELEMENTS   200000
+
+/**
+ * Callback for hash map iteration performance test
+ */
+static EnumerationCallbackResult HashMapPerfCallback(const void *key, const void *value, void *context)
+{
+   *static_cast<UINT64*>(context) += *static_cast<const UINT32*>(key);
+   return _CONTINUE;
+}
+
+/**
+ * Callback for string map iteration performance test
+ */
+static EnumerationCallbackResult StringMapPerfCallback(const TCHAR *key, const void *value, void *context)
+{
+   (*static_cast<int*>(context))++;
+   return _CONTINUE;
+}
+
+/**
+ * Test hash map and string map performance
+ */
+static void TestHashMapPerformance()
+{
+   String value(_T("value"));
+   HashMap<UINT32, String> *hashMap = new HashMap<UINT32, String>(Ownership::False);
+
+   StartTest(_T("HashMap performance - insert"));
+   INT64 start = GetCurrentTimeMs();
+   for(UINT32 i = 0; i < HASH_MAP_PERF_ELEMENTS; i++)
+      hashMap->set(i * 7919, &value);
+   AssertEquals(hashMap->size(), HASH_MAP_PERF_ELEMENTS);
+   EndTest(GetCurrentTimeMs() - start);
+
+   StartTest(_T("HashMap performance - memory per entry"));
+   size_t bytesPerEntry = hashMap->memoryUsage() / hashMap->size();
+   AssertTrue(bytesPerEntry < 64);
+   _tprintf(_T("%d bytes\n"), static_cast<int>(bytesPerEntry));
+
+   StartTest(_T("HashMap performance - find"));
+   start = GetCurrentTimeMs();
+   int found = 0;
+   for(UINT32 i = 0; i < HASH_MAP_PERF_ELEMENTS * 2; i++)
+      if (hashMap->get(i * 7919) != NULL)
+         found++;
+   AssertEquals(found, HASH_MAP_PERF_ELEMENTS);
+   EndTest(GetCurrentTimeMs() - start);
+
+   StartTest(_T("HashMap performance - iterate"));
+   start = GetCurrentTimeMs();
+   UINT64 sum = 0;
+   for(int i = 0; i < 10; i++)
+      hashMap->forEach(HashMapPerfCallback, &sum);
+   AssertEquals(sum, static_cast<UINT64>(HASH_MAP_PERF_ELEMENTS - 1) * HASH_MAP_PERF_ELEMENTS / 2 * 7919 * 10);
+   EndTest(GetCurrentTimeMs() - start);
+
+   StartTest(_T("HashMap performance - remove"));
+   start = GetCurrentTimeMs();
+   for(UINT32 i = 0; i < HASH_MAP_PERF_ELEMENTS; i += 2)
+      hashMap->remove(i * 7919);
+   AssertEquals(hashMap->size(), HASH_MAP_PERF_ELEMENTS / 2);
+   AssertNull(hashMap->get(0));
+   AssertNotNull(hashMap->get(7919));
+   EndTest(GetCurrentTimeMs() - start);
+
+   delete hashMap;
+
+   StringObjectMap<String> *m = new StringObjectMap<String>(Ownership::False);
+   TCHAR key[64];
+
+   StartTest(_T("StringMap performance - insert"));
+   start = GetCurrentTimeMs();
+   for(int i = 0; i < HASH_MAP_PERF_ELEMENTS; i++)
+   {
+      _sntprintf(key, 64, _T("Key-%d"), i);
+      m->set(key, &value);
+   }
+   AssertEquals(m->size(), HASH_MAP_PERF_ELEMENTS);
+   EndTest(GetCurrentTimeMs() - start);
+
+   StartTest(_T("StringMap performance - memory per entry"));
+   bytesPerEntry = m->memoryUsage() / m->size();
+   AssertTrue(bytesPerEntry < 192);
+   _tprintf(_T("%d bytes\n"), static_cast<int>(bytesPerEntry));
+
+   StartTest(_T("StringMap performance - find"));
+   start = GetCurrentTimeMs();
+   found = 0;
+   for(int i = 0; i < HASH_MAP_PERF_ELEMENTS * 2; i++)
+   {
+      _sntprintf(key, 64, _T("KEY-%d"), i);
+      if (m->get(key) != NULL)
+         found++;
+   }
+   AssertEquals(found, HASH_MAP_PERF_ELEMENTS);
+   EndTest(GetCurrentTimeMs() - start);
+
+   StartTest(_T("StringMap performance - iterate"));
+   start = GetCurrentTimeMs();
+   int count = 0;
+   for(int i = 0; i < 10; i++)
+      m->forEach(StringMapPerfCallback, &count);
+   AssertEquals(count, HASH_MAP_PERF_ELEMENTS * 10);
+   StringList *keys = m->keys();
+   AssertTrue(!_tcscmp(keys->get(0), _T("Key-0")));
+   _sntprintf(key, 64, _T("Key-%d"), HASH_MAP_PERF_ELEMENTS - 1);
+   AssertTrue(!_tcscmp(keys->get(HASH_MAP_PERF_ELEMENTS - 1), key));
+   delete keys;
+   EndTest(GetCurrentTimeMs() - start);
+
+   delete m;
+}
+
 /**
  * Test shared hash map
  */
@@ -2044,6 +2168,67 @@ static void TestDebugTags()
    EndTest();
 }
 
+/**
+ * Debug logging benchmark thread
+ */
+static THREAD_RESULT THREAD_CALL DebugLogBenchmarkThread(void *arg)
+{
+   for(int i = 0; i < 100000; i++)
+      nxlog_debug_tag(_T("test.log.benchmark"), 6, _T("Debug log benchmark message %d from thread %p"), i, arg);
+   return THREAD_OK;
+}
+
+/**
+ * Run debug logging benchmark with 4 threads
+ */
+static void RunDebugLogBenchmark(const TCHAR *name)
+{
+   StartTest(name);
+   INT64 startTime = GetCurrentTimeMs();
+   THREAD threads[4];
+   for(int i = 0; i < 4; i++)
+      threads[i] = ThreadCreateEx(DebugLogBenchmarkThread, 0, CAST_TO_POINTER(i, void*));
+   for(int i = 0; i < 4; i++)
+      ThreadJoin(threads[i]);
+   EndTest(GetCurrentTimeMs() - startTime);
+}
+
+/**
+ * Test debug logging overhead at different debug levels
+ */
+static void TestDebugLogPerformance()
+{
+   const TCHAR *logFile = _T("test-libnetxms-debug.log");
+   StartTest(_T("Open log file with background writer"));
+   nxlog_set_rotation_policy(NXLOG_ROTATION_DISABLED, 0, 0, NULL);
+   AssertTrue(nxlog_open(logFile, NXLOG_BACKGROUND_WRITER));
+   EndTest();
+
+   static int levels[] = { 0, 5, 9 };
+   for(int l = 0; l < 3; l++)
+   {
+      TCHAR name[64];
+      _sntprintf(name, 64, _T("Debug logging overhead - level %d"), levels[l]);
+      nxlog_set_debug_level(levels[l]);
+      RunDebugLogBenchmark(name);
+   }
+
+   // Benchmark tag won't be logged, but its level could not be rejected by global maximum
+   nxlog_set_debug_level(0);
+   nxlog_set_debug_level_tag(_T("test.other"), 9);
+   RunDebugLogBenchmark(_T("Debug logging overhead - other tag at level 9"));
+   nxlog_set_debug_level_tag(_T("test.other"), -1);
+
+   StartTest(_T("Close log file"));
+   nxlog_close();
+   nxlog_set_rotation_policy(NXLOG_ROTATION_BY_SIZE, 4096 * 1024, 4, NULL);
+   NX_STAT_STRUCT st;
+   AssertTrue(CALL_STAT(logFile, &st) == 0);
+   AssertTrue(st.st_size > 400000 * 50);   // all messages should be written
+   _tremove(logFile);
+   EndTest();
+}
+
 /**
  * Debug writer for logger
  */
@@ -2087,6 +2272,7 @@ int main(int argc, char *argv[])
 #endif
 
    TestMemoryPool();
+   TestMemoryPoolPerformance();
    TestObjectMemoryPool();
    TestString();
    TestStringConversion();
@@ -2103,6 +2289,7 @@ int main(int argc, char *argv[])
    TestItoa();
    TestQueue();
    TestHashMap();
+   TestHashMapPerformance();
    TestSharedHashMap();
    TestSynchronizedSharedHashMap();
    TestHashSet();
@@ -2118,9 +2305,15 @@ int main(int argc, char *argv[])
    TestRingBuffer();
    TestDebugLevel();
    TestDebugTags();
+   TestDebugLogPerformance();
    TestProcessExecutor(argv[0]);
    TestSubProcess(argv[0]);
    TestThreadPool();
    TestThreadCountAndMaxWaitTime();
+   TestThreadPoolSerialization();
+   TestThreadPoolPerformance();
+   TestThreadPoolBurst();
+   TestTimerWheel();
+   TestThreadPoolScheduler();
    return 0;
 }
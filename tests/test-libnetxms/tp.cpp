@@ -1,6 +1,7 @@
 #include <nms_common.h>
 #include <nms_util.h>
 #include <testtools.h>
+#include <timer_wheel.h>
 
 static void EmptyWorkload(void *arg)
 {
@@ -90,3 +91,398 @@ void TestThreadCountAndMaxWaitTime()
    ThreadPoolDestroy(threadPool);
    EndTest();
 }
+
+/**
+ * Serialized execution test data
+ */
+struct SerializedExecutionData
+{
+   int key;
+   int sequence;
+   int *lastSequence;
+   VolatileCounter *errors;
+   VolatileCounter *remaining;
+   CONDITION done;
+};
+
+static void SerializedWorkload(void *arg)
+{
+   SerializedExecutionData *d = static_cast<SerializedExecutionData*>(arg);
+   if (d->lastSequence[d->key] != d->sequence - 1)
+      InterlockedIncrement(d->errors);
+   d->lastSequence[d->key] = d->sequence;
+   if (InterlockedDecrement(d->remaining) == 0)
+      ConditionSet(d->done);
+   delete d;
+}
+
+void TestThreadPoolSerialization()
+{
+   StartTest(_T("Thread pool - serialized execution order"));
+   ThreadPool *p = ThreadPoolCreate(_T("SERIAL"), 8, 8);
+   int lastSequence[64];
+   for(int i = 0; i < 64; i++)
+      lastSequence[i] = -1;
+   VolatileCounter errors = 0;
+   VolatileCounter remaining = 64 * 500;
+   CONDITION done = ConditionCreate(true);
+   for(int n = 0; n < 500; n++)
+   {
+      for(int k = 0; k < 64; k++)
+      {
+         SerializedExecutionData *d = new SerializedExecutionData;
+         d->key = k;
+         d->sequence = n;
+         d->lastSequence = lastSequence;
+         d->errors = &errors;
+         d->remaining = &remaining;
+         d->done = done;
+         TCHAR key[32];
+         _sntprintf(key, 32, _T("Key%d"), k);
+         ThreadPoolExecuteSerialized(p, key, SerializedWorkload, d);
+      }
+   }
+   AssertTrue(ConditionWait(done, 30000));
+   AssertEquals(errors, 0);
+   ThreadPoolDestroy(p);
+   ConditionDestroy(done);
+   EndTest();
+}
+
+/**
+ * Thread pool benchmark data
+ */
+struct ThreadPoolBenchmarkData
+{
+   ThreadPool *pool;
+   VolatileCounter remaining;
+   CONDITION done;
+   int tasks;
+};
+
+static void CountingWorkload(void *arg)
+{
+   ThreadPoolBenchmarkData *d = static_cast<ThreadPoolBenchmarkData*>(arg);
+   if (InterlockedDecrement(&d->remaining) == 0)
+      ConditionSet(d->done);
+}
+
+static void SpawningWorkload(void *arg)
+{
+   ThreadPoolBenchmarkData *d = static_cast<ThreadPoolBenchmarkData*>(arg);
+   for(int i = 0; i < 16; i++)
+      ThreadPoolExecute(d->pool, CountingWorkload, d);
+   CountingWorkload(d);
+}
+
+static THREAD_RESULT THREAD_CALL SubmitterThread(void *arg)
+{
+   ThreadPoolBenchmarkData *d = static_cast<ThreadPoolBenchmarkData*>(arg);
+   for(int i = 0; i < d->tasks; i++)
+      ThreadPoolExecute(d->pool, CountingWorkload, d);
+   return THREAD_OK;
+}
+
+/**
+ * Thread pool throughput benchmark - external submitters and tasks spawning subtasks
+ */
+void TestThreadPoolPerformance()
+{
+   static const int submitters = 4;
+   static const int tasksPerSubmitter = 50000;
+
+   for(int threads = 1; threads <= 64; threads *= 2)
+   {
+      TCHAR name[64];
+      _sntprintf(name, 64, _T("Thread pool throughput - %d threads"), threads);
+      StartTest(name);
+
+      ThreadPoolBenchmarkData d;
+      d.pool = ThreadPoolCreate(_T("BENCHMARK"), threads, threads);
+      d.remaining = submitters * tasksPerSubmitter;
+      d.done = ConditionCreate(true);
+      d.tasks = tasksPerSubmitter;
+
+      INT64 start = GetCurrentTimeMs();
+      THREAD submitterThreads[submitters];
+      for(int i = 0; i < submitters; i++)
+         submitterThreads[i] = ThreadCreateEx(SubmitterThread, 0, &d);
+      for(int i = 0; i < submitters; i++)
+         ThreadJoin(submitterThreads[i]);
+      AssertTrue(ConditionWait(d.done, 60000));
+      EndTest(GetCurrentTimeMs() - start);
+
+      _sntprintf(name, 64, _T("Thread pool nested tasks - %d threads"), threads);
+      StartTest(name);
+      ConditionReset(d.done);
+      d.remaining = 17 * 10000;
+      start = GetCurrentTimeMs();
+      for(int i = 0; i < 10000; i++)
+         ThreadPoolExecute(d.pool, SpawningWorkload, &d);
+      AssertTrue(ConditionWait(d.done, 60000));
+      EndTest(GetCurrentTimeMs() - start);
+
+      ThreadPoolDestroy(d.pool);
+      ConditionDestroy(d.done);
+   }
+}
+
+static void BlockingWorkload(void *arg)
+{
+   ConditionWait(static_cast<CONDITION>(arg), 60000);
+}
+
+/**
+ * Bursts of short tasks while some workers are blocked - tasks distributed into deques
+ * of blocked workers should be picked up by other workers
+ */
+void TestThreadPoolBurst()
+{
+   StartTest(_T("Thread pool - task bursts with blocked workers"));
+
+   ThreadPoolBenchmarkData d;
+   d.pool = ThreadPoolCreate(_T("BURST"), 8, 8);
+   d.done = ConditionCreate(true);
+
+   CONDITION release = ConditionCreate(true);
+   for(int i = 0; i < 4; i++)
+      ThreadPoolExecute(d.pool, BlockingWorkload, release);
+   ThreadSleepMs(100);
+
+   bool success = true;
+   for(int round = 0; (round < 500) && success; round++)
+   {
+      ConditionReset(d.done);
+      d.remaining = 64;
+      for(int i = 0; i < 64; i++)
+         ThreadPoolExecute(d.pool, CountingWorkload, &d);
+      success = ConditionWait(d.done, 10000);
+   }
+   AssertTrue(success);
+
+   ConditionSet(release);
+   ThreadPoolDestroy(d.pool);
+   ConditionDestroy(d.done);
+   ConditionDestroy(release);
+   EndTest();
+}
+
+/**
+ * Timer wheel test context
+ */
+struct TimerWheelTestContext
+{
+   INT64 now;
+   INT64 prevNow;
+   int expired;
+   int errors;
+};
+
+static void TimerWheelTestCallback(void *data, void *context)
+{
+   TimerWheelTestContext *c = static_cast<TimerWheelTestContext*>(context);
+   INT64 expirationTime = *static_cast<INT64*>(data);
+   // Timer should expire exactly during first advance() call covering its expiration time
+   if ((expirationTime > c->now) || (expirationTime <= c->prevNow))
+      c->errors++;
+   c->expired++;
+}
+
+/**
+ * Simple deterministic pseudo-random generator for timer tests
+ */
+static inline UINT64 NextRandom(UINT64 *state)
+{
+   *state = *state * _ULL(6364136223846793005) + _ULL(1442695040888963407);
+   return *state >> 16;
+}
+
+/**
+ * Test timer wheel
+ */
+void TestTimerWheel()
+{
+   StartTest(_T("Timer wheel - expiration"));
+   static const int count = 20000;
+   INT64 *expirationTimes = MemAllocArray<INT64>(count);
+   UINT64 *ids = MemAllocArray<UINT64>(count);
+   UINT64 rs = 1;
+   TimerWheel wheel(0);
+   for(int i = 0; i < count; i++)
+   {
+      // Mix of short, medium, long, and very long (more than 2^32 ms) delays
+      switch(i % 4)
+      {
+         case 0:
+            expirationTimes[i] = NextRandom(&rs) % 1000;
+            break;
+         case 1:
+            expirationTimes[i] = NextRandom(&rs) % 1000000;
+            break;
+         case 2:
+            expirationTimes[i] = NextRandom(&rs) % _ULL(1000000000);
+            break;
+         default:
+            expirationTimes[i] = NextRandom(&rs) % _ULL(20000000000);
+            break;
+      }
+      ids[i] = wheel.add(expirationTimes[i], &expirationTimes[i]);
+      AssertTrue(ids[i] != 0);
+   }
+   AssertEquals(wheel.size(), count);
+
+   // Cancel every 8th timer
+   int cancelled = 0;
+   for(int i = 0; i < count; i += 8)
+   {
+      void *data = NULL;
+      AssertTrue(wheel.cancel(ids[i], &data));
+      AssertTrue(data == &expirationTimes[i]);
+      AssertFalse(wheel.cancel(ids[i]));
+      cancelled++;
+   }
+   AssertEquals(wheel.size(), count - cancelled);
+
+   TimerWheelTestContext context;
+   context.now = -1;
+   context.expired = 0;
+   context.errors = 0;
+   while(wheel.size() > 0)
+   {
+      context.prevNow = context.now;
+      INT64 next = wheel.getNextExpirationTime();
+      AssertTrue(next > context.prevNow);
+      // Advance either to next processing point or with random step
+      context.now = ((NextRandom(&rs) % 3) == 0) ? next : context.now + static_cast<INT64>(NextRandom(&rs) % 5000000) + 1;
+      wheel.advance(context.now, TimerWheelTestCallback, &context);
+   }
+   AssertEquals(context.expired, count - cancelled);
+   AssertEquals(context.errors, 0);
+   AssertEquals(wheel.getNextExpirationTime(), -1);
+
+   // Identifiers of expired timers should not be valid anymore
+   for(int i = 1; i < count; i += 8)
+      AssertFalse(wheel.cancel(ids[i]));
+   EndTest();
+
+   StartTest(_T("Timer wheel - interleaved add and advance"));
+   context.expired = 0;
+   int added = 0;
+   while(added < count)
+   {
+      // Add few timers relative to current time and advance by small step,
+      // so that processing regularly stops exactly at slot boundaries
+      int n = static_cast<int>(NextRandom(&rs) % 5);
+      for(int i = 0; (i < n) && (added < count); i++, added++)
+      {
+         expirationTimes[added] = context.now + 1 + static_cast<INT64>(NextRandom(&rs) % (((added % 2) == 0) ? 700 : 70000));
+         wheel.add(expirationTimes[added], &expirationTimes[added]);
+      }
+      context.prevNow = context.now;
+      context.now += static_cast<INT64>(NextRandom(&rs) % (((added % 3) == 0) ? 5000 : 50)) + 1;
+      wheel.advance(context.now, TimerWheelTestCallback, &context);
+   }
+   while(wheel.size() > 0)
+   {
+      context.prevNow = context.now;
+      context.now += 10;
+      wheel.advance(context.now, TimerWheelTestCallback, &context);
+   }
+   AssertEquals(context.expired, count);
+   AssertEquals(context.errors, 0);
+   EndTest();
+
+   StartTest(_T("Timer wheel - add/cancel performance"));
+   INT64 start = GetCurrentTimeMs();
+   for(int n = 0; n < 50; n++)
+   {
+      for(int i = 0; i < count; i++)
+         ids[i] = wheel.add(context.now + static_cast<INT64>(NextRandom(&rs) % 3600000), NULL);
+      for(int i = 0; i < count; i++)
+         wheel.cancel(ids[i]);
+   }
+   AssertEquals(wheel.size(), 0);
+   EndTest(GetCurrentTimeMs() - start);
+
+   MemFree(ids);
+   MemFree(expirationTimes);
+}
+
+/**
+ * Scheduled task data
+ */
+struct ScheduledTaskData
+{
+   INT64 runTime;
+   VolatileCounter *executed;
+   VolatileCounter *early;
+};
+
+static void ScheduledWorkload(void *arg)
+{
+   ScheduledTaskData *d = static_cast<ScheduledTaskData*>(arg);
+   if (GetCurrentTimeMs() < d->runTime)
+      InterlockedIncrement(d->early);
+   InterlockedIncrement(d->executed);
+}
+
+/**
+ * Test thread pool scheduler
+ */
+void TestThreadPoolScheduler()
+{
+   StartTest(_T("Thread pool - scheduled execution"));
+   ThreadPool *p = ThreadPoolCreate(_T("SCHEDULER"), 4, 4);
+   static const int count = 2000;
+   ScheduledTaskData *tasks = MemAllocArray<ScheduledTaskData>(count);
+   UINT64 *ids = MemAllocArray<UINT64>(count);
+   VolatileCounter executed = 0;
+   VolatileCounter early = 0;
+   INT64 now = GetCurrentTimeMs();
+   for(int i = 0; i < count; i++)
+   {
+      UINT32 delay = 10 + (i * 7) % 700;
+      tasks[i].runTime = now + delay;
+      tasks[i].executed = &executed;
+      tasks[i].early = &early;
+      ids[i] = ThreadPoolScheduleRelative(p, delay, ScheduledWorkload, &tasks[i]);
+      AssertTrue(ids[i] != 0);
+   }
+
+   int cancelled = 0;
+   for(int i = 0; i < count; i += 4)
+   {
+      if (ThreadPoolCancelScheduledTask(p, ids[i]))
+         cancelled++;
+   }
+   AssertTrue(cancelled > count / 8);
+
+   ThreadSleepMs(1500);
+   AssertEquals(static_cast<int>(executed), count - cancelled);
+   AssertEquals(static_cast<int>(early), 0);
+   AssertFalse(ThreadPoolCancelScheduledTask(p, ids[1]));
+
+   ThreadPoolInfo info;
+   ThreadPoolGetInfo(p, &info);
+   AssertEquals(info.scheduledRequests, 0);
+   EndTest();
+
+   StartTest(_T("Thread pool - schedule and cancel 1000000 tasks"));
+   static const int bulkCount = 1000000;
+   UINT64 *bulkIds = MemAllocArray<UINT64>(bulkCount);
+   INT64 start = GetCurrentTimeMs();
+   for(int i = 0; i < bulkCount; i++)
+      bulkIds[i] = ThreadPoolScheduleRelative(p, 60000 + (i % 3600) * 1000, ScheduledWorkload, &tasks[0]);
+   ThreadPoolGetInfo(p, &info);
+   AssertEquals(info.scheduledRequests, bulkCount);
+   for(int i = 0; i < bulkCount; i++)
+      AssertTrue(ThreadPoolCancelScheduledTask(p, bulkIds[i]));
+   ThreadPoolGetInfo(p, &info);
+   AssertEquals(info.scheduledRequests, 0);
+   EndTest(GetCurrentTimeMs() - start);
+
+   ThreadPoolDestroy(p);
+   MemFree(bulkIds);
+   MemFree(ids);
+   MemFree(tasks);
+}
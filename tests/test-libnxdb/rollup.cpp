@@ -0,0 +1,174 @@
+#include <nms_common.h>
+#include <nms_util.h>
+#include <nms_rollup.h>
+#include <testtools.h>
+
+/**
+ * Collected segment
+ */
+struct Segment
+{
+   int tier;
+   INT64 from;
+   INT64 to;
+};
+
+/**
+ * Collect range segment
+ */
+static bool CollectSegment(int tier, INT64 from, INT64 to, void *context)
+{
+   Segment s;
+   s.tier = tier;
+   s.from = from;
+   s.to = to;
+   static_cast<StructArray<Segment>*>(context)->add(&s);
+   return true;
+}
+
+/**
+ * Check segment
+ */
+static void AssertSegment(StructArray<Segment> *segments, int index, int tier, INT64 from, INT64 to)
+{
+   Segment *s = segments->get(index);
+   AssertNotNull(s);
+   AssertEquals(s->tier, tier);
+   AssertEquals(s->from, from);
+   AssertEquals(s->to, to);
+}
+
+/**
+ * Data rollup tests
+ */
+void TestDataRollups()
+{
+   StartTest(_T("Data rollups - parse resolution"));
+   AssertEquals(ParseRollupResolution(_T("300")), _LL(300));
+   AssertEquals(ParseRollupResolution(_T("45s")), _LL(45));
+   AssertEquals(ParseRollupResolution(_T("5m")), _LL(300));
+   AssertEquals(ParseRollupResolution(_T("1 H")), _LL(3600));
+   AssertEquals(ParseRollupResolution(_T("7d")), _LL(604800));
+   AssertEquals(ParseRollupResolution(_T("5x")), _LL(0));
+   AssertEquals(ParseRollupResolution(_T("1hh")), _LL(0));
+   AssertEquals(RollupAlignDown(3700, 3600), _LL(3600));
+   AssertEquals(RollupAlignUp(3700, 3600), _LL(7200));
+   AssertEquals(RollupAlignUp(7200, 3600), _LL(7200));
+   EndTest();
+
+   StartTest(_T("Data rollups - aggregate"));
+   RollupAggregate a;
+   a.reset();
+   AssertFalse(a.hasExtremes());
+   a.update(5);
+   a.update(-2);
+   a.update(10);
+   AssertTrue(a.hasExtremes());
+   AssertEquals(a.count, 3);
+   AssertEquals(a.minValue, -2.0);
+   AssertEquals(a.maxValue, 10.0);
+   AssertEquals(a.sum, 13.0);
+
+   RollupAggregate b;
+   b.reset();
+   b.update(20);
+   a.merge(&b);
+   AssertEquals(a.count, 4);
+   AssertEquals(a.maxValue, 20.0);
+   AssertEquals(a.sum, 33.0);
+
+   // Empty aggregate should not affect extremes
+   b.reset();
+   a.merge(&b);
+   AssertEquals(a.count, 4);
+   AssertEquals(a.minValue, -2.0);
+   AssertEquals(a.maxValue, 20.0);
+   EndTest();
+
+   StartTest(_T("Data rollups - deletion adjustment"));
+   // Pending deletion recorded before any values were added to bucket
+   RollupAggregate delta;
+   delta.reset();
+   delta.subtract(1, 10);
+   delta.update(7);
+   delta.update(8);
+   AssertEquals(delta.count, 1);
+   AssertEquals(delta.sum, 5.0);
+   AssertEquals(delta.minValue, 7.0);
+
+   // Merge with stored record and recalculated extremes
+   RollupAggregate stored;
+   stored.reset();
+   stored.update(10);
+   stored.update(3);
+   RollupAggregate adjustment;
+   adjustment.reset();
+   adjustment.count = stored.count;
+   adjustment.sum = stored.sum;
+   adjustment.minValue = 3;
+   adjustment.maxValue = 8;
+   delta.resetExtremes();
+   delta.merge(&adjustment);
+   AssertEquals(delta.count, 3);
+   AssertEquals(delta.sum, 18.0);
+   AssertEquals(delta.minValue, 3.0);
+   AssertEquals(delta.maxValue, 8.0);
+
+   // Deletion of only value in period
+   RollupAggregate single;
+   single.reset();
+   single.update(42);
+   single.subtract(1, 42);
+   AssertEquals(single.count, 0);
+   AssertEquals(single.sum, 0.0);
+   EndTest();
+
+   RollupTier tiers[3];
+   tiers[0].resolution = 300;
+   tiers[0].coverageStart = 0;
+   tiers[1].resolution = 3600;
+   tiers[1].coverageStart = 0;
+   tiers[2].resolution = 86400;
+   tiers[2].coverageStart = 0;
+
+   StartTest(_T("Data rollups - split range"));
+   StructArray<Segment> segments;
+   AssertTrue(SplitRollupRange(tiers, 2, 86100, 2 * 86400 + 3900, 10 * 86400, CollectSegment, &segments));
+   AssertEquals(segments.size(), 4);
+   AssertSegment(&segments, 0, 0, 86100, 86400);
+   AssertSegment(&segments, 1, 2, 86400, 2 * 86400);
+   AssertSegment(&segments, 2, 1, 2 * 86400, 2 * 86400 + 3600);
+   AssertSegment(&segments, 3, 0, 2 * 86400 + 3600, 2 * 86400 + 3900);
+
+   // Edges shorter than finest tier resolution are read from raw data
+   segments.clear();
+   AssertTrue(SplitRollupRange(tiers, 2, 100, 4020, 10 * 86400, CollectSegment, &segments));
+   AssertEquals(segments.size(), 3);
+   AssertSegment(&segments, 0, -1, 100, 300);
+   AssertSegment(&segments, 1, 0, 300, 3900);
+   AssertSegment(&segments, 2, -1, 3900, 4020);
+
+   // Periods not flushed yet are read from raw data
+   segments.clear();
+   AssertTrue(SplitRollupRange(tiers, 2, 100, 4020, 3100, CollectSegment, &segments));
+   AssertEquals(segments.size(), 3);
+   AssertSegment(&segments, 1, 0, 300, 3000);
+   AssertSegment(&segments, 2, -1, 3000, 4020);
+
+   // Periods before tier coverage start are not used
+   tiers[2].coverageStart = 2 * 86400;
+   segments.clear();
+   AssertTrue(SplitRollupRange(tiers, 2, 0, 3 * 86400, 10 * 86400, CollectSegment, &segments));
+   AssertEquals(segments.size(), 2);
+   AssertSegment(&segments, 0, 1, 0, 2 * 86400);
+   AssertSegment(&segments, 1, 2, 2 * 86400, 3 * 86400);
+   tiers[2].coverageStart = 0;
+   EndTest();
+
+   StartTest(_T("Data rollups - select tier"));
+   AssertEquals(SelectRollupTier(tiers, 3, 86400, 500), 0);
+   AssertEquals(SelectRollupTier(tiers, 3, 7 * 86400, 500), 1);
+   AssertEquals(SelectRollupTier(tiers, 3, 365 * 86400, 500), 2);
+   AssertEquals(SelectRollupTier(tiers, 3, 3650 * 86400LL, 500), 2);
+   EndTest();
+}
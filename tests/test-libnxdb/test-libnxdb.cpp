@@ -21,6 +21,7 @@ NETXMS_EXECUTABLE_HEADER(test-libnxdb)
 #endif
 
 void TestOracleBatch(const TCHAR *server, const TCHAR *login, const TCHAR *password);
+void TestDataRollups();
 
 /**
  * Common tests
@@ -136,6 +137,190 @@ static void CommonTests(const TCHAR *prefix, const TCHAR *driver, const TCHAR *s
    EndTest();
 }
 
+/**
+ * Count records in given table
+ */
+static INT32 CountRecords(DB_HANDLE session, const TCHAR *table)
+{
+   TCHAR query[256];
+   _sntprintf(query, 256, _T("SELECT count(*) FROM %s"), table);
+   DB_RESULT hResult = DBSelect(session, query);
+   if (hResult == NULL)
+      return -1;
+   INT32 count = DBGetFieldLong(hResult, 0, 0);
+   DBFreeResult(hResult);
+   return count;
+}
+
+/**
+ * Time partitioned table tests
+ */
+static void TimePartitionTests(const TCHAR *prefix, const TCHAR *driver, const TCHAR *server,
+         const TCHAR *dbName, const TCHAR *login, const TCHAR *password, const TCHAR *syntax)
+{
+   DB_DRIVER drv = DBLoadDriver(driver, _T(""), false, NULL, NULL);
+   AssertNotNull(drv);
+
+   TCHAR buffer[DBDRV_MAX_ERROR_TEXT];
+   DB_HANDLE session = DBConnect(drv, server, dbName, login, password, NULL, buffer);
+   AssertNotNull(session);
+
+   if (DBIsTableExist(session, _T("metadata")) == DBIsTableExist_Found)
+      DBQuery(session, _T("DROP TABLE metadata"));
+   AssertTrueEx(DBQueryEx(session, _T("CREATE TABLE metadata (var_name varchar(63) not null, var_value varchar(255) not null, PRIMARY KEY(var_name))"), buffer), buffer);
+   TCHAR query[256];
+   _sntprintf(query, 256, _T("INSERT INTO metadata (var_name,var_value) VALUES ('Syntax','%s')"), syntax);
+   AssertTrueEx(DBQueryEx(session, query, buffer), buffer);
+
+   StartTest(prefix, _T("time partitions - create"));
+   static INT64 starts[] = { 0, 3600, 7200, 10800 };
+   for(int i = 0; i < 4; i++)
+   {
+      TCHAR name[64];
+      DBGetTimePartitionName(_T("nx_data"), starts[3 - i], name, 64);
+      _sntprintf(query, 256, _T("CREATE TABLE %s (item_id integer not null,data_timestamp integer not null,data_value varchar(63))"), name);
+      AssertTrueEx(DBQueryEx(session, query, buffer), buffer);
+   }
+   AssertTrueEx(DBQueryEx(session, _T("CREATE TABLE nx_data_pending (id integer)"), buffer), buffer);
+   AssertTrueEx(DBQueryEx(session, _T("CREATE TABLE nx_datax_p100 (id integer)"), buffer), buffer);
+
+   IntegerArray<INT64> *partitions = DBGetTimePartitions(session, _T("nx_data"));
+   AssertNotNull(partitions);
+   AssertEquals(partitions->size(), 4);
+   for(int i = 0; i < 4; i++)
+      AssertEquals(partitions->get(i), starts[i]);
+   EndTest();
+
+   StartTest(prefix, _T("time partitions - find"));
+   AssertEquals(DBFindTimePartition(partitions, 0), 0);
+   AssertEquals(DBFindTimePartition(partitions, 3599), 0);
+   AssertEquals(DBFindTimePartition(partitions, 3600), 1);
+   AssertEquals(DBFindTimePartition(partitions, 10000), 2);
+   AssertEquals(DBFindTimePartition(partitions, 100000), 3);
+   AssertEquals(DBFindTimePartition(partitions, -1), -1);
+   EndTest();
+
+   StartTest(prefix, _T("time partitions - view"));
+   AssertTrue(DBBegin(session));
+   for(int t = 0; t < 14400; t += 60)
+   {
+      TCHAR name[64];
+      DBGetTimePartitionName(_T("nx_data"), partitions->get(DBFindTimePartition(partitions, t)), name, 64);
+      _sntprintf(query, 256, _T("INSERT INTO %s (item_id,data_timestamp,data_value) VALUES (1,%d,'%d')"), name, t, t);
+      AssertTrueEx(DBQueryEx(session, query, buffer), buffer);
+   }
+   AssertTrue(DBCommit(session));
+   AssertTrue(DBRebuildTimePartitionView(session, _T("nx_data"), partitions));
+   AssertEquals(CountRecords(session, _T("nx_data")), 240);
+   AssertEquals(CountRecords(session, _T("nx_data_p3600")), 60);
+   DB_RESULT hResult = DBSelect(session, _T("SELECT data_timestamp FROM nx_data WHERE item_id=1 ORDER BY data_timestamp DESC LIMIT 1"));
+   AssertNotNull(hResult);
+   AssertEquals(DBGetFieldLong(hResult, 0, 0), 14340);
+   DBFreeResult(hResult);
+   EndTest();
+
+   StartTest(prefix, _T("time partitions - drop"));
+   partitions->remove(0);
+   AssertTrue(DBRebuildTimePartitionView(session, _T("nx_data"), partitions));
+   AssertTrue(DBQuery(session, _T("DROP TABLE nx_data_p0")));
+   AssertEquals(CountRecords(session, _T("nx_data")), 180);
+   delete partitions;
+   partitions = DBGetTimePartitions(session, _T("nx_data"));
+   AssertNotNull(partitions);
+   AssertEquals(partitions->size(), 3);
+   AssertEquals(partitions->get(0), static_cast<INT64>(3600));
+   EndTest();
+
+   StartTest(prefix, _T("time partitions - boundary crossing"));
+   AssertTrue(DBBegin(session));
+   for(int t = 14340; t < 14460; t += 60)
+   {
+      if (t >= partitions->get(partitions->size() - 1) + 3600)
+      {
+         // Next partition is created on same connection within writer's transaction
+         TCHAR name[64];
+         _sntprintf(query, 256, _T("CREATE TABLE %s (item_id integer not null,data_timestamp integer not null,data_value varchar(63))"),
+                  DBGetTimePartitionName(_T("nx_data"), t - t % 3600, name, 64));
+         AssertTrueEx(DBQueryEx(session, query, buffer), buffer);
+         partitions->add(t - t % 3600);
+         AssertTrue(DBRebuildTimePartitionView(session, _T("nx_data"), partitions));
+      }
+      TCHAR name[64];
+      DBGetTimePartitionName(_T("nx_data"), partitions->get(DBFindTimePartition(partitions, t)), name, 64);
+      _sntprintf(query, 256, _T("INSERT INTO %s (item_id,data_timestamp,data_value) VALUES (2,%d,'%d')"), name, t, t);
+      AssertTrueEx(DBQueryEx(session, query, buffer), buffer);
+   }
+   AssertTrue(DBCommit(session));
+   AssertEquals(partitions->size(), 4);
+   AssertEquals(CountRecords(session, _T("nx_data_p10800")), 61);
+   AssertEquals(CountRecords(session, _T("nx_data_p14400")), 1);
+   AssertEquals(CountRecords(session, _T("nx_data")), 182);
+   EndTest();
+
+   StartTest(prefix, _T("time partitions - creation rollback"));
+   AssertTrue(DBBegin(session));
+   AssertTrue(DBQuery(session, _T("CREATE TABLE nx_data_p18000 (item_id integer not null,data_timestamp integer not null,data_value varchar(63))")));
+   AssertTrue(DBRollback(session));
+   delete partitions;
+   partitions = DBGetTimePartitions(session, _T("nx_data"));
+   AssertNotNull(partitions);
+   AssertEquals(partitions->size(), 4);
+   AssertEquals(partitions->get(3), static_cast<INT64>(14400));
+   EndTest();
+
+   StartTest(prefix, _T("time partitions - view update failure"));
+   partitions->add(18000);  // Partition table does not exist
+   AssertFalse(DBRebuildTimePartitionView(session, _T("nx_data"), partitions));
+   partitions->remove(partitions->size() - 1);
+   AssertEquals(CountRecords(session, _T("nx_data")), 182);
+   EndTest();
+
+   StartTest(prefix, _T("time partitions - large view"));
+   IntegerArray<INT64> largeSet(720, 16);
+   AssertTrue(DBBegin(session));
+   for(int i = 0; i < 720; i++)
+   {
+      TCHAR name[64];
+      _sntprintf(query, 256, _T("CREATE TABLE %s (item_id integer not null,data_timestamp integer not null,data_value varchar(63))"),
+               DBGetTimePartitionName(_T("nx_large"), i * 3600, name, 64));
+      AssertTrueEx(DBQueryEx(session, query, buffer), buffer);
+      _sntprintf(query, 256, _T("INSERT INTO %s (item_id,data_timestamp,data_value) VALUES (1,%d,'%d')"), name, i * 3600, i);
+      AssertTrueEx(DBQueryEx(session, query, buffer), buffer);
+      largeSet.add(i * 3600);
+   }
+   AssertTrue(DBCommit(session));
+   AssertTrue(DBRebuildTimePartitionView(session, _T("nx_large"), &largeSet));
+   AssertEquals(CountRecords(session, _T("nx_large")), 720);
+   largeSet.remove(0);
+   AssertTrue(DBRebuildTimePartitionView(session, _T("nx_large"), &largeSet));
+   AssertEquals(CountRecords(session, _T("nx_large")), 719);
+   DBQuery(session, _T("DROP VIEW nx_large"));
+   AssertTrue(DBBegin(session));
+   for(int i = 0; i < 720; i++)
+   {
+      TCHAR name[64];
+      _sntprintf(query, 256, _T("DROP TABLE %s"), DBGetTimePartitionName(_T("nx_large"), i * 3600, name, 64));
+      DBQuery(session, query);
+   }
+   AssertTrue(DBCommit(session));
+   EndTest();
+
+   for(int i = 0; i < partitions->size(); i++)
+   {
+      TCHAR name[64];
+      _sntprintf(query, 256, _T("DROP TABLE %s"), DBGetTimePartitionName(_T("nx_data"), partitions->get(i), name, 64));
+      DBQuery(session, query);
+   }
+   delete partitions;
+   DBQuery(session, _T("DROP VIEW nx_data"));
+   DBQuery(session, _T("DROP TABLE nx_data_pending"));
+   DBQuery(session, _T("DROP TABLE nx_datax_p100"));
+   DBQuery(session, _T("DROP TABLE metadata"));
+
+   DBDisconnect(session);
+   DBUnloadDriver(drv);
+}
+
 /**
  * main()
  */
@@ -159,6 +344,8 @@ int main(int argc, char *argv[])
 
    DBInit();
 
+   TestDataRollups();
+
    if (!skipMySQL)
    {
       CommonTests(_T("MySQL"), _T("mysql.ddr"), MYSQL_SERVER, MYSQL_DBNAME, MYSQL_LOGIN, MYSQL_PASSWORD, _T("MYSQL"));
@@ -173,6 +360,7 @@ int main(int argc, char *argv[])
    if (!skipSQLite)
    {
       CommonTests(_T("SQLite"), _T("sqlite.ddr"), SQLITE_DB, NULL, NULL, NULL, _T("SQLITE"));
+      TimePartitionTests(_T("SQLite"), _T("sqlite.ddr"), SQLITE_DB, NULL, NULL, NULL, _T("SQLITE"));
    }
    return 0;
 }
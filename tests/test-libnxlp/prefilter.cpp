@@ -0,0 +1,194 @@
+#include <nms_common.h>
+#include <nms_util.h>
+#include <testtools.h>
+#include <libnxlp.h>
+
+/**
+ * Check literal extracted from given regexp
+ */
+static bool CheckLiteral(const TCHAR *regexp, bool ignoreCase, const TCHAR *expected)
+{
+   TCHAR *literal = ExtractRequiredLiteral(regexp, ignoreCase);
+   bool success = (expected != NULL) ? ((literal != NULL) && !_tcscmp(literal, expected)) : (literal == NULL);
+   if (!success)
+      _tprintf(_T("\n   \"%s\": expected \"%s\", got \"%s\"\n"), regexp, CHECK_NULL(expected), CHECK_NULL(literal));
+   MemFree(literal);
+   return success;
+}
+
+/**
+ * Test rule definition
+ */
+struct TestRule
+{
+   const TCHAR *regexp;
+   bool ignoreCase;
+};
+
+/**
+ * Test rules
+ */
+static TestRule s_rules[] =
+{
+   { _T("disk full"), true },
+   { _T("(error|warning): [0-9]+ items"), false },
+   { _T("^\\d+$"), false },
+   { _T("user [a-z]+ logged (in|out)"), true },
+   { _T("timeout(s)? exceeded"), false },
+   { _T("(?:GET|POST) /api/v1"), false },
+   { NULL, false }
+};
+
+/**
+ * Test line with expected prefilter candidates (bit mask of rule indexes)
+ */
+struct TestLine
+{
+   const TCHAR *text;
+   UINT32 candidates;
+};
+
+/**
+ * Test lines. Rule 2 has no extractable literal and should be always checked.
+ */
+static TestLine s_lines[] =
+{
+   { _T("DISK FULL on /dev/sda1"), 0x05 },
+   { _T("Disk Full"), 0x05 },
+   { _T("warning: 15 items dropped"), 0x06 },
+   { _T("error: 7 ITEMS dropped"), 0x06 },   // case sensitive rule is still a candidate, regexp decides
+   { _T("12345"), 0x04 },
+   { _T("user bob logged out"), 0x0C },
+   { _T("USER BOB LOGGED IN"), 0x0C },
+   { _T("timeouts exceeded"), 0x14 },
+   { _T("timeout exceeded"), 0x14 },
+   { _T("POST /api/v1/objects"), 0x24 },
+   { _T("PUT /api/v2/objects"), 0x04 },
+   { _T("disk is full, 3 items lost"), 0x06 },
+   { _T("nothing interesting"), 0x04 },
+   { _T(""), 0x04 },
+   { NULL, 0 }
+};
+
+/**
+ * Test log parser prefilter
+ */
+void TestPrefilter()
+{
+   StartTest(_T("ExtractRequiredLiteral - plain text"));
+   AssertTrue(CheckLiteral(_T("disk full"), false, _T("disk full")));
+   AssertTrue(CheckLiteral(_T("^Disk full$"), false, _T("disk full")));
+   AssertTrue(CheckLiteral(_T("\\[error\\] code"), false, _T("[error] code")));
+   AssertTrue(CheckLiteral(_T("a.b"), false, NULL));
+   AssertTrue(CheckLiteral(_T(""), false, NULL));
+   AssertTrue(CheckLiteral(NULL, false, NULL));
+   EndTest();
+
+   StartTest(_T("ExtractRequiredLiteral - alternation"));
+   AssertTrue(CheckLiteral(_T("foo|bar"), false, NULL));
+   AssertTrue(CheckLiteral(_T("disk full|disk error"), false, NULL));
+   AssertTrue(CheckLiteral(_T("(foo|bar) failed"), false, _T(" failed")));
+   AssertTrue(CheckLiteral(_T("(?:error|fail)ed to connect"), false, _T("ed to connect")));
+   AssertTrue(CheckLiteral(_T("^(GET|POST) /api/v1"), false, _T(" /api/v1")));
+   AssertTrue(CheckLiteral(_T("connection (refused|reset (by peer|remotely))"), false, _T("connection ")));
+   AssertTrue(CheckLiteral(_T("a\\|b literal"), false, _T("a|b literal")));
+   EndTest();
+
+   StartTest(_T("ExtractRequiredLiteral - character classes"));
+   AssertTrue(CheckLiteral(_T("user [a-z]+ logged in"), false, _T(" logged in")));
+   AssertTrue(CheckLiteral(_T("[]x] not closed"), false, _T(" not closed")));
+   AssertTrue(CheckLiteral(_T("[^]x]+ not closed"), false, _T(" not closed")));
+   AssertTrue(CheckLiteral(_T("[[:digit:]]+ packets dropped"), false, _T(" packets dropped")));
+   AssertTrue(CheckLiteral(_T("[|(] separator"), false, _T(" separator")));
+   AssertTrue(CheckLiteral(_T("[\\]] bracket"), false, _T(" bracket")));
+   AssertTrue(CheckLiteral(_T("abc\\d+def"), false, _T("abc")));
+   AssertTrue(CheckLiteral(_T("value\\s*=\\s*high"), false, _T("value")));
+   AssertTrue(CheckLiteral(_T("abc["), false, NULL));
+   AssertTrue(CheckLiteral(_T("[[:alpha:] abc"), false, NULL));
+   EndTest();
+
+   StartTest(_T("ExtractRequiredLiteral - optional elements"));
+   AssertTrue(CheckLiteral(_T("(error: )?disk full"), false, _T("disk full")));
+   AssertTrue(CheckLiteral(_T("timeout(s)? exceeded"), false, _T(" exceeded")));
+   AssertTrue(CheckLiteral(_T("connection( lost)?"), false, _T("connection")));
+   AssertTrue(CheckLiteral(_T("colou?r"), false, _T("colo")));
+   AssertTrue(CheckLiteral(_T("retries{0,1} exhausted"), false, _T(" exhausted")));
+   AssertTrue(CheckLiteral(_T("retries{1,3} exhausted"), false, _T(" exhausted")));
+   AssertTrue(CheckLiteral(_T("retries{0} x"), false, _T("retrie")));
+   AssertTrue(CheckLiteral(_T("ab*?cd"), false, _T("cd")));
+   AssertTrue(CheckLiteral(_T("file\\.?name"), false, _T("file")));
+   AssertTrue(CheckLiteral(_T("a*b?"), false, NULL));
+   AssertTrue(CheckLiteral(_T("size{,5}"), false, _T("size{,5}")));
+   AssertTrue(CheckLiteral(_T("(unbalanced"), false, NULL));
+   AssertTrue(CheckLiteral(_T("unbalanced)"), false, NULL));
+   EndTest();
+
+   StartTest(_T("ExtractRequiredLiteral - case insensitive"));
+   AssertTrue(CheckLiteral(_T("Disk FULL"), true, _T("disk full")));
+   AssertTrue(CheckLiteral(_T("Disk FULL"), false, _T("disk full")));
+   AssertTrue(CheckLiteral(_T("(?i)disk full"), false, NULL));
+   AssertTrue(CheckLiteral(_T("(?-i)disk full"), true, NULL));
+   AssertTrue(CheckLiteral(_T("Gr\u00F6\u00DFe \u00FCberschritten"), true, _T("berschritten")));
+   AssertTrue(CheckLiteral(_T("Gr\u00F6\u00DFe \u00FCberschritten"), false, _T("gr\u00F6\u00DFe \u00FCberschritten")));
+   AssertTrue(CheckLiteral(_T("\\QDisk\\E full"), true, NULL));
+   EndTest();
+
+   LogParser parser;
+   ObjectArray<LogParserRule> rules(16, 16, Ownership::True);
+   for(int i = 0; s_rules[i].regexp != NULL; i++)
+      rules.add(new LogParserRule(&parser, _T("test"), s_rules[i].regexp, s_rules[i].ignoreCase));
+
+   StartTest(_T("LogParserPrefilter - candidate rules"));
+   LogParserPrefilter prefilter(&rules);
+   AssertEquals(prefilter.getLiteralCount(), rules.size() - 1);
+   for(int i = 0; s_lines[i].text != NULL; i++)
+   {
+      prefilter.scan(s_lines[i].text);
+      for(int j = 0; j < rules.size(); j++)
+         AssertEquals(prefilter.isCandidate(j), (s_lines[i].candidates & (1 << j)) != 0);
+   }
+   EndTest();
+
+   StartTest(_T("LogParserPrefilter - matching rules are always candidates"));
+   int matches = 0;
+   for(int i = 0; s_lines[i].text != NULL; i++)
+   {
+      prefilter.scan(s_lines[i].text);
+      for(int j = 0; j < rules.size(); j++)
+      {
+         if (rules.get(j)->match(s_lines[i].text, 0, NULL, NULL))
+         {
+            AssertTrue(prefilter.isCandidate(j));
+            matches++;
+         }
+      }
+   }
+   AssertEquals(matches, 9);
+   EndTest();
+
+   StartTest(_T("LogParserPrefilter - overlapping literals"));
+   ObjectArray<LogParserRule> overlapping(16, 16, Ownership::True);
+   overlapping.add(new LogParserRule(&parser, _T("test"), _T("abcd"), false));
+   overlapping.add(new LogParserRule(&parser, _T("test"), _T("bc"), false));
+   overlapping.add(new LogParserRule(&parser, _T("test"), _T("bcx"), false));
+   overlapping.add(new LogParserRule(&parser, _T("test"), _T("cdcd"), false));
+   LogParserPrefilter prefilter2(&overlapping);
+   prefilter2.scan(_T("xxabcdcdx"));
+   AssertTrue(prefilter2.isCandidate(0));
+   AssertTrue(prefilter2.isCandidate(1));
+   AssertFalse(prefilter2.isCandidate(2));
+   AssertTrue(prefilter2.isCandidate(3));
+   prefilter2.scan(_T("abbcx"));
+   AssertFalse(prefilter2.isCandidate(0));
+   AssertTrue(prefilter2.isCandidate(1));
+   AssertTrue(prefilter2.isCandidate(2));
+   AssertFalse(prefilter2.isCandidate(3));
+   EndTest();
+
+   StartTest(_T("LogParserPrefilter - no rules"));
+   ObjectArray<LogParserRule> empty(16, 16, Ownership::True);
+   LogParserPrefilter prefilter3(&empty);
+   prefilter3.scan(_T("some line"));
+   AssertEquals(prefilter3.getLiteralCount(), 0);
+   EndTest();
+}
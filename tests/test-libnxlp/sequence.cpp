@@ -0,0 +1,61 @@
+#include <nms_common.h>
+#include <nms_util.h>
+#include <testtools.h>
+#include <libnxlp.h>
+
+/**
+ * Find sequence in given buffer and return offset of match or -1
+ */
+static int Find(const char *data, int length, const char *sequence, int seqLength)
+{
+   char buffer[64];
+   memcpy(buffer, data, length);
+   char *p = FindSequence(buffer, length, sequence, seqLength);
+   return (p != NULL) ? static_cast<int>(p - buffer) : -1;
+}
+
+/**
+ * Test search for end of line in multibyte encodings
+ */
+void TestFindSequence()
+{
+   StartTest(_T("FindSequence - UCS-2 little endian"));
+   AssertEquals(Find("a\0b\0\n\0c\0", 8, "\n\0", 2), 4);
+   AssertEquals(Find("a\0b\0c\0", 6, "\n\0", 2), -1);
+   AssertEquals(Find("\r\0\n\0", 4, "\r\0", 2), 0);
+   EndTest();
+
+   StartTest(_T("FindSequence - UCS-2 big endian"));
+   AssertEquals(Find("\0a\0b\0\n\0c", 8, "\0\n", 2), 4);
+   AssertEquals(Find("\0a\0b\0c", 6, "\0\n", 2), -1);
+   EndTest();
+
+   StartTest(_T("FindSequence - UCS-4 little endian"));
+   AssertEquals(Find("a\0\0\0b\0\0\0\n\0\0\0", 12, "\n\0\0\0", 4), 8);
+   AssertEquals(Find("a\0\0\0b\0\0\0", 8, "\n\0\0\0", 4), -1);
+   EndTest();
+
+   StartTest(_T("FindSequence - UCS-4 big endian"));
+   AssertEquals(Find("\0\0\0a\0\0\0b\0\0\0\n", 12, "\0\0\0\n", 4), 8);
+   AssertEquals(Find("\0\0\0a\0\0\0b", 8, "\0\0\0\n", 4), -1);
+   EndTest();
+
+   StartTest(_T("FindSequence - misaligned matches"));
+   // U+0A41 U+4200 contain bytes 0A 00 at odd offset, real new line follows
+   AssertEquals(Find("\x41\n\0\x42\n\0", 6, "\n\0", 2), 4);
+   AssertEquals(Find("\x41\n\0\x42", 4, "\n\0", 2), -1);
+   // Same for big endian: 00 0A across character boundary
+   AssertEquals(Find("\x41\0\n\x42\0\n", 6, "\0\n", 2), 4);
+   // UCS-4: 00 00 00 0A at offset 2 spans two characters
+   AssertEquals(Find("\0\x01\0\0\0\n\0\0\0\0\0\n", 12, "\0\0\0\n", 4), 8);
+   AssertEquals(Find("\0\x01\0\0\0\n\0\0", 8, "\0\0\0\n", 4), -1);
+   // UCS-4 little endian: 0A 00 00 00 at offset 1
+   AssertEquals(Find("\x41\n\0\0\0\x01\0\0\n\0\0\0", 12, "\n\0\0\0", 4), 8);
+   EndTest();
+
+   StartTest(_T("FindSequence - incomplete character at the end"));
+   AssertEquals(Find("a\0\n", 3, "\n\0", 2), -1);
+   AssertEquals(Find("a\0\0\0\n\0\0", 7, "\n\0\0\0", 4), -1);
+   AssertEquals(Find("\0\0\0a\0\0\0", 7, "\0\0\0\n", 4), -1);
+   EndTest();
+}
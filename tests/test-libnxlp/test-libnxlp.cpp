@@ -0,0 +1,38 @@
+#include <nms_common.h>
+#include <nms_util.h>
+#include <testtools.h>
+
+NETXMS_EXECUTABLE_HEADER(test-libnxlp)
+
+void TestFindSequence();
+void TestPrefilter();
+
+/**
+ * Debug writer
+ */
+static void DebugWriter(const TCHAR *tag, const TCHAR *format, va_list args)
+{
+   if (tag != NULL)
+      _tprintf(_T("[DEBUG/%-20s] "), tag);
+   else
+      _tprintf(_T("[DEBUG%-21s] "), _T(""));
+   _vtprintf(format, args);
+   _fputtc(_T('\n'), stdout);
+}
+
+/**
+ * main()
+ */
+int main(int argc, char *argv[])
+{
+   InitNetXMSProcess(true);
+   if ((argc > 1) && !strcmp(argv[1], "-debug"))
+   {
+      nxlog_set_debug_writer(DebugWriter);
+      nxlog_set_debug_level(9);
+   }
+
+   TestFindSequence();
+   TestPrefilter();
+   return 0;
+}
@@ -142,6 +142,734 @@ static void TestVariableClass()
    EndTest();
 }
 
+/**
+ * Simulated SNMP agent
+ */
+class TestTransport : public SNMP_Transport
+{
+private:
+   ObjectArray<SNMP_Variable> *m_mib;
+   SNMP_PDU *m_response;
+   InetAddress m_addr;
+   bool m_bulkSupported;
+   UINT32 m_maxResponseVariables;
+
+public:
+   int requests;
+   int bulkRequests;
+   int lostResponses;
+   UINT32 maxDeliveredVariables; // Larger responses are lost on the way
+   bool alive;
+
+   TestTransport(ObjectArray<SNMP_Variable> *mib, SNMP_Version version, const TCHAR *addr, bool bulkSupported, UINT32 maxResponseVariables) : SNMP_Transport()
+   {
+      m_mib = mib;
+      m_response = NULL;
+      m_addr = InetAddress::parse(addr);
+      m_bulkSupported = bulkSupported;
+      m_maxResponseVariables = maxResponseVariables;
+      m_snmpVersion = version;
+      requests = 0;
+      bulkRequests = 0;
+      lostResponses = 0;
+      maxDeliveredVariables = 0xFFFFFFFF;
+      alive = true;
+   }
+
+   virtual ~TestTransport()
+   {
+      delete m_response;
+   }
+
+   virtual int readMessage(SNMP_PDU **data, UINT32 timeout, struct sockaddr *sender, socklen_t *addrSize,
+            SNMP_SecurityContext* (*contextFinder)(struct sockaddr *, socklen_t)) override
+   {
+      *data = m_response;
+      m_response = NULL;
+      return (*data != NULL) ? 1 : 0;
+   }
+
+   virtual int sendMessage(SNMP_PDU *pdu, UINT32 timeout) override
+   {
+      requests++;
+      if (pdu->getCommand() == SNMP_GET_BULK_REQUEST)
+         bulkRequests++;
+      delete_and_null(m_response);
+      if (!alive)
+      {
+         lostResponses++;
+         return 1;
+      }
+
+      UINT32 count = 1;
+      if (pdu->getCommand() == SNMP_GET_BULK_REQUEST)
+      {
+         if (!m_bulkSupported)
+         {
+            m_response = new SNMP_PDU(SNMP_RESPONSE, pdu->getRequestId(), pdu->getVersion());
+            m_response->setErrorCode(SNMP_PDU_ERR_GENERIC);
+            return 1;
+         }
+         count = pdu->getMaxRepetitions();
+      }
+
+      int numColumns = pdu->getNumVariables();
+      m_response = new SNMP_PDU(SNMP_RESPONSE, pdu->getRequestId(), pdu->getVersion());
+      if (count * numColumns > m_maxResponseVariables)
+      {
+         m_response->setErrorCode(SNMP_PDU_ERR_TOO_BIG);
+         return 1;
+      }
+
+      // Find position of next object for each requested variable
+      int *positions = MemAllocArray<int>(numColumns);
+      for(int c = 0; c < numColumns; c++)
+      {
+         const SNMP_ObjectId& name = pdu->getVariable(c)->getName();
+         int i;
+         for(i = 0; i < m_mib->size(); i++)
+         {
+            int rc = m_mib->get(i)->getName().compare(name);
+            if ((rc == OID_FOLLOWING) || (rc == OID_LONGER))
+               break;
+         }
+         positions[c] = i;
+      }
+
+      for(UINT32 n = 0; n < count; n++)
+      {
+         bool endOfMib = false;
+         for(int c = 0; c < numColumns; c++)
+         {
+            int i = positions[c] + n;
+            if (i >= m_mib->size())
+            {
+               if ((n == 0) && (m_response->getNumVariables() == c))
+               {
+                  m_response->setErrorCode(SNMP_PDU_ERR_NO_SUCH_NAME);
+                  m_response->setErrorIndex(c + 1);
+               }
+               endOfMib = true;
+               break;
+            }
+            m_response->bindVariable(new SNMP_Variable(m_mib->get(i)));
+         }
+         if (endOfMib)
+            break;
+      }
+      MemFree(positions);
+
+      if (static_cast<UINT32>(m_response->getNumVariables()) > maxDeliveredVariables)
+      {
+         delete_and_null(m_response);
+         lostResponses++;
+      }
+      return 1;
+   }
+
+   virtual InetAddress getPeerIpAddress() override { return m_addr; }
+   virtual UINT16 getPort() override { return 161; }
+   virtual bool isProxyTransport() override { return false; }
+};
+
+/**
+ * Walk callback context
+ */
+struct WalkContext
+{
+   int count;
+   bool ordered;
+   SNMP_ObjectId last;
+};
+
+/**
+ * Walk callback
+ */
+static UINT32 WalkCallback(SNMP_Variable *var, SNMP_Transport *transport, void *arg)
+{
+   WalkContext *context = static_cast<WalkContext*>(arg);
+   TCHAR expected[64], value[64];
+   _sntprintf(expected, 64, _T("interface %d"), context->count + 1);
+   if ((context->count > 0) && (var->getName().compare(context->last) != OID_FOLLOWING))
+      context->ordered = false;
+   if (_tcscmp(var->getValueAsString(value, 64), expected))
+      context->ordered = false;
+   context->last = var->getName();
+   context->count++;
+   return SNMP_ERR_SUCCESS;
+}
+
+/**
+ * Walk simulated agent and check results
+ */
+static void WalkTestTransport(TestTransport *transport, int expectedCount)
+{
+   WalkContext context;
+   context.count = 0;
+   context.ordered = true;
+   AssertEquals(SnmpWalk(transport, _T(".1.3.6.1.2.1.2.2.1.2"), WalkCallback, &context), SNMP_ERR_SUCCESS);
+   AssertEquals(context.count, expectedCount);
+   AssertTrue(context.ordered);
+}
+
+/**
+ * Test SNMP walk
+ */
+static void TestWalk()
+{
+   ObjectArray<SNMP_Variable> mib(0, 64, Ownership::True);
+   TCHAR oid[64], value[64];
+   for(int i = 1; i <= 500; i++)
+   {
+      _sntprintf(oid, 64, _T(".1.3.6.1.2.1.2.2.1.2.%d"), i);
+      _sntprintf(value, 64, _T("interface %d"), i);
+      SNMP_Variable *v = new SNMP_Variable(oid);
+      v->setValueFromString(ASN_OCTET_STRING, value);
+      mib.add(v);
+   }
+   SNMP_Variable *v = new SNMP_Variable(_T(".1.3.6.1.2.1.2.2.1.3.1"));
+   v->setValueFromString(ASN_INTEGER, _T("6"));
+   mib.add(v);
+
+   SnmpResetBulkWalkCapabilities();
+
+   StartTest(_T("SnmpWalk - GETNEXT"));
+   TestTransport t1(&mib, SNMP_VERSION_1, _T("10.0.0.1"), true, 1000);
+   WalkTestTransport(&t1, 500);
+   AssertEquals(t1.requests, 501);
+   AssertEquals(t1.bulkRequests, 0);
+   EndTest();
+
+   StartTest(_T("SnmpWalk - GETBULK"));
+   TestTransport t2(&mib, SNMP_VERSION_2C, _T("10.0.0.2"), true, 1000);
+   WalkTestTransport(&t2, 500);
+   AssertTrue(t2.requests < 50);
+   AssertEquals(t2.requests, t2.bulkRequests);
+   EndTest();
+
+   StartTest(_T("SnmpWalk - GETBULK with small agent message size"));
+   TestTransport t3(&mib, SNMP_VERSION_2C, _T("10.0.0.3"), true, 3);
+   WalkTestTransport(&t3, 500);
+   AssertTrue(t3.requests < 250);
+   EndTest();
+
+   StartTest(_T("SnmpWalk - fallback to GETNEXT"));
+   TestTransport t4(&mib, SNMP_VERSION_2C, _T("10.0.0.4"), false, 1000);
+   WalkTestTransport(&t4, 500);
+   int bulkRequests = t4.bulkRequests;
+   AssertTrue(bulkRequests > 0);
+   WalkTestTransport(&t4, 500);
+   AssertEquals(t4.bulkRequests, bulkRequests);
+   EndTest();
+
+   StartTest(_T("SnmpWalk - large responses lost"));
+   TestTransport t5(&mib, SNMP_VERSION_2C, _T("10.0.0.5"), true, 1000);
+   t5.maxDeliveredVariables = 25;
+   WalkTestTransport(&t5, 500);
+   AssertTrue(t5.lostResponses > 0);
+   int lostResponses = t5.lostResponses;
+   WalkTestTransport(&t5, 500);
+   AssertEquals(t5.lostResponses, lostResponses);  // limit learned from successful smaller request
+   EndTest();
+
+   StartTest(_T("SnmpWalk - agent stops responding"));
+   TestTransport t6(&mib, SNMP_VERSION_2C, _T("10.0.0.6"), true, 1000);
+   WalkTestTransport(&t6, 500);
+   int requests = t6.requests;
+   t6.alive = false;
+   WalkContext context;
+   context.count = 0;
+   context.ordered = true;
+   AssertEquals(SnmpWalk(&t6, _T(".1.3.6.1.2.1.2.2.1.2"), WalkCallback, &context), SNMP_ERR_TIMEOUT);
+   AssertTrue(t6.lostResponses <= 8);   // initial request and one smaller retry, with transport retries
+   t6.alive = true;
+   t6.requests = 0;
+   WalkTestTransport(&t6, 500);
+   AssertTrue(t6.requests <= requests);   // repetition limit is not lowered by plain timeout
+   EndTest();
+
+   StartTest(_T("SnmpWalk - unreachable agent is not switched to GETNEXT"));
+   TestTransport t7(&mib, SNMP_VERSION_2C, _T("10.0.0.7"), true, 1000);
+   t7.alive = false;
+   context.count = 0;
+   context.ordered = true;
+   AssertEquals(SnmpWalk(&t7, _T(".1.3.6.1.2.1.2.2.1.2"), WalkCallback, &context), SNMP_ERR_TIMEOUT);
+   AssertEquals(t7.requests, t7.bulkRequests);
+   t7.alive = true;
+   t7.requests = 0;
+   t7.bulkRequests = 0;
+   WalkTestTransport(&t7, 500);
+   AssertEquals(t7.requests, t7.bulkRequests);
+   AssertTrue(t7.requests < 50);
+   EndTest();
+}
+
+/**
+ * Table walk context
+ */
+struct TableWalkContext
+{
+   int rows;
+   int typeValues;
+   bool valid;
+};
+
+/**
+ * Table walk row handler
+ */
+static UINT32 TableWalkCallback(SNMP_Variable **values, const UINT32 *index, size_t indexLen, SNMP_Transport *transport, void *arg)
+{
+   TableWalkContext *context = static_cast<TableWalkContext*>(arg);
+   context->rows++;
+   if ((indexLen != 1) || (index[0] != static_cast<UINT32>(context->rows)))
+      context->valid = false;
+
+   // Description and speed columns are dense, type column has values only for odd rows
+   TCHAR descr[64], speed[64];
+   if ((values[0] == NULL) || (values[2] == NULL) ||
+       _tcscmp(values[0]->getValueAsString(descr, 64), values[2]->getValueAsString(speed, 64)))
+      context->valid = false;
+   if (values[1] != NULL)
+   {
+      context->typeValues++;
+      if ((index[0] % 2) == 0)
+         context->valid = false;
+   }
+   return SNMP_ERR_SUCCESS;
+}
+
+/**
+ * Test multi-column SNMP walk
+ */
+static void TestWalkTable()
+{
+   ObjectArray<SNMP_Variable> mib(0, 64, Ownership::True);
+   TCHAR oid[64], value[64];
+   for(int i = 1; i <= 100; i++)
+   {
+      _sntprintf(oid, 64, _T(".1.3.6.1.2.1.2.2.1.2.%d"), i);
+      _sntprintf(value, 64, _T("%d"), i);
+      SNMP_Variable *v = new SNMP_Variable(oid);
+      v->setValueFromString(ASN_OCTET_STRING, value);
+      mib.add(v);
+   }
+   for(int i = 1; i <= 100; i += 2)
+   {
+      _sntprintf(oid, 64, _T(".1.3.6.1.2.1.2.2.1.3.%d"), i);
+      SNMP_Variable *v = new SNMP_Variable(oid);
+      v->setValueFromString(ASN_INTEGER, _T("6"));
+      mib.add(v);
+   }
+   for(int i = 1; i <= 100; i++)
+   {
+      _sntprintf(oid, 64, _T(".1.3.6.1.2.1.2.2.1.5.%d"), i);
+      _sntprintf(value, 64, _T("%d"), i);
+      SNMP_Variable *v = new SNMP_Variable(oid);
+      v->setValueFromString(ASN_GAUGE32, value);
+      mib.add(v);
+   }
+
+   static UINT32 columnDescr[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 2 };
+   static UINT32 columnType[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 3 };
+   static UINT32 columnSpeed[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 5 };
+   ObjectArray<SNMP_ObjectId> columns(4, 4, Ownership::True);
+   columns.add(new SNMP_ObjectId(columnDescr, 10));
+   columns.add(new SNMP_ObjectId(columnType, 10));
+   columns.add(new SNMP_ObjectId(columnSpeed, 10));
+
+   SnmpResetBulkWalkCapabilities();
+
+   StartTest(_T("SnmpWalkTable - GETNEXT"));
+   TestTransport t1(&mib, SNMP_VERSION_1, _T("10.0.1.1"), true, 1000);
+   TableWalkContext context;
+   memset(&context, 0, sizeof(context));
+   context.valid = true;
+   AssertEquals(SnmpWalkTable(&t1, &columns, TableWalkCallback, &context), SNMP_ERR_SUCCESS);
+   AssertEquals(context.rows, 100);
+   AssertEquals(context.typeValues, 50);
+   AssertTrue(context.valid);
+   AssertTrue(t1.requests <= 102);
+   EndTest();
+
+   StartTest(_T("SnmpWalkTable - GETBULK"));
+   TestTransport t2(&mib, SNMP_VERSION_2C, _T("10.0.1.2"), true, 1000);
+   memset(&context, 0, sizeof(context));
+   context.valid = true;
+   AssertEquals(SnmpWalkTable(&t2, &columns, TableWalkCallback, &context), SNMP_ERR_SUCCESS);
+   AssertEquals(context.rows, 100);
+   AssertEquals(context.typeValues, 50);
+   AssertTrue(context.valid);
+   AssertTrue(t2.requests < 30);
+   EndTest();
+
+   StartTest(_T("SnmpWalkTable - agent with small message size"));
+   TestTransport t3(&mib, SNMP_VERSION_1, _T("10.0.1.3"), true, 2);
+   memset(&context, 0, sizeof(context));
+   context.valid = true;
+   AssertEquals(SnmpWalkTable(&t3, &columns, TableWalkCallback, &context), SNMP_ERR_SUCCESS);
+   AssertEquals(context.rows, 100);
+   AssertEquals(context.typeValues, 50);
+   AssertTrue(context.valid);
+   EndTest();
+
+   StartTest(_T("SnmpWalkTable - large responses lost"));
+   TestTransport t5(&mib, SNMP_VERSION_2C, _T("10.0.1.5"), true, 1000);
+   t5.maxDeliveredVariables = 30;
+   memset(&context, 0, sizeof(context));
+   context.valid = true;
+   AssertEquals(SnmpWalkTable(&t5, &columns, TableWalkCallback, &context), SNMP_ERR_SUCCESS);
+   AssertEquals(context.rows, 100);
+   AssertEquals(context.typeValues, 50);
+   AssertTrue(context.valid);
+   EndTest();
+
+   StartTest(_T("SNMP_Snapshot - multiple columns"));
+   TestTransport t4(&mib, SNMP_VERSION_2C, _T("10.0.1.4"), true, 1000);
+   SNMP_Snapshot *snapshot = SNMP_Snapshot::create(&t4, &columns);
+   AssertNotNull(snapshot);
+   AssertEquals(snapshot->size(), 250);
+   AssertNotNull(snapshot->get(_T(".1.3.6.1.2.1.2.2.1.3.1")));
+   AssertNull(snapshot->get(_T(".1.3.6.1.2.1.2.2.1.3.2")));
+   AssertEquals(snapshot->getAsUInt32(_T(".1.3.6.1.2.1.2.2.1.5.42")), 42);
+   const SNMP_Variable *v = snapshot->getNext(_T(".1.3.6.1.2.1.2.2.1.2.100"));
+   AssertNotNull(v);
+   AssertTrue(!_tcscmp(v->getName().toString(oid, 64), _T(".1.3.6.1.2.1.2.2.1.3.1")));
+   delete snapshot;
+   EndTest();
+}
+
+/**
+ * UDP agent for asynchronous engine tests
+ */
+struct UdpTestAgent
+{
+   SOCKET socket;
+   UINT16 port;
+   VolatileCounter requests;
+   bool dropFirstAttempt;
+   bool shutdown;
+};
+
+/**
+ * UDP agent thread. Responds to any request except request for sysLocation
+ * (used for timeout testing). If dropFirstAttempt is set, first attempt of
+ * each request is ignored to force retransmission.
+ */
+static THREAD_RESULT THREAD_CALL UdpTestAgentThread(void *arg)
+{
+   UdpTestAgent *agent = static_cast<UdpTestAgent*>(arg);
+   SNMP_UDPTransport transport(agent->socket);
+   transport.setSecurityContext(new SNMP_SecurityContext("public"));
+   transport.setPeerUpdatedOnRecv(true);
+   UINT32 lastDroppedId = 0;
+   while(!agent->shutdown)
+   {
+      SNMP_PDU *request;
+      SockAddrBuffer sender;
+      socklen_t addrLen = sizeof(SockAddrBuffer);
+      if ((transport.readMessage(&request, 100, (struct sockaddr *)&sender, &addrLen) <= 0) || (request == NULL))
+         continue;
+
+      InterlockedIncrement(&agent->requests);
+      const SNMP_ObjectId& name = request->getVariable(0)->getName();
+      bool drop = (name.compare(s_oidSysLocation) == OID_EQUAL);
+      if (!drop && agent->dropFirstAttempt && (request->getRequestId() != lastDroppedId))
+      {
+         lastDroppedId = request->getRequestId();
+         drop = true;
+      }
+      if (!drop)
+      {
+         SNMP_PDU response(SNMP_RESPONSE, request->getRequestId(), request->getVersion());
+         SNMP_Variable *v = new SNMP_Variable(name);
+         v->setValueFromString(ASN_OCTET_STRING, _T("Test agent"));
+         response.bindVariable(v);
+         transport.sendMessage(&response, 0);
+      }
+      delete request;
+   }
+   return THREAD_OK;
+}
+
+/**
+ * Asynchronous request test context
+ */
+struct AsyncTestContext
+{
+   VolatileCounter completed;
+   VolatileCounter succeeded;
+   int total;
+   CONDITION done;
+};
+
+/**
+ * Asynchronous request test callback
+ */
+static void AsyncTestCallback(UINT32 rcc, SNMP_PDU *response, void *context)
+{
+   AsyncTestContext *ctx = static_cast<AsyncTestContext*>(context);
+   if ((rcc == SNMP_ERR_SUCCESS) && (response != NULL) && (response->getNumVariables() == 1))
+      InterlockedIncrement(&ctx->succeeded);
+   delete response;
+   if (InterlockedIncrement(&ctx->completed) == ctx->total)
+      ConditionSet(ctx->done);
+}
+
+/**
+ * Test asynchronous SNMP engine
+ */
+static void TestAsyncEngine()
+{
+   UdpTestAgent agent;
+   memset(&agent, 0, sizeof(agent));
+   agent.socket = CreateSocket(AF_INET, SOCK_DGRAM, 0);
+   struct sockaddr_in sa;
+   memset(&sa, 0, sizeof(sa));
+   sa.sin_family = AF_INET;
+   sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   bind(agent.socket, (struct sockaddr *)&sa, sizeof(sa));
+   socklen_t len = sizeof(sa);
+   getsockname(agent.socket, (struct sockaddr *)&sa, &len);
+   agent.port = ntohs(sa.sin_port);
+   THREAD agentThread = ThreadCreateEx(UdpTestAgentThread, 0, &agent);
+
+   SNMP_AsyncEngine engine(2);
+
+   StartTest(_T("SNMP_AsyncEngine - start"));
+   AssertTrue(engine.start());
+   SnmpSetDefaultAsyncEngine(&engine);
+   EndTest();
+
+   SNMP_UDPTransport transport;
+   AssertEquals(transport.createUDPTransport(InetAddress::LOOPBACK, agent.port), SNMP_ERR_SUCCESS);
+   transport.setSecurityContext(new SNMP_SecurityContext("public"));
+   transport.setSnmpVersion(SNMP_VERSION_2C);
+
+   StartTest(_T("SNMP_AsyncEngine - synchronous request"));
+   AssertTrue(engine.isTransportSupported(&transport));
+   TCHAR value[64];
+   AssertEquals(SnmpGetEx(&transport, NULL, s_sysDescription, 9, value, 64, SG_STRING_RESULT, NULL), SNMP_ERR_SUCCESS);
+   AssertTrue(!_tcscmp(value, _T("Test agent")));
+   EndTest();
+
+   StartTest(_T("SNMP_AsyncEngine - retransmission"));
+   agent.dropFirstAttempt = true;
+   agent.requests = 0;
+   SNMP_PDU *request = new SNMP_PDU(SNMP_GET_REQUEST, SnmpNewRequestId(), SNMP_VERSION_2C);
+   request->bindVariable(new SNMP_Variable(s_oidSysDescription));
+   SNMP_PDU *response;
+   AssertEquals(transport.doRequest(request, &response, 200, 3), SNMP_ERR_SUCCESS);
+   AssertNotNull(response);
+   AssertEquals(agent.requests, 2);
+   delete response;
+   delete request;
+   agent.dropFirstAttempt = false;
+   EndTest();
+
+   StartTest(_T("SNMP_AsyncEngine - timeout"));
+   request = new SNMP_PDU(SNMP_GET_REQUEST, SnmpNewRequestId(), SNMP_VERSION_2C);
+   request->bindVariable(new SNMP_Variable(s_oidSysLocation));
+   INT64 startTime = GetCurrentTimeMs();
+   AssertEquals(transport.doRequest(request, &response, 100, 2), SNMP_ERR_TIMEOUT);
+   AssertNull(response);
+   AssertTrue(GetCurrentTimeMs() - startTime >= 190);
+   AssertEquals(engine.getPendingRequestCount(), 0);
+   delete request;
+   EndTest();
+
+   StartTest(_T("SNMP_AsyncEngine - asynchronous requests"));
+   AsyncTestContext ctx;
+   ctx.completed = 0;
+   ctx.succeeded = 0;
+   ctx.total = 100;
+   ctx.done = ConditionCreate(true);
+   for(int i = 0; i < ctx.total; i++)
+   {
+      request = new SNMP_PDU(SNMP_GET_REQUEST, SnmpNewRequestId(), SNMP_VERSION_2C);
+      request->bindVariable(new SNMP_Variable(s_oidSysDescription));
+      AssertTrue(engine.request(&transport, request, AsyncTestCallback, &ctx, 2000, 3));
+   }
+   AssertTrue(ConditionWait(ctx.done, 10000));
+   AssertEquals(ctx.succeeded, ctx.total);
+   ConditionDestroy(ctx.done);
+   EndTest();
+
+   StartTest(_T("SNMP_AsyncEngine - stop"));
+   SnmpSetDefaultAsyncEngine(NULL);
+   engine.stop();
+   AssertFalse(engine.isTransportSupported(&transport));
+   AssertEquals(SnmpGetEx(&transport, NULL, s_sysDescription, 9, value, 64, SG_STRING_RESULT, NULL), SNMP_ERR_SUCCESS);
+   AssertTrue(!_tcscmp(value, _T("Test agent")));
+   EndTest();
+
+   agent.shutdown = true;
+   ThreadJoin(agentThread);
+   closesocket(agent.socket);
+}
+
+/**
+ * Build synthetic MIB tree: .1.3.6.1.4.1.<e>.<o> with named enterprise and object nodes
+ */
+static SNMP_MIBObject *BuildTestMIBTree(UINT32 enterprises, UINT32 objects)
+{
+   SNMP_MIBObject *root = new SNMP_MIBObject();
+   SNMP_MIBObject *iso = new SNMP_MIBObject(1, _T("iso"));
+   root->addChild(iso);
+   SNMP_MIBObject *org = new SNMP_MIBObject(3, _T("org"));
+   iso->addChild(org);
+   SNMP_MIBObject *dod = new SNMP_MIBObject(6, _T("dod"));
+   org->addChild(dod);
+   SNMP_MIBObject *internet = new SNMP_MIBObject(1, _T("internet"));
+   dod->addChild(internet);
+   SNMP_MIBObject *priv = new SNMP_MIBObject(4, _T("private"));
+   internet->addChild(priv);
+   SNMP_MIBObject *ent = new SNMP_MIBObject(1, _T("enterprises"));
+   priv->addChild(ent);
+
+   TCHAR name[64], description[64];
+   for(UINT32 e = enterprises; e > 0; e--)   // reverse order to verify that children are sorted
+   {
+      _sntprintf(name, 64, _T("ent%u"), e);
+      SNMP_MIBObject *eo = new SNMP_MIBObject(e, name);
+      ent->addChild(eo);
+      for(UINT32 o = 1; o <= objects; o++)
+      {
+         _sntprintf(name, 64, _T("ent%uObject%u"), e, o);
+         _sntprintf(description, 64, _T("Object %u of enterprise %u"), o, e);
+         eo->addChild(new SNMP_MIBObject(o, name, MIB_TYPE_INTEGER, MIB_STATUS_CURRENT, MIB_ACCESS_READONLY, description, NULL));
+      }
+   }
+   return root;
+}
+
+/**
+ * Find MIB object in tree loaded from legacy file
+ */
+static SNMP_MIBObject *FindMIBObject(SNMP_MIBObject *root, const UINT32 *oid, size_t length)
+{
+   SNMP_MIBObject *curr = root;
+   for(size_t i = 0; (i < length) && (curr != NULL); i++)
+      curr = curr->findChildByID(oid[i]);
+   return curr;
+}
+
+/**
+ * Test indexed MIB file
+ */
+static void TestMIBIndex()
+{
+   static const UINT32 enterprises = 2000;
+   static const UINT32 objects = 20;
+   static const int lookups = 100000;
+
+   SNMP_MIBObject *root = BuildTestMIBTree(enterprises, objects);
+
+   StartTest(_T("SNMPSaveIndexedMIBTree"));
+   AssertEquals(SNMPSaveMIBTree(_T("test-libnxsnmp.mib"), root, 0), SNMP_ERR_SUCCESS);
+   AssertEquals(SNMPSaveIndexedMIBTree(_T("test-libnxsnmp.mibx"), root, 0), SNMP_ERR_SUCCESS);
+   EndTest();
+   delete root;
+
+   StartTest(_T("SNMP_MIBIndex::load"));
+   UINT32 rcc;
+   SNMP_MIBIndex *index = SNMP_MIBIndex::load(_T("test-libnxsnmp.mibx"), &rcc);
+   AssertNotNull(index);
+   AssertEquals(rcc, SNMP_ERR_SUCCESS);
+   AssertEquals(index->getNodeCount(), 7 + enterprises * (objects + 1));
+   AssertNull(SNMP_MIBIndex::load(_T("test-libnxsnmp.mib"), &rcc));
+   AssertEquals(rcc, SNMP_ERR_BAD_FILE_HEADER);
+   EndTest();
+
+   StartTest(_T("SNMP_MIBIndex - lookup"));
+   UINT32 oid[] = { 1, 3, 6, 1, 4, 1, 1500, 7, 2, 14 };
+   size_t matched;
+   UINT32 node = index->findNode(oid, 10, &matched);
+   AssertEquals(matched, 8);
+   AssertTrue(!strcmp(index->getName(node), "ent1500Object7"));
+   AssertTrue(!strcmp(index->getDescription(node), "Object 7 of enterprise 1500"));
+   AssertEquals(index->getType(node), MIB_TYPE_INTEGER);
+   AssertEquals(index->getAccess(node), MIB_ACCESS_READONLY);
+   AssertEquals(index->getChildCount(node), 0);
+   UINT32 parent = index->getParent(node);
+   AssertEquals(index->getChildCount(parent), objects);
+   AssertEquals(index->getSubId(index->getChild(parent, 0)), 1);
+   AssertEquals(index->getSubId(index->getChild(parent, objects - 1)), objects);
+   AssertEquals(index->findChild(parent, objects + 1), SNMP_MIB_INVALID_NODE);
+   AssertEquals(index->getType(parent), -1);
+   AssertEquals(index->findNodeByName("ent1500Object7"), node);
+   AssertEquals(index->findNodeByName("noSuchObject"), SNMP_MIB_INVALID_NODE);
+   UINT32 buffer[32];
+   AssertEquals(index->getObjectId(node, buffer, 32), 8);
+   AssertTrue(!memcmp(buffer, oid, 8 * sizeof(UINT32)));
+   EndTest();
+
+   StartTest(_T("SNMP_MIBIndex::getSymbolicName"));
+   TCHAR text[256];
+   AssertTrue(!_tcscmp(index->getSymbolicName(oid, 10, text, 256), _T("ent1500Object7.2.14")));
+   AssertTrue(!_tcscmp(index->getSymbolicName(oid, 7, text, 256), _T("ent1500")));
+   AssertTrue(!_tcscmp(index->getSymbolicName(s_sysDescription, 9, text, 256), _T("internet.2.1.1.1.0")));
+   UINT32 unknown[] = { 2, 5, 7 };
+   AssertTrue(!_tcscmp(index->getSymbolicName(unknown, 3, text, 256), _T(".2.5.7")));
+   AssertTrue(!_tcscmp(index->getSymbolicName(oid, 10, text, 17), _T("ent1500Object7.2")));
+   EndTest();
+
+   StartTest(_T("SNMPSaveIndexedMIBTree - replace loaded file"));
+   SNMP_MIBObject *smallRoot = BuildTestMIBTree(10, 5);
+   AssertEquals(SNMPSaveIndexedMIBTree(_T("test-libnxsnmp.mibx"), smallRoot, 0), SNMP_ERR_SUCCESS);
+   delete smallRoot;
+   AssertTrue(!strcmp(index->getName(node), "ent1500Object7"));   // Already loaded index should not change
+   AssertEquals(index->getObjectId(node, buffer, 32), 8);
+   SNMP_MIBIndex *smallIndex = SNMP_MIBIndex::load(_T("test-libnxsnmp.mibx"));
+   AssertNotNull(smallIndex);
+   AssertEquals(smallIndex->getNodeCount(), 7 + 10 * (5 + 1));
+   delete smallIndex;
+   root = BuildTestMIBTree(enterprises, objects);
+   AssertEquals(SNMPSaveIndexedMIBTree(_T("test-libnxsnmp.mibx"), root, 0), SNMP_ERR_SUCCESS);
+   delete root;
+   EndTest();
+
+   StartTest(_T("Legacy MIB file load performance"));
+   INT64 start = GetCurrentTimeMs();
+   AssertEquals(SNMPLoadMIBTree(_T("test-libnxsnmp.mib"), &root), SNMP_ERR_SUCCESS);
+   EndTest(GetCurrentTimeMs() - start);
+
+   StartTest(_T("Indexed MIB file load performance"));
+   start = GetCurrentTimeMs();
+   for(int i = 0; i < 100; i++)
+   {
+      SNMP_MIBIndex *tmp = SNMP_MIBIndex::load(_T("test-libnxsnmp.mibx"));
+      AssertNotNull(tmp);
+      delete tmp;
+   }
+   EndTest((GetCurrentTimeMs() - start) / 100);
+
+   StartTest(_T("Legacy MIB tree lookup performance"));
+   start = GetCurrentTimeMs();
+   for(int i = 0; i < lookups; i++)
+   {
+      oid[6] = (i % enterprises) + 1;
+      oid[7] = (i % objects) + 1;
+      AssertNotNull(FindMIBObject(root, oid, 8));
+   }
+   EndTest(GetCurrentTimeMs() - start);
+
+   StartTest(_T("Indexed MIB tree lookup performance"));
+   start = GetCurrentTimeMs();
+   for(int i = 0; i < lookups; i++)
+   {
+      oid[6] = (i % enterprises) + 1;
+      oid[7] = (i % objects) + 1;
+      index->findNode(oid, 8, &matched);
+      AssertEquals(matched, 8);
+   }
+   EndTest(GetCurrentTimeMs() - start);
+
+   delete root;
+   delete index;
+   _tremove(_T("test-libnxsnmp.mib"));
+   _tremove(_T("test-libnxsnmp.mibx"));
+}
+
 /**
  * main()
  */
@@ -152,5 +880,9 @@ int main(int argc, char *argv[])
    TestOidConversion();
    TestOidClass();
    TestVariableClass();
+   TestWalk();
+   TestWalkTable();
+   TestAsyncEngine();
+   TestMIBIndex();
    return 0;
 }
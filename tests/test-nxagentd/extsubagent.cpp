@@ -0,0 +1,218 @@
+#include <nms_common.h>
+#include <nms_util.h>
+#include <nxcpapi.h>
+#include <nxproc.h>
+#include <testtools.h>
+#include <nxagentd.h>
+
+/**
+ * Number of requester threads and requests per thread
+ */
+#define ESA_TEST_THREADS   16
+#define ESA_TEST_REQUESTS  50
+
+/**
+ * Simulated external subagent
+ */
+struct FakeSubagent
+{
+   const TCHAR *name;
+   bool batchSupported;
+   bool stop;
+   VolatileCounter batchRequests;
+   VolatileCounter singleRequests;
+   THREAD thread;
+};
+
+/**
+ * Send response to parameter request
+ */
+static void SendParameterResponse(NamedPipe *pipe, NXCPMessage *request)
+{
+   NXCPMessage response(CMD_REQUEST_COMPLETED, request->getId());
+   TCHAR name[MAX_PARAM_NAME], value[MAX_RESULT_LENGTH];
+   request->getFieldAsString(VID_PARAMETER, name, MAX_PARAM_NAME);
+   _sntprintf(value, MAX_RESULT_LENGTH, _T("value:%s"), name);
+   response.setField(VID_RCC, ERR_SUCCESS);
+   response.setField(VID_VALUE, value);
+   NXCP_MESSAGE *rawMsg = response.serialize();
+   pipe->write(rawMsg, ntohl(rawMsg->size));
+   MemFree(rawMsg);
+}
+
+/**
+ * Simulated external subagent thread. Single parameter requests are answered in reverse
+ * order once pipelined burst is over, so agent has to correlate responses by request ID.
+ */
+static THREAD_RESULT THREAD_CALL FakeSubagentThread(void *arg)
+{
+   FakeSubagent *sa = static_cast<FakeSubagent*>(arg);
+
+   TCHAR pipeName[MAX_PIPE_NAME_LEN];
+   _sntprintf(pipeName, MAX_PIPE_NAME_LEN, _T("nxagentd.subagent.%s"), sa->name);
+   NamedPipe *pipe = NULL;
+   for(int i = 0; (i < 50) && (pipe == NULL); i++)
+   {
+      pipe = NamedPipe::connect(pipeName, 1000);
+      if (pipe == NULL)
+         ThreadSleepMs(100);
+   }
+   if (pipe == NULL)
+      return THREAD_OK;
+
+   PipeMessageReceiver receiver(pipe->handle(), 8192, 1048576);
+   ObjectArray<NXCPMessage> pending(64, 64, Ownership::True);
+   while(!sa->stop)
+   {
+      MessageReceiverResult result;
+      NXCPMessage *msg = receiver.readMessage(pending.isEmpty() ? 100 : 10, &result);
+      if (msg == NULL)
+      {
+         if (result != MSGRECV_TIMEOUT)
+            break;
+         for(int i = pending.size() - 1; i >= 0; i--)
+            SendParameterResponse(pipe, pending.get(i));
+         pending.clear();
+         continue;
+      }
+
+      if (msg->getCode() == CMD_GET_PARAMETER)
+      {
+         InterlockedIncrement(&sa->singleRequests);
+         pending.add(msg);
+         continue;
+      }
+
+      NXCPMessage response(CMD_REQUEST_COMPLETED, msg->getId());
+      if ((msg->getCode() == CMD_GET_PARAMETERS) && sa->batchSupported)
+      {
+         InterlockedIncrement(&sa->batchRequests);
+         ThreadSleepMs(5);
+         response.setField(VID_RCC, ERR_SUCCESS);
+         int count = msg->getFieldAsInt32(VID_NUM_PARAMETERS);
+         UINT32 fieldId = VID_PARAM_LIST_BASE;
+         for(int i = 0; i < count; i++, fieldId += 2)
+         {
+            TCHAR name[MAX_PARAM_NAME], value[MAX_RESULT_LENGTH];
+            msg->getFieldAsString(VID_PARAM_LIST_BASE + i, name, MAX_PARAM_NAME);
+            _sntprintf(value, MAX_RESULT_LENGTH, _T("value:%s"), name);
+            response.setField(fieldId, ERR_SUCCESS);
+            response.setField(fieldId + 1, value);
+         }
+      }
+      else if (msg->getCode() == CMD_GET_LIST)
+      {
+         response.setField(VID_RCC, ERR_SUCCESS);
+         response.setField(VID_NUM_STRINGS, static_cast<UINT32>(1));
+         response.setField(VID_ENUM_VALUE_BASE, _T("element"));
+      }
+      else
+      {
+         response.setField(VID_RCC, ERR_UNKNOWN_COMMAND);
+      }
+      NXCP_MESSAGE *rawMsg = response.serialize();
+      pipe->write(rawMsg, ntohl(rawMsg->size));
+      MemFree(rawMsg);
+      delete msg;
+   }
+
+   delete pipe;
+   return THREAD_OK;
+}
+
+/**
+ * Requester thread data
+ */
+struct RequesterData
+{
+   ExternalSubagent *esa;
+   int index;
+   int failures;
+};
+
+/**
+ * Requester thread
+ */
+static THREAD_RESULT THREAD_CALL RequesterThread(void *arg)
+{
+   RequesterData *data = static_cast<RequesterData*>(arg);
+   for(int i = 0; i < ESA_TEST_REQUESTS; i++)
+   {
+      TCHAR name[MAX_PARAM_NAME], expected[MAX_RESULT_LENGTH], value[MAX_RESULT_LENGTH];
+      _sntprintf(name, MAX_PARAM_NAME, _T("Test.Parameter(%d,%d)"), data->index, i);
+      _sntprintf(expected, MAX_RESULT_LENGTH, _T("value:%s"), name);
+      value[0] = 0;
+      if ((data->esa->getParameter(name, value) != ERR_SUCCESS) || _tcscmp(value, expected))
+         data->failures++;
+   }
+   return THREAD_OK;
+}
+
+/**
+ * Run concurrent parameter requests against simulated subagent
+ */
+static void RunExternalSubagentTest(const TCHAR *name, int maxActiveRequests, bool batchSupported, FakeSubagent *sa)
+{
+   ExternalSubagent *esa = new ExternalSubagent(name, _T("*"), maxActiveRequests);
+   esa->startListener();
+
+   sa->name = name;
+   sa->batchSupported = batchSupported;
+   sa->stop = false;
+   sa->batchRequests = 0;
+   sa->singleRequests = 0;
+   sa->thread = ThreadCreateEx(FakeSubagentThread, 0, sa);
+   for(int i = 0; (i < 100) && !esa->isConnected(); i++)
+      ThreadSleepMs(50);
+   AssertTrue(esa->isConnected());
+
+   RequesterData data[ESA_TEST_THREADS];
+   THREAD threads[ESA_TEST_THREADS];
+   for(int i = 0; i < ESA_TEST_THREADS; i++)
+   {
+      data[i].esa = esa;
+      data[i].index = i;
+      data[i].failures = 0;
+      threads[i] = ThreadCreateEx(RequesterThread, 0, &data[i]);
+   }
+   for(int i = 0; i < ESA_TEST_THREADS; i++)
+   {
+      ThreadJoin(threads[i]);
+      AssertEquals(data[i].failures, 0);
+   }
+
+   // All request slots should be released
+   AssertEquals(esa->getActiveRequestCount(), 0);
+   StringList list;
+   AssertEquals(esa->getList(_T("Test.List"), &list), ERR_SUCCESS);
+   AssertEquals(list.size(), 1);
+   AssertEquals(esa->getActiveRequestCount(), 0);
+
+   sa->stop = true;
+   ThreadJoin(sa->thread);
+   esa->stopListener();
+   delete esa;
+}
+
+/**
+ * Test external subagent request scheduling
+ */
+void TestExternalSubagent()
+{
+   FakeSubagent sa;
+
+   StartTest(_T("External subagent - concurrent requests with single slot"));
+   RunExternalSubagentTest(_T("TEST1"), 1, true, &sa);
+   AssertTrue(sa.batchRequests > 0);
+   EndTest();
+
+   StartTest(_T("External subagent - batch requests"));
+   RunExternalSubagentTest(_T("TEST2"), 4, true, &sa);
+   AssertTrue(sa.batchRequests > 0);
+   EndTest();
+
+   StartTest(_T("External subagent - pipelined requests"));
+   RunExternalSubagentTest(_T("TEST3"), 2, false, &sa);
+   AssertTrue(sa.singleRequests >= ESA_TEST_THREADS * ESA_TEST_REQUESTS);
+   EndTest();
+}
@@ -0,0 +1,341 @@
+#include <nms_common.h>
+#include <nms_util.h>
+#include <nxcpapi.h>
+#include <nxstat.h>
+#include <testtools.h>
+#include <nxagentd.h>
+
+OfflineDataQueue *GetOfflineDataQueue(UINT64 serverId, bool create);
+void DeleteOfflineDataQueue(UINT64 serverId);
+void CloseOfflineDataQueues();
+int MigrateOfflineData(DB_HANDLE hdb, void (*handler)(DB_RESULT, int, OfflineDataQueue*));
+
+/**
+ * Size of test record data
+ */
+#define TEST_RECORD_SIZE   1000
+
+/**
+ * Size of test record on disk (with header)
+ */
+#define TEST_RECORD_DISK_SIZE (TEST_RECORD_SIZE + 8)
+
+/**
+ * Get name of segment file for given queue
+ */
+static void GetSegmentFileName(UINT64 serverId, UINT32 segment, TCHAR *fileName)
+{
+   _sntprintf(fileName, MAX_PATH, _T("%s") FS_PATH_SEPARATOR _T("dcqueue") FS_PATH_SEPARATOR UINT64X_FMT(_T("016")) FS_PATH_SEPARATOR _T("%08X.seg"),
+            g_szDataDirectory, serverId, segment);
+}
+
+/**
+ * Get name of cursor file for given queue
+ */
+static void GetCursorFileName(UINT64 serverId, TCHAR *fileName)
+{
+   _sntprintf(fileName, MAX_PATH, _T("%s") FS_PATH_SEPARATOR _T("dcqueue") FS_PATH_SEPARATOR UINT64X_FMT(_T("016")) FS_PATH_SEPARATOR _T("cursor"),
+            g_szDataDirectory, serverId);
+}
+
+/**
+ * Get size of given file or -1 if file does not exist
+ */
+static INT64 GetFileSize(const TCHAR *fileName)
+{
+   NX_STAT_STRUCT st;
+   return (CALL_STAT(fileName, &st) == 0) ? static_cast<INT64>(st.st_size) : -1;
+}
+
+/**
+ * Create empty queue, removing data left by previous runs
+ */
+static OfflineDataQueue *CreateEmptyQueue(UINT64 serverId)
+{
+   GetOfflineDataQueue(serverId, true)->decRefCount();
+   DeleteOfflineDataQueue(serverId);
+   return GetOfflineDataQueue(serverId, true);
+}
+
+/**
+ * Reopen queue as after agent restart
+ */
+static OfflineDataQueue *ReopenQueue(OfflineDataQueue *queue)
+{
+   UINT64 serverId = queue->getServerId();
+   queue->decRefCount();
+   CloseOfflineDataQueues();
+   return GetOfflineDataQueue(serverId, true);
+}
+
+/**
+ * Append given number of test records starting with given sequence number
+ */
+static void AppendRecords(OfflineDataQueue *queue, int start, int count)
+{
+   BYTE data[TEST_RECORD_SIZE];
+   for(int i = start; i < start + count; i++)
+   {
+      memset(data, i & 0xFF, TEST_RECORD_SIZE);
+      memcpy(data, &i, sizeof(int));
+      queue->append(data, TEST_RECORD_SIZE);
+   }
+   queue->flush(true);
+}
+
+/**
+ * Read given number of records starting at given position and check that they have expected sequence numbers
+ */
+static bool ReadRecords(OfflineDataQueue *queue, OfflineDataQueuePosition *position, int start, int count)
+{
+   for(int i = start; i < start + count; i++)
+   {
+      ByteStream *record = queue->read(position);
+      if (record == NULL)
+         return false;
+      bool valid = (record->size() == TEST_RECORD_SIZE) && !memcmp(record->buffer(), &i, sizeof(int)) &&
+               (record->buffer()[TEST_RECORD_SIZE - 1] == static_cast<BYTE>(i & 0xFF));
+      delete record;
+      if (!valid)
+         return false;
+   }
+   return true;
+}
+
+/**
+ * Overwrite part of file
+ */
+static bool PatchFile(const TCHAR *fileName, off_t offset, const void *data, size_t size)
+{
+   int fh = _topen(fileName, O_WRONLY | O_BINARY);
+   if (fh == -1)
+      return false;
+   bool success = (_lseek(fh, offset, SEEK_SET) == offset) && (_write(fh, data, static_cast<unsigned int>(size)) == static_cast<int>(size));
+   _close(fh);
+   return success;
+}
+
+/**
+ * Migration handler used by tests: record contains DCI ID only
+ */
+static void MigrationHandler(DB_RESULT hResult, int row, OfflineDataQueue *queue)
+{
+   UINT32 dciId = DBGetFieldULong(hResult, row, 1);
+   queue->append(reinterpret_cast<BYTE*>(&dciId), sizeof(UINT32));
+}
+
+/**
+ * Check that queue contains every second DCI ID from start to end in order
+ */
+static bool CheckMigratedRecords(OfflineDataQueue *queue, UINT32 start, UINT32 end)
+{
+   OfflineDataQueuePosition position = queue->getReadPosition();
+   for(UINT32 id = start; id <= end; id += 2)
+   {
+      ByteStream *record = queue->read(&position);
+      if (record == NULL)
+         return false;
+      bool valid = (record->size() == sizeof(UINT32)) && !memcmp(record->buffer(), &id, sizeof(UINT32));
+      delete record;
+      if (!valid)
+         return false;
+   }
+   ByteStream *record = queue->read(&position);
+   delete record;
+   return record == NULL;
+}
+
+/**
+ * Test migration from dc_queue table
+ */
+static void TestMigration()
+{
+   StartTest(_T("Offline data queue - migration from local database"));
+
+   DBInit();
+   DB_DRIVER driver = DBLoadDriver(_T("sqlite.ddr"), _T(""), false, NULL, NULL);
+   AssertNotNull(driver);
+
+   TCHAR dbFile[MAX_PATH], errorText[DBDRV_MAX_ERROR_TEXT];
+   _sntprintf(dbFile, MAX_PATH, _T("%s") FS_PATH_SEPARATOR _T("migration.db"), g_szDataDirectory);
+   _tremove(dbFile);
+   DB_HANDLE hdb = DBConnect(driver, dbFile, NULL, NULL, NULL, NULL, errorText);
+   AssertNotNull(hdb);
+   AssertTrue(DBQuery(hdb,
+            _T("CREATE TABLE dc_queue (")
+            _T("  server_id number(20) not null,")
+            _T("  dci_id integer not null,")
+            _T("  dci_type integer not null,")
+            _T("  dci_origin integer not null,")
+            _T("  snmp_target_guid varchar(36) not null,")
+            _T("  timestamp integer not null,")
+            _T("  value varchar not null,")
+            _T("  status_code integer not null,")
+            _T("  PRIMARY KEY(server_id,dci_id,timestamp))")));
+
+   // More records than fit into single migration block, interleaved between two servers
+   DBBegin(hdb);
+   DB_STATEMENT hStmt = DBPrepare(hdb, _T("INSERT INTO dc_queue (server_id,dci_id,dci_type,dci_origin,snmp_target_guid,timestamp,value,status_code) VALUES (?,?,1,1,'00000000-0000-0000-0000-000000000000',1000,'value',0)"));
+   AssertNotNull(hStmt);
+   for(UINT32 i = 1; i <= 24000; i++)
+   {
+      DBBind(hStmt, 1, DB_SQLTYPE_BIGINT, static_cast<UINT64>((i % 2 == 0) ? 0x11 : 0x12));
+      DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, i);
+      AssertTrue(DBExecute(hStmt));
+   }
+   DBFreeStatement(hStmt);
+   DBCommit(hdb);
+
+   CreateEmptyQueue(0x11)->decRefCount();
+   CreateEmptyQueue(0x12)->decRefCount();
+   AssertEquals(MigrateOfflineData(hdb, MigrationHandler), 24000);
+
+   DB_RESULT hResult = DBSelect(hdb, _T("SELECT count(*) FROM dc_queue"));
+   AssertNotNull(hResult);
+   AssertEquals(DBGetFieldLong(hResult, 0, 0), 0);
+   DBFreeResult(hResult);
+
+   // Migrated records should survive restart
+   CloseOfflineDataQueues();
+   OfflineDataQueue *queue = GetOfflineDataQueue(0x11, true);
+   AssertEquals(queue->getSize(), 12000);
+   AssertTrue(CheckMigratedRecords(queue, 2, 24000));
+   queue->decRefCount();
+
+   queue = GetOfflineDataQueue(0x12, true);
+   AssertEquals(queue->getSize(), 12000);
+   AssertTrue(CheckMigratedRecords(queue, 1, 23999));
+   queue->decRefCount();
+
+   // Repeated migration does nothing
+   AssertEquals(MigrateOfflineData(hdb, MigrationHandler), 0);
+
+   DBDisconnect(hdb);
+   DBUnloadDriver(driver);
+   _tremove(dbFile);
+   DeleteOfflineDataQueue(0x11);
+   DeleteOfflineDataQueue(0x12);
+
+   EndTest();
+}
+
+/**
+ * Test offline data queue
+ */
+void TestOfflineDataQueue()
+{
+   TCHAR fileName[MAX_PATH];
+
+   StartTest(_T("Offline data queue - append and read"));
+   OfflineDataQueue *queue = CreateEmptyQueue(1);
+   AssertEquals(queue->getSize(), 0);
+   AppendRecords(queue, 0, 200);
+   AssertEquals(queue->getSize(), 200);
+   OfflineDataQueuePosition position = queue->getReadPosition();
+   AssertTrue(ReadRecords(queue, &position, 0, 200));
+   AssertNull(queue->read(&position));
+   EndTest();
+
+   StartTest(_T("Offline data queue - segment deletion"));
+   GetSegmentFileName(1, 0, fileName);
+   AssertTrue(GetFileSize(fileName) > 0);
+   GetSegmentFileName(1, 2, fileName);
+   AssertTrue(GetFileSize(fileName) > 0);   // 200 records do not fit into two segments
+   position = queue->getReadPosition();
+   AssertTrue(ReadRecords(queue, &position, 0, 100));
+   queue->acknowledge(position, 100);
+   AssertEquals(queue->getSize(), 100);
+   GetSegmentFileName(1, 0, fileName);
+   AssertEquals(GetFileSize(fileName), -1);
+   GetSegmentFileName(1, position.segment, fileName);
+   AssertTrue(GetFileSize(fileName) > 0);
+   AssertTrue(ReadRecords(queue, &position, 100, 100));
+   queue->acknowledge(position, 100);
+   AssertEquals(queue->getSize(), 0);
+   for(UINT32 s = 0; s < position.segment; s++)
+   {
+      GetSegmentFileName(1, s, fileName);
+      AssertEquals(GetFileSize(fileName), -1);
+   }
+   queue->decRefCount();
+   DeleteOfflineDataQueue(1);
+   EndTest();
+
+   StartTest(_T("Offline data queue - cursor persistence"));
+   queue = CreateEmptyQueue(2);
+   AppendRecords(queue, 0, 100);
+   position = queue->getReadPosition();
+   AssertTrue(ReadRecords(queue, &position, 0, 30));
+   queue->acknowledge(position, 30);
+   queue = ReopenQueue(queue);
+   AssertEquals(queue->getSize(), 70);
+   AssertEquals(queue->getReadPosition().segment, position.segment);
+   AssertEquals(queue->getReadPosition().offset, position.offset);
+   position = queue->getReadPosition();
+   AssertTrue(ReadRecords(queue, &position, 30, 70));
+   AssertNull(queue->read(&position));
+   EndTest();
+
+   StartTest(_T("Offline data queue - corrupted cursor"));
+   GetCursorFileName(2, fileName);
+   BYTE garbage = 0xFF;
+   AssertTrue(PatchFile(fileName, 4, &garbage, 1));
+   queue = ReopenQueue(queue);
+   AssertEquals(queue->getSize(), 100);   // Replayed from the beginning
+   position = queue->getReadPosition();
+   AssertEquals(position.offset, 0);
+   AssertTrue(ReadRecords(queue, &position, 0, 100));
+   queue->decRefCount();
+   DeleteOfflineDataQueue(2);
+   EndTest();
+
+   StartTest(_T("Offline data queue - incomplete record truncation"));
+   queue = CreateEmptyQueue(3);
+   AppendRecords(queue, 0, 10);
+   queue->decRefCount();
+   CloseOfflineDataQueues();
+
+   // Simulate crash in the middle of record write
+   GetSegmentFileName(3, 0, fileName);
+   AssertEquals(GetFileSize(fileName), 10 * TEST_RECORD_DISK_SIZE);
+   BYTE partialRecord[108];
+   memset(partialRecord, 0, sizeof(partialRecord));
+   UINT32 recordSize = htonl(TEST_RECORD_SIZE);
+   memcpy(partialRecord, &recordSize, sizeof(UINT32));
+   AssertTrue(PatchFile(fileName, 10 * TEST_RECORD_DISK_SIZE, partialRecord, sizeof(partialRecord)));
+
+   queue = GetOfflineDataQueue(3, true);
+   AssertEquals(queue->getSize(), 10);
+   AssertEquals(GetFileSize(fileName), 10 * TEST_RECORD_DISK_SIZE);
+   AppendRecords(queue, 10, 5);
+   AssertEquals(queue->getSize(), 15);
+   position = queue->getReadPosition();
+   AssertTrue(ReadRecords(queue, &position, 0, 15));
+   AssertNull(queue->read(&position));
+   queue->decRefCount();
+   DeleteOfflineDataQueue(3);
+   EndTest();
+
+   StartTest(_T("Offline data queue - CRC recovery"));
+   queue = CreateEmptyQueue(4);
+   AppendRecords(queue, 0, 10);
+   queue->decRefCount();
+   CloseOfflineDataQueues();
+
+   // Damage data of record 8, it and all following records should be dropped
+   GetSegmentFileName(4, 0, fileName);
+   garbage = 0x5A;
+   AssertTrue(PatchFile(fileName, 8 * TEST_RECORD_DISK_SIZE + 100, &garbage, 1));
+
+   queue = GetOfflineDataQueue(4, true);
+   AssertEquals(queue->getSize(), 8);
+   AssertEquals(GetFileSize(fileName), 8 * TEST_RECORD_DISK_SIZE);
+   position = queue->getReadPosition();
+   AssertTrue(ReadRecords(queue, &position, 0, 8));
+   AssertNull(queue->read(&position));
+   queue->decRefCount();
+   DeleteOfflineDataQueue(4);
+   EndTest();
+
+   TestMigration();
+}
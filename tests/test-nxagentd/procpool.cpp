@@ -0,0 +1,204 @@
+#include <nms_common.h>
+#include <nms_util.h>
+#include <testtools.h>
+#include <nxagentd.h>
+
+#ifndef _WIN32
+
+#include <signal.h>
+
+/**
+ * Externals
+ */
+extern TCHAR g_szDataDirectory[];
+
+/**
+ * Simulated worker process
+ */
+static const TCHAR *s_workerScript =
+   _T("while IFS= read -r line; do\n")
+   _T("   case \"$line\" in\n")
+   _T("      Echo*) printf '%s\\n' \"${line#Echo\t}\"; echo .OK ;;\n")
+   _T("      Lines) echo first; echo ..dotted; echo ...; echo last; echo .OK ;;\n")
+   _T("      Error) echo .ERROR test error ;;\n")
+   _T("      Unsupported) echo .UNSUPPORTED ;;\n")
+   _T("      Invalid) echo .WHATEVER ;;\n")
+   _T("      Hang) sleep 30; echo .OK ;;\n")
+   _T("      Pid) echo $$; echo .OK ;;\n")
+   _T("      Files) ls /proc/$$/fd; echo .OK ;;\n")
+   _T("      Exit) exit 1 ;;\n")
+   _T("      *) echo .UNSUPPORTED ;;\n")
+   _T("   esac\n")
+   _T("done\n");
+
+/**
+ * Get process ID of pool worker which serves next request
+ */
+static pid_t GetWorkerPid(ExternalProcessPool *pool)
+{
+   StringList output;
+   if ((pool->execute(_T("Pid"), &output, 5000) != SYSINFO_RC_SUCCESS) || (output.size() != 1))
+      return 0;
+   return static_cast<pid_t>(_tcstol(output.get(0), NULL, 10));
+}
+
+/**
+ * Count lines in file
+ */
+static int CountLines(const char *fileName)
+{
+   FILE *f = fopen(fileName, "r");
+   if (f == NULL)
+      return 0;
+   int count = 0;
+   int ch;
+   while((ch = fgetc(f)) != EOF)
+   {
+      if (ch == '\n')
+         count++;
+   }
+   fclose(f);
+   return count;
+}
+
+/**
+ * Test persistent external process pool
+ */
+void TestExternalProcessPool()
+{
+   ExternalProcessPool *pool = new ExternalProcessPool(s_workerScript, 2);
+   StringList output;
+
+   StartTest(_T("External process pool - request arguments"));
+   AssertEquals(pool->execute(_T("Echo\targ1\targ 2"), &output, 5000), SYSINFO_RC_SUCCESS);
+   AssertEquals(output.size(), 1);
+   AssertTrue(!_tcscmp(output.get(0), _T("arg1\targ 2")));
+   EndTest();
+
+   StartTest(_T("External process pool - response status"));
+   output.clear();
+   AssertEquals(pool->execute(_T("Error"), &output, 5000), SYSINFO_RC_ERROR);
+   AssertEquals(output.size(), 0);
+   AssertEquals(pool->execute(_T("Unsupported"), &output, 5000), SYSINFO_RC_UNSUPPORTED);
+   AssertEquals(pool->execute(_T("Unknown"), &output, 5000), SYSINFO_RC_UNSUPPORTED);
+   AssertEquals(output.size(), 0);
+   EndTest();
+
+   StartTest(_T("External process pool - worker reuse"));
+   pid_t pid = GetWorkerPid(pool);
+   AssertTrue(pid > 0);
+   AssertEquals(GetWorkerPid(pool), pid);
+   EndTest();
+
+   StartTest(_T("External process pool - data line escaping"));
+   output.clear();
+   AssertEquals(pool->execute(_T("Lines"), &output, 5000), SYSINFO_RC_SUCCESS);
+   AssertEquals(output.size(), 4);
+   AssertTrue(!_tcscmp(output.get(0), _T("first")));
+   AssertTrue(!_tcscmp(output.get(1), _T(".dotted")));
+   AssertTrue(!_tcscmp(output.get(2), _T("..")));
+   AssertTrue(!_tcscmp(output.get(3), _T("last")));
+   EndTest();
+
+   StartTest(_T("External process pool - invalid status line"));
+   output.clear();
+   AssertEquals(pool->execute(_T("Invalid"), &output, 5000), SYSINFO_RC_ERROR);
+   AssertEquals(output.size(), 0);
+   AssertTrue(kill(pid, 0) != 0);
+   pid_t newPid = GetWorkerPid(pool);
+   AssertTrue(newPid > 0);
+   AssertTrue(newPid != pid);
+   pid = newPid;
+   EndTest();
+
+   StartTest(_T("External process pool - timeout"));
+   output.clear();
+   INT64 startTime = GetCurrentTimeMs();
+   AssertEquals(pool->execute(_T("Hang"), &output, 500), SYSINFO_RC_ERROR);
+   AssertTrue(GetCurrentTimeMs() - startTime < 3000);
+   AssertTrue(kill(pid, 0) != 0);   // hung worker should be killed
+   newPid = GetWorkerPid(pool);
+   AssertTrue(newPid > 0);
+   AssertTrue(newPid != pid);
+   pid = newPid;
+   EndTest();
+
+   StartTest(_T("External process pool - worker exit"));
+   AssertEquals(pool->execute(_T("Exit"), &output, 5000), SYSINFO_RC_ERROR);
+   newPid = GetWorkerPid(pool);
+   AssertTrue(newPid > 0);
+   AssertTrue(newPid != pid);
+   EndTest();
+
+   StartTest(_T("External process pool - file descriptors not inherited"));
+   int fds[2];
+   AssertTrue(pipe(fds) == 0);
+   pool->shutdown();
+   delete pool;
+   pool = new ExternalProcessPool(s_workerScript, 2);
+   output.clear();
+   AssertEquals(pool->execute(_T("Files"), &output, 5000), SYSINFO_RC_SUCCESS);
+   AssertTrue(output.contains(_T("0")));
+   AssertTrue(output.contains(_T("1")));
+   AssertTrue(output.contains(_T("2")));
+   TCHAR fd[16];
+   _sntprintf(fd, 16, _T("%d"), fds[0]);
+   AssertFalse(output.contains(fd));
+   _sntprintf(fd, 16, _T("%d"), fds[1]);
+   AssertFalse(output.contains(fd));
+   close(fds[0]);
+   close(fds[1]);
+   EndTest();
+
+   StartTest(_T("External process pool - shutdown"));
+   pid = GetWorkerPid(pool);
+   AssertTrue(pid > 0);
+   pool->shutdown();
+   AssertTrue(kill(pid, 0) != 0);
+   AssertEquals(pool->execute(_T("Pid"), &output, 1000), SYSINFO_RC_ERROR);
+   delete pool;
+   EndTest();
+
+   StartTest(_T("External process pool - restart back-off"));
+   char startLog[MAX_PATH];
+#ifdef UNICODE
+   snprintf(startLog, MAX_PATH, "%S/worker-start.log", g_szDataDirectory);
+#else
+   snprintf(startLog, MAX_PATH, "%s/worker-start.log", g_szDataDirectory);
+#endif
+   remove(startLog);
+   TCHAR command[MAX_PATH + 64];
+   _sntprintf(command, MAX_PATH + 64, _T("echo started >> %hs; exit 1"), startLog);
+   pool = new ExternalProcessPool(command, 1);
+   for(int i = 0; i < 3; i++)
+      AssertEquals(pool->execute(_T("Test"), &output, 2000), SYSINFO_RC_ERROR);
+   AssertEquals(CountLines(startLog), 3);
+
+   // Restarts should be suspended for 1 second after third consecutive failure
+   startTime = GetCurrentTimeMs();
+   AssertEquals(pool->execute(_T("Test"), &output, 2000), SYSINFO_RC_ERROR);
+   AssertTrue(GetCurrentTimeMs() - startTime < 500);
+   AssertEquals(CountLines(startLog), 3);
+
+   ThreadSleepMs(2100);
+   AssertEquals(pool->execute(_T("Test"), &output, 2000), SYSINFO_RC_ERROR);
+   AssertEquals(CountLines(startLog), 4);
+
+   // Restarts should be suspended again, now for longer interval
+   AssertEquals(pool->execute(_T("Test"), &output, 2000), SYSINFO_RC_ERROR);
+   AssertEquals(CountLines(startLog), 4);
+   delete pool;
+   remove(startLog);
+   EndTest();
+}
+
+#else /* _WIN32 */
+
+/**
+ * Test persistent external process pool (not supported on Windows)
+ */
+void TestExternalProcessPool()
+{
+}
+
+#endif /* _WIN32 */
@@ -0,0 +1,69 @@
+#include <nms_common.h>
+#include <nms_util.h>
+#include <testtools.h>
+#include <nxagentd.h>
+
+NETXMS_EXECUTABLE_HEADER(test-nxagentd)
+
+void TestExternalSubagent();
+void TestOfflineDataQueue();
+void TestExternalProcessPool();
+
+/**
+ * Agent globals referenced by tested modules
+ */
+UINT32 g_dwFlags = 0;
+UINT32 g_dwMaxSessions = 0;
+CommSession **g_pSessionList = NULL;
+MUTEX g_hSessionListAccess = MutexCreate();
+TCHAR g_szDataDirectory[MAX_PATH] = _T("/tmp/test-nxagentd");
+UINT64 g_dcOfflineSegmentSize = 65536;
+UINT32 g_externalProcessPoolSize = 2;
+
+/**
+ * Forward event to server (not used by tests)
+ */
+void ForwardEvent(NXCPMessage *msg)
+{
+}
+
+/**
+ * Find server session by ID (not used by tests)
+ */
+AbstractCommSession *FindServerSessionById(UINT32 id)
+{
+   return NULL;
+}
+
+/**
+ * Debug writer
+ */
+static void DebugWriter(const TCHAR *tag, const TCHAR *format, va_list args)
+{
+   if (tag != NULL)
+      _tprintf(_T("[DEBUG/%-20s] "), tag);
+   else
+      _tprintf(_T("[DEBUG%-21s] "), _T(""));
+   _vtprintf(format, args);
+   _fputtc(_T('\n'), stdout);
+}
+
+/**
+ * main()
+ */
+int main(int argc, char *argv[])
+{
+   InitNetXMSProcess(true);
+   if ((argc > 1) && !strcmp(argv[1], "-debug"))
+   {
+      nxlog_set_debug_writer(DebugWriter);
+      nxlog_set_debug_level(9);
+   }
+
+   TestExternalSubagent();
+
+   CreateFolder(g_szDataDirectory);
+   TestOfflineDataQueue();
+   TestExternalProcessPool();
+   return 0;
+}
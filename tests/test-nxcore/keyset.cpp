@@ -0,0 +1,210 @@
+#include <nms_common.h>
+#include <nms_util.h>
+#include <nxcpapi.h>
+#include <nxdbapi.h>
+#include <testtools.h>
+#include <nxcore_logs.h>
+
+#ifdef _WIN32
+#define TEST_DB_FILE   _T("C:\\test-nxcore.sqlite")
+#else
+#define TEST_DB_FILE   _T("/tmp/test-nxcore.sqlite")
+#endif
+
+/**
+ * Number of rows in test table and page size
+ */
+#define TEST_ROWS    200
+#define PAGE_SIZE    7
+
+/**
+ * Add key column
+ */
+static void AddKeyColumn(StructArray<OrderingColumn> *keyColumns, const TCHAR *name, bool descending)
+{
+   OrderingColumn c;
+   _tcslcpy(c.name, name, MAX_COLUMN_NAME_LEN);
+   c.descending = descending;
+   keyColumns->add(&c);
+}
+
+/**
+ * Build ORDER BY clause with explicit NULL placement
+ */
+static StringBuffer BuildOrderClause(const StructArray<OrderingColumn> *keyColumns, bool nullsSortedLast)
+{
+   StringBuffer sql(_T(" ORDER BY "));
+   for(int i = 0; i < keyColumns->size(); i++)
+   {
+      const OrderingColumn *c = keyColumns->get(i);
+      if (i > 0)
+         sql.append(_T(","));
+      sql.append(c->name);
+      if (c->descending)
+         sql.append(_T(" DESC"));
+      sql.append((nullsSortedLast != c->descending) ? _T(" NULLS LAST") : _T(" NULLS FIRST"));
+   }
+   return sql;
+}
+
+/**
+ * Read all rows of test table page by page using keyset condition and compare with single query result
+ */
+static bool CheckPagination(DB_HANDLE hdb, const StructArray<OrderingColumn> *keyColumns, bool nullsSortedLast)
+{
+   StringBuffer columns(_T("id"));
+   for(int i = 0; i < keyColumns->size(); i++)
+   {
+      columns.append(_T(","));
+      columns.append(keyColumns->get(i)->name);
+   }
+   StringBuffer orderClause = BuildOrderClause(keyColumns, nullsSortedLast);
+
+   StringBuffer query(_T("SELECT "));
+   query.append(columns);
+   query.append(_T(" FROM keyset_test"));
+   query.append(orderClause);
+   DB_RESULT hResult = DBSelect(hdb, query);
+   if (hResult == NULL)
+      return false;
+   IntegerArray<INT32> expected(TEST_ROWS, 16);
+   for(int i = 0; i < DBGetNumRows(hResult); i++)
+      expected.add(DBGetFieldLong(hResult, i, 0));
+   DBFreeResult(hResult);
+
+   IntegerArray<INT32> actual(TEST_ROWS, 16);
+   LogQueryCursor cursor(0);
+   while(true)
+   {
+      query = _T("SELECT ");
+      query.append(columns);
+      query.append(_T(" FROM keyset_test"));
+      if (!cursor.key.isEmpty())
+      {
+         query.append(_T(" WHERE "));
+         query.append(cursor.buildCondition(keyColumns, nullsSortedLast));
+      }
+      query.append(orderClause);
+      query.appendFormattedString(_T(" LIMIT %d"), PAGE_SIZE);
+
+      hResult = DBSelect(hdb, query);
+      if (hResult == NULL)
+         return false;
+      int count = DBGetNumRows(hResult);
+      for(int i = 0; i < count; i++)
+         actual.add(DBGetFieldLong(hResult, i, 0));
+      if (count > 0)
+      {
+         cursor.key.clear();
+         for(int i = 0; i < keyColumns->size(); i++)
+         {
+            TCHAR *value = DBGetField(hResult, count - 1, i + 1, NULL, 0);
+            cursor.key.add(CHECK_NULL_EX(value));
+            MemFree(value);
+         }
+      }
+      DBFreeResult(hResult);
+      if ((count < PAGE_SIZE) || (actual.size() > TEST_ROWS))
+         break;
+   }
+
+   if (actual.size() != expected.size())
+      return false;
+   for(int i = 0; i < expected.size(); i++)
+      if (actual.get(i) != expected.get(i))
+         return false;
+   return true;
+}
+
+/**
+ * Test log query cursor (keyset pagination condition)
+ */
+void TestLogQueryCursor()
+{
+   StartTest(_T("Log query cursor - keyset condition"));
+   StructArray<OrderingColumn> keyColumns;
+   AddKeyColumn(&keyColumns, _T("event_timestamp"), true);
+   AddKeyColumn(&keyColumns, _T("event_id"), true);
+   LogQueryCursor cursor(1000);
+   cursor.key.add(_T("1500000000"));
+   cursor.key.add(_T("42"));
+   AssertTrue(!_tcscmp(cursor.buildCondition(&keyColumns, true),
+            _T("event_timestamp<=1500000000 AND ((event_timestamp<1500000000) OR (event_timestamp=1500000000 AND event_id<42))")));
+   EndTest();
+
+   StartTest(_T("Log query cursor - keyset condition with NULL values"));
+   AssertTrue(!_tcscmp(cursor.buildCondition(&keyColumns, false),
+            _T("(event_timestamp<=1500000000 OR event_timestamp IS NULL) AND (((event_timestamp<1500000000 OR event_timestamp IS NULL)) OR (event_timestamp=1500000000 AND (event_id<42 OR event_id IS NULL)))")));
+   keyColumns.clear();
+   AddKeyColumn(&keyColumns, _T("dci_id"), false);
+   AddKeyColumn(&keyColumns, _T("event_id"), false);
+   AssertTrue(!_tcscmp(cursor.buildCondition(&keyColumns, true),
+            _T("(dci_id>=1500000000 OR dci_id IS NULL) AND (((dci_id>1500000000 OR dci_id IS NULL)) OR (dci_id=1500000000 AND (event_id>42 OR event_id IS NULL)))")));
+   cursor.key.clear();
+   cursor.key.add(_T(""));
+   cursor.key.add(_T("42"));
+   AssertTrue(!_tcscmp(cursor.buildCondition(&keyColumns, false),
+            _T("((dci_id IS NOT NULL) OR (dci_id IS NULL AND event_id>42))")));
+   AssertTrue(!_tcscmp(cursor.buildCondition(&keyColumns, true),
+            _T("dci_id IS NULL AND ((dci_id IS NULL AND (event_id>42 OR event_id IS NULL)))")));
+   EndTest();
+
+   StartTest(_T("Log query cursor - pagination over NULL values"));
+   DBInit();
+   DB_DRIVER driver = DBLoadDriver(_T("sqlite.ddr"), _T(""), false, NULL, NULL);
+   AssertNotNull(driver);
+
+   TCHAR errorText[DBDRV_MAX_ERROR_TEXT];
+   _tremove(TEST_DB_FILE);
+   DB_HANDLE hdb = DBConnect(driver, TEST_DB_FILE, NULL, NULL, NULL, NULL, errorText);
+   AssertNotNull(hdb);
+   AssertTrue(DBQuery(hdb, _T("CREATE TABLE keyset_test (id integer not null, a integer null, b integer null, PRIMARY KEY(id))")));
+   DBBegin(hdb);
+   for(int i = 1; i <= TEST_ROWS; i++)
+   {
+      TCHAR query[256], a[16], b[16];
+      if (i % 3 == 0)
+         _tcscpy(a, _T("NULL"));
+      else
+         _sntprintf(a, 16, _T("%d"), i % 7 - 3);
+      if (i % 5 == 0)
+         _tcscpy(b, _T("NULL"));
+      else
+         _sntprintf(b, 16, _T("%d"), i % 4);
+      _sntprintf(query, 256, _T("INSERT INTO keyset_test (id,a,b) VALUES (%d,%s,%s)"), i, a, b);
+      AssertTrue(DBQuery(hdb, query));
+   }
+   DBCommit(hdb);
+
+   for(int n = 0; n < 2; n++)
+   {
+      bool nullsSortedLast = (n == 1);
+
+      keyColumns.clear();
+      AddKeyColumn(&keyColumns, _T("a"), false);
+      AddKeyColumn(&keyColumns, _T("id"), false);
+      AssertTrue(CheckPagination(hdb, &keyColumns, nullsSortedLast));
+
+      keyColumns.clear();
+      AddKeyColumn(&keyColumns, _T("a"), true);
+      AddKeyColumn(&keyColumns, _T("id"), true);
+      AssertTrue(CheckPagination(hdb, &keyColumns, nullsSortedLast));
+
+      keyColumns.clear();
+      AddKeyColumn(&keyColumns, _T("a"), true);
+      AddKeyColumn(&keyColumns, _T("b"), false);
+      AddKeyColumn(&keyColumns, _T("id"), true);
+      AssertTrue(CheckPagination(hdb, &keyColumns, nullsSortedLast));
+
+      keyColumns.clear();
+      AddKeyColumn(&keyColumns, _T("b"), false);
+      AddKeyColumn(&keyColumns, _T("a"), true);
+      AddKeyColumn(&keyColumns, _T("id"), false);
+      AssertTrue(CheckPagination(hdb, &keyColumns, nullsSortedLast));
+   }
+
+   DBDisconnect(hdb);
+   DBUnloadDriver(driver);
+   _tremove(TEST_DB_FILE);
+   EndTest();
+}
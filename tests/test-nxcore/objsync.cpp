@@ -0,0 +1,82 @@
+#include <nms_common.h>
+#include <nms_util.h>
+#include <testtools.h>
+#include <nxcore_objsync.h>
+
+/**
+ * Test object revision tracker (base for delta object synchronization)
+ */
+void TestObjectRevisionTracker()
+{
+   ObjectRevisionTracker tracker;
+
+   StartTest(_T("Object revisions - initial state"));
+   tracker.setHistorySize(4);
+   UINT64 base = tracker.current();
+   AssertFalse(tracker.canResume(0));
+   AssertTrue(tracker.canResume(base));
+   AssertFalse(tracker.canResume(base + 1));   // Revision from the future (for example, before server restart)
+   EndTest();
+
+   StartTest(_T("Object revisions - resume after changes"));
+   UINT64 r1 = tracker.next();
+   UINT64 r2 = tracker.next();
+   AssertTrue(r2 > r1);
+   AssertTrue(r1 > base);
+   AssertEquals(tracker.current(), r2);
+   AssertTrue(tracker.canResume(base));
+   AssertTrue(tracker.canResume(r1));
+   EndTest();
+
+   StartTest(_T("Object revisions - deleted objects"));
+   UINT64 d1 = tracker.next();
+   tracker.registerDeletedObject(10, d1);
+   UINT64 d2 = tracker.next();
+   tracker.registerDeletedObject(11, d2);
+   IntegerArray<UINT32> deleted;
+   tracker.getDeletedObjects(base, &deleted);
+   AssertEquals(deleted.size(), 2);
+   AssertEquals(deleted.get(0), 10);
+   AssertEquals(deleted.get(1), 11);
+   deleted.clear();
+   tracker.getDeletedObjects(d1, &deleted);
+   AssertEquals(deleted.size(), 1);
+   AssertEquals(deleted.get(0), 11);
+   deleted.clear();
+   tracker.getDeletedObjects(d2, &deleted);
+   AssertEquals(deleted.size(), 0);
+   AssertTrue(tracker.canResume(base));
+   EndTest();
+
+   StartTest(_T("Object revisions - deleted object history overflow"));
+   for(UINT32 id = 12; id < 15; id++)
+      tracker.registerDeletedObject(id, tracker.next());
+   AssertFalse(tracker.canResume(base));   // Deletion of object 10 is lost
+   AssertFalse(tracker.canResume(d1));
+   AssertTrue(tracker.canResume(d2));
+   deleted.clear();
+   tracker.getDeletedObjects(d2, &deleted);
+   AssertEquals(deleted.size(), 3);
+   AssertEquals(deleted.get(0), 12);
+   AssertEquals(deleted.get(2), 14);
+   EndTest();
+
+   StartTest(_T("Object revisions - invalidation"));
+   UINT64 synced = tracker.current();
+   AssertTrue(tracker.canResume(synced));
+   tracker.invalidate();   // Access rights or object hierarchy changed
+   AssertFalse(tracker.canResume(synced));
+   AssertTrue(tracker.canResume(tracker.current()));
+   tracker.next();
+   AssertTrue(tracker.canResume(tracker.current() - 1));
+   EndTest();
+
+   StartTest(_T("Object revisions - history reset"));
+   synced = tracker.current();
+   tracker.setHistorySize(16);
+   AssertFalse(tracker.canResume(synced));
+   deleted.clear();
+   tracker.getDeletedObjects(0, &deleted);
+   AssertEquals(deleted.size(), 0);
+   EndTest();
+}